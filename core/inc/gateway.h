@@ -4,9 +4,10 @@
 /** @file gateway.h
 *	@brief Extends the Gateway_LL library with additional features.
 *
-*	@details Gateway extends the Gateway_LL library with 1 additional
-*		feature:
+*	@details Gateway extends the Gateway_LL library with 2 additional
+*		features:
 *			- Creating a gateway from a JSON configuration file.
+*			- Updating a running gateway from a JSON configuration file.
 */
 
 #ifndef GATEWAY_H
@@ -47,6 +48,26 @@ extern "C"
 	*/
 	extern GATEWAY_HANDLE Gateway_Create_From_JSON(const char* file_path);
 
+	/**
+	* @brief	Updates a running gateway to the modules and links of a JSON
+	*			configuration file.
+	*
+	* @details	Only the modules whose "module path", "args" or "queue"
+	*			changed, and the modules that were added to or removed from
+	*			the file, are removed and added, see ::Gateway_LL_Update.
+	*			The other modules keep running with their threads, their
+	*			connections and their queued messages. The "worker pool" and
+	*			"startup" settings are only read by
+	*			::Gateway_Create_From_JSON.
+	*
+	* @param	gw			The #GATEWAY_HANDLE to update.
+	* @param	file_path	Path to the JSON configuration file, in the format
+	*						read by ::Gateway_Create_From_JSON.
+	*
+	* @return	0 on success, a non-zero value otherwise.
+	*/
+	extern int Gateway_UpdateFromJSON(GATEWAY_HANDLE gw, const char* file_path);
+
 #ifdef __cplusplus
 }
 #endif
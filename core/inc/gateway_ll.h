@@ -26,7 +26,13 @@ extern "C"
 /** @brief Struct representing a particular gateway. */
 typedef struct GATEWAY_HANDLE_DATA_TAG* GATEWAY_HANDLE;
 
-/** @brief Struct representing a single entry of the #GATEWAY_PROPERTIES. */
+/** @brief		Struct representing a single entry of the #GATEWAY_PROPERTIES.
+*
+*	@details	Callers must zero every entry before setting its fields, for
+*				instance with <tt>GATEWAY_PROPERTIES_ENTRY entry = { 0 };</tt>:
+*				fields are added to this struct over time, and a zeroed field
+*				always keeps the behavior the gateway had before it existed.
+*/
 typedef struct GATEWAY_PROPERTIES_ENTRY_TAG
 {
 	/** @brief The (possibly @c NULL) name of the module */
@@ -37,8 +43,81 @@ typedef struct GATEWAY_PROPERTIES_ENTRY_TAG
 	
 	/** @brief The user-defined configuration object for the module */
 	const void* module_configuration;
+
+	/** @brief	The queue of messages waiting to be delivered to the module.
+	*			A zeroed #MESSAGE_BUS_QUEUE_CONFIG gives a queue without
+	*			limit.
+	*/
+	MESSAGE_BUS_QUEUE_CONFIG module_queue;
+
+	/** @brief	The (possibly @c NULL) vector of the names (@c const @c char*)
+	*			of the modules this module depends on, such as the modules
+	*			it publishes to. ::Gateway_LL_Create adds them to the bus
+	*			before it creates this module, and ::Gateway_LL_Destroy
+	*			removes this module first.
+	*/
+	VECTOR_HANDLE depends_on;
+
+	/** @brief	The size in bytes of @c module_configuration, or 0 if it is
+	*			not known. When it is not 0 the gateway copies that many
+	*			bytes from @c module_configuration, so it must not be more
+	*			than the caller owns there. ::Gateway_LL_Update can only
+	*			keep a module running if its configuration is @c NULL or its
+	*			size is known.
+	*/
+	size_t module_configuration_size;
 } GATEWAY_PROPERTIES_ENTRY;
 
+/** @brief	The #GATEWAY_LINK_ENTRY module_source that stands for any
+*			module of the gateway.
+*/
+#define GATEWAY_LINK_ANY_SOURCE "*"
+
+/** @brief	Struct representing a link between two modules of the gateway.
+*
+*	@details	Once a gateway has links, messages are only delivered to the
+*				modules that are the sink of a matching link. See
+*				::MessageBus_AddLink.
+*/
+typedef struct GATEWAY_LINK_ENTRY_TAG
+{
+	/** @brief	The name of the module publishing the messages, or
+	*			#GATEWAY_LINK_ANY_SOURCE for any module.
+	*/
+	const char* module_source;
+
+	/** @brief The name of the module receiving the messages */
+	const char* module_sink;
+
+	/** @brief The (possibly @c NULL) name of a property the messages must have */
+	const char* filter_property;
+
+	/** @brief The (possibly @c NULL) value @c filter_property must have */
+	const char* filter_value;
+} GATEWAY_LINK_ENTRY;
+
+/** @brief	Struct describing how ::Gateway_LL_Create starts the modules of
+*			the gateway.
+*
+*	@details	Loading a module and creating it can take a while, for
+*				instance when the module connects to a service. Started in
+*				parallel, the modules are still added to the message bus in
+*				the order of their entries, once they have all been created.
+*/
+typedef struct GATEWAY_STARTUP_CONFIG_TAG
+{
+	/** @brief	@c false to load and create the modules one after another,
+	*			@c true to load and create them concurrently on a pool of
+	*			threads.
+	*/
+	bool parallel;
+
+	/** @brief	The number of threads of the pool, or 0 for one thread per
+	*			module.
+	*/
+	size_t thread_count;
+} GATEWAY_STARTUP_CONFIG;
+
 /** @brief	Struct representing the properties that should be used when 
 			creating a module; each entry of the @c VECTOR_HANDLE being a 
 *			#GATEWAY_PROPERTIES_ENTRY. 
@@ -47,6 +126,26 @@ typedef struct GATEWAY_PROPERTIES_DATA_TAG
 {
 	/** @brief Vector of #GATEWAY_PROPERTIES_ENTRY objects. */
 	VECTOR_HANDLE gateway_properties_entries;
+
+	/** @brief	The (possibly @c NULL) vector of #GATEWAY_LINK_ENTRY objects
+	*			describing how messages flow between the modules. Unless
+	*			@c bus_config asks for another routing, a gateway created
+	*			with a vector, even an empty one, only delivers messages
+	*			along its links, and one created with @c NULL delivers every
+	*			message to every module until links are added.
+	*/
+	VECTOR_HANDLE gateway_links;
+
+	/** @brief	How the message bus of the gateway runs its modules and
+	*			routes their messages. A zeroed #MESSAGE_BUS_CONFIG gives
+	*			every module its own thread.
+	*/
+	MESSAGE_BUS_CONFIG bus_config;
+
+	/** @brief	How the modules are started. A zeroed
+	*			#GATEWAY_STARTUP_CONFIG starts them one after another.
+	*/
+	GATEWAY_STARTUP_CONFIG startup_config;
 } GATEWAY_PROPERTIES;
 
 /** @brief		Creates a new gateway using the provided #GATEWAY_PROPERTIES.
@@ -75,6 +174,26 @@ extern GATEWAY_HANDLE Gateway_LL_Create2(const VECTOR_HANDLE modules, MESSAGE_BU
 */
 extern void Gateway_LL_Destroy(GATEWAY_HANDLE gw);
 
+/** @brief		Destroys the gateway after delivering the messages queued for
+*				its modules.
+*
+*	@details	The modules are removed as ::Gateway_LL_Destroy does, each
+*				with ::MessageBus_RemoveModuleWithDrain, so that a module's
+*				queue is delivered before the modules it publishes to are
+*				removed. @c drain_timeout_ms bounds the whole gateway, not
+*				each module; the messages still queued when it has passed
+*				are dropped and the modules they were queued for are logged.
+*
+*	@param		gw					#GATEWAY_HANDLE to be destroyed.
+*	@param		drain_timeout_ms	How long to keep delivering the queued
+*									messages, in milliseconds.
+*	@param		drain_result		The (possibly @c NULL)
+*									#MESSAGE_BUS_DRAIN_RESULT receiving the
+*									number of messages delivered and dropped
+*									for all the modules.
+*/
+extern void Gateway_LL_DestroyWithDrain(GATEWAY_HANDLE gw, unsigned int drain_timeout_ms, MESSAGE_BUS_DRAIN_RESULT* drain_result);
+
 /** @brief		Creates a new module based on the GATEWAY_PROPERTIES_ENTRY*.
 *	
 *	@param		gw		Pointer to a #GATEWAY_HANDLE to add the Module onto.
@@ -94,6 +213,122 @@ extern MODULE_HANDLE Gateway_LL_AddModule(GATEWAY_HANDLE gw, const GATEWAY_PROPE
 */
 extern void Gateway_LL_RemoveModule(GATEWAY_HANDLE gw, MODULE_HANDLE module);
 
+/** @brief		Adds a link between two modules of the gateway.
+*
+*	@param		gw		Pointer to a #GATEWAY_HANDLE to add the link onto.
+*	@param		entry	Pointer to a #GATEWAY_LINK_ENTRY structure describing
+*						the link; the modules are looked up by name.
+*
+*	@return		0 upon success, a non-zero value otherwise.
+*/
+extern int Gateway_LL_AddLink(GATEWAY_HANDLE gw, const GATEWAY_LINK_ENTRY* entry);
+
+/** @brief		Removes a link previously added to the gateway.
+*
+*	@param		gw		Pointer to a #GATEWAY_HANDLE from which to remove the
+*						link.
+*	@param		entry	Pointer to a #GATEWAY_LINK_ENTRY structure describing
+*						the link.
+*/
+extern void Gateway_LL_RemoveLink(GATEWAY_HANDLE gw, const GATEWAY_LINK_ENTRY* entry);
+
+/** @brief		Updates the modules and links of the gateway to those of the
+*				provided #GATEWAY_PROPERTIES.
+*
+*	@details	Modules are matched by name. The modules whose entry is
+*				unchanged keep running, along with their links; the others
+*				are removed with ::Gateway_LL_RemoveModule and the new
+*				entries are added with ::Gateway_LL_AddModule, after the
+*				modules they depend on. A module that depends on a module
+*				being replaced or removed is restarted as well, even if its
+*				own entry is unchanged, so that it is created again after
+*				its dependencies. Links are then removed or added so that
+*				they are those of @c properties. The @c bus_config and
+*				@c startup_config of @c properties are not used, as the
+*				message bus keeps running.
+*
+*				There is no rollback: if a module or a link cannot be added,
+*				the modules and links removed so far stay removed and the
+*				gateway is left part way between the old and the new
+*				properties. Calling the function again with the same
+*				properties resumes the update.
+*
+*	@param		gw			Pointer to a #GATEWAY_HANDLE to update.
+*	@param		properties	#GATEWAY_PROPERTIES describing every module and
+*							link the gateway should have; every entry needs
+*							a @c module_name.
+*
+*	@return		0 on success, a non-zero value otherwise. The gateway is left
+*				unchanged if @c properties is invalid, and part way updated
+*				if a module or a link cannot be added.
+*/
+extern int Gateway_LL_Update(GATEWAY_HANDLE gw, const GATEWAY_PROPERTIES* properties);
+
+/** @brief		Function called by ::Gateway_LL_GetStatistics for every module
+*				of the gateway.
+*
+*	@param		module_name	The (possibly @c NULL) name of the module.
+*	@param		module		The #MODULE_HANDLE of the module.
+*	@param		statistics	The statistics the message bus keeps for the module.
+*	@param		context		The context passed to ::Gateway_LL_GetStatistics.
+*/
+typedef void(*GATEWAY_STATISTICS_CALLBACK)(const char* module_name, MODULE_HANDLE module, const MESSAGE_BUS_MODULE_STATISTICS* statistics, void* context);
+
+/** @brief		Reads the statistics of every module of the gateway.
+*
+*	@param		gw			Pointer to a #GATEWAY_HANDLE whose modules to read
+*							the statistics of.
+*	@param		callback	The #GATEWAY_STATISTICS_CALLBACK called once for
+*							every module, in the order they were added.
+*	@param		context		Passed as is to @c callback.
+*
+*	@return		0 on success, a non-zero value if the statistics of a module
+*				could not be read.
+*/
+extern int Gateway_LL_GetStatistics(GATEWAY_HANDLE gw, GATEWAY_STATISTICS_CALLBACK callback, void* context);
+
+/** @brief	Struct receiving how long starting a module took, see
+*			::Gateway_LL_GetStartupTimes.
+*/
+typedef struct GATEWAY_MODULE_STARTUP_TIMES_TAG
+{
+	/** @brief	The time spent loading the library of the module, in
+	*			microseconds.
+	*/
+	uint64_t load_time_us;
+
+	/** @brief	The time spent in the module's @c Module_Create, in
+	*			microseconds.
+	*/
+	uint64_t create_time_us;
+} GATEWAY_MODULE_STARTUP_TIMES;
+
+/** @brief		Function called by ::Gateway_LL_GetStartupTimes for every
+*				module of the gateway.
+*
+*	@param		module_name	The (possibly @c NULL) name of the module.
+*	@param		module		The #MODULE_HANDLE of the module.
+*	@param		times		How long starting the module took.
+*	@param		context		The context passed to
+*							::Gateway_LL_GetStartupTimes.
+*/
+typedef void(*GATEWAY_STARTUP_TIMES_CALLBACK)(const char* module_name, MODULE_HANDLE module, const GATEWAY_MODULE_STARTUP_TIMES* times, void* context);
+
+/** @brief		Reads how long starting every module of the gateway took.
+*
+*	@details	The modules of ::Gateway_LL_Create2 were started by the
+*				caller and report zeroed times.
+*
+*	@param		gw			Pointer to a #GATEWAY_HANDLE whose modules to read
+*							the startup times of.
+*	@param		callback	The #GATEWAY_STARTUP_TIMES_CALLBACK called once
+*							for every module, in the order they were added.
+*	@param		context		Passed as is to @c callback.
+*
+*	@return		0 on success, a non-zero value if an argument is @c NULL.
+*/
+extern int Gateway_LL_GetStartupTimes(GATEWAY_HANDLE gw, GATEWAY_STARTUP_TIMES_CALLBACK callback, void* context);
+
 #ifdef __cplusplus
 }
 #endif
@@ -84,12 +84,53 @@ typedef struct MESSAGE_BUFFER_CONFIG_TAG
 	MAP_HANDLE sourceProperties;
 }MESSAGE_BUFFER_CONFIG;
 
+/** @brief	Function called by a message created with #Message_CreateAdopt to
+*			release the content it adopted, once the message is destroyed.
+*
+*	@param	content		The @c source the message was created with.
+*	@param	context		The @c releaseContext the message was created with.
+*/
+typedef void(*MESSAGE_CONTENT_RELEASE)(unsigned char* content, void* context);
+
+/** @brief	Struct defining the configuration of a message that takes
+*			ownership of its content instead of copying it.
+*/
+typedef struct MESSAGE_ADOPT_CONFIG_TAG
+{
+	/** @brief	Specifies the size of the buffer pointed at by @c source. It
+	*			is an error for the size to be greater than zero when @c
+	*			source is equal to @c NULL.
+	*/
+	size_t size;
+
+	/** @brief	The buffer that becomes the content of the message. It must
+	*			not be modified once the message is created.
+	*/
+	unsigned char* source;
+
+	/** @brief	Releases @c source when the message is destroyed. When @c NULL,
+	*			@c source must have been allocated with @c malloc and the
+	*			message frees it.
+	*/
+	MESSAGE_CONTENT_RELEASE release;
+
+	/** @brief	Passed to @c release. */
+	void* releaseContext;
+
+	/** @brief	A collection of key/value pairs where both the key and value are
+	*			strings representing the properties of this message. This field 
+	*			must not be @c NULL.
+	*/
+	MAP_HANDLE sourceProperties;
+}MESSAGE_ADOPT_CONFIG;
+
 /** @brief		Creates a new reference counted message from a #MESSAGE_CONFIG
 *				structure with the reference count initialized to 1.
 *
-*	@details	This function will create its own @c CONSTBUFFER and @c ConstMap
-*				with copies of the @c source and @c sourceProperties contained
-*				within the #MESSAGE_CONFIG structure parameter. It is the
+*	@details	The message keeps a copy of the @c source contained within
+*				the #MESSAGE_CONFIG structure parameter, and the names and
+*				values of its @c sourceProperties interned in the process
+*				wide string intern table (see string_intern.h). It is the
 *				responsibility of the Message to dispose of these resources.
 *
 *	@param		cfg		Pointer to a #MESSAGE_CONFIG structure.
@@ -103,7 +144,9 @@ extern MESSAGE_HANDLE Message_Create(const MESSAGE_CONFIG* cfg);
 *               the serialized form of a message.
 *
 *	@details	The newly created message shall have all the properties of the original
-*               message and the same content.
+*               message and the same content. The properties are interned straight
+*               from the byte array, which is only read, and is checked whole before
+*               the message is allocated.
 *
 *	@param		source		Pointer to a byte array.
 *               size        size in bytes of the array
@@ -113,6 +156,24 @@ extern MESSAGE_HANDLE Message_Create(const MESSAGE_CONFIG* cfg);
 */
 extern MESSAGE_HANDLE Message_CreateFromByteArray(const unsigned char* source, int32_t size);
 
+/** @brief		Creates a new reference counted message that keeps the byte
+*				array it was created from, without copying anything out of it.
+*
+*	@details	The byte array is checked as #Message_CreateFromByteArray
+*				checks it. The names and values of the properties and the
+*				content of the message point into it, and the message
+*				serializes to it unchanged, so a message that is received as
+*				a byte array and forwarded as one is never parsed again nor
+*				copied.
+*
+*	@param		source		A @c CONSTBUFFER_HANDLE holding the byte array. The
+*							message takes its own reference on it.
+*
+*	@return		A non-NULL #MESSAGE_HANDLE for the newly created message, or NULL
+*				upon failure.
+*/
+extern MESSAGE_HANDLE Message_CreateFromByteArrayView(CONSTBUFFER_HANDLE source);
+
 /** @brief		Creates a byte array representation of a MESSAGE_HANDLE. 
 *
 *	@details	The byte array created can be used with function #Message_CreateFromByteArray
@@ -126,13 +187,54 @@ extern MESSAGE_HANDLE Message_CreateFromByteArray(const unsigned char* source, i
 */
 extern const unsigned char* Message_ToByteArray(MESSAGE_HANDLE messageHandle, int32_t* size);
 
+/** @brief		Gets the size of the byte array #Message_ToByteArray creates
+*				from a message, for callers that bring their own buffer to
+*				#Message_ToByteArrayBuffer.
+*
+*	@param		messageHandle		A #MESSAGE_HANDLE. This parameter cannot be NULL.
+*
+*	@return		The size in bytes of the serialized form of the message, or -1
+*				if @c messageHandle is NULL or the message is too big to be
+*				serialized.
+*/
+extern int32_t Message_GetByteArraySize(MESSAGE_HANDLE messageHandle);
+
+/** @brief		Writes the byte array #Message_ToByteArray would create from
+*				a message to a buffer provided by the caller, without
+*				allocating.
+*
+*	@param		messageHandle		A #MESSAGE_HANDLE. This parameter cannot be NULL.
+*	@param		buffer				Where to write the byte array. This parameter cannot be NULL.
+*	@param		size				The size in bytes of @c buffer.
+*
+*	@return		The number of bytes written to @c buffer, or -1 if a parameter
+*				is NULL or the byte array does not fit in @c size bytes, in
+*				which case nothing is written.
+*/
+extern int32_t Message_ToByteArrayBuffer(MESSAGE_HANDLE messageHandle, unsigned char* buffer, int32_t size);
+
+/** @brief		Gets the byte array #Message_ToByteArray would create from a
+*				message as a @c CONSTBUFFER_HANDLE.
+*
+*	@details	For a message created with #Message_CreateFromByteArrayView
+*				this is the byte array it was created from, with one more
+*				reference on it.
+*
+*	@param		messageHandle		A #MESSAGE_HANDLE. This parameter cannot be NULL.
+*
+*	@return		A non-NULL @c CONSTBUFFER_HANDLE, to be destroyed with
+*				@c CONSTBUFFER_Destroy, or NULL upon failure.
+*/
+extern CONSTBUFFER_HANDLE Message_ToByteArrayHandle(MESSAGE_HANDLE messageHandle);
+
 
 /** @brief		Creates a new message from a @c CONSTBUFFER source and @c MAP_HANDLE.
 *
-*	@details	This function will create its own @c CONSTBUFFER and @c ConstMap
-*				with copies of the @c source and @c sourceProperties contained
-*				within the #MESSAGE_CONFIG structure parameter. It is the
-*				responsibility of the Message to dispose of these resources.
+*	@details	The message keeps a clone of the @c sourceContent contained
+*				within the #MESSAGE_BUFFER_CONFIG structure parameter, and
+*				the names and values of its @c sourceProperties interned as
+*				with #Message_Create. It is the responsibility of the Message
+*				to dispose of these resources.
 *
 *	@param		cfg		Pointer to a #MESSAGE_BUFFER_CONFIG structure.
 *
@@ -141,6 +243,40 @@ extern const unsigned char* Message_ToByteArray(MESSAGE_HANDLE messageHandle, in
 */
 extern MESSAGE_HANDLE Message_CreateFromBuffer(const MESSAGE_BUFFER_CONFIG* cfg);
 
+/** @brief		Creates a new message that takes ownership of the @c source
+*				buffer of a #MESSAGE_ADOPT_CONFIG instead of copying it.
+*
+*	@details	On success the message owns @c source and releases it, with
+*				@c release or @c free, when its reference count becomes zero.
+*				On failure @c source still belongs to the caller. The
+*				properties are copied as with #Message_Create.
+*
+*	@param		cfg		Pointer to a #MESSAGE_ADOPT_CONFIG structure.
+*
+*	@return		A non-NULL #MESSAGE_HANDLE for the newly created message, or @c NULL
+*				upon failure.
+*/
+extern MESSAGE_HANDLE Message_CreateAdopt(const MESSAGE_ADOPT_CONFIG* cfg);
+
+/** @brief		Creates a new message with the content and properties of
+*				@c parent, plus the properties of @c overrides, which replace
+*				those of @c parent with the same names.
+*
+*	@details	The new message keeps a reference on @c parent and shares
+*				its content and its properties: it only stores the
+*				properties of @c overrides, so republishing a message with a
+*				few more properties costs what those properties cost. A
+*				message derived from a derived message is derived from the
+*				original one, with the properties of both overrides.
+*
+*	@param		parent		The #MESSAGE_HANDLE to derive the message from.
+*	@param		overrides	The properties to add or replace.
+*
+*	@return		A non-NULL #MESSAGE_HANDLE for the newly created message, or @c NULL
+*				upon failure.
+*/
+extern MESSAGE_HANDLE Message_CreateDerived(MESSAGE_HANDLE parent, MAP_HANDLE overrides);
+
 /** @brief		Creates a clone of the message.
 *
 *	@details	Since messages are immutable, this function only increments the inner
@@ -156,7 +292,9 @@ extern MESSAGE_HANDLE Message_Clone(MESSAGE_HANDLE message);
 /** @brief		Gets the properties of a message.
 *
 *	@details	The returned @c CONSTMAP handle should be destroyed when no longer
-*				needed.
+*				needed. The message builds the @c CONSTMAP the first time it
+*				is asked for it; #Message_GetProperty reads a single property
+*				without building it.
 *
 *	@param		message		The #MESSAGE_HANDLE from which properties will be
 *							fetched.
@@ -167,6 +305,23 @@ extern MESSAGE_HANDLE Message_Clone(MESSAGE_HANDLE message);
 */
 extern CONSTMAP_HANDLE Message_GetProperties(MESSAGE_HANDLE message);
 
+/** @brief		Gets the value of one property of a message.
+*
+*	@details	The message indexes its properties by the hash of their
+*				names when it is created, so @c name is hashed once and
+*				only compared to the names with the same hash. The names
+*				are interned, so a @c name returned by
+*				@c StringIntern_Acquire is found by comparing pointers.
+*
+*	@param		message		The #MESSAGE_HANDLE from which the property will
+*							be fetched.
+*	@param		name		The name of the property.
+*
+*	@return		The value of the property, valid as long as @c message, or
+*				@c NULL if the message has no such property.
+*/
+extern const char* Message_GetProperty(MESSAGE_HANDLE message, const char* name);
+
 /** @brief		Gets the content of a message.
 *
 *	@details	The returned @c CONSTMAP_HANDLE need not be freed by the caller.
@@ -6,7 +6,8 @@
 *
 *	@details	This is the API to create a reference counted and thread safe 
 *				gateway message bus. The message bus broadcasts the messages to 
-*				the subscribers. Messages on the message bus have a bag of 
+*				the subscribers, or delivers them along the links configured
+*				with ::MessageBus_AddLink when there are any. Messages on the message bus have a bag of 
 *				properties (name, value) and an opaque array of bytes that is 
 *				the message content.
 */
@@ -23,10 +24,13 @@ typedef struct MESSAGE_BUS_HANDLE_DATA_TAG* MESSAGE_BUS_HANDLE;
 
 #ifdef __cplusplus
 #include <cstddef>
+#include <cstdint>
 extern "C"
 {
 #else
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
 #endif
 
 #define MESSAGE_BUS_RESULT_VALUES \
@@ -39,12 +43,294 @@ extern "C"
 */
 DEFINE_ENUM(MESSAGE_BUS_RESULT, MESSAGE_BUS_RESULT_VALUES);
 
+/** @brief	Struct describing a link between two modules on the message bus.
+*
+*	@details	Once a link has been added to a message bus, messages are only
+*				delivered to the modules that are the sink of a matching link.
+*				A message bus without any link broadcasts every message to
+*				every module.
+*/
+typedef struct MESSAGE_BUS_LINK_TAG
+{
+	/** @brief	The module whose messages are delivered to @c module_sink,
+	*			or @c NULL to deliver messages from any publisher.
+	*/
+	MODULE_HANDLE module_source;
+
+	/** @brief	The module receiving the messages. */
+	MODULE_HANDLE module_sink;
+
+	/** @brief	The name of a property the message must have to be delivered
+	*			(optional, may be @c NULL).
+	*/
+	const char* filter_property;
+
+	/** @brief	The value @c filter_property must have for the message to be
+	*			delivered (optional, may be @c NULL to accept any value).
+	*/
+	const char* filter_value;
+} MESSAGE_BUS_LINK;
+
+/** @brief	One condition of a #MESSAGE_BUS_FILTER: the message must have
+*			@c property and its value must be one of @c values.
+*/
+typedef struct MESSAGE_BUS_FILTER_CONDITION_TAG
+{
+	/** @brief	The name of the message property. */
+	const char* property;
+
+	/** @brief	The accepted values of @c property. */
+	const char* const* values;
+
+	/** @brief	The number of elements in @c values, at least 1. */
+	size_t value_count;
+} MESSAGE_BUS_FILTER_CONDITION;
+
+/** @brief	A subscription predicate: a message matches the filter when it
+*			satisfies every one of the conditions, for example
+*			@c source == "bleTelemetry" && @c macAddress in {...}.
+*/
+typedef struct MESSAGE_BUS_FILTER_TAG
+{
+	/** @brief	The conditions that must all hold. */
+	const MESSAGE_BUS_FILTER_CONDITION* conditions;
+
+	/** @brief	The number of elements in @c conditions, at least 1. */
+	size_t condition_count;
+} MESSAGE_BUS_FILTER;
+
+#define MESSAGE_BUS_QUEUE_POLICY_VALUES \
+    MESSAGE_BUS_QUEUE_DROP_NEWEST, \
+    MESSAGE_BUS_QUEUE_DROP_OLDEST, \
+    MESSAGE_BUS_QUEUE_BLOCK
+
+/** @brief	Enumeration describing what ::MessageBus_Publish does with a
+*			message for a module whose queue is full.
+*
+*	@details	#MESSAGE_BUS_QUEUE_DROP_NEWEST drops the message being
+*				published, #MESSAGE_BUS_QUEUE_DROP_OLDEST drops the oldest
+*				message of the queue to make room for it and
+*				#MESSAGE_BUS_QUEUE_BLOCK makes the publisher wait for room,
+*				dropping the message if there is still none after the
+*				timeout.
+*/
+DEFINE_ENUM(MESSAGE_BUS_QUEUE_POLICY, MESSAGE_BUS_QUEUE_POLICY_VALUES);
+
+/** @brief	Struct describing the queue of messages waiting to be delivered
+*			to a module.
+*/
+typedef struct MESSAGE_BUS_QUEUE_CONFIG_TAG
+{
+	/** @brief	The maximum number of messages in the queue, or 0 for a
+	*			queue that grows without limit.
+	*/
+	size_t capacity;
+
+	/** @brief	What to do with a message when the queue is full. */
+	MESSAGE_BUS_QUEUE_POLICY policy;
+
+	/** @brief	How long, in milliseconds, a publisher waits for room with
+	*			#MESSAGE_BUS_QUEUE_BLOCK, at most @c INT_MAX.
+	*/
+	unsigned int timeout_ms;
+} MESSAGE_BUS_QUEUE_CONFIG;
+
+/** @brief	The name of the message property that selects the priority of
+*			a message on the message bus.
+*/
+#define MESSAGE_BUS_PRIORITY_PROPERTY "priority"
+
+/** @brief	The value of #MESSAGE_BUS_PRIORITY_PROPERTY for high priority
+*			messages; messages with any other value, or without the
+*			property, have normal priority.
+*/
+#define MESSAGE_BUS_PRIORITY_HIGH_VALUE "high"
+
+#define MESSAGE_BUS_PRIORITY_VALUES \
+    MESSAGE_BUS_PRIORITY_NORMAL, \
+    MESSAGE_BUS_PRIORITY_HIGH
+
+/** @brief	Enumeration describing the priority of a message, which is also
+*			the index of the lane of a module's queue the message waits in.
+*
+*	@details	The messages of the high priority lane are delivered ahead
+*				of the normal priority ones, but a few normal priority
+*				messages are delivered with every batch so that they are
+*				never starved.
+*/
+DEFINE_ENUM(MESSAGE_BUS_PRIORITY, MESSAGE_BUS_PRIORITY_VALUES);
+
+/** @brief	The number of #MESSAGE_BUS_PRIORITY values. */
+#define MESSAGE_BUS_PRIORITY_COUNT 2
+
+/** @brief	Struct receiving the counters of one lane of a module's queue,
+*			see ::MessageBus_GetModuleCounters.
+*
+*	@details	The queue latency is sampled: the time one message at a time
+*				spends in the lane is measured.
+*/
+typedef struct MESSAGE_BUS_LANE_COUNTERS_TAG
+{
+	/** @brief	The number of messages waiting in the lane. */
+	size_t queued;
+
+	/** @brief	The number of messages whose queue latency was measured. */
+	size_t latency_samples;
+
+	/** @brief	The average measured queue latency, in milliseconds. */
+	unsigned int latency_average_ms;
+
+	/** @brief	The largest measured queue latency, in milliseconds. */
+	unsigned int latency_max_ms;
+} MESSAGE_BUS_LANE_COUNTERS;
+
+/** @brief	Struct receiving the counters of a module, see
+*			::MessageBus_GetModuleCounters.
+*/
+typedef struct MESSAGE_BUS_MODULE_COUNTERS_TAG
+{
+	/** @brief	The number of messages waiting in the module's queue. */
+	size_t queued;
+
+	/** @brief	The number of messages for the module that were dropped
+	*			because its queue was full.
+	*/
+	size_t dropped;
+
+	/** @brief	The counters of every lane of the module's queue, indexed
+	*			by #MESSAGE_BUS_PRIORITY.
+	*/
+	MESSAGE_BUS_LANE_COUNTERS lanes[MESSAGE_BUS_PRIORITY_COUNT];
+} MESSAGE_BUS_MODULE_COUNTERS;
+
+/** @brief	Number of buckets of the latency histogram of a module, see
+*			#MESSAGE_BUS_MODULE_STATISTICS.
+*/
+#define MESSAGE_BUS_LATENCY_BUCKET_COUNT 32
+
+/** @brief	Struct receiving the statistics of a module, see
+*			::MessageBus_GetStatistics.
+*
+*	@details	The counters are kept with atomic operations, so reading them
+*				does not stop the module or its publishers, and the values
+*				read may not all be from the same instant. The latency is
+*				sampled like the queue latency of #MESSAGE_BUS_LANE_COUNTERS,
+*				but measured up to the return of @c Module_Receive (or
+*				@c Module_ReceiveBatch) for the message.
+*/
+typedef struct MESSAGE_BUS_MODULE_STATISTICS_TAG
+{
+	/** @brief	The number of messages queued for the module. */
+	uint64_t enqueued;
+
+	/** @brief	The number of messages delivered to the module. */
+	uint64_t delivered;
+
+	/** @brief	The number of messages for the module that were dropped
+	*			because its queue was full.
+	*/
+	uint64_t dropped;
+
+	/** @brief	The number of messages waiting in the module's queue. */
+	size_t queued;
+
+	/** @brief	The largest number of messages that have been waiting in
+	*			the module's queue.
+	*/
+	size_t queued_high_water;
+
+	/** @brief	The total time spent in the module's @c Module_Receive and
+	*			@c Module_ReceiveBatch, in microseconds.
+	*/
+	uint64_t receive_time_us;
+
+	/** @brief	The number of messages whose latency was measured, the sum
+	*			of @c latency_buckets.
+	*/
+	uint64_t latency_samples;
+
+	/** @brief	The latency histogram: bucket @c i counts the latencies of
+	*			at least 2^i microseconds and below 2^(i+1), except bucket 0
+	*			which starts at 0 and the last bucket which has no upper
+	*			bound.
+	*/
+	uint64_t latency_buckets[MESSAGE_BUS_LATENCY_BUCKET_COUNT];
+} MESSAGE_BUS_MODULE_STATISTICS;
+
+/** @brief	Struct receiving what ::MessageBus_RemoveModuleWithDrain did
+*			with the messages that were queued for a module.
+*/
+typedef struct MESSAGE_BUS_DRAIN_RESULT_TAG
+{
+	/** @brief	The number of queued messages delivered to the module while
+	*			it was being removed.
+	*/
+	size_t delivered;
+	/** @brief	The number of queued messages destroyed without being
+	*			delivered because the drain deadline had passed.
+	*/
+	size_t dropped;
+} MESSAGE_BUS_DRAIN_RESULT;
+
+#define MESSAGE_BUS_ROUTING_VALUES \
+    MESSAGE_BUS_ROUTING_AUTOMATIC, \
+    MESSAGE_BUS_ROUTING_BROADCAST, \
+    MESSAGE_BUS_ROUTING_LINKS
+
+/** @brief	Enumeration describing which modules ::MessageBus_Publish
+*			delivers a message to.
+*
+*	@details	#MESSAGE_BUS_ROUTING_BROADCAST delivers every message to
+*				every module, and ::MessageBus_AddLink fails.
+*				#MESSAGE_BUS_ROUTING_LINKS only delivers a message along the
+*				links of the bus, so that none is delivered while there is
+*				no link. #MESSAGE_BUS_ROUTING_AUTOMATIC, the routing of
+*				::MessageBus_Create, broadcasts while there is no link and
+*				follows the links otherwise: removing the last link, or the
+*				last module that had links, makes the bus broadcast again.
+*/
+DEFINE_ENUM(MESSAGE_BUS_ROUTING, MESSAGE_BUS_ROUTING_VALUES);
+
+/** @brief	Struct describing how a message bus delivers messages, see
+*			::MessageBus_Create2.
+*/
+typedef struct MESSAGE_BUS_CONFIG_TAG
+{
+	/** @brief	@c false to give every module its own thread, @c true to
+	*			deliver the messages of all the modules on a shared pool of
+	*			threads.
+	*/
+	bool use_worker_pool;
+
+	/** @brief	The number of threads of the pool, or 0 for one thread per
+	*			processor.
+	*/
+	size_t worker_count;
+
+	/** @brief	Which modules receive the messages published on the bus. */
+	MESSAGE_BUS_ROUTING routing;
+} MESSAGE_BUS_CONFIG;
+
 /** @brief	Creates a new message bus.
 *
 *	@return	A valid #MESSAGE_BUS_HANDLE upon success, or @c NULL upon failure.
 */
 extern MESSAGE_BUS_HANDLE MessageBus_Create(void);
 
+/** @brief		Creates a new message bus with the given configuration.
+*
+*	@details	With a worker pool every module still receives its messages
+*				in order and one call at a time, but a gateway with hundreds
+*				of modules needs only a few threads.
+*
+*	@param		config	The #MESSAGE_BUS_CONFIG of the bus, or @c NULL for
+*						the configuration of ::MessageBus_Create.
+*
+*	@return		A valid #MESSAGE_BUS_HANDLE upon success, or @c NULL upon
+*				failure.
+*/
+extern MESSAGE_BUS_HANDLE MessageBus_Create2(const MESSAGE_BUS_CONFIG* config);
+
 /** @brief		Creates a clone of the message bus.
 *
 *	@details	This function will simply increment the internal reference
@@ -69,6 +355,9 @@ extern void MessageBus_DecRef(MESSAGE_BUS_HANDLE bus);
 *	@details	For details about threading with regard to the message bus and
 *				modules connected to the message bus, see
 *				<a href="https://github.com/Azure/azure-iot-gateway-sdk/blob/develop/core/devdoc/message_bus_hld.md">Bus High Level Design Documentation</a>.
+*				A message whose #MESSAGE_BUS_PRIORITY_PROPERTY property is
+*				#MESSAGE_BUS_PRIORITY_HIGH_VALUE is queued in the high
+*				priority lane of the modules.
 *
 *	@param		bus		The #MESSAGE_BUS_HANDLE onto which the message will be
 *						published.
@@ -99,6 +388,77 @@ extern MESSAGE_BUS_RESULT MessageBus_Publish(MESSAGE_BUS_HANDLE bus, MODULE_HAND
 */
 extern MESSAGE_BUS_RESULT MessageBus_AddModule(MESSAGE_BUS_HANDLE bus, const MODULE* module);
 
+/** @brief		Adds a module onto the message bus that only receives the
+*				messages matching @c filter.
+*
+*	@details	The bus compiles the filters of all the modules into an index
+*				keyed on property name and value, so that publishing a message
+*				costs one hash lookup per filtered property name regardless of
+*				the number of subscribed modules. Modules whose filter does not
+*				match are skipped at publish time; their worker threads are not
+*				woken up. The bus keeps its own copy of the filter strings.
+*
+*	@param		bus				The #MESSAGE_BUS_HANDLE onto which the module will be
+*								added.
+*	@param		module			The #MODULE for the module that will be added to
+*								this message bus.
+*	@param		filter			The #MESSAGE_BUS_FILTER messages must match to be
+*								delivered to the module, or @c NULL to receive every
+*								message as with ::MessageBus_AddModule.
+*
+*	@return		A #MESSAGE_BUS_RESULT describing the result of the function.
+*/
+extern MESSAGE_BUS_RESULT MessageBus_AddModuleWithFilter(MESSAGE_BUS_HANDLE bus, const MODULE* module, const MESSAGE_BUS_FILTER* filter);
+
+/** @brief		Adds a module onto the message bus with a bounded queue.
+*
+*	@details	The queue of the module has one lane per
+*				#MESSAGE_BUS_PRIORITY. Messages published while their lane
+*				holds @c queue_config->capacity messages are handled according to
+*				@c queue_config->policy; ::MessageBus_Publish still succeeds
+*				and counts the dropped messages, which can be read with
+*				::MessageBus_GetModuleCounters.
+*
+*	@param		bus				The #MESSAGE_BUS_HANDLE onto which the module will be
+*								added.
+*	@param		module			The #MODULE for the module that will be added to
+*								this message bus.
+*	@param		filter			The (possibly @c NULL) #MESSAGE_BUS_FILTER messages
+*								must match to be delivered to the module.
+*	@param		queue_config	The #MESSAGE_BUS_QUEUE_CONFIG of the module's queue,
+*								or @c NULL for a queue without limit.
+*
+*	@return		A #MESSAGE_BUS_RESULT describing the result of the function.
+*/
+extern MESSAGE_BUS_RESULT MessageBus_AddModuleWithQueue(MESSAGE_BUS_HANDLE bus, const MODULE* module, const MESSAGE_BUS_FILTER* filter, const MESSAGE_BUS_QUEUE_CONFIG* queue_config);
+
+/** @brief		Adds a module onto the message bus that receives its messages
+*				in batches.
+*
+*	@details	Behaves as ::MessageBus_AddModuleWithQueue, except that the
+*				messages pending for a #NATIVE_C_TYPE module are handed to
+*				@c receive_batch in one call rather than to its
+*				@c Module_Receive one at a time. The gateway gets
+*				@c receive_batch from the module library, see
+*				#MODULE_GETRECEIVEBATCH_NAME.
+*
+*	@param		bus				The #MESSAGE_BUS_HANDLE onto which the module will be
+*								added.
+*	@param		module			The #MODULE for the module that will be added to
+*								this message bus.
+*	@param		filter			The (possibly @c NULL) #MESSAGE_BUS_FILTER messages
+*								must match to be delivered to the module.
+*	@param		queue_config	The #MESSAGE_BUS_QUEUE_CONFIG of the module's queue,
+*								or @c NULL for a queue without limit.
+*	@param		receive_batch	The #pfModule_ReceiveBatch of the module, or
+*								@c NULL to deliver every message through
+*								@c Module_Receive. It is ignored for a
+*								#MODERN_CPP_TYPE module.
+*
+*	@return		A #MESSAGE_BUS_RESULT describing the result of the function.
+*/
+extern MESSAGE_BUS_RESULT MessageBus_AddModuleWithReceiveBatch(MESSAGE_BUS_HANDLE bus, const MODULE* module, const MESSAGE_BUS_FILTER* filter, const MESSAGE_BUS_QUEUE_CONFIG* queue_config, pfModule_ReceiveBatch receive_batch);
+
 /** @brief	Removes a module from the message bus.
 *
 *	@param	bus		The #MESSAGE_BUS_HANDLE from which the module will be removed.
@@ -108,6 +468,80 @@ extern MESSAGE_BUS_RESULT MessageBus_AddModule(MESSAGE_BUS_HANDLE bus, const MOD
 */
 extern MESSAGE_BUS_RESULT MessageBus_RemoveModule(MESSAGE_BUS_HANDLE bus, MODULE_HANDLE module);
 
+/** @brief		Removes a module from the message bus after delivering the
+*				messages that are queued for it.
+*
+*	@details	The module stops receiving newly published messages right
+*				away but keeps its links as a source, so that what it
+*				publishes while the queue drains still reaches its sinks.
+*				The queued messages are then delivered in order, a batch at a
+*				time, until the queue is empty or @c drain_timeout_ms
+*				milliseconds have passed; the messages still queued at that
+*				point are destroyed. The deadline is checked between
+*				batches, so a module slow to receive a batch can make the
+*				call last longer. The bus is not locked while the queue
+*				drains: other calls on the bus go on, and the module may
+*				call the bus from its receive function. A link added or
+*				removed meanwhile ends the links from the module early.
+*
+*	@param		bus					The #MESSAGE_BUS_HANDLE from which the
+*									module will be removed.
+*	@param		module				The #MODULE_HANDLE of the module to be
+*									removed.
+*	@param		drain_timeout_ms	How long to keep delivering the queued
+*									messages, in milliseconds, or 0 to
+*									destroy them as ::MessageBus_RemoveModule
+*									does.
+*	@param		drain_result		The (possibly @c NULL)
+*									#MESSAGE_BUS_DRAIN_RESULT receiving the
+*									number of messages delivered and dropped.
+*
+*	@return		A #MESSAGE_BUS_RESULT describing the result of the function.
+*/
+extern MESSAGE_BUS_RESULT MessageBus_RemoveModuleWithDrain(MESSAGE_BUS_HANDLE bus, MODULE_HANDLE module, unsigned int drain_timeout_ms, MESSAGE_BUS_DRAIN_RESULT* drain_result);
+
+/** @brief	Reads the counters of a module on the message bus.
+*
+*	@param	bus			The #MESSAGE_BUS_HANDLE the module is on.
+*	@param	module		The #MODULE_HANDLE of the module.
+*	@param	counters	The #MESSAGE_BUS_MODULE_COUNTERS receiving the counters.
+*
+*	@return	A #MESSAGE_BUS_RESULT describing the result of the function.
+*/
+extern MESSAGE_BUS_RESULT MessageBus_GetModuleCounters(MESSAGE_BUS_HANDLE bus, MODULE_HANDLE module, MESSAGE_BUS_MODULE_COUNTERS* counters);
+
+/** @brief	Reads the statistics of a module on the message bus.
+*
+*	@param	bus			The #MESSAGE_BUS_HANDLE the module is on.
+*	@param	module		The #MODULE_HANDLE of the module.
+*	@param	statistics	The #MESSAGE_BUS_MODULE_STATISTICS receiving the
+*						statistics.
+*
+*	@return	A #MESSAGE_BUS_RESULT describing the result of the function.
+*/
+extern MESSAGE_BUS_RESULT MessageBus_GetStatistics(MESSAGE_BUS_HANDLE bus, MODULE_HANDLE module, MESSAGE_BUS_MODULE_STATISTICS* statistics);
+
+/** @brief		Adds a link between two modules on the message bus.
+*
+*	@details	The sink module must already be connected to the bus. The
+*				bus keeps its own copy of the filter strings.
+*
+*	@param		bus		The #MESSAGE_BUS_HANDLE onto which the link will be added.
+*	@param		link	The #MESSAGE_BUS_LINK describing the link.
+*
+*	@return		A #MESSAGE_BUS_RESULT describing the result of the function.
+*/
+extern MESSAGE_BUS_RESULT MessageBus_AddLink(MESSAGE_BUS_HANDLE bus, const MESSAGE_BUS_LINK* link);
+
+/** @brief		Removes a link previously added with ::MessageBus_AddLink.
+*
+*	@param		bus		The #MESSAGE_BUS_HANDLE from which the link will be removed.
+*	@param		link	The #MESSAGE_BUS_LINK describing the link.
+*
+*	@return		A #MESSAGE_BUS_RESULT describing the result of the function.
+*/
+extern MESSAGE_BUS_RESULT MessageBus_RemoveLink(MESSAGE_BUS_HANDLE bus, const MESSAGE_BUS_LINK* link);
+
 /** @brief Disposes of resources allocated by a message bus.
 *
 *	@param	bus		The #MESSAGE_BUS_HANDLE to be destroyed.
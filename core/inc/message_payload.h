@@ -0,0 +1,156 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file		message_payload.h
+*	@brief		A compact binary encoding of typed fields, for the content
+*				of messages.
+*
+*	@details	The content of a message is an opaque array of bytes, and
+*				modules that exchange readings have to agree on a format for
+*				it. This encoding is an optional one: a record of named
+*				fields, each an integer, a number, a boolean, a string or an
+*				array of bytes. Integers take as few bytes as their value
+*				needs and numbers are stored as they are in memory, so
+*				nothing is formatted as text nor parsed back.
+*
+*				Names and strings are encoded with a terminating zero, so a
+*				decoded field points into the encoded bytes instead of
+*				copying out of them.
+*/
+
+#ifndef MESSAGE_PAYLOAD_H
+#define MESSAGE_PAYLOAD_H
+
+#include "azure_c_shared_utility/macro_utils.h"
+#include "azure_c_shared_utility/map.h"
+#include "message.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+extern "C"
+{
+#else
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#endif
+
+#define MESSAGE_PAYLOAD_TYPE_VALUES \
+    MESSAGE_PAYLOAD_INTEGER, \
+    MESSAGE_PAYLOAD_NUMBER, \
+    MESSAGE_PAYLOAD_BOOLEAN, \
+    MESSAGE_PAYLOAD_STRING, \
+    MESSAGE_PAYLOAD_BYTES
+
+/** @brief	Enumeration describing the type of a #MESSAGE_PAYLOAD_FIELD. */
+DEFINE_ENUM(MESSAGE_PAYLOAD_TYPE, MESSAGE_PAYLOAD_TYPE_VALUES);
+
+/** @brief	Struct describing one field of an encoded payload. */
+typedef struct MESSAGE_PAYLOAD_FIELD_TAG
+{
+	/** @brief	The name of the field. It cannot be @c NULL. */
+	const char* name;
+
+	/** @brief	Which member of @c value holds the value of the field. */
+	MESSAGE_PAYLOAD_TYPE type;
+
+	/** @brief	The value of the field. */
+	union
+	{
+		int64_t integer;
+		double number;
+		bool boolean;
+
+		/** @brief	A zero terminated string. It cannot be @c NULL. */
+		const char* string;
+
+		struct
+		{
+			/** @brief	It can only be @c NULL when @c size is 0. */
+			const unsigned char* buffer;
+			size_t size;
+		} bytes;
+	} value;
+} MESSAGE_PAYLOAD_FIELD;
+
+/** @brief		Gets the number of bytes #MessagePayload_Encode writes for a
+*				set of fields.
+*
+*	@param		fields	The fields to encode.
+*	@param		count	The number of fields.
+*
+*	@return		The size in bytes of the encoded fields, or -1 if a
+*				parameter or a field is invalid or the encoded fields would
+*				not fit in an @c int32_t.
+*/
+extern int32_t MessagePayload_GetEncodedSize(const MESSAGE_PAYLOAD_FIELD* fields, size_t count);
+
+/** @brief		Encodes a set of fields to a buffer provided by the caller,
+*				without allocating.
+*
+*	@param		fields	The fields to encode.
+*	@param		count	The number of fields.
+*	@param		buffer	Where to write the encoded fields.
+*	@param		size	The size in bytes of @c buffer.
+*
+*	@return		The number of bytes written to @c buffer, or -1 if a
+*				parameter or a field is invalid or the encoded fields do
+*				not fit in @c size bytes, in which case nothing is written.
+*/
+extern int32_t MessagePayload_Encode(const MESSAGE_PAYLOAD_FIELD* fields, size_t count, unsigned char* buffer, int32_t size);
+
+/** @brief		Creates a message whose content is a set of encoded fields.
+*
+*	@details	The fields are encoded straight into the buffer the message
+*				adopts (see #Message_CreateAdopt), so they are only written
+*				once.
+*
+*	@param		fields		The fields to encode.
+*	@param		count		The number of fields.
+*	@param		properties	The properties of the message. It cannot be
+*							@c NULL.
+*
+*	@return		A non-NULL #MESSAGE_HANDLE for the newly created message, or
+*				@c NULL upon failure.
+*/
+extern MESSAGE_HANDLE MessagePayload_CreateMessage(const MESSAGE_PAYLOAD_FIELD* fields, size_t count, MAP_HANDLE properties);
+
+/** @brief		Tells whether an array of bytes starts like an encoded
+*				payload, without decoding it.
+*
+*	@details	Meant for modules that receive both encoded payloads and
+*				other content; #MessagePayload_Decode still checks the
+*				whole payload.
+*
+*	@return		@c true if @c source starts with the header of an encoded
+*				payload, @c false otherwise.
+*/
+extern bool MessagePayload_IsEncoded(const unsigned char* source, size_t size);
+
+/** @brief		Decodes the fields of an encoded payload.
+*
+*	@details	The names of the decoded fields, and their values of type
+*				#MESSAGE_PAYLOAD_STRING and #MESSAGE_PAYLOAD_BYTES, point
+*				into @c source, which has to outlive them.
+*
+*	@param		source	The encoded payload, for instance the content of a
+*						message.
+*	@param		size	The size in bytes of @c source.
+*	@param		fields	Receives the fields. It can be @c NULL when
+*						@c *count is 0, to learn the number of fields.
+*	@param		count	On input, the number of fields @c fields can hold.
+*						On output, the number of fields of the payload,
+*						unless @c source is not a valid payload.
+*
+*	@return		Zero upon success, non-zero if a parameter is @c NULL,
+*				@c source is not a valid payload or it has more fields
+*				than @c fields can hold.
+*/
+extern int MessagePayload_Decode(const unsigned char* source, size_t size, MESSAGE_PAYLOAD_FIELD* fields, size_t* count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*MESSAGE_PAYLOAD_H*/
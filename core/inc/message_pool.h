@@ -0,0 +1,135 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file		message_pool.h
+*	@brief		An opt-in cache of the memory blocks messages are made of.
+*
+*	@details	Once enabled, the pool keeps the blocks of destroyed messages
+*				in free lists of fixed size classes instead of giving them
+*				back to the heap. Every thread has its own free lists, used
+*				without locking. A block destroyed on a thread other than
+*				the one that allocated it goes back to a central free list,
+*				where any thread can take it. Blocks bigger than the
+*				largest size class always come from the heap.
+*
+*				The pool is process wide but belongs to the copy of the
+*				gateway library that enabled it: a module library that links
+*				its own copy has to enable its own pool. Blocks are self
+*				describing, so a message can be destroyed by any copy.
+*/
+
+#ifndef MESSAGE_POOL_H
+#define MESSAGE_POOL_H
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+extern "C"
+{
+#else
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+/** @brief	Number of size classes of the pool. The classes hold blocks of
+*			128, 256, 512, 1024, 2048 and 4096 bytes, pool bookkeeping
+*			included.
+*/
+#define MESSAGE_POOL_SIZE_CLASS_COUNT 6
+
+/** @brief	Struct describing how many free blocks the pool keeps. */
+typedef struct MESSAGE_POOL_CONFIG_TAG
+{
+	/** @brief	Free blocks every thread keeps for itself, per size class. */
+	size_t thread_cache_blocks;
+
+	/** @brief	Free blocks kept in the central free lists, per size
+	*			class. Blocks freed when the central list is full go back
+	*			to the heap.
+	*/
+	size_t central_cache_blocks;
+} MESSAGE_POOL_CONFIG;
+
+/** @brief	Struct describing what the pool did since it was enabled.
+*
+*	@details	Allocations served from the free list of the calling thread
+*				are not counted, so that they stay free of shared writes.
+*/
+typedef struct MESSAGE_POOL_STATISTICS_TAG
+{
+	/** @brief	Blocks taken from the central free lists. */
+	uint64_t central_allocations;
+
+	/** @brief	Blocks returned to the central free lists. */
+	uint64_t central_frees;
+
+	/** @brief	Blocks allocated from the heap. */
+	uint64_t heap_allocations;
+
+	/** @brief	Blocks given back to the heap. */
+	uint64_t heap_frees;
+
+	/** @brief	Free blocks in the central free lists right now. */
+	size_t central_cached_blocks;
+} MESSAGE_POOL_STATISTICS;
+
+/** @brief		Starts caching the blocks of messages.
+*
+*	@details	Meant to be called once, before the gateway is created. It is
+*				not safe to call it concurrently with itself or with
+*				#MessagePool_Disable. No gateway code path calls it: the host
+*				application enables the pool, typically in @c main before
+*				#Gateway_Create or #Gateway_LL_Create, and disables it after
+*				the gateway is destroyed.
+*
+*	@param		config	How many free blocks to keep.
+*
+*	@return		Zero upon success, non-zero if @c config is @c NULL, asks
+*				for no caching at all or the pool is already enabled.
+*/
+extern int MessagePool_Enable(const MESSAGE_POOL_CONFIG* config);
+
+/** @brief		Stops caching the blocks of messages and gives the central
+*				free lists back to the heap.
+*
+*	@details	Messages still alive are freed to the heap when destroyed.
+*				Every thread gives its own free lists back the next time it
+*				allocates or frees a block.
+*/
+extern void MessagePool_Disable(void);
+
+/** @brief		Empties the free lists of the calling thread into the
+*				central free lists, or into the heap when they are full or
+*				the pool is disabled. Threads that are about to exit have
+*				to call it or their cached blocks are lost. The message bus
+*				and worker pool threads do; a module that allocates
+*				messages on threads of its own has to do the same.
+*/
+extern void MessagePool_ReleaseThreadCache(void);
+
+/** @brief		Reads the counters of the pool.
+*
+*	@param		statistics	Receives the counters, all zero if the pool was
+*							never enabled.
+*
+*	@return		Zero upon success, non-zero if @c statistics is @c NULL.
+*/
+extern int MessagePool_GetStatistics(MESSAGE_POOL_STATISTICS* statistics);
+
+/** @brief		Allocates a block of at least @c size bytes, from the pool
+*				when it is enabled and from the heap otherwise.
+*
+*	@return		The block, or @c NULL upon failure.
+*/
+extern void* MessagePool_Allocate(size_t size);
+
+/** @brief		Frees a block returned by #MessagePool_Allocate, on any
+*				thread. Does nothing if @c block is @c NULL.
+*/
+extern void MessagePool_Free(void* block);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*MESSAGE_POOL_H*/
@@ -0,0 +1,124 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file		message_queue.h
+*	@brief		A FIFO queue of messages backed by a circular buffer.
+*
+*	@details	The message queue is used by the message bus to hold the
+*				messages that are due for delivery to a module. Enqueue and
+*				dequeue are both O(1); when the queue is full the backing
+*				buffer is doubled in size unless a maximum capacity was
+*				given at creation time. The queue is not thread safe, callers
+*				are expected to provide their own synchronization.
+*/
+
+#ifndef MESSAGE_QUEUE_H
+#define MESSAGE_QUEUE_H
+
+#include "azure_c_shared_utility/macro_utils.h"
+#include "message.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+extern "C"
+{
+#else
+#include <stddef.h>
+#include <stdbool.h>
+#endif
+
+/** @brief Struct representing a particular message queue. */
+typedef struct MESSAGE_QUEUE_HANDLE_DATA_TAG* MESSAGE_QUEUE_HANDLE;
+
+#define MESSAGE_QUEUE_RESULT_VALUES \
+    MESSAGE_QUEUE_OK, \
+    MESSAGE_QUEUE_ERROR, \
+    MESSAGE_QUEUE_INVALIDARG, \
+    MESSAGE_QUEUE_FULL
+
+/** @brief	Enumeration describing the result of ::MessageQueue_Push. */
+DEFINE_ENUM(MESSAGE_QUEUE_RESULT, MESSAGE_QUEUE_RESULT_VALUES);
+
+/** @brief		Creates a new, empty message queue.
+*
+*	@param		initial_capacity	The number of messages the queue can hold
+*									before it has to grow. Rounded up to the
+*									next power of 2.
+*	@param		max_capacity		The maximum number of messages the queue
+*									will hold, or 0 if the queue may grow
+*									without limit.
+*
+*	@return		A valid #MESSAGE_QUEUE_HANDLE upon success, or @c NULL upon
+*				failure.
+*/
+extern MESSAGE_QUEUE_HANDLE MessageQueue_Create(size_t initial_capacity, size_t max_capacity);
+
+/** @brief		Disposes of the queue.
+*
+*	@details	Every message still in the queue is released by calling
+*				#Message_Destroy.
+*
+*	@param		handle		The #MESSAGE_QUEUE_HANDLE to be destroyed.
+*/
+extern void MessageQueue_Destroy(MESSAGE_QUEUE_HANDLE handle);
+
+/** @brief		Appends a message to the back of the queue.
+*
+*	@details	The queue takes ownership of @c message upon success.
+*
+*	@param		handle		The #MESSAGE_QUEUE_HANDLE to push onto.
+*	@param		message		The #MESSAGE_HANDLE to be enqueued.
+*
+*	@return		#MESSAGE_QUEUE_OK upon success, #MESSAGE_QUEUE_FULL if the
+*				queue already holds its maximum capacity or another
+*				#MESSAGE_QUEUE_RESULT value upon failure.
+*/
+extern MESSAGE_QUEUE_RESULT MessageQueue_Push(MESSAGE_QUEUE_HANDLE handle, MESSAGE_HANDLE message);
+
+/** @brief		Removes the message at the front of the queue.
+*
+*	@details	Ownership of the returned message passes to the caller.
+*
+*	@param		handle		The #MESSAGE_QUEUE_HANDLE to pop from.
+*
+*	@return		The oldest #MESSAGE_HANDLE in the queue, or @c NULL if the
+*				queue is empty.
+*/
+extern MESSAGE_HANDLE MessageQueue_Pop(MESSAGE_QUEUE_HANDLE handle);
+
+/** @brief		Removes up to @c max_count messages from the front of the queue.
+*
+*	@details	The messages are stored in @c messages oldest first and their
+*				ownership passes to the caller.
+*
+*	@param		handle		The #MESSAGE_QUEUE_HANDLE to pop from.
+*	@param		messages	Array receiving the messages.
+*	@param		max_count	Number of elements of @c messages.
+*
+*	@return		The number of messages removed, 0 if the queue is empty or
+*				an argument is invalid.
+*/
+extern size_t MessageQueue_PopBatch(MESSAGE_QUEUE_HANDLE handle, MESSAGE_HANDLE* messages, size_t max_count);
+
+/** @brief		Gets the number of messages in the queue.
+*
+*	@param		handle		The #MESSAGE_QUEUE_HANDLE to inspect.
+*
+*	@return		The number of queued messages, 0 if @c handle is @c NULL.
+*/
+extern size_t MessageQueue_Size(MESSAGE_QUEUE_HANDLE handle);
+
+/** @brief		Tells whether the queue is empty.
+*
+*	@param		handle		The #MESSAGE_QUEUE_HANDLE to inspect.
+*
+*	@return		@c true if there are no messages in the queue or @c handle
+*				is @c NULL, @c false otherwise.
+*/
+extern bool MessageQueue_IsEmpty(MESSAGE_QUEUE_HANDLE handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*MESSAGE_QUEUE_H*/
@@ -22,9 +22,29 @@ typedef void* MODULE_HANDLE;
 typedef struct MODULE_APIS_TAG MODULE_APIS;
 
 #include "azure_c_shared_utility/macro_utils.h"
-#include "message_bus.h"
 #include "message.h"
 
+/*declared before message_bus.h is included, as MessageBus_AddModuleWithReceiveBatch takes one*/
+/** @brief		The module's optional callback function that is called with
+*				every message that was pending for the module at once.
+*
+*	@details	This function may be implemented by the module creator to
+*				amortize per-message work. When it is @c NULL the message
+*				bus calls #pfModule_Receive once per message instead. The
+*				messages are delivered oldest first and are destroyed by
+*				the message bus when the call returns.
+*
+*	@param		moduleHandle	The #MODULE_HANDLE of the module receiving the
+*								messages.
+*	@param		messageHandles	Array of the #MESSAGE_HANDLE of the messages
+*								being sent to the module.
+*	@param		count			Number of elements of @c messageHandles, always
+*								at least 1.
+*/
+typedef void(*pfModule_ReceiveBatch)(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE* messageHandles, size_t count);
+
+#include "message_bus.h"
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -134,6 +154,17 @@ extern "C"
     /** @brief Returns the module APIS name.*/
 #define MODULE_GETAPIS_NAME ("Module_GetAPIS")
 
+	/** @brief	Optional function exported by a module library that
+	*			implements #Module_ReceiveBatch. It is a separate export
+	*			rather than a member of #MODULE_APIS so that module libraries
+	*			built before it existed keep working: the loader never reads
+	*			past the end of the #MODULE_APIS they return.
+	*/
+	typedef pfModule_ReceiveBatch (*pfModule_GetReceiveBatch)(void);
+
+	/** @brief Returns the name of the optional #pfModule_GetReceiveBatch export.*/
+#define MODULE_GETRECEIVEBATCH_NAME ("Module_GetReceiveBatch")
+
 #ifdef _WIN32
 #define MODULE_EXPORT __declspec(dllexport)
 #else
@@ -15,6 +15,7 @@ typedef struct MODULE_LIBRARY_HANDLE_DATA_TAG* MODULE_LIBRARY_HANDLE;
 
 extern MODULE_LIBRARY_HANDLE ModuleLoader_Load(const char* moduleLibraryFileName);
 extern const MODULE_APIS* ModuleLoader_GetModuleAPIs(MODULE_LIBRARY_HANDLE moduleLibraryHandle);
+extern pfModule_ReceiveBatch ModuleLoader_GetModuleReceiveBatch(MODULE_LIBRARY_HANDLE moduleLibraryHandle);
 extern void ModuleLoader_Unload(MODULE_LIBRARY_HANDLE moduleLibraryHandle);
 
 #ifdef __cplusplus
@@ -0,0 +1,62 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file		string_intern.h
+*	@brief		A process wide table of reference counted, read only strings.
+*
+*	@details	Interning a string returns the one copy of it the table
+*				holds, so two interned strings are equal exactly when their
+*				pointers are. Messages intern the names of their properties:
+*				the few property names a gateway uses are stored once however
+*				many messages carry them.
+*
+*				The table belongs to the copy of the gateway library that
+*				holds it, but it is allocated from the heap and every
+*				interned string knows its place in it, so a string can be
+*				released by any copy.
+*/
+
+#ifndef STRING_INTERN_H
+#define STRING_INTERN_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @brief		Returns the interned copy of @c string, adding it to the table
+*				if it is not there yet, and takes a reference on it.
+*
+*	@param		string	The string to intern.
+*
+*	@return		The interned string, which stays valid until every reference
+*				taken on it is released with #StringIntern_Release, or
+*				@c NULL if @c string is @c NULL or memory is exhausted.
+*/
+extern const char* StringIntern_Acquire(const char* string);
+
+/** @brief		Releases a reference taken by #StringIntern_Acquire, removing
+*				the string from the table when it was the last one. Does
+*				nothing if @c interned is @c NULL.
+*
+*	@param		interned	A string returned by #StringIntern_Acquire. Any
+*							other string is undefined behavior.
+*/
+extern void StringIntern_Release(const char* interned);
+
+/** @brief		Hashes a string the way the table does.
+*
+*	@param		string	The string to hash, interned or not.
+*
+*	@return		The hash of @c string, equal for equal strings, or 0 if
+*				@c string is @c NULL.
+*/
+extern size_t StringIntern_Hash(const char* string);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*STRING_INTERN_H*/
@@ -0,0 +1,113 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file		subscription_index.h
+*	@brief		An index of message bus subscription filters keyed on
+*				property name and value.
+*
+*	@details	Every filter added to the index is assigned a slot. Matching
+*				a message against the index costs one hash lookup per distinct
+*				property name used by any filter, independently of the number
+*				of filters, and tells which slots the message matches. The
+*				index keeps its own copy of the filter strings. It is not
+*				thread safe, callers are expected to provide their own
+*				synchronization.
+*/
+
+#ifndef SUBSCRIPTION_INDEX_H
+#define SUBSCRIPTION_INDEX_H
+
+#include "azure_c_shared_utility/macro_utils.h"
+#include "message.h"
+#include "message_bus.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+extern "C"
+{
+#else
+#include <stddef.h>
+#endif
+
+/** @brief Struct representing a particular subscription index. */
+typedef struct SUBSCRIPTION_INDEX_HANDLE_DATA_TAG* SUBSCRIPTION_INDEX_HANDLE;
+
+#define SUBSCRIPTION_INDEX_RESULT_VALUES \
+    SUBSCRIPTION_INDEX_OK, \
+    SUBSCRIPTION_INDEX_ERROR, \
+    SUBSCRIPTION_INDEX_INVALIDARG
+
+/** @brief	Enumeration describing the result of ::SubscriptionIndex_Add. */
+DEFINE_ENUM(SUBSCRIPTION_INDEX_RESULT, SUBSCRIPTION_INDEX_RESULT_VALUES);
+
+/** @brief		Creates a new, empty subscription index.
+*
+*	@return		A valid #SUBSCRIPTION_INDEX_HANDLE upon success, or @c NULL
+*				upon failure.
+*/
+extern SUBSCRIPTION_INDEX_HANDLE SubscriptionIndex_Create(void);
+
+/** @brief		Disposes of the index.
+*
+*	@param		handle		The #SUBSCRIPTION_INDEX_HANDLE to be destroyed.
+*/
+extern void SubscriptionIndex_Destroy(SUBSCRIPTION_INDEX_HANDLE handle);
+
+/** @brief		Creates a copy of an index, with the same filters at the same
+*				slots. The copy can be modified while the original is being
+*				matched against on other threads.
+*
+*	@param		handle		The #SUBSCRIPTION_INDEX_HANDLE to be copied.
+*
+*	@return		A valid #SUBSCRIPTION_INDEX_HANDLE upon success, or @c NULL
+*				upon failure.
+*/
+extern SUBSCRIPTION_INDEX_HANDLE SubscriptionIndex_Clone(SUBSCRIPTION_INDEX_HANDLE handle);
+
+/** @brief		Adds a filter to the index.
+*
+*	@details	If the function fails the index is left as it was.
+*
+*	@param		handle		The #SUBSCRIPTION_INDEX_HANDLE to add to.
+*	@param		filter		The #MESSAGE_BUS_FILTER to be indexed.
+*	@param		slot		Receives the slot assigned to the filter.
+*
+*	@return		#SUBSCRIPTION_INDEX_OK upon success or another
+*				#SUBSCRIPTION_INDEX_RESULT value upon failure.
+*/
+extern SUBSCRIPTION_INDEX_RESULT SubscriptionIndex_Add(SUBSCRIPTION_INDEX_HANDLE handle, const MESSAGE_BUS_FILTER* filter, size_t* slot);
+
+/** @brief		Removes the filter stored at @c slot from the index. The slot
+*				may be assigned again by a later ::SubscriptionIndex_Add.
+*
+*	@param		handle		The #SUBSCRIPTION_INDEX_HANDLE to remove from.
+*	@param		slot		The slot returned by ::SubscriptionIndex_Add.
+*/
+extern void SubscriptionIndex_Remove(SUBSCRIPTION_INDEX_HANDLE handle, size_t slot);
+
+/** @brief		Gets the number of slots of the index, which is the size of
+*				the buffer ::SubscriptionIndex_Match needs.
+*
+*	@param		handle		The #SUBSCRIPTION_INDEX_HANDLE to inspect.
+*
+*	@return		The number of slots, 0 if @c handle is @c NULL.
+*/
+extern size_t SubscriptionIndex_GetSlotCount(SUBSCRIPTION_INDEX_HANDLE handle);
+
+/** @brief		Matches the properties of a message against every filter of
+*				the index.
+*
+*	@param		handle		The #SUBSCRIPTION_INDEX_HANDLE to match against.
+*	@param		message		The message, may be @c NULL.
+*	@param		matches		A buffer of ::SubscriptionIndex_GetSlotCount
+*							elements; element @c slot is set to a non-zero
+*							value if the filter at @c slot matches and to 0
+*							otherwise.
+*/
+extern void SubscriptionIndex_Match(SUBSCRIPTION_INDEX_HANDLE handle, MESSAGE_HANDLE message, size_t* matches);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*SUBSCRIPTION_INDEX_H*/
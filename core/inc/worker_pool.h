@@ -0,0 +1,132 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file		worker_pool.h
+*	@brief		A fixed number of threads running the tasks scheduled on
+*				them.
+*
+*	@details	The message bus uses a worker pool, when it is created with
+*				one, to deliver the messages of all its modules instead of
+*				giving every module its own thread. Tasks are run in the
+*				order they were scheduled, each by one of the threads of the
+*				pool. A task is a caller owned #WORKER_POOL_TASK, so
+*				scheduling never allocates.
+*/
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include "azure_c_shared_utility/macro_utils.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+extern "C"
+{
+#else
+#include <stddef.h>
+#endif
+
+/** @brief Struct representing a particular worker pool. */
+typedef struct WORKER_POOL_HANDLE_DATA_TAG* WORKER_POOL_HANDLE;
+
+#define WORKER_POOL_RESULT_VALUES \
+    WORKER_POOL_OK, \
+    WORKER_POOL_ERROR, \
+    WORKER_POOL_INVALIDARG
+
+/** @brief	Enumeration describing the result of ::WorkerPool_Schedule. */
+DEFINE_ENUM(WORKER_POOL_RESULT, WORKER_POOL_RESULT_VALUES);
+
+/** @brief	Function run by a thread of the pool for a scheduled task. */
+typedef void(*WORKER_POOL_TASK_FUNCTION)(void* context);
+
+/** @brief	Struct describing a task that can be scheduled on a worker pool.
+*
+*	@details	The pool links the scheduled tasks through @c next, so a task
+*				must stay alive and must not be scheduled again until its
+*				function has started running.
+*/
+typedef struct WORKER_POOL_TASK_TAG
+{
+	/** @brief	The function to run. */
+	WORKER_POOL_TASK_FUNCTION function;
+
+	/** @brief	The argument @c function is called with. */
+	void* context;
+
+	/** @brief	Used by the pool while the task is scheduled. */
+	struct WORKER_POOL_TASK_TAG* next;
+} WORKER_POOL_TASK;
+
+/** @brief	Function called by every thread of the pool right before it exits. */
+typedef void(*WORKER_POOL_THREAD_EXIT_FUNCTION)(void);
+
+/** @brief		Creates a worker pool and starts its threads.
+*
+*	@param		thread_count	The number of threads of the pool, or 0 for
+*								one thread per processor.
+*
+*	@return		A valid #WORKER_POOL_HANDLE upon success, or @c NULL upon
+*				failure.
+*/
+extern WORKER_POOL_HANDLE WorkerPool_Create(size_t thread_count);
+
+/** @brief		Creates a worker pool whose threads call @c on_thread_exit
+*				before they exit.
+*
+*	@details	This lets the owner of the pool release the per thread state
+*				its tasks leave behind, such as thread local caches.
+*
+*	@param		thread_count	The number of threads of the pool, or 0 for
+*								one thread per processor.
+*	@param		on_thread_exit	The function every thread calls before it
+*								exits, or @c NULL.
+*
+*	@return		A valid #WORKER_POOL_HANDLE upon success, or @c NULL upon
+*				failure.
+*/
+extern WORKER_POOL_HANDLE WorkerPool_CreateWithThreadExit(size_t thread_count, WORKER_POOL_THREAD_EXIT_FUNCTION on_thread_exit);
+
+/** @brief		Stops the threads of the pool and disposes of it.
+*
+*	@details	Tasks that are running are waited for, tasks that are still
+*				scheduled are not run.
+*
+*	@param		handle		The #WORKER_POOL_HANDLE to be destroyed.
+*/
+extern void WorkerPool_Destroy(WORKER_POOL_HANDLE handle);
+
+/** @brief		Schedules a task to be run by one of the threads of the pool.
+*
+*	@param		handle		The #WORKER_POOL_HANDLE to run the task on.
+*	@param		task		The #WORKER_POOL_TASK to run.
+*
+*	@return		A #WORKER_POOL_RESULT describing the result of the function.
+*/
+extern WORKER_POOL_RESULT WorkerPool_Schedule(WORKER_POOL_HANDLE handle, WORKER_POOL_TASK* task);
+
+/** @brief		Removes a task that has not started running from the
+*				scheduled tasks.
+*
+*	@param		handle		The #WORKER_POOL_HANDLE the task was scheduled on.
+*	@param		task		The #WORKER_POOL_TASK to remove.
+*
+*	@return		#WORKER_POOL_OK if the task was removed, or another
+*				#WORKER_POOL_RESULT value if it is not scheduled (it may be
+*				running) or an argument is invalid.
+*/
+extern WORKER_POOL_RESULT WorkerPool_Cancel(WORKER_POOL_HANDLE handle, WORKER_POOL_TASK* task);
+
+/** @brief		Gets the number of threads of the pool.
+*
+*	@param		handle		The #WORKER_POOL_HANDLE to inspect.
+*
+*	@return		The number of threads, 0 if @c handle is @c NULL.
+*/
+extern size_t WorkerPool_GetThreadCount(WORKER_POOL_HANDLE handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*WORKER_POOL_H*/
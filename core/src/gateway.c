@@ -1,6 +1,8 @@
 // Copyright (c) Microsoft. All rights reserved.
 // Licensed under the MIT license. See LICENSE file in the project root for full license information.
 
+#include <string.h>
+
 #include "azure_c_shared_utility/gballoc.h"
 #include "azure_c_shared_utility/iot_logging.h"
 #include "azure_c_shared_utility/macro_utils.h"
@@ -11,6 +13,24 @@
 #define MODULE_NAME_KEY "module name"
 #define MODULE_PATH_KEY "module path"
 #define ARG_KEY "args"
+#define QUEUE_KEY "queue"
+#define QUEUE_CAPACITY_KEY "capacity"
+#define QUEUE_POLICY_KEY "policy"
+#define QUEUE_TIMEOUT_KEY "timeout"
+#define QUEUE_POLICY_DROP_NEWEST "drop newest"
+#define QUEUE_POLICY_DROP_OLDEST "drop oldest"
+#define QUEUE_POLICY_BLOCK "block"
+#define DEPENDS_ON_KEY "depends on"
+#define LINKS_KEY "links"
+#define LINK_SOURCE_KEY "source"
+#define LINK_SINK_KEY "sink"
+#define LINK_FILTER_KEY "filter"
+#define LINK_FILTER_PROPERTY_KEY "property"
+#define LINK_FILTER_VALUE_KEY "value"
+#define WORKER_POOL_KEY "worker pool"
+#define WORKER_POOL_THREADS_KEY "threads"
+#define STARTUP_KEY "startup"
+#define STARTUP_THREADS_KEY "threads"
 
 #define PARSE_JSON_RESULT_VALUES \
     PARSE_JSON_SUCCESS, \
@@ -22,6 +42,11 @@
 DEFINE_ENUM(PARSE_JSON_RESULT, PARSE_JSON_RESULT_VALUES);
 
 static PARSE_JSON_RESULT parse_json_internal(GATEWAY_PROPERTIES* out_properties, JSON_Value *root);
+static PARSE_JSON_RESULT parse_queue_internal(MESSAGE_BUS_QUEUE_CONFIG* out_queue, JSON_Object *module_object);
+static PARSE_JSON_RESULT parse_depends_on_internal(VECTOR_HANDLE* out_depends_on, JSON_Object *module_object);
+static PARSE_JSON_RESULT parse_links_internal(GATEWAY_PROPERTIES* out_properties, JSON_Object *root_object);
+static PARSE_JSON_RESULT parse_worker_pool_internal(MESSAGE_BUS_CONFIG* out_bus_config, JSON_Object *root_object);
+static PARSE_JSON_RESULT parse_startup_internal(GATEWAY_STARTUP_CONFIG* out_startup_config, JSON_Object *root_object);
 static void destroy_properties_internal(GATEWAY_PROPERTIES* properties);
 
 GATEWAY_HANDLE Gateway_Create_From_JSON(const char* file_path)
@@ -87,6 +112,61 @@ GATEWAY_HANDLE Gateway_Create_From_JSON(const char* file_path)
     return gw;
 }
 
+int Gateway_UpdateFromJSON(GATEWAY_HANDLE gw, const char* file_path)
+{
+    int result;
+
+    /*Codes_SRS_GATEWAY_13_018: [If gw or file_path is NULL the function shall return a non-zero value.]*/
+    if (gw == NULL || file_path == NULL)
+    {
+        result = __LINE__;
+        LogError("Invalid argument. gw = %p, file_path = %p.", gw, file_path);
+    }
+    else
+    {
+        /*Codes_SRS_GATEWAY_13_019: [The function shall read and parse the file into a GATEWAY_PROPERTIES instance as Gateway_Create_From_JSON does, and return a non-zero value without changing the gateway if it cannot.]*/
+        JSON_Value *root_value = json_parse_file(file_path);
+        if (root_value == NULL)
+        {
+            result = __LINE__;
+            LogError("Input file [%s] could not be read.", file_path);
+        }
+        else
+        {
+            GATEWAY_PROPERTIES *properties = (GATEWAY_PROPERTIES*)malloc(sizeof(GATEWAY_PROPERTIES));
+            if (properties == NULL)
+            {
+                result = __LINE__;
+                LogError("Malloc failed.");
+            }
+            else
+            {
+                if (parse_json_internal(properties, root_value) != PARSE_JSON_SUCCESS)
+                {
+                    result = __LINE__;
+                    LogError("Failed to create properties structure from JSON configuration.");
+                }
+                else
+                {
+                    /*Codes_SRS_GATEWAY_13_020: [The function shall update the gateway with Gateway_LL_Update, so that only the modules and links that changed are removed or added, and return its result.]*/
+                    result = Gateway_LL_Update(gw, properties);
+                    if (result != 0)
+                    {
+                        LogError("Failed to update gateway using lower level library.");
+                    }
+                    destroy_properties_internal(properties);
+                }
+
+                free(properties);
+            }
+
+            json_value_free(root_value);
+        }
+    }
+
+    return result;
+}
+
 static void destroy_properties_internal(GATEWAY_PROPERTIES* properties)
 {
     size_t vector_size = VECTOR_size(properties->gateway_properties_entries);
@@ -94,15 +174,32 @@ static void destroy_properties_internal(GATEWAY_PROPERTIES* properties)
     {
         GATEWAY_PROPERTIES_ENTRY* element = (GATEWAY_PROPERTIES_ENTRY*)VECTOR_element(properties->gateway_properties_entries, element_index);
         json_free_serialized_string((char*)(element->module_configuration));
+        if (element->depends_on != NULL)
+        {
+            VECTOR_destroy(element->depends_on);
+        }
     }
 
     VECTOR_destroy(properties->gateway_properties_entries);
+
+    if (properties->gateway_links != NULL)
+    {
+        VECTOR_destroy(properties->gateway_links);
+    }
 }
 
 static PARSE_JSON_RESULT parse_json_internal(GATEWAY_PROPERTIES* out_properties, JSON_Value *root)
 {
     PARSE_JSON_RESULT result;
 
+    out_properties->gateway_links = NULL;
+    out_properties->bus_config.use_worker_pool = false;
+    out_properties->bus_config.worker_count = 0;
+    /*Codes_SRS_GATEWAY_13_021: [The function shall set the routing of GATEWAY_PROPERTIES's bus_config to MESSAGE_BUS_ROUTING_AUTOMATIC.]*/
+    out_properties->bus_config.routing = MESSAGE_BUS_ROUTING_AUTOMATIC;
+    out_properties->startup_config.parallel = false;
+    out_properties->startup_config.thread_count = 0;
+
     JSON_Object *modules_object = json_value_get_object(root);
     if (modules_object != NULL)
     {
@@ -123,14 +220,34 @@ static PARSE_JSON_RESULT parse_json_internal(GATEWAY_PROPERTIES* out_properties,
 
                     if (module_name != NULL && module_path != NULL)
                     {
+                        MESSAGE_BUS_QUEUE_CONFIG module_queue;
+                        VECTOR_HANDLE depends_on;
+                        if (parse_queue_internal(&module_queue, module) != PARSE_JSON_SUCCESS)
+                        {
+                            destroy_properties_internal(out_properties);
+                            result = PARSE_JSON_MISSING_OR_MISCONFIGURED_CONFIG;
+                            break;
+                        }
+
+                        result = parse_depends_on_internal(&depends_on, module);
+                        if (result != PARSE_JSON_SUCCESS)
+                        {
+                            destroy_properties_internal(out_properties);
+                            break;
+                        }
+
                         /*Codes_SRS_GATEWAY_14_005: [The function shall set the value of const void* module_properties in the GATEWAY_PROPERTIES instance to a char* representing the serialized args value for the particular module.]*/
                         JSON_Value *args = json_object_get_value(module, ARG_KEY);
                         char* args_str = json_serialize_to_string(args);
 
+                        /*Codes_SRS_GATEWAY_13_017: [The function shall set module_configuration_size to the size of the serialized args, including its terminating null character, or to 0 if there are no args.]*/
                         GATEWAY_PROPERTIES_ENTRY entry = {
                             module_name,
                             module_path,
-                            args_str
+                            args_str,
+                            module_queue,
+                            depends_on,
+                            (args_str == NULL) ? 0 : strlen(args_str) + 1
                         };
 
                         /*Codes_SRS_GATEWAY_14_006: [The function shall return NULL if the JSON_Value contains incomplete information.]*/
@@ -141,6 +258,10 @@ static PARSE_JSON_RESULT parse_json_internal(GATEWAY_PROPERTIES* out_properties,
                         else
                         {
                             json_free_serialized_string(args_str);
+                            if (depends_on != NULL)
+                            {
+                                VECTOR_destroy(depends_on);
+                            }
                             destroy_properties_internal(out_properties);
                             result = PARSE_JSON_VECTOR_FAILURE;
                             LogError("Failed to push data into properties vector.");
@@ -156,6 +277,23 @@ static PARSE_JSON_RESULT parse_json_internal(GATEWAY_PROPERTIES* out_properties,
                         break;
                     }
                 }
+
+                if (result == PARSE_JSON_SUCCESS)
+                {
+                    result = parse_links_internal(out_properties, modules_object);
+                    if (result == PARSE_JSON_SUCCESS)
+                    {
+                        result = parse_worker_pool_internal(&out_properties->bus_config, modules_object);
+                    }
+                    if (result == PARSE_JSON_SUCCESS)
+                    {
+                        result = parse_startup_internal(&out_properties->startup_config, modules_object);
+                    }
+                    if (result != PARSE_JSON_SUCCESS)
+                    {
+                        destroy_properties_internal(out_properties);
+                    }
+                }
             }
             else
             {
@@ -178,3 +316,257 @@ static PARSE_JSON_RESULT parse_json_internal(GATEWAY_PROPERTIES* out_properties,
     }
     return result;
 }
+
+static PARSE_JSON_RESULT parse_queue_internal(MESSAGE_BUS_QUEUE_CONFIG* out_queue, JSON_Object *module_object)
+{
+    PARSE_JSON_RESULT result;
+
+    out_queue->capacity = 0;
+    out_queue->policy = MESSAGE_BUS_QUEUE_DROP_NEWEST;
+    out_queue->timeout_ms = 0;
+
+    JSON_Object *queue_object = json_object_get_object(module_object, QUEUE_KEY);
+    if (queue_object == NULL)
+    {
+        /*Codes_SRS_GATEWAY_13_005: [If a module has no "queue" object the function shall leave the module_queue of its GATEWAY_PROPERTIES_ENTRY zeroed so that its queue has no limit.]*/
+        result = PARSE_JSON_SUCCESS;
+    }
+    else
+    {
+        /*Codes_SRS_GATEWAY_13_006: [The function shall set the module_queue of the GATEWAY_PROPERTIES_ENTRY from the "capacity", "policy" and "timeout" of the "queue" object of the module.]*/
+        double capacity = json_object_get_number(queue_object, QUEUE_CAPACITY_KEY);
+        const char* policy = json_object_get_string(queue_object, QUEUE_POLICY_KEY);
+        double timeout = json_object_get_number(queue_object, QUEUE_TIMEOUT_KEY);
+
+        result = PARSE_JSON_SUCCESS;
+        if (policy == NULL || strcmp(policy, QUEUE_POLICY_DROP_NEWEST) == 0)
+        {
+            out_queue->policy = MESSAGE_BUS_QUEUE_DROP_NEWEST;
+        }
+        else if (strcmp(policy, QUEUE_POLICY_DROP_OLDEST) == 0)
+        {
+            out_queue->policy = MESSAGE_BUS_QUEUE_DROP_OLDEST;
+        }
+        else if (strcmp(policy, QUEUE_POLICY_BLOCK) == 0)
+        {
+            out_queue->policy = MESSAGE_BUS_QUEUE_BLOCK;
+        }
+        else
+        {
+            /*Codes_SRS_GATEWAY_13_007: [The function shall return NULL if the "policy" of a "queue" is not "drop newest", "drop oldest" or "block", or its "capacity" or "timeout" is negative.]*/
+            result = PARSE_JSON_MISSING_OR_MISCONFIGURED_CONFIG;
+            LogError("\"policy\" of a \"queue\" in input JSON configuration is not \"drop newest\", \"drop oldest\" or \"block\".");
+        }
+
+        if (result == PARSE_JSON_SUCCESS)
+        {
+            if (capacity < 0 || timeout < 0)
+            {
+                /*Codes_SRS_GATEWAY_13_007: [The function shall return NULL if the "policy" of a "queue" is not "drop newest", "drop oldest" or "block", or its "capacity" or "timeout" is negative.]*/
+                result = PARSE_JSON_MISSING_OR_MISCONFIGURED_CONFIG;
+                LogError("\"capacity\" or \"timeout\" of a \"queue\" in input JSON configuration is negative.");
+            }
+            else
+            {
+                out_queue->capacity = (size_t)capacity;
+                out_queue->timeout_ms = (unsigned int)timeout;
+            }
+        }
+    }
+
+    return result;
+}
+
+static PARSE_JSON_RESULT parse_depends_on_internal(VECTOR_HANDLE* out_depends_on, JSON_Object *module_object)
+{
+    PARSE_JSON_RESULT result;
+
+    JSON_Value *depends_on_value = json_object_get_value(module_object, DEPENDS_ON_KEY);
+    if (depends_on_value == NULL)
+    {
+        /*Codes_SRS_GATEWAY_13_014: [If a module has no "depends on" array the function shall leave the depends_on of its GATEWAY_PROPERTIES_ENTRY NULL.]*/
+        *out_depends_on = NULL;
+        result = PARSE_JSON_SUCCESS;
+    }
+    else
+    {
+        JSON_Array *depends_on_array = json_value_get_array(depends_on_value);
+        if (depends_on_array == NULL)
+        {
+            /*Codes_SRS_GATEWAY_13_016: [The function shall return NULL if the "depends on" of a module is not an array of strings.]*/
+            *out_depends_on = NULL;
+            result = PARSE_JSON_MISSING_OR_MISCONFIGURED_CONFIG;
+            LogError("\"depends on\" of a module in input JSON configuration is not an array.");
+        }
+        else
+        {
+            /*Codes_SRS_GATEWAY_13_015: [The function shall set the depends_on of the GATEWAY_PROPERTIES_ENTRY to a vector of the names in the "depends on" array of the module.]*/
+            *out_depends_on = VECTOR_create(sizeof(const char*));
+            if (*out_depends_on == NULL)
+            {
+                result = PARSE_JSON_VECTOR_FAILURE;
+                LogError("Failed to create depends on vector.");
+            }
+            else
+            {
+                size_t name_count = json_array_get_count(depends_on_array);
+                result = PARSE_JSON_SUCCESS;
+                for (size_t name_index = 0; name_index < name_count; ++name_index)
+                {
+                    const char* name = json_array_get_string(depends_on_array, name_index);
+                    if (name == NULL)
+                    {
+                        /*Codes_SRS_GATEWAY_13_016: [The function shall return NULL if the "depends on" of a module is not an array of strings.]*/
+                        result = PARSE_JSON_MISSING_OR_MISCONFIGURED_CONFIG;
+                        LogError("\"depends on\" of a module in input JSON configuration is not an array of strings.");
+                        break;
+                    }
+                    else if (VECTOR_push_back(*out_depends_on, &name, 1) != 0)
+                    {
+                        result = PARSE_JSON_VECTOR_FAILURE;
+                        LogError("Failed to push data into depends on vector.");
+                        break;
+                    }
+                }
+
+                if (result != PARSE_JSON_SUCCESS)
+                {
+                    VECTOR_destroy(*out_depends_on);
+                    *out_depends_on = NULL;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+static PARSE_JSON_RESULT parse_worker_pool_internal(MESSAGE_BUS_CONFIG* out_bus_config, JSON_Object *root_object)
+{
+    PARSE_JSON_RESULT result;
+
+    JSON_Object *worker_pool_object = json_object_get_object(root_object, WORKER_POOL_KEY);
+    if (worker_pool_object == NULL)
+    {
+        /*Codes_SRS_GATEWAY_13_008: [If the JSON_Value has no "worker pool" object the function shall leave GATEWAY_PROPERTIES's bus_config zeroed so that every module gets its own thread.]*/
+        result = PARSE_JSON_SUCCESS;
+    }
+    else
+    {
+        double threads = json_object_get_number(worker_pool_object, WORKER_POOL_THREADS_KEY);
+        if (threads < 0)
+        {
+            /*Codes_SRS_GATEWAY_13_010: [The function shall return NULL if the "threads" of the "worker pool" object is negative.]*/
+            result = PARSE_JSON_MISSING_OR_MISCONFIGURED_CONFIG;
+            LogError("\"threads\" of the \"worker pool\" in input JSON configuration is negative.");
+        }
+        else
+        {
+            /*Codes_SRS_GATEWAY_13_009: [The function shall set use_worker_pool of GATEWAY_PROPERTIES's bus_config and its worker_count to the "threads" of the "worker pool" object, 0 meaning one thread per processor.]*/
+            out_bus_config->use_worker_pool = true;
+            out_bus_config->worker_count = (size_t)threads;
+            result = PARSE_JSON_SUCCESS;
+        }
+    }
+
+    return result;
+}
+
+static PARSE_JSON_RESULT parse_startup_internal(GATEWAY_STARTUP_CONFIG* out_startup_config, JSON_Object *root_object)
+{
+    PARSE_JSON_RESULT result;
+
+    JSON_Object *startup_object = json_object_get_object(root_object, STARTUP_KEY);
+    if (startup_object == NULL)
+    {
+        /*Codes_SRS_GATEWAY_13_011: [If the JSON_Value has no "startup" object the function shall leave GATEWAY_PROPERTIES's startup_config zeroed so that the modules are started one after another.]*/
+        result = PARSE_JSON_SUCCESS;
+    }
+    else
+    {
+        double threads = json_object_get_number(startup_object, STARTUP_THREADS_KEY);
+        if (threads < 0)
+        {
+            /*Codes_SRS_GATEWAY_13_013: [The function shall return NULL if the "threads" of the "startup" object is negative.]*/
+            result = PARSE_JSON_MISSING_OR_MISCONFIGURED_CONFIG;
+            LogError("\"threads\" of the \"startup\" in input JSON configuration is negative.");
+        }
+        else
+        {
+            /*Codes_SRS_GATEWAY_13_012: [The function shall set parallel of GATEWAY_PROPERTIES's startup_config and its thread_count to the "threads" of the "startup" object, 0 meaning one thread per module.]*/
+            out_startup_config->parallel = true;
+            out_startup_config->thread_count = (size_t)threads;
+            result = PARSE_JSON_SUCCESS;
+        }
+    }
+
+    return result;
+}
+
+static PARSE_JSON_RESULT parse_links_internal(GATEWAY_PROPERTIES* out_properties, JSON_Object *root_object)
+{
+    PARSE_JSON_RESULT result;
+
+    JSON_Value *links_value = json_object_get_value(root_object, LINKS_KEY);
+    if (links_value == NULL)
+    {
+        /*Codes_SRS_GATEWAY_13_001: [If the JSON_Value has no "links" array the function shall leave GATEWAY_PROPERTIES's gateway_links NULL so that every message is delivered to every module.]*/
+        out_properties->gateway_links = NULL;
+        result = PARSE_JSON_SUCCESS;
+    }
+    else
+    {
+        JSON_Array *links_array = json_value_get_array(links_value);
+        if (links_array == NULL)
+        {
+            /*Codes_SRS_GATEWAY_13_002: [The function shall return NULL if "links" is not an array or any of its entries is missing "source" or "sink".]*/
+            result = PARSE_JSON_MISSING_OR_MISCONFIGURED_CONFIG;
+            LogError("\"links\" in input JSON configuration is not an array.");
+        }
+        else
+        {
+            /*Codes_SRS_GATEWAY_13_003: [The function shall add a GATEWAY_LINK_ENTRY to GATEWAY_PROPERTIES's gateway_links for each entry of the "links" array.]*/
+            out_properties->gateway_links = VECTOR_create(sizeof(GATEWAY_LINK_ENTRY));
+            if (out_properties->gateway_links == NULL)
+            {
+                result = PARSE_JSON_VECTOR_FAILURE;
+                LogError("Failed to create links vector.");
+            }
+            else
+            {
+                size_t link_count = json_array_get_count(links_array);
+                result = PARSE_JSON_SUCCESS;
+                for (size_t link_index = 0; link_index < link_count; ++link_index)
+                {
+                    JSON_Object *link = json_array_get_object(links_array, link_index);
+                    JSON_Object *filter = json_object_get_object(link, LINK_FILTER_KEY);
+
+                    /*Codes_SRS_GATEWAY_13_004: [The function shall set filter_property and filter_value of the GATEWAY_LINK_ENTRY from the optional "filter" object of the link.]*/
+                    GATEWAY_LINK_ENTRY entry = {
+                        json_object_get_string(link, LINK_SOURCE_KEY),
+                        json_object_get_string(link, LINK_SINK_KEY),
+                        json_object_get_string(filter, LINK_FILTER_PROPERTY_KEY),
+                        json_object_get_string(filter, LINK_FILTER_VALUE_KEY)
+                    };
+
+                    /*Codes_SRS_GATEWAY_13_002: [The function shall return NULL if "links" is not an array or any of its entries is missing "source" or "sink".]*/
+                    if (entry.module_source == NULL || entry.module_sink == NULL ||
+                        (filter != NULL && (entry.filter_property == NULL || entry.filter_value == NULL)))
+                    {
+                        result = PARSE_JSON_MISSING_OR_MISCONFIGURED_CONFIG;
+                        LogError("\"source\" or \"sink\" or \"filter\" of a link in input JSON configuration is missing or misconfigured.");
+                        break;
+                    }
+                    else if (VECTOR_push_back(out_properties->gateway_links, &entry, 1) != 0)
+                    {
+                        result = PARSE_JSON_VECTOR_FAILURE;
+                        LogError("Failed to push data into links vector.");
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    return result;
+}
@@ -9,10 +9,41 @@
 #include "azure_c_shared_utility/iot_logging.h"
 
 #include <stddef.h>
+#include <string.h>
+
+#include "azure_c_shared_utility/crt_abstractions.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
 
 #include "gateway_ll.h"
 #include "message_bus.h"
 #include "module_loader.h"
+#include "worker_pool.h"
+#include "message_pool.h"
+
+#if defined(WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/*atomic operations on the number of modules of a level still being started*/
+#if defined(WIN32)
+typedef volatile LONG GATEWAY_STARTUP_COUNTER;
+#define GATEWAY_STARTUP_COUNTER_GET(counter) InterlockedCompareExchange(&(counter), 0, 0)
+#define GATEWAY_STARTUP_COUNTER_SET(counter, value) (void)InterlockedExchange(&(counter), (LONG)(value))
+#define GATEWAY_STARTUP_COUNTER_DECREMENT(counter) InterlockedDecrement(&(counter))
+#elif defined(__GNUC__)
+typedef volatile long GATEWAY_STARTUP_COUNTER;
+#define GATEWAY_STARTUP_COUNTER_GET(counter) __atomic_load_n(&(counter), __ATOMIC_SEQ_CST)
+#define GATEWAY_STARTUP_COUNTER_SET(counter, value) __atomic_store_n(&(counter), (long)(value), __ATOMIC_SEQ_CST)
+#define GATEWAY_STARTUP_COUNTER_DECREMENT(counter) __atomic_sub_fetch(&(counter), 1, __ATOMIC_SEQ_CST)
+#else
+#error "the parallel startup of the modules needs atomic operations on this platform"
+#endif
+
+/*how long the startup waits for the modules of a level before it looks at 'pending' again*/
+#define GATEWAY_STARTUP_WAIT_MS 10
 
 typedef struct GATEWAY_HANDLE_DATA_TAG {
 	/** @brief Vector of MODULE_DATA modules that the Gateway must track */
@@ -20,6 +51,9 @@ typedef struct GATEWAY_HANDLE_DATA_TAG {
 
 	/** @brief The message bus contained within this Gateway */
 	MESSAGE_BUS_HANDLE bus;
+
+	/** @brief The (possibly NULL) vector of the GATEWAY_LINK_ENTRY copies of the links added to the bus, so that Gateway_LL_Update can tell which ones changed */
+	VECTOR_HANDLE links;
 } GATEWAY_HANDLE_DATA;
 
 typedef struct MODULE_DATA_TAG {
@@ -28,11 +62,89 @@ typedef struct MODULE_DATA_TAG {
 
 	/** @brief The MODULE_HANDLE of the same module that lives on the message bus.*/
 	MODULE_HANDLE module;
+
+	/** @brief The (possibly NULL) name of the module, used to resolve links.*/
+	char* module_name;
+
+	/** @brief How long loading the library and creating the module took, zeroed for the modules of Gateway_LL_Create2.*/
+	GATEWAY_MODULE_STARTUP_TIMES startup_times;
+
+	/** @brief The (possibly NULL) copy of the module_path the module was loaded from.*/
+	char* module_path;
+
+	/** @brief The (possibly NULL) copy of the configuration the module was created with, module_configuration_size bytes long.*/
+	void* module_configuration;
+	size_t module_configuration_size;
+
+	/** @brief true if module_path and module_configuration describe the module, in which case Gateway_LL_Update can keep it running.*/
+	bool module_described;
+
+	/** @brief The queue the module was added to the bus with.*/
+	MESSAGE_BUS_QUEUE_CONFIG module_queue;
+
+	/** @brief true while Gateway_LL_Update is about to remove the module.*/
+	bool update_removed;
 } MODULE_DATA;
 
-static MODULE_HANDLE gateway_addmodule_internal(GATEWAY_HANDLE gw, const char* module_path, const void* module_configuration);
-static void gateway_removemodule_internal(GATEWAY_HANDLE gw, MODULE_DATA* module);
+/*tracks the tasks of a parallel startup still running*/
+typedef struct GATEWAY_STARTUP_TAG {
+	/** @brief Guards the wait on 'cond'.*/
+	LOCK_HANDLE lock;
+
+	/** @brief Signaled when 'pending' drops to 0.*/
+	COND_HANDLE cond;
+
+	/** @brief The number of modules still being loaded and created, changed atomically so that a task that cannot lock still counts its module.*/
+	GATEWAY_STARTUP_COUNTER pending;
+
+	/** @brief The bus the modules are created with.*/
+	MESSAGE_BUS_HANDLE bus;
+} GATEWAY_STARTUP;
+
+#define MODULE_START_NO_LEVEL ((size_t)-1)
+
+/*a module loaded and created from a GATEWAY_PROPERTIES_ENTRY, not yet added to the bus*/
+typedef struct MODULE_START_TAG {
+	const GATEWAY_PROPERTIES_ENTRY* entry;
+
+	/** @brief The indexes of the entries of the modules this module depends on.*/
+	size_t* dependencies;
+	size_t dependency_count;
+
+	/** @brief The modules of a level are started together, once those of the levels below are on the bus.*/
+	size_t level;
+
+	MODULE_LIBRARY_HANDLE module_library_handle;
+	const MODULE_APIS* module_apis;
+	pfModule_ReceiveBatch module_receive_batch;
+
+	/** @brief NULL until the module is created.*/
+	MODULE_HANDLE module;
+	GATEWAY_MODULE_STARTUP_TIMES startup_times;
+
+	/** @brief true once the module is on the bus and in the gateway's modules.*/
+	bool added;
+	WORKER_POOL_TASK task;
+	GATEWAY_STARTUP* startup;
+} MODULE_START;
+
+static MODULE_HANDLE gateway_addmodule_internal(GATEWAY_HANDLE gw, const GATEWAY_PROPERTIES_ENTRY* entry);
+static int gateway_addmodules_internal(GATEWAY_HANDLE_DATA* gateway_handle, VECTOR_HANDLE entries, size_t entries_count);
+static int gateway_addmodules_graph_internal(GATEWAY_HANDLE_DATA* gateway_handle, VECTOR_HANDLE entries, size_t entries_count, const GATEWAY_STARTUP_CONFIG* startup_config);
+static bool gateway_entries_have_dependencies(VECTOR_HANDLE entries, size_t entries_count);
+static void gateway_removemodule_internal(GATEWAY_HANDLE gw, MODULE_DATA* module, uint64_t drain_deadline_us, MESSAGE_BUS_DRAIN_RESULT* drain_result);
+static void gateway_destroy_internal(GATEWAY_HANDLE_DATA* gateway_handle, uint64_t drain_deadline_us, MESSAGE_BUS_DRAIN_RESULT* drain_result);
+static uint64_t get_time_us(void);
+static MESSAGE_BUS_HANDLE gateway_bus_create(const GATEWAY_PROPERTIES* properties);
 static bool module_data_find(const void* element, const void* value);
+static MODULE_DATA* module_data_find_by_name(GATEWAY_HANDLE_DATA* gateway_handle, const char* module_name);
+static int gateway_link_to_bus_link(GATEWAY_HANDLE_DATA* gateway_handle, const GATEWAY_LINK_ENTRY* entry, MESSAGE_BUS_LINK* link);
+static int link_data_add(GATEWAY_HANDLE_DATA* gateway_handle, const GATEWAY_LINK_ENTRY* entry);
+static bool link_data_find(GATEWAY_HANDLE_DATA* gateway_handle, const GATEWAY_LINK_ENTRY* entry, size_t* link_index);
+static bool gateway_links_contain(VECTOR_HANDLE links, const GATEWAY_LINK_ENTRY* entry);
+static void link_data_remove(GATEWAY_HANDLE_DATA* gateway_handle, const GATEWAY_LINK_ENTRY* entry);
+static void link_data_remove_module(GATEWAY_HANDLE_DATA* gateway_handle, const char* module_name);
+static void link_data_destroy(GATEWAY_HANDLE_DATA* gateway_handle);
 
 GATEWAY_HANDLE Gateway_LL_Create(const GATEWAY_PROPERTIES* properties)
 {
@@ -40,8 +152,9 @@ GATEWAY_HANDLE Gateway_LL_Create(const GATEWAY_PROPERTIES* properties)
 	GATEWAY_HANDLE_DATA* gateway = (GATEWAY_HANDLE_DATA*)malloc(sizeof(GATEWAY_HANDLE_DATA));
 	if (gateway != NULL)
 	{
+		gateway->links = NULL;
 		/*Codes_SRS_GATEWAY_LL_14_003: [This function shall create a new MESSAGE_BUS_HANDLE for the gateway representing this gateway's message bus. ]*/
-		gateway->bus = MessageBus_Create();
+		gateway->bus = gateway_bus_create(properties);
 		if (gateway->bus == NULL)
 		{
 			/*Codes_SRS_GATEWAY_LL_14_004: [This function shall return NULL if a MESSAGE_BUS_HANDLE cannot be created.]*/
@@ -70,26 +183,31 @@ GATEWAY_HANDLE Gateway_LL_Create(const GATEWAY_PROPERTIES* properties)
 					size_t entries_count = VECTOR_size(properties->gateway_properties_entries);
 					if (entries_count > 0)
 					{
-						//Add the first module, if successfull add others
-						GATEWAY_PROPERTIES_ENTRY* entry = (GATEWAY_PROPERTIES_ENTRY*)VECTOR_element(properties->gateway_properties_entries, 0);
-						MODULE_HANDLE module = gateway_addmodule_internal(gateway, entry->module_path, entry->module_configuration);
-
-						//Continue adding modules until all are added or one fails
-						for (size_t properties_index = 1; properties_index < entries_count && module != NULL; ++properties_index)
+						int added;
+						/*Codes_SRS_GATEWAY_LL_13_017: [If properties's startup_config asks for a parallel startup and there is more than one entry, the function shall load and create the modules of the entries concurrently on a worker pool of startup_config's thread_count threads, one thread per entry when it is 0 or more than the number of entries.]*/
+						if (properties->startup_config.parallel && entries_count > 1)
+						{
+							added = gateway_addmodules_graph_internal(gateway, properties->gateway_properties_entries, entries_count, &properties->startup_config);
+						}
+						else if (gateway_entries_have_dependencies(properties->gateway_properties_entries, entries_count))
+						{
+							added = gateway_addmodules_graph_internal(gateway, properties->gateway_properties_entries, entries_count, NULL);
+						}
+						else
 						{
-							entry = (GATEWAY_PROPERTIES_ENTRY*)VECTOR_element(properties->gateway_properties_entries, properties_index);
-							module = gateway_addmodule_internal(gateway, entry->module_path, entry->module_configuration);
+							added = gateway_addmodules_internal(gateway, properties->gateway_properties_entries, entries_count);
 						}
 
 						/*Codes_SRS_GATEWAY_LL_14_036: [ If any MODULE_HANDLE is unable to be created from a GATEWAY_PROPERTIES_ENTRY the GATEWAY_HANDLE will be destroyed. ]*/
-						if (module == NULL)
+						if (added != 0)
 						{
-							LogError("Gateway_LL_Create(): Unable to add module '%s'. The gateway will be destroyed.", entry->module_name);
+							LogError("Gateway_LL_Create(): Unable to add the modules. The gateway will be destroyed.");
+							/*Codes_SRS_GATEWAY_LL_13_028: [Before destroying the GATEWAY_HANDLE the function shall remove the modules already added in the reverse order they were added.]*/
 							while (gateway->modules != NULL && VECTOR_size(gateway->modules) > 0)
 							{
-								MODULE_DATA* module_data = (MODULE_DATA*)VECTOR_front(gateway->modules);
+								MODULE_DATA* module_data = (MODULE_DATA*)VECTOR_back(gateway->modules);
 								//By design, there will be no NULL module_data pointers in the vector
-								gateway_removemodule_internal(gateway, module_data);
+								gateway_removemodule_internal(gateway, module_data, 0, NULL);
 							}
 							VECTOR_destroy(gateway->modules);
 							MessageBus_Destroy(gateway->bus);
@@ -98,6 +216,24 @@ GATEWAY_HANDLE Gateway_LL_Create(const GATEWAY_PROPERTIES* properties)
 						}
 					}
 				}
+
+				if (gateway != NULL && properties != NULL && properties->gateway_links != NULL)
+				{
+					/*Codes_SRS_GATEWAY_LL_13_001: [The function shall add each GATEWAY_LINK_ENTRY of GATEWAY_PROPERTIES's gateway_links to the gateway once all modules have been added.]*/
+					size_t link_count = VECTOR_size(properties->gateway_links);
+					for (size_t link_index = 0; link_index < link_count; ++link_index)
+					{
+						GATEWAY_LINK_ENTRY* link_entry = (GATEWAY_LINK_ENTRY*)VECTOR_element(properties->gateway_links, link_index);
+						if (Gateway_LL_AddLink(gateway, link_entry) != 0)
+						{
+							/*Codes_SRS_GATEWAY_LL_13_002: [If any link cannot be added the GATEWAY_HANDLE will be destroyed.]*/
+							LogError("Gateway_LL_Create(): Unable to add link from '%s' to '%s'. The gateway will be destroyed.", link_entry->module_source, link_entry->module_sink);
+							Gateway_LL_Destroy(gateway);
+							gateway = NULL;
+							break;
+						}
+					}
+				}
 			}
 		}
 	}
@@ -116,6 +252,7 @@ GATEWAY_HANDLE Gateway_LL_Create2(const VECTOR_HANDLE modules, MESSAGE_BUS_HANDL
 	GATEWAY_HANDLE_DATA* gateway = (GATEWAY_HANDLE_DATA*)malloc(sizeof(GATEWAY_HANDLE_DATA));
 	if (gateway != NULL)
 	{
+		gateway->links = NULL;
 		/*Codes_SRS_GATEWAY_LL_14_003: [This function shall create a new MESSAGE_BUS_HANDLE for the gateway representing this gateway's message bus. ]*/
 		gateway->bus = bus;
 		if (gateway->bus == NULL)
@@ -128,7 +265,7 @@ GATEWAY_HANDLE Gateway_LL_Create2(const VECTOR_HANDLE modules, MESSAGE_BUS_HANDL
 		else
 		{
 			/*Codes_SRS_GATEWAY_LL_14_033: [ The function shall create a vector to store each MODULE_DATA. ]*/
-			gateway->modules = modules;
+			gateway->modules = VECTOR_create(sizeof(MODULE_DATA));
 			if (gateway->modules == NULL)
 			{
 				/*Codes_SRS_GATEWAY_LL_14_034: [ This function shall return NULL if a VECTOR_HANDLE cannot be created. ]*/
@@ -140,32 +277,38 @@ GATEWAY_HANDLE Gateway_LL_Create2(const VECTOR_HANDLE modules, MESSAGE_BUS_HANDL
 			}
 			else
 			{
-				size_t entries_count = VECTOR_size(gateway->modules);
+				size_t entries_count = (modules == NULL) ? 0 : VECTOR_size(modules);
 
 				//Continue adding modules until all are added or one fails
 				for (size_t index = 0; index < entries_count; ++index)
 				{
-					MODULE* module = (MODULE*)VECTOR_element(gateway->modules, index);
+					MODULE* module = (MODULE*)VECTOR_element(modules, index);
 
 					/*Codes_SRS_GATEWAY_LL_14_036: [ If any MODULE_HANDLE is unable to be created from a GATEWAY_PROPERTIES_ENTRY the GATEWAY_HANDLE will be destroyed. ]*/
-					if (module != NULL)
+					if (module != NULL && module->module_data != NULL)
 					{
+						MODULE_DATA module_data;
+						memset(&module_data, 0, sizeof(module_data));
+						module_data.module = (module->module_type == NATIVE_C_TYPE) ?
+							((MODULE_C_STYLE*)module->module_data)->module_handle :
+							(MODULE_HANDLE)((MODULE_CPP_STYLE*)module->module_data)->module_instance;
+
 						if (MessageBus_AddModule(gateway->bus, module) != MESSAGE_BUS_OK)
 						{
 							// TODO: cleanup for error case
-							// module_apis->Module_Destroy(module_handle);
-							// VECTOR_destroy(gateway->modules);
-							// MessageBus_Destroy(gateway->bus);
-							// free(gateway);
-							// gateway = NULL;
 							LogError("Failed to add module to the gateway bus.");
 						}
+						/*Codes_SRS_GATEWAY_LL_13_015: [The function shall track every module it adds to the bus in its own vector of MODULE_DATA, without a module library and without a name, and shall not keep a reference to modules.]*/
+						else if (VECTOR_push_back(gateway->modules, &module_data, 1) != 0)
+						{
+							LogError("Failed to track module on the gateway.");
+							(void)MessageBus_RemoveModule(gateway->bus, module_data.module);
+						}
 						else
 						{
 							/*Codes_SRS_GATEWAY_LL_14_039: [ The function shall increment the MESSAGE_BUS_HANDLE reference count if the MODULE_HANDLE was successfully linked to the GATEWAY_HANDLE_DATA's bus. ]*/
 							MessageBus_IncRef(gateway->bus);
 						}
-
 					}
 				}
 			}
@@ -185,27 +328,35 @@ void Gateway_LL_Destroy(GATEWAY_HANDLE gw)
 	/*Codes_SRS_GATEWAY_LL_14_005: [If gw is NULL the function shall do nothing.]*/
 	if (gw != NULL)
 	{
-		GATEWAY_HANDLE_DATA* gateway_handle = (GATEWAY_HANDLE_DATA*)gw;
-
-		/*Codes_SRS_GATEWAY_LL_14_028: [The function shall remove each module in GATEWAY_HANDLE_DATA's modules vector and destroy GATEWAY_HANDLE_DATA's modules.]*/
-		while (gateway_handle->modules != NULL && VECTOR_size(gateway_handle->modules) > 0)
-		{
-			MODULE_DATA* module_data = (MODULE_DATA*)VECTOR_front(gateway_handle->modules);
-			//By design, there will be no NULL module_data pointers in the vector
-			/*Codes_SRS_GATEWAY_LL_14_037: [If GATEWAY_HANDLE_DATA's message bus cannot unlink module, the function shall log the error and continue unloading the module from the GATEWAY_HANDLE. ]*/
-			gateway_removemodule_internal(gateway_handle, module_data);
-		}
+		gateway_destroy_internal((GATEWAY_HANDLE_DATA*)gw, 0, NULL);
+	}
+	else
+	{
+		LogError("Gateway_LL_Destroy(): The GATEWAY_HANDLE is null.");
+	}
+}
 
-		VECTOR_destroy(gateway_handle->modules);
+void Gateway_LL_DestroyWithDrain(GATEWAY_HANDLE gw, unsigned int drain_timeout_ms, MESSAGE_BUS_DRAIN_RESULT* drain_result)
+{
+	MESSAGE_BUS_DRAIN_RESULT local_drain_result;
 
-		/*Codes_SRS_GATEWAY_LL_14_006: [The function shall destroy the GATEWAY_HANDLE_DATA's `bus` `MESSAGE_BUS_HANDLE`. ]*/
-		MessageBus_Destroy(gateway_handle->bus);
+	/*Codes_SRS_GATEWAY_LL_13_033: [If drain_result is not NULL, the function shall store in it the sum of the messages delivered and dropped while removing the modules.]*/
+	if (drain_result == NULL)
+	{
+		drain_result = &local_drain_result;
+	}
+	drain_result->delivered = 0;
+	drain_result->dropped = 0;
 
-		free(gateway_handle);
+	/*Codes_SRS_GATEWAY_LL_13_030: [If gw is NULL the function shall do nothing.]*/
+	if (gw != NULL)
+	{
+		/*Codes_SRS_GATEWAY_LL_13_031: [The function shall destroy the gateway as Gateway_LL_Destroy does, removing every module from the bus with MessageBus_RemoveModuleWithDrain and the time left until drain_timeout_ms milliseconds have passed since the function was called.]*/
+		gateway_destroy_internal((GATEWAY_HANDLE_DATA*)gw, get_time_us() + ((uint64_t)drain_timeout_ms * 1000), drain_result);
 	}
 	else
 	{
-		LogError("Gateway_LL_Destroy(): The GATEWAY_HANDLE is null.");
+		LogError("Gateway_LL_DestroyWithDrain(): The GATEWAY_HANDLE is null.");
 	}
 }
 
@@ -215,7 +366,7 @@ MODULE_HANDLE Gateway_LL_AddModule(GATEWAY_HANDLE gw, const GATEWAY_PROPERTIES_E
 	/*Codes_SRS_GATEWAY_LL_14_011: [ If gw, entry, or GATEWAY_PROPERTIES_ENTRY's module_path is NULL the function shall return NULL. ]*/
 	if (gw != NULL && entry != NULL)
 	{
-		module = gateway_addmodule_internal(gw, entry->module_path, entry->module_configuration);
+		module = gateway_addmodule_internal(gw, entry);
 
 		if (module == NULL)
 		{
@@ -231,6 +382,71 @@ MODULE_HANDLE Gateway_LL_AddModule(GATEWAY_HANDLE gw, const GATEWAY_PROPERTIES_E
 	return module;
 }
 
+int Gateway_LL_AddLink(GATEWAY_HANDLE gw, const GATEWAY_LINK_ENTRY* entry)
+{
+	int result;
+	MESSAGE_BUS_LINK link;
+
+	/*Codes_SRS_GATEWAY_LL_13_004: [If gw, entry, entry's module_source or entry's module_sink is NULL the function shall return a non-zero value.]*/
+	if (gw == NULL || entry == NULL || entry->module_source == NULL || entry->module_sink == NULL)
+	{
+		result = __LINE__;
+		LogError("Gateway_LL_AddLink(): invalid arg. gw = %p, entry = %p.", gw, entry);
+	}
+	/*Codes_SRS_GATEWAY_LL_13_005: [The function shall return a non-zero value if module_sink, or module_source when it is not "*", is not the name of a module of the gateway.]*/
+	else if (gateway_link_to_bus_link((GATEWAY_HANDLE_DATA*)gw, entry, &link) != 0)
+	{
+		result = __LINE__;
+		LogError("Gateway_LL_AddLink(): unable to find the modules of the link from '%s' to '%s'.", entry->module_source, entry->module_sink);
+	}
+	/*Codes_SRS_GATEWAY_LL_13_006: [The function shall add the link to GATEWAY_HANDLE_DATA's bus using MessageBus_AddLink and return a non-zero value if it fails.]*/
+	else if (MessageBus_AddLink(((GATEWAY_HANDLE_DATA*)gw)->bus, &link) != MESSAGE_BUS_OK)
+	{
+		result = __LINE__;
+		LogError("Gateway_LL_AddLink(): MessageBus_AddLink failed.");
+	}
+	/*Codes_SRS_GATEWAY_LL_13_034: [The function shall keep a copy of entry in GATEWAY_HANDLE_DATA's links, and shall remove the link from the bus and return a non-zero value if it cannot.]*/
+	else if (link_data_add((GATEWAY_HANDLE_DATA*)gw, entry) != 0)
+	{
+		result = __LINE__;
+		(void)MessageBus_RemoveLink(((GATEWAY_HANDLE_DATA*)gw)->bus, &link);
+		LogError("Gateway_LL_AddLink(): unable to keep a copy of the link.");
+	}
+	else
+	{
+		/*Codes_SRS_GATEWAY_LL_13_007: [The function shall return 0 upon success.]*/
+		result = 0;
+	}
+
+	return result;
+}
+
+void Gateway_LL_RemoveLink(GATEWAY_HANDLE gw, const GATEWAY_LINK_ENTRY* entry)
+{
+	MESSAGE_BUS_LINK link;
+
+	/*Codes_SRS_GATEWAY_LL_13_008: [If gw, entry, entry's module_source or entry's module_sink is NULL the function shall return.]*/
+	if (gw == NULL || entry == NULL || entry->module_source == NULL || entry->module_sink == NULL)
+	{
+		LogError("Gateway_LL_RemoveLink(): invalid arg. gw = %p, entry = %p.", gw, entry);
+	}
+	/*Codes_SRS_GATEWAY_LL_13_009: [The function shall return if the modules of the link cannot be found.]*/
+	else if (gateway_link_to_bus_link((GATEWAY_HANDLE_DATA*)gw, entry, &link) != 0)
+	{
+		LogError("Gateway_LL_RemoveLink(): unable to find the modules of the link from '%s' to '%s'.", entry->module_source, entry->module_sink);
+	}
+	/*Codes_SRS_GATEWAY_LL_13_010: [The function shall remove the link from GATEWAY_HANDLE_DATA's bus using MessageBus_RemoveLink.]*/
+	else if (MessageBus_RemoveLink(((GATEWAY_HANDLE_DATA*)gw)->bus, &link) != MESSAGE_BUS_OK)
+	{
+		LogError("Gateway_LL_RemoveLink(): MessageBus_RemoveLink failed.");
+	}
+	else
+	{
+		/*Codes_SRS_GATEWAY_LL_13_035: [The function shall remove the copy of the link from GATEWAY_HANDLE_DATA's links.]*/
+		link_data_remove((GATEWAY_HANDLE_DATA*)gw, entry);
+	}
+}
+
 void Gateway_LL_RemoveModule(GATEWAY_HANDLE gw, MODULE_HANDLE module)
 {
 	/*Codes_SRS_GATEWAY_LL_14_020: [ If gw or module is NULL the function shall return. ]*/
@@ -243,7 +459,7 @@ void Gateway_LL_RemoveModule(GATEWAY_HANDLE gw, MODULE_HANDLE module)
 
 		if (module_data != NULL)
 		{
-			gateway_removemodule_internal(gateway_handle, module_data);
+			gateway_removemodule_internal(gateway_handle, module_data, 0, NULL);
 		}
 		else
 		{
@@ -256,122 +472,1183 @@ void Gateway_LL_RemoveModule(GATEWAY_HANDLE gw, MODULE_HANDLE module)
 	}
 }
 
-/*Private*/
+int Gateway_LL_GetStatistics(GATEWAY_HANDLE gw, GATEWAY_STATISTICS_CALLBACK callback, void* context)
+{
+	int result;
+
+	/*Codes_SRS_GATEWAY_LL_13_012: [If gw or callback is NULL the function shall return a non-zero value.]*/
+	if (gw == NULL || callback == NULL)
+	{
+		result = __LINE__;
+		LogError("Gateway_LL_GetStatistics(): invalid arg. gw = %p, callback = %p.", gw, callback);
+	}
+	else
+	{
+		GATEWAY_HANDLE_DATA* gateway_handle = (GATEWAY_HANDLE_DATA*)gw;
+		size_t module_count = VECTOR_size(gateway_handle->modules);
+		result = 0;
+		for (size_t module_index = 0; module_index < module_count; ++module_index)
+		{
+			MODULE_DATA* module_data = (MODULE_DATA*)VECTOR_element(gateway_handle->modules, module_index);
+			MESSAGE_BUS_MODULE_STATISTICS statistics;
+
+			/*Codes_SRS_GATEWAY_LL_13_013: [The function shall read the statistics of each module of GATEWAY_HANDLE_DATA's modules with MessageBus_GetStatistics and pass them to callback along with the module's name.]*/
+			if (MessageBus_GetStatistics(gateway_handle->bus, module_data->module, &statistics) != MESSAGE_BUS_OK)
+			{
+				/*Codes_SRS_GATEWAY_LL_13_014: [If the statistics of a module cannot be read, the function shall skip the module and return a non-zero value.]*/
+				LogError("Gateway_LL_GetStatistics(): MessageBus_GetStatistics failed for module '%s'.", module_data->module_name);
+				result = __LINE__;
+			}
+			else
+			{
+				callback(module_data->module_name, module_data->module, &statistics, context);
+			}
+		}
+	}
+
+	return result;
+}
 
-static MODULE_HANDLE gateway_addmodule_internal(GATEWAY_HANDLE_DATA* gateway_handle, const char* module_path, const void* module_configuration)
+int Gateway_LL_GetStartupTimes(GATEWAY_HANDLE gw, GATEWAY_STARTUP_TIMES_CALLBACK callback, void* context)
 {
-	MODULE_HANDLE module_result;
-	if (module_path != NULL)
+	int result;
+
+	/*Codes_SRS_GATEWAY_LL_13_024: [If gw or callback is NULL the function shall return a non-zero value.]*/
+	if (gw == NULL || callback == NULL)
+	{
+		result = __LINE__;
+		LogError("Gateway_LL_GetStartupTimes(): invalid arg. gw = %p, callback = %p.", gw, callback);
+	}
+	else
 	{
-		/*Codes_SRS_GATEWAY_LL_14_012: [The function shall load the module located at GATEWAY_PROPERTIES_ENTRY's module_path into a MODULE_LIBRARY_HANDLE. ]*/
-		MODULE_LIBRARY_HANDLE module_library_handle = ModuleLoader_Load(module_path);
-		/*Codes_SRS_GATEWAY_LL_14_031: [If unsuccessful, the function shall return NULL.]*/
-		if (module_library_handle == NULL)
+		GATEWAY_HANDLE_DATA* gateway_handle = (GATEWAY_HANDLE_DATA*)gw;
+		size_t module_count = VECTOR_size(gateway_handle->modules);
+		for (size_t module_index = 0; module_index < module_count; ++module_index)
 		{
-			module_result = NULL;
-			LogError("Failed to add module because the module located at [%s] could not be loaded.", module_path);
+			MODULE_DATA* module_data = (MODULE_DATA*)VECTOR_element(gateway_handle->modules, module_index);
+			/*Codes_SRS_GATEWAY_LL_13_025: [The function shall pass the startup times of each module of GATEWAY_HANDLE_DATA's modules to callback along with the module's name, and return 0.]*/
+			callback(module_data->module_name, module_data->module, &module_data->startup_times, context);
 		}
-		else
+		result = 0;
+	}
+
+	return result;
+}
+
+/*checks that the entries can replace the modules of the gateway before Gateway_LL_Update changes anything*/
+static int gateway_update_check_entries(VECTOR_HANDLE entries, size_t entries_count)
+{
+	int result = 0;
+	for (size_t entry_index = 0; entry_index < entries_count && result == 0; ++entry_index)
+	{
+		GATEWAY_PROPERTIES_ENTRY* entry = (GATEWAY_PROPERTIES_ENTRY*)VECTOR_element(entries, entry_index);
+		size_t dependency_count = (entry->depends_on == NULL) ? 0 : VECTOR_size(entry->depends_on);
+		size_t other_index;
+
+		if (entry->module_name == NULL || entry->module_path == NULL)
+		{
+			result = __LINE__;
+			LogError("Gateway_LL_Update(): every module needs a name and a path.");
+		}
+		for (other_index = 0; other_index < entry_index && result == 0; ++other_index)
+		{
+			GATEWAY_PROPERTIES_ENTRY* other = (GATEWAY_PROPERTIES_ENTRY*)VECTOR_element(entries, other_index);
+			if (strcmp(other->module_name, entry->module_name) == 0)
+			{
+				result = __LINE__;
+				LogError("Gateway_LL_Update(): there is more than one module named '%s'.", entry->module_name);
+			}
+		}
+		for (size_t dependency_index = 0; dependency_index < dependency_count && result == 0; ++dependency_index)
+		{
+			const char* dependency_name = *(const char**)VECTOR_element(entry->depends_on, dependency_index);
+			for (other_index = 0; other_index < entries_count; ++other_index)
+			{
+				GATEWAY_PROPERTIES_ENTRY* other = (GATEWAY_PROPERTIES_ENTRY*)VECTOR_element(entries, other_index);
+				if (dependency_name != NULL && other->module_name != NULL && strcmp(other->module_name, dependency_name) == 0)
+				{
+					break;
+				}
+			}
+			if (other_index == entries_count)
+			{
+				result = __LINE__;
+				LogError("Gateway_LL_Update(): module '%s' depends on '%s', which is not a module of the gateway.", entry->module_name, dependency_name);
+			}
+		}
+	}
+	return result;
+}
+
+/*tells whether the module was added from an entry equal to this one, in which case Gateway_LL_Update keeps it running*/
+static bool module_data_matches_entry(const MODULE_DATA* module_data, const GATEWAY_PROPERTIES_ENTRY* entry)
+{
+	return module_data->module_described &&
+		strcmp(module_data->module_path, entry->module_path) == 0 &&
+		module_data->module_queue.capacity == entry->module_queue.capacity &&
+		module_data->module_queue.policy == entry->module_queue.policy &&
+		module_data->module_queue.timeout_ms == entry->module_queue.timeout_ms &&
+		((entry->module_configuration == NULL) ?
+			(module_data->module_configuration == NULL) :
+			(module_data->module_configuration != NULL &&
+			module_data->module_configuration_size == entry->module_configuration_size &&
+			memcmp(module_data->module_configuration, entry->module_configuration, entry->module_configuration_size) == 0));
+}
+
+static GATEWAY_PROPERTIES_ENTRY* gateway_entries_find_by_name(VECTOR_HANDLE entries, size_t entries_count, const char* module_name)
+{
+	GATEWAY_PROPERTIES_ENTRY* result = NULL;
+	for (size_t entry_index = 0; entry_index < entries_count && result == NULL; ++entry_index)
+	{
+		GATEWAY_PROPERTIES_ENTRY* entry = (GATEWAY_PROPERTIES_ENTRY*)VECTOR_element(entries, entry_index);
+		if (strcmp(entry->module_name, module_name) == 0)
 		{
-			//Should always be a safe call.
-			/*Codes_SRS_GATEWAY_LL_14_013: [The function shall get the const MODULE_APIS* from the MODULE_LIBRARY_HANDLE.]*/
-			const MODULE_APIS* module_apis = ModuleLoader_GetModuleAPIs(module_library_handle);
+			result = entry;
+		}
+	}
+	return result;
+}
 
-			/*Codes_SRS_GATEWAY_LL_14_015: [The function shall use the MODULE_APIS to create a MODULE_HANDLE using the GATEWAY_PROPERTIES_ENTRY's module_configuration. ]*/
-			MODULE_HANDLE module_handle = module_apis->Module_Create(gateway_handle->bus, module_configuration);
-			/*Codes_SRS_GATEWAY_LL_14_016: [If the module_handle creation is unsuccessful, the function shall return NULL.]*/
-			if (module_handle == NULL)
+/*marks the named modules Gateway_LL_Update removes: those without an entry, those whose entry changed and those whose entry depends on a module it removes*/
+static void gateway_update_mark_removed(GATEWAY_HANDLE_DATA* gateway_handle, VECTOR_HANDLE entries, size_t entries_count)
+{
+	size_t module_count = VECTOR_size(gateway_handle->modules);
+	size_t module_index;
+	bool marked_any = true;
+
+	for (module_index = 0; module_index < module_count; ++module_index)
+	{
+		MODULE_DATA* module_data = (MODULE_DATA*)VECTOR_element(gateway_handle->modules, module_index);
+		GATEWAY_PROPERTIES_ENTRY* entry = (module_data->module_name == NULL) ? NULL : gateway_entries_find_by_name(entries, entries_count, module_data->module_name);
+		module_data->update_removed = module_data->module_name != NULL && (entry == NULL || !module_data_matches_entry(module_data, entry));
+	}
+
+	/*a dependency can be marked after its dependents, so go on until nothing new is marked*/
+	while (marked_any)
+	{
+		marked_any = false;
+		for (module_index = 0; module_index < module_count; ++module_index)
+		{
+			MODULE_DATA* module_data = (MODULE_DATA*)VECTOR_element(gateway_handle->modules, module_index);
+			if (module_data->module_name != NULL && !module_data->update_removed)
 			{
-				module_result = NULL;
-				ModuleLoader_Unload(module_library_handle);
-				LogError("Module_Create failed.");
+				GATEWAY_PROPERTIES_ENTRY* entry = gateway_entries_find_by_name(entries, entries_count, module_data->module_name);
+				size_t dependency_count = (entry->depends_on == NULL) ? 0 : VECTOR_size(entry->depends_on);
+				for (size_t dependency_index = 0; dependency_index < dependency_count && !module_data->update_removed; ++dependency_index)
+				{
+					MODULE_DATA* dependency = module_data_find_by_name(gateway_handle, *(const char**)VECTOR_element(entry->depends_on, dependency_index));
+					if (dependency != NULL && dependency->update_removed)
+					{
+						module_data->update_removed = true;
+						marked_any = true;
+					}
+				}
 			}
-			else
+		}
+	}
+}
+
+/*adds the modules of the entries that are not on the gateway, each once the modules it depends on are*/
+static int gateway_update_add_modules(GATEWAY_HANDLE_DATA* gateway_handle, VECTOR_HANDLE entries, size_t entries_count)
+{
+	int result = 0;
+	bool added_any = true;
+	bool pending_any = true;
+	while (result == 0 && pending_any && added_any)
+	{
+		added_any = false;
+		pending_any = false;
+		for (size_t entry_index = 0; entry_index < entries_count && result == 0; ++entry_index)
+		{
+			GATEWAY_PROPERTIES_ENTRY* entry = (GATEWAY_PROPERTIES_ENTRY*)VECTOR_element(entries, entry_index);
+			if (module_data_find_by_name(gateway_handle, entry->module_name) == NULL)
 			{
-				MODULE_C_STYLE module_c =
+				size_t dependency_count = (entry->depends_on == NULL) ? 0 : VECTOR_size(entry->depends_on);
+				size_t dependency_index = 0;
+				while (dependency_index < dependency_count &&
+					module_data_find_by_name(gateway_handle, *(const char**)VECTOR_element(entry->depends_on, dependency_index)) != NULL)
 				{
-					module_apis,
-					module_handle
-				};
+					dependency_index++;
+				}
 
-				MODULE module = 
+				if (dependency_index < dependency_count)
+				{
+					pending_any = true;
+				}
+				else if (gateway_addmodule_internal(gateway_handle, entry) == NULL)
+				{
+					result = __LINE__;
+					LogError("Gateway_LL_Update(): Unable to add module '%s'.", entry->module_name);
+				}
+				else
 				{
-					NATIVE_C_TYPE,
-					(MODULE_DATA_TYPED)&module_c
-				};
+					added_any = true;
+				}
+			}
+		}
+	}
+
+	if (result == 0 && pending_any)
+	{
+		result = __LINE__;
+		LogError("Gateway_LL_Update(): the dependencies of the modules have a cycle.");
+	}
+	return result;
+}
+
+int Gateway_LL_Update(GATEWAY_HANDLE gw, const GATEWAY_PROPERTIES* properties)
+{
+	int result;
+
+	/*Codes_SRS_GATEWAY_LL_13_038: [If gw, properties or properties's gateway_properties_entries is NULL the function shall return a non-zero value.]*/
+	if (gw == NULL || properties == NULL || properties->gateway_properties_entries == NULL)
+	{
+		result = __LINE__;
+		LogError("Gateway_LL_Update(): invalid arg. gw = %p, properties = %p.", gw, properties);
+	}
+	else
+	{
+		GATEWAY_HANDLE_DATA* gateway_handle = (GATEWAY_HANDLE_DATA*)gw;
+		VECTOR_HANDLE entries = properties->gateway_properties_entries;
+		size_t entries_count = VECTOR_size(entries);
 
-				/*Codes_SRS_GATEWAY_LL_14_017: [The function shall link the module to the GATEWAY_HANDLE_DATA's bus using a call to MessageBus_AddModule. ]*/
-				/*Codes_SRS_GATEWAY_LL_14_018: [If the message bus linking is unsuccessful, the function shall return NULL.]*/
-				if (MessageBus_AddModule(gateway_handle->bus, &module) != MESSAGE_BUS_OK)
+		/*Codes_SRS_GATEWAY_LL_13_039: [The function shall return a non-zero value without changing the gateway if an entry has no module_name or no module_path, if two entries have the same module_name, or if an entry depends on a name that is not the module_name of an entry.]*/
+		if (gateway_update_check_entries(entries, entries_count) != 0)
+		{
+			result = __LINE__;
+		}
+		else
+		{
+			size_t module_index = VECTOR_size(gateway_handle->modules);
+			size_t link_index;
+
+			/*Codes_SRS_GATEWAY_LL_13_040: [The function shall remove, in the reverse order they were added and as Gateway_LL_RemoveModule does, the named modules of the gateway that have no entry of the same module_name, or whose entry has a module_path, module_queue or module_configuration other than the ones the module was added with.]*/
+			/*Codes_SRS_GATEWAY_LL_13_049: [The function shall also remove the named modules whose entry depends, directly or through other entries, on a module it removes, so that they are created again after it.]*/
+			gateway_update_mark_removed(gateway_handle, entries, entries_count);
+			while (module_index-- > 0)
+			{
+				MODULE_DATA* module_data = (MODULE_DATA*)VECTOR_element(gateway_handle->modules, module_index);
+				if (module_data->update_removed)
 				{
-					module_result = NULL;
-					LogError("Failed to add module to the gateway bus.");
+					gateway_removemodule_internal(gateway_handle, module_data, 0, NULL);
 				}
-				else 
+			}
+
+			/*Codes_SRS_GATEWAY_LL_13_041: [The function shall remove, as Gateway_LL_RemoveLink does, the links of GATEWAY_HANDLE_DATA's links that are not in properties's gateway_links.]*/
+			link_index = (gateway_handle->links == NULL) ? 0 : VECTOR_size(gateway_handle->links);
+			while (link_index-- > 0)
+			{
+				GATEWAY_LINK_ENTRY* link_entry = (GATEWAY_LINK_ENTRY*)VECTOR_element(gateway_handle->links, link_index);
+				if (!gateway_links_contain(properties->gateway_links, link_entry))
 				{
-					/*Codes_SRS_GATEWAY_LL_14_039: [ The function shall increment the MESSAGE_BUS_HANDLE reference count if the MODULE_HANDLE was successfully linked to the GATEWAY_HANDLE_DATA's bus. ]*/
-					MessageBus_IncRef(gateway_handle->bus);
-					/*Codes_SRS_GATEWAY_LL_14_029: [The function shall create a new MODULE_DATA containting the MODULE_HANDLE and MODULE_LIBRARY_HANDLE if the module was successfully linked to the message bus.]*/
-					MODULE_DATA module_data = 
-					{
-						module_library_handle,
-						module_handle
-					};
-					/*Codes_SRS_GATEWAY_LL_14_032: [The function shall add the new MODULE_DATA to GATEWAY_HANDLE_DATA's modules if the module was successfully linked to the message bus. ]*/
-					if (VECTOR_push_back(gateway_handle->modules, &module_data, 1) != 0)
-					{
-						MessageBus_DecRef(gateway_handle->bus);
-						module_result = NULL;
-						if (MessageBus_RemoveModule(gateway_handle->bus, module_handle) != MESSAGE_BUS_OK)
-						{
-							LogError("Failed to remove module [%p] from the gateway message bus. This module will remain linked.", module_handle);
-						}
-						LogError("Unable to add MODULE_DATA* to the gateway module vector.");
-					}
-					else
-					{
-						/*Codes_SRS_GATEWAY_LL_14_019: [The function shall return the newly created MODULE_HANDLE only if each API call returns successfully.]*/
-						module_result = module_handle;
-					}
+					Gateway_LL_RemoveLink(gw, link_entry);
 				}
+			}
 
-				/*Codes_SRS_GATEWAY_LL_14_030: [If any internal API call is unsuccessful after a module is created, the library will be unloaded and the module destroyed.]*/
-				if (module_result == NULL)
+			/*Codes_SRS_GATEWAY_LL_13_042: [The function shall add, as Gateway_LL_AddModule does, the module of every entry whose module_name is not the name of a module of the gateway, once the modules it depends on are on the gateway.]*/
+			/*Codes_SRS_GATEWAY_LL_13_043: [If a module cannot be added, or the entries left to add depend on each other, the function shall return a non-zero value, leaving the gateway with the modules updated so far.]*/
+			if (gateway_update_add_modules(gateway_handle, entries, entries_count) != 0)
+			{
+				result = __LINE__;
+			}
+			else
+			{
+				size_t link_count = (properties->gateway_links == NULL) ? 0 : VECTOR_size(properties->gateway_links);
+				result = 0;
+				/*Codes_SRS_GATEWAY_LL_13_044: [The function shall add, as Gateway_LL_AddLink does, the links of properties's gateway_links that are not in GATEWAY_HANDLE_DATA's links, and return a non-zero value if one cannot be added.]*/
+				for (link_index = 0; link_index < link_count && result == 0; ++link_index)
 				{
-					module_apis->Module_Destroy(module_handle);
-					ModuleLoader_Unload(module_library_handle);
+					GATEWAY_LINK_ENTRY* link_entry = (GATEWAY_LINK_ENTRY*)VECTOR_element(properties->gateway_links, link_index);
+					if (!link_data_find(gateway_handle, link_entry, NULL) && Gateway_LL_AddLink(gw, link_entry) != 0)
+					{
+						result = __LINE__;
+						LogError("Gateway_LL_Update(): Unable to add link from '%s' to '%s'.", link_entry->module_source, link_entry->module_sink);
+					}
 				}
+				/*Codes_SRS_GATEWAY_LL_13_045: [The function shall return 0 once the modules and links of the gateway are those of properties.]*/
 			}
 		}
 	}
-	/*Codes_SRS_GATEWAY_LL_14_011: [If gw, entry, or GATEWAY_PROPERTIES_ENTRY's module_path is NULL the function shall return NULL. ]*/
+
+	return result;
+}
+
+/*Private*/
+
+static MESSAGE_BUS_HANDLE gateway_bus_create(const GATEWAY_PROPERTIES* properties)
+{
+	MESSAGE_BUS_HANDLE result;
+	if (properties == NULL)
+	{
+		result = MessageBus_Create();
+	}
 	else
 	{
-		module_result = NULL;
-		LogError("Failed to add module because either the GATEWAY_HANDLE is NULL or the module_path string is NULL or empty. gw = %p, module_path = '%s'.", gateway_handle, module_path);
+		MESSAGE_BUS_CONFIG bus_config = properties->bus_config;
+
+		/*Codes_SRS_GATEWAY_LL_13_046: [If properties's gateway_links is not NULL and its bus_config routing is MESSAGE_BUS_ROUTING_AUTOMATIC, the function shall create a bus with MESSAGE_BUS_ROUTING_LINKS routing, so that the gateway keeps following its links when it has none left.]*/
+		if (properties->gateway_links != NULL && bus_config.routing == MESSAGE_BUS_ROUTING_AUTOMATIC)
+		{
+			bus_config.routing = MESSAGE_BUS_ROUTING_LINKS;
+		}
+
+		/*Codes_SRS_GATEWAY_LL_13_011: [If properties is not NULL and its bus_config asks for a worker pool or a routing other than MESSAGE_BUS_ROUTING_AUTOMATIC, the function shall create the message bus by calling MessageBus_Create2 with it.]*/
+		result = (bus_config.use_worker_pool || bus_config.routing != MESSAGE_BUS_ROUTING_AUTOMATIC) ?
+			MessageBus_Create2(&bus_config) :
+			MessageBus_Create();
 	}
-	return module_result;
+	return result;
 }
 
-static void gateway_removemodule_internal(GATEWAY_HANDLE_DATA* gateway_handle, MODULE_DATA* module_data)
+/*monotonic clock with a microsecond resolution the startup of the modules is measured with*/
+#if defined(WIN32)
+static uint64_t get_time_us(void)
 {
-	/*Codes_SRS_GATEWAY_LL_14_021: [ The function shall unlink module from the GATEWAY_HANDLE_DATA's bus MESSAGE_BUS_HANDLE. ]*/
-	/*Codes_SRS_GATEWAY_LL_14_022: [ If GATEWAY_HANDLE_DATA's bus cannot unlink module, the function shall log the error and continue unloading the module from the GATEWAY_HANDLE. ]*/
-	if (MessageBus_RemoveModule(gateway_handle->bus, module_data->module) != MESSAGE_BUS_OK)
+	LARGE_INTEGER counter, frequency;
+	(void)QueryPerformanceCounter(&counter);
+	(void)QueryPerformanceFrequency(&frequency);
+	return ((uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000) + ((uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000 / (uint64_t)frequency.QuadPart);
+}
+#else
+static uint64_t get_time_us(void)
+{
+	struct timespec now;
+	return (clock_gettime(CLOCK_MONOTONIC, &now) == 0) ? ((uint64_t)now.tv_sec * 1000000) + ((uint64_t)now.tv_nsec / 1000) : 0;
+}
+#endif
+
+/*loads the library of a module and creates the module, without touching the gateway, so that modules can be started concurrently*/
+static int module_start_internal(MESSAGE_BUS_HANDLE bus, const char* module_path, const void* module_configuration, MODULE_START* start)
+{
+	int result;
+	uint64_t start_us = get_time_us();
+
+	/*Codes_SRS_GATEWAY_LL_14_012: [The function shall load the module located at GATEWAY_PROPERTIES_ENTRY's module_path into a MODULE_LIBRARY_HANDLE. ]*/
+	start->module_library_handle = ModuleLoader_Load(module_path);
+	/*Codes_SRS_GATEWAY_LL_13_023: [The function shall measure how long loading the library of the module and creating the module take.]*/
+	start->startup_times.load_time_us = get_time_us() - start_us;
+	/*Codes_SRS_GATEWAY_LL_14_031: [If unsuccessful, the function shall return NULL.]*/
+	if (start->module_library_handle == NULL)
 	{
-		LogError("Failed to remove module [%p] from the message bus. This module will remain linked to the message bus but will be removed from the gateway.", module_data->module);
+		result = __LINE__;
+		LogError("Failed to add module because the module located at [%s] could not be loaded.", module_path);
 	}
-	/*Codes_SRS_GATEWAY_LL_14_038: [ The function shall decrement the MESSAGE_BUS_HANDLE reference count. ]*/
-	MessageBus_DecRef(gateway_handle->bus);
-	/*Codes_SRS_GATEWAY_LL_14_024: [ The function shall use the MODULE_DATA's module_library_handle to retrieve the MODULE_APIS and destroy module. ]*/
-	ModuleLoader_GetModuleAPIs(module_data->module_library_handle)->Module_Destroy(module_data->module);
-	/*Codes_SRS_GATEWAY_LL_14_025: [The function shall unload MODULE_DATA's module_library_handle. ]*/
-	ModuleLoader_Unload(module_data->module_library_handle);
-	/*Codes_SRS_GATEWAY_LL_14_026:[The function shall remove that MODULE_DATA from GATEWAY_HANDLE_DATA's modules. ]*/
-	VECTOR_erase(gateway_handle->modules, module_data, 1);
+	else
+	{
+		//Should always be a safe call.
+		/*Codes_SRS_GATEWAY_LL_14_013: [The function shall get the const MODULE_APIS* from the MODULE_LIBRARY_HANDLE.]*/
+		start->module_apis = ModuleLoader_GetModuleAPIs(start->module_library_handle);
+		/*Codes_SRS_GATEWAY_LL_13_047: [The function shall get the optional Module_ReceiveBatch of the module from the MODULE_LIBRARY_HANDLE and hand it to the bus with the module.]*/
+		start->module_receive_batch = ModuleLoader_GetModuleReceiveBatch(start->module_library_handle);
+
+		/*Codes_SRS_GATEWAY_LL_14_015: [The function shall use the MODULE_APIS to create a MODULE_HANDLE using the GATEWAY_PROPERTIES_ENTRY's module_configuration. ]*/
+		start_us = get_time_us();
+		start->module = start->module_apis->Module_Create(bus, module_configuration);
+		start->startup_times.create_time_us = get_time_us() - start_us;
+		/*Codes_SRS_GATEWAY_LL_14_016: [If the module_handle creation is unsuccessful, the function shall return NULL.]*/
+		if (start->module == NULL)
+		{
+			result = __LINE__;
+			ModuleLoader_Unload(start->module_library_handle);
+			start->module_library_handle = NULL;
+			LogError("Module_Create failed.");
+		}
+		else
+		{
+			result = 0;
+		}
+	}
+	return result;
 }
 
-static bool module_data_find(const void* element, const void* value)
+/*adds a started module to the bus and to the gateway's modules, destroys it if that fails*/
+/*keeps copies of the module_path and of the configuration of entry, when its size is known, so that Gateway_LL_Update can tell whether the module changed; a module that cannot be described is replaced by Gateway_LL_Update*/
+static void module_data_describe(MODULE_DATA* module_data, const GATEWAY_PROPERTIES_ENTRY* entry)
+{
+	module_data->module_queue = entry->module_queue;
+	if (entry->module_path == NULL || mallocAndStrcpy_s(&module_data->module_path, entry->module_path) != 0)
+	{
+		module_data->module_path = NULL;
+	}
+	else if (entry->module_configuration == NULL)
+	{
+		module_data->module_described = true;
+	}
+	else if (entry->module_configuration_size == 0)
+	{
+		/*a configuration of unknown size is not copied, no byte of it is known to belong to the caller*/
+	}
+	else if ((module_data->module_configuration = malloc(entry->module_configuration_size)) == NULL)
+	{
+		LogError("unable to copy the configuration of module '%s', Gateway_LL_Update will replace it.", entry->module_name);
+	}
+	else
+	{
+		(void)memcpy(module_data->module_configuration, entry->module_configuration, entry->module_configuration_size);
+		module_data->module_configuration_size = entry->module_configuration_size;
+		module_data->module_described = true;
+	}
+}
+
+static MODULE_HANDLE module_add_internal(GATEWAY_HANDLE_DATA* gateway_handle, const GATEWAY_PROPERTIES_ENTRY* entry, MODULE_START* start)
+{
+	const char* module_name = entry->module_name;
+	MODULE_HANDLE module_result;
+	MODULE_C_STYLE module_c =
+	{
+		start->module_apis,
+		start->module
+	};
+
+	MODULE module = 
+	{
+		NATIVE_C_TYPE,
+		(MODULE_DATA_TYPED)&module_c
+	};
+
+	/*Codes_SRS_GATEWAY_LL_14_017: [The function shall link the module to the GATEWAY_HANDLE_DATA's bus using a call to MessageBus_AddModuleWithReceiveBatch with GATEWAY_PROPERTIES_ENTRY's module_queue and the Module_ReceiveBatch of the module library. ]*/
+	/*Codes_SRS_GATEWAY_LL_14_018: [If the message bus linking is unsuccessful, the function shall return NULL.]*/
+	if (MessageBus_AddModuleWithReceiveBatch(gateway_handle->bus, &module, NULL, &entry->module_queue, start->module_receive_batch) != MESSAGE_BUS_OK)
+	{
+		module_result = NULL;
+		LogError("Failed to add module to the gateway bus.");
+	}
+	else 
+	{
+		/*Codes_SRS_GATEWAY_LL_14_039: [ The function shall increment the MESSAGE_BUS_HANDLE reference count if the MODULE_HANDLE was successfully linked to the GATEWAY_HANDLE_DATA's bus. ]*/
+		MessageBus_IncRef(gateway_handle->bus);
+		/*Codes_SRS_GATEWAY_LL_14_029: [The function shall create a new MODULE_DATA containting the MODULE_HANDLE and MODULE_LIBRARY_HANDLE if the module was successfully linked to the message bus.]*/
+		MODULE_DATA module_data;
+		memset(&module_data, 0, sizeof(module_data));
+		module_data.module_library_handle = start->module_library_handle;
+		module_data.module = start->module;
+		module_data.startup_times = start->startup_times;
+		/*Codes_SRS_GATEWAY_LL_13_037: [The function shall keep in the MODULE_DATA a copy of GATEWAY_PROPERTIES_ENTRY's module_path, its module_queue and, if it is NULL or module_configuration_size is not 0, of its module_configuration.]*/
+		module_data_describe(&module_data, entry);
+		/*Codes_SRS_GATEWAY_LL_13_003: [The function shall keep a copy of GATEWAY_PROPERTIES_ENTRY's module_name in the MODULE_DATA if it is not NULL.]*/
+		/*Codes_SRS_GATEWAY_LL_14_032: [The function shall add the new MODULE_DATA to GATEWAY_HANDLE_DATA's modules if the module was successfully linked to the message bus. ]*/
+		if ((module_name != NULL && mallocAndStrcpy_s(&module_data.module_name, module_name) != 0) ||
+			VECTOR_push_back(gateway_handle->modules, &module_data, 1) != 0)
+		{
+			free(module_data.module_name);
+			free(module_data.module_path);
+			free(module_data.module_configuration);
+			MessageBus_DecRef(gateway_handle->bus);
+			module_result = NULL;
+			if (MessageBus_RemoveModule(gateway_handle->bus, start->module) != MESSAGE_BUS_OK)
+			{
+				LogError("Failed to remove module [%p] from the gateway message bus. This module will remain linked.", start->module);
+			}
+			LogError("Unable to add MODULE_DATA* to the gateway module vector.");
+		}
+		else
+		{
+			/*Codes_SRS_GATEWAY_LL_14_019: [The function shall return the newly created MODULE_HANDLE only if each API call returns successfully.]*/
+			module_result = start->module;
+			start->added = true;
+		}
+	}
+
+	/*Codes_SRS_GATEWAY_LL_14_030: [If any internal API call is unsuccessful after a module is created, the library will be unloaded and the module destroyed.]*/
+	if (module_result == NULL)
+	{
+		start->module_apis->Module_Destroy(start->module);
+		ModuleLoader_Unload(start->module_library_handle);
+		start->module = NULL;
+		start->module_library_handle = NULL;
+	}
+	return module_result;
+}
+
+static MODULE_HANDLE gateway_addmodule_internal(GATEWAY_HANDLE_DATA* gateway_handle, const GATEWAY_PROPERTIES_ENTRY* entry)
+{
+	MODULE_HANDLE module_result;
+	const char* module_path = entry->module_path;
+	if (module_path != NULL)
+	{
+		MODULE_START start;
+		memset(&start, 0, sizeof(start));
+		if (module_start_internal(gateway_handle->bus, module_path, entry->module_configuration, &start) != 0)
+		{
+			module_result = NULL;
+		}
+		else
+		{
+			module_result = module_add_internal(gateway_handle, entry, &start);
+		}
+	}
+	/*Codes_SRS_GATEWAY_LL_14_011: [If gw, entry, or GATEWAY_PROPERTIES_ENTRY's module_path is NULL the function shall return NULL. ]*/
+	else
+	{
+		module_result = NULL;
+		LogError("Failed to add module because either the GATEWAY_HANDLE is NULL or the module_path string is NULL or empty. gw = %p, module_path = '%s'.", gateway_handle, module_path);
+	}
+	return module_result;
+}
+
+/*adds the modules of the entries one after another, stops at the first that cannot be added*/
+static int gateway_addmodules_internal(GATEWAY_HANDLE_DATA* gateway_handle, VECTOR_HANDLE entries, size_t entries_count)
+{
+	int result = 0;
+	for (size_t entry_index = 0; entry_index < entries_count; ++entry_index)
+	{
+		GATEWAY_PROPERTIES_ENTRY* entry = (GATEWAY_PROPERTIES_ENTRY*)VECTOR_element(entries, entry_index);
+		if (gateway_addmodule_internal(gateway_handle, entry) == NULL)
+		{
+			LogError("Gateway_LL_Create(): Unable to add module '%s'.", entry->module_name);
+			result = __LINE__;
+			break;
+		}
+	}
+	return result;
+}
+
+/*loads and creates the module of start's entry*/
+static int module_start_entry(MESSAGE_BUS_HANDLE bus, MODULE_START* start)
+{
+	int result;
+	if (start->entry->module_path == NULL)
+	{
+		result = __LINE__;
+		LogError("Failed to add module '%s' because its module_path is NULL.", start->entry->module_name);
+	}
+	else
+	{
+		result = module_start_internal(bus, start->entry->module_path, start->entry->module_configuration, start);
+	}
+	return result;
+}
+
+static void module_start_task(void* context)
+{
+	MODULE_START* start = (MODULE_START*)context;
+	GATEWAY_STARTUP* startup = start->startup;
+
+	(void)module_start_entry(startup->bus, start);
+
+	if (Lock(startup->lock) != LOCK_OK)
+	{
+		/*Codes_SRS_GATEWAY_LL_13_051: [If a task cannot lock, it shall still count its module as started and signal the condition, so that the wait for the level does not hang.]*/
+		LogError("unable to lock");
+		(void)GATEWAY_STARTUP_COUNTER_DECREMENT(startup->pending);
+		(void)Condition_Post(startup->cond);
+	}
+	else
+	{
+		if (GATEWAY_STARTUP_COUNTER_DECREMENT(startup->pending) == 0 && Condition_Post(startup->cond) != COND_OK)
+		{
+			LogError("Condition_Post failed");
+		}
+		(void)Unlock(startup->lock);
+	}
+}
+
+/*tells whether any entry depends on other modules, in which case the modules are started in the order of their dependencies*/
+static bool gateway_entries_have_dependencies(VECTOR_HANDLE entries, size_t entries_count)
+{
+	bool result = false;
+	for (size_t entry_index = 0; entry_index < entries_count && !result; ++entry_index)
+	{
+		GATEWAY_PROPERTIES_ENTRY* entry = (GATEWAY_PROPERTIES_ENTRY*)VECTOR_element(entries, entry_index);
+		result = (entry->depends_on != NULL && VECTOR_size(entry->depends_on) > 0);
+	}
+	return result;
+}
+
+/*resolves the names start's entry depends on to the indexes of the entries*/
+static int module_start_resolve_dependencies(MODULE_START* starts, size_t starts_count, MODULE_START* start)
+{
+	int result;
+	size_t dependency_count = (start->entry->depends_on == NULL) ? 0 : VECTOR_size(start->entry->depends_on);
+	if (dependency_count == 0)
+	{
+		result = 0;
+	}
+	else if ((start->dependencies = (size_t*)malloc(dependency_count * sizeof(size_t))) == NULL)
+	{
+		result = __LINE__;
+		LogError("Gateway_LL_Create(): malloc failed.");
+	}
+	else
+	{
+		result = 0;
+		for (size_t dependency_index = 0; dependency_index < dependency_count && result == 0; ++dependency_index)
+		{
+			const char* dependency_name = *(const char**)VECTOR_element(start->entry->depends_on, dependency_index);
+			size_t start_index = 0;
+			while (start_index < starts_count &&
+				(dependency_name == NULL || starts[start_index].entry->module_name == NULL || strcmp(starts[start_index].entry->module_name, dependency_name) != 0))
+			{
+				start_index++;
+			}
+
+			if (start_index == starts_count)
+			{
+				/*Codes_SRS_GATEWAY_LL_13_027: [If an entry depends on a name that is not the module_name of an entry, or the dependencies of the entries have a cycle, the function shall destroy the GATEWAY_HANDLE without starting any module.]*/
+				result = __LINE__;
+				LogError("Gateway_LL_Create(): module '%s' depends on '%s', which is not a module of the gateway.", start->entry->module_name, dependency_name);
+			}
+			else
+			{
+				start->dependencies[start->dependency_count++] = start_index;
+			}
+		}
+	}
+	return result;
+}
+
+/*gives every module a level one above the highest level of the modules it depends on, fails if the dependencies have a cycle*/
+static int module_starts_level(MODULE_START* starts, size_t starts_count, size_t* level_count)
+{
+	int result;
+	size_t leveled_count = 0;
+	bool leveled_any = true;
+	size_t start_index;
+
+	for (start_index = 0; start_index < starts_count; ++start_index)
+	{
+		starts[start_index].level = MODULE_START_NO_LEVEL;
+	}
+
+	*level_count = 0;
+	while (leveled_count < starts_count && leveled_any)
+	{
+		leveled_any = false;
+		for (start_index = 0; start_index < starts_count; ++start_index)
+		{
+			MODULE_START* start = &starts[start_index];
+			if (start->level == MODULE_START_NO_LEVEL)
+			{
+				size_t level = 0;
+				size_t dependency_index;
+				for (dependency_index = 0; dependency_index < start->dependency_count; ++dependency_index)
+				{
+					size_t dependency_level = starts[start->dependencies[dependency_index]].level;
+					if (dependency_level == MODULE_START_NO_LEVEL)
+					{
+						break;
+					}
+					else if (dependency_level + 1 > level)
+					{
+						level = dependency_level + 1;
+					}
+				}
+
+				if (dependency_index == start->dependency_count)
+				{
+					start->level = level;
+					if (level + 1 > *level_count)
+					{
+						*level_count = level + 1;
+					}
+					leveled_count++;
+					leveled_any = true;
+				}
+			}
+		}
+	}
+
+	if (leveled_count < starts_count)
+	{
+		/*Codes_SRS_GATEWAY_LL_13_027: [If an entry depends on a name that is not the module_name of an entry, or the dependencies of the entries have a cycle, the function shall destroy the GATEWAY_HANDLE without starting any module.]*/
+		result = __LINE__;
+		LogError("Gateway_LL_Create(): the dependencies of the modules have a cycle.");
+	}
+	else
+	{
+		result = 0;
+	}
+	return result;
+}
+
+static void module_starts_destroy(MODULE_START* starts, size_t starts_count)
+{
+	for (size_t start_index = 0; start_index < starts_count; ++start_index)
+	{
+		free(starts[start_index].dependencies);
+	}
+	free(starts);
+}
+
+/*prepares a MODULE_START for every entry, NULL if the dependencies of the entries cannot be resolved*/
+static MODULE_START* module_starts_create(VECTOR_HANDLE entries, size_t entries_count, size_t* level_count)
+{
+	MODULE_START* starts = (MODULE_START*)malloc(entries_count * sizeof(MODULE_START));
+	if (starts == NULL)
+	{
+		LogError("Gateway_LL_Create(): malloc failed.");
+	}
+	else
+	{
+		size_t entry_index;
+		int result = 0;
+		memset(starts, 0, entries_count * sizeof(MODULE_START));
+		for (entry_index = 0; entry_index < entries_count; ++entry_index)
+		{
+			starts[entry_index].entry = (GATEWAY_PROPERTIES_ENTRY*)VECTOR_element(entries, entry_index);
+		}
+		for (entry_index = 0; entry_index < entries_count && result == 0; ++entry_index)
+		{
+			result = module_start_resolve_dependencies(starts, entries_count, &starts[entry_index]);
+		}
+
+		if (result != 0 || module_starts_level(starts, entries_count, level_count) != 0)
+		{
+			module_starts_destroy(starts, entries_count);
+			starts = NULL;
+		}
+	}
+	return starts;
+}
+
+/*loads, creates and adds the modules of a level one after another*/
+static int module_starts_add_level(GATEWAY_HANDLE_DATA* gateway_handle, MODULE_START* starts, size_t starts_count, size_t level)
+{
+	int result = 0;
+	for (size_t start_index = 0; start_index < starts_count && result == 0; ++start_index)
+	{
+		MODULE_START* start = &starts[start_index];
+		if (start->level == level &&
+			(module_start_entry(gateway_handle->bus, start) != 0 ||
+			module_add_internal(gateway_handle, start->entry, start) == NULL))
+		{
+			LogError("Gateway_LL_Create(): Unable to add module '%s'.", start->entry->module_name);
+			result = __LINE__;
+		}
+	}
+	return result;
+}
+
+/*loads and creates the modules of a level on the worker pool, then adds them in the order of their entries; when waiting for the tasks fails the pool is destroyed and *pool set to NULL*/
+static int module_starts_add_level_parallel(GATEWAY_HANDLE_DATA* gateway_handle, WORKER_POOL_HANDLE* pool, GATEWAY_STARTUP* startup, MODULE_START* starts, size_t starts_count, size_t level)
+{
+	int result;
+	size_t start_index;
+	size_t level_count;
+	bool waited;
+
+	/*the tasks of the previous level have all been waited for, so pending can be set without the lock*/
+	level_count = 0;
+	for (start_index = 0; start_index < starts_count; ++start_index)
+	{
+		if (starts[start_index].level == level)
+		{
+			level_count++;
+		}
+	}
+	GATEWAY_STARTUP_COUNTER_SET(startup->pending, level_count);
+
+	for (start_index = 0; start_index < starts_count; ++start_index)
+	{
+		MODULE_START* start = &starts[start_index];
+		if (start->level == level)
+		{
+			start->startup = startup;
+			start->task.function = module_start_task;
+			start->task.context = start;
+			if (WorkerPool_Schedule(*pool, &start->task) != WORKER_POOL_OK)
+			{
+				/*Codes_SRS_GATEWAY_LL_13_022: [If a module cannot be scheduled on the worker pool, the function shall load and create it on the calling thread.]*/
+				LogError("Gateway_LL_Create(): WorkerPool_Schedule failed, module '%s' is started on this thread.", start->entry->module_name);
+				module_start_task(start);
+			}
+		}
+	}
+
+	/*Codes_SRS_GATEWAY_LL_13_018: [The function shall wait for every module of a level to be loaded and created before adding any of them to the bus.]*/
+	waited = false;
+	if (Lock(startup->lock) != LOCK_OK)
+	{
+		LogError("unable to lock");
+	}
+	else
+	{
+		waited = true;
+		/*a task that could not lock signals without the lock, so its wake-up can be missed; the wait is timed to look at pending again*/
+		while (GATEWAY_STARTUP_COUNTER_GET(startup->pending) > 0)
+		{
+			if (Condition_Wait(startup->cond, startup->lock, GATEWAY_STARTUP_WAIT_MS) == COND_ERROR)
+			{
+				LogError("Condition_Wait failed");
+				waited = false;
+				break;
+			}
+		}
+		(void)Unlock(startup->lock);
+	}
+
+	if (!waited)
+	{
+		/*Codes_SRS_GATEWAY_LL_13_048: [If locking or waiting for the modules of a level fails, the function shall destroy the worker pool, so that no task is running any more, and fail without adding any module of the level.]*/
+		WorkerPool_Destroy(*pool);
+		*pool = NULL;
+		result = __LINE__;
+	}
+	else
+	{
+		/*Codes_SRS_GATEWAY_LL_13_019: [The function shall add the created modules of a level to the bus and to GATEWAY_HANDLE_DATA's modules in the order of their entries, as Gateway_LL_AddModule does.]*/
+		result = 0;
+		for (start_index = 0; start_index < starts_count && result == 0; ++start_index)
+		{
+			MODULE_START* start = &starts[start_index];
+			if (start->level == level &&
+				(start->module == NULL ||
+				module_add_internal(gateway_handle, start->entry, start) == NULL))
+			{
+				LogError("Gateway_LL_Create(): Unable to add module '%s'.", start->entry->module_name);
+				result = __LINE__;
+			}
+		}
+	}
+
+	/*Codes_SRS_GATEWAY_LL_13_020: [If any module cannot be loaded, created or added to the bus, the function shall destroy the modules that were created but not added in the reverse order of their entries, then destroy the GATEWAY_HANDLE.]*/
+	start_index = starts_count;
+	while (start_index-- > 0)
+	{
+		MODULE_START* start = &starts[start_index];
+		if (start->level == level && start->module != NULL && !start->added)
+		{
+			start->module_apis->Module_Destroy(start->module);
+			ModuleLoader_Unload(start->module_library_handle);
+		}
+	}
+	return result;
+}
+
+/*loads, creates and adds the modules of the entries level by level, so that a module is only created once the modules it depends on are on the bus*/
+static int gateway_addmodules_graph_internal(GATEWAY_HANDLE_DATA* gateway_handle, VECTOR_HANDLE entries, size_t entries_count, const GATEWAY_STARTUP_CONFIG* startup_config)
+{
+	int result;
+	size_t level_count;
+	MODULE_START* starts = module_starts_create(entries, entries_count, &level_count);
+	if (starts == NULL)
+	{
+		result = __LINE__;
+	}
+	else
+	{
+		GATEWAY_STARTUP startup;
+		WORKER_POOL_HANDLE pool = NULL;
+		size_t level;
+
+		startup.bus = gateway_handle->bus;
+		GATEWAY_STARTUP_COUNTER_SET(startup.pending, 0);
+		startup.lock = NULL;
+		startup.cond = NULL;
+		if (startup_config != NULL)
+		{
+			size_t thread_count = (startup_config->thread_count == 0 || startup_config->thread_count > entries_count) ?
+				entries_count :
+				startup_config->thread_count;
+			startup.lock = Lock_Init();
+			startup.cond = (startup.lock == NULL) ? NULL : Condition_Init();
+			/*Codes_SRS_GATEWAY_LL_13_050: [The function shall create the worker pool by calling WorkerPool_CreateWithThreadExit with MessagePool_ReleaseThreadCache, so that the message blocks cached by its threads are not lost.]*/
+			pool = (startup.cond == NULL) ? NULL : WorkerPool_CreateWithThreadExit(thread_count, MessagePool_ReleaseThreadCache);
+			if (pool == NULL)
+			{
+				/*Codes_SRS_GATEWAY_LL_13_021: [If the worker pool, its lock or its condition cannot be created, the function shall load, create and add the modules one after another instead.]*/
+				LogError("Gateway_LL_Create(): unable to create the startup worker pool, the modules are started one after another.");
+			}
+		}
+
+		/*Codes_SRS_GATEWAY_LL_13_026: [If an entry depends on other modules, the function shall start the modules level by level, a module's level being one above the highest level of the modules it depends on, and add every module of a level to the bus before creating those of the next level.]*/
+		result = 0;
+		for (level = 0; level < level_count && result == 0; ++level)
+		{
+			result = (pool == NULL) ?
+				module_starts_add_level(gateway_handle, starts, entries_count, level) :
+				module_starts_add_level_parallel(gateway_handle, &pool, &startup, starts, entries_count, level);
+		}
+
+		if (pool != NULL)
+		{
+			WorkerPool_Destroy(pool);
+		}
+		if (startup.cond != NULL)
+		{
+			Condition_Deinit(startup.cond);
+		}
+		if (startup.lock != NULL)
+		{
+			(void)Lock_Deinit(startup.lock);
+		}
+		module_starts_destroy(starts, entries_count);
+	}
+	return result;
+}
+
+static void gateway_destroy_internal(GATEWAY_HANDLE_DATA* gateway_handle, uint64_t drain_deadline_us, MESSAGE_BUS_DRAIN_RESULT* drain_result)
+{
+	/*Codes_SRS_GATEWAY_LL_14_028: [The function shall remove each module in GATEWAY_HANDLE_DATA's modules vector and destroy GATEWAY_HANDLE_DATA's modules.]*/
+	/*Codes_SRS_GATEWAY_LL_13_029: [The function shall remove the modules in the reverse order they were added, so that a module is removed before the modules it depends on.]*/
+	while (gateway_handle->modules != NULL && VECTOR_size(gateway_handle->modules) > 0)
+	{
+		MODULE_DATA* module_data = (MODULE_DATA*)VECTOR_back(gateway_handle->modules);
+		//By design, there will be no NULL module_data pointers in the vector
+		/*Codes_SRS_GATEWAY_LL_14_037: [If GATEWAY_HANDLE_DATA's message bus cannot unlink module, the function shall log the error and continue unloading the module from the GATEWAY_HANDLE. ]*/
+		gateway_removemodule_internal(gateway_handle, module_data, drain_deadline_us, drain_result);
+	}
+
+	VECTOR_destroy(gateway_handle->modules);
+	link_data_destroy(gateway_handle);
+
+	/*Codes_SRS_GATEWAY_LL_14_006: [The function shall destroy the GATEWAY_HANDLE_DATA's `bus` `MESSAGE_BUS_HANDLE`. ]*/
+	MessageBus_Destroy(gateway_handle->bus);
+
+	free(gateway_handle);
+}
+
+/*removes the module from the bus; when drain_result is not NULL the queue of the module is drained until drain_deadline_us and what was delivered and dropped is added to drain_result*/
+static MESSAGE_BUS_RESULT gateway_bus_removemodule(GATEWAY_HANDLE_DATA* gateway_handle, MODULE_DATA* module_data, uint64_t drain_deadline_us, MESSAGE_BUS_DRAIN_RESULT* drain_result)
+{
+	MESSAGE_BUS_RESULT result;
+	if (drain_result == NULL)
+	{
+		result = MessageBus_RemoveModule(gateway_handle->bus, module_data->module);
+	}
+	else
+	{
+		MESSAGE_BUS_DRAIN_RESULT module_drain_result = { 0, 0 };
+		uint64_t now_us = get_time_us();
+		/*once the deadline has passed the queued messages are still counted, as dropped*/
+		unsigned int drain_timeout_ms = (drain_deadline_us > now_us) ? (unsigned int)((drain_deadline_us - now_us + 999) / 1000) : 0;
+
+		result = MessageBus_RemoveModuleWithDrain(gateway_handle->bus, module_data->module, drain_timeout_ms, &module_drain_result);
+		drain_result->delivered += module_drain_result.delivered;
+		drain_result->dropped += module_drain_result.dropped;
+
+		/*Codes_SRS_GATEWAY_LL_13_032: [The function shall log the name of every module whose queued messages could not all be delivered in time, with the number of messages dropped.]*/
+		if (module_drain_result.dropped > 0)
+		{
+			LogError("Module [%s] was removed with %zu queued messages not delivered.", (module_data->module_name == NULL) ? "" : module_data->module_name, module_drain_result.dropped);
+		}
+	}
+	return result;
+}
+
+static void gateway_removemodule_internal(GATEWAY_HANDLE_DATA* gateway_handle, MODULE_DATA* module_data, uint64_t drain_deadline_us, MESSAGE_BUS_DRAIN_RESULT* drain_result)
+{
+	/*Codes_SRS_GATEWAY_LL_14_021: [ The function shall unlink module from the GATEWAY_HANDLE_DATA's bus MESSAGE_BUS_HANDLE. ]*/
+	/*Codes_SRS_GATEWAY_LL_14_022: [ If GATEWAY_HANDLE_DATA's bus cannot unlink module, the function shall log the error and continue unloading the module from the GATEWAY_HANDLE. ]*/
+	if (gateway_bus_removemodule(gateway_handle, module_data, drain_deadline_us, drain_result) != MESSAGE_BUS_OK)
+	{
+		LogError("Failed to remove module [%p] from the message bus. This module will remain linked to the message bus but will be removed from the gateway.", module_data->module);
+	}
+	/*Codes_SRS_GATEWAY_LL_14_038: [ The function shall decrement the MESSAGE_BUS_HANDLE reference count. ]*/
+	MessageBus_DecRef(gateway_handle->bus);
+	/*Codes_SRS_GATEWAY_LL_14_024: [ The function shall use the MODULE_DATA's module_library_handle to retrieve the MODULE_APIS and destroy module. ]*/
+	/*Codes_SRS_GATEWAY_LL_13_016: [If MODULE_DATA's module_library_handle is NULL the module belongs to the caller of Gateway_LL_Create2 and the function shall neither destroy it nor unload a library.]*/
+	if (module_data->module_library_handle != NULL)
+	{
+		ModuleLoader_GetModuleAPIs(module_data->module_library_handle)->Module_Destroy(module_data->module);
+		/*Codes_SRS_GATEWAY_LL_14_025: [The function shall unload MODULE_DATA's module_library_handle. ]*/
+		ModuleLoader_Unload(module_data->module_library_handle);
+	}
+	/*Codes_SRS_GATEWAY_LL_13_036: [The function shall remove the copies of the links from or to the module from GATEWAY_HANDLE_DATA's links, the bus having removed the links themselves.]*/
+	link_data_remove_module(gateway_handle, module_data->module_name);
+	free(module_data->module_name);
+	free(module_data->module_path);
+	free(module_data->module_configuration);
+	/*Codes_SRS_GATEWAY_LL_14_026:[The function shall remove that MODULE_DATA from GATEWAY_HANDLE_DATA's modules. ]*/
+	VECTOR_erase(gateway_handle->modules, module_data, 1);
+}
+
+static bool module_data_find(const void* element, const void* value)
 {
 	return ((MODULE_DATA*)element)->module == value;
-}
\ No newline at end of file
+}
+static MODULE_DATA* module_data_find_by_name(GATEWAY_HANDLE_DATA* gateway_handle, const char* module_name)
+{
+	MODULE_DATA* result = NULL;
+	size_t module_count = VECTOR_size(gateway_handle->modules);
+	for (size_t module_index = 0; module_index < module_count; ++module_index)
+	{
+		MODULE_DATA* module_data = (MODULE_DATA*)VECTOR_element(gateway_handle->modules, module_index);
+		if (module_data->module_name != NULL && strcmp(module_data->module_name, module_name) == 0)
+		{
+			result = module_data;
+			break;
+		}
+	}
+	return result;
+}
+
+static int gateway_link_to_bus_link(GATEWAY_HANDLE_DATA* gateway_handle, const GATEWAY_LINK_ENTRY* entry, MESSAGE_BUS_LINK* link)
+{
+	int result;
+	MODULE_DATA* sink = module_data_find_by_name(gateway_handle, entry->module_sink);
+	if (sink == NULL)
+	{
+		LogError("Module '%s' was not found.", entry->module_sink);
+		result = __LINE__;
+	}
+	else if (strcmp(entry->module_source, GATEWAY_LINK_ANY_SOURCE) == 0)
+	{
+		link->module_source = NULL;
+		link->module_sink = sink->module;
+		link->filter_property = entry->filter_property;
+		link->filter_value = entry->filter_value;
+		result = 0;
+	}
+	else
+	{
+		MODULE_DATA* source = module_data_find_by_name(gateway_handle, entry->module_source);
+		if (source == NULL)
+		{
+			LogError("Module '%s' was not found.", entry->module_source);
+			result = __LINE__;
+		}
+		else
+		{
+			link->module_source = source->module;
+			link->module_sink = sink->module;
+			link->filter_property = entry->filter_property;
+			link->filter_value = entry->filter_value;
+			result = 0;
+		}
+	}
+	return result;
+}
+
+static bool strings_equal(const char* left, const char* right)
+{
+	return (left == NULL) ? (right == NULL) : (right != NULL && strcmp(left, right) == 0);
+}
+
+static bool link_entries_equal(const GATEWAY_LINK_ENTRY* left, const GATEWAY_LINK_ENTRY* right)
+{
+	return strings_equal(left->module_source, right->module_source) &&
+		strings_equal(left->module_sink, right->module_sink) &&
+		strings_equal(left->filter_property, right->filter_property) &&
+		strings_equal(left->filter_value, right->filter_value);
+}
+
+static bool gateway_links_contain(VECTOR_HANDLE links, const GATEWAY_LINK_ENTRY* entry)
+{
+	bool result = false;
+	size_t link_count = (links == NULL) ? 0 : VECTOR_size(links);
+	for (size_t link_index = 0; link_index < link_count && !result; ++link_index)
+	{
+		result = link_entries_equal((const GATEWAY_LINK_ENTRY*)VECTOR_element(links, link_index), entry);
+	}
+	return result;
+}
+
+static void link_entry_free(GATEWAY_LINK_ENTRY* link_entry)
+{
+	free((char*)link_entry->module_source);
+	free((char*)link_entry->module_sink);
+	free((char*)link_entry->filter_property);
+	free((char*)link_entry->filter_value);
+}
+
+/*copies a string that may be NULL, returns 0 on success*/
+static int link_entry_copy_string(const char** destination, const char* source)
+{
+	int result;
+	char* copy = NULL;
+	if (source != NULL && mallocAndStrcpy_s(&copy, source) != 0)
+	{
+		result = __LINE__;
+	}
+	else
+	{
+		result = 0;
+	}
+	*destination = copy;
+	return result;
+}
+
+static int link_data_add(GATEWAY_HANDLE_DATA* gateway_handle, const GATEWAY_LINK_ENTRY* entry)
+{
+	int result;
+	GATEWAY_LINK_ENTRY link_entry;
+	int copy_result = link_entry_copy_string(&link_entry.module_source, entry->module_source);
+	copy_result |= link_entry_copy_string(&link_entry.module_sink, entry->module_sink);
+	copy_result |= link_entry_copy_string(&link_entry.filter_property, entry->filter_property);
+	copy_result |= link_entry_copy_string(&link_entry.filter_value, entry->filter_value);
+
+	if (copy_result != 0)
+	{
+		result = __LINE__;
+		link_entry_free(&link_entry);
+		LogError("unable to copy the link.");
+	}
+	else if (gateway_handle->links == NULL && (gateway_handle->links = VECTOR_create(sizeof(GATEWAY_LINK_ENTRY))) == NULL)
+	{
+		result = __LINE__;
+		link_entry_free(&link_entry);
+		LogError("VECTOR_create failed.");
+	}
+	else if (VECTOR_push_back(gateway_handle->links, &link_entry, 1) != 0)
+	{
+		result = __LINE__;
+		link_entry_free(&link_entry);
+		LogError("VECTOR_push_back failed.");
+	}
+	else
+	{
+		result = 0;
+	}
+	return result;
+}
+
+static bool link_data_find(GATEWAY_HANDLE_DATA* gateway_handle, const GATEWAY_LINK_ENTRY* entry, size_t* link_index)
+{
+	bool result = false;
+	size_t link_count = (gateway_handle->links == NULL) ? 0 : VECTOR_size(gateway_handle->links);
+	for (size_t index = 0; index < link_count && !result; ++index)
+	{
+		if (link_entries_equal((const GATEWAY_LINK_ENTRY*)VECTOR_element(gateway_handle->links, index), entry))
+		{
+			result = true;
+			if (link_index != NULL)
+			{
+				*link_index = index;
+			}
+		}
+	}
+	return result;
+}
+
+/*entry may be the copy being removed*/
+static void link_data_remove(GATEWAY_HANDLE_DATA* gateway_handle, const GATEWAY_LINK_ENTRY* entry)
+{
+	size_t link_index;
+	if (link_data_find(gateway_handle, entry, &link_index))
+	{
+		GATEWAY_LINK_ENTRY* link_entry = (GATEWAY_LINK_ENTRY*)VECTOR_element(gateway_handle->links, link_index);
+		link_entry_free(link_entry);
+		VECTOR_erase(gateway_handle->links, link_entry, 1);
+	}
+}
+
+static void link_data_remove_module(GATEWAY_HANDLE_DATA* gateway_handle, const char* module_name)
+{
+	if (gateway_handle->links != NULL && module_name != NULL)
+	{
+		size_t link_index = VECTOR_size(gateway_handle->links);
+		while (link_index-- > 0)
+		{
+			GATEWAY_LINK_ENTRY* link_entry = (GATEWAY_LINK_ENTRY*)VECTOR_element(gateway_handle->links, link_index);
+			if (strcmp(link_entry->module_source, module_name) == 0 || strcmp(link_entry->module_sink, module_name) == 0)
+			{
+				link_entry_free(link_entry);
+				VECTOR_erase(gateway_handle->links, link_entry, 1);
+			}
+		}
+	}
+}
+
+static void link_data_destroy(GATEWAY_HANDLE_DATA* gateway_handle)
+{
+	if (gateway_handle->links != NULL)
+	{
+		size_t link_count = VECTOR_size(gateway_handle->links);
+		for (size_t link_index = 0; link_index < link_count; ++link_index)
+		{
+			link_entry_free((GATEWAY_LINK_ENTRY*)VECTOR_element(gateway_handle->links, link_index));
+		}
+		VECTOR_destroy(gateway_handle->links);
+	}
+}
@@ -8,68 +8,416 @@
 #include "azure_c_shared_utility/gballoc.h"
 
 #include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
 #include <inttypes.h>
 
 #include "message.h"
+#include "message_pool.h"
+#include "string_intern.h"
 #include "azure_c_shared_utility/buffer_.h"
 #include "azure_c_shared_utility/map.h"
 #include "azure_c_shared_utility/constmap.h"
 #include "azure_c_shared_utility/iot_logging.h"
 
-#include "azure_c_shared_utility/refcount.h"
-
 #define FIRST_MESSAGE_BYTE 0xA1  /*0xA1 comes from (A)zure (I)oT*/
 #define SECOND_MESSAGE_BYTE 0x60 /*0x60 comes from (G)ateway*/
 
 #define MIN_MESSAGE_BUFFER_LENGTH 14 /*14 is the minimum message length that is still valid*/
 
+/*atomic operations on the ref count and on the lazily created property and content handles*/
+#if defined(WIN32)
+#include <windows.h>
+typedef volatile LONG MESSAGE_COUNTER;
+#define MESSAGE_COUNTER_INC(counter) InterlockedIncrement(&(counter))
+#define MESSAGE_COUNTER_DEC(counter) InterlockedDecrement(&(counter))
+#define MESSAGE_POINTER_GET(pointer) InterlockedCompareExchangePointer((PVOID volatile*)&(pointer), NULL, NULL)
+#define MESSAGE_POINTER_SET_IF_NULL(pointer, value) (InterlockedCompareExchangePointer((PVOID volatile*)&(pointer), (value), NULL) == NULL)
+#elif defined(__GNUC__)
+typedef volatile long MESSAGE_COUNTER;
+#define MESSAGE_COUNTER_INC(counter) __atomic_add_fetch(&(counter), 1, __ATOMIC_SEQ_CST)
+#define MESSAGE_COUNTER_DEC(counter) __atomic_sub_fetch(&(counter), 1, __ATOMIC_SEQ_CST)
+#define MESSAGE_POINTER_GET(pointer) __atomic_load_n(&(pointer), __ATOMIC_SEQ_CST)
+#define MESSAGE_POINTER_SET_IF_NULL(pointer, value) __sync_bool_compare_and_swap(&(pointer), NULL, (value))
+#else
+#error "messages need atomic operations on this platform"
+#endif
+
+/*an entry of the index of the properties of a message*/
+typedef struct MESSAGE_PROPERTY_INDEX_TAG
+{
+    size_t hash;
+    size_t property;
+}MESSAGE_PROPERTY_INDEX;
+
+/*
+* A message is a single block: this header, the interned names and the
+* values of its properties, the index of the properties, for the messages
+* that own a copy of their content the bytes of the content, and the
+* characters of the values.
+*/
 typedef struct MESSAGE_HANDLE_DATA_TAG
 {
+    MESSAGE_COUNTER count;
+
+    /*point into the block, every name was acquired from the string intern table and every value points after the content, or both point into byte_array*/
+    const char** keys;
+    const char** values;
+    size_t property_count;
+
+    /*
+    * the properties sorted by the hash of their names, built with the
+    * message: Message_GetProperty hashes the name it looks for once and
+    * binary searches it here, on any thread, instead of comparing it to
+    * every name
+    */
+    MESSAGE_PROPERTY_INDEX* index;
+
+    /*NULL until Message_GetProperties is called*/
     CONSTMAP_HANDLE properties;
-    CONSTBUFFER_HANDLE content;
+
+    /*points at the bytes following the properties, or into content_handle*/
+    CONSTBUFFER content;
+
+    /*NULL until Message_GetContentHandle is called, unless the message was created from a CONSTBUFFER_HANDLE*/
+    CONSTBUFFER_HANDLE content_handle;
+
+    /*set when the message adopted its content (Message_CreateAdopt), NULL otherwise*/
+    MESSAGE_CONTENT_RELEASE content_release;
+    void* content_release_context;
+
+    /*
+    * set when the message was created from a byte array it keeps
+    * (Message_CreateFromByteArrayView): the names, values and content point
+    * into it, and the message serializes to it
+    */
+    CONSTBUFFER_HANDLE byte_array;
+
+    /*
+    * set when the message was derived from another (Message_CreateDerived):
+    * the properties of the message add to or override those of parent,
+    * whose content it shares. parent is never itself derived
+    */
+    struct MESSAGE_HANDLE_DATA_TAG* parent;
 }MESSAGE_HANDLE_DATA;
 
-DEFINE_REFCOUNT_TYPE(MESSAGE_HANDLE_DATA);
+/*the bytes a message needs for each of its properties: a name, a value and an entry of the index*/
+#define MESSAGE_PROPERTY_SIZE ((2 * sizeof(const char*)) + sizeof(MESSAGE_PROPERTY_INDEX))
 
-static MESSAGE_HANDLE_DATA* Message_CreateImpl(const MESSAGE_CONFIG * cfg)
+/*
+* allocates the header of a message and room for property_count properties,
+* content_size bytes of content and values_size characters of values after
+* it, from the message pool. *values points at the room for the values
+*/
+static MESSAGE_HANDLE_DATA* message_allocate(size_t property_count, size_t content_size, size_t values_size, char** values)
 {
     MESSAGE_HANDLE_DATA* result;
-    /*Codes_SRS_MESSAGE_02_006: [Otherwise, Message_Create shall return a non-NULL handle and shall set the internal ref count to "1".]*/
-    result = REFCOUNT_TYPE_CREATE(MESSAGE_HANDLE_DATA);
-    if (result == NULL)
+    if ((property_count > (SIZE_MAX - sizeof(MESSAGE_HANDLE_DATA)) / MESSAGE_PROPERTY_SIZE) ||
+        (content_size > SIZE_MAX - sizeof(MESSAGE_HANDLE_DATA) - (MESSAGE_PROPERTY_SIZE * property_count)) ||
+        (values_size > SIZE_MAX - sizeof(MESSAGE_HANDLE_DATA) - (MESSAGE_PROPERTY_SIZE * property_count) - content_size))
     {
-        LogError("malloc returned NULL");
-        /*return as is*/
+        LogError("message too big: %zu properties, %zu bytes of content, %zu characters of values", property_count, content_size, values_size);
+        result = NULL;
+    }
+    else if ((result = (MESSAGE_HANDLE_DATA*)MessagePool_Allocate(sizeof(MESSAGE_HANDLE_DATA) + (MESSAGE_PROPERTY_SIZE * property_count) + content_size + values_size)) == NULL)
+    {
+        LogError("MessagePool_Allocate returned NULL");
     }
     else
     {
-        /*Codes_SRS_MESSAGE_02_004: [Mesages shall be allowed to be created from zero-size content.]*/
-        /*Codes_SRS_MESSAGE_02_015: [The MESSAGE_CONTENT's field size shall have the same value as the cfg's field size.]*/
-        /*Codes_SRS_MESSAGE_17_003: [Message_Create shall copy the source to a readonly CONSTBUFFER.]*/
-        result->content = CONSTBUFFER_Create(cfg->source, cfg->size);
-        if (result->content == NULL)
+        result->count = 1;
+        /*the index comes first, size_t may be more aligned than a pointer*/
+        result->index = (MESSAGE_PROPERTY_INDEX*)(result + 1);
+        result->keys = (const char**)(result->index + property_count);
+        result->values = result->keys + property_count;
+        result->property_count = 0;
+        result->properties = NULL;
+        result->content.buffer = (content_size == 0) ? NULL : (const unsigned char*)(result->values + property_count);
+        result->content.size = content_size;
+        *values = (char*)(result->values + property_count) + content_size;
+        result->content_handle = NULL;
+        result->content_release = NULL;
+        result->content_release_context = NULL;
+        result->byte_array = NULL;
+        result->parent = NULL;
+    }
+    return result;
+}
+
+/*releases the interned names of the properties of a message, their values are in the message*/
+static void message_release_properties(MESSAGE_HANDLE_DATA* message)
+{
+    size_t i;
+    for (i = 0; i < message->property_count; i++)
+    {
+        StringIntern_Release(message->keys[i]);
+    }
+    message->property_count = 0;
+}
+
+/*the characters count values take, terminators included*/
+static size_t get_values_size(const char* const* values, size_t count)
+{
+    size_t result = 0;
+    size_t i;
+    for (i = 0; i < count; i++)
+    {
+        result += strlen(values[i]) + 1;
+    }
+    return result;
+}
+
+/*
+* appends a property to a message, and inserts it in the index after the
+* properties whose names hash lower or the same. Fails if the message already
+* has a property called key, which can only be one of the names with the same
+* hash
+*/
+static int message_add_property(MESSAGE_HANDLE_DATA* message, const char* key, const char* value)
+{
+    int result;
+    size_t hash = StringIntern_Hash(key);
+    size_t position = message->property_count;
+    size_t i;
+    while ((position > 0) && (message->index[position - 1].hash > hash))
+    {
+        position--;
+    }
+
+    for (i = position; (i > 0) && (message->index[i - 1].hash == hash); i--)
+    {
+        const char* name = message->keys[message->index[i - 1].property];
+        if ((name == key) || (strcmp(name, key) == 0))
         {
-            LogError("CONSBUFFER_Create failed");
-            free(result);
-            result = NULL;
+            break;
+        }
+    }
+
+    if ((i > 0) && (message->index[i - 1].hash == hash))
+    {
+        LogError("the message already has a property called %s", key);
+        result = __LINE__;
+    }
+    else
+    {
+        (void)memmove(message->index + position + 1, message->index + position, (message->property_count - position) * sizeof(MESSAGE_PROPERTY_INDEX));
+        message->index[position].hash = hash;
+        message->index[position].property = message->property_count;
+
+        message->keys[message->property_count] = key;
+        message->values[message->property_count] = value;
+        message->property_count++;
+        result = 0;
+    }
+    return result;
+}
+
+/*
+* acquires key from the string intern table, copies value to *values and adds
+* them to a message as a property, moving *values past the copy
+*/
+static int message_add_interned_property(MESSAGE_HANDLE_DATA* message, const char* key, const char* value, char** values)
+{
+    int result;
+    const char* internedKey = StringIntern_Acquire(key);
+    if ((internedKey == NULL) || (message_add_property(message, internedKey, *values) != 0))
+    {
+        /*StringIntern_Release does nothing with NULL*/
+        LogError("unable to add the property %s", key);
+        StringIntern_Release(internedKey);
+        result = __LINE__;
+    }
+    else
+    {
+        size_t size = strlen(value) + 1;
+        (void)memcpy(*values, value, size);
+        *values += size;
+        result = 0;
+    }
+    return result;
+}
+
+/*binary searches the index of a message for the property called name, whose hash is hash, and returns its value or NULL*/
+static const char* message_find_property(const MESSAGE_HANDLE_DATA* message, const char* name, size_t hash)
+{
+    const char* result = NULL;
+    size_t low = 0;
+    size_t high = message->property_count;
+
+    /*find the first entry of the index with this hash*/
+    while (low < high)
+    {
+        size_t middle = low + ((high - low) / 2);
+        if (message->index[middle].hash < hash)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    for (; (low < message->property_count) && (message->index[low].hash == hash); low++)
+    {
+        /*Codes_SRS_MESSAGE_13_019: [Message_GetProperty shall compare name to the interned names of the properties by pointer before comparing their characters.]*/
+        size_t property = message->index[low].property;
+        if ((message->keys[property] == name) || (strcmp(message->keys[property], name) == 0))
+        {
+            result = message->values[property];
+            break;
+        }
+    }
+    return result;
+}
+
+/*
+* walks the properties of a message: *cursor starts at 0, and each call
+* returns the next property until there are no more. A derived message has
+* its own properties first, then those of its parent it does not override
+*/
+static bool message_next_property(const MESSAGE_HANDLE_DATA* message, size_t* cursor, const char** key, const char** value)
+{
+    /*Codes_SRS_MESSAGE_13_053: [ The properties of a derived message, as Message_GetProperties and Message_ToByteArray see them, shall be the properties of overrides followed by the properties of its parent they do not override. ]*/
+    bool result = false;
+    while (!result)
+    {
+        if (*cursor < message->property_count)
+        {
+            *key = message->keys[*cursor];
+            *value = message->values[*cursor];
+            result = true;
+        }
+        else if ((message->parent != NULL) && (*cursor - message->property_count < message->parent->property_count))
+        {
+            size_t property = *cursor - message->property_count;
+            *key = message->parent->keys[property];
+            *value = message->parent->values[property];
+            result = (message_find_property(message, *key, StringIntern_Hash(*key)) == NULL);
         }
         else
         {
-            /*Codes_SRS_MESSAGE_02_019: [Message_Create shall clone the sourceProperties to a readonly CONSTMAP.]*/
-            result->properties = ConstMap_Create(cfg->sourceProperties);
-            if (result->properties == NULL)
+            break;
+        }
+        (*cursor)++;
+    }
+    return result;
+}
+
+/*
+* allocates a message with room for the properties of sourceProperties and
+* content_size bytes of content, and stores the interned names and copies of
+* the values of the properties in it
+*/
+static MESSAGE_HANDLE_DATA* message_create_with_properties(MAP_HANDLE sourceProperties, size_t content_size)
+{
+    MESSAGE_HANDLE_DATA* result;
+    const char* const* keys;
+    const char* const* values;
+    size_t count;
+    char* valueBuffer;
+    if (Map_GetInternals(sourceProperties, &keys, &values, &count) != MAP_OK)
+    {
+        LogError("Map_GetInternals failed");
+        result = NULL;
+    }
+    else if ((result = message_allocate(count, content_size, get_values_size(values, count), &valueBuffer)) == NULL)
+    {
+        LogError("unable to allocate the message");
+    }
+    else
+    {
+        size_t i;
+        for (i = 0; i < count; i++)
+        {
+            if (message_add_interned_property(result, keys[i], values[i], &valueBuffer) != 0)
             {
-                /*Codes_SRS_MESSAGE_02_005: [If Message_Create encounters an error while building the internal structures of the message, then it shall return NULL.] */
-                LogError("ConstMap_Create failed");
-                CONSTBUFFER_Destroy(result->content);
-                free(result);
-                result = NULL;
+                break;
             }
-            else
+        }
+
+        if (i != count)
+        {
+            message_release_properties(result);
+            MessagePool_Free(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+/*releases the content adopted by a message created with a NULL MESSAGE_CONTENT_RELEASE*/
+static void message_free_content(unsigned char* content, void* context)
+{
+    (void)context;
+    free(content);
+}
+
+/*builds the readonly CONSTMAP handed out by Message_GetProperties*/
+static CONSTMAP_HANDLE message_create_constmap(const MESSAGE_HANDLE_DATA* message)
+{
+    CONSTMAP_HANDLE result;
+    MAP_HANDLE map = Map_Create(NULL);
+    if (map == NULL)
+    {
+        LogError("Map_Create failed");
+        result = NULL;
+    }
+    else
+    {
+        size_t cursor = 0;
+        const char* key;
+        const char* value;
+        bool added = true;
+        while (added && message_next_property(message, &cursor, &key, &value))
+        {
+            if (Map_Add(map, key, value) != MAP_OK)
             {
-                /*all is fine, return as is.*/
+                LogError("Map_Add failed");
+                added = false;
             }
         }
+
+        if (!added)
+        {
+            result = NULL;
+        }
+        else if ((result = ConstMap_Create(map)) == NULL)
+        {
+            LogError("ConstMap_Create failed");
+        }
+        else
+        {
+            /*all is fine, return as is*/
+        }
+        Map_Destroy(map);
+    }
+    return result;
+}
+
+static MESSAGE_HANDLE_DATA* Message_CreateImpl(const MESSAGE_CONFIG * cfg)
+{
+    /*Codes_SRS_MESSAGE_13_001: [Message_Create shall allocate the message, its properties and the copy of its content in a single block of memory, with MessagePool_Allocate.]*/
+    /*Codes_SRS_MESSAGE_02_019: [Message_Create shall copy the names and values of the sourceProperties, read with Map_GetInternals, to the message.]*/
+    /*Codes_SRS_MESSAGE_13_002: [Message_Create shall store the names of the properties acquired from the string intern table with StringIntern_Acquire, and copies of their values in the message.]*/
+    /*Codes_SRS_MESSAGE_13_020: [Message_Create shall index the properties by the hash of their names, computed with StringIntern_Hash.]*/
+    MESSAGE_HANDLE_DATA* result = message_create_with_properties(cfg->sourceProperties, cfg->size);
+    if (result == NULL)
+    {
+        /*Codes_SRS_MESSAGE_02_005: [If Message_Create encounters an error while building the internal structures of the message, then it shall return NULL.] */
+        LogError("unable to create the message");
+    }
+    else
+    {
+        /*Codes_SRS_MESSAGE_02_004: [Mesages shall be allowed to be created from zero-size content.]*/
+        /*Codes_SRS_MESSAGE_02_015: [The MESSAGE_CONTENT's field size shall have the same value as the cfg's field size.]*/
+        /*Codes_SRS_MESSAGE_17_003: [Message_Create shall copy the source to the readonly content of the message.]*/
+        if (cfg->size > 0)
+        {
+            (void)memcpy((unsigned char*)result->content.buffer, cfg->source, cfg->size);
+        }
+
+        /*Codes_SRS_MESSAGE_02_006: [Otherwise, Message_Create shall return a non-NULL handle and shall set the internal ref count to "1".]*/
     }
     return result;
 }
@@ -122,43 +470,160 @@ MESSAGE_HANDLE Message_CreateFromBuffer(const MESSAGE_BUFFER_CONFIG* cfg)
 	{
 		/*Codes_SRS_MESSAGE_17_011: [If Message_CreateFromBuffer encounters an error while building the internal structures of the message, then it shall return NULL.]*/
 		/*Codes_SRS_MESSAGE_17_014: [On success, Message_CreateFromBuffer shall return a non-NULL handle and set the internal ref count to "1".]*/
-		result = REFCOUNT_TYPE_CREATE(MESSAGE_HANDLE_DATA);
+		/*Codes_SRS_MESSAGE_17_012: [Message_CreateFromBuffer shall copy the names and values of the sourceProperties to the message, the names acquired from the string intern table.]*/
+		result = message_create_with_properties(cfg->sourceProperties, 0);
 		if (result == NULL)
 		{
-			LogError("malloc returned NULL");
+			LogError("unable to create the message");
 			/*return as is*/
 		}
 		else
 		{
 			/*Codes_SRS_MESSAGE_17_013: [Message_CreateFromBuffer shall clone the CONSTBUFFER sourceBuffer.]*/
-			result->content = CONSTBUFFER_Clone(cfg->sourceContent);
-			if (result->content == NULL)
+			result->content_handle = CONSTBUFFER_Clone(cfg->sourceContent);
+			if (result->content_handle == NULL)
 			{
 				LogError("CONSBUFFER Clone failed");
-				free(result);
+				message_release_properties(result);
+				MessagePool_Free(result);
 				result = NULL;
 			}
 			else
 			{
-				/*Codes_SRS_MESSAGE_17_012: [Message_CreateFromBuffer shall copy the sourceProperties to a readonly CONSTMAP.]*/
-				result->properties = ConstMap_Create(cfg->sourceProperties);
-				if (result->properties == NULL)
-				{
-					LogError("ConstMap_Create failed");
-					CONSTBUFFER_Destroy(result->content);
-					free(result);
-					result = NULL;
-				}
-				else
-				{
-					/*all is fine, return as is.*/
-				}
+				/*Codes_SRS_MESSAGE_13_003: [Message_CreateFromBuffer shall use the CONSTBUFFER returned by CONSTBUFFER_GetContent as the content of the message.]*/
+				result->content = *CONSTBUFFER_GetContent(result->content_handle);
 			}
 		}
 	}
 	return (MESSAGE_HANDLE)result;
 }
 
+MESSAGE_HANDLE Message_CreateAdopt(const MESSAGE_ADOPT_CONFIG* cfg)
+{
+    MESSAGE_HANDLE_DATA* result;
+    if (cfg == NULL)
+    {
+        /*Codes_SRS_MESSAGE_13_007: [If cfg is NULL then Message_CreateAdopt shall return NULL.]*/
+        LogError("invalid parameter (NULL).");
+        result = NULL;
+    }
+    else if ((cfg->size > 0) && (cfg->source == NULL))
+    {
+        /*Codes_SRS_MESSAGE_13_008: [If field source of cfg is NULL and size is not zero, then Message_CreateAdopt shall fail and return NULL.]*/
+        LogError("invalid parameter combination cfg->size=%zu, cfg->source=%p", cfg->size, cfg->source);
+        result = NULL;
+    }
+    /*Codes_SRS_MESSAGE_13_009: [Message_CreateAdopt shall allocate the message without room for its content.]*/
+    /*Codes_SRS_MESSAGE_13_010: [Message_CreateAdopt shall copy the names and values of the sourceProperties to the message, the names acquired from the string intern table.]*/
+    else if ((result = message_create_with_properties(cfg->sourceProperties, 0)) == NULL)
+    {
+        /*Codes_SRS_MESSAGE_13_011: [If Message_CreateAdopt fails, it shall return NULL and leave source to the caller.]*/
+        LogError("unable to create the message");
+    }
+    else
+    {
+        /*Codes_SRS_MESSAGE_13_012: [Message_CreateAdopt shall use source as the content of the message, without copying it.]*/
+        result->content.buffer = cfg->source;
+        result->content.size = cfg->size;
+        if (cfg->source != NULL)
+        {
+            result->content_release = (cfg->release == NULL) ? message_free_content : cfg->release;
+            result->content_release_context = cfg->releaseContext;
+        }
+        /*Codes_SRS_MESSAGE_13_013: [On success, Message_CreateAdopt shall return a non-NULL handle and set the internal ref count to "1".]*/
+    }
+    return (MESSAGE_HANDLE)result;
+}
+
+/*
+* adds the overrides of a derived message to it, their values copied to
+* valueBuffer, and, when it is derived from a derived message, the
+* properties of the latter that the overrides do not override
+*/
+static int message_add_overrides(MESSAGE_HANDLE_DATA* message, const char* const* keys, const char* const* values, size_t count, const MESSAGE_HANDLE_DATA* inherited, char* valueBuffer)
+{
+    int result = 0;
+    size_t i;
+    for (i = 0; (result == 0) && (i < count); i++)
+    {
+        result = message_add_interned_property(message, keys[i], values[i], &valueBuffer);
+    }
+
+    if (inherited != NULL)
+    {
+        /*Codes_SRS_MESSAGE_13_048: [ If parent is itself derived, Message_CreateDerived shall derive the message from the parent of parent instead, and make room for the properties of parent that overrides does not override. ]*/
+        for (i = 0; (result == 0) && (i < inherited->property_count); i++)
+        {
+            const char* key = inherited->keys[i];
+            if (message_find_property(message, key, StringIntern_Hash(key)) == NULL)
+            {
+                result = message_add_interned_property(message, key, inherited->values[i], &valueBuffer);
+            }
+        }
+    }
+    return result;
+}
+
+MESSAGE_HANDLE Message_CreateDerived(MESSAGE_HANDLE parent, MAP_HANDLE overrides)
+{
+    MESSAGE_HANDLE_DATA* result;
+    if ((parent == NULL) || (overrides == NULL))
+    {
+        /*Codes_SRS_MESSAGE_13_045: [ If parent or overrides is NULL then Message_CreateDerived shall fail and return NULL. ]*/
+        LogError("invalid arg: parent=%p, overrides=%p", parent, overrides);
+        result = NULL;
+    }
+    else
+    {
+        /*
+        * a message derived from a derived message is derived from the parent
+        * of the latter instead, and carries over its properties, so that
+        * messages enriched by module after module stay one overlay deep
+        */
+        MESSAGE_HANDLE_DATA* base = (MESSAGE_HANDLE_DATA*)parent;
+        const MESSAGE_HANDLE_DATA* inherited = NULL;
+        const char* const* keys;
+        const char* const* values;
+        size_t count;
+        char* valueBuffer;
+        if (base->parent != NULL)
+        {
+            inherited = base;
+            base = base->parent;
+        }
+
+        if (Map_GetInternals(overrides, &keys, &values, &count) != MAP_OK)
+        {
+            /*Codes_SRS_MESSAGE_13_050: [ If any of the above steps fails, Message_CreateDerived shall fail and return NULL. ]*/
+            LogError("Map_GetInternals failed");
+            result = NULL;
+        }
+        /*Codes_SRS_MESSAGE_13_046: [ Message_CreateDerived shall allocate the message, with room for the properties of overrides only, with MessagePool_Allocate. ]*/
+        /*Codes_SRS_MESSAGE_13_048: [ If parent is itself derived, Message_CreateDerived shall derive the message from the parent of parent instead, and make room for the properties of parent that overrides does not override. ]*/
+        else if ((result = message_allocate(count + ((inherited == NULL) ? 0 : inherited->property_count), 0, get_values_size(values, count) + ((inherited == NULL) ? 0 : get_values_size(inherited->values, inherited->property_count)), &valueBuffer)) == NULL)
+        {
+            /*Codes_SRS_MESSAGE_13_050: [ If any of the above steps fails, Message_CreateDerived shall fail and return NULL. ]*/
+            LogError("unable to allocate the message");
+        }
+        /*Codes_SRS_MESSAGE_13_047: [ Message_CreateDerived shall store the names of overrides acquired from the string intern table and copies of their values, and index them as Message_Create does. ]*/
+        else if (message_add_overrides(result, keys, values, count, inherited, valueBuffer) != 0)
+        {
+            /*Codes_SRS_MESSAGE_13_050: [ If any of the above steps fails, Message_CreateDerived shall fail and return NULL. ]*/
+            message_release_properties(result);
+            MessagePool_Free(result);
+            result = NULL;
+        }
+        else
+        {
+            /*Codes_SRS_MESSAGE_13_049: [ Message_CreateDerived shall clone the message it derives from, and share its content without copying it. ]*/
+            result->parent = (MESSAGE_HANDLE_DATA*)Message_Clone((MESSAGE_HANDLE)base);
+            result->content = base->content;
+            /*Codes_SRS_MESSAGE_13_051: [ On success, Message_CreateDerived shall return a non-NULL handle and set the internal ref count to "1". ]*/
+        }
+    }
+    return (MESSAGE_HANDLE)result;
+}
+
 MESSAGE_HANDLE Message_Clone(MESSAGE_HANDLE message)
 {
     
@@ -170,12 +635,9 @@ MESSAGE_HANDLE Message_Clone(MESSAGE_HANDLE message)
     else
     {
         /*Codes_SRS_MESSAGE_02_008: [Otherwise, Message_Clone shall increment the internal ref count.] */
-        INC_REF(MESSAGE_HANDLE_DATA, message);
         MESSAGE_HANDLE_DATA* messageData = (MESSAGE_HANDLE_DATA*)message;
-		/*Codes_SRS_MESSAGE_17_001: [Message_Clone shall clone the CONSTMAP handle.]*/
-		(void)ConstMap_Clone(messageData->properties);
-		/*Codes_SRS_MESSAGE_17_004: [Message_Clone shall clone the CONSTBUFFER handle]*/
-		(void)CONSTBUFFER_Clone(messageData->content);
+        /*Codes_SRS_MESSAGE_13_004: [Message_Clone shall not clone the content nor the properties, which belong to the message until its ref count is zero.]*/
+        (void)MESSAGE_COUNTER_INC(messageData->count);
     }
     /*Codes_SRS_MESSAGE_02_010: [Message_Clone shall return messageHandle.]*/
     return message;
@@ -192,9 +654,52 @@ CONSTMAP_HANDLE Message_GetProperties(MESSAGE_HANDLE message)
     }
     else
     {
-        /*Codes_SRS_MESSAGE_02_012: [Otherwise, Message_GetProperties shall shall clone and return the CONSTMAP handle representing the properties of the message.]*/
         MESSAGE_HANDLE_DATA* messageData = (MESSAGE_HANDLE_DATA*)message;
-        result = ConstMap_Clone(messageData->properties);
+        CONSTMAP_HANDLE properties = (CONSTMAP_HANDLE)MESSAGE_POINTER_GET(messageData->properties);
+        if (properties == NULL)
+        {
+            /*Codes_SRS_MESSAGE_13_015: [If the message has no CONSTMAP yet, Message_GetProperties shall create one with the names and values of its properties and keep it until the ref count of the message is zero.]*/
+            properties = message_create_constmap(messageData);
+            if (properties == NULL)
+            {
+                /*Codes_SRS_MESSAGE_13_016: [If creating the CONSTMAP fails, Message_GetProperties shall return NULL.]*/
+                LogError("unable to create the CONSTMAP of the message properties");
+            }
+            else if (!MESSAGE_POINTER_SET_IF_NULL(messageData->properties, properties))
+            {
+                /*another thread got there first, use its map*/
+                ConstMap_Destroy(properties);
+                properties = (CONSTMAP_HANDLE)MESSAGE_POINTER_GET(messageData->properties);
+            }
+        }
+
+        /*Codes_SRS_MESSAGE_02_012: [Otherwise, Message_GetProperties shall shall clone and return the CONSTMAP handle representing the properties of the message.]*/
+        result = (properties == NULL) ? NULL : ConstMap_Clone(properties);
+    }
+    return result;
+}
+
+const char* Message_GetProperty(MESSAGE_HANDLE message, const char* name)
+{
+    const char* result;
+    if ((message == NULL) || (name == NULL))
+    {
+        /*Codes_SRS_MESSAGE_13_017: [If message or name is NULL then Message_GetProperty shall return NULL.]*/
+        LogError("invalid arg: message=%p, name=%p", message, name);
+        result = NULL;
+    }
+    else
+    {
+        /*Codes_SRS_MESSAGE_13_018: [Message_GetProperty shall return the value of the property called name, or NULL if the message has no such property.]*/
+        const MESSAGE_HANDLE_DATA* messageData = (const MESSAGE_HANDLE_DATA*)message;
+        /*Codes_SRS_MESSAGE_13_021: [Message_GetProperty shall hash name with StringIntern_Hash and only compare it to the names of the properties with the same hash.]*/
+        size_t hash = StringIntern_Hash(name);
+        result = message_find_property(messageData, name, hash);
+        if ((result == NULL) && (messageData->parent != NULL))
+        {
+            /*Codes_SRS_MESSAGE_13_052: [ Message_GetProperty shall look for the property in the properties of a derived message first, then in the properties of its parent. ]*/
+            result = message_find_property(messageData->parent, name, hash);
+        }
     }
     return result;
 }
@@ -212,7 +717,7 @@ const CONSTBUFFER * Message_GetContent(MESSAGE_HANDLE message)
     {
         /*Codes_SRS_MESSAGE_02_014: [Otherwise, Message_GetContent shall return a non-NULL const pointer to a structure of type MESSAGE_CONTENT.]*/
 		/*Codes_SRS_MESSAGE_02_016: [The CONSTBUFFER's field buffer shall compare equal byte-by-byte to the cfg's field source.]*/
-        result = CONSTBUFFER_GetContent(((MESSAGE_HANDLE_DATA*)message)->content);
+        result = &((MESSAGE_HANDLE_DATA*)message)->content;
     }
     return result;
 }
@@ -226,10 +731,34 @@ CONSTBUFFER_HANDLE Message_GetContentHandle(MESSAGE_HANDLE message)
 		LogError("invalid argument, message is NULL");
 		result = NULL;
 	}
+	else if (((MESSAGE_HANDLE_DATA*)message)->parent != NULL)
+	{
+		/*Codes_SRS_MESSAGE_13_054: [ Message_GetContentHandle shall return the CONSTBUFFER_HANDLE of the parent of a derived message. ]*/
+		result = Message_GetContentHandle((MESSAGE_HANDLE)((MESSAGE_HANDLE_DATA*)message)->parent);
+	}
 	else
 	{
+		MESSAGE_HANDLE_DATA* messageData = (MESSAGE_HANDLE_DATA*)message;
+		CONSTBUFFER_HANDLE content_handle = (CONSTBUFFER_HANDLE)MESSAGE_POINTER_GET(messageData->content_handle);
+		if (content_handle == NULL)
+		{
+			/*Codes_SRS_MESSAGE_13_005: [If the message has no CONSTBUFFER_HANDLE, Message_GetContentHandle shall create one with a copy of the content and keep it until the ref count of the message is zero.]*/
+			content_handle = CONSTBUFFER_Create(messageData->content.buffer, messageData->content.size);
+			if (content_handle == NULL)
+			{
+				/*Codes_SRS_MESSAGE_13_006: [If creating the CONSTBUFFER_HANDLE fails, Message_GetContentHandle shall return NULL.]*/
+				LogError("CONSTBUFFER_Create failed");
+			}
+			else if (!MESSAGE_POINTER_SET_IF_NULL(messageData->content_handle, content_handle))
+			{
+				/*another thread got there first, use its handle*/
+				CONSTBUFFER_Destroy(content_handle);
+				content_handle = (CONSTBUFFER_HANDLE)MESSAGE_POINTER_GET(messageData->content_handle);
+			}
+		}
+
 		/*Codes_SRS_MESSAGE_17_007: [Otherwise, Message_GetContentHandle shall shall clone and return the CONSTBUFFER_HANDLE representing the message content.]*/
-		result = CONSTBUFFER_Clone(((MESSAGE_HANDLE_DATA*)message)->content);
+		result = (content_handle == NULL) ? NULL : CONSTBUFFER_Clone(content_handle);
 	}
 	return result;
 }
@@ -244,15 +773,40 @@ void Message_Destroy(MESSAGE_HANDLE message)
     else
     {
         MESSAGE_HANDLE_DATA* messageData = (MESSAGE_HANDLE_DATA*)message;
-		/*Codes_SRS_MESSAGE_17_002: [Message_Destroy shall destroy the CONSTMAP properties.]*/
-		ConstMap_Destroy(messageData->properties);
-		/*Codes_SRS_MESSAGE_17_005: [Message_Destroy shall destroy the CONSTBUFFER.]*/
-		CONSTBUFFER_Destroy(messageData->content);
         /*Codes_SRS_MESSAGE_02_020: [Otherwise, Message_Destroy shall decrement the internal ref count of the message.]*/
-        if (DEC_REF(MESSAGE_HANDLE_DATA, message) == DEC_RETURN_ZERO)
+        if (MESSAGE_COUNTER_DEC(messageData->count) == 0)
         {
+            /*Codes_SRS_MESSAGE_17_002: [Message_Destroy shall release the names of the properties with StringIntern_Release, and destroy the CONSTMAP of the message if it has one, when the ref count is zero.]*/
+            /*Codes_SRS_MESSAGE_13_044: [ Message_Destroy shall destroy the byte array kept by a message created with Message_CreateFromByteArrayView, instead of releasing its names, when the ref count is zero. ]*/
+            if (messageData->byte_array != NULL)
+            {
+                CONSTBUFFER_Destroy(messageData->byte_array);
+            }
+            else
+            {
+                message_release_properties(messageData);
+            }
+            if (messageData->properties != NULL)
+            {
+                ConstMap_Destroy(messageData->properties);
+            }
+            /*Codes_SRS_MESSAGE_17_005: [Message_Destroy shall destroy the CONSTBUFFER_HANDLE of the message, if it has one, when the ref count is zero.]*/
+            if (messageData->content_handle != NULL)
+            {
+                CONSTBUFFER_Destroy(messageData->content_handle);
+            }
+            /*Codes_SRS_MESSAGE_13_014: [Message_Destroy shall release the content adopted by the message, with the release function of the MESSAGE_ADOPT_CONFIG or with free if it was NULL, when the ref count is zero.]*/
+            if (messageData->content_release != NULL)
+            {
+                messageData->content_release((unsigned char*)messageData->content.buffer, messageData->content_release_context);
+            }
+            /*Codes_SRS_MESSAGE_13_055: [ Message_Destroy shall destroy the parent of a derived message when the ref count is zero. ]*/
+            if (messageData->parent != NULL)
+            {
+                Message_Destroy((MESSAGE_HANDLE)messageData->parent);
+            }
             /*Codes_SRS_MESSAGE_02_021: [If the ref count is zero then the allocated resources are freed.]*/
-            free(message);
+            MessagePool_Free(message);
         }
     }
 }
@@ -273,11 +827,11 @@ static int parse_int32_t(const unsigned char* source, int32_t sourceSize, int32_
     else
     {
         *parsed = 4;
-        *value = 
-            (source[position + 0] << 24) |
-            (source[position + 1] << 16) |
-            (source[position + 2] <<  8) |
-            (source[position + 3]);
+        *value = (int32_t)(
+            ((uint32_t)source[position + 0] << 24) |
+            ((uint32_t)source[position + 1] << 16) |
+            ((uint32_t)source[position + 2] <<  8) |
+            ((uint32_t)source[position + 3]));
         result = 0;
     }
     return result;
@@ -303,187 +857,278 @@ static int parse_null_terminated_const_char(const unsigned char* source, int32_t
     return result;
 }
 
-/*creates a MESSAGE_HANDLE from a serialized byte array*/
-MESSAGE_HANDLE Message_CreateFromByteArray(const unsigned char* source, int32_t size)
+/*where the properties and the content of a byte array are, found by parse_byte_array*/
+typedef struct BYTE_ARRAY_LAYOUT_TAG
 {
-    MESSAGE_HANDLE_DATA* result;
-    /*Codes_SRS_MESSAGE_02_022: [ If source is NULL then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    int32_t propertiesCount;
+    int32_t propertiesPosition;
+    int32_t valuesSize;
+    int32_t contentSize;
+    int32_t contentPosition;
+}BYTE_ARRAY_LAYOUT;
+
+/*checks that source is the byte array of a message, as indicated in the implementation details, and finds its properties and its content*/
+static int parse_byte_array(const unsigned char* source, int32_t size, BYTE_ARRAY_LAYOUT* layout)
+{
+    int result;
     /*Codes_SRS_MESSAGE_02_023: [ If source is not NULL and and size parameter is smaller than 14 then Message_CreateFromByteArray shall fail and return NULL. ]*/
-    if (
-        (source == NULL) ||
-        (size < MIN_MESSAGE_BUFFER_LENGTH)
+    if (size < MIN_MESSAGE_BUFFER_LENGTH)
+    {
+        LogError("invalid parameter size=%" PRId32, size);
+        result = __LINE__;
+    }
+    /*Codes_SRS_MESSAGE_02_024: [ If the first two bytes of source are not 0xA1 0x60 then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    else if (
+        (source[0] != FIRST_MESSAGE_BYTE) ||
+        (source[1] != SECOND_MESSAGE_BYTE)
         )
     {
-        LogError("invalid parameter source=[%p] size=%" PRId32, source, size);
-        result = NULL;
+        LogError("byte array is not a gateway message serialization");
+        result = __LINE__;
     }
     else
     {
-        /*Codes_SRS_MESSAGE_02_024: [ If the first two bytes of source are not 0xA1 0x60 then Message_CreateFromByteArray shall fail and return NULL. ]*/
-        if (
-            (source[0] != FIRST_MESSAGE_BYTE) ||
-            (source[1] != SECOND_MESSAGE_BYTE)
+        int32_t currentPosition = 2; /*current position is always the first character that "we are about to look at"*/
+
+        int32_t parsed; /*reused in all parsings*/
+        int32_t messageSize;
+        /*Codes_SRS_MESSAGE_02_037: [ If the size embedded in the message is not the same as size parameter then Message_CreateFromByteArray shall fail and return NULL. ]*/
+        if (parse_int32_t(source, size, currentPosition, &parsed, &messageSize) != 0)
+        {
+            LogError("unable to parse an int32_t");
+            result = __LINE__;
+        }
+        else if (messageSize != size)
+        {
+            LogError("message size is inconsistent");
+            result = __LINE__;
+        }
+        else if (parse_int32_t(source, size, currentPosition + parsed, &parsed, &layout->propertiesCount) != 0)
+        {
+            LogError("unable to parse an int32_t");
+            result = __LINE__;
+        }
+        else if (
+            (layout->propertiesCount < 0) ||
+            (layout->propertiesCount == INT32_MAX)
             )
         {
-            LogError("byte array is not a gateway message serialization");
-            result = NULL;
+            /*Codes_SRS_MESSAGE_02_030: [ If any of the above steps fails, then Message_CreateFromByteArray shall fail and return NULL. ]*/
+            LogError("invalid message detected with wrong number of properties =%" PRId32, layout->propertiesCount);
+            result = __LINE__;
         }
         else
         {
-            int32_t currentPosition = 2; /*current position is always the first character that "we are about to look at"*/
+            int32_t i;
+            currentPosition = 10;
+            layout->propertiesPosition = currentPosition;
+            layout->valuesSize = 0;
 
-            int32_t parsed; /*reused in all parsings*/
-            int32_t messageSize;
-            /*Codes_SRS_MESSAGE_02_037: [ If the size embedded in the message is not the same as size parameter then Message_CreateFromByteArray shall fail and return NULL. ]*/
-            if (parse_int32_t(source, size, currentPosition, &parsed, &messageSize) != 0)
-            {
-                LogError("unable to parse an int32_t");
-                result = NULL;
-            }
-            else
+            for (i = 0;i < layout->propertiesCount;i++)
             {
-                currentPosition += parsed;
-                if (messageSize != size)
+                const char* keyName;
+                if (parse_null_terminated_const_char(source, size, currentPosition, &parsed, &keyName) != 0)
                 {
-                    LogError("message size is inconsistent");
-                    result = NULL;
+                    LogError("unable to parse the name string of the property");
+                    break;
                 }
                 else
                 {
-                    /*Codes_SRS_MESSAGE_02_026: [ A MAP_HANDLE shall be created. ]*/
-                    MAP_HANDLE configMap = Map_Create(NULL);
-                    if (configMap == NULL)
+                    const char* keyValue;
+                    currentPosition += parsed;
+                    if (parse_null_terminated_const_char(source, size, currentPosition, &parsed, &keyValue) != 0)
                     {
-                        /*Codes_SRS_MESSAGE_02_030: [ If any of the above steps fails, then Message_CreateFromByteArray shall fail and return NULL. ]*/
-                        LogError("failed to create a MAP_HANDLE");
-                        result = NULL;
+                        LogError("unable to parse the value string of the property");
+                        break;
                     }
                     else
                     {
-                        /*add all the properties to the map*/
-                        int32_t propertiesCount;
-                        if (parse_int32_t(source, size, currentPosition, &parsed, &propertiesCount) != 0)
-                        {
-                            LogError("unable to parse an int32_t");
-                            result = NULL;
-                        }
-                        else
-                        {
-                            currentPosition += parsed;
-
-                            if (
-                                (propertiesCount < 0) ||
-                                (propertiesCount == INT32_MAX)
-                                )
-                            {
-                                /*Codes_SRS_MESSAGE_02_030: [ If any of the above steps fails, then Message_CreateFromByteArray shall fail and return NULL. ]*/
-                                LogError("invalid message detected with wrong number of properties =%" PRId32, propertiesCount);
-                                result = NULL;
-                            }
-                            else
-                            {
-                                int32_t i;
-
-                                for (i = 0;i < propertiesCount;i++)
-                                {
-                                    const char* keyName;
-                                    if (parse_null_terminated_const_char(source, size, currentPosition, &parsed, &keyName) != 0)
-                                    {
-                                        LogError("unable to parse the name string of the property");
-                                        break;
-                                    }
-                                    else
-                                    {
-                                        const char* keyValue;
-                                        currentPosition += parsed;
-                                        if (parse_null_terminated_const_char(source, size, currentPosition, &parsed, &keyValue) != 0)
-                                        {
-                                            LogError("unable to parse the name string of the property");
-                                            break;
-                                        }
-                                        else
-                                        {
-                                            currentPosition += parsed;
-                                            /*Codes_SRS_MESSAGE_02_027: [ All the properties of the byte array shall be added to the MAP_HANDLE. ]*/
-                                            if (Map_Add(configMap, keyName, keyValue) != MAP_OK)
-                                            {
-                                                LogError("Map_Add failed\n");
-                                                break;
-                                            }
-                                            else
-                                            {
-                                                /*all is fine, proceed to the next property*/
-                                            }
-                                        }
-                                    }
-                                }
-
-                                if (i != propertiesCount)
-                                {
-                                    result = NULL;
-                                }
-                                else
-                                {
-                                    /*all is fine*/
-                                    int32_t messageContentSize;
-
-                                    if(parse_int32_t(source, size, currentPosition, &parsed, &messageContentSize)!=0)
-                                    {
-                                        LogError("no space to read the number of bytes making the message");
-                                        result = NULL;
-                                    }
-                                    else
-                                    {
-                                        currentPosition += parsed;
-                                        if (currentPosition + messageContentSize != messageSize)
-                                        {
-                                            LogError("the message content doesn't up to the message size %" PRId32 " %" PRId32 "\n", (int32_t)(currentPosition + messageContentSize), messageSize);
-                                            result = NULL;
-                                        }
-                                        else
-                                        {
-                                            /*Codes_SRS_MESSAGE_02_028: [ A structure of type MESSAGE_CONFIG shall be populated with the MAP_HANDLE previously constructed and the message content ]*/
-                                            MESSAGE_CONFIG msgConfig = { (size_t)messageContentSize, source + currentPosition, configMap };
-
-                                            /*Codes_SRS_MESSAGE_02_029: [ A MESSAGE_HANDLE shall be constructed from the MESSAGE_CONFIG. ]*/
-                                            /*Codes_SRS_MESSAGE_02_031: [ Otherwise Message_CreateFromByteArray shall succeed and return a non-NULL handle. ]*/
-                                            result = Message_CreateImpl(&msgConfig);
-
-                                            /*return as is*/
-                                            
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                        Map_Destroy(configMap);
+                        currentPosition += parsed;
+                        layout->valuesSize += parsed;
                     }
                 }
             }
+
+            if (i != layout->propertiesCount)
+            {
+                result = __LINE__;
+            }
+            else if (parse_int32_t(source, size, currentPosition, &parsed, &layout->contentSize) != 0)
+            {
+                LogError("no space to read the number of bytes making the message");
+                result = __LINE__;
+            }
+            else
+            {
+                currentPosition += parsed;
+                if (
+                    (layout->contentSize < 0) ||
+                    (layout->contentSize != messageSize - currentPosition)
+                    )
+                {
+                    LogError("the message content doesn't up to the message size %" PRId32 " %" PRId32 "\n", layout->contentSize, messageSize - currentPosition);
+                    result = __LINE__;
+                }
+                else
+                {
+                    layout->contentPosition = currentPosition;
+                    result = 0;
+                }
+            }
         }
     }
-    return (MESSAGE_HANDLE)result;
+    return result;
+}
+
+/*
+* adds the properties of a byte array checked by parse_byte_array to a
+* message, their names acquired from the string intern table and their values
+* copied to valueBuffer or, for a message that keeps the byte array
+* (valueBuffer is NULL), pointing into it
+*/
+static int message_add_byte_array_properties(MESSAGE_HANDLE_DATA* message, const unsigned char* source, const BYTE_ARRAY_LAYOUT* layout, char* valueBuffer)
+{
+    int result;
+    const char* keyName = (const char*)source + layout->propertiesPosition;
+    int32_t i;
+    for (i = 0; i < layout->propertiesCount; i++)
+    {
+        const char* keyValue = keyName + strlen(keyName) + 1;
+        /*Codes_SRS_MESSAGE_13_024: [ If the byte array has two properties with the same name, Message_CreateFromByteArray shall fail and return NULL. ]*/
+        if ((valueBuffer == NULL) ?
+            (message_add_property(message, keyName, keyValue) != 0) :
+            (message_add_interned_property(message, keyName, keyValue, &valueBuffer) != 0))
+        {
+            LogError("unable to add the property %s", keyName);
+            break;
+        }
+        keyName = keyValue + strlen(keyValue) + 1;
+    }
 
+    if (i != layout->propertiesCount)
+    {
+        if (valueBuffer != NULL)
+        {
+            message_release_properties(message);
+        }
+        result = __LINE__;
+    }
+    else
+    {
+        result = 0;
+    }
+    return result;
 }
 
-const unsigned char* Message_ToByteArray(MESSAGE_HANDLE messageHandle, int32_t* size)
+/*creates a MESSAGE_HANDLE from a serialized byte array*/
+MESSAGE_HANDLE Message_CreateFromByteArray(const unsigned char* source, int32_t size)
 {
-    unsigned char* result;
-    /*Codes_SRS_MESSAGE_02_032: [ If messageHandle is NULL then Message_ToByteArray shall fail and return NULL. ]*/
-    /*Codes_SRS_MESSAGE_02_038: [ If size is NULL then Message_ToByteArray shall fail and return NULL. ]*/
-    if (
-        (messageHandle == NULL) ||
-        (size == NULL)
-        )
+    MESSAGE_HANDLE_DATA* result;
+    BYTE_ARRAY_LAYOUT layout;
+    char* valueBuffer;
+    /*Codes_SRS_MESSAGE_02_022: [ If source is NULL then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    if (source == NULL)
     {
-        LogError("invalid (NULL) parameter detected messageHandle = %p, size=%p", messageHandle, size);
+        LogError("invalid parameter source=[%p] size=%" PRId32, source, size);
+        result = NULL;
+    }
+    /*the whole byte array is checked before the message is allocated*/
+    else if (parse_byte_array(source, size, &layout) != 0)
+    {
+        /*Codes_SRS_MESSAGE_02_025: [ If while parsing the message content, a read would occur past the end of the array (as indicated by size) then Message_CreateFromByteArray shall fail and return NULL. ]*/
+        result = NULL;
+    }
+    /*Codes_SRS_MESSAGE_13_022: [ Message_CreateFromByteArray shall allocate the message, with room for the properties and the content of the byte array, with MessagePool_Allocate. ]*/
+    else if ((result = message_allocate((size_t)layout.propertiesCount, (size_t)layout.contentSize, (size_t)layout.valuesSize, &valueBuffer)) == NULL)
+    {
+        /*Codes_SRS_MESSAGE_02_030: [ If any of the above steps fails, then Message_CreateFromByteArray shall fail and return NULL. ]*/
+        LogError("unable to allocate the message");
+    }
+    /*Codes_SRS_MESSAGE_13_023: [ Message_CreateFromByteArray shall acquire the names of the properties from the string intern table straight from the byte array, copy their values to the message, and index them as Message_Create does. ]*/
+    else if (message_add_byte_array_properties(result, source, &layout, valueBuffer) != 0)
+    {
+        /*Codes_SRS_MESSAGE_02_030: [ If any of the above steps fails, then Message_CreateFromByteArray shall fail and return NULL. ]*/
+        MessagePool_Free(result);
+        result = NULL;
+    }
+    else
+    {
+        /*Codes_SRS_MESSAGE_13_025: [ Message_CreateFromByteArray shall copy the content of the byte array to the message. ]*/
+        if (layout.contentSize > 0)
+        {
+            (void)memcpy((unsigned char*)result->content.buffer, source + layout.contentPosition, (size_t)layout.contentSize);
+        }
+        /*Codes_SRS_MESSAGE_02_031: [ Otherwise Message_CreateFromByteArray shall succeed and return a non-NULL handle. ]*/
+    }
+    return (MESSAGE_HANDLE)result;
+}
+
+MESSAGE_HANDLE Message_CreateFromByteArrayView(CONSTBUFFER_HANDLE source)
+{
+    MESSAGE_HANDLE_DATA* result;
+    const CONSTBUFFER* byteArray;
+    BYTE_ARRAY_LAYOUT layout;
+    char* valueBuffer;
+    if (source == NULL)
+    {
+        /*Codes_SRS_MESSAGE_13_032: [ If source is NULL then Message_CreateFromByteArrayView shall fail and return NULL. ]*/
+        LogError("invalid arg: source is NULL");
+        result = NULL;
+    }
+    else if ((byteArray = CONSTBUFFER_GetContent(source))->size > INT32_MAX)
+    {
+        /*Codes_SRS_MESSAGE_13_033: [ Message_CreateFromByteArrayView shall check the byte array in source as Message_CreateFromByteArray does, and fail and return NULL if it is not the byte array of a message. ]*/
+        LogError("the byte array is too big to be a message: %zu bytes", byteArray->size);
+        result = NULL;
+    }
+    /*Codes_SRS_MESSAGE_13_033: [ Message_CreateFromByteArrayView shall check the byte array in source as Message_CreateFromByteArray does, and fail and return NULL if it is not the byte array of a message. ]*/
+    else if (parse_byte_array(byteArray->buffer, (int32_t)byteArray->size, &layout) != 0)
+    {
+        result = NULL;
+    }
+    /*Codes_SRS_MESSAGE_13_034: [ Message_CreateFromByteArrayView shall allocate the message, with room for its properties only, with MessagePool_Allocate. ]*/
+    else if ((result = message_allocate((size_t)layout.propertiesCount, 0, 0, &valueBuffer)) == NULL)
+    {
+        /*Codes_SRS_MESSAGE_13_038: [ If any of the above steps fails, Message_CreateFromByteArrayView shall fail and return NULL. ]*/
+        LogError("unable to allocate the message");
+    }
+    /*Codes_SRS_MESSAGE_13_035: [ Message_CreateFromByteArrayView shall use the names and values in the byte array as the properties of the message, without copying nor interning them, and index them as Message_Create does. ]*/
+    else if (message_add_byte_array_properties(result, byteArray->buffer, &layout, NULL) != 0)
+    {
+        /*Codes_SRS_MESSAGE_13_038: [ If any of the above steps fails, Message_CreateFromByteArrayView shall fail and return NULL. ]*/
+        MessagePool_Free(result);
+        result = NULL;
+    }
+    /*Codes_SRS_MESSAGE_13_037: [ Message_CreateFromByteArrayView shall clone source and keep it until the ref count of the message is zero. ]*/
+    else if ((result->byte_array = CONSTBUFFER_Clone(source)) == NULL)
+    {
+        /*Codes_SRS_MESSAGE_13_038: [ If any of the above steps fails, Message_CreateFromByteArrayView shall fail and return NULL. ]*/
+        LogError("CONSTBUFFER_Clone failed");
+        MessagePool_Free(result);
         result = NULL;
     }
     else
     {
-        MESSAGE_HANDLE_DATA* messageHandleData = (MESSAGE_HANDLE_DATA*)messageHandle;
+        /*Codes_SRS_MESSAGE_13_036: [ Message_CreateFromByteArrayView shall use the content in the byte array as the content of the message, without copying it. ]*/
+        result->content.buffer = (layout.contentSize == 0) ? NULL : byteArray->buffer + layout.contentPosition;
+        result->content.size = (size_t)layout.contentSize;
+        /*Codes_SRS_MESSAGE_13_039: [ On success, Message_CreateFromByteArrayView shall return a non-NULL handle and set the internal ref count to "1". ]*/
+    }
+    return (MESSAGE_HANDLE)result;
+}
 
-        /*Codes_SRS_MESSAGE_02_033: [Message_ToByteArray shall precompute the needed memory size and shall pre allocate it.]*/
+/*computes the size of the byte array of a message, fails if it would not fit an int32_t*/
+static int message_get_byte_array_size(const MESSAGE_HANDLE_DATA* message, size_t* size)
+{
+    int result;
+    if (message->byte_array != NULL)
+    {
+        /*Codes_SRS_MESSAGE_13_040: [ A message created with Message_CreateFromByteArrayView shall serialize to the byte array it was created from. ]*/
+        *size = CONSTBUFFER_GetContent(message->byte_array)->size;
+        result = 0;
+    }
+    else
+    {
         size_t byteArraySize =
             + 2 /*header*/
             + 4 /*total size of byte array*/
@@ -492,84 +1137,228 @@ const unsigned char* Message_ToByteArray(MESSAGE_HANDLE messageHandle, int32_t*
             + 4 /*number of bytes in messageContent*/
             + 0 /*an unknown at this moment number of bytes for message content*/
             ;
-        
-        const char* const * keys;
-        const char* const * values;
-        size_t nProperties;
+        size_t cursor = 0;
+        const char* key;
+        const char* value;
 
-        /*Codes_SRS_MESSAGE_02_035: [ If any of the above steps fails then Message_ToByteArray shall fail and return NULL. ]*/
-        if (ConstMap_GetInternals(messageHandleData->properties, &keys, &values, &nProperties) != CONSTMAP_OK)
+        while ((byteArraySize <= INT32_MAX) && message_next_property(message, &cursor, &key, &value))
         {
-            LogError("failed to get the keys and values from the message properties");
-            result = NULL;
+            /*add to the needed size the name and value of the property*/
+            byteArraySize += (strlen(key) + 1) + (strlen(value) + 1);
+        }
+
+        if ((byteArraySize > INT32_MAX) || (message->content.size > INT32_MAX - byteArraySize))
+        {
+            LogError("the message is too big to be serialized");
+            result = __LINE__;
         }
         else
         {
-            size_t i;
-            for (i = 0;i < nProperties;i++)
-            {
-                /*add to the needed size the name and value of property i*/
-                byteArraySize += (strlen(keys[i]) + 1) + (strlen(values[i]) + 1);
-            }
+            *size = byteArraySize + message->content.size;
+            result = 0;
+        }
+    }
+    return result;
+}
 
-            const CONSTBUFFER* messageContent = CONSTBUFFER_GetContent(messageHandleData->content);
-            byteArraySize += messageContent->size;
-            
-            result = (unsigned char*)malloc(byteArraySize);
-            if (result == NULL)
-            {
-                /*Codes_SRS_MESSAGE_02_035: [ If any of the above steps fails then Message_ToByteArray shall fail and return NULL. ]*/
-                LogError("Out Of Memory [oom]");
-                /*return as is*/
-            }
-            else
-            {
-                /*Codes_SRS_MESSAGE_02_034: [ Message_ToByteArray shall populate the memory with values as indicated in the implementation details. ]*/
-
-                size_t currentPosition; /*always points to the byte we are about to write*/
-                /*a header formed of the following hex characters in this order: 0xA1 0x60*/
-                result[0] = FIRST_MESSAGE_BYTE;
-                result[1] = SECOND_MESSAGE_BYTE;
-                /*4 bytes in MSB order representing the total size of the byte array. */
-                result[2] = byteArraySize >> 24;
-                result[3] = (byteArraySize >> 16) & 0xFF;
-                result[4] = (byteArraySize >> 8) & 0xFF;
-                result[5] = (byteArraySize) & 0xFF;
-                /*4 bytes in MSB order representing the number of properties*/
-                result[6] = nProperties >> 24;
-                result[7] = (nProperties >> 16) & 0xFF;
-                result[8] = (nProperties >> 8) & 0xFF;
-                result[9] = nProperties & 0xFF;
-                /*for every property, 2 arrays of null terminated characters representing the name of the property and the value.*/
-                currentPosition = 10;
-                for (i = 0;i < nProperties;i++)
-                {
-                    size_t nameLength = strlen(keys[i]) + 1;/*the +1 will take care of copying '\0' too*/
-                    size_t valueLength = strlen(values[i]) + 1;/*the +1 will take care of copying '\0' too*/
-
-                    /*copy name*/
-                    memcpy(result + currentPosition, keys[i], nameLength);
-                    currentPosition += nameLength;
-                    
-                    /*copy value*/
-                    memcpy(result + currentPosition, values[i], valueLength);
-                    currentPosition += valueLength;
-                }
+/*serializes the properties and the content of a message, as indicated in the implementation details, to destination, which has byteArraySize bytes*/
+static void message_serialize(const MESSAGE_HANDLE_DATA* message, unsigned char* destination, size_t byteArraySize)
+{
+    size_t nProperties = 0;
+    const CONSTBUFFER* messageContent = &message->content;
+    size_t currentPosition; /*always points to the byte we are about to write*/
+    size_t cursor = 0;
+    const char* key;
+    const char* value;
 
-                /*4 bytes in MSB order representing the number of bytes in the message content array*/
-                result[currentPosition++] = (messageContent->size) >> 24;
-                result[currentPosition++] = ((messageContent->size) >> 16) & 0xFF;
-                result[currentPosition++] = ((messageContent->size) >> 8) & 0xFF;
-                result[currentPosition++] = (messageContent->size) & 0xFF;
+    /*a header formed of the following hex characters in this order: 0xA1 0x60*/
+    destination[0] = FIRST_MESSAGE_BYTE;
+    destination[1] = SECOND_MESSAGE_BYTE;
+    /*4 bytes in MSB order representing the total size of the byte array. */
+    destination[2] = byteArraySize >> 24;
+    destination[3] = (byteArraySize >> 16) & 0xFF;
+    destination[4] = (byteArraySize >> 8) & 0xFF;
+    destination[5] = (byteArraySize) & 0xFF;
+    /*for every property, 2 arrays of null terminated characters representing the name of the property and the value.*/
+    currentPosition = 10;
+    while (message_next_property(message, &cursor, &key, &value))
+    {
+        size_t nameLength = strlen(key) + 1;/*the +1 will take care of copying '\0' too*/
+        size_t valueLength = strlen(value) + 1;/*the +1 will take care of copying '\0' too*/
 
-                /*n bytes of message content follows.*/
-                memcpy(result + currentPosition, messageContent->buffer, messageContent->size);
+        /*copy name*/
+        memcpy(destination + currentPosition, key, nameLength);
+        currentPosition += nameLength;
 
-                /*Codes_SRS_MESSAGE_02_036: [ Otherwise Message_ToByteArray shall succeed, write in *size the byte array size and return a non-NULL result. ]*/
-                *size = byteArraySize;
-                /*return as is*/
-            }
+        /*copy value*/
+        memcpy(destination + currentPosition, value, valueLength);
+        currentPosition += valueLength;
+        nProperties++;
+    }
+    /*4 bytes in MSB order representing the number of properties, known once a derived message has skipped the properties of its parent it overrides*/
+    destination[6] = nProperties >> 24;
+    destination[7] = (nProperties >> 16) & 0xFF;
+    destination[8] = (nProperties >> 8) & 0xFF;
+    destination[9] = nProperties & 0xFF;
+
+    /*4 bytes in MSB order representing the number of bytes in the message content array*/
+    destination[currentPosition++] = (messageContent->size) >> 24;
+    destination[currentPosition++] = ((messageContent->size) >> 16) & 0xFF;
+    destination[currentPosition++] = ((messageContent->size) >> 8) & 0xFF;
+    destination[currentPosition++] = (messageContent->size) & 0xFF;
+
+    /*n bytes of message content follows.*/
+    if (messageContent->size > 0)
+    {
+        memcpy(destination + currentPosition, messageContent->buffer, messageContent->size);
+    }
+}
+
+/*writes the byte array of a message to destination, which has byteArraySize bytes*/
+static void message_write_byte_array(const MESSAGE_HANDLE_DATA* message, unsigned char* destination, size_t byteArraySize)
+{
+    if (message->byte_array != NULL)
+    {
+        /*Codes_SRS_MESSAGE_13_040: [ A message created with Message_CreateFromByteArrayView shall serialize to the byte array it was created from. ]*/
+        (void)memcpy(destination, CONSTBUFFER_GetContent(message->byte_array)->buffer, byteArraySize);
+    }
+    else
+    {
+        message_serialize(message, destination, byteArraySize);
+    }
+}
+
+const unsigned char* Message_ToByteArray(MESSAGE_HANDLE messageHandle, int32_t* size)
+{
+    unsigned char* result;
+    size_t byteArraySize;
+    /*Codes_SRS_MESSAGE_02_032: [ If messageHandle is NULL then Message_ToByteArray shall fail and return NULL. ]*/
+    /*Codes_SRS_MESSAGE_02_038: [ If size is NULL then Message_ToByteArray shall fail and return NULL. ]*/
+    if (
+        (messageHandle == NULL) ||
+        (size == NULL)
+        )
+    {
+        LogError("invalid (NULL) parameter detected messageHandle = %p, size=%p", messageHandle, size);
+        result = NULL;
+    }
+    /*Codes_SRS_MESSAGE_02_033: [Message_ToByteArray shall precompute the needed memory size and shall pre allocate it.]*/
+    else if (message_get_byte_array_size((MESSAGE_HANDLE_DATA*)messageHandle, &byteArraySize) != 0)
+    {
+        /*Codes_SRS_MESSAGE_02_035: [ If any of the above steps fails then Message_ToByteArray shall fail and return NULL. ]*/
+        result = NULL;
+    }
+    else if ((result = (unsigned char*)malloc(byteArraySize)) == NULL)
+    {
+        /*Codes_SRS_MESSAGE_02_035: [ If any of the above steps fails then Message_ToByteArray shall fail and return NULL. ]*/
+        LogError("Out Of Memory [oom]");
+        /*return as is*/
+    }
+    else
+    {
+        /*Codes_SRS_MESSAGE_02_034: [ Message_ToByteArray shall populate the memory with values as indicated in the implementation details. ]*/
+        message_write_byte_array((MESSAGE_HANDLE_DATA*)messageHandle, result, byteArraySize);
+
+        /*Codes_SRS_MESSAGE_02_036: [ Otherwise Message_ToByteArray shall succeed, write in *size the byte array size and return a non-NULL result. ]*/
+        *size = (int32_t)byteArraySize;
+        /*return as is*/
+    }
+    return result;
+}
+
+int32_t Message_GetByteArraySize(MESSAGE_HANDLE messageHandle)
+{
+    int32_t result;
+    size_t byteArraySize;
+    if (messageHandle == NULL)
+    {
+        /*Codes_SRS_MESSAGE_13_026: [ If messageHandle is NULL then Message_GetByteArraySize shall return -1. ]*/
+        LogError("invalid arg: messageHandle is NULL");
+        result = -1;
+    }
+    else if (message_get_byte_array_size((MESSAGE_HANDLE_DATA*)messageHandle, &byteArraySize) != 0)
+    {
+        /*Codes_SRS_MESSAGE_13_027: [ If the byte array of the message would be larger than INT32_MAX bytes, Message_GetByteArraySize shall return -1. ]*/
+        result = -1;
+    }
+    else
+    {
+        /*Codes_SRS_MESSAGE_13_028: [ Otherwise Message_GetByteArraySize shall return the size of the byte array Message_ToByteArray creates from the message. ]*/
+        result = (int32_t)byteArraySize;
+    }
+    return result;
+}
+
+int32_t Message_ToByteArrayBuffer(MESSAGE_HANDLE messageHandle, unsigned char* buffer, int32_t size)
+{
+    int32_t result;
+    size_t byteArraySize;
+    if (
+        (messageHandle == NULL) ||
+        (buffer == NULL)
+        )
+    {
+        /*Codes_SRS_MESSAGE_13_029: [ If messageHandle or buffer is NULL then Message_ToByteArrayBuffer shall fail and return -1. ]*/
+        LogError("invalid (NULL) parameter detected messageHandle = %p, buffer=%p", messageHandle, buffer);
+        result = -1;
+    }
+    else if (message_get_byte_array_size((MESSAGE_HANDLE_DATA*)messageHandle, &byteArraySize) != 0)
+    {
+        /*Codes_SRS_MESSAGE_13_030: [ If the byte array of the message does not fit in size bytes, Message_ToByteArrayBuffer shall fail and return -1 without writing to buffer. ]*/
+        result = -1;
+    }
+    else if ((size < 0) || ((size_t)size < byteArraySize))
+    {
+        /*Codes_SRS_MESSAGE_13_030: [ If the byte array of the message does not fit in size bytes, Message_ToByteArrayBuffer shall fail and return -1 without writing to buffer. ]*/
+        LogError("the byte array of the message needs %zu bytes, the buffer has %" PRId32, byteArraySize, size);
+        result = -1;
+    }
+    else
+    {
+        /*Codes_SRS_MESSAGE_13_031: [ Otherwise Message_ToByteArrayBuffer shall write the byte array of the message, as Message_ToByteArray does, at the start of buffer and return its size. ]*/
+        message_write_byte_array((MESSAGE_HANDLE_DATA*)messageHandle, buffer, byteArraySize);
+        result = (int32_t)byteArraySize;
+    }
+    return result;
+}
+
+CONSTBUFFER_HANDLE Message_ToByteArrayHandle(MESSAGE_HANDLE messageHandle)
+{
+    CONSTBUFFER_HANDLE result;
+    size_t byteArraySize;
+    unsigned char* byteArray;
+    if (messageHandle == NULL)
+    {
+        /*Codes_SRS_MESSAGE_13_041: [ If messageHandle is NULL then Message_ToByteArrayHandle shall fail and return NULL. ]*/
+        LogError("invalid arg: messageHandle is NULL");
+        result = NULL;
+    }
+    else if (((MESSAGE_HANDLE_DATA*)messageHandle)->byte_array != NULL)
+    {
+        /*Codes_SRS_MESSAGE_13_042: [ If the message was created with Message_CreateFromByteArrayView, Message_ToByteArrayHandle shall return a clone of the byte array it was created from. ]*/
+        result = CONSTBUFFER_Clone(((MESSAGE_HANDLE_DATA*)messageHandle)->byte_array);
+    }
+    else if (message_get_byte_array_size((MESSAGE_HANDLE_DATA*)messageHandle, &byteArraySize) != 0)
+    {
+        /*Codes_SRS_MESSAGE_13_043: [ Otherwise Message_ToByteArrayHandle shall create a CONSTBUFFER_HANDLE holding the byte array Message_ToByteArray creates from the message, and return NULL if that fails. ]*/
+        result = NULL;
+    }
+    else if ((byteArray = (unsigned char*)malloc(byteArraySize)) == NULL)
+    {
+        /*Codes_SRS_MESSAGE_13_043: [ Otherwise Message_ToByteArrayHandle shall create a CONSTBUFFER_HANDLE holding the byte array Message_ToByteArray creates from the message, and return NULL if that fails. ]*/
+        LogError("Out Of Memory [oom]");
+        result = NULL;
+    }
+    else
+    {
+        /*Codes_SRS_MESSAGE_13_043: [ Otherwise Message_ToByteArrayHandle shall create a CONSTBUFFER_HANDLE holding the byte array Message_ToByteArray creates from the message, and return NULL if that fails. ]*/
+        message_serialize((MESSAGE_HANDLE_DATA*)messageHandle, byteArray, byteArraySize);
+        result = CONSTBUFFER_Create(byteArray, byteArraySize);
+        if (result == NULL)
+        {
+            LogError("CONSTBUFFER_Create failed");
         }
+        free(byteArray);
     }
     return result;
-}
\ No newline at end of file
+}
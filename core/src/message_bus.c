@@ -8,36 +8,249 @@
 #endif
 
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include <signal.h>
+#include <limits.h>
 
 #include "azure_c_shared_utility/gballoc.h"
-#include "azure_c_shared_utility/vector.h"
 #include "azure_c_shared_utility/lock.h"
 #include "azure_c_shared_utility/condition.h"
 #include "azure_c_shared_utility/threadapi.h"
 #include "azure_c_shared_utility/iot_logging.h"
 #include "azure_c_shared_utility/refcount.h"
 #include "azure_c_shared_utility/list.h"
+#include "azure_c_shared_utility/vector.h"
+#include "azure_c_shared_utility/crt_abstractions.h"
+#include "azure_c_shared_utility/tickcounter.h"
 
 #include "message.h"
+#include "message_queue.h"
 #include "module.h"
 #include "message_bus.h"
+#include "subscription_index.h"
+#include "worker_pool.h"
+#include "message_pool.h"
+
+/*number of subscription slots MessageBus_Publish can match without allocating*/
+#define MESSAGE_BUS_MATCH_BUFFER_SIZE 32
+
+/*number of modules MessageBus_Publish can wait for room in after its loop without allocating*/
+#define MESSAGE_BUS_WAIT_BUFFER_SIZE 8
+
+/*number of times a writer yields while waiting for the publishers to leave the previous snapshot before it starts sleeping*/
+#define MESSAGE_BUS_READER_SPINS 64
+
+/*maximum number of messages module_publish_worker takes from a module queue in one critical section*/
+#define MESSAGE_BUS_RECEIVE_BATCH_SIZE 64
+
+/*number of slots of a batch kept for normal priority messages when both lanes of a module have messages, so high priority traffic cannot starve them*/
+#define MESSAGE_BUS_NORMAL_PRIORITY_RESERVE 8
+
+/*milliseconds stop_module waits on mq_cond before looking at MESSAGE_BUS_MODULEINFO::scheduled again, in case the task could not lock mq_lock to signal it*/
+#define MESSAGE_BUS_TASK_WAIT_MS 10
+
+/*atomic operations on the data shared by publishers and writers, all of them sequentially consistent*/
+#if defined(WIN32)
+#include <windows.h>
+typedef volatile LONG MESSAGE_BUS_COUNTER;
+#define MESSAGE_BUS_COUNTER_INC(counter) InterlockedIncrement(&(counter))
+#define MESSAGE_BUS_COUNTER_DEC(counter) InterlockedDecrement(&(counter))
+#define MESSAGE_BUS_COUNTER_GET(counter) InterlockedCompareExchange(&(counter), 0, 0)
+#define MESSAGE_BUS_COUNTER_SET(counter, value) (void)InterlockedExchange(&(counter), (LONG)(value))
+#define MESSAGE_BUS_POINTER_GET(pointer) InterlockedCompareExchangePointer((PVOID volatile*)&(pointer), NULL, NULL)
+#define MESSAGE_BUS_POINTER_SET(pointer, value) (void)InterlockedExchangePointer((PVOID volatile*)&(pointer), (value))
+typedef volatile LONGLONG MESSAGE_BUS_STAT;
+#define MESSAGE_BUS_STAT_ADD(stat, value) (void)InterlockedExchangeAdd64(&(stat), (LONGLONG)(value))
+#define MESSAGE_BUS_STAT_GET(stat) ((uint64_t)InterlockedCompareExchange64(&(stat), 0, 0))
+#define MESSAGE_BUS_STAT_SET(stat, value) (void)InterlockedExchange64(&(stat), (LONGLONG)(value))
+#elif defined(__GNUC__)
+typedef volatile long MESSAGE_BUS_COUNTER;
+#define MESSAGE_BUS_COUNTER_INC(counter) __atomic_add_fetch(&(counter), 1, __ATOMIC_SEQ_CST)
+#define MESSAGE_BUS_COUNTER_DEC(counter) __atomic_sub_fetch(&(counter), 1, __ATOMIC_SEQ_CST)
+#define MESSAGE_BUS_COUNTER_GET(counter) __atomic_load_n(&(counter), __ATOMIC_SEQ_CST)
+#define MESSAGE_BUS_COUNTER_SET(counter, value) __atomic_store_n(&(counter), (long)(value), __ATOMIC_SEQ_CST)
+#define MESSAGE_BUS_POINTER_GET(pointer) __atomic_load_n(&(pointer), __ATOMIC_SEQ_CST)
+#define MESSAGE_BUS_POINTER_SET(pointer, value) __atomic_store_n(&(pointer), (value), __ATOMIC_SEQ_CST)
+/*the statistics order nothing, relaxed is enough*/
+typedef volatile int64_t MESSAGE_BUS_STAT;
+#define MESSAGE_BUS_STAT_ADD(stat, value) (void)__atomic_add_fetch(&(stat), (int64_t)(value), __ATOMIC_RELAXED)
+#define MESSAGE_BUS_STAT_GET(stat) ((uint64_t)__atomic_load_n(&(stat), __ATOMIC_RELAXED))
+#define MESSAGE_BUS_STAT_SET(stat, value) __atomic_store_n(&(stat), (int64_t)(value), __ATOMIC_RELAXED)
+#else
+#error "the message bus needs atomic operations on this platform"
+#endif
+
+/*monotonic clock with a microsecond resolution the latencies and the time spent in the modules are measured with*/
+#if defined(WIN32)
+static uint64_t get_time_us(void)
+{
+    LARGE_INTEGER counter, frequency;
+    (void)QueryPerformanceCounter(&counter);
+    (void)QueryPerformanceFrequency(&frequency);
+    return ((uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000) + ((uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000 / (uint64_t)frequency.QuadPart);
+}
+#else
+#include <time.h>
+static uint64_t get_time_us(void)
+{
+    struct timespec now;
+    return (clock_gettime(CLOCK_MONOTONIC, &now) == 0) ? ((uint64_t)now.tv_sec * 1000000) + ((uint64_t)now.tv_nsec / 1000) : 0;
+}
+#endif
 
 /*The message bus implementation shall use the following definition as the backing structure for the message bus handle*/
 typedef struct MESSAGE_BUS_HANDLE_DATA_TAG
 {
     LIST_HANDLE				modules;
     LOCK_HANDLE             modules_lock;
+
+    /**
+    * Number of links on the bus. With MESSAGE_BUS_ROUTING_AUTOMATIC every
+    * message is broadcast to every module when this is 0.
+    */
+    size_t                  link_count;
+
+    MESSAGE_BUS_ROUTING     routing;
+
+    /**
+    * Index of the filters of the modules added with
+    * MessageBus_AddModuleWithFilter, NULL until the first such module.
+    */
+    SUBSCRIPTION_INDEX_HANDLE subscriptions;
+
+    /**
+    * The modules as seen by MessageBus_Publish, NULL until the first module
+    * is added. Publishers read it without taking 'modules_lock'; the
+    * functions changing the modules or the links replace it and free the
+    * old one once no publisher can be using it.
+    */
+    struct MESSAGE_BUS_SNAPSHOT_TAG* volatile snapshot;
+
+    /**
+    * Publishers in MessageBus_Publish, counted by the parity of 'epoch' at
+    * the time they started.
+    */
+    MESSAGE_BUS_COUNTER     epoch;
+    MESSAGE_BUS_COUNTER     readers[2];
+
+    /**
+    * Threads delivering the messages of all the modules, NULL when every
+    * module has its own thread.
+    */
+    WORKER_POOL_HANDLE      pool;
 }MESSAGE_BUS_HANDLE_DATA;
 
 DEFINE_REFCOUNT_TYPE(MESSAGE_BUS_HANDLE_DATA);
 
+/*A link as stored by the sink module of the link*/
+typedef struct MESSAGE_BUS_ROUTE_TAG
+{
+    MODULE_HANDLE           module_source;
+    char*                   filter_property;
+    char*                   filter_value;
+}MESSAGE_BUS_ROUTE;
+
+typedef union MESSAGE_BUS_MODULE_DATA_TAG
+{
+    MODULE_C_STYLE          c_style;
+    MODULE_CPP_STYLE        cpp_style;
+}MESSAGE_BUS_MODULE_DATA;
+
+/*A queue of messages for a module, see MESSAGE_BUS_MODULEINFO::lanes*/
+typedef struct MESSAGE_BUS_LANE_TAG
+{
+    MESSAGE_QUEUE_HANDLE    mq;
+
+    /**
+    * With MESSAGE_BUS_QUEUE_BLOCK, a condition variable that is signaled
+    * when messages leave 'mq'. NULL with the other policies.
+    */
+    COND_HANDLE             space_cond;
+
+    /**
+    * The latency of one message at a time is measured: while 'sampling',
+    * the message that was pushed at 'sample_us' has 'sample_ahead' messages
+    * in front of it.
+    */
+    bool                    sampling;
+    size_t                  sample_ahead;
+    uint64_t                sample_us;
+
+    /**
+    * The measured queue latencies.
+    */
+    size_t                  latency_samples;
+    uint64_t                latency_total_us;
+    uint64_t                latency_max_us;
+}MESSAGE_BUS_LANE;
+
+/**
+* The statistics of a module, see MessageBus_GetStatistics. They are written
+* and read without taking any lock.
+*/
+typedef struct MESSAGE_BUS_MODULE_STATS_TAG
+{
+    MESSAGE_BUS_STAT        enqueued;
+    MESSAGE_BUS_STAT        delivered;
+    MESSAGE_BUS_STAT        dropped;
+    MESSAGE_BUS_STAT        queued;
+
+    /**
+    * Only written with 'mq_lock' held, so it needs no compare and swap.
+    */
+    MESSAGE_BUS_STAT        queued_high_water;
+
+    MESSAGE_BUS_STAT        receive_time_us;
+    MESSAGE_BUS_STAT        latency_buckets[MESSAGE_BUS_LATENCY_BUCKET_COUNT];
+}MESSAGE_BUS_MODULE_STATS;
+
+/*Messages dequeued for a module by dequeue_batch, and the enqueue times of those whose latency is measured*/
+typedef struct MESSAGE_BUS_BATCH_TAG
+{
+    MESSAGE_HANDLE          messages[MESSAGE_BUS_RECEIVE_BATCH_SIZE];
+    size_t                  count;
+    uint64_t                sample_us[MESSAGE_BUS_PRIORITY_COUNT];
+    size_t                  sample_count;
+}MESSAGE_BUS_BATCH;
+
 typedef struct MESSAGE_BUS_MODULEINFO_TAG
 {
     /**
-    * Handle to the module that's connected to the bus.
+    * Type of the module that's connected to the bus.
+    */
+    MODULE_TYPE             module_type;
+
+    /**
+    * Copy of the module data handed to MessageBus_AddModule.
+    */
+    MESSAGE_BUS_MODULE_DATA module_data;
+
+    /**
+    * The receive_batch the module was added with, NULL to deliver every
+    * message through Module_Receive. Only used for NATIVE_C_TYPE modules.
+    */
+    pfModule_ReceiveBatch   receive_batch;
+
+    /**
+    * Handle to the module that's connected to the bus. This is what
+    * publishers pass as 'source' and what MessageBus_RemoveModule is
+    * called with.
+    */
+    MODULE_HANDLE           module_handle;
+
+    /**
+    * Links for which this module is the sink. Each element is a
+    * MESSAGE_BUS_ROUTE.
+    */
+    VECTOR_HANDLE           routes;
+
+    /**
+    * Whether the module was added with a filter, and the slot of the filter
+    * in MESSAGE_BUS_HANDLE_DATA::subscriptions.
     */
-    const MODULE*             module;
+    bool                    has_subscription;
+    size_t                  subscription_slot;
 
     /**
     * Handle to the thread on which this module's message processing loop is
@@ -46,12 +259,26 @@ typedef struct MESSAGE_BUS_MODULEINFO_TAG
     THREAD_HANDLE           thread;
 
     /**
-    * Handle to the queue of messages to be delivered to this module.
+    * When the bus has a worker pool, the pool that runs 'task' instead of
+    * 'thread', and whether 'task' is scheduled or running (1) or not (0).
+    * 'scheduled' is changed holding 'mq_lock', except by a task that cannot
+    * lock it, and keeps the module on at most one thread.
+    */
+    WORKER_POOL_HANDLE      pool;
+    WORKER_POOL_TASK        task;
+    MESSAGE_BUS_COUNTER     scheduled;
+
+    /**
+    * The queues of messages to be delivered to this module, one per
+    * MESSAGE_BUS_PRIORITY, all guarded by 'mq_lock'.
     */
-    VECTOR_HANDLE           mq;
+    MESSAGE_BUS_LANE        lanes[MESSAGE_BUS_PRIORITY_COUNT];
 
     /**
-    * Lock used to synchronize access to the 'mq' field.
+    * Lock used to synchronize access to the 'lanes' field. Publishers take
+    * it to enqueue rather than pushing lock-free, because the queue policy,
+    * the latency sample and waking the module up have to agree with the
+    * worker, which needs the lock to wait on 'mq_cond' anyway.
     */
     LOCK_HANDLE             mq_lock;
 
@@ -60,22 +287,83 @@ typedef struct MESSAGE_BUS_MODULEINFO_TAG
     */
     COND_HANDLE             mq_cond;
 
+    /**
+    * Capacity of each lane and what MessageBus_Publish does when it is full.
+    */
+    MESSAGE_BUS_QUEUE_CONFIG queue_config;
+
+    /**
+    * Counts of the messages of the module, including the ones dropped
+    * because a lane was full.
+    */
+    MESSAGE_BUS_MODULE_STATS stats;
+
+    /**
+    * The clock publishers measure their wait for room in a lane with.
+    */
+    TICK_COUNTER_HANDLE     tick_counter;
+
     /**
     * Message publish worker will keep running while this is false.
     */
     volatile sig_atomic_t   quit_worker;
+
+    /**
+    * Publishers that left their read side section to wait for room in a
+    * full MESSAGE_BUS_QUEUE_BLOCK lane. The module is not freed while this
+    * is not 0.
+    */
+    MESSAGE_BUS_COUNTER     waiting_publishers;
 }MESSAGE_BUS_MODULEINFO;
 
+/*A module as seen by MessageBus_Publish*/
+typedef struct MESSAGE_BUS_SNAPSHOT_ENTRY_TAG
+{
+    MESSAGE_BUS_MODULEINFO* module_info;
+    bool                    has_subscription;
+    size_t                  subscription_slot;
+    const MESSAGE_BUS_ROUTE* routes;
+    size_t                  route_count;
+}MESSAGE_BUS_SNAPSHOT_ENTRY;
+
+/**
+* An immutable copy of what MessageBus_Publish needs to know about the
+* modules and the links on the bus. The entries, the routes and their
+* strings live in the same allocation as the snapshot.
+*/
+typedef struct MESSAGE_BUS_SNAPSHOT_TAG
+{
+    const MESSAGE_BUS_SNAPSHOT_ENTRY* entries;
+    size_t                  entry_count;
+    /*false to deliver the messages to every module, true to deliver them along the routes only*/
+    bool                    routed;
+    SUBSCRIPTION_INDEX_HANDLE subscriptions;
+}MESSAGE_BUS_SNAPSHOT;
+
 // This variable is used only for unit testing purposes.
 size_t BUS_offsetof_quit_worker = offsetof(MESSAGE_BUS_MODULEINFO, quit_worker);
 
 MESSAGE_BUS_HANDLE MessageBus_Create(void)
+{
+    /*Codes_SRS_MESSAGE_BUS_13_158: [MessageBus_Create shall behave as MessageBus_Create2 called with a NULL config.]*/
+    return MessageBus_Create2(NULL);
+}
+
+MESSAGE_BUS_HANDLE MessageBus_Create2(const MESSAGE_BUS_CONFIG* config)
 {
     MESSAGE_BUS_HANDLE_DATA* result;
 
+    /*Codes_SRS_MESSAGE_BUS_13_186: [If config is not NULL and config->routing is not a MESSAGE_BUS_ROUTING value, MessageBus_Create2 shall return NULL.]*/
+    if ((config != NULL) &&
+        (config->routing != MESSAGE_BUS_ROUTING_AUTOMATIC) &&
+        (config->routing != MESSAGE_BUS_ROUTING_BROADCAST) &&
+        (config->routing != MESSAGE_BUS_ROUTING_LINKS))
+    {
+        LogError("invalid arg: routing=%d", (int)config->routing);
+        result = NULL;
+    }
     /*Codes_SRS_MESSAGE_BUS_13_067: [MessageBus_Create shall malloc a new instance of MESSAGE_BUS_HANDLE_DATA and return NULL if it fails.]*/
-    result = REFCOUNT_TYPE_CREATE(MESSAGE_BUS_HANDLE_DATA);
-    if (result == NULL)
+    else if ((result = REFCOUNT_TYPE_CREATE(MESSAGE_BUS_HANDLE_DATA)) == NULL)
     {
         LogError("malloc returned NULL");
         /*return as is*/
@@ -93,6 +381,21 @@ MESSAGE_BUS_HANDLE MessageBus_Create(void)
         }
         else
         {
+            /*Codes_SRS_MESSAGE_BUS_13_116: [MessageBus_Create shall initialize MESSAGE_BUS_HANDLE_DATA::link_count to 0.]*/
+            result->link_count = 0;
+
+            /*Codes_SRS_MESSAGE_BUS_13_187: [MessageBus_Create2 shall initialize MESSAGE_BUS_HANDLE_DATA::routing to config->routing, or to MESSAGE_BUS_ROUTING_AUTOMATIC if config is NULL.]*/
+            result->routing = (config == NULL) ? MESSAGE_BUS_ROUTING_AUTOMATIC : config->routing;
+
+            /*Codes_SRS_MESSAGE_BUS_13_131: [MessageBus_Create shall initialize MESSAGE_BUS_HANDLE_DATA::subscriptions to NULL.]*/
+            result->subscriptions = NULL;
+
+            /*Codes_SRS_MESSAGE_BUS_13_139: [MessageBus_Create shall initialize MESSAGE_BUS_HANDLE_DATA::snapshot to NULL and the reader counts to 0.]*/
+            result->snapshot = NULL;
+            result->epoch = 0;
+            result->readers[0] = 0;
+            result->readers[1] = 0;
+
             /*Codes_SRS_MESSAGE_BUS_13_023: [MessageBus_Create shall initialize MESSAGE_BUS_HANDLE_DATA::modules_lock with a valid LOCK_HANDLE.]*/
             result->modules_lock = Lock_Init();
             if (result->modules_lock == NULL)
@@ -103,6 +406,25 @@ MESSAGE_BUS_HANDLE MessageBus_Create(void)
                 free(result);
                 result = NULL;
             }
+            /*Codes_SRS_MESSAGE_BUS_13_159: [If config is NULL or config->use_worker_pool is false, MessageBus_Create2 shall initialize MESSAGE_BUS_HANDLE_DATA::pool to NULL.]*/
+            else if ((config == NULL) || (config->use_worker_pool == false))
+            {
+                result->pool = NULL;
+            }
+            /*Codes_SRS_MESSAGE_BUS_13_160: [Otherwise MessageBus_Create2 shall initialize MESSAGE_BUS_HANDLE_DATA::pool by calling WorkerPool_CreateWithThreadExit with config->worker_count and MessagePool_ReleaseThreadCache, so that the message blocks cached by the pool threads are not lost.]*/
+            else if ((result->pool = WorkerPool_CreateWithThreadExit(config->worker_count, MessagePool_ReleaseThreadCache)) == NULL)
+            {
+                /*Codes_SRS_MESSAGE_BUS_13_003: [This function shall return NULL if an underlying API call to the platform causes an error.]*/
+                LogError("WorkerPool_Create failed");
+                Lock_Deinit(result->modules_lock);
+                list_destroy(result->modules);
+                free(result);
+                result = NULL;
+            }
+            else
+            {
+                /*all is fine*/
+            }
         }
     }
 
@@ -124,6 +446,178 @@ void MessageBus_IncRef(MESSAGE_BUS_HANDLE bus)
     }
 }
 
+/*hands the messages dequeued by module_publish_worker to the module, in one call if it implements Module_ReceiveBatch*/
+static void deliver_messages(MESSAGE_BUS_MODULEINFO* module_info, MESSAGE_HANDLE* messages, size_t count)
+{
+    size_t i;
+    switch (module_info->module_type)
+    {
+    case NATIVE_C_TYPE:
+        if (module_info->receive_batch != NULL)
+        {
+            /*Codes_SRS_MESSAGE_BUS_13_145: [If the module is a NATIVE_C_TYPE module added with a receive_batch that is not NULL, the function shall deliver all the dequeued messages to it in one call.]*/
+            module_info->receive_batch(module_info->module_handle, messages, count);
+        }
+        else
+        {
+            /*Codes_SRS_MESSAGE_BUS_13_092: [Otherwise the function shall deliver the messages one at a time, in order, to the module's callback function via module_info->module_apis.]*/
+            for (i = 0; i < count; i++)
+            {
+                module_info->module_data.c_style.module_apis->Module_Receive(module_info->module_handle, messages[i]);
+            }
+        }
+        break;
+
+    case MODERN_CPP_TYPE:
+        /*Codes_SRS_MESSAGE_BUS_13_092: [Otherwise the function shall deliver the messages one at a time, in order, to the module's callback function via module_info->module_apis.]*/
+        for (i = 0; i < count; i++)
+        {
+            ((IInternalGatewayModule*)module_info->module_data.cpp_style.module_instance)->Module_Receive(module_info->module_handle, messages[i]);
+        }
+        break;
+    }
+}
+
+/*tells whether any lane of the module has messages; called with mq_lock held*/
+static bool module_has_messages(MESSAGE_BUS_MODULEINFO* module_info)
+{
+    size_t i;
+    for (i = 0; i < MESSAGE_BUS_PRIORITY_COUNT; i++)
+    {
+        if (MessageQueue_IsEmpty(module_info->lanes[i].mq) == false)
+        {
+            break;
+        }
+    }
+    return (i < MESSAGE_BUS_PRIORITY_COUNT);
+}
+
+/*appends msg to the lane and starts measuring its latency unless a message of the lane is already being measured; called with mq_lock held*/
+static MESSAGE_QUEUE_RESULT lane_push(MESSAGE_BUS_MODULEINFO* module_info, MESSAGE_BUS_LANE* lane, MESSAGE_HANDLE msg)
+{
+    MESSAGE_QUEUE_RESULT result = MessageQueue_Push(lane->mq, msg);
+
+    if (result == MESSAGE_QUEUE_OK)
+    {
+        /*Codes_SRS_MESSAGE_BUS_13_175: [MessageBus_Publish shall count every message appended to a lane of the module as enqueued and queued, and raise the queue depth high-water mark of the module if the number of queued messages exceeds it.]*/
+        MESSAGE_BUS_STAT_ADD(module_info->stats.enqueued, 1);
+        MESSAGE_BUS_STAT_ADD(module_info->stats.queued, 1);
+        if (MESSAGE_BUS_STAT_GET(module_info->stats.queued) > MESSAGE_BUS_STAT_GET(module_info->stats.queued_high_water))
+        {
+            MESSAGE_BUS_STAT_SET(module_info->stats.queued_high_water, MESSAGE_BUS_STAT_GET(module_info->stats.queued));
+        }
+
+        /*Codes_SRS_MESSAGE_BUS_13_171: [If no message of the lane is being measured, MessageBus_Publish shall record the time at which the message was appended and the number of messages ahead of it.]*/
+        if (lane->sampling == false)
+        {
+            lane->sampling = true;
+            lane->sample_ahead = MessageQueue_Size(lane->mq) - 1;
+            lane->sample_us = get_time_us();
+        }
+    }
+
+    return result;
+}
+
+/*accounts for 'count' messages having left the front of the lane, either to be delivered in 'batch' or dropped when 'batch' is NULL; called with mq_lock held*/
+static void lane_popped(MESSAGE_BUS_MODULEINFO* module_info, MESSAGE_BUS_LANE* lane, size_t count, MESSAGE_BUS_BATCH* batch)
+{
+    MESSAGE_BUS_STAT_ADD(module_info->stats.queued, -(int64_t)count);
+
+    if (lane->sampling)
+    {
+        if (count <= lane->sample_ahead)
+        {
+            lane->sample_ahead -= count;
+        }
+        else
+        {
+            lane->sampling = false;
+
+            /*Codes_SRS_MESSAGE_BUS_13_172: [When the measured message is dequeued to be delivered, its queue latency shall be added to the latency counters of the lane. A measured message that is dropped shall not be counted.]*/
+            if (batch != NULL)
+            {
+                uint64_t latency_us = get_time_us() - lane->sample_us;
+                lane->latency_samples++;
+                lane->latency_total_us += latency_us;
+                if (latency_us > lane->latency_max_us)
+                {
+                    lane->latency_max_us = latency_us;
+                }
+
+                batch->sample_us[batch->sample_count++] = lane->sample_us;
+            }
+        }
+    }
+}
+
+/*dequeues up to MESSAGE_BUS_RECEIVE_BATCH_SIZE messages of the module, high priority first; called with mq_lock held*/
+static void dequeue_batch(MESSAGE_BUS_MODULEINFO* module_info, MESSAGE_BUS_BATCH* batch)
+{
+    MESSAGE_BUS_LANE* high = &module_info->lanes[MESSAGE_BUS_PRIORITY_HIGH];
+    MESSAGE_BUS_LANE* normal = &module_info->lanes[MESSAGE_BUS_PRIORITY_NORMAL];
+    size_t high_count, normal_count;
+
+    /*Codes_SRS_MESSAGE_BUS_13_169: [The function shall dequeue the high priority messages first, leaving MESSAGE_BUS_NORMAL_PRIORITY_RESERVE slots of the batch to the normal priority messages when there are any.]*/
+    high_count = MessageQueue_PopBatch(high->mq, batch->messages,
+        MessageQueue_IsEmpty(normal->mq) ? MESSAGE_BUS_RECEIVE_BATCH_SIZE : (MESSAGE_BUS_RECEIVE_BATCH_SIZE - MESSAGE_BUS_NORMAL_PRIORITY_RESERVE));
+    normal_count = MessageQueue_PopBatch(normal->mq, batch->messages + high_count, MESSAGE_BUS_RECEIVE_BATCH_SIZE - high_count);
+
+    batch->count = high_count + normal_count;
+    batch->sample_count = 0;
+    lane_popped(module_info, high, high_count, batch);
+    lane_popped(module_info, normal, normal_count, batch);
+
+    /*Codes_SRS_MESSAGE_BUS_13_150: [If the module's queue policy is MESSAGE_BUS_QUEUE_BLOCK, the function shall signal the space_cond of every lane it dequeued messages from.]*/
+    if ((high_count > 0) && (high->space_cond != NULL) && (Condition_Post(high->space_cond) != COND_OK))
+    {
+        LogError("Condition_Post failed for module [%p]", module_info);
+    }
+    if ((normal_count > 0) && (normal->space_cond != NULL) && (Condition_Post(normal->space_cond) != COND_OK))
+    {
+        LogError("Condition_Post failed for module [%p]", module_info);
+    }
+}
+
+/*bucket of MESSAGE_BUS_MODULE_STATISTICS::latency_buckets counting a latency*/
+static size_t get_latency_bucket(uint64_t latency_us)
+{
+    size_t result = 0;
+    while ((latency_us > 1) && (result < MESSAGE_BUS_LATENCY_BUCKET_COUNT - 1))
+    {
+        latency_us >>= 1;
+        result++;
+    }
+    return result;
+}
+
+/*delivers the batch to the module without holding mq_lock, destroys its messages and updates the statistics of the module*/
+static void deliver_batch(MESSAGE_BUS_MODULEINFO* module_info, MESSAGE_BUS_BATCH* batch)
+{
+    uint64_t start_us, end_us;
+    size_t i;
+
+    start_us = get_time_us();
+    deliver_messages(module_info, batch->messages, batch->count);
+    end_us = get_time_us();
+
+    /*Codes_SRS_MESSAGE_BUS_13_176: [The function shall count the delivered messages and the time spent delivering them to the module.]*/
+    MESSAGE_BUS_STAT_ADD(module_info->stats.delivered, batch->count);
+    MESSAGE_BUS_STAT_ADD(module_info->stats.receive_time_us, end_us - start_us);
+
+    /*Codes_SRS_MESSAGE_BUS_13_177: [For every measured message of the batch, the function shall count the time from its enqueuing to the return of the module in the latency histogram of the module.]*/
+    for (i = 0; i < batch->sample_count; i++)
+    {
+        MESSAGE_BUS_STAT_ADD(module_info->stats.latency_buckets[get_latency_bucket(end_us - batch->sample_us[i])], 1);
+    }
+
+    /*Codes_SRS_MESSAGE_BUS_13_093: [The function shall destroy the messages that were dequeued by calling Message_Destroy.]*/
+    for (i = 0; i < batch->count; i++)
+    {
+        Message_Destroy(batch->messages[i]);
+    }
+}
+
 /**
 * This is the worker function that runs for each module. The module_publish_worker
 * function is passed in a pointer to the relevant MODULE_INFO object as it's
@@ -152,45 +646,34 @@ static int module_publish_worker(void * user_data)
 
             /*this condition accounts for the case where the message has been enqueued in the past, and the condition has been signalled in the past, and this thread */
             /*is still at static int module_publish_worker(void * user_data), that is, didn't get to execute Lock(...)*/
-            if ((VECTOR_size(module_info->mq) > 0) || (Condition_Wait(module_info->mq_cond, module_info->mq_lock, 0) == COND_OK))
+            if (module_has_messages(module_info) || (Condition_Wait(module_info->mq_cond, module_info->mq_lock, 0) == COND_OK))
             {
                 /*Codes_SRS_MESSAGE_BUS_13_090: [When module_info->mq_cond has been signaled this function shall kick off another loop predicated on module_info->quit_worker being equal to 0 and module_info->mq not being empty.This thread has the lock on module_info->mq_lock at this point.]*/
                 LOCK_RESULT lock_result = LOCK_OK;
-                while ((module_info->quit_worker == 0) && VECTOR_size(module_info->mq) > 0)
+                while ((module_info->quit_worker == 0) && module_has_messages(module_info))
                 {
-                    /*Codes_SRS_MESSAGE_BUS_13_069: [The function shall dequeue a message from the module's message queue. ]*/
-                    MESSAGE_HANDLE *pmsg = (MESSAGE_HANDLE*)VECTOR_front(module_info->mq);
-                    MESSAGE_HANDLE msg = *pmsg;
-                    VECTOR_erase(module_info->mq, pmsg, 1);
+                    MESSAGE_BUS_BATCH batch;
+                    size_t i;
+
+                    /*Codes_SRS_MESSAGE_BUS_13_069: [The function shall dequeue the messages of the module's lanes, up to MESSAGE_BUS_RECEIVE_BATCH_SIZE of them, by calling MessageQueue_PopBatch once per lane.]*/
+                    dequeue_batch(module_info, &batch);
 
                     /*Codes_SRS_MESSAGE_BUS_13_091: [The function shall unlock module_info->mq_lock.]*/
                     if (Unlock(module_info->mq_lock) != LOCK_OK)
                     {
                         LogError("unable to unlock");
 
-                        /*Codes_SRS_MESSAGE_BUS_13_093: [The function shall destroy the message that was dequeued by calling Message_Destroy.]*/
-                        Message_Destroy(msg);
+                        /*Codes_SRS_MESSAGE_BUS_13_093: [The function shall destroy the messages that were dequeued by calling Message_Destroy.]*/
+                        for (i = 0; i < batch.count; i++)
+                        {
+                            Message_Destroy(batch.messages[i]);
+                        }
 
                         continue;
                     }
                     else
                     {
-						switch (module_info->module->module_type)
-						{
-						case NATIVE_C_TYPE:
-							/*Codes_SRS_MESSAGE_BUS_13_092: [The function shall deliver the message to the module's callback function via module_info->module_apis. ]*/
-							((MODULE_C_STYLE*)module_info->module->module_data)->module_apis->Module_Receive(((MODULE_C_STYLE*)module_info->module->module_data)->module_handle, msg);
-							break;
-
-						case MODERN_CPP_TYPE:
-							/*Codes_SRS_MESSAGE_BUS_13_092: [The function shall deliver the message to the module's callback function via module_info->module_apis. ]*/
-							((IInternalGatewayModule*)((MODULE_CPP_STYLE*)module_info->module->module_data)->module_instance)->Module_Receive(((MODULE_HANDLE)((MODULE_CPP_STYLE*)module_info->module->module_data)->module_instance), msg);
-							break;
-
-						}
-
-                        /*Codes_SRS_MESSAGE_BUS_13_093: [The function shall destroy the message that was dequeued by calling Message_Destroy.]*/
-                        Message_Destroy(msg);
+                        deliver_batch(module_info, &batch);
 
                         /*Codes_SRS_MESSAGE_BUS_13_094: [The function shall re - acquire the lock on module_info->mq_lock.]*/
                         if ((lock_result = Lock(module_info->mq_lock)) != LOCK_OK)
@@ -215,78 +698,143 @@ static int module_publish_worker(void * user_data)
         }
     }
 
-    
+    /*Codes_SRS_MESSAGE_BUS_13_193: [Before it exits, the function shall call MessagePool_ReleaseThreadCache so that the message blocks cached by the thread are not lost.]*/
+    MessagePool_ReleaseThreadCache();
 
     return 0;
 }
 
-static MESSAGE_BUS_RESULT init_module(MESSAGE_BUS_MODULEINFO* module_info, const MODULE* module)
+/*the task cannot lock mq_lock: tell stop_module that it has finished anyway. 'scheduled' is cleared last, stop_module may free the module as soon as it sees it*/
+static void abandon_task(MESSAGE_BUS_MODULEINFO* module_info)
 {
-    MESSAGE_BUS_RESULT result;
+    LogError("unable to lock, the module is not scheduled anymore");
+    if (Condition_Post(module_info->mq_cond) != COND_OK)
+    {
+        LogError("Condition_Post failed for module [%p]", module_info);
+    }
+    MESSAGE_BUS_COUNTER_SET(module_info->scheduled, 0);
+}
 
-    /*Codes_SRS_MESSAGE_BUS_13_107: The function shall assign the `module` handle to `MESSAGE_BUS_MODULEINFO::module`.*/
-    module_info->module = module;
+/**
+* What a module's thread does, run as a task of the bus' worker pool: deliver
+* one batch of the module's messages and schedule the module again while
+* there are more. The module is only ever scheduled once so its messages are
+* still delivered one batch at a time, in order.
+*/
+static void module_pool_task(void* context)
+{
+    MESSAGE_BUS_MODULEINFO* module_info = (MESSAGE_BUS_MODULEINFO*)context;
 
-    /*Codes_SRS_MESSAGE_BUS_13_098: [The function shall initialize MESSAGE_BUS_MODULEINFO::mq with a valid vector handle.]*/
-    module_info->mq = VECTOR_create(sizeof(MESSAGE_HANDLE));
-    if (module_info->mq == NULL)
+    if (Lock(module_info->mq_lock) != LOCK_OK)
     {
-        LogError("VECTOR_create failed");
-        result = MESSAGE_BUS_ERROR;
+        /*Codes_SRS_MESSAGE_BUS_13_197: [If the task cannot lock MESSAGE_BUS_MODULEINFO::mq_lock, it shall signal MESSAGE_BUS_MODULEINFO::mq_cond and set MESSAGE_BUS_MODULEINFO::scheduled to 0 without delivering anything.]*/
+        abandon_task(module_info);
     }
     else
     {
-        /*Codes_SRS_MESSAGE_BUS_13_099: [The function shall initialize MESSAGE_BUS_MODULEINFO::mq_lock with a valid lock handle.]*/
-        module_info->mq_lock = Lock_Init();
-        if (module_info->mq_lock == NULL)
+        MESSAGE_BUS_BATCH batch;
+        batch.count = 0;
+
+        /*Codes_SRS_MESSAGE_BUS_13_162: [The task shall dequeue up to MESSAGE_BUS_RECEIVE_BATCH_SIZE messages as module_publish_worker does, unless MESSAGE_BUS_MODULEINFO::quit_worker is not 0.]*/
+        if (module_info->quit_worker == 0)
         {
-            LogError("Lock_Init failed");
-            VECTOR_destroy(module_info->mq);
-            result = MESSAGE_BUS_ERROR;
+            dequeue_batch(module_info, &batch);
+        }
+        (void)Unlock(module_info->mq_lock);
+
+        /*Codes_SRS_MESSAGE_BUS_13_163: [The task shall deliver the messages to the module without holding MESSAGE_BUS_MODULEINFO::mq_lock and destroy them.]*/
+        if (batch.count > 0)
+        {
+            deliver_batch(module_info, &batch);
+        }
+
+        if (Lock(module_info->mq_lock) != LOCK_OK)
+        {
+            /*Codes_SRS_MESSAGE_BUS_13_197: [If the task cannot lock MESSAGE_BUS_MODULEINFO::mq_lock, it shall signal MESSAGE_BUS_MODULEINFO::mq_cond and set MESSAGE_BUS_MODULEINFO::scheduled to 0 without delivering anything.]*/
+            abandon_task(module_info);
         }
         else
         {
-            /*Codes_SRS_MESSAGE_BUS_13_100: [The function shall initialize MESSAGE_BUS_MODULEINFO::mq_cond with a valid condition handle.]*/
-            module_info->mq_cond = Condition_Init();
-            if (module_info->mq_cond == NULL)
+            /*Codes_SRS_MESSAGE_BUS_13_164: [If MESSAGE_BUS_MODULEINFO::quit_worker is 0 and the queue is not empty, the task shall schedule itself again on the worker pool.]*/
+            if ((module_info->quit_worker == 0) &&
+                module_has_messages(module_info) &&
+                (WorkerPool_Schedule(module_info->pool, &module_info->task) == WORKER_POOL_OK))
             {
-                LogError("Condition_Init failed");
-                Lock_Deinit(module_info->mq_lock);
-                VECTOR_destroy(module_info->mq);
-                result = MESSAGE_BUS_ERROR;
+                /*still scheduled*/
             }
             else
             {
-                /*Codes_SRS_MESSAGE_BUS_13_101: [The function shall assign 0 to MESSAGE_BUS_MODULEINFO::quit_worker.]*/
-                module_info->quit_worker = 0;
-                result = MESSAGE_BUS_OK;
+                /*Codes_SRS_MESSAGE_BUS_13_165: [Otherwise the task shall set MESSAGE_BUS_MODULEINFO::scheduled to 0 and signal MESSAGE_BUS_MODULEINFO::mq_cond.]*/
+                MESSAGE_BUS_COUNTER_SET(module_info->scheduled, 0);
+                if (Condition_Post(module_info->mq_cond) != COND_OK)
+                {
+                    LogError("Condition_Post failed for module [%p]", module_info);
+                }
             }
+            (void)Unlock(module_info->mq_lock);
         }
     }
+}
+
+/*tells the module's thread, or the worker pool, that there are messages for the module; called holding mq_lock*/
+static int wake_module(MESSAGE_BUS_MODULEINFO* module_info)
+{
+    int result;
+
+    if (module_info->pool == NULL)
+    {
+        result = (Condition_Post(module_info->mq_cond) == COND_OK) ? 0 : __LINE__;
+    }
+    else if (MESSAGE_BUS_COUNTER_GET(module_info->scheduled) != 0)
+    {
+        /*Codes_SRS_MESSAGE_BUS_13_161: [If the bus has a worker pool, the function shall instead schedule MESSAGE_BUS_MODULEINFO::task on it, unless it is already scheduled or running.]*/
+        result = 0;
+    }
+    else if (WorkerPool_Schedule(module_info->pool, &module_info->task) != WORKER_POOL_OK)
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        MESSAGE_BUS_COUNTER_SET(module_info->scheduled, 1);
+        result = 0;
+    }
 
     return result;
 }
 
-static void deinit_module(MESSAGE_BUS_MODULEINFO* module_info)
+static void deinit_lane(MESSAGE_BUS_LANE* lane)
 {
-    /*Codes_SRS_MESSAGE_BUS_13_057: [The function shall free all members of the MODULE_INFO object.]*/
-    VECTOR_destroy(module_info->mq);
-    Condition_Deinit(module_info->mq_cond);
-    Lock_Deinit(module_info->mq_lock);
+    MessageQueue_Destroy(lane->mq);
+    if (lane->space_cond != NULL)
+    {
+        Condition_Deinit(lane->space_cond);
+    }
 }
 
-static MESSAGE_BUS_RESULT start_module(MESSAGE_BUS_MODULEINFO* module_info)
+static MESSAGE_BUS_RESULT init_lane(MESSAGE_BUS_MODULEINFO* module_info, MESSAGE_BUS_LANE* lane)
 {
     MESSAGE_BUS_RESULT result;
 
-    /*Codes_SRS_MESSAGE_BUS_13_102: [The function shall create a new thread for the module by calling ThreadAPI_Create using module_publish_worker as the thread callback and using the newly allocated MESSAGE_BUS_MODULEINFO object as the thread context.*/
-    if (ThreadAPI_Create(
-        &(module_info->thread),
-        module_publish_worker,
-        (void*)module_info
-        ) != THREADAPI_OK)
+    lane->space_cond = NULL;
+    lane->sampling = false;
+    lane->sample_ahead = 0;
+    lane->sample_us = 0;
+    lane->latency_samples = 0;
+    lane->latency_total_us = 0;
+    lane->latency_max_us = 0;
+
+    /*Codes_SRS_MESSAGE_BUS_13_098: [The function shall initialize every lane of MESSAGE_BUS_MODULEINFO::lanes with a valid message queue handle holding at most MESSAGE_BUS_MODULEINFO::queue_config.capacity messages.]*/
+    if ((lane->mq = MessageQueue_Create(0, module_info->queue_config.capacity)) == NULL)
     {
-        LogError("ThreadAPI_Create failed");
+        LogError("MessageQueue_Create failed");
+        result = MESSAGE_BUS_ERROR;
+    }
+    /*Codes_SRS_MESSAGE_BUS_13_147: [If the queue policy is MESSAGE_BUS_QUEUE_BLOCK, the function shall initialize the space_cond of every lane with a valid condition handle.]*/
+    else if ((module_info->queue_config.policy == MESSAGE_BUS_QUEUE_BLOCK) && ((lane->space_cond = Condition_Init()) == NULL))
+    {
+        LogError("Condition_Init failed");
+        MessageQueue_Destroy(lane->mq);
         result = MESSAGE_BUS_ERROR;
     }
     else
@@ -297,14 +845,264 @@ static MESSAGE_BUS_RESULT start_module(MESSAGE_BUS_MODULEINFO* module_info)
     return result;
 }
 
-/*stop module means: stop the thread that feeds messages to Module_Receive function + deletion of all queued messages */
-/*returns 0 if success, otherwise __LINE__*/
-static int stop_module(MESSAGE_BUS_MODULEINFO* module_info)
+static void deinit_lanes(MESSAGE_BUS_MODULEINFO* module_info)
 {
-    int thread_result, result;
-    size_t len, i;
-    /*Codes_SRS_MESSAGE_BUS_02_001: [ MessageBus_RemoveModule shall lock `MESSAGE_BUS_MODULEINFO::mq_lock`. ]*/
-    if (Lock(module_info->mq_lock) != LOCK_OK)
+    size_t i;
+    for (i = 0; i < MESSAGE_BUS_PRIORITY_COUNT; i++)
+    {
+        deinit_lane(&module_info->lanes[i]);
+    }
+    tickcounter_destroy(module_info->tick_counter);
+}
+
+/*creates the queues of the module and the clock their latency is measured with*/
+static MESSAGE_BUS_RESULT init_lanes(MESSAGE_BUS_MODULEINFO* module_info)
+{
+    MESSAGE_BUS_RESULT result;
+
+    /*Codes_SRS_MESSAGE_BUS_13_170: [The function shall initialize MESSAGE_BUS_MODULEINFO::tick_counter with a valid tick counter.]*/
+    if ((module_info->tick_counter = tickcounter_create()) == NULL)
+    {
+        LogError("tickcounter_create failed");
+        result = MESSAGE_BUS_ERROR;
+    }
+    else
+    {
+        size_t i;
+        for (i = 0; i < MESSAGE_BUS_PRIORITY_COUNT; i++)
+        {
+            if (init_lane(module_info, &module_info->lanes[i]) != MESSAGE_BUS_OK)
+            {
+                break;
+            }
+        }
+
+        if (i < MESSAGE_BUS_PRIORITY_COUNT)
+        {
+            while (i > 0)
+            {
+                deinit_lane(&module_info->lanes[--i]);
+            }
+            tickcounter_destroy(module_info->tick_counter);
+            result = MESSAGE_BUS_ERROR;
+        }
+        else
+        {
+            result = MESSAGE_BUS_OK;
+        }
+    }
+
+    return result;
+}
+
+static MESSAGE_BUS_RESULT init_module(MESSAGE_BUS_MODULEINFO* module_info, const MODULE* module, const MESSAGE_BUS_QUEUE_CONFIG* queue_config, pfModule_ReceiveBatch receive_batch, WORKER_POOL_HANDLE pool)
+{
+    MESSAGE_BUS_RESULT result;
+
+    /*Codes_SRS_MESSAGE_BUS_13_107: [The function shall copy `module` into `MESSAGE_BUS_MODULEINFO` and assign the module's `MODULE_HANDLE` to `MESSAGE_BUS_MODULEINFO::module_handle`.]*/
+    module_info->module_type = module->module_type;
+    if (module->module_type == NATIVE_C_TYPE)
+    {
+        module_info->module_data.c_style = *((const MODULE_C_STYLE*)module->module_data);
+        module_info->module_handle = module_info->module_data.c_style.module_handle;
+    }
+    else
+    {
+        module_info->module_data.cpp_style = *((const MODULE_CPP_STYLE*)module->module_data);
+        module_info->module_handle = (MODULE_HANDLE)module_info->module_data.cpp_style.module_instance;
+    }
+
+    /*Codes_SRS_MESSAGE_BUS_13_196: [The function shall keep receive_batch in MESSAGE_BUS_MODULEINFO::receive_batch if the module is a NATIVE_C_TYPE module, and NULL otherwise.]*/
+    module_info->receive_batch = (module->module_type == NATIVE_C_TYPE) ? receive_batch : NULL;
+
+    /*Codes_SRS_MESSAGE_BUS_13_146: [The function shall copy queue_config into MESSAGE_BUS_MODULEINFO::queue_config, or use an unbounded queue if queue_config is NULL.]*/
+    if (queue_config == NULL)
+    {
+        module_info->queue_config.capacity = 0;
+        module_info->queue_config.policy = MESSAGE_BUS_QUEUE_DROP_NEWEST;
+        module_info->queue_config.timeout_ms = 0;
+    }
+    else
+    {
+        module_info->queue_config = *queue_config;
+    }
+    /*Codes_SRS_MESSAGE_BUS_13_174: [The function shall set the statistics of the module to 0.]*/
+    memset(&module_info->stats, 0, sizeof(module_info->stats));
+
+    if (init_lanes(module_info) != MESSAGE_BUS_OK)
+    {
+        result = MESSAGE_BUS_ERROR;
+    }
+    else
+    {
+        /*Codes_SRS_MESSAGE_BUS_13_099: [The function shall initialize MESSAGE_BUS_MODULEINFO::mq_lock with a valid lock handle.]*/
+        module_info->mq_lock = Lock_Init();
+        if (module_info->mq_lock == NULL)
+        {
+            LogError("Lock_Init failed");
+            deinit_lanes(module_info);
+            result = MESSAGE_BUS_ERROR;
+        }
+        else
+        {
+            /*Codes_SRS_MESSAGE_BUS_13_100: [The function shall initialize MESSAGE_BUS_MODULEINFO::mq_cond with a valid condition handle.]*/
+            module_info->mq_cond = Condition_Init();
+            if (module_info->mq_cond == NULL)
+            {
+                LogError("Condition_Init failed");
+                Lock_Deinit(module_info->mq_lock);
+                deinit_lanes(module_info);
+                result = MESSAGE_BUS_ERROR;
+            }
+            else
+            {
+                /*Codes_SRS_MESSAGE_BUS_13_114: [The function shall initialize MESSAGE_BUS_MODULEINFO::routes with a valid VECTOR_HANDLE.]*/
+                module_info->routes = VECTOR_create(sizeof(MESSAGE_BUS_ROUTE));
+                if (module_info->routes == NULL)
+                {
+                    LogError("VECTOR_create failed");
+                    Condition_Deinit(module_info->mq_cond);
+                    Lock_Deinit(module_info->mq_lock);
+                    deinit_lanes(module_info);
+                    result = MESSAGE_BUS_ERROR;
+                }
+                else
+                {
+                    /*Codes_SRS_MESSAGE_BUS_13_101: [The function shall assign 0 to MESSAGE_BUS_MODULEINFO::quit_worker.]*/
+                    module_info->quit_worker = 0;
+                    module_info->waiting_publishers = 0;
+                    module_info->has_subscription = false;
+                    module_info->subscription_slot = 0;
+                    module_info->pool = pool;
+                    module_info->task.function = module_pool_task;
+                    module_info->task.context = module_info;
+                    module_info->task.next = NULL;
+                    module_info->scheduled = 0;
+                    result = MESSAGE_BUS_OK;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+static void destroy_route(MESSAGE_BUS_ROUTE* route)
+{
+    free(route->filter_property);
+    free(route->filter_value);
+}
+
+static void deinit_module(MESSAGE_BUS_MODULEINFO* module_info)
+{
+    size_t i, route_count = VECTOR_size(module_info->routes);
+    for (i = 0; i < route_count; i++)
+    {
+        destroy_route((MESSAGE_BUS_ROUTE*)VECTOR_element(module_info->routes, i));
+    }
+
+    /*Codes_SRS_MESSAGE_BUS_13_057: [The function shall free all members of the MODULE_INFO object.]*/
+    VECTOR_destroy(module_info->routes);
+    Condition_Deinit(module_info->mq_cond);
+    Lock_Deinit(module_info->mq_lock);
+    deinit_lanes(module_info);
+}
+
+static MESSAGE_BUS_RESULT start_module(MESSAGE_BUS_MODULEINFO* module_info)
+{
+    MESSAGE_BUS_RESULT result;
+
+    if (module_info->pool != NULL)
+    {
+        /*Codes_SRS_MESSAGE_BUS_13_166: [If the bus has a worker pool, the function shall not create a thread for the module.]*/
+        result = MESSAGE_BUS_OK;
+    }
+    /*Codes_SRS_MESSAGE_BUS_13_102: [The function shall create a new thread for the module by calling ThreadAPI_Create using module_publish_worker as the thread callback and using the newly allocated MESSAGE_BUS_MODULEINFO object as the thread context.*/
+    else if (ThreadAPI_Create(
+        &(module_info->thread),
+        module_publish_worker,
+        (void*)module_info
+        ) != THREADAPI_OK)
+    {
+        LogError("ThreadAPI_Create failed");
+        result = MESSAGE_BUS_ERROR;
+    }
+    else
+    {
+        result = MESSAGE_BUS_OK;
+    }
+
+    return result;
+}
+
+/*delivers the messages left in the lanes of a stopped module on the calling thread, a batch at a time, until the lanes are empty or the deadline has passed*/
+static void drain_module(MESSAGE_BUS_MODULEINFO* module_info, uint64_t drain_deadline_us, MESSAGE_BUS_DRAIN_RESULT* drain_result)
+{
+    bool draining = true;
+    while (draining && (get_time_us() < drain_deadline_us))
+    {
+        MESSAGE_BUS_BATCH batch;
+        if (Lock(module_info->mq_lock) != LOCK_OK)
+        {
+            LogError("unable to lock mq_lock, the messages left are not delivered");
+            draining = false;
+        }
+        else
+        {
+            dequeue_batch(module_info, &batch);
+            (void)Unlock(module_info->mq_lock);
+
+            if (batch.count == 0)
+            {
+                draining = false;
+            }
+            else
+            {
+                deliver_batch(module_info, &batch);
+                drain_result->delivered += batch.count;
+            }
+        }
+    }
+}
+
+/*wakes the publishers waiting for room in the lanes of a stopping module and waits until none of them uses it any longer*/
+static void release_waiting_publishers(MESSAGE_BUS_MODULEINFO* module_info)
+{
+    while (MESSAGE_BUS_COUNTER_GET(module_info->waiting_publishers) != 0)
+    {
+        if (Lock(module_info->mq_lock) != LOCK_OK)
+        {
+            LogError("unable to lock mq_lock");
+        }
+        else
+        {
+            size_t i;
+            for (i = 0; i < MESSAGE_BUS_PRIORITY_COUNT; i++)
+            {
+                if ((module_info->lanes[i].space_cond != NULL) && (Condition_Post(module_info->lanes[i].space_cond) != COND_OK))
+                {
+                    LogError("Condition_Post failed for module [%p]", module_info);
+                }
+            }
+            (void)Unlock(module_info->mq_lock);
+        }
+
+        /*quit_worker is set, so a woken publisher gives up at once*/
+        ThreadAPI_Sleep(1);
+    }
+}
+
+/*stop module means: stop the thread that feeds messages to Module_Receive function + deletion of all queued messages, once they have been drained if drain_deadline_us is not 0 */
+/*returns 0 if success, otherwise __LINE__*/
+static int stop_module(MESSAGE_BUS_MODULEINFO* module_info, uint64_t drain_deadline_us, MESSAGE_BUS_DRAIN_RESULT* drain_result)
+{
+    int thread_result, result;
+    MESSAGE_HANDLE msg;
+    size_t i;
+    /*without mq_lock the task cannot be known to have stopped*/
+    bool task_stopped = (module_info->pool == NULL);
+    /*Codes_SRS_MESSAGE_BUS_02_001: [ MessageBus_RemoveModule shall lock `MESSAGE_BUS_MODULEINFO::mq_lock`. ]*/
+    if (Lock(module_info->mq_lock) != LOCK_OK)
     {
         module_info->quit_worker = 1; /*at the cost of a data race, still try to stop the module*/
         /*Codes_SRS_MESSAGE_BUS_02_002: [ If locking fails, then terminating the thread shall not be attempted (signalling the condition and joining the thread). ]*/
@@ -312,184 +1110,1204 @@ static int stop_module(MESSAGE_BUS_MODULEINFO* module_info)
     }
     else
     {
-        /*Codes_SRS_MESSAGE_BUS_13_103: [The function shall assign 1 to MESSAGE_BUS_MODULEINFO::quit_worker.]*/
-        module_info->quit_worker = 1;
+        /*Codes_SRS_MESSAGE_BUS_13_103: [The function shall assign 1 to MESSAGE_BUS_MODULEINFO::quit_worker.]*/
+        module_info->quit_worker = 1;
+
+        if (module_info->pool != NULL)
+        {
+            /*Codes_SRS_MESSAGE_BUS_13_167: [If the bus has a worker pool, the function shall cancel MESSAGE_BUS_MODULEINFO::task if it has not started running, or else wait on MESSAGE_BUS_MODULEINFO::mq_cond until it has finished.]*/
+            if ((MESSAGE_BUS_COUNTER_GET(module_info->scheduled) != 0) && (WorkerPool_Cancel(module_info->pool, &module_info->task) == WORKER_POOL_OK))
+            {
+                MESSAGE_BUS_COUNTER_SET(module_info->scheduled, 0);
+            }
+
+            while (MESSAGE_BUS_COUNTER_GET(module_info->scheduled) != 0)
+            {
+                /*a task that cannot lock mq_lock signals without it, so the signal can be missed*/
+                if (Condition_Wait(module_info->mq_cond, module_info->mq_lock, MESSAGE_BUS_TASK_WAIT_MS) == COND_ERROR)
+                {
+                    LogError("Condition_Wait failed for module [%p]", module_info);
+                    break;
+                }
+            }
+            task_stopped = (MESSAGE_BUS_COUNTER_GET(module_info->scheduled) == 0);
+        }
+        /*Codes_SRS_MESSAGE_BUS_17_001: [The function shall signal MESSAGE_BUS_MODULEINFO::mq_cond to release module from waiting.]*/
+        else if (Condition_Post(module_info->mq_cond) != COND_OK)
+        {
+            LogError("Condition_Post failed for module at  item [%p] failed", module_info);
+        }
+        else
+        {
+            /*all is fine, thread will eventually stop and be joined*/
+        }
+
+        /*Codes_SRS_MESSAGE_BUS_02_003: [ After signaling the condition, MessageBus_RemoveModule shall unlock MESSAGE_BUS_MODULEINFO::mq_lock. ]*/
+        if (Unlock(module_info->mq_lock) != LOCK_OK)
+        {
+            LogError("unable to unlock mq_lock");
+        }
+    }
+
+    /*Codes_SRS_MESSAGE_BUS_13_192: [The function shall signal the space_cond of the lanes of the module until MESSAGE_BUS_MODULEINFO::waiting_publishers is 0.]*/
+    release_waiting_publishers(module_info);
+
+    if (module_info->pool != NULL)
+    {
+        /*Codes_SRS_MESSAGE_BUS_13_198: [If the bus has a worker pool and the function could neither cancel MESSAGE_BUS_MODULEINFO::task nor see it finish, it shall fail without touching the lanes of the module, which is then never freed.]*/
+        result = task_stopped ? 0 : __LINE__;
+    }
+    /*Codes_SRS_MESSAGE_BUS_13_104: [The function shall wait for the module's thread to exit by joining MESSAGE_BUS_MODULEINFO::thread via ThreadAPI_Join. ]*/
+    else if (ThreadAPI_Join(module_info->thread, &thread_result) != THREADAPI_OK)
+    {
+        result = __LINE__;
+        LogError("ThreadAPI_Join() returned an error.");
+    }
+    else
+    {
+        result = 0;
+    }
+
+    /*Codes_SRS_MESSAGE_BUS_13_183: [If drain_timeout_ms is not 0, once the module's thread or task has stopped the function shall deliver the messages left in its lanes on the calling thread, a batch at a time as the module's thread does, until the lanes are empty or drain_timeout_ms milliseconds have passed since the function was called.]*/
+    if ((result == 0) && (drain_deadline_us != 0))
+    {
+        drain_module(module_info, drain_deadline_us, drain_result);
+    }
+
+    /*Codes_SRS_MESSAGE_BUS_13_056: [If the lanes of MESSAGE_BUS_MODULEINFO are not empty then this function shall call Message_Destroy on every message still left in them.]*/
+    for (i = 0; task_stopped && (i < MESSAGE_BUS_PRIORITY_COUNT); i++)
+    {
+        while ((msg = MessageQueue_Pop(module_info->lanes[i].mq)) != NULL)
+        {
+            Message_Destroy(msg);
+            drain_result->dropped++;
+        }
+    }
+    return result;
+}
+
+/*enters a publisher's read side section and returns the current snapshot, which stays valid until snapshot_release*/
+static MESSAGE_BUS_SNAPSHOT* snapshot_acquire(MESSAGE_BUS_HANDLE_DATA* bus_data, long* reader_epoch)
+{
+    *reader_epoch = MESSAGE_BUS_COUNTER_GET(bus_data->epoch) & 1;
+    (void)MESSAGE_BUS_COUNTER_INC(bus_data->readers[*reader_epoch]);
+
+    /*the snapshot is read only after the writers can see this reader*/
+    return (MESSAGE_BUS_SNAPSHOT*)MESSAGE_BUS_POINTER_GET(bus_data->snapshot);
+}
+
+static void snapshot_release(MESSAGE_BUS_HANDLE_DATA* bus_data, long reader_epoch)
+{
+    (void)MESSAGE_BUS_COUNTER_DEC(bus_data->readers[reader_epoch]);
+}
+
+/**
+* Waits until every publisher that might have read the previous snapshot is
+* done with it. Each phase moves new publishers to the other counter and
+* waits for the one they left to drain. Two phases are needed because a
+* publisher may read 'epoch' and get preempted before incrementing its
+* counter: by the time it does, the counter it picked may be the one that
+* the first phase no longer waits for. Either way such a publisher reads
+* the snapshot after incrementing and so gets the new one.
+*/
+static void wait_for_readers(MESSAGE_BUS_HANDLE_DATA* bus_data)
+{
+    int phase;
+    for (phase = 0; phase < 2; phase++)
+    {
+        long retired = (MESSAGE_BUS_COUNTER_INC(bus_data->epoch) - 1) & 1;
+        size_t spins = 0;
+        /*publishers never wait in their read side section, so yielding is usually enough; sleep if it is not, rather than burn a core while holding modules_lock*/
+        while (MESSAGE_BUS_COUNTER_GET(bus_data->readers[retired]) != 0)
+        {
+            ThreadAPI_Sleep((spins < MESSAGE_BUS_READER_SPINS) ? 0 : 1);
+            spins++;
+        }
+    }
+}
+
+static bool snapshot_keeps_route(const MESSAGE_BUS_ROUTE* route, MODULE_HANDLE removed_source, const MESSAGE_BUS_ROUTE* removed_route)
+{
+    return (route != removed_route) && ((removed_source == NULL) || (route->module_source != removed_source));
+}
+
+static size_t route_strings_size(const MESSAGE_BUS_ROUTE* route)
+{
+    return
+        ((route->filter_property == NULL) ? 0 : strlen(route->filter_property) + 1) +
+        ((route->filter_value == NULL) ? 0 : strlen(route->filter_value) + 1);
+}
+
+static char* snapshot_copy_string(char** strings, const char* source)
+{
+    char* result;
+    if (source == NULL)
+    {
+        result = NULL;
+    }
+    else
+    {
+        size_t length = strlen(source) + 1;
+        result = *strings;
+        (void)memcpy(result, source, length);
+        *strings += length;
+    }
+    return result;
+}
+
+/*builds a snapshot of the modules on the bus without 'removed_module', the links from 'removed_source' and 'removed_route'; returns NULL if malloc fails*/
+static MESSAGE_BUS_SNAPSHOT* snapshot_create(MESSAGE_BUS_HANDLE_DATA* bus_data, SUBSCRIPTION_INDEX_HANDLE subscriptions, MODULE_HANDLE removed_module, MODULE_HANDLE removed_source, const MESSAGE_BUS_ROUTE* removed_route)
+{
+    MESSAGE_BUS_SNAPSHOT* result;
+    size_t entry_count = 0, route_count = 0, strings_size = 0;
+    LIST_ITEM_HANDLE current_module;
+    size_t i;
+
+    for (current_module = list_get_head_item(bus_data->modules);
+         current_module != NULL;
+         current_module = list_get_next_item(current_module))
+    {
+        MESSAGE_BUS_MODULEINFO* module_info = (MESSAGE_BUS_MODULEINFO*)list_item_get_value(current_module);
+        if (module_info->module_handle != removed_module)
+        {
+            size_t module_route_count = VECTOR_size(module_info->routes);
+            entry_count++;
+            for (i = 0; i < module_route_count; i++)
+            {
+                const MESSAGE_BUS_ROUTE* route = (const MESSAGE_BUS_ROUTE*)VECTOR_element(module_info->routes, i);
+                if (snapshot_keeps_route(route, removed_source, removed_route))
+                {
+                    route_count++;
+                    strings_size += route_strings_size(route);
+                }
+            }
+        }
+    }
+
+    result = (MESSAGE_BUS_SNAPSHOT*)malloc(sizeof(MESSAGE_BUS_SNAPSHOT) + (entry_count * sizeof(MESSAGE_BUS_SNAPSHOT_ENTRY)) + (route_count * sizeof(MESSAGE_BUS_ROUTE)) + strings_size);
+    if (result == NULL)
+    {
+        LogError("malloc failed");
+    }
+    else
+    {
+        MESSAGE_BUS_SNAPSHOT_ENTRY* entry = (MESSAGE_BUS_SNAPSHOT_ENTRY*)(result + 1);
+        MESSAGE_BUS_ROUTE* route_copy = (MESSAGE_BUS_ROUTE*)(entry + entry_count);
+        char* strings = (char*)(route_copy + route_count);
+
+        result->entries = entry;
+        result->entry_count = entry_count;
+        result->routed = (bus_data->routing == MESSAGE_BUS_ROUTING_LINKS) ||
+            ((bus_data->routing == MESSAGE_BUS_ROUTING_AUTOMATIC) && (route_count > 0));
+        result->subscriptions = subscriptions;
+
+        for (current_module = list_get_head_item(bus_data->modules);
+             current_module != NULL;
+             current_module = list_get_next_item(current_module))
+        {
+            MESSAGE_BUS_MODULEINFO* module_info = (MESSAGE_BUS_MODULEINFO*)list_item_get_value(current_module);
+            if (module_info->module_handle != removed_module)
+            {
+                size_t module_route_count = VECTOR_size(module_info->routes);
+                entry->module_info = module_info;
+                entry->has_subscription = module_info->has_subscription;
+                entry->subscription_slot = module_info->subscription_slot;
+                entry->routes = route_copy;
+                entry->route_count = 0;
+                for (i = 0; i < module_route_count; i++)
+                {
+                    const MESSAGE_BUS_ROUTE* route = (const MESSAGE_BUS_ROUTE*)VECTOR_element(module_info->routes, i);
+                    if (snapshot_keeps_route(route, removed_source, removed_route))
+                    {
+                        route_copy->module_source = route->module_source;
+                        route_copy->filter_property = snapshot_copy_string(&strings, route->filter_property);
+                        route_copy->filter_value = snapshot_copy_string(&strings, route->filter_value);
+                        route_copy++;
+                        entry->route_count++;
+                    }
+                }
+                entry++;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*makes 'snapshot' and 'subscriptions' the ones publishers use and frees the previous ones once no publisher is using them. Must be called with modules_lock held*/
+static void snapshot_replace(MESSAGE_BUS_HANDLE_DATA* bus_data, MESSAGE_BUS_SNAPSHOT* snapshot, SUBSCRIPTION_INDEX_HANDLE subscriptions)
+{
+    MESSAGE_BUS_SNAPSHOT* old_snapshot = bus_data->snapshot;
+    SUBSCRIPTION_INDEX_HANDLE old_subscriptions = bus_data->subscriptions;
+
+    MESSAGE_BUS_POINTER_SET(bus_data->snapshot, snapshot);
+    bus_data->subscriptions = subscriptions;
+
+    wait_for_readers(bus_data);
+
+    free(old_snapshot);
+    if (old_subscriptions != subscriptions)
+    {
+        SubscriptionIndex_Destroy(old_subscriptions);
+    }
+}
+
+MESSAGE_BUS_RESULT MessageBus_AddModule(MESSAGE_BUS_HANDLE bus, const MODULE* module)
+{
+    /*Codes_SRS_MESSAGE_BUS_13_132: [MessageBus_AddModule shall behave as MessageBus_AddModuleWithFilter with a NULL filter.]*/
+    return MessageBus_AddModuleWithFilter(bus, module, NULL);
+}
+
+/*adds the filter of the module to a copy of the bus' subscription index, or to a new index if the bus has none yet*/
+static MESSAGE_BUS_RESULT add_subscription(MESSAGE_BUS_HANDLE_DATA* bus_data, MESSAGE_BUS_MODULEINFO* module_info, const MESSAGE_BUS_FILTER* filter, SUBSCRIPTION_INDEX_HANDLE* subscriptions)
+{
+    MESSAGE_BUS_RESULT result;
+    SUBSCRIPTION_INDEX_RESULT index_result;
+
+    /*Codes_SRS_MESSAGE_BUS_13_134: [If filter is not NULL, MessageBus_AddModuleWithFilter shall add it to a copy of MESSAGE_BUS_HANDLE_DATA::subscriptions, or to a new index if it is NULL.]*/
+    *subscriptions = (bus_data->subscriptions == NULL) ? SubscriptionIndex_Create() : SubscriptionIndex_Clone(bus_data->subscriptions);
+    if (*subscriptions == NULL)
+    {
+        LogError("unable to create the subscription index");
+        *subscriptions = bus_data->subscriptions;
+        result = MESSAGE_BUS_ERROR;
+    }
+    else if ((index_result = SubscriptionIndex_Add(*subscriptions, filter, &module_info->subscription_slot)) != SUBSCRIPTION_INDEX_OK)
+    {
+        /*Codes_SRS_MESSAGE_BUS_13_135: [MessageBus_AddModuleWithFilter shall return MESSAGE_BUS_INVALIDARG if filter is not valid.]*/
+        LogError("SubscriptionIndex_Add failed");
+        SubscriptionIndex_Destroy(*subscriptions);
+        *subscriptions = bus_data->subscriptions;
+        result = (index_result == SUBSCRIPTION_INDEX_INVALIDARG) ? MESSAGE_BUS_INVALIDARG : MESSAGE_BUS_ERROR;
+    }
+    else
+    {
+        module_info->has_subscription = true;
+        result = MESSAGE_BUS_OK;
+    }
+
+    return result;
+}
+
+/*returns a copy of the bus' subscription index without the filter of the module, or NULL if copying fails*/
+static SUBSCRIPTION_INDEX_HANDLE remove_subscription(MESSAGE_BUS_HANDLE_DATA* bus_data, MESSAGE_BUS_MODULEINFO* module_info)
+{
+    SUBSCRIPTION_INDEX_HANDLE result = SubscriptionIndex_Clone(bus_data->subscriptions);
+    if (result == NULL)
+    {
+        LogError("SubscriptionIndex_Clone failed");
+    }
+    else
+    {
+        SubscriptionIndex_Remove(result, module_info->subscription_slot);
+    }
+    return result;
+}
+
+/*destroys an index made by add_subscription or remove_subscription that was not handed to snapshot_replace*/
+static void discard_subscriptions(MESSAGE_BUS_HANDLE_DATA* bus_data, SUBSCRIPTION_INDEX_HANDLE subscriptions)
+{
+    if (subscriptions != bus_data->subscriptions)
+    {
+        SubscriptionIndex_Destroy(subscriptions);
+    }
+}
+
+MESSAGE_BUS_RESULT MessageBus_AddModuleWithFilter(MESSAGE_BUS_HANDLE bus, const MODULE* module, const MESSAGE_BUS_FILTER* filter)
+{
+    /*Codes_SRS_MESSAGE_BUS_13_148: [MessageBus_AddModuleWithFilter shall behave as MessageBus_AddModuleWithQueue with a NULL queue_config.]*/
+    return MessageBus_AddModuleWithQueue(bus, module, filter, NULL);
+}
+
+/*Condition_Wait takes its timeout as an int, so a longer timeout_ms is rejected rather than waited for as a negative one*/
+static bool is_valid_queue_config(const MESSAGE_BUS_QUEUE_CONFIG* queue_config)
+{
+    return (queue_config == NULL) ||
+        (((queue_config->policy == MESSAGE_BUS_QUEUE_DROP_NEWEST) ||
+          (queue_config->policy == MESSAGE_BUS_QUEUE_DROP_OLDEST) ||
+          (queue_config->policy == MESSAGE_BUS_QUEUE_BLOCK)) &&
+         (queue_config->timeout_ms <= INT_MAX));
+}
+
+MESSAGE_BUS_RESULT MessageBus_AddModuleWithQueue(MESSAGE_BUS_HANDLE bus, const MODULE* module, const MESSAGE_BUS_FILTER* filter, const MESSAGE_BUS_QUEUE_CONFIG* queue_config)
+{
+    /*Codes_SRS_MESSAGE_BUS_13_195: [MessageBus_AddModuleWithQueue shall behave as MessageBus_AddModuleWithReceiveBatch with a NULL receive_batch.]*/
+    return MessageBus_AddModuleWithReceiveBatch(bus, module, filter, queue_config, NULL);
+}
+
+MESSAGE_BUS_RESULT MessageBus_AddModuleWithReceiveBatch(MESSAGE_BUS_HANDLE bus, const MODULE* module, const MESSAGE_BUS_FILTER* filter, const MESSAGE_BUS_QUEUE_CONFIG* queue_config, pfModule_ReceiveBatch receive_batch)
+{
+    MESSAGE_BUS_RESULT result;
+
+    /*Codes_SRS_MESSAGE_BUS_13_038: [If `bus` or `module` or `module->module_data` is NULL the function shall return MESSAGE_BUS_INVALIDARG.]*/
+    if (bus == NULL || module == NULL || module->module_data == NULL)
+    {
+        result = MESSAGE_BUS_INVALIDARG;
+        LogError("invalid parameter (NULL).");
+    }
+    /*Codes_SRS_MESSAGE_BUS_13_149: [If queue_config is not NULL and its policy is not a MESSAGE_BUS_QUEUE_POLICY value, the function shall return MESSAGE_BUS_INVALIDARG.]*/
+    /*Codes_SRS_MESSAGE_BUS_13_189: [If queue_config is not NULL and its timeout_ms is greater than INT_MAX, the function shall return MESSAGE_BUS_INVALIDARG.]*/
+    else if (!is_valid_queue_config(queue_config))
+    {
+        result = MESSAGE_BUS_INVALIDARG;
+        LogError("invalid queue config: policy %d, timeout %u ms", (int)queue_config->policy, queue_config->timeout_ms);
+    }
+    else
+    {
+        MESSAGE_BUS_MODULEINFO* module_info = (MESSAGE_BUS_MODULEINFO*)malloc(sizeof(MESSAGE_BUS_MODULEINFO));
+        if (module_info == NULL)
+        {
+            LogError("Allocate module info failed");
+            result = MESSAGE_BUS_ERROR;
+        }
+        else
+        {
+            if (init_module(module_info, module, queue_config, receive_batch, ((MESSAGE_BUS_HANDLE_DATA*)bus)->pool) != MESSAGE_BUS_OK)
+            {
+                /*Codes_SRS_MESSAGE_BUS_13_047: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
+                LogError("start_module failed");
+                free(module_info);
+                result = MESSAGE_BUS_ERROR;
+            }
+            else
+            {
+                /*Codes_SRS_MESSAGE_BUS_13_039: [This function shall acquire the lock on MESSAGE_BUS_HANDLE_DATA::modules_lock.]*/
+                MESSAGE_BUS_HANDLE_DATA* bus_data = (MESSAGE_BUS_HANDLE_DATA*)bus;
+                if (Lock(bus_data->modules_lock) != LOCK_OK)
+                {
+                    /*Codes_SRS_MESSAGE_BUS_13_047: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
+                    LogError("Lock on bus_data->modules_lock failed");
+                    deinit_module(module_info);
+                    free(module_info);
+                    result = MESSAGE_BUS_ERROR;
+                }
+                else
+                {
+                    SUBSCRIPTION_INDEX_HANDLE subscriptions = bus_data->subscriptions;
+                    LIST_ITEM_HANDLE moduleListItem;
+                    MESSAGE_BUS_SNAPSHOT* snapshot;
+
+                    if ((filter != NULL) && ((result = add_subscription(bus_data, module_info, filter, &subscriptions)) != MESSAGE_BUS_OK))
+                    {
+                        /*Codes_SRS_MESSAGE_BUS_13_047: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
+                        deinit_module(module_info);
+                        free(module_info);
+                    }
+                    /*Codes_SRS_MESSAGE_BUS_13_045: [MessageBus_AddModule shall append the new instance of MESSAGE_BUS_MODULEINFO to MESSAGE_BUS_HANDLE_DATA::modules.]*/
+                    else if ((moduleListItem = list_add(bus_data->modules, module_info)) == NULL)
+                    {
+                        /*Codes_SRS_MESSAGE_BUS_13_047: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
+                        LogError("list_add failed");
+                        discard_subscriptions(bus_data, subscriptions);
+                        deinit_module(module_info);
+                        free(module_info);
+                        result = MESSAGE_BUS_ERROR;
+                    }
+                    /*Codes_SRS_MESSAGE_BUS_13_140: [The function shall create a new snapshot of the modules and links on the bus.]*/
+                    else if ((snapshot = snapshot_create(bus_data, subscriptions, NULL, NULL, NULL)) == NULL)
+                    {
+                        /*Codes_SRS_MESSAGE_BUS_13_047: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
+                        LogError("unable to create a snapshot of the modules");
+                        list_remove(bus_data->modules, moduleListItem);
+                        discard_subscriptions(bus_data, subscriptions);
+                        deinit_module(module_info);
+                        free(module_info);
+                        result = MESSAGE_BUS_ERROR;
+                    }
+                    else if (start_module(module_info) != MESSAGE_BUS_OK)
+                    {
+                        LogError("start_module failed");
+                        free(snapshot);
+                        list_remove(bus_data->modules, moduleListItem);
+                        discard_subscriptions(bus_data, subscriptions);
+                        deinit_module(module_info);
+                        free(module_info);
+                        result = MESSAGE_BUS_ERROR;
+                    }
+                    else
+                    {
+                        /*Codes_SRS_MESSAGE_BUS_13_141: [The function shall replace MESSAGE_BUS_HANDLE_DATA::snapshot with the new snapshot and free the previous snapshot once no call to MessageBus_Publish can be using it.]*/
+                        snapshot_replace(bus_data, snapshot, subscriptions);
+
+                        /*Codes_SRS_MESSAGE_BUS_13_047: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
+                        result = MESSAGE_BUS_OK;
+                    }
+
+                    /*Codes_SRS_MESSAGE_BUS_13_046: [This function shall release the lock on MESSAGE_BUS_HANDLE_DATA::modules_lock.]*/
+                    Unlock(bus_data->modules_lock);
+                }
+            }
+
+        }
+    }
+
+    return result;
+}
+
+static bool find_module_predicate(LIST_ITEM_HANDLE list_item, const void* value)
+{
+    MESSAGE_BUS_MODULEINFO* element = (MESSAGE_BUS_MODULEINFO*)list_item_get_value(list_item);
+    return (element->module_handle == value);
+}
+
+/*removes every route that has 'module' as its source from every module on the bus; returns the number of routes removed*/
+static size_t remove_routes_from_source(MESSAGE_BUS_HANDLE_DATA* bus_data, MODULE_HANDLE module)
+{
+    size_t result = 0;
+    LIST_ITEM_HANDLE current_module;
+    for (current_module = list_get_head_item(bus_data->modules);
+         current_module != NULL;
+         current_module = list_get_next_item(current_module))
+    {
+        MESSAGE_BUS_MODULEINFO* module_info = (MESSAGE_BUS_MODULEINFO*)list_item_get_value(current_module);
+        size_t i = 0;
+        while (i < VECTOR_size(module_info->routes))
+        {
+            MESSAGE_BUS_ROUTE* route = (MESSAGE_BUS_ROUTE*)VECTOR_element(module_info->routes, i);
+            if (route->module_source == module)
+            {
+                destroy_route(route);
+                VECTOR_erase(module_info->routes, route, 1);
+                result++;
+            }
+            else
+            {
+                i++;
+            }
+        }
+    }
+    return result;
+}
+
+/*stops a module that is no longer in the snapshot, drains its queue until drain_deadline_us if it is not 0, and frees it*/
+static void stop_and_free_module(MESSAGE_BUS_MODULEINFO* module_info, uint64_t drain_deadline_us, MESSAGE_BUS_DRAIN_RESULT* drain_result)
+{
+    if (stop_module(module_info, drain_deadline_us, drain_result) == 0)
+    {
+        deinit_module(module_info);
+        free(module_info);
+    }
+    /*Codes_SRS_MESSAGE_BUS_13_198: [If the bus has a worker pool and the function could neither cancel MESSAGE_BUS_MODULEINFO::task nor see it finish, it shall fail without touching the lanes of the module, which is then never freed.]*/
+    else if (module_info->pool != NULL)
+    {
+        LogError("unable to stop module, it is leaked as its task may still be using it");
+    }
+    else
+    {
+        LogError("unable to stop module");
+        free(module_info);
+    }
+}
+
+MESSAGE_BUS_RESULT MessageBus_RemoveModule(MESSAGE_BUS_HANDLE bus, MODULE_HANDLE module)
+{
+    /*Codes_SRS_MESSAGE_BUS_13_181: [MessageBus_RemoveModule shall behave as MessageBus_RemoveModuleWithDrain with a drain_timeout_ms of 0 and a NULL drain_result.]*/
+    return MessageBus_RemoveModuleWithDrain(bus, module, 0, NULL);
+}
+
+MESSAGE_BUS_RESULT MessageBus_RemoveModuleWithDrain(MESSAGE_BUS_HANDLE bus, MODULE_HANDLE module, unsigned int drain_timeout_ms, MESSAGE_BUS_DRAIN_RESULT* drain_result)
+{
+    /*Codes_SRS_MESSAGE_BUS_13_048: [If `bus` or `module` is NULL the function shall return MESSAGE_BUS_INVALIDARG.]*/
+    MESSAGE_BUS_RESULT result;
+    MESSAGE_BUS_DRAIN_RESULT local_drain_result;
+    uint64_t drain_deadline_us = (drain_timeout_ms == 0) ? 0 : get_time_us() + ((uint64_t)drain_timeout_ms * 1000);
+
+    /*Codes_SRS_MESSAGE_BUS_13_185: [If drain_result is not NULL, the function shall store in it the number of queued messages delivered to the module while draining and the number of queued messages destroyed without being delivered.]*/
+    if (drain_result == NULL)
+    {
+        drain_result = &local_drain_result;
+    }
+    drain_result->delivered = 0;
+    drain_result->dropped = 0;
+
+    if (bus == NULL || module == NULL)
+    {
+        result = MESSAGE_BUS_INVALIDARG;
+        LogError("invalid parameter (NULL).");
+    }
+    else
+    {
+        /*Codes_SRS_MESSAGE_BUS_13_088: [This function shall acquire the lock on MESSAGE_BUS_HANDLE_DATA::modules_lock.]*/
+        MESSAGE_BUS_HANDLE_DATA* bus_data = (MESSAGE_BUS_HANDLE_DATA*)bus;
+        bool locked = true;
+        if (Lock(bus_data->modules_lock) != LOCK_OK)
+        {
+            /*Codes_SRS_MESSAGE_BUS_13_053: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
+            LogError("Lock on bus_data->modules_lock failed");
+            result = MESSAGE_BUS_ERROR;
+        }
+        else
+        {
+            /*Codes_SRS_MESSAGE_BUS_13_049: [MessageBus_RemoveModule shall perform a linear search for module in MESSAGE_BUS_HANDLE_DATA::modules.]*/
+            LIST_ITEM_HANDLE module_info_item = list_find(bus_data->modules, find_module_predicate, module);
+
+            if (module_info_item == NULL)
+            {
+                /*Codes_SRS_MESSAGE_BUS_13_050: [MessageBus_RemoveModule shall unlock MESSAGE_BUS_HANDLE_DATA::modules_lock and return MESSAGE_BUS_ERROR if the module is not found in MESSAGE_BUS_HANDLE_DATA::modules.]*/
+                LogError("Supplied module was not found on the bus");
+                result = MESSAGE_BUS_ERROR;
+            }
+            else
+            {
+                MESSAGE_BUS_MODULEINFO* module_info = (MESSAGE_BUS_MODULEINFO*)list_item_get_value(module_info_item);
+                SUBSCRIPTION_INDEX_HANDLE subscriptions = bus_data->subscriptions;
+                MESSAGE_BUS_SNAPSHOT* snapshot;
+
+                /*Codes_SRS_MESSAGE_BUS_13_136: [MessageBus_RemoveModule shall remove the filter of the module, if any, from a copy of MESSAGE_BUS_HANDLE_DATA::subscriptions.]*/
+                if (module_info->has_subscription && ((subscriptions = remove_subscription(bus_data, module_info)) == NULL))
+                {
+                    /*Codes_SRS_MESSAGE_BUS_13_053: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
+                    result = MESSAGE_BUS_ERROR;
+                }
+                /*Codes_SRS_MESSAGE_BUS_13_142: [MessageBus_RemoveModule shall create a new snapshot of the modules and links on the bus without the module and the links from or to it.]*/
+                /*Codes_SRS_MESSAGE_BUS_13_182: [If drain_timeout_ms is not 0, MessageBus_RemoveModuleWithDrain shall instead create a snapshot without the module but with the links from it, so that the messages the module publishes while its queue drains still reach their sinks.]*/
+                else if ((snapshot = snapshot_create(bus_data, subscriptions, module, (drain_timeout_ms == 0) ? module : NULL, NULL)) == NULL)
+                {
+                    /*Codes_SRS_MESSAGE_BUS_13_053: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
+                    LogError("unable to create a snapshot of the modules");
+                    discard_subscriptions(bus_data, subscriptions);
+                    result = MESSAGE_BUS_ERROR;
+                }
+                else
+                {
+                    /*Codes_SRS_MESSAGE_BUS_13_143: [MessageBus_RemoveModule shall replace MESSAGE_BUS_HANDLE_DATA::snapshot with the new snapshot and wait until no call to MessageBus_Publish can be using the previous one before stopping the module.]*/
+                    snapshot_replace(bus_data, snapshot, subscriptions);
+
+                    /*Codes_SRS_MESSAGE_BUS_13_115: [MessageBus_RemoveModule shall remove every link that has module as its source or as its sink.]*/
+                    bus_data->link_count -= remove_routes_from_source(bus_data, module);
+                    bus_data->link_count -= VECTOR_size(module_info->routes);
+
+                    if (drain_timeout_ms == 0)
+                    {
+                        stop_and_free_module(module_info, 0, drain_result);
+
+                        /*Codes_SRS_MESSAGE_BUS_13_052: [The function shall remove the module from MESSAGE_BUS_HANDLE_DATA::modules.]*/
+                        list_remove(bus_data->modules, module_info_item);
+                    }
+                    else
+                    {
+                        /*Codes_SRS_MESSAGE_BUS_13_052: [The function shall remove the module from MESSAGE_BUS_HANDLE_DATA::modules.]*/
+                        list_remove(bus_data->modules, module_info_item);
+
+                        /*Codes_SRS_MESSAGE_BUS_13_194: [If drain_timeout_ms is not 0, the function shall release MESSAGE_BUS_HANDLE_DATA::modules_lock while it stops the module and drains its queue, and acquire it again afterwards.]*/
+                        Unlock(bus_data->modules_lock);
+                        stop_and_free_module(module_info, drain_deadline_us, drain_result);
+                        if (Lock(bus_data->modules_lock) != LOCK_OK)
+                        {
+                            /*the snapshot keeps the links from the module, which are only used by messages the module publishes*/
+                            LogError("Lock on bus_data->modules_lock failed, the links from the removed module stay in the snapshot");
+                            locked = false;
+                        }
+                        /*Codes_SRS_MESSAGE_BUS_13_184: [Once the queue of the module has drained, MessageBus_RemoveModuleWithDrain shall replace the snapshot, unless it was replaced while draining, with a new one without the links from the module.]*/
+                        else if (bus_data->snapshot == snapshot)
+                        {
+                            MESSAGE_BUS_SNAPSHOT* drained_snapshot = snapshot_create(bus_data, bus_data->subscriptions, NULL, NULL, NULL);
+                            if (drained_snapshot == NULL)
+                            {
+                                LogError("unable to create a snapshot of the modules, the links from the removed module stay in the snapshot");
+                            }
+                            else
+                            {
+                                snapshot_replace(bus_data, drained_snapshot, bus_data->subscriptions);
+                            }
+                        }
+                        else
+                        {
+                            /*a change made while draining already left the links from the module out*/
+                        }
+                    }
+
+                    /*Codes_SRS_MESSAGE_BUS_13_053: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
+                    result = MESSAGE_BUS_OK;
+                }
+            }
+
+            /*Codes_SRS_MESSAGE_BUS_13_054: [This function shall release the lock on MESSAGE_BUS_HANDLE_DATA::modules_lock.]*/
+            if (locked)
+            {
+                Unlock(bus_data->modules_lock);
+            }
+        }
+    }
+
+    return result;
+}
+
+MESSAGE_BUS_RESULT MessageBus_GetModuleCounters(MESSAGE_BUS_HANDLE bus, MODULE_HANDLE module, MESSAGE_BUS_MODULE_COUNTERS* counters)
+{
+    MESSAGE_BUS_RESULT result;
+
+    /*Codes_SRS_MESSAGE_BUS_13_155: [If bus, module or counters is NULL, MessageBus_GetModuleCounters shall return MESSAGE_BUS_INVALIDARG.]*/
+    if (bus == NULL || module == NULL || counters == NULL)
+    {
+        result = MESSAGE_BUS_INVALIDARG;
+        LogError("invalid parameter (NULL).");
+    }
+    else
+    {
+        MESSAGE_BUS_HANDLE_DATA* bus_data = (MESSAGE_BUS_HANDLE_DATA*)bus;
+        if (Lock(bus_data->modules_lock) != LOCK_OK)
+        {
+            LogError("Lock on bus_data->modules_lock failed");
+            result = MESSAGE_BUS_ERROR;
+        }
+        else
+        {
+            LIST_ITEM_HANDLE module_info_item = list_find(bus_data->modules, find_module_predicate, module);
+            if (module_info_item == NULL)
+            {
+                /*Codes_SRS_MESSAGE_BUS_13_156: [MessageBus_GetModuleCounters shall return MESSAGE_BUS_ERROR if module is not on the bus.]*/
+                LogError("Supplied module was not found on the bus");
+                result = MESSAGE_BUS_ERROR;
+            }
+            else
+            {
+                MESSAGE_BUS_MODULEINFO* module_info = (MESSAGE_BUS_MODULEINFO*)list_item_get_value(module_info_item);
+                if (Lock(module_info->mq_lock) != LOCK_OK)
+                {
+                    LogError("Lock on module_info->mq_lock for module [%p] failed", module_info);
+                    result = MESSAGE_BUS_ERROR;
+                }
+                else
+                {
+                    size_t i;
+
+                    /*Codes_SRS_MESSAGE_BUS_13_157: [MessageBus_GetModuleCounters shall store the number of messages in the module's lanes and the number of messages dropped for the module in counters and return MESSAGE_BUS_OK.]*/
+                    counters->queued = 0;
+                    counters->dropped = (size_t)MESSAGE_BUS_STAT_GET(module_info->stats.dropped);
+
+                    /*Codes_SRS_MESSAGE_BUS_13_173: [MessageBus_GetModuleCounters shall store the number of messages, the number of latency samples and the average and maximum queue latency of every lane in counters->lanes.]*/
+                    for (i = 0; i < MESSAGE_BUS_PRIORITY_COUNT; i++)
+                    {
+                        const MESSAGE_BUS_LANE* lane = &module_info->lanes[i];
+                        counters->lanes[i].queued = MessageQueue_Size(lane->mq);
+                        counters->lanes[i].latency_samples = lane->latency_samples;
+                        counters->lanes[i].latency_average_ms = (lane->latency_samples == 0) ? 0 : (unsigned int)(lane->latency_total_us / lane->latency_samples / 1000);
+                        counters->lanes[i].latency_max_ms = (unsigned int)(lane->latency_max_us / 1000);
+                        counters->queued += counters->lanes[i].queued;
+                    }
+                    (void)Unlock(module_info->mq_lock);
+                    result = MESSAGE_BUS_OK;
+                }
+            }
+
+            Unlock(bus_data->modules_lock);
+        }
+    }
+
+    return result;
+}
+
+MESSAGE_BUS_RESULT MessageBus_GetStatistics(MESSAGE_BUS_HANDLE bus, MODULE_HANDLE module, MESSAGE_BUS_MODULE_STATISTICS* statistics)
+{
+    MESSAGE_BUS_RESULT result;
+
+    /*Codes_SRS_MESSAGE_BUS_13_178: [If bus, module or statistics is NULL, MessageBus_GetStatistics shall return MESSAGE_BUS_INVALIDARG.]*/
+    if (bus == NULL || module == NULL || statistics == NULL)
+    {
+        result = MESSAGE_BUS_INVALIDARG;
+        LogError("invalid parameter (NULL).");
+    }
+    else
+    {
+        MESSAGE_BUS_HANDLE_DATA* bus_data = (MESSAGE_BUS_HANDLE_DATA*)bus;
+        if (Lock(bus_data->modules_lock) != LOCK_OK)
+        {
+            LogError("Lock on bus_data->modules_lock failed");
+            result = MESSAGE_BUS_ERROR;
+        }
+        else
+        {
+            LIST_ITEM_HANDLE module_info_item = list_find(bus_data->modules, find_module_predicate, module);
+            if (module_info_item == NULL)
+            {
+                /*Codes_SRS_MESSAGE_BUS_13_179: [MessageBus_GetStatistics shall return MESSAGE_BUS_ERROR if module is not on the bus.]*/
+                LogError("Supplied module was not found on the bus");
+                result = MESSAGE_BUS_ERROR;
+            }
+            else
+            {
+                /*Codes_SRS_MESSAGE_BUS_13_180: [MessageBus_GetStatistics shall copy the statistics of the module into statistics without acquiring MESSAGE_BUS_MODULEINFO::mq_lock and return MESSAGE_BUS_OK.]*/
+                MESSAGE_BUS_MODULEINFO* module_info = (MESSAGE_BUS_MODULEINFO*)list_item_get_value(module_info_item);
+                size_t i;
+
+                statistics->enqueued = MESSAGE_BUS_STAT_GET(module_info->stats.enqueued);
+                statistics->delivered = MESSAGE_BUS_STAT_GET(module_info->stats.delivered);
+                statistics->dropped = MESSAGE_BUS_STAT_GET(module_info->stats.dropped);
+                statistics->queued = (size_t)MESSAGE_BUS_STAT_GET(module_info->stats.queued);
+                statistics->queued_high_water = (size_t)MESSAGE_BUS_STAT_GET(module_info->stats.queued_high_water);
+                statistics->receive_time_us = MESSAGE_BUS_STAT_GET(module_info->stats.receive_time_us);
+                statistics->latency_samples = 0;
+                for (i = 0; i < MESSAGE_BUS_LATENCY_BUCKET_COUNT; i++)
+                {
+                    statistics->latency_buckets[i] = MESSAGE_BUS_STAT_GET(module_info->stats.latency_buckets[i]);
+                    statistics->latency_samples += statistics->latency_buckets[i];
+                }
+                result = MESSAGE_BUS_OK;
+            }
+
+            Unlock(bus_data->modules_lock);
+        }
+    }
+
+    return result;
+}
+
+static void bus_decrement_ref(MESSAGE_BUS_HANDLE bus)
+{
+    /*Codes_SRS_MESSAGE_BUS_13_058: [If `bus` is NULL the function shall do nothing.]*/
+    if (bus != NULL)
+    {
+        /*Codes_SRS_MESSAGE_BUS_13_111: [Otherwise, MessageBus_Destroy shall decrement the internal ref count of the message.]*/
+        /*Codes_SRS_MESSAGE_BUS_13_112: [If the ref count is zero then the allocated resources are freed.]*/
+        if (DEC_REF(MESSAGE_BUS_HANDLE_DATA, bus) == DEC_RETURN_ZERO)
+        {
+            MESSAGE_BUS_HANDLE_DATA* bus_data = (MESSAGE_BUS_HANDLE_DATA*)bus; 
+            if (list_get_head_item(bus_data->modules) != NULL)
+            {
+                LogError("WARNING: There are still active modules connected to the bus and the bus is being destroyed.");
+            }
+
+            WorkerPool_Destroy(bus_data->pool);
+            list_destroy(bus_data->modules);
+            free(bus_data->snapshot);
+            SubscriptionIndex_Destroy(bus_data->subscriptions);
+            Lock_Deinit(bus_data->modules_lock);
+            free(bus_data);
+        }
+    }
+    else
+    {
+        LogError("bus handle is NULL");
+    }
+}
+
+extern void MessageBus_Destroy(MESSAGE_BUS_HANDLE bus)
+{
+    bus_decrement_ref(bus);
+}
+
+extern void MessageBus_DecRef(MESSAGE_BUS_HANDLE bus)
+{
+    /*Codes_SRS_MESSAGE_BUS_13_113: [This function shall implement all the requirements of the MessageBus_Destroy API.]*/
+    bus_decrement_ref(bus);
+}
+
+/*tells whether any of the module's routes accepts a message published by 'source'. The message properties are only read when a route has a filter*/
+static bool module_has_matching_route(const MESSAGE_BUS_SNAPSHOT_ENTRY* entry, MODULE_HANDLE source, MESSAGE_HANDLE message)
+{
+    bool result = false;
+    size_t i;
+    for (i = 0; (i < entry->route_count) && (result == false); i++)
+    {
+        const MESSAGE_BUS_ROUTE* route = &entry->routes[i];
+        if ((route->module_source == NULL) || (route->module_source == source))
+        {
+            if (route->filter_property == NULL)
+            {
+                result = true;
+            }
+            else
+            {
+                const char* value = Message_GetProperty(message, route->filter_property);
+                result = (value != NULL) && ((route->filter_value == NULL) || (strcmp(value, route->filter_value) == 0));
+            }
+        }
+    }
+    return result;
+}
+
+/*waits on the lane's space_cond until msg fits in the lane, the module's timeout elapses or the module is being removed; called with mq_lock held*/
+static MESSAGE_QUEUE_RESULT wait_for_room(MESSAGE_BUS_MODULEINFO* module_info, MESSAGE_BUS_LANE* lane, MESSAGE_HANDLE msg)
+{
+    MESSAGE_QUEUE_RESULT result = MESSAGE_QUEUE_FULL;
+    tickcounter_ms_t start_ms, now_ms;
+
+    if (tickcounter_get_current_ms(module_info->tick_counter, &start_ms) != 0)
+    {
+        LogError("tickcounter_get_current_ms failed");
+    }
+    else
+    {
+        now_ms = start_ms;
+        while ((result == MESSAGE_QUEUE_FULL) && (module_info->quit_worker == 0) && ((now_ms - start_ms) < module_info->queue_config.timeout_ms))
+        {
+            /*Condition_Wait treats a timeout of 0 as infinite, the remaining time is never 0 here*/
+            if (Condition_Wait(lane->space_cond, module_info->mq_lock, (int)(module_info->queue_config.timeout_ms - (now_ms - start_ms))) == COND_ERROR)
+            {
+                LogError("Condition_Wait failed for module [%p]", module_info);
+                break;
+            }
 
-        /*Codes_SRS_MESSAGE_BUS_17_001: [The function shall signal MESSAGE_BUS_MODULEINFO::mq_cond to release module from waiting.]*/
-        if (Condition_Post(module_info->mq_cond) != COND_OK)
+            result = lane_push(module_info, lane, msg);
+            if ((result == MESSAGE_QUEUE_FULL) && (tickcounter_get_current_ms(module_info->tick_counter, &now_ms) != 0))
+            {
+                LogError("tickcounter_get_current_ms failed");
+                break;
+            }
+        }
+
+        /*Condition_Post wakes a single waiter, pass the wake-up on while there is room left*/
+        if ((result == MESSAGE_QUEUE_OK) &&
+            (MessageQueue_Size(lane->mq) < module_info->queue_config.capacity) &&
+            (Condition_Post(lane->space_cond) != COND_OK))
         {
-            LogError("Condition_Post failed for module at  item [%p] failed", module_info);
+            LogError("Condition_Post failed for module [%p]", module_info);
         }
-        else
+    }
+
+    return result;
+}
+
+/*appends a clone of message to the lane of the module, applying its queue policy when the lane is full; called with mq_lock held*/
+static MESSAGE_QUEUE_RESULT enqueue_message(MESSAGE_BUS_MODULEINFO* module_info, MESSAGE_BUS_PRIORITY priority, MESSAGE_HANDLE message)
+{
+    MESSAGE_BUS_LANE* lane = &module_info->lanes[priority];
+    MESSAGE_HANDLE msg = Message_Clone(message);
+    MESSAGE_QUEUE_RESULT result = lane_push(module_info, lane, msg);
+
+    if (result == MESSAGE_QUEUE_FULL)
+    {
+        if (module_info->queue_config.policy == MESSAGE_BUS_QUEUE_DROP_OLDEST)
         {
-            /*all is fine, thread will eventually stop and be joined*/
+            /*Codes_SRS_MESSAGE_BUS_13_151: [If the module's lane is full and its policy is MESSAGE_BUS_QUEUE_DROP_OLDEST, MessageBus_Publish shall destroy the oldest message of the lane, count it as dropped and append the message.]*/
+            Message_Destroy(MessageQueue_Pop(lane->mq));
+            lane_popped(module_info, lane, 1, NULL);
+            MESSAGE_BUS_STAT_ADD(module_info->stats.dropped, 1);
+            result = lane_push(module_info, lane, msg);
+        }
+        else if (module_info->queue_config.policy == MESSAGE_BUS_QUEUE_BLOCK)
+        {
+            /*Codes_SRS_MESSAGE_BUS_13_152: [If the module's lane is full and its policy is MESSAGE_BUS_QUEUE_BLOCK, MessageBus_Publish shall wait on the space_cond of the lane for up to queue_config.timeout_ms milliseconds for room in the lane.]*/
+            result = wait_for_room(module_info, lane, msg);
         }
+    }
 
-        /*Codes_SRS_MESSAGE_BUS_02_003: [ After signaling the condition, MessageBus_RemoveModule shall unlock MESSAGE_BUS_MODULEINFO::mq_lock. ]*/
-        if (Unlock(module_info->mq_lock) != LOCK_OK)
+    if (result != MESSAGE_QUEUE_OK)
+    {
+        /*Codes_SRS_MESSAGE_BUS_13_153: [If the module's lane is still full, MessageBus_Publish shall destroy the clone of the message and count it as dropped.]*/
+        if (result == MESSAGE_QUEUE_FULL)
         {
-            LogError("unable to unlock mq_lock");
+            MESSAGE_BUS_STAT_ADD(module_info->stats.dropped, 1);
         }
+        Message_Destroy(msg);
     }
 
-    /*Codes_SRS_MESSAGE_BUS_13_104: [The function shall wait for the module's thread to exit by joining MESSAGE_BUS_MODULEINFO::thread via ThreadAPI_Join. ]*/
-    if (ThreadAPI_Join(module_info->thread, &thread_result) != THREADAPI_OK)
+    return result;
+}
+
+/*tells which lane of the modules the message goes to*/
+static MESSAGE_BUS_PRIORITY get_message_priority(MESSAGE_HANDLE message)
+{
+    const char* value = Message_GetProperty(message, MESSAGE_BUS_PRIORITY_PROPERTY);
+    return ((value != NULL) && (strcmp(value, MESSAGE_BUS_PRIORITY_HIGH_VALUE) == 0)) ? MESSAGE_BUS_PRIORITY_HIGH : MESSAGE_BUS_PRIORITY_NORMAL;
+}
+
+/*tells whether MessageBus_Publish would have to wait for room in the lane of the module; called with mq_lock held*/
+static bool must_wait_for_room(MESSAGE_BUS_MODULEINFO* module_info, MESSAGE_BUS_PRIORITY priority)
+{
+    return (module_info->queue_config.policy == MESSAGE_BUS_QUEUE_BLOCK) &&
+        (module_info->queue_config.timeout_ms != 0) &&
+        (module_info->queue_config.capacity != 0) &&
+        (MessageQueue_Size(module_info->lanes[priority].mq) >= module_info->queue_config.capacity);
+}
+
+/*appends the message to the lane of the module and wakes the module up; called with mq_lock held, which it releases*/
+static MESSAGE_BUS_RESULT publish_to_module(MESSAGE_BUS_MODULEINFO* module_info, MESSAGE_BUS_PRIORITY priority, MESSAGE_HANDLE message)
+{
+    MESSAGE_BUS_RESULT result = MESSAGE_BUS_OK;
+
+    /*Codes_SRS_MESSAGE_BUS_13_034: [The function shall then append message to the lane of the module by calling Message_Clone and MessageQueue_Push.]*/
+    MESSAGE_QUEUE_RESULT push_result = enqueue_message(module_info, priority, message);
+    if (push_result == MESSAGE_QUEUE_FULL)
     {
-        result = __LINE__;
-        LogError("ThreadAPI_Join() returned an error.");
+        /*Codes_SRS_MESSAGE_BUS_13_154: [A message dropped because of the queue policy of a module shall not cause MessageBus_Publish to return MESSAGE_BUS_ERROR.]*/
+        Unlock(module_info->mq_lock);
+    }
+    else if (push_result != MESSAGE_QUEUE_OK)
+    {
+        /*Codes_SRS_MESSAGE_BUS_13_037: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
+        LogError("MessageQueue_Push failed for module [%p]", module_info);
+        Unlock(module_info->mq_lock);
+        result = MESSAGE_BUS_ERROR;
     }
     else
     {
-        result = 0;
+        /*Codes_SRS_MESSAGE_BUS_13_096: [The function shall then signal MESSAGE_BUS_MODULEINFO::mq_cond.]*/
+        if (wake_module(module_info) != 0)
+        {
+            /*Codes_SRS_MESSAGE_BUS_13_037: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
+            LogError("unable to wake module [%p]", module_info);
+            result = MESSAGE_BUS_ERROR;
+        }
+
+        /*Codes_SRS_MESSAGE_BUS_13_035: [The function shall then release MESSAGE_BUS_MODULEINFO::mq_lock.]*/
+        if (Unlock(module_info->mq_lock) != LOCK_OK)
+        {
+            LogError("unable to unlock");
+        }
     }
 
-    /*Codes_SRS_MESSAGE_BUS_13_056: [If MESSAGE_BUS_MODULEINFO::mq is not empty then this function shall call Message_Destroy on every message still left in the collection.]*/
-    len = VECTOR_size(module_info->mq);
-    for (i = 0; i < len; i++)
+    return result;
+}
+
+/*publishes the message to a module MessageBus_Publish left out of its read side section to wait for room, then lets the module be freed*/
+static MESSAGE_BUS_RESULT publish_waiting(MESSAGE_BUS_MODULEINFO* module_info, MESSAGE_BUS_PRIORITY priority, MESSAGE_HANDLE message)
+{
+    MESSAGE_BUS_RESULT result;
+
+    if (Lock(module_info->mq_lock) != LOCK_OK)
+    {
+        LogError("Lock on module_info->mq_lock for module [%p] failed", module_info);
+        result = MESSAGE_BUS_ERROR;
+    }
+    else if (module_info->quit_worker != 0)
+    {
+        /*the module was taken off the bus since the snapshot was released*/
+        MESSAGE_BUS_STAT_ADD(module_info->stats.dropped, 1);
+        (void)Unlock(module_info->mq_lock);
+        result = MESSAGE_BUS_OK;
+    }
+    else
     {
-        // this MUST NOT be NULL
-        MESSAGE_HANDLE* msg = (MESSAGE_HANDLE*)VECTOR_element(module_info->mq, i);
-        Message_Destroy(*msg);
+        result = publish_to_module(module_info, priority, message);
     }
+
+    /*module_info may be freed as soon as this is 0*/
+    (void)MESSAGE_BUS_COUNTER_DEC(module_info->waiting_publishers);
+
     return result;
 }
 
-MESSAGE_BUS_RESULT MessageBus_AddModule(MESSAGE_BUS_HANDLE bus, const MODULE* module)
+MESSAGE_BUS_RESULT MessageBus_Publish(MESSAGE_BUS_HANDLE bus, MODULE_HANDLE source, MESSAGE_HANDLE message)
 {
     MESSAGE_BUS_RESULT result;
-
-    /*Codes_SRS_MESSAGE_BUS_13_038: [If `bus` or `module` or `module_apis` is NULL the function shall return MESSAGE_BUS_INVALIDARG.]*/
-    if (bus == NULL || module == NULL || module->module_data == NULL)
+    /*Codes_SRS_MESSAGE_BUS_13_030: [If bus or message is NULL the function shall return MESSAGE_BUS_INVALIDARG.]*/
+    if (bus == NULL || message == NULL)
     {
         result = MESSAGE_BUS_INVALIDARG;
-        LogError("invalid parameter (NULL).");
+        LogError("Bus handle and/or message handle is NULL");
     }
     else
     {
-        MESSAGE_BUS_MODULEINFO* module_info = (MESSAGE_BUS_MODULEINFO*)malloc(sizeof(MESSAGE_BUS_MODULEINFO));
-        if (module_info == NULL)
-        {
-            LogError("Allocate module info failed");
-            result = MESSAGE_BUS_ERROR;
-        }
-        else
+        /*Codes_SRS_MESSAGE_BUS_13_031: [MessageBus_Publish shall read MESSAGE_BUS_HANDLE_DATA::snapshot without acquiring MESSAGE_BUS_HANDLE_DATA::modules_lock and shall keep it from being freed until the loop ends.]*/
+        MESSAGE_BUS_HANDLE_DATA* bus_data = (MESSAGE_BUS_HANDLE_DATA*)bus;
+        long reader_epoch;
+        const MESSAGE_BUS_SNAPSHOT* snapshot = snapshot_acquire(bus_data, &reader_epoch);
+        size_t entry_count = (snapshot == NULL) ? 0 : snapshot->entry_count;
+        size_t slot_count = (snapshot == NULL) ? 0 : SubscriptionIndex_GetSlotCount(snapshot->subscriptions);
+        MESSAGE_BUS_PRIORITY priority = MESSAGE_BUS_PRIORITY_NORMAL;
+        size_t match_buffer[MESSAGE_BUS_MATCH_BUFFER_SIZE];
+        size_t* matches = NULL;
+        MESSAGE_BUS_MODULEINFO* wait_buffer[MESSAGE_BUS_WAIT_BUFFER_SIZE];
+        MESSAGE_BUS_MODULEINFO** waiting = NULL;
+        size_t waiting_count = 0;
+        size_t i;
+
+        /*Codes_SRS_MESSAGE_BUS_13_037: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
+        result = MESSAGE_BUS_OK;
+
+        if (slot_count > 0)
         {
-            if (init_module(module_info, module) != MESSAGE_BUS_OK)
+            /*Codes_SRS_MESSAGE_BUS_13_137: [If any module was added with a filter, MessageBus_Publish shall match the message properties against the subscription index of the snapshot once before the processing loop.]*/
+            matches = (slot_count <= MESSAGE_BUS_MATCH_BUFFER_SIZE) ? match_buffer : (size_t*)malloc(slot_count * sizeof(size_t));
+            if (matches == NULL)
             {
-                /*Codes_SRS_MESSAGE_BUS_13_047: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
-                LogError("start_module failed");
-                free(module_info);
+                LogError("malloc failed, the message will not be delivered to modules with a filter");
                 result = MESSAGE_BUS_ERROR;
             }
             else
             {
-                /*Codes_SRS_MESSAGE_BUS_13_039: [This function shall acquire the lock on MESSAGE_BUS_HANDLE_DATA::modules_lock.]*/
-                MESSAGE_BUS_HANDLE_DATA* bus_data = (MESSAGE_BUS_HANDLE_DATA*)bus;
-                if (Lock(bus_data->modules_lock) != LOCK_OK)
+                SubscriptionIndex_Match(snapshot->subscriptions, message, matches);
+            }
+        }
+
+        /*Codes_SRS_MESSAGE_BUS_13_168: [MessageBus_Publish shall queue the message in the high priority lane of the modules if its MESSAGE_BUS_PRIORITY_PROPERTY property is MESSAGE_BUS_PRIORITY_HIGH_VALUE, and in their normal priority lane otherwise.]*/
+        if (entry_count > 0)
+        {
+            priority = get_message_priority(message);
+        }
+
+        /*Codes_SRS_MESSAGE_BUS_13_032: [MessageBus_Publish shall start a processing loop for every module in the snapshot.]*/
+
+        // NOTE: This is a best-effort delivery bus which means that we offer no
+        // delivery guarantees. If message delivery for a particular module fails,
+        // we log the fact and go on our merry way trying to deliver messages to
+        // other modules on the bus. We will however return MESSAGE_BUS_ERROR when this
+        // happens.
+        for (i = 0; i < entry_count; i++)
+        {
+            const MESSAGE_BUS_SNAPSHOT_ENTRY* entry = &snapshot->entries[i];
+            MESSAGE_BUS_MODULEINFO* module_info = entry->module_info;
+
+            /*Codes_SRS_MESSAGE_BUS_17_002: [ If source is not NULL, MessageBus_Publish shall not publish the message to the MESSAGE_BUS_MODULEINFO::module which matches source. ]*/
+            /*Codes_SRS_MESSAGE_BUS_13_117: [If the routing of the bus is MESSAGE_BUS_ROUTING_LINKS, or MESSAGE_BUS_ROUTING_AUTOMATIC and there are links on the bus, MessageBus_Publish shall only publish the message to the modules that are the sink of a link whose source is NULL or matches source and whose filter, if any, matches the message properties.]*/
+            /*Codes_SRS_MESSAGE_BUS_13_138: [MessageBus_Publish shall not publish the message to a module added with a filter that the message does not match.]*/
+            if ((source == NULL || module_info->module_handle != source) &&
+                ((entry->has_subscription == false) || ((matches != NULL) && (matches[entry->subscription_slot] != 0))) &&
+                ((snapshot->routed == false) || module_has_matching_route(entry, source, message)))
+            {
+                /*Codes_SRS_MESSAGE_BUS_13_033: [In the loop, the function shall first acquire the lock on MESSAGE_BUS_MODULEINFO::mq_lock.]*/
+                if (Lock(module_info->mq_lock) != LOCK_OK)
                 {
-                    /*Codes_SRS_MESSAGE_BUS_13_047: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
-                    LogError("Lock on bus_data->modules_lock failed");
-                    deinit_module(module_info);
-                    free(module_info);
+                    /*Codes_SRS_MESSAGE_BUS_13_037: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
+                    LogError("Lock on module_info->mq_lock for module [%p] failed", module_info);
                     result = MESSAGE_BUS_ERROR;
                 }
                 else
                 {
-                    /*Codes_SRS_MESSAGE_BUS_13_045: [MessageBus_AddModule shall append the new instance of MESSAGE_BUS_MODULEINFO to MESSAGE_BUS_HANDLE_DATA::modules.]*/
-                    LIST_ITEM_HANDLE moduleListItem = list_add(bus_data->modules, module_info);
-                    if (moduleListItem == NULL)
-                    {
-                        /*Codes_SRS_MESSAGE_BUS_13_047: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
-                        LogError("list_add failed");
-                        deinit_module(module_info);
-                        free(module_info);
-                        result = MESSAGE_BUS_ERROR;
-                    }
-                    else
+                    /*Codes_SRS_MESSAGE_BUS_13_190: [If the lane of a module with the MESSAGE_BUS_QUEUE_BLOCK policy is full, MessageBus_Publish shall not wait for room in it before releasing the snapshot: it shall increment MESSAGE_BUS_MODULEINFO::waiting_publishers, release MESSAGE_BUS_MODULEINFO::mq_lock and publish the message to the module after the loop.]*/
+                    if (must_wait_for_room(module_info, priority))
                     {
-                        if (start_module(module_info) != MESSAGE_BUS_OK)
+                        if (waiting == NULL)
+                        {
+                            waiting = (entry_count <= MESSAGE_BUS_WAIT_BUFFER_SIZE) ? wait_buffer : (MESSAGE_BUS_MODULEINFO**)malloc(entry_count * sizeof(MESSAGE_BUS_MODULEINFO*));
+                        }
+
+                        if (waiting == NULL)
                         {
-                            LogError("start_module failed");
-                            deinit_module(module_info);
-                            list_remove(bus_data->modules, moduleListItem);
-                            free(module_info);
+                            /*Codes_SRS_MESSAGE_BUS_13_037: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
+                            LogError("malloc failed, the message is dropped for module [%p]", module_info);
+                            MESSAGE_BUS_STAT_ADD(module_info->stats.dropped, 1);
                             result = MESSAGE_BUS_ERROR;
                         }
                         else
                         {
-                            /*Codes_SRS_MESSAGE_BUS_13_047: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
-                            result = MESSAGE_BUS_OK;
+                            (void)MESSAGE_BUS_COUNTER_INC(module_info->waiting_publishers);
+                            waiting[waiting_count++] = module_info;
                         }
+                        (void)Unlock(module_info->mq_lock);
+                    }
+                    else if (publish_to_module(module_info, priority, message) != MESSAGE_BUS_OK)
+                    {
+                        result = MESSAGE_BUS_ERROR;
                     }
-
-                    /*Codes_SRS_MESSAGE_BUS_13_046: [This function shall release the lock on MESSAGE_BUS_HANDLE_DATA::modules_lock.]*/
-                    Unlock(bus_data->modules_lock);
                 }
             }
+        }
+
+        if (matches != match_buffer)
+        {
+            free(matches);
+        }
+
+        /*Codes_SRS_MESSAGE_BUS_13_040: [MessageBus_Publish shall release the snapshot after the loop.]*/
+        snapshot_release(bus_data, reader_epoch);
+
+        /*Codes_SRS_MESSAGE_BUS_13_191: [After releasing the snapshot, MessageBus_Publish shall acquire the MESSAGE_BUS_MODULEINFO::mq_lock of every module it left to wait for room, count the message as dropped if the module is being removed and otherwise append it as in the loop, then decrement MESSAGE_BUS_MODULEINFO::waiting_publishers.]*/
+        for (i = 0; i < waiting_count; i++)
+        {
+            if (publish_waiting(waiting[i], priority, message) != MESSAGE_BUS_OK)
+            {
+                result = MESSAGE_BUS_ERROR;
+            }
+        }
 
+        if (waiting != wait_buffer)
+        {
+            free(waiting);
         }
     }
 
     return result;
 }
 
-static bool find_module_predicate(LIST_ITEM_HANDLE list_item, const void* value)
+static bool route_matches_link(const MESSAGE_BUS_ROUTE* route, const MESSAGE_BUS_LINK* link)
 {
-    MESSAGE_BUS_MODULEINFO* element = (MESSAGE_BUS_MODULEINFO*)list_item_get_value(list_item);
-    return (element->module == value);
+    return
+        (route->module_source == link->module_source) &&
+        (((route->filter_property == NULL) && (link->filter_property == NULL)) ||
+         ((route->filter_property != NULL) && (link->filter_property != NULL) && (strcmp(route->filter_property, link->filter_property) == 0))) &&
+        (((route->filter_value == NULL) && (link->filter_value == NULL)) ||
+         ((route->filter_value != NULL) && (link->filter_value != NULL) && (strcmp(route->filter_value, link->filter_value) == 0)));
 }
 
-MESSAGE_BUS_RESULT MessageBus_RemoveModule(MESSAGE_BUS_HANDLE bus, MODULE_HANDLE module)
+MESSAGE_BUS_RESULT MessageBus_AddLink(MESSAGE_BUS_HANDLE bus, const MESSAGE_BUS_LINK* link)
 {
-    /*Codes_SRS_MESSAGE_BUS_13_048: [If `bus` or `module` is NULL the function shall return MESSAGE_BUS_INVALIDARG.]*/
     MESSAGE_BUS_RESULT result;
-    if (bus == NULL || module == NULL)
+
+    /*Codes_SRS_MESSAGE_BUS_13_118: [If bus, link or link->module_sink is NULL, MessageBus_AddLink shall return MESSAGE_BUS_INVALIDARG.]*/
+    /*Codes_SRS_MESSAGE_BUS_13_119: [If link->filter_value is not NULL and link->filter_property is NULL, MessageBus_AddLink shall return MESSAGE_BUS_INVALIDARG.]*/
+    if (bus == NULL || link == NULL || link->module_sink == NULL ||
+        (link->filter_value != NULL && link->filter_property == NULL))
     {
         result = MESSAGE_BUS_INVALIDARG;
-        LogError("invalid parameter (NULL).");
+        LogError("invalid arg: bus=%p, link=%p", bus, link);
     }
     else
     {
-        /*Codes_SRS_MESSAGE_BUS_13_088: [This function shall acquire the lock on MESSAGE_BUS_HANDLE_DATA::modules_lock.]*/
+        /*Codes_SRS_MESSAGE_BUS_13_120: [MessageBus_AddLink shall acquire the lock on MESSAGE_BUS_HANDLE_DATA::modules_lock.]*/
         MESSAGE_BUS_HANDLE_DATA* bus_data = (MESSAGE_BUS_HANDLE_DATA*)bus;
         if (Lock(bus_data->modules_lock) != LOCK_OK)
         {
-            /*Codes_SRS_MESSAGE_BUS_13_053: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
+            /*Codes_SRS_MESSAGE_BUS_13_125: [MessageBus_AddLink shall return MESSAGE_BUS_ERROR if an underlying API call fails.]*/
             LogError("Lock on bus_data->modules_lock failed");
             result = MESSAGE_BUS_ERROR;
         }
         else
         {
-            /*Codes_SRS_MESSAGE_BUS_13_049: [MessageBus_RemoveModule shall perform a linear search for module in MESSAGE_BUS_HANDLE_DATA::modules.]*/
-            LIST_ITEM_HANDLE module_info_item = list_find(bus_data->modules, find_module_predicate, module);
-
-            if (module_info_item == NULL)
+            /*Codes_SRS_MESSAGE_BUS_13_121: [MessageBus_AddLink shall return MESSAGE_BUS_ERROR if link->module_sink is not connected to the bus.]*/
+            LIST_ITEM_HANDLE module_info_item = list_find(bus_data->modules, find_module_predicate, link->module_sink);
+            /*Codes_SRS_MESSAGE_BUS_13_188: [MessageBus_AddLink shall return MESSAGE_BUS_INVALIDARG if the routing of the bus is MESSAGE_BUS_ROUTING_BROADCAST.]*/
+            if (bus_data->routing == MESSAGE_BUS_ROUTING_BROADCAST)
             {
-                /*Codes_SRS_MESSAGE_BUS_13_050: [MessageBus_RemoveModule shall unlock MESSAGE_BUS_HANDLE_DATA::modules_lock and return MESSAGE_BUS_ERROR if the module is not found in MESSAGE_BUS_HANDLE_DATA::modules.]*/
-                LogError("Supplied module was not found on the bus");
+                LogError("links cannot be added to a bus that broadcasts every message");
+                result = MESSAGE_BUS_INVALIDARG;
+            }
+            else if (module_info_item == NULL)
+            {
+                LogError("The sink module of the link was not found on the bus");
                 result = MESSAGE_BUS_ERROR;
             }
             else
             {
+                /*Codes_SRS_MESSAGE_BUS_13_122: [MessageBus_AddLink shall store a copy of link, including its filter strings, with the sink module.]*/
                 MESSAGE_BUS_MODULEINFO* module_info = (MESSAGE_BUS_MODULEINFO*)list_item_get_value(module_info_item);
-                if (stop_module(module_info) == 0)
+                MESSAGE_BUS_ROUTE route;
+                route.module_source = link->module_source;
+                route.filter_property = NULL;
+                route.filter_value = NULL;
+
+                if ((link->filter_property != NULL && mallocAndStrcpy_s(&route.filter_property, link->filter_property) != 0) ||
+                    (link->filter_value != NULL && mallocAndStrcpy_s(&route.filter_value, link->filter_value) != 0))
                 {
-                    deinit_module(module_info);
+                    /*Codes_SRS_MESSAGE_BUS_13_125: [MessageBus_AddLink shall return MESSAGE_BUS_ERROR if an underlying API call fails.]*/
+                    LogError("unable to copy the link filter");
+                    destroy_route(&route);
+                    result = MESSAGE_BUS_ERROR;
                 }
-                else
+                else if (VECTOR_push_back(module_info->routes, &route, 1) != 0)
                 {
-                    LogError("unable to stop module");
+                    /*Codes_SRS_MESSAGE_BUS_13_125: [MessageBus_AddLink shall return MESSAGE_BUS_ERROR if an underlying API call fails.]*/
+                    LogError("VECTOR_push_back failed");
+                    destroy_route(&route);
+                    result = MESSAGE_BUS_ERROR;
                 }
+                else
+                {
+                    /*Codes_SRS_MESSAGE_BUS_13_144: [MessageBus_AddLink and MessageBus_RemoveLink shall replace MESSAGE_BUS_HANDLE_DATA::snapshot with a new snapshot of the modules and links on the bus.]*/
+                    MESSAGE_BUS_SNAPSHOT* snapshot = snapshot_create(bus_data, bus_data->subscriptions, NULL, NULL, NULL);
+                    if (snapshot == NULL)
+                    {
+                        /*Codes_SRS_MESSAGE_BUS_13_125: [MessageBus_AddLink shall return MESSAGE_BUS_ERROR if an underlying API call fails.]*/
+                        MESSAGE_BUS_ROUTE* added = (MESSAGE_BUS_ROUTE*)VECTOR_element(module_info->routes, VECTOR_size(module_info->routes) - 1);
+                        LogError("unable to create a snapshot of the modules");
+                        destroy_route(added);
+                        VECTOR_erase(module_info->routes, added, 1);
+                        result = MESSAGE_BUS_ERROR;
+                    }
+                    else
+                    {
+                        snapshot_replace(bus_data, snapshot, bus_data->subscriptions);
 
-                /*Codes_SRS_MESSAGE_BUS_13_052: [The function shall remove the module from MESSAGE_BUS_HANDLE_DATA::modules.]*/
-                list_remove(bus_data->modules, module_info_item);
-                free(module_info);
-
-                /*Codes_SRS_MESSAGE_BUS_13_053: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
-                result = MESSAGE_BUS_OK;
+                        /*Codes_SRS_MESSAGE_BUS_13_123: [MessageBus_AddLink shall increment MESSAGE_BUS_HANDLE_DATA::link_count and return MESSAGE_BUS_OK.]*/
+                        bus_data->link_count++;
+                        result = MESSAGE_BUS_OK;
+                    }
+                }
             }
 
-            /*Codes_SRS_MESSAGE_BUS_13_054: [This function shall release the lock on MESSAGE_BUS_HANDLE_DATA::modules_lock.]*/
+            /*Codes_SRS_MESSAGE_BUS_13_124: [MessageBus_AddLink shall release the lock on MESSAGE_BUS_HANDLE_DATA::modules_lock.]*/
             Unlock(bus_data->modules_lock);
         }
     }
@@ -497,55 +2315,19 @@ MESSAGE_BUS_RESULT MessageBus_RemoveModule(MESSAGE_BUS_HANDLE bus, MODULE_HANDLE
     return result;
 }
 
-static void bus_decrement_ref(MESSAGE_BUS_HANDLE bus)
-{
-    /*Codes_SRS_MESSAGE_BUS_13_058: [If `bus` is NULL the function shall do nothing.]*/
-    if (bus != NULL)
-    {
-        /*Codes_SRS_MESSAGE_BUS_13_111: [Otherwise, MessageBus_Destroy shall decrement the internal ref count of the message.]*/
-        /*Codes_SRS_MESSAGE_BUS_13_112: [If the ref count is zero then the allocated resources are freed.]*/
-        if (DEC_REF(MESSAGE_BUS_HANDLE_DATA, bus) == DEC_RETURN_ZERO)
-        {
-            MESSAGE_BUS_HANDLE_DATA* bus_data = (MESSAGE_BUS_HANDLE_DATA*)bus; 
-            if (list_get_head_item(bus_data->modules) != NULL)
-            {
-                LogError("WARNING: There are still active modules connected to the bus and the bus is being destroyed.");
-            }
-
-            list_destroy(bus_data->modules);
-            Lock_Deinit(bus_data->modules_lock);
-            free(bus_data);
-        }
-    }
-    else
-    {
-        LogError("bus handle is NULL");
-    }
-}
-
-extern void MessageBus_Destroy(MESSAGE_BUS_HANDLE bus)
-{
-    bus_decrement_ref(bus);
-}
-
-extern void MessageBus_DecRef(MESSAGE_BUS_HANDLE bus)
-{
-    /*Codes_SRS_MESSAGE_BUS_13_113: [This function shall implement all the requirements of the MessageBus_Destroy API.]*/
-    bus_decrement_ref(bus);
-}
-
-MESSAGE_BUS_RESULT MessageBus_Publish(MESSAGE_BUS_HANDLE bus, MODULE_HANDLE source, MESSAGE_HANDLE message)
+MESSAGE_BUS_RESULT MessageBus_RemoveLink(MESSAGE_BUS_HANDLE bus, const MESSAGE_BUS_LINK* link)
 {
     MESSAGE_BUS_RESULT result;
-    /*Codes_SRS_MESSAGE_BUS_13_030: [If bus or message is NULL the function shall return MESSAGE_BUS_INVALIDARG.]*/
-    if (bus == NULL || message == NULL)
+
+    /*Codes_SRS_MESSAGE_BUS_13_126: [If bus, link or link->module_sink is NULL, MessageBus_RemoveLink shall return MESSAGE_BUS_INVALIDARG.]*/
+    if (bus == NULL || link == NULL || link->module_sink == NULL)
     {
         result = MESSAGE_BUS_INVALIDARG;
-        LogError("Bus handle and/or message handle is NULL");
+        LogError("invalid arg: bus=%p, link=%p", bus, link);
     }
     else
     {
-        /*Codes_SRS_MESSAGE_BUS_13_031: [MessageBus_Publish shall acquire the lock MESSAGE_BUS_HANDLE_DATA::modules_lock.]*/
+        /*Codes_SRS_MESSAGE_BUS_13_127: [MessageBus_RemoveLink shall acquire the lock on MESSAGE_BUS_HANDLE_DATA::modules_lock.]*/
         MESSAGE_BUS_HANDLE_DATA* bus_data = (MESSAGE_BUS_HANDLE_DATA*)bus;
         if (Lock(bus_data->modules_lock) != LOCK_OK)
         {
@@ -554,66 +2336,50 @@ MESSAGE_BUS_RESULT MessageBus_Publish(MESSAGE_BUS_HANDLE bus, MODULE_HANDLE sour
         }
         else
         {
-            /*Codes_SRS_MESSAGE_BUS_13_032: [MessageBus_Publish shall start a processing loop for every module in MESSAGE_BUS_HANDLE_DATA::modules.]*/
+            LIST_ITEM_HANDLE module_info_item = list_find(bus_data->modules, find_module_predicate, link->module_sink);
 
-            /*Codes_SRS_MESSAGE_BUS_13_037: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
-            result = MESSAGE_BUS_OK;
+            /*Codes_SRS_MESSAGE_BUS_13_128: [MessageBus_RemoveLink shall return MESSAGE_BUS_ERROR if the sink module or a link with the same source and filter is not found.]*/
+            result = MESSAGE_BUS_ERROR;
+            if (module_info_item == NULL)
+            {
+                LogError("The sink module of the link was not found on the bus");
+            }
+            else
+            {
+                MESSAGE_BUS_MODULEINFO* module_info = (MESSAGE_BUS_MODULEINFO*)list_item_get_value(module_info_item);
+                size_t i, route_count = VECTOR_size(module_info->routes);
+                for (i = 0; i < route_count; i++)
+                {
+                    MESSAGE_BUS_ROUTE* route = (MESSAGE_BUS_ROUTE*)VECTOR_element(module_info->routes, i);
+                    if (route_matches_link(route, link))
+                    {
+                        /*Codes_SRS_MESSAGE_BUS_13_144: [MessageBus_AddLink and MessageBus_RemoveLink shall replace MESSAGE_BUS_HANDLE_DATA::snapshot with a new snapshot of the modules and links on the bus.]*/
+                        MESSAGE_BUS_SNAPSHOT* snapshot = snapshot_create(bus_data, bus_data->subscriptions, NULL, NULL, route);
+                        if (snapshot == NULL)
+                        {
+                            LogError("unable to create a snapshot of the modules");
+                        }
+                        else
+                        {
+                            snapshot_replace(bus_data, snapshot, bus_data->subscriptions);
+
+                            /*Codes_SRS_MESSAGE_BUS_13_129: [MessageBus_RemoveLink shall remove the link, decrement MESSAGE_BUS_HANDLE_DATA::link_count and return MESSAGE_BUS_OK.]*/
+                            destroy_route(route);
+                            VECTOR_erase(module_info->routes, route, 1);
+                            bus_data->link_count--;
+                            result = MESSAGE_BUS_OK;
+                        }
+                        break;
+                    }
+                }
+
+                if (i == route_count)
+                {
+                    LogError("The link was not found on the bus");
+                }
+            }
 
-            // NOTE: This is a best-effort delivery bus which means that we offer no
-            // delivery guarantees. If message delivery for a particular module fails,
-            // we log the fact and go on our merry way trying to deliver messages to
-            // other modules on the bus. We will however return MESSAGE_BUS_ERROR when this
-            // happens.
-            for (LIST_ITEM_HANDLE current_module = list_get_head_item(bus_data->modules);
-                 current_module != NULL; 
-                 current_module = list_get_next_item(current_module))
-            {
-
-                MESSAGE_BUS_MODULEINFO* module_info = (MESSAGE_BUS_MODULEINFO*)list_item_get_value(current_module);
-
-				/*Codes_SRS_MESSAGE_BUS_17_002: [ If source is not NULL, MessageBus_Publish shall not publish the message to the MESSAGE_BUS_MODULEINFO::module which matches source. ]*/
-				if (source == NULL  || module_info->module != source)
-				{
-					/*Codes_SRS_MESSAGE_BUS_13_033: [In the loop, the function shall first acquire the lock on MESSAGE_BUS_MODULEINFO::mq_lock.]*/
-					if (Lock(module_info->mq_lock) != LOCK_OK)
-					{
-						/*Codes_SRS_MESSAGE_BUS_13_037: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
-						LogError("Lock on module_info->mq_lock for module at item [%p] failed", current_module);
-						result = MESSAGE_BUS_ERROR;
-					}
-					else
-					{
-						/*Codes_SRS_MESSAGE_BUS_13_034: [The function shall then append message to MESSAGE_BUS_MODULEINFO::mq by calling Message_Clone and VECTOR_push_back.]*/
-						MESSAGE_HANDLE msg = Message_Clone(message);
-						if (VECTOR_push_back(module_info->mq, &msg, 1) != 0)
-						{
-							/*Codes_SRS_MESSAGE_BUS_13_037: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
-							LogError("VECTOR_push_back failed for module at  item [%p] failed", current_module);
-							Message_Destroy(msg);
-							Unlock(module_info->mq_lock);
-							result = MESSAGE_BUS_ERROR;
-						}
-						else
-						{
-							/*Codes_SRS_MESSAGE_BUS_13_096: [The function shall then signal MESSAGE_BUS_MODULEINFO::mq_cond.]*/
-							if (Condition_Post(module_info->mq_cond) != COND_OK)
-							{
-								/*Codes_SRS_MESSAGE_BUS_13_037: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]*/
-								LogError("Condition_Post failed for module at  item [%p] failed", current_module);
-								result = MESSAGE_BUS_ERROR;
-							}
-
-							/*Codes_SRS_MESSAGE_BUS_13_035: [The function shall then release MESSAGE_BUS_MODULEINFO::mq_lock.]*/
-							if (Unlock(module_info->mq_lock) != LOCK_OK)
-							{
-								LogError("unable to unlock");
-							}
-						}
-					}
-				}
-            }
-
-            /*Codes_SRS_MESSAGE_BUS_13_040: [MessageBus_Publish shall release the lock MESSAGE_BUS_HANDLE_DATA::modules_lock after the loop.]*/
+            /*Codes_SRS_MESSAGE_BUS_13_130: [MessageBus_RemoveLink shall release the lock on MESSAGE_BUS_HANDLE_DATA::modules_lock.]*/
             Unlock(bus_data->modules_lock);
         }
     }
@@ -0,0 +1,486 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include "azure_c_shared_utility/gballoc.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "azure_c_shared_utility/iot_logging.h"
+
+#include "message_payload.h"
+
+/*
+* An encoded payload is:
+*     header:  0x93 'P' version, then the number of fields
+*     fields:  name length, name, 0, type, value
+* Lengths and counts are unsigned LEB128, integers are zigzag encoded LEB128,
+* numbers are the 8 bytes of the double, little endian, booleans are one byte
+* (0 or 1), strings are a length, the characters and 0, and byte arrays are a
+* length and the bytes.
+*/
+#define PAYLOAD_MAGIC_0 0x93
+#define PAYLOAD_MAGIC_1 'P'
+#define PAYLOAD_VERSION 1
+#define PAYLOAD_HEADER_SIZE 3
+
+/*the smallest field: an empty name, its 0, the type and a one byte value*/
+#define PAYLOAD_MIN_FIELD_SIZE 4
+
+static size_t varint_size(uint64_t value)
+{
+    size_t result = 1;
+    while (value >= 0x80)
+    {
+        value >>= 7;
+        result++;
+    }
+    return result;
+}
+
+static unsigned char* write_varint(unsigned char* destination, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        *destination++ = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    *destination++ = (unsigned char)value;
+    return destination;
+}
+
+/*reads a varint from [*cursor, end), returns false if it is truncated or longer than 64 bits*/
+static bool read_varint(const unsigned char** cursor, const unsigned char* end, uint64_t* value)
+{
+    bool result = false;
+    uint64_t read = 0;
+    unsigned int shift = 0;
+    const unsigned char* current = *cursor;
+    while ((current < end) && (shift < 64))
+    {
+        unsigned char byte = *current++;
+        read |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *cursor = current;
+            *value = read;
+            result = true;
+            break;
+        }
+        shift += 7;
+    }
+    return result;
+}
+
+static uint64_t zigzag_encode(int64_t value)
+{
+    return (value < 0) ? ~((uint64_t)value << 1) : ((uint64_t)value << 1);
+}
+
+static int64_t zigzag_decode(uint64_t value)
+{
+    return ((value & 1) != 0) ? (int64_t)~(value >> 1) : (int64_t)(value >> 1);
+}
+
+/*the encoded size of a field, or 0 if it is invalid*/
+static size_t field_size(const MESSAGE_PAYLOAD_FIELD* field)
+{
+    size_t result;
+    if (field->name == NULL)
+    {
+        result = 0;
+    }
+    else
+    {
+        size_t name_length = strlen(field->name);
+        result = varint_size(name_length) + name_length + 1 + 1;
+        switch (field->type)
+        {
+        case MESSAGE_PAYLOAD_INTEGER:
+            result += varint_size(zigzag_encode(field->value.integer));
+            break;
+        case MESSAGE_PAYLOAD_NUMBER:
+            result += sizeof(uint64_t);
+            break;
+        case MESSAGE_PAYLOAD_BOOLEAN:
+            result += 1;
+            break;
+        case MESSAGE_PAYLOAD_STRING:
+            if (field->value.string == NULL)
+            {
+                result = 0;
+            }
+            else
+            {
+                size_t length = strlen(field->value.string);
+                result += varint_size(length) + length + 1;
+            }
+            break;
+        case MESSAGE_PAYLOAD_BYTES:
+            if ((field->value.bytes.buffer == NULL) && (field->value.bytes.size > 0))
+            {
+                result = 0;
+            }
+            else
+            {
+                result += varint_size(field->value.bytes.size) + field->value.bytes.size;
+            }
+            break;
+        default:
+            result = 0;
+            break;
+        }
+    }
+    return result;
+}
+
+static int32_t encoded_size(const MESSAGE_PAYLOAD_FIELD* fields, size_t count)
+{
+    int32_t result;
+    if ((fields == NULL) && (count > 0))
+    {
+        LogError("invalid arg: fields is NULL and count is %zu", count);
+        result = -1;
+    }
+    else
+    {
+        size_t total = PAYLOAD_HEADER_SIZE + varint_size(count);
+        size_t i;
+        for (i = 0; i < count; i++)
+        {
+            size_t size = field_size(&fields[i]);
+            if (size == 0)
+            {
+                LogError("field %zu is invalid", i);
+                break;
+            }
+            else if (size > (size_t)INT32_MAX - total)
+            {
+                LogError("the encoded fields do not fit in an int32_t");
+                break;
+            }
+            else
+            {
+                total += size;
+            }
+        }
+        result = (i == count) ? (int32_t)total : -1;
+    }
+    return result;
+}
+
+/*writes fields that encoded_size checked*/
+static void encode_fields(const MESSAGE_PAYLOAD_FIELD* fields, size_t count, unsigned char* buffer)
+{
+    unsigned char* cursor = buffer;
+    size_t i;
+
+    *cursor++ = PAYLOAD_MAGIC_0;
+    *cursor++ = PAYLOAD_MAGIC_1;
+    *cursor++ = PAYLOAD_VERSION;
+    cursor = write_varint(cursor, count);
+
+    for (i = 0; i < count; i++)
+    {
+        const MESSAGE_PAYLOAD_FIELD* field = &fields[i];
+        size_t name_length = strlen(field->name);
+        cursor = write_varint(cursor, name_length);
+        (void)memcpy(cursor, field->name, name_length + 1);
+        cursor += name_length + 1;
+        *cursor++ = (unsigned char)field->type;
+
+        switch (field->type)
+        {
+        case MESSAGE_PAYLOAD_INTEGER:
+            cursor = write_varint(cursor, zigzag_encode(field->value.integer));
+            break;
+        case MESSAGE_PAYLOAD_NUMBER:
+        {
+            uint64_t bits;
+            size_t byte;
+            (void)memcpy(&bits, &field->value.number, sizeof(bits));
+            for (byte = 0; byte < sizeof(bits); byte++)
+            {
+                *cursor++ = (unsigned char)(bits >> (8 * byte));
+            }
+            break;
+        }
+        case MESSAGE_PAYLOAD_BOOLEAN:
+            *cursor++ = field->value.boolean ? 1 : 0;
+            break;
+        case MESSAGE_PAYLOAD_STRING:
+        {
+            size_t length = strlen(field->value.string);
+            cursor = write_varint(cursor, length);
+            (void)memcpy(cursor, field->value.string, length + 1);
+            cursor += length + 1;
+            break;
+        }
+        default: /*MESSAGE_PAYLOAD_BYTES*/
+            cursor = write_varint(cursor, field->value.bytes.size);
+            if (field->value.bytes.size > 0)
+            {
+                (void)memcpy(cursor, field->value.bytes.buffer, field->value.bytes.size);
+                cursor += field->value.bytes.size;
+            }
+            break;
+        }
+    }
+}
+
+/*reads a length, the characters and their 0, returns false if they do not fit in [*cursor, end) or hold another 0*/
+static bool read_string(const unsigned char** cursor, const unsigned char* end, const char** string)
+{
+    bool result;
+    uint64_t length;
+    if (!read_varint(cursor, end, &length) ||
+        (length >= (uint64_t)(end - *cursor)) ||
+        (memchr(*cursor, 0, (size_t)length + 1) != *cursor + length))
+    {
+        result = false;
+    }
+    else
+    {
+        *string = (const char*)*cursor;
+        *cursor += length + 1;
+        result = true;
+    }
+    return result;
+}
+
+/*decodes one field from [*cursor, end), returns false if it is invalid*/
+static bool decode_field(const unsigned char** cursor, const unsigned char* end, MESSAGE_PAYLOAD_FIELD* field)
+{
+    bool result;
+    if (!read_string(cursor, end, &field->name) || (*cursor == end))
+    {
+        result = false;
+    }
+    else
+    {
+        uint64_t value;
+        unsigned char type = *(*cursor)++;
+        switch (type)
+        {
+        case MESSAGE_PAYLOAD_INTEGER:
+            result = read_varint(cursor, end, &value);
+            if (result)
+            {
+                field->value.integer = zigzag_decode(value);
+            }
+            break;
+        case MESSAGE_PAYLOAD_NUMBER:
+            if ((size_t)(end - *cursor) < sizeof(uint64_t))
+            {
+                result = false;
+            }
+            else
+            {
+                size_t byte;
+                value = 0;
+                for (byte = 0; byte < sizeof(uint64_t); byte++)
+                {
+                    value |= (uint64_t)(*cursor)[byte] << (8 * byte);
+                }
+                (void)memcpy(&field->value.number, &value, sizeof(value));
+                *cursor += sizeof(uint64_t);
+                result = true;
+            }
+            break;
+        case MESSAGE_PAYLOAD_BOOLEAN:
+            result = (*cursor < end) && (**cursor <= 1);
+            if (result)
+            {
+                field->value.boolean = (*(*cursor)++ == 1);
+            }
+            break;
+        case MESSAGE_PAYLOAD_STRING:
+            result = read_string(cursor, end, &field->value.string);
+            break;
+        case MESSAGE_PAYLOAD_BYTES:
+            result = read_varint(cursor, end, &value) && (value <= (uint64_t)(end - *cursor));
+            if (result)
+            {
+                field->value.bytes.buffer = (value == 0) ? NULL : *cursor;
+                field->value.bytes.size = (size_t)value;
+                *cursor += value;
+            }
+            break;
+        default:
+            result = false;
+            break;
+        }
+        field->type = (MESSAGE_PAYLOAD_TYPE)type;
+    }
+    return result;
+}
+
+/*checks the header and reads the number of fields, which cannot be more than what the rest of the payload could hold*/
+static bool read_header(const unsigned char* source, size_t size, const unsigned char** cursor, uint64_t* field_count)
+{
+    bool result;
+    if (!MessagePayload_IsEncoded(source, size))
+    {
+        result = false;
+    }
+    else
+    {
+        const unsigned char* end = source + size;
+        *cursor = source + PAYLOAD_HEADER_SIZE;
+        result = read_varint(cursor, end, field_count) &&
+            (*field_count <= (uint64_t)(end - *cursor) / PAYLOAD_MIN_FIELD_SIZE);
+    }
+    return result;
+}
+
+int32_t MessagePayload_GetEncodedSize(const MESSAGE_PAYLOAD_FIELD* fields, size_t count)
+{
+    /*Codes_SRS_MESSAGE_PAYLOAD_13_001: [If fields is NULL and count is not 0, or any field is invalid, MessagePayload_GetEncodedSize shall return -1.]*/
+    /*Codes_SRS_MESSAGE_PAYLOAD_13_002: [If the encoded fields would not fit in an int32_t, MessagePayload_GetEncodedSize shall return -1.]*/
+    /*Codes_SRS_MESSAGE_PAYLOAD_13_003: [Otherwise, MessagePayload_GetEncodedSize shall return the number of bytes MessagePayload_Encode writes for the fields.]*/
+    return encoded_size(fields, count);
+}
+
+int32_t MessagePayload_Encode(const MESSAGE_PAYLOAD_FIELD* fields, size_t count, unsigned char* buffer, int32_t size)
+{
+    int32_t result;
+    if (buffer == NULL)
+    {
+        /*Codes_SRS_MESSAGE_PAYLOAD_13_004: [If buffer is NULL, MessagePayload_Encode shall return -1.]*/
+        LogError("invalid arg: buffer is NULL");
+        result = -1;
+    }
+    /*Codes_SRS_MESSAGE_PAYLOAD_13_005: [If fields is NULL and count is not 0, or any field is invalid, MessagePayload_Encode shall return -1.]*/
+    else if ((result = encoded_size(fields, count)) < 0)
+    {
+        result = -1;
+    }
+    else if (result > size)
+    {
+        /*Codes_SRS_MESSAGE_PAYLOAD_13_006: [If the encoded fields do not fit in size bytes, MessagePayload_Encode shall return -1 and write nothing.]*/
+        LogError("the encoded fields need %" PRId32 " bytes, the buffer has %" PRId32, result, size);
+        result = -1;
+    }
+    else
+    {
+        /*Codes_SRS_MESSAGE_PAYLOAD_13_007: [MessagePayload_Encode shall write the encoded fields to buffer and return the number of bytes written.]*/
+        encode_fields(fields, count, buffer);
+    }
+    return result;
+}
+
+MESSAGE_HANDLE MessagePayload_CreateMessage(const MESSAGE_PAYLOAD_FIELD* fields, size_t count, MAP_HANDLE properties)
+{
+    MESSAGE_HANDLE result;
+    int32_t size;
+    unsigned char* content;
+    if (properties == NULL)
+    {
+        /*Codes_SRS_MESSAGE_PAYLOAD_13_008: [If properties is NULL, MessagePayload_CreateMessage shall return NULL.]*/
+        LogError("invalid arg: properties is NULL");
+        result = NULL;
+    }
+    /*Codes_SRS_MESSAGE_PAYLOAD_13_009: [If fields is NULL and count is not 0, or any field is invalid, MessagePayload_CreateMessage shall return NULL.]*/
+    else if ((size = encoded_size(fields, count)) < 0)
+    {
+        result = NULL;
+    }
+    /*Codes_SRS_MESSAGE_PAYLOAD_13_010: [MessagePayload_CreateMessage shall allocate a buffer for the encoded fields.]*/
+    else if ((content = (unsigned char*)malloc((size_t)size)) == NULL)
+    {
+        /*Codes_SRS_MESSAGE_PAYLOAD_13_013: [If any step fails, MessagePayload_CreateMessage shall free what it allocated and return NULL.]*/
+        LogError("unable to allocate %" PRId32 " bytes for the payload", size);
+        result = NULL;
+    }
+    else
+    {
+        MESSAGE_ADOPT_CONFIG config;
+
+        /*Codes_SRS_MESSAGE_PAYLOAD_13_011: [MessagePayload_CreateMessage shall encode the fields into the buffer.]*/
+        encode_fields(fields, count, content);
+
+        /*Codes_SRS_MESSAGE_PAYLOAD_13_012: [MessagePayload_CreateMessage shall create the message by calling Message_CreateAdopt with the buffer and properties, and return it.]*/
+        config.size = (size_t)size;
+        config.source = content;
+        config.release = NULL;
+        config.releaseContext = NULL;
+        config.sourceProperties = properties;
+        result = Message_CreateAdopt(&config);
+        if (result == NULL)
+        {
+            /*Codes_SRS_MESSAGE_PAYLOAD_13_013: [If any step fails, MessagePayload_CreateMessage shall free what it allocated and return NULL.]*/
+            LogError("unable to create the message");
+            free(content);
+        }
+    }
+    return result;
+}
+
+bool MessagePayload_IsEncoded(const unsigned char* source, size_t size)
+{
+    /*Codes_SRS_MESSAGE_PAYLOAD_13_014: [MessagePayload_IsEncoded shall return true if source is not NULL and starts with the header of an encoded payload, and false otherwise.]*/
+    return (source != NULL) &&
+        (size >= PAYLOAD_HEADER_SIZE + 1) &&
+        (source[0] == PAYLOAD_MAGIC_0) &&
+        (source[1] == PAYLOAD_MAGIC_1) &&
+        (source[2] == PAYLOAD_VERSION);
+}
+
+int MessagePayload_Decode(const unsigned char* source, size_t size, MESSAGE_PAYLOAD_FIELD* fields, size_t* count)
+{
+    int result;
+    const unsigned char* cursor;
+    uint64_t field_count;
+    if ((source == NULL) || (count == NULL) || ((fields == NULL) && (*count > 0)))
+    {
+        /*Codes_SRS_MESSAGE_PAYLOAD_13_015: [If source or count is NULL, or fields is NULL and *count is not 0, MessagePayload_Decode shall fail and return a non-zero value.]*/
+        LogError("invalid arg: source, count or fields is NULL");
+        result = __LINE__;
+    }
+    else if (!read_header(source, size, &cursor, &field_count))
+    {
+        /*Codes_SRS_MESSAGE_PAYLOAD_13_016: [If source does not start with a valid header, MessagePayload_Decode shall fail and return a non-zero value.]*/
+        LogError("the source is not an encoded payload");
+        result = __LINE__;
+    }
+    else if (field_count > *count)
+    {
+        /*Codes_SRS_MESSAGE_PAYLOAD_13_017: [If the payload has more fields than *count, MessagePayload_Decode shall set *count to the number of fields and fail and return a non-zero value.]*/
+        *count = (size_t)field_count;
+        result = __LINE__;
+    }
+    else
+    {
+        size_t i;
+
+        /*Codes_SRS_MESSAGE_PAYLOAD_13_018: [MessagePayload_Decode shall decode the fields into fields, with names and values that point into source.]*/
+        for (i = 0; i < field_count; i++)
+        {
+            if (!decode_field(&cursor, source + size, &fields[i]))
+            {
+                break;
+            }
+        }
+
+        if ((i < field_count) || (cursor != source + size))
+        {
+            /*Codes_SRS_MESSAGE_PAYLOAD_13_019: [If a field is invalid or bytes are left after the last field, MessagePayload_Decode shall fail and return a non-zero value.]*/
+            LogError("the payload is invalid");
+            result = __LINE__;
+        }
+        else
+        {
+            /*Codes_SRS_MESSAGE_PAYLOAD_13_020: [On success, MessagePayload_Decode shall set *count to the number of fields and return 0.]*/
+            *count = (size_t)field_count;
+            result = 0;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,505 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include "azure_c_shared_utility/gballoc.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/iot_logging.h"
+
+#include "message_pool.h"
+
+/*thread local storage, and the atomic operations on the state shared by the threads*/
+#if defined(WIN32)
+#include <windows.h>
+#define MESSAGE_POOL_THREAD_LOCAL __declspec(thread)
+typedef volatile LONG MESSAGE_POOL_FLAG;
+typedef volatile LONGLONG MESSAGE_POOL_COUNTER;
+#define MESSAGE_POOL_FLAG_GET(flag) InterlockedCompareExchange(&(flag), 0, 0)
+#define MESSAGE_POOL_FLAG_SET(flag, value) (void)InterlockedExchange(&(flag), (value))
+#define MESSAGE_POOL_POINTER_GET(pointer) InterlockedCompareExchangePointer((PVOID volatile*)&(pointer), NULL, NULL)
+#define MESSAGE_POOL_POINTER_SET_IF_NULL(pointer, value) (InterlockedCompareExchangePointer((PVOID volatile*)&(pointer), (value), NULL) == NULL)
+#define MESSAGE_POOL_COUNTER_ADD(counter, value) (void)InterlockedExchangeAdd64(&(counter), (LONGLONG)(value))
+#define MESSAGE_POOL_COUNTER_GET(counter) ((uint64_t)InterlockedCompareExchange64(&(counter), 0, 0))
+#define MESSAGE_POOL_COUNTER_RESET(counter) (void)InterlockedExchange64(&(counter), 0)
+#elif defined(__GNUC__)
+#define MESSAGE_POOL_THREAD_LOCAL __thread
+typedef volatile long MESSAGE_POOL_FLAG;
+typedef volatile uint64_t MESSAGE_POOL_COUNTER;
+#define MESSAGE_POOL_FLAG_GET(flag) __atomic_load_n(&(flag), __ATOMIC_SEQ_CST)
+#define MESSAGE_POOL_FLAG_SET(flag, value) __atomic_store_n(&(flag), (value), __ATOMIC_SEQ_CST)
+#define MESSAGE_POOL_POINTER_GET(pointer) __atomic_load_n(&(pointer), __ATOMIC_SEQ_CST)
+#define MESSAGE_POOL_POINTER_SET_IF_NULL(pointer, value) __sync_bool_compare_and_swap(&(pointer), NULL, (value))
+#define MESSAGE_POOL_COUNTER_ADD(counter, value) (void)__atomic_add_fetch(&(counter), (uint64_t)(value), __ATOMIC_SEQ_CST)
+#define MESSAGE_POOL_COUNTER_GET(counter) __atomic_load_n(&(counter), __ATOMIC_SEQ_CST)
+#define MESSAGE_POOL_COUNTER_RESET(counter) __atomic_store_n(&(counter), 0, __ATOMIC_SEQ_CST)
+#else
+#error "the message pool needs thread local storage and atomic operations on this platform"
+#endif
+
+#define NO_SIZE_CLASS ((size_t)-1)
+#define SMALLEST_SIZE_CLASS_BYTES 128
+
+struct MESSAGE_POOL_THREAD_CACHE_TAG;
+
+/*every block starts with this, MessagePool_Allocate returns the bytes that follow it*/
+typedef struct MESSAGE_POOL_BLOCK_TAG
+{
+    union
+    {
+        /*while allocated: the cache of the thread that allocated the block*/
+        struct MESSAGE_POOL_THREAD_CACHE_TAG* owner;
+        /*while free: the next free block of the same size class*/
+        struct MESSAGE_POOL_BLOCK_TAG* next;
+    } link;
+    size_t size_class;
+}MESSAGE_POOL_BLOCK;
+
+typedef struct MESSAGE_POOL_THREAD_CACHE_TAG
+{
+    MESSAGE_POOL_BLOCK* free_blocks[MESSAGE_POOL_SIZE_CLASS_COUNT];
+    size_t free_block_count[MESSAGE_POOL_SIZE_CLASS_COUNT];
+
+    /*the generation of the pool the blocks were cached under, 0 when the cache is empty*/
+    long generation;
+}MESSAGE_POOL_THREAD_CACHE;
+
+static MESSAGE_POOL_THREAD_LOCAL MESSAGE_POOL_THREAD_CACHE thread_cache;
+
+/*
+* 0 while the pool is disabled. Every MessagePool_Enable starts a new
+* generation so that threads notice that their caches are stale.
+*/
+static MESSAGE_POOL_FLAG pool_generation;
+static long last_generation;
+static MESSAGE_POOL_CONFIG pool_config;
+
+/*the central free lists, guarded by central_lock; the lock is created on first use and never destroyed*/
+static LOCK_HANDLE central_lock;
+static MESSAGE_POOL_BLOCK* central_free_blocks[MESSAGE_POOL_SIZE_CLASS_COUNT];
+static size_t central_free_block_count[MESSAGE_POOL_SIZE_CLASS_COUNT];
+static uint64_t central_allocations;
+static uint64_t central_frees;
+
+static MESSAGE_POOL_COUNTER heap_allocations;
+static MESSAGE_POOL_COUNTER heap_frees;
+
+static LOCK_HANDLE get_central_lock(void)
+{
+    LOCK_HANDLE result = (LOCK_HANDLE)MESSAGE_POOL_POINTER_GET(central_lock);
+    if (result == NULL)
+    {
+        LOCK_HANDLE lock = Lock_Init();
+        if (lock == NULL)
+        {
+            LogError("Lock_Init failed");
+        }
+        else if (MESSAGE_POOL_POINTER_SET_IF_NULL(central_lock, lock))
+        {
+            result = lock;
+        }
+        else
+        {
+            /*another thread created the lock meanwhile*/
+            (void)Lock_Deinit(lock);
+            result = (LOCK_HANDLE)MESSAGE_POOL_POINTER_GET(central_lock);
+        }
+    }
+    return result;
+}
+
+/*returns 0 once the central free lists are locked*/
+static int lock_central(void)
+{
+    int result;
+    LOCK_HANDLE lock = get_central_lock();
+    if (lock == NULL)
+    {
+        result = __LINE__;
+    }
+    else if (Lock(lock) != LOCK_OK)
+    {
+        LogError("unable to lock the central free lists");
+        result = __LINE__;
+    }
+    else
+    {
+        result = 0;
+    }
+    return result;
+}
+
+static void unlock_central(void)
+{
+    (void)Unlock((LOCK_HANDLE)MESSAGE_POOL_POINTER_GET(central_lock));
+}
+
+static size_t get_size_class_bytes(size_t size_class)
+{
+    return (size_t)SMALLEST_SIZE_CLASS_BYTES << size_class;
+}
+
+/*returns the smallest size class with room for size bytes after the block header, or NO_SIZE_CLASS*/
+static size_t get_size_class(size_t size)
+{
+    size_t result = NO_SIZE_CLASS;
+    if (size <= get_size_class_bytes(MESSAGE_POOL_SIZE_CLASS_COUNT - 1) - sizeof(MESSAGE_POOL_BLOCK))
+    {
+        result = 0;
+        while (get_size_class_bytes(result) - sizeof(MESSAGE_POOL_BLOCK) < size)
+        {
+            result++;
+        }
+    }
+    return result;
+}
+
+static void free_to_heap(MESSAGE_POOL_BLOCK* block, long generation)
+{
+    free(block);
+    if (generation != 0)
+    {
+        MESSAGE_POOL_COUNTER_ADD(heap_frees, 1);
+    }
+}
+
+/*gives a block to the central free list of its size class, or to the heap when that is full*/
+static void free_to_central(MESSAGE_POOL_BLOCK* block)
+{
+    int cached;
+    long generation;
+    if (lock_central() != 0)
+    {
+        /*Codes_SRS_MESSAGE_POOL_13_021: [If the central free lists cannot be locked, MessagePool_Allocate and MessagePool_Free shall use the heap instead of them.]*/
+        generation = MESSAGE_POOL_FLAG_GET(pool_generation);
+        cached = 0;
+    }
+    else
+    {
+        /*the pool might have been disabled since the caller looked*/
+        generation = MESSAGE_POOL_FLAG_GET(pool_generation);
+        if ((generation != 0) && (central_free_block_count[block->size_class] < pool_config.central_cache_blocks))
+        {
+            block->link.next = central_free_blocks[block->size_class];
+            central_free_blocks[block->size_class] = block;
+            central_free_block_count[block->size_class]++;
+            central_frees++;
+            cached = 1;
+        }
+        else
+        {
+            cached = 0;
+        }
+        unlock_central();
+    }
+
+    if (!cached)
+    {
+        free_to_heap(block, generation);
+    }
+}
+
+/*empties the cache of the calling thread, into the central free lists if the pool is still enabled with the same generation*/
+static void release_thread_cache(long generation)
+{
+    size_t size_class;
+    for (size_class = 0; size_class < MESSAGE_POOL_SIZE_CLASS_COUNT; size_class++)
+    {
+        while (thread_cache.free_blocks[size_class] != NULL)
+        {
+            MESSAGE_POOL_BLOCK* block = thread_cache.free_blocks[size_class];
+            thread_cache.free_blocks[size_class] = block->link.next;
+            if (thread_cache.generation == generation)
+            {
+                free_to_central(block);
+            }
+            else
+            {
+                free_to_heap(block, generation);
+            }
+        }
+        thread_cache.free_block_count[size_class] = 0;
+    }
+    thread_cache.generation = 0;
+}
+
+static MESSAGE_POOL_THREAD_CACHE* get_thread_cache(long generation)
+{
+    if (thread_cache.generation != generation)
+    {
+        /*the blocks were cached by a previous generation of the pool*/
+        release_thread_cache(generation);
+        thread_cache.generation = generation;
+    }
+    return &thread_cache;
+}
+
+/*moves up to half a thread cache worth of blocks from the central free list to the thread, returns one of them*/
+static MESSAGE_POOL_BLOCK* allocate_from_central(MESSAGE_POOL_THREAD_CACHE* cache, size_t size_class)
+{
+    MESSAGE_POOL_BLOCK* result;
+    size_t wanted = pool_config.thread_cache_blocks / 2;
+
+    if (lock_central() != 0)
+    {
+        /*Codes_SRS_MESSAGE_POOL_13_021: [If the central free lists cannot be locked, MessagePool_Allocate and MessagePool_Free shall use the heap instead of them.]*/
+        result = NULL;
+    }
+    else
+    {
+        result = central_free_blocks[size_class];
+        if (result != NULL)
+        {
+            central_free_blocks[size_class] = result->link.next;
+            central_free_block_count[size_class]--;
+            central_allocations++;
+            while ((wanted > 0) && (central_free_blocks[size_class] != NULL))
+            {
+                MESSAGE_POOL_BLOCK* block = central_free_blocks[size_class];
+                central_free_blocks[size_class] = block->link.next;
+                central_free_block_count[size_class]--;
+                central_allocations++;
+
+                block->link.next = cache->free_blocks[size_class];
+                cache->free_blocks[size_class] = block;
+                cache->free_block_count[size_class]++;
+                wanted--;
+            }
+        }
+        unlock_central();
+    }
+    return result;
+}
+
+int MessagePool_Enable(const MESSAGE_POOL_CONFIG* config)
+{
+    int result;
+    if (config == NULL)
+    {
+        /*Codes_SRS_MESSAGE_POOL_13_001: [If config is NULL then MessagePool_Enable shall fail and return a non-zero value.]*/
+        LogError("invalid argument: config is NULL");
+        result = __LINE__;
+    }
+    else if ((config->thread_cache_blocks == 0) && (config->central_cache_blocks == 0))
+    {
+        /*Codes_SRS_MESSAGE_POOL_13_002: [If config asks to cache no block at all then MessagePool_Enable shall fail and return a non-zero value.]*/
+        LogError("invalid argument: the pool would not cache any block");
+        result = __LINE__;
+    }
+    else if (MESSAGE_POOL_FLAG_GET(pool_generation) != 0)
+    {
+        /*Codes_SRS_MESSAGE_POOL_13_003: [If the pool is already enabled then MessagePool_Enable shall fail and return a non-zero value.]*/
+        LogError("the message pool is already enabled");
+        result = __LINE__;
+    }
+    else if (lock_central() != 0)
+    {
+        /*Codes_SRS_MESSAGE_POOL_13_018: [If the central free lists cannot be locked, MessagePool_Enable shall fail and return a non-zero value.]*/
+        result = __LINE__;
+    }
+    else
+    {
+        /*Codes_SRS_MESSAGE_POOL_13_004: [MessagePool_Enable shall reset the statistics of the pool, start a new generation of the pool and return 0.]*/
+        pool_config = *config;
+        central_allocations = 0;
+        central_frees = 0;
+        unlock_central();
+        MESSAGE_POOL_COUNTER_RESET(heap_allocations);
+        MESSAGE_POOL_COUNTER_RESET(heap_frees);
+
+        last_generation++;
+        MESSAGE_POOL_FLAG_SET(pool_generation, last_generation);
+        result = 0;
+    }
+    return result;
+}
+
+void MessagePool_Disable(void)
+{
+    if (lock_central() != 0)
+    {
+        /*Codes_SRS_MESSAGE_POOL_13_019: [If the central free lists cannot be locked, MessagePool_Disable shall still disable the pool and leave the blocks of the central free lists to the next MessagePool_Disable.]*/
+        LogError("the blocks of the central free lists are not freed");
+        MESSAGE_POOL_FLAG_SET(pool_generation, 0);
+    }
+    else
+    {
+        size_t size_class;
+
+        /*Codes_SRS_MESSAGE_POOL_13_005: [MessagePool_Disable shall disable the pool so that blocks are allocated from and freed to the heap.]*/
+        MESSAGE_POOL_FLAG_SET(pool_generation, 0);
+
+        /*Codes_SRS_MESSAGE_POOL_13_006: [MessagePool_Disable shall free the blocks of the central free lists.]*/
+        for (size_class = 0; size_class < MESSAGE_POOL_SIZE_CLASS_COUNT; size_class++)
+        {
+            while (central_free_blocks[size_class] != NULL)
+            {
+                MESSAGE_POOL_BLOCK* block = central_free_blocks[size_class];
+                central_free_blocks[size_class] = block->link.next;
+                free(block);
+            }
+            central_free_block_count[size_class] = 0;
+        }
+        unlock_central();
+    }
+
+    /*Codes_SRS_MESSAGE_POOL_13_007: [MessagePool_Disable shall free the blocks cached by the calling thread.]*/
+    release_thread_cache(0);
+}
+
+void MessagePool_ReleaseThreadCache(void)
+{
+    /*Codes_SRS_MESSAGE_POOL_13_008: [MessagePool_ReleaseThreadCache shall give the blocks cached by the calling thread to the central free lists, or to the heap when they are full or the pool is disabled.]*/
+    release_thread_cache(MESSAGE_POOL_FLAG_GET(pool_generation));
+}
+
+int MessagePool_GetStatistics(MESSAGE_POOL_STATISTICS* statistics)
+{
+    int result;
+    if (statistics == NULL)
+    {
+        /*Codes_SRS_MESSAGE_POOL_13_009: [If statistics is NULL then MessagePool_GetStatistics shall fail and return a non-zero value.]*/
+        LogError("invalid argument: statistics is NULL");
+        result = __LINE__;
+    }
+    else if (lock_central() != 0)
+    {
+        /*Codes_SRS_MESSAGE_POOL_13_020: [If the central free lists cannot be locked, MessagePool_GetStatistics shall fail and return a non-zero value.]*/
+        result = __LINE__;
+    }
+    else
+    {
+        /*Codes_SRS_MESSAGE_POOL_13_010: [MessagePool_GetStatistics shall copy the counters of the pool to statistics and return 0.]*/
+        size_t size_class;
+        statistics->central_allocations = central_allocations;
+        statistics->central_frees = central_frees;
+        statistics->central_cached_blocks = 0;
+        for (size_class = 0; size_class < MESSAGE_POOL_SIZE_CLASS_COUNT; size_class++)
+        {
+            statistics->central_cached_blocks += central_free_block_count[size_class];
+        }
+        unlock_central();
+        statistics->heap_allocations = MESSAGE_POOL_COUNTER_GET(heap_allocations);
+        statistics->heap_frees = MESSAGE_POOL_COUNTER_GET(heap_frees);
+        result = 0;
+    }
+    return result;
+}
+
+void* MessagePool_Allocate(size_t size)
+{
+    void* result;
+    long generation = MESSAGE_POOL_FLAG_GET(pool_generation);
+    size_t size_class = (generation == 0) ? NO_SIZE_CLASS : get_size_class(size);
+    MESSAGE_POOL_BLOCK* block;
+
+    if (size > SIZE_MAX - sizeof(MESSAGE_POOL_BLOCK))
+    {
+        LogError("invalid argument: size too big (%zu)", size);
+        result = NULL;
+    }
+    else if (size_class == NO_SIZE_CLASS)
+    {
+        if ((generation == 0) && (thread_cache.generation != 0))
+        {
+            release_thread_cache(0);
+        }
+
+        /*Codes_SRS_MESSAGE_POOL_13_011: [If the pool is disabled or size does not fit the largest size class, MessagePool_Allocate shall allocate the block from the heap.]*/
+        block = (MESSAGE_POOL_BLOCK*)malloc(sizeof(MESSAGE_POOL_BLOCK) + size);
+        if (block == NULL)
+        {
+            /*Codes_SRS_MESSAGE_POOL_13_013: [If allocating the block fails, MessagePool_Allocate shall return NULL.]*/
+            LogError("malloc failed");
+            result = NULL;
+        }
+        else
+        {
+            if (generation != 0)
+            {
+                MESSAGE_POOL_COUNTER_ADD(heap_allocations, 1);
+            }
+            block->link.owner = NULL;
+            block->size_class = NO_SIZE_CLASS;
+            result = block + 1;
+        }
+    }
+    else
+    {
+        MESSAGE_POOL_THREAD_CACHE* cache = get_thread_cache(generation);
+        block = cache->free_blocks[size_class];
+        if (block != NULL)
+        {
+            /*Codes_SRS_MESSAGE_POOL_13_012: [Otherwise, MessagePool_Allocate shall take a block of the smallest size class that fits size from the free list of the calling thread, then from the central free list, then from the heap.]*/
+            cache->free_blocks[size_class] = block->link.next;
+            cache->free_block_count[size_class]--;
+        }
+        else if ((block = allocate_from_central(cache, size_class)) == NULL)
+        {
+            block = (MESSAGE_POOL_BLOCK*)malloc(get_size_class_bytes(size_class));
+            if (block != NULL)
+            {
+                MESSAGE_POOL_COUNTER_ADD(heap_allocations, 1);
+            }
+        }
+
+        if (block == NULL)
+        {
+            /*Codes_SRS_MESSAGE_POOL_13_013: [If allocating the block fails, MessagePool_Allocate shall return NULL.]*/
+            LogError("malloc failed");
+            result = NULL;
+        }
+        else
+        {
+            block->link.owner = cache;
+            block->size_class = size_class;
+            result = block + 1;
+        }
+    }
+    return result;
+}
+
+void MessagePool_Free(void* ptr)
+{
+    if (ptr == NULL)
+    {
+        /*Codes_SRS_MESSAGE_POOL_13_014: [If block is NULL then MessagePool_Free shall do nothing.]*/
+    }
+    else
+    {
+        MESSAGE_POOL_BLOCK* block = (MESSAGE_POOL_BLOCK*)ptr - 1;
+        long generation = MESSAGE_POOL_FLAG_GET(pool_generation);
+        if ((block->size_class == NO_SIZE_CLASS) || (generation == 0))
+        {
+            if ((generation == 0) && (thread_cache.generation != 0))
+            {
+                release_thread_cache(0);
+            }
+            /*Codes_SRS_MESSAGE_POOL_13_015: [If the pool is disabled or the block came from the heap, MessagePool_Free shall free it to the heap.]*/
+            free_to_heap(block, generation);
+        }
+        else
+        {
+            MESSAGE_POOL_THREAD_CACHE* cache = get_thread_cache(generation);
+            if ((block->link.owner == cache) && (cache->free_block_count[block->size_class] < pool_config.thread_cache_blocks))
+            {
+                /*Codes_SRS_MESSAGE_POOL_13_016: [If the block was allocated by the calling thread and its free list is not full, MessagePool_Free shall add the block to that free list.]*/
+                block->link.next = cache->free_blocks[block->size_class];
+                cache->free_blocks[block->size_class] = block;
+                cache->free_block_count[block->size_class]++;
+            }
+            else
+            {
+                /*Codes_SRS_MESSAGE_POOL_13_017: [Otherwise, MessagePool_Free shall add the block to the central free list of its size class, or free it to the heap when that list is full.]*/
+                free_to_central(block);
+            }
+        }
+    }
+}
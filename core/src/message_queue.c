@@ -0,0 +1,258 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include "azure_c_shared_utility/gballoc.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "azure_c_shared_utility/iot_logging.h"
+
+#include "message.h"
+#include "message_queue.h"
+
+#define MESSAGE_QUEUE_DEFAULT_CAPACITY 16
+
+typedef struct MESSAGE_QUEUE_HANDLE_DATA_TAG
+{
+    /**
+    * Circular buffer of messages. The capacity is always a power of 2 so
+    * that positions can be wrapped with a mask instead of a division.
+    */
+    MESSAGE_HANDLE*         buffer;
+
+    /**
+    * Number of slots in 'buffer'.
+    */
+    size_t                  capacity;
+
+    /**
+    * Maximum number of messages the queue will hold (0 means unbounded).
+    */
+    size_t                  max_capacity;
+
+    /**
+    * Index of the oldest message in the queue.
+    */
+    size_t                  head;
+
+    /**
+    * Number of messages currently in the queue.
+    */
+    size_t                  count;
+}MESSAGE_QUEUE_HANDLE_DATA;
+
+/*returns 0 when the rounded value does not fit in a size_t*/
+static size_t round_up_to_power_of_2(size_t value)
+{
+    size_t result = 1;
+    while ((result != 0) && (result < value))
+    {
+        result <<= 1;
+    }
+    return result;
+}
+
+/*grows the buffer by doubling it; the messages are laid out again starting at index 0*/
+static int grow_queue(MESSAGE_QUEUE_HANDLE_DATA* queue)
+{
+    int result;
+    size_t new_capacity = queue->capacity * 2;
+    if ((new_capacity < queue->capacity) || (new_capacity > (SIZE_MAX / sizeof(MESSAGE_HANDLE))))
+    {
+        LogError("message queue capacity overflow");
+        result = __LINE__;
+    }
+    else
+    {
+        MESSAGE_HANDLE* new_buffer = (MESSAGE_HANDLE*)malloc(new_capacity * sizeof(MESSAGE_HANDLE));
+        if (new_buffer == NULL)
+        {
+            LogError("malloc failed");
+            result = __LINE__;
+        }
+        else
+        {
+            size_t i;
+            for (i = 0; i < queue->count; i++)
+            {
+                new_buffer[i] = queue->buffer[(queue->head + i) & (queue->capacity - 1)];
+            }
+            free(queue->buffer);
+            queue->buffer = new_buffer;
+            queue->capacity = new_capacity;
+            queue->head = 0;
+            result = 0;
+        }
+    }
+    return result;
+}
+
+MESSAGE_QUEUE_HANDLE MessageQueue_Create(size_t initial_capacity, size_t max_capacity)
+{
+    MESSAGE_QUEUE_HANDLE_DATA* result;
+
+    /*Codes_SRS_MESSAGE_QUEUE_13_001: [MessageQueue_Create shall allocate a new MESSAGE_QUEUE_HANDLE_DATA and return NULL if it fails.]*/
+    result = (MESSAGE_QUEUE_HANDLE_DATA*)malloc(sizeof(MESSAGE_QUEUE_HANDLE_DATA));
+    if (result == NULL)
+    {
+        LogError("malloc failed");
+        /*return as is*/
+    }
+    else
+    {
+        /*Codes_SRS_MESSAGE_QUEUE_13_002: [If initial_capacity is 0, MessageQueue_Create shall use a default capacity of 16.]*/
+        size_t capacity = (initial_capacity == 0) ? MESSAGE_QUEUE_DEFAULT_CAPACITY : initial_capacity;
+
+        /*Codes_SRS_MESSAGE_QUEUE_13_003: [If max_capacity is not 0 and is smaller than the initial capacity, the initial capacity shall be max_capacity.]*/
+        if ((max_capacity != 0) && (capacity > max_capacity))
+        {
+            capacity = max_capacity;
+        }
+
+        /*Codes_SRS_MESSAGE_QUEUE_13_004: [MessageQueue_Create shall round the capacity up to the next power of 2 and allocate the circular buffer.]*/
+        result->capacity = round_up_to_power_of_2(capacity);
+        if ((result->capacity == 0) || (result->capacity > (SIZE_MAX / sizeof(MESSAGE_HANDLE))))
+        {
+            result->buffer = NULL;
+        }
+        else
+        {
+            result->buffer = (MESSAGE_HANDLE*)malloc(result->capacity * sizeof(MESSAGE_HANDLE));
+        }
+
+        if (result->buffer == NULL)
+        {
+            /*Codes_SRS_MESSAGE_QUEUE_13_005: [If allocating the circular buffer fails, MessageQueue_Create shall free all resources and return NULL.]*/
+            LogError("malloc failed");
+            free(result);
+            result = NULL;
+        }
+        else
+        {
+            result->max_capacity = max_capacity;
+            result->head = 0;
+            result->count = 0;
+        }
+    }
+
+    return result;
+}
+
+void MessageQueue_Destroy(MESSAGE_QUEUE_HANDLE handle)
+{
+    /*Codes_SRS_MESSAGE_QUEUE_13_006: [If handle is NULL, MessageQueue_Destroy shall do nothing.]*/
+    if (handle == NULL)
+    {
+        LogError("invalid arg: handle is NULL");
+    }
+    else
+    {
+        /*Codes_SRS_MESSAGE_QUEUE_13_007: [MessageQueue_Destroy shall call Message_Destroy on every message still in the queue.]*/
+        MESSAGE_HANDLE message;
+        while ((message = MessageQueue_Pop(handle)) != NULL)
+        {
+            Message_Destroy(message);
+        }
+
+        /*Codes_SRS_MESSAGE_QUEUE_13_008: [MessageQueue_Destroy shall free the circular buffer and the queue.]*/
+        free(handle->buffer);
+        free(handle);
+    }
+}
+
+MESSAGE_QUEUE_RESULT MessageQueue_Push(MESSAGE_QUEUE_HANDLE handle, MESSAGE_HANDLE message)
+{
+    MESSAGE_QUEUE_RESULT result;
+
+    /*Codes_SRS_MESSAGE_QUEUE_13_009: [If handle or message is NULL, MessageQueue_Push shall return MESSAGE_QUEUE_INVALIDARG.]*/
+    if (handle == NULL || message == NULL)
+    {
+        LogError("invalid arg: handle=%p, message=%p", handle, message);
+        result = MESSAGE_QUEUE_INVALIDARG;
+    }
+    /*Codes_SRS_MESSAGE_QUEUE_13_010: [If the queue holds max_capacity messages, MessageQueue_Push shall return MESSAGE_QUEUE_FULL.]*/
+    else if ((handle->max_capacity != 0) && (handle->count >= handle->max_capacity))
+    {
+        result = MESSAGE_QUEUE_FULL;
+    }
+    /*Codes_SRS_MESSAGE_QUEUE_13_011: [If the circular buffer is full, MessageQueue_Push shall double its size.]*/
+    /*Codes_SRS_MESSAGE_QUEUE_13_012: [If growing the circular buffer fails, MessageQueue_Push shall return MESSAGE_QUEUE_ERROR.]*/
+    else if ((handle->count == handle->capacity) && (grow_queue(handle) != 0))
+    {
+        LogError("unable to grow the message queue");
+        result = MESSAGE_QUEUE_ERROR;
+    }
+    else
+    {
+        /*Codes_SRS_MESSAGE_QUEUE_13_013: [MessageQueue_Push shall store message at the back of the queue and return MESSAGE_QUEUE_OK.]*/
+        handle->buffer[(handle->head + handle->count) & (handle->capacity - 1)] = message;
+        handle->count++;
+        result = MESSAGE_QUEUE_OK;
+    }
+
+    return result;
+}
+
+MESSAGE_HANDLE MessageQueue_Pop(MESSAGE_QUEUE_HANDLE handle)
+{
+    MESSAGE_HANDLE result;
+
+    /*Codes_SRS_MESSAGE_QUEUE_13_014: [If handle is NULL or the queue is empty, MessageQueue_Pop shall return NULL.]*/
+    if (handle == NULL || handle->count == 0)
+    {
+        result = NULL;
+    }
+    else
+    {
+        /*Codes_SRS_MESSAGE_QUEUE_13_015: [MessageQueue_Pop shall remove and return the message at the front of the queue.]*/
+        result = handle->buffer[handle->head];
+        handle->head = (handle->head + 1) & (handle->capacity - 1);
+        handle->count--;
+    }
+
+    return result;
+}
+
+size_t MessageQueue_PopBatch(MESSAGE_QUEUE_HANDLE handle, MESSAGE_HANDLE* messages, size_t max_count)
+{
+    size_t result;
+
+    /*Codes_SRS_MESSAGE_QUEUE_13_018: [If handle or messages is NULL, MessageQueue_PopBatch shall return 0.]*/
+    if (handle == NULL || messages == NULL)
+    {
+        LogError("invalid arg: handle=%p, messages=%p", handle, messages);
+        result = 0;
+    }
+    else
+    {
+        /*Codes_SRS_MESSAGE_QUEUE_13_019: [MessageQueue_PopBatch shall remove the oldest messages of the queue, up to max_count of them, store them in messages in order and return how many it removed.]*/
+        size_t i;
+        result = (handle->count < max_count) ? handle->count : max_count;
+        for (i = 0; i < result; i++)
+        {
+            messages[i] = handle->buffer[(handle->head + i) & (handle->capacity - 1)];
+        }
+        handle->head = (handle->head + result) & (handle->capacity - 1);
+        handle->count -= result;
+    }
+
+    return result;
+}
+
+size_t MessageQueue_Size(MESSAGE_QUEUE_HANDLE handle)
+{
+    /*Codes_SRS_MESSAGE_QUEUE_13_016: [MessageQueue_Size shall return the number of messages in the queue, or 0 if handle is NULL.]*/
+    return (handle == NULL) ? 0 : handle->count;
+}
+
+bool MessageQueue_IsEmpty(MESSAGE_QUEUE_HANDLE handle)
+{
+    /*Codes_SRS_MESSAGE_QUEUE_13_017: [MessageQueue_IsEmpty shall return true if handle is NULL or the queue holds no messages, false otherwise.]*/
+    return (handle == NULL) || (handle->count == 0);
+}
@@ -1,90 +1,197 @@
 // Copyright (c) Microsoft. All rights reserved.
 // Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/*realpath is not declared in strict C99 mode*/
+#if !defined(WIN32) && !defined(_XOPEN_SOURCE)
+#define _XOPEN_SOURCE 500
+#endif
+
 #include <stdlib.h>
 #ifdef _CRTDBG_MAP_ALLOC
 #include <crtdbg.h>
 #endif
 #include "azure_c_shared_utility/gballoc.h"
+#include <stdbool.h>
 #include <string.h>
 
 #include "azure_c_shared_utility/iot_logging.h"
+#include "azure_c_shared_utility/lock.h"
 
 #include "module_loader.h"
 #include "dynamic_library.h"
 
+/*atomic operations on the pointer to the lock of the library cache, and how paths are made canonical*/
+#if defined(WIN32)
+#include <windows.h>
+#define MODULE_LOADER_POINTER_GET(pointer) InterlockedCompareExchangePointer((PVOID volatile*)&(pointer), NULL, NULL)
+#define MODULE_LOADER_POINTER_SET_IF_NULL(pointer, value) (InterlockedCompareExchangePointer((PVOID volatile*)&(pointer), (value), NULL) == NULL)
+#define MODULE_LOADER_PATH_MAX MAX_PATH
+#elif defined(__GNUC__)
+#include <limits.h>
+#define MODULE_LOADER_POINTER_GET(pointer) __atomic_load_n(&(pointer), __ATOMIC_SEQ_CST)
+#define MODULE_LOADER_POINTER_SET_IF_NULL(pointer, value) __sync_bool_compare_and_swap(&(pointer), NULL, (value))
+#define MODULE_LOADER_PATH_MAX PATH_MAX
+#else
+#error "the module library cache needs atomic operations on this platform"
+#endif
+
+/*
+* A loaded library, shared by every ModuleLoader_Load of the same path until
+* as many ModuleLoader_Unload have been made.
+*/
 typedef struct MODULE_LIBRARY_HANDLE_DATA_TAG
 {
+    struct MODULE_LIBRARY_HANDLE_DATA_TAG* next;
     void* library;
     const MODULE_APIS* apis;
+    /*NULL if the library does not export MODULE_GETRECEIVEBATCH_NAME*/
+    pfModule_ReceiveBatch receive_batch;
+    /*guarded by library_cache_lock*/
+    size_t count;
+    /*the moduleLibraryFileName the library was first loaded with, stored after path*/
+    const char* name;
+    /*the canonical path of the library*/
+    char path[1];
 }MODULE_LIBRARY_HANDLE_DATA;
 
+/*the loaded libraries, guarded by library_cache_lock; the lock is never held while a library is loaded or unloaded*/
+static MODULE_LIBRARY_HANDLE_DATA* library_cache;
+/*
+* Created by the first ModuleLoader_Load and never destroyed: the module
+* loader has no global initialization to create it in.
+*/
+static LOCK_HANDLE library_cache_lock;
 
+static LOCK_HANDLE get_library_cache_lock(void);
+static bool is_relative_library_name(const char* moduleLibraryFileName);
+static const char* get_library_key(const char* moduleLibraryFileName, char* buffer);
+static MODULE_LIBRARY_HANDLE_DATA* library_cache_find(const char* key, bool match_name);
+static int library_cache_acquire(const char* key, bool match_name, MODULE_LIBRARY_HANDLE_DATA** library_data);
+static MODULE_LIBRARY_HANDLE_DATA* library_cache_add(MODULE_LIBRARY_HANDLE_DATA* library_data);
 
 MODULE_LIBRARY_HANDLE ModuleLoader_Load(const char* moduleLibraryFileName)
 {
-  MODULE_LIBRARY_HANDLE_DATA* result;
-
-  // moduleLibraryFileName cannot be null/empty
-  if (moduleLibraryFileName == NULL)
-  {
-	  /*Codes_SRS_MODULE_LOADER_17_001: [ModuleLoader_Load shall validate the moduleLibraryFileName, if it is NULL, it will return NULL.]*/
-      result = NULL;
-      LogError("ModuleLoader_Load() - moduleLibraryFileName is NULL");
-  }
-  else
-  {
-	  /* Codes_SRS_MODULE_LOADER_17_005: [ModuleLoader_Load shall allocate memory for the structure MODULE_LIBRARY_HANDLE.] */
-	  result = (MODULE_LIBRARY_HANDLE_DATA*)malloc(sizeof(MODULE_LIBRARY_HANDLE_DATA));
-	  if (result == NULL)
-	  {
-		  /*Codes_SRS_MODULE_LOADER_17_014: [If memory allocation is not successful, the load shall fail, and it shall return NULL.]*/
-		  LogError("ModuleLoader_Load() - malloc(sizeof(MODULE_LIBRARY_HANDLE_DATA)) failed");
-	  }
-	  else
-	  {
-		  /* load the DLL */
-		  /* Codes_SRS_MODULE_LOADER_17_002: [ModuleLoader_Load shall load the library as a file, the filename given by the moduleLibraryFileName.]*/
-		  result->library = DynamicLibrary_LoadLibrary(moduleLibraryFileName);
-		  if (result->library == NULL)
-		  {
-			  /* Codes_SRS_MODULE_LOADER_17_012: [If the attempt is not successful, the load shall fail, and it shall return NULL.]*/
-			  free(result);
-			  result = NULL;
-			  LogError("ModuleLoader_Load() - DynamicLibrary_LoadLibrary() returned NULL");
-		  }
-		  else
-		  {
-			  /* Codes_SRS_MODULE_LOADER_17_003: [ModuleLoader_Load shall locate the function defined by MODULE_GETAPIS_NAME in the open library.] */
-			  pfModule_GetAPIS pfnGetAPIS = (pfModule_GetAPIS)DynamicLibrary_FindSymbol(result->library, MODULE_GETAPIS_NAME);
-			  if (pfnGetAPIS == NULL)
-			  {
-				  /* Codes_SRS_MODULE_LOADER_17_013: [If locating the function is not successful, the load shall fail, and it shall return NULL.]*/
-				  DynamicLibrary_UnloadLibrary(result->library); 
-				  free(result);
-				  result = NULL;
-				  LogError("ModuleLoader_Load() - DynamicLibrary_FindSymbol() returned NULL");
-			  }
-			  else
-			  {
-				  /* Codes_SRS_MODULE_LOADER_17_004: [ModuleLoader_Load shall call the function defined by MODULE_GETAPIS_NAME in the open library.]*/
-				  result->apis = pfnGetAPIS();
-
-				  /* if "apis" is NULL then we have a misbehaving module */
-				  if (result->apis == NULL)
-				  {
-					  /* Codes_SRS_MODULE_LOADER_17_015: [If the get API call returns NULL, the load shall fail, and it shall return NULL.]*/
-					  DynamicLibrary_UnloadLibrary(result->library);
-					  free(result);
-					  result = NULL;
-					  LogError("ModuleLoader_Load() - pfnGetAPIS() returned NULL");
-				  }
-			  }
-		  }
-	  }
-  }
-
-  /*Codes_SRS_MODULE_LOADER_17_006: [ModuleLoader_Load shall return a non-NULL handle to a MODULE_LIBRARY_DATA_TAG upon success.]*/
-  return result;
+    MODULE_LIBRARY_HANDLE_DATA* result;
+
+    // moduleLibraryFileName cannot be null/empty
+    if (moduleLibraryFileName == NULL)
+    {
+        /*Codes_SRS_MODULE_LOADER_17_001: [ModuleLoader_Load shall validate the moduleLibraryFileName, if it is NULL, it will return NULL.]*/
+        result = NULL;
+        LogError("ModuleLoader_Load() - moduleLibraryFileName is NULL");
+    }
+    else if (get_library_cache_lock() == NULL)
+    {
+        /*Codes_SRS_MODULE_LOADER_13_008: [If the lock of the loaded libraries cannot be created or taken, ModuleLoader_Load shall fail and return NULL.]*/
+        result = NULL;
+        LogError("ModuleLoader_Load() - unable to create the lock of the loaded libraries");
+    }
+    else
+    {
+        char canonical_path[MODULE_LOADER_PATH_MAX];
+        const char* library_key = moduleLibraryFileName;
+        int acquired = 0;
+
+        /*Codes_SRS_MODULE_LOADER_13_001: [ModuleLoader_Load shall identify the library by the canonical path of moduleLibraryFileName if it is a relative path with a directory, by moduleLibraryFileName if it has no directory, and otherwise by moduleLibraryFileName if a loaded library was loaded with the same moduleLibraryFileName and by its canonical path if not.]*/
+        /*Codes_SRS_MODULE_LOADER_13_002: [If the library is already loaded, ModuleLoader_Load shall increment its reference count and return its handle without loading the library again.]*/
+        result = NULL;
+        if (!is_relative_library_name(moduleLibraryFileName))
+        {
+            acquired = library_cache_acquire(moduleLibraryFileName, true, &result);
+        }
+        if (acquired == 0 && result == NULL)
+        {
+            /*resolving the path takes longer than the lookup, and is only needed for the first instance of a library*/
+            library_key = get_library_key(moduleLibraryFileName, canonical_path);
+            if (library_key != moduleLibraryFileName)
+            {
+                acquired = library_cache_acquire(library_key, false, &result);
+            }
+        }
+
+        if (acquired != 0)
+        {
+            /*Codes_SRS_MODULE_LOADER_13_008: [If the lock of the loaded libraries cannot be created or taken, ModuleLoader_Load shall fail and return NULL.]*/
+            result = NULL;
+            LogError("ModuleLoader_Load() - unable to lock the loaded libraries");
+        }
+        else if (result == NULL)
+        {
+            /* Codes_SRS_MODULE_LOADER_17_005: [ModuleLoader_Load shall allocate memory for the structure MODULE_LIBRARY_HANDLE.] */
+            size_t key_length = strlen(library_key);
+            size_t name_length = strlen(moduleLibraryFileName);
+            result = (MODULE_LIBRARY_HANDLE_DATA*)malloc(sizeof(MODULE_LIBRARY_HANDLE_DATA) + key_length + name_length + 1);
+            if (result == NULL)
+            {
+                /*Codes_SRS_MODULE_LOADER_17_014: [If memory allocation is not successful, the load shall fail, and it shall return NULL.]*/
+                LogError("ModuleLoader_Load() - malloc(sizeof(MODULE_LIBRARY_HANDLE_DATA)) failed");
+            }
+            else
+            {
+                (void)memcpy(result->path, library_key, key_length + 1);
+                result->name = result->path + key_length + 1;
+                (void)memcpy((char*)result->name, moduleLibraryFileName, name_length + 1);
+
+                /* load the DLL */
+                /* Codes_SRS_MODULE_LOADER_17_002: [ModuleLoader_Load shall load the library as a file, the filename given by the moduleLibraryFileName.]*/
+                result->library = DynamicLibrary_LoadLibrary(moduleLibraryFileName);
+                if (result->library == NULL)
+                {
+                    /* Codes_SRS_MODULE_LOADER_17_012: [If the attempt is not successful, the load shall fail, and it shall return NULL.]*/
+                    free(result);
+                    result = NULL;
+                    LogError("ModuleLoader_Load() - DynamicLibrary_LoadLibrary() returned NULL");
+                }
+                else
+                {
+                    /* Codes_SRS_MODULE_LOADER_17_003: [ModuleLoader_Load shall locate the function defined by MODULE_GETAPIS_NAME in the open library.] */
+                    pfModule_GetAPIS pfnGetAPIS = (pfModule_GetAPIS)DynamicLibrary_FindSymbol(result->library, MODULE_GETAPIS_NAME);
+                    if (pfnGetAPIS == NULL)
+                    {
+                        /* Codes_SRS_MODULE_LOADER_17_013: [If locating the function is not successful, the load shall fail, and it shall return NULL.]*/
+                        DynamicLibrary_UnloadLibrary(result->library);
+                        free(result);
+                        result = NULL;
+                        LogError("ModuleLoader_Load() - DynamicLibrary_FindSymbol() returned NULL");
+                    }
+                    else
+                    {
+                        /* Codes_SRS_MODULE_LOADER_17_004: [ModuleLoader_Load shall call the function defined by MODULE_GETAPIS_NAME in the open library.]*/
+                        result->apis = pfnGetAPIS();
+
+                        /* if "apis" is NULL then we have a misbehaving module */
+                        if (result->apis == NULL)
+                        {
+                            /* Codes_SRS_MODULE_LOADER_17_015: [If the get API call returns NULL, the load shall fail, and it shall return NULL.]*/
+                            DynamicLibrary_UnloadLibrary(result->library);
+                            free(result);
+                            result = NULL;
+                            LogError("ModuleLoader_Load() - pfnGetAPIS() returned NULL");
+                        }
+                        else
+                        {
+                            /*Codes_SRS_MODULE_LOADER_13_005: [ModuleLoader_Load shall locate the function defined by MODULE_GETRECEIVEBATCH_NAME in the open library and, if it is present, call it to get the Module_ReceiveBatch of the library.]*/
+                            pfModule_GetReceiveBatch pfnGetReceiveBatch = (pfModule_GetReceiveBatch)DynamicLibrary_FindSymbol(result->library, MODULE_GETRECEIVEBATCH_NAME);
+                            result->receive_batch = (pfnGetReceiveBatch == NULL) ? NULL : pfnGetReceiveBatch();
+
+                            /*Codes_SRS_MODULE_LOADER_13_003: [ModuleLoader_Load shall add the library to the loaded libraries with a reference count of 1, unless another thread loaded it meanwhile, in which case it shall unload its own copy and return the handle of the other thread as in SRS_MODULE_LOADER_13_002.]*/
+                            /*Codes_SRS_MODULE_LOADER_13_008: [If the lock of the loaded libraries cannot be created or taken, ModuleLoader_Load shall fail and return NULL.]*/
+                            MODULE_LIBRARY_HANDLE_DATA* loaded = library_cache_add(result);
+                            if (loaded != result)
+                            {
+                                DynamicLibrary_UnloadLibrary(result->library);
+                                free(result);
+                                result = loaded;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /*Codes_SRS_MODULE_LOADER_17_006: [ModuleLoader_Load shall return a non-NULL handle to a MODULE_LIBRARY_DATA_TAG upon success.]*/
+    return result;
 }
 
 const MODULE_APIS* ModuleLoader_GetModuleAPIs(MODULE_LIBRARY_HANDLE moduleLibraryHandle)
@@ -107,8 +214,29 @@ const MODULE_APIS* ModuleLoader_GetModuleAPIs(MODULE_LIBRARY_HANDLE moduleLibrar
     return result;
 }
 
+pfModule_ReceiveBatch ModuleLoader_GetModuleReceiveBatch(MODULE_LIBRARY_HANDLE moduleLibraryHandle)
+{
+    pfModule_ReceiveBatch result;
+
+    if (moduleLibraryHandle == NULL)
+    {
+        /*Codes_SRS_MODULE_LOADER_13_006: [ModuleLoader_GetModuleReceiveBatch shall return NULL if the moduleLibraryHandle is NULL.]*/
+        result = NULL;
+        LogError("ModuleLoader_GetModuleReceiveBatch() - moduleLibraryHandle is NULL");
+    }
+    else
+    {
+        /*Codes_SRS_MODULE_LOADER_13_007: [ModuleLoader_GetModuleReceiveBatch shall return the Module_ReceiveBatch of the library, or NULL if it does not export MODULE_GETRECEIVEBATCH_NAME.]*/
+        MODULE_LIBRARY_HANDLE_DATA* loader_data = moduleLibraryHandle;
+        result = loader_data->receive_batch;
+    }
+
+    return result;
+}
+
 
 /*Codes_SRS_MODULE_LOADER_17_009: [ModuleLoader_Unload shall do nothing if the moduleLibraryHandle is NULL.]*/
+/*Codes_SRS_MODULE_LOADER_13_004: [ModuleLoader_Unload shall decrement the reference count of the library, and shall do nothing else unless it reaches 0.]*/
 /*Codes_SRS_MODULE_LOADER_17_010: [ModuleLoader_Unload shall attempt to unload the library.]*/
 /*Codes_SRS_MODULE_LOADER_17_011: [ModuleLoader_UnLoad shall deallocate memory for the structure MODULE_LIBRARY_HANDLE.]*/
 
@@ -117,11 +245,172 @@ void ModuleLoader_Unload(MODULE_LIBRARY_HANDLE moduleLibraryHandle)
     if (moduleLibraryHandle != NULL)
     {
         MODULE_LIBRARY_HANDLE_DATA* loader_data = moduleLibraryHandle;
-		    DynamicLibrary_UnloadLibrary(loader_data->library);
-        free(loader_data);
+        bool last = false;
+
+        /*the lock exists, it was created before moduleLibraryHandle was loaded*/
+        if (Lock(library_cache_lock) != LOCK_OK)
+        {
+            /*the library stays loaded: the cache cannot be changed without the lock*/
+            LogError("ModuleLoader_Unload() - unable to lock the loaded libraries");
+        }
+        else
+        {
+            last = (--loader_data->count == 0);
+            if (last)
+            {
+                MODULE_LIBRARY_HANDLE_DATA** link = &library_cache;
+                while (*link != loader_data)
+                {
+                    link = &(*link)->next;
+                }
+                *link = loader_data->next;
+            }
+            (void)Unlock(library_cache_lock);
+        }
+
+        if (last)
+        {
+            DynamicLibrary_UnloadLibrary(loader_data->library);
+            free(loader_data);
+        }
     }
     else
     {
       LogError("ModuleLoader_Unload() - moduleLibraryHandle is NULL");
     }
 }
+
+static LOCK_HANDLE get_library_cache_lock(void)
+{
+    LOCK_HANDLE result = (LOCK_HANDLE)MODULE_LOADER_POINTER_GET(library_cache_lock);
+    if (result == NULL)
+    {
+        LOCK_HANDLE lock = Lock_Init();
+        if (lock == NULL)
+        {
+            LogError("Lock_Init failed");
+        }
+        else if (MODULE_LOADER_POINTER_SET_IF_NULL(library_cache_lock, lock))
+        {
+            result = lock;
+        }
+        else
+        {
+            /*another thread created the lock meanwhile*/
+            (void)Lock_Deinit(lock);
+            result = (LOCK_HANDLE)MODULE_LOADER_POINTER_GET(library_cache_lock);
+        }
+    }
+    return result;
+}
+
+/*
+* A relative name with a directory names a different library in another
+* working directory, so it is only ever matched by its canonical path.
+*/
+static bool is_relative_library_name(const char* moduleLibraryFileName)
+{
+#if defined(WIN32)
+    bool has_drive = (moduleLibraryFileName[0] != '\0' && moduleLibraryFileName[1] == ':' && (moduleLibraryFileName[2] == '\\' || moduleLibraryFileName[2] == '/'));
+    bool is_unc = (moduleLibraryFileName[0] == '\\' && moduleLibraryFileName[1] == '\\');
+    return strpbrk(moduleLibraryFileName, "\\/:") != NULL && !has_drive && !is_unc;
+#else
+    return moduleLibraryFileName[0] != '/' && strchr(moduleLibraryFileName, '/') != NULL;
+#endif
+}
+
+/*
+* The loader looks libraries without a directory up in the search path, so
+* only the names that contain one are resolved; buffer holds
+* MODULE_LOADER_PATH_MAX characters. The name is kept as it is if it cannot
+* be resolved, in which case loading the library fails anyway.
+*/
+static const char* get_library_key(const char* moduleLibraryFileName, char* buffer)
+{
+    const char* result = moduleLibraryFileName;
+#if defined(WIN32)
+    if (strpbrk(moduleLibraryFileName, "\\/:") != NULL)
+    {
+        DWORD length = GetFullPathNameA(moduleLibraryFileName, MODULE_LOADER_PATH_MAX, buffer, NULL);
+        if (length > 0 && length < MODULE_LOADER_PATH_MAX)
+        {
+            result = buffer;
+        }
+    }
+#else
+    if (strchr(moduleLibraryFileName, '/') != NULL && realpath(moduleLibraryFileName, buffer) != NULL)
+    {
+        result = buffer;
+    }
+#endif
+    return result;
+}
+
+/*
+* Called with library_cache_lock held. Libraries are matched by the name they
+* were first loaded with only if match_name is true, which ModuleLoader_Load
+* never asks for a relative name.
+*/
+static MODULE_LIBRARY_HANDLE_DATA* library_cache_find(const char* key, bool match_name)
+{
+    MODULE_LIBRARY_HANDLE_DATA* result = library_cache;
+    while (result != NULL && strcmp(result->path, key) != 0 && !(match_name && strcmp(result->name, key) == 0))
+    {
+        result = result->next;
+    }
+    return result;
+}
+
+/*library_data is set to the library, or to NULL if it is not loaded; returns 0 unless the cache cannot be locked*/
+static int library_cache_acquire(const char* key, bool match_name, MODULE_LIBRARY_HANDLE_DATA** library_data)
+{
+    int result;
+
+    if (Lock(library_cache_lock) != LOCK_OK)
+    {
+        *library_data = NULL;
+        result = __LINE__;
+    }
+    else
+    {
+        *library_data = library_cache_find(key, match_name);
+        if (*library_data != NULL)
+        {
+            (*library_data)->count++;
+        }
+        (void)Unlock(library_cache_lock);
+        result = 0;
+    }
+
+    return result;
+}
+
+/*adds library_data to the cache and returns it, or returns the library of the same path another thread added meanwhile, or NULL if the cache cannot be locked*/
+static MODULE_LIBRARY_HANDLE_DATA* library_cache_add(MODULE_LIBRARY_HANDLE_DATA* library_data)
+{
+    MODULE_LIBRARY_HANDLE_DATA* result;
+
+    if (Lock(library_cache_lock) != LOCK_OK)
+    {
+        result = NULL;
+        LogError("ModuleLoader_Load() - unable to lock the loaded libraries");
+    }
+    else
+    {
+        result = library_cache_find(library_data->path, false);
+        if (result != NULL)
+        {
+            result->count++;
+        }
+        else
+        {
+            library_data->count = 1;
+            library_data->next = library_cache;
+            library_cache = library_data;
+            result = library_data;
+        }
+        (void)Unlock(library_cache_lock);
+    }
+
+    return result;
+}
@@ -0,0 +1,321 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include "azure_c_shared_utility/gballoc.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "azure_c_shared_utility/iot_logging.h"
+#include "azure_c_shared_utility/lock.h"
+
+#include "string_intern.h"
+
+/*atomic operations on the table pointer*/
+#if defined(WIN32)
+#include <windows.h>
+#define STRING_INTERN_POINTER_GET(pointer) InterlockedCompareExchangePointer((PVOID volatile*)&(pointer), NULL, NULL)
+#define STRING_INTERN_POINTER_SET_IF_NULL(pointer, value) (InterlockedCompareExchangePointer((PVOID volatile*)&(pointer), (value), NULL) == NULL)
+#elif defined(__GNUC__)
+#define STRING_INTERN_POINTER_GET(pointer) __atomic_load_n(&(pointer), __ATOMIC_SEQ_CST)
+#define STRING_INTERN_POINTER_SET_IF_NULL(pointer, value) __sync_bool_compare_and_swap(&(pointer), NULL, (value))
+#else
+#error "the string intern table needs atomic operations on this platform"
+#endif
+
+/*the table is split in shards, each with its own lock, so that threads interning different strings rarely wait for each other*/
+#define SHARD_COUNT 16
+#define INITIAL_BUCKET_COUNT 16
+
+struct STRING_INTERN_SHARD_TAG;
+
+/*an interned string: StringIntern_Acquire returns the characters that follow the header*/
+typedef struct STRING_INTERN_ENTRY_TAG
+{
+    struct STRING_INTERN_ENTRY_TAG* next;
+    struct STRING_INTERN_SHARD_TAG* shard;
+    size_t hash;
+    size_t count;
+    char string[1];
+}STRING_INTERN_ENTRY;
+
+typedef struct STRING_INTERN_SHARD_TAG
+{
+    /*guards everything below, and the count of the entries of the shard*/
+    LOCK_HANDLE lock;
+    STRING_INTERN_ENTRY** buckets;
+    size_t bucket_count;
+    size_t entry_count;
+}STRING_INTERN_SHARD;
+
+typedef struct STRING_INTERN_TABLE_TAG
+{
+    STRING_INTERN_SHARD shards[SHARD_COUNT];
+}STRING_INTERN_TABLE;
+
+/*
+* Allocated by the first StringIntern_Acquire and never freed: interned
+* strings point at their shard, and may be released after the copy of the
+* library holding this pointer is unloaded.
+*/
+static STRING_INTERN_TABLE* intern_table;
+
+/*FNV-1a, also measures the string*/
+static size_t hash_string(const char* string, size_t* length)
+{
+    uint32_t hash = 2166136261u;
+    const unsigned char* current = (const unsigned char*)string;
+    while (*current != '\0')
+    {
+        hash = (hash ^ *current) * 16777619u;
+        current++;
+    }
+    *length = (size_t)(current - (const unsigned char*)string);
+    return (size_t)hash;
+}
+
+/*the low bits of the hash pick the shard, the next ones the bucket*/
+static size_t get_bucket(const STRING_INTERN_SHARD* shard, size_t hash)
+{
+    return (hash / SHARD_COUNT) & (shard->bucket_count - 1);
+}
+
+static void destroy_table(STRING_INTERN_TABLE* table, size_t shard_count)
+{
+    size_t i;
+    for (i = 0; i < shard_count; i++)
+    {
+        (void)Lock_Deinit(table->shards[i].lock);
+    }
+    free(table);
+}
+
+static STRING_INTERN_TABLE* create_table(void)
+{
+    STRING_INTERN_TABLE* result = (STRING_INTERN_TABLE*)calloc(1, sizeof(STRING_INTERN_TABLE));
+    if (result == NULL)
+    {
+        LogError("unable to allocate the string intern table");
+    }
+    else
+    {
+        size_t i;
+        for (i = 0; i < SHARD_COUNT; i++)
+        {
+            if ((result->shards[i].lock = Lock_Init()) == NULL)
+            {
+                LogError("unable to create the lock of a shard of the string intern table");
+                break;
+            }
+        }
+
+        if (i != SHARD_COUNT)
+        {
+            destroy_table(result, i);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+static STRING_INTERN_TABLE* get_table(void)
+{
+    STRING_INTERN_TABLE* result = (STRING_INTERN_TABLE*)STRING_INTERN_POINTER_GET(intern_table);
+    if (result == NULL)
+    {
+        STRING_INTERN_TABLE* table = create_table();
+        if (table == NULL)
+        {
+            /*create_table logged the error*/
+        }
+        else if (STRING_INTERN_POINTER_SET_IF_NULL(intern_table, table))
+        {
+            result = table;
+        }
+        else
+        {
+            /*another thread got there first, use its table*/
+            destroy_table(table, SHARD_COUNT);
+            result = (STRING_INTERN_TABLE*)STRING_INTERN_POINTER_GET(intern_table);
+        }
+    }
+    return result;
+}
+
+/*doubles the buckets of a shard whose chains got long; called with the shard locked. The shard keeps working with long chains if this fails*/
+static void grow_shard(STRING_INTERN_SHARD* shard)
+{
+    size_t new_bucket_count = (shard->bucket_count == 0) ? INITIAL_BUCKET_COUNT : shard->bucket_count * 2;
+    STRING_INTERN_ENTRY** new_buckets = (STRING_INTERN_ENTRY**)calloc(new_bucket_count, sizeof(STRING_INTERN_ENTRY*));
+    if (new_buckets == NULL)
+    {
+        LogError("unable to grow the string intern table to %zu buckets", new_bucket_count);
+    }
+    else
+    {
+        STRING_INTERN_ENTRY** old_buckets = shard->buckets;
+        size_t old_bucket_count = shard->bucket_count;
+        size_t i;
+
+        shard->buckets = new_buckets;
+        shard->bucket_count = new_bucket_count;
+        for (i = 0; i < old_bucket_count; i++)
+        {
+            STRING_INTERN_ENTRY* entry = old_buckets[i];
+            while (entry != NULL)
+            {
+                STRING_INTERN_ENTRY* next = entry->next;
+                size_t bucket = get_bucket(shard, entry->hash);
+                entry->next = new_buckets[bucket];
+                new_buckets[bucket] = entry;
+                entry = next;
+            }
+        }
+        free(old_buckets);
+    }
+}
+
+const char* StringIntern_Acquire(const char* string)
+{
+    const char* result;
+    STRING_INTERN_TABLE* table;
+    if (string == NULL)
+    {
+        /*Codes_SRS_STRING_INTERN_13_001: [If string is NULL then StringIntern_Acquire shall fail and return NULL.]*/
+        LogError("invalid arg: string is NULL");
+        result = NULL;
+    }
+    /*Codes_SRS_STRING_INTERN_13_002: [StringIntern_Acquire shall allocate the table the first time it is called, and fail and return NULL if that fails.]*/
+    else if ((table = get_table()) == NULL)
+    {
+        result = NULL;
+    }
+    else
+    {
+        size_t length;
+        size_t hash = hash_string(string, &length);
+        STRING_INTERN_SHARD* shard = &table->shards[hash % SHARD_COUNT];
+
+        /*Codes_SRS_STRING_INTERN_13_011: [StringIntern_Acquire shall lock the shard of the table that holds string, and fail and return NULL if that fails.]*/
+        if (Lock(shard->lock) != LOCK_OK)
+        {
+            LogError("unable to lock a shard of the string intern table");
+            result = NULL;
+        }
+        else
+        {
+            STRING_INTERN_ENTRY* entry = NULL;
+            if (shard->bucket_count > 0)
+            {
+                entry = shard->buckets[get_bucket(shard, hash)];
+                while ((entry != NULL) && ((entry->hash != hash) || (strcmp(entry->string, string) != 0)))
+                {
+                    entry = entry->next;
+                }
+            }
+
+            if (entry != NULL)
+            {
+                /*Codes_SRS_STRING_INTERN_13_003: [If the table holds a string equal to string, StringIntern_Acquire shall take a reference on it and return it.]*/
+                entry->count++;
+                result = entry->string;
+            }
+            else
+            {
+                if (shard->entry_count >= shard->bucket_count)
+                {
+                    grow_shard(shard);
+                }
+
+                if (shard->bucket_count == 0)
+                {
+                    /*Codes_SRS_STRING_INTERN_13_005: [If adding the string fails, StringIntern_Acquire shall return NULL.]*/
+                    result = NULL;
+                }
+                else if ((entry = (STRING_INTERN_ENTRY*)malloc(offsetof(STRING_INTERN_ENTRY, string) + length + 1)) == NULL)
+                {
+                    /*Codes_SRS_STRING_INTERN_13_005: [If adding the string fails, StringIntern_Acquire shall return NULL.]*/
+                    LogError("unable to intern a string of %zu characters", length);
+                    result = NULL;
+                }
+                else
+                {
+                    /*Codes_SRS_STRING_INTERN_13_004: [Otherwise, StringIntern_Acquire shall add a copy of string to the table with a single reference and return the copy.]*/
+                    size_t bucket = get_bucket(shard, hash);
+                    (void)memcpy(entry->string, string, length + 1);
+                    entry->shard = shard;
+                    entry->hash = hash;
+                    entry->count = 1;
+                    entry->next = shard->buckets[bucket];
+                    shard->buckets[bucket] = entry;
+                    shard->entry_count++;
+                    result = entry->string;
+                }
+            }
+
+            (void)Unlock(shard->lock);
+        }
+    }
+    return result;
+}
+
+void StringIntern_Release(const char* interned)
+{
+    /*Codes_SRS_STRING_INTERN_13_006: [If interned is NULL then StringIntern_Release shall do nothing.]*/
+    if (interned != NULL)
+    {
+        STRING_INTERN_ENTRY* entry = (STRING_INTERN_ENTRY*)(interned - offsetof(STRING_INTERN_ENTRY, string));
+        STRING_INTERN_SHARD* shard = entry->shard;
+
+        if (Lock(shard->lock) != LOCK_OK)
+        {
+            /*Codes_SRS_STRING_INTERN_13_012: [If StringIntern_Release cannot lock the shard of the table that holds interned, it shall keep the reference, and the string stays in the table.]*/
+            LogError("unable to lock a shard of the string intern table, the string is kept");
+        }
+        else
+        {
+            /*Codes_SRS_STRING_INTERN_13_007: [StringIntern_Release shall release a reference on interned.]*/
+            if (--entry->count == 0)
+            {
+                /*Codes_SRS_STRING_INTERN_13_008: [When the last reference is released, StringIntern_Release shall remove the string from the table and free it.]*/
+                STRING_INTERN_ENTRY** link = &shard->buckets[get_bucket(shard, entry->hash)];
+                while (*link != entry)
+                {
+                    link = &(*link)->next;
+                }
+                *link = entry->next;
+                shard->entry_count--;
+            }
+            else
+            {
+                entry = NULL;
+            }
+
+            (void)Unlock(shard->lock);
+
+            free(entry);
+        }
+    }
+}
+
+size_t StringIntern_Hash(const char* string)
+{
+    size_t result;
+    if (string == NULL)
+    {
+        /*Codes_SRS_STRING_INTERN_13_009: [If string is NULL then StringIntern_Hash shall return 0.]*/
+        result = 0;
+    }
+    else
+    {
+        /*Codes_SRS_STRING_INTERN_13_010: [Otherwise, StringIntern_Hash shall return the hash the table uses for string, which is the same for equal strings, interned or not.]*/
+        size_t length;
+        result = hash_string(string, &length);
+    }
+    return result;
+}
@@ -0,0 +1,715 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include "azure_c_shared_utility/gballoc.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "azure_c_shared_utility/iot_logging.h"
+
+#include "subscription_index.h"
+
+#define SUBSCRIPTION_INDEX_INITIAL_BUCKETS 16
+#define SUBSCRIPTION_INDEX_FREE_SLOT SIZE_MAX
+
+/*a (filter, condition) pair that is satisfied by the property value of the node holding it*/
+typedef struct SUBSCRIPTION_INDEX_ENTRY_TAG
+{
+    size_t                  slot;
+    size_t                  condition;
+}SUBSCRIPTION_INDEX_ENTRY;
+
+typedef struct SUBSCRIPTION_INDEX_NODE_TAG
+{
+    /**
+    * Property name and value of this node. Both strings live in the same
+    * allocation as the node.
+    */
+    const char*             property;
+    const char*             value;
+    size_t                  hash;
+
+    /**
+    * The conditions that accept this property value.
+    */
+    SUBSCRIPTION_INDEX_ENTRY* entries;
+    size_t                  entry_count;
+    size_t                  entry_capacity;
+
+    struct SUBSCRIPTION_INDEX_NODE_TAG* next;
+}SUBSCRIPTION_INDEX_NODE;
+
+typedef struct SUBSCRIPTION_INDEX_PROPERTY_TAG
+{
+    char*                   name;
+
+    /**
+    * Number of nodes with this property name.
+    */
+    size_t                  node_count;
+}SUBSCRIPTION_INDEX_PROPERTY;
+
+typedef struct SUBSCRIPTION_INDEX_HANDLE_DATA_TAG
+{
+    /**
+    * Hash table of nodes keyed on (property, value). The number of buckets
+    * is always a power of 2.
+    */
+    SUBSCRIPTION_INDEX_NODE** buckets;
+    size_t                  bucket_count;
+    size_t                  node_count;
+
+    /**
+    * The distinct property names used by the filters, these are the names
+    * looked up in the message properties when matching.
+    */
+    SUBSCRIPTION_INDEX_PROPERTY* properties;
+    size_t                  property_count;
+    size_t                  property_capacity;
+
+    /**
+    * Number of conditions of the filter at each slot, or
+    * SUBSCRIPTION_INDEX_FREE_SLOT for slots that are not in use.
+    */
+    size_t*                 condition_counts;
+    size_t                  slot_count;
+    size_t                  slot_capacity;
+}SUBSCRIPTION_INDEX_HANDLE_DATA;
+
+/*FNV-1a over the property name, a separator and the value*/
+static size_t hash_pair(const char* property, const char* value)
+{
+    uint32_t result = 2166136261u;
+    const unsigned char* c;
+    for (c = (const unsigned char*)property; *c != '\0'; c++)
+    {
+        result = (result ^ *c) * 16777619u;
+    }
+    result = (result ^ 0xFFu) * 16777619u;
+    for (c = (const unsigned char*)value; *c != '\0'; c++)
+    {
+        result = (result ^ *c) * 16777619u;
+    }
+    return (size_t)result;
+}
+
+/*grows an array of element_size elements so that it holds at least 'needed' elements; returns 0 on success*/
+static int ensure_capacity(void** array, size_t* capacity, size_t needed, size_t element_size)
+{
+    int result;
+    if (needed <= *capacity)
+    {
+        result = 0;
+    }
+    else
+    {
+        size_t new_capacity = (*capacity == 0) ? 4 : *capacity * 2;
+        void* new_array;
+        while (new_capacity < needed)
+        {
+            new_capacity *= 2;
+        }
+
+        new_array = realloc(*array, new_capacity * element_size);
+        if (new_array == NULL)
+        {
+            LogError("realloc failed");
+            result = __LINE__;
+        }
+        else
+        {
+            *array = new_array;
+            *capacity = new_capacity;
+            result = 0;
+        }
+    }
+    return result;
+}
+
+static SUBSCRIPTION_INDEX_NODE* find_node(SUBSCRIPTION_INDEX_HANDLE_DATA* index, const char* property, const char* value, size_t hash)
+{
+    SUBSCRIPTION_INDEX_NODE* node = index->buckets[hash & (index->bucket_count - 1)];
+    while ((node != NULL) &&
+           ((node->hash != hash) || (strcmp(node->property, property) != 0) || (strcmp(node->value, value) != 0)))
+    {
+        node = node->next;
+    }
+    return node;
+}
+
+static SUBSCRIPTION_INDEX_PROPERTY* find_property(SUBSCRIPTION_INDEX_HANDLE_DATA* index, const char* name)
+{
+    SUBSCRIPTION_INDEX_PROPERTY* result = NULL;
+    size_t i;
+    for (i = 0; i < index->property_count; i++)
+    {
+        if (strcmp(index->properties[i].name, name) == 0)
+        {
+            result = &index->properties[i];
+            break;
+        }
+    }
+    return result;
+}
+
+static int add_property_ref(SUBSCRIPTION_INDEX_HANDLE_DATA* index, const char* name)
+{
+    int result;
+    SUBSCRIPTION_INDEX_PROPERTY* property = find_property(index, name);
+    if (property != NULL)
+    {
+        property->node_count++;
+        result = 0;
+    }
+    else if (ensure_capacity((void**)&index->properties, &index->property_capacity, index->property_count + 1, sizeof(SUBSCRIPTION_INDEX_PROPERTY)) != 0)
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        size_t length = strlen(name) + 1;
+        char* name_copy = (char*)malloc(length);
+        if (name_copy == NULL)
+        {
+            LogError("malloc failed");
+            result = __LINE__;
+        }
+        else
+        {
+            (void)memcpy(name_copy, name, length);
+            index->properties[index->property_count].name = name_copy;
+            index->properties[index->property_count].node_count = 1;
+            index->property_count++;
+            result = 0;
+        }
+    }
+    return result;
+}
+
+static void release_property_ref(SUBSCRIPTION_INDEX_HANDLE_DATA* index, const char* name)
+{
+    SUBSCRIPTION_INDEX_PROPERTY* property = find_property(index, name);
+    if (property != NULL && --property->node_count == 0)
+    {
+        free(property->name);
+        *property = index->properties[index->property_count - 1];
+        index->property_count--;
+    }
+}
+
+/*doubles the number of buckets; failing to do so only makes the chains longer*/
+static void grow_buckets(SUBSCRIPTION_INDEX_HANDLE_DATA* index)
+{
+    size_t new_bucket_count = index->bucket_count * 2;
+    SUBSCRIPTION_INDEX_NODE** new_buckets = (SUBSCRIPTION_INDEX_NODE**)malloc(new_bucket_count * sizeof(SUBSCRIPTION_INDEX_NODE*));
+    if (new_buckets == NULL)
+    {
+        LogError("malloc failed, the subscription index will not grow");
+    }
+    else
+    {
+        size_t i;
+        for (i = 0; i < new_bucket_count; i++)
+        {
+            new_buckets[i] = NULL;
+        }
+        for (i = 0; i < index->bucket_count; i++)
+        {
+            SUBSCRIPTION_INDEX_NODE* node = index->buckets[i];
+            while (node != NULL)
+            {
+                SUBSCRIPTION_INDEX_NODE* next = node->next;
+                size_t bucket = node->hash & (new_bucket_count - 1);
+                node->next = new_buckets[bucket];
+                new_buckets[bucket] = node;
+                node = next;
+            }
+        }
+        free(index->buckets);
+        index->buckets = new_buckets;
+        index->bucket_count = new_bucket_count;
+    }
+}
+
+static SUBSCRIPTION_INDEX_NODE* create_node(SUBSCRIPTION_INDEX_HANDLE_DATA* index, const char* property, const char* value, size_t hash)
+{
+    size_t property_length = strlen(property) + 1;
+    size_t value_length = strlen(value) + 1;
+    SUBSCRIPTION_INDEX_NODE* result = (SUBSCRIPTION_INDEX_NODE*)malloc(sizeof(SUBSCRIPTION_INDEX_NODE) + property_length + value_length);
+    if (result == NULL)
+    {
+        LogError("malloc failed");
+    }
+    else if (add_property_ref(index, property) != 0)
+    {
+        free(result);
+        result = NULL;
+    }
+    else
+    {
+        char* strings = (char*)(result + 1);
+        size_t bucket;
+        (void)memcpy(strings, property, property_length);
+        (void)memcpy(strings + property_length, value, value_length);
+        result->property = strings;
+        result->value = strings + property_length;
+        result->hash = hash;
+        result->entries = NULL;
+        result->entry_count = 0;
+        result->entry_capacity = 0;
+
+        if (index->node_count >= index->bucket_count)
+        {
+            grow_buckets(index);
+        }
+        bucket = hash & (index->bucket_count - 1);
+        result->next = index->buckets[bucket];
+        index->buckets[bucket] = result;
+        index->node_count++;
+    }
+    return result;
+}
+
+static int add_entry(SUBSCRIPTION_INDEX_HANDLE_DATA* index, const char* property, const char* value, size_t slot, size_t condition)
+{
+    int result;
+    size_t hash = hash_pair(property, value);
+    SUBSCRIPTION_INDEX_NODE* node = find_node(index, property, value, hash);
+    if ((node == NULL) && ((node = create_node(index, property, value, hash)) == NULL))
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        size_t i;
+        for (i = 0; i < node->entry_count; i++)
+        {
+            if ((node->entries[i].slot == slot) && (node->entries[i].condition == condition))
+            {
+                break;
+            }
+        }
+
+        if (i < node->entry_count)
+        {
+            /*the same value was given twice for the condition*/
+            result = 0;
+        }
+        else if (ensure_capacity((void**)&node->entries, &node->entry_capacity, node->entry_count + 1, sizeof(SUBSCRIPTION_INDEX_ENTRY)) != 0)
+        {
+            result = __LINE__;
+        }
+        else
+        {
+            node->entries[node->entry_count].slot = slot;
+            node->entries[node->entry_count].condition = condition;
+            node->entry_count++;
+            result = 0;
+        }
+    }
+    return result;
+}
+
+static void destroy_node(SUBSCRIPTION_INDEX_NODE* node)
+{
+    free(node->entries);
+    free(node);
+}
+
+/*removes every entry of 'slot' and every node left without entries*/
+static void remove_slot_entries(SUBSCRIPTION_INDEX_HANDLE_DATA* index, size_t slot)
+{
+    size_t i;
+    for (i = 0; i < index->bucket_count; i++)
+    {
+        SUBSCRIPTION_INDEX_NODE** link = &index->buckets[i];
+        while (*link != NULL)
+        {
+            SUBSCRIPTION_INDEX_NODE* node = *link;
+            size_t read, write = 0;
+            for (read = 0; read < node->entry_count; read++)
+            {
+                if (node->entries[read].slot != slot)
+                {
+                    node->entries[write++] = node->entries[read];
+                }
+            }
+            node->entry_count = write;
+
+            if (node->entry_count == 0)
+            {
+                *link = node->next;
+                release_property_ref(index, node->property);
+                destroy_node(node);
+                index->node_count--;
+            }
+            else
+            {
+                link = &node->next;
+            }
+        }
+    }
+}
+
+static bool is_valid_filter(const MESSAGE_BUS_FILTER* filter)
+{
+    bool result = (filter->conditions != NULL) && (filter->condition_count > 0);
+    size_t i, j;
+    for (i = 0; result && (i < filter->condition_count); i++)
+    {
+        const MESSAGE_BUS_FILTER_CONDITION* condition = &filter->conditions[i];
+        result = (condition->property != NULL) && (condition->values != NULL) && (condition->value_count > 0);
+        for (j = 0; result && (j < condition->value_count); j++)
+        {
+            result = (condition->values[j] != NULL);
+        }
+    }
+    return result;
+}
+
+SUBSCRIPTION_INDEX_HANDLE SubscriptionIndex_Create(void)
+{
+    /*Codes_SRS_SUBSCRIPTION_INDEX_13_001: [SubscriptionIndex_Create shall allocate a new SUBSCRIPTION_INDEX_HANDLE_DATA and return NULL if it fails.]*/
+    SUBSCRIPTION_INDEX_HANDLE_DATA* result = (SUBSCRIPTION_INDEX_HANDLE_DATA*)malloc(sizeof(SUBSCRIPTION_INDEX_HANDLE_DATA));
+    if (result == NULL)
+    {
+        LogError("malloc failed");
+    }
+    else
+    {
+        /*Codes_SRS_SUBSCRIPTION_INDEX_13_002: [SubscriptionIndex_Create shall allocate a hash table of 16 empty buckets and return NULL if it fails.]*/
+        result->buckets = (SUBSCRIPTION_INDEX_NODE**)malloc(SUBSCRIPTION_INDEX_INITIAL_BUCKETS * sizeof(SUBSCRIPTION_INDEX_NODE*));
+        if (result->buckets == NULL)
+        {
+            LogError("malloc failed");
+            free(result);
+            result = NULL;
+        }
+        else
+        {
+            size_t i;
+            for (i = 0; i < SUBSCRIPTION_INDEX_INITIAL_BUCKETS; i++)
+            {
+                result->buckets[i] = NULL;
+            }
+            result->bucket_count = SUBSCRIPTION_INDEX_INITIAL_BUCKETS;
+            result->node_count = 0;
+            result->properties = NULL;
+            result->property_count = 0;
+            result->property_capacity = 0;
+            result->condition_counts = NULL;
+            result->slot_count = 0;
+            result->slot_capacity = 0;
+        }
+    }
+    return result;
+}
+
+void SubscriptionIndex_Destroy(SUBSCRIPTION_INDEX_HANDLE handle)
+{
+    /*Codes_SRS_SUBSCRIPTION_INDEX_13_003: [If handle is NULL, SubscriptionIndex_Destroy shall do nothing.]*/
+    if (handle != NULL)
+    {
+        size_t i;
+        /*Codes_SRS_SUBSCRIPTION_INDEX_13_004: [SubscriptionIndex_Destroy shall free every node, every property name and the index.]*/
+        for (i = 0; i < handle->bucket_count; i++)
+        {
+            SUBSCRIPTION_INDEX_NODE* node = handle->buckets[i];
+            while (node != NULL)
+            {
+                SUBSCRIPTION_INDEX_NODE* next = node->next;
+                destroy_node(node);
+                node = next;
+            }
+        }
+        for (i = 0; i < handle->property_count; i++)
+        {
+            free(handle->properties[i].name);
+        }
+        free(handle->properties);
+        free(handle->condition_counts);
+        free(handle->buckets);
+        free(handle);
+    }
+}
+
+/*copies a node, its strings and its entries; the copy is not linked to any bucket*/
+static SUBSCRIPTION_INDEX_NODE* clone_node(const SUBSCRIPTION_INDEX_NODE* node)
+{
+    size_t property_length = strlen(node->property) + 1;
+    size_t value_length = strlen(node->value) + 1;
+    SUBSCRIPTION_INDEX_NODE* result = (SUBSCRIPTION_INDEX_NODE*)malloc(sizeof(SUBSCRIPTION_INDEX_NODE) + property_length + value_length);
+    if (result == NULL)
+    {
+        LogError("malloc failed");
+    }
+    else
+    {
+        char* strings = (char*)(result + 1);
+        (void)memcpy(strings, node->property, property_length);
+        (void)memcpy(strings + property_length, node->value, value_length);
+        result->property = strings;
+        result->value = strings + property_length;
+        result->hash = node->hash;
+        result->entry_count = node->entry_count;
+        result->entry_capacity = node->entry_count;
+        result->next = NULL;
+        result->entries = (SUBSCRIPTION_INDEX_ENTRY*)malloc(node->entry_count * sizeof(SUBSCRIPTION_INDEX_ENTRY));
+        if (result->entries == NULL)
+        {
+            LogError("malloc failed");
+            free(result);
+            result = NULL;
+        }
+        else
+        {
+            (void)memcpy(result->entries, node->entries, node->entry_count * sizeof(SUBSCRIPTION_INDEX_ENTRY));
+        }
+    }
+    return result;
+}
+
+SUBSCRIPTION_INDEX_HANDLE SubscriptionIndex_Clone(SUBSCRIPTION_INDEX_HANDLE handle)
+{
+    SUBSCRIPTION_INDEX_HANDLE_DATA* result;
+
+    /*Codes_SRS_SUBSCRIPTION_INDEX_13_017: [If handle is NULL, SubscriptionIndex_Clone shall return NULL.]*/
+    if (handle == NULL)
+    {
+        LogError("invalid arg handle=NULL");
+        result = NULL;
+    }
+    /*Codes_SRS_SUBSCRIPTION_INDEX_13_018: [SubscriptionIndex_Clone shall create a new index with the same slots, filters and number of buckets as handle.]*/
+    else if ((result = SubscriptionIndex_Create()) == NULL)
+    {
+        LogError("SubscriptionIndex_Create failed");
+    }
+    else
+    {
+        bool failed = false;
+        size_t i;
+
+        if (handle->bucket_count != result->bucket_count)
+        {
+            SUBSCRIPTION_INDEX_NODE** buckets = (SUBSCRIPTION_INDEX_NODE**)realloc(result->buckets, handle->bucket_count * sizeof(SUBSCRIPTION_INDEX_NODE*));
+            if (buckets == NULL)
+            {
+                LogError("realloc failed");
+                failed = true;
+            }
+            else
+            {
+                result->buckets = buckets;
+                result->bucket_count = handle->bucket_count;
+                for (i = 0; i < result->bucket_count; i++)
+                {
+                    result->buckets[i] = NULL;
+                }
+            }
+        }
+
+        for (i = 0; !failed && (i < handle->bucket_count); i++)
+        {
+            /*keep the order of the chains so that lookups in the clone cost the same*/
+            SUBSCRIPTION_INDEX_NODE** tail = &result->buckets[i];
+            const SUBSCRIPTION_INDEX_NODE* node;
+            for (node = handle->buckets[i]; !failed && (node != NULL); node = node->next)
+            {
+                SUBSCRIPTION_INDEX_NODE* copy = clone_node(node);
+                if (copy == NULL)
+                {
+                    failed = true;
+                }
+                else
+                {
+                    *tail = copy;
+                    tail = &copy->next;
+                    result->node_count++;
+                }
+            }
+        }
+
+        if (!failed &&
+            ((ensure_capacity((void**)&result->properties, &result->property_capacity, handle->property_count, sizeof(SUBSCRIPTION_INDEX_PROPERTY)) != 0) ||
+             (ensure_capacity((void**)&result->condition_counts, &result->slot_capacity, handle->slot_count, sizeof(size_t)) != 0)))
+        {
+            failed = true;
+        }
+
+        for (i = 0; !failed && (i < handle->property_count); i++)
+        {
+            size_t length = strlen(handle->properties[i].name) + 1;
+            char* name_copy = (char*)malloc(length);
+            if (name_copy == NULL)
+            {
+                LogError("malloc failed");
+                failed = true;
+            }
+            else
+            {
+                (void)memcpy(name_copy, handle->properties[i].name, length);
+                result->properties[i].name = name_copy;
+                result->properties[i].node_count = handle->properties[i].node_count;
+                result->property_count++;
+            }
+        }
+
+        if (failed)
+        {
+            /*Codes_SRS_SUBSCRIPTION_INDEX_13_019: [If any allocation fails, SubscriptionIndex_Clone shall free what it allocated and return NULL.]*/
+            SubscriptionIndex_Destroy(result);
+            result = NULL;
+        }
+        else
+        {
+            if (handle->slot_count > 0)
+            {
+                (void)memcpy(result->condition_counts, handle->condition_counts, handle->slot_count * sizeof(size_t));
+            }
+            result->slot_count = handle->slot_count;
+        }
+    }
+
+    return result;
+}
+
+SUBSCRIPTION_INDEX_RESULT SubscriptionIndex_Add(SUBSCRIPTION_INDEX_HANDLE handle, const MESSAGE_BUS_FILTER* filter, size_t* slot)
+{
+    SUBSCRIPTION_INDEX_RESULT result;
+
+    /*Codes_SRS_SUBSCRIPTION_INDEX_13_005: [If handle, filter or slot is NULL, SubscriptionIndex_Add shall return SUBSCRIPTION_INDEX_INVALIDARG.]*/
+    /*Codes_SRS_SUBSCRIPTION_INDEX_13_006: [If filter has no conditions, or a condition has a NULL property or no values or a NULL value, SubscriptionIndex_Add shall return SUBSCRIPTION_INDEX_INVALIDARG.]*/
+    if (handle == NULL || filter == NULL || slot == NULL || !is_valid_filter(filter))
+    {
+        LogError("invalid arg handle=%p, filter=%p, slot=%p", handle, filter, slot);
+        result = SUBSCRIPTION_INDEX_INVALIDARG;
+    }
+    else
+    {
+        /*Codes_SRS_SUBSCRIPTION_INDEX_13_007: [SubscriptionIndex_Add shall use the first slot that is not in use, or a new slot if all of them are.]*/
+        size_t new_slot;
+        for (new_slot = 0; new_slot < handle->slot_count; new_slot++)
+        {
+            if (handle->condition_counts[new_slot] == SUBSCRIPTION_INDEX_FREE_SLOT)
+            {
+                break;
+            }
+        }
+
+        if ((new_slot == handle->slot_count) &&
+            (ensure_capacity((void**)&handle->condition_counts, &handle->slot_capacity, handle->slot_count + 1, sizeof(size_t)) != 0))
+        {
+            /*Codes_SRS_SUBSCRIPTION_INDEX_13_009: [If any allocation fails, SubscriptionIndex_Add shall remove what it added to the index and return SUBSCRIPTION_INDEX_ERROR.]*/
+            result = SUBSCRIPTION_INDEX_ERROR;
+        }
+        else
+        {
+            size_t i, j;
+            result = SUBSCRIPTION_INDEX_OK;
+
+            /*Codes_SRS_SUBSCRIPTION_INDEX_13_008: [SubscriptionIndex_Add shall record the slot and condition under the (property, value) key of every value of every condition of filter.]*/
+            for (i = 0; (result == SUBSCRIPTION_INDEX_OK) && (i < filter->condition_count); i++)
+            {
+                const MESSAGE_BUS_FILTER_CONDITION* condition = &filter->conditions[i];
+                for (j = 0; (result == SUBSCRIPTION_INDEX_OK) && (j < condition->value_count); j++)
+                {
+                    if (add_entry(handle, condition->property, condition->values[j], new_slot, i) != 0)
+                    {
+                        result = SUBSCRIPTION_INDEX_ERROR;
+                    }
+                }
+            }
+
+            if (result != SUBSCRIPTION_INDEX_OK)
+            {
+                /*Codes_SRS_SUBSCRIPTION_INDEX_13_009: [If any allocation fails, SubscriptionIndex_Add shall remove what it added to the index and return SUBSCRIPTION_INDEX_ERROR.]*/
+                LogError("unable to add the filter to the index");
+                remove_slot_entries(handle, new_slot);
+            }
+            else
+            {
+                /*Codes_SRS_SUBSCRIPTION_INDEX_13_010: [SubscriptionIndex_Add shall store the slot in slot and return SUBSCRIPTION_INDEX_OK.]*/
+                handle->condition_counts[new_slot] = filter->condition_count;
+                if (new_slot == handle->slot_count)
+                {
+                    handle->slot_count++;
+                }
+                *slot = new_slot;
+            }
+        }
+    }
+
+    return result;
+}
+
+void SubscriptionIndex_Remove(SUBSCRIPTION_INDEX_HANDLE handle, size_t slot)
+{
+    /*Codes_SRS_SUBSCRIPTION_INDEX_13_011: [If handle is NULL or slot is not in use, SubscriptionIndex_Remove shall do nothing.]*/
+    if (handle == NULL || slot >= handle->slot_count || handle->condition_counts[slot] == SUBSCRIPTION_INDEX_FREE_SLOT)
+    {
+        LogError("invalid arg handle=%p, slot=%zu", handle, slot);
+    }
+    else
+    {
+        /*Codes_SRS_SUBSCRIPTION_INDEX_13_012: [SubscriptionIndex_Remove shall remove every entry of slot from the index, free the nodes and property names no longer used and mark slot as not in use.]*/
+        remove_slot_entries(handle, slot);
+        handle->condition_counts[slot] = SUBSCRIPTION_INDEX_FREE_SLOT;
+    }
+}
+
+size_t SubscriptionIndex_GetSlotCount(SUBSCRIPTION_INDEX_HANDLE handle)
+{
+    /*Codes_SRS_SUBSCRIPTION_INDEX_13_013: [SubscriptionIndex_GetSlotCount shall return the number of slots of the index, or 0 if handle is NULL.]*/
+    return (handle == NULL) ? 0 : handle->slot_count;
+}
+
+void SubscriptionIndex_Match(SUBSCRIPTION_INDEX_HANDLE handle, MESSAGE_HANDLE message, size_t* matches)
+{
+    /*Codes_SRS_SUBSCRIPTION_INDEX_13_014: [If handle or matches is NULL, SubscriptionIndex_Match shall do nothing.]*/
+    if (handle == NULL || matches == NULL)
+    {
+        LogError("invalid arg handle=%p, matches=%p", handle, matches);
+    }
+    else
+    {
+        size_t i, j;
+        for (i = 0; i < handle->slot_count; i++)
+        {
+            matches[i] = 0;
+        }
+
+        if (message != NULL)
+        {
+            /*Codes_SRS_SUBSCRIPTION_INDEX_13_015: [SubscriptionIndex_Match shall look up the value of every indexed property name in the properties of message with Message_GetProperty and count, for each slot, the conditions accepting that value.]*/
+            for (i = 0; i < handle->property_count; i++)
+            {
+                const char* name = handle->properties[i].name;
+                const char* value = Message_GetProperty(message, name);
+                if (value != NULL)
+                {
+                    SUBSCRIPTION_INDEX_NODE* node = find_node(handle, name, value, hash_pair(name, value));
+                    if (node != NULL)
+                    {
+                        for (j = 0; j < node->entry_count; j++)
+                        {
+                            matches[node->entries[j].slot]++;
+                        }
+                    }
+                }
+            }
+        }
+
+        /*Codes_SRS_SUBSCRIPTION_INDEX_13_016: [SubscriptionIndex_Match shall set matches[slot] to 1 for every slot in use whose conditions are all satisfied and to 0 for every other slot.]*/
+        for (i = 0; i < handle->slot_count; i++)
+        {
+            matches[i] = ((handle->condition_counts[i] != SUBSCRIPTION_INDEX_FREE_SLOT) && (matches[i] == handle->condition_counts[i])) ? 1 : 0;
+        }
+    }
+}
@@ -0,0 +1,355 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include "azure_c_shared_utility/gballoc.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "azure_c_shared_utility/iot_logging.h"
+
+#include "worker_pool.h"
+
+#if defined(WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+typedef struct WORKER_POOL_HANDLE_DATA_TAG
+{
+    /**
+    * Lock guarding the scheduled tasks and 'quit'.
+    */
+    LOCK_HANDLE             lock;
+
+    /**
+    * A condition variable that is signaled when a task is scheduled or the
+    * pool is being destroyed.
+    */
+    COND_HANDLE             cond;
+
+    /**
+    * Scheduled tasks, oldest first, linked through WORKER_POOL_TASK::next.
+    */
+    WORKER_POOL_TASK*       head;
+    WORKER_POOL_TASK*       tail;
+
+    /**
+    * The threads of the pool.
+    */
+    THREAD_HANDLE*          threads;
+    size_t                  thread_count;
+
+    /**
+    * Called by every thread right before it exits, may be NULL.
+    */
+    WORKER_POOL_THREAD_EXIT_FUNCTION on_thread_exit;
+
+    /**
+    * The threads keep running while this is 0.
+    */
+    int                     quit;
+}WORKER_POOL_HANDLE_DATA;
+
+static size_t get_processor_count(void)
+{
+    size_t result;
+#if defined(WIN32)
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    result = (size_t)system_info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    result = (processors > 0) ? (size_t)processors : 1;
+#else
+    result = 1;
+#endif
+    return (result == 0) ? 1 : result;
+}
+
+static int worker_pool_thread(void* user_data)
+{
+    WORKER_POOL_HANDLE_DATA* pool = (WORKER_POOL_HANDLE_DATA*)user_data;
+
+    if (Lock(pool->lock) != LOCK_OK)
+    {
+        LogError("unable to lock");
+    }
+    else
+    {
+        bool locked = true;
+
+        /*Codes_SRS_WORKER_POOL_13_008: [Every thread of the pool shall run the scheduled tasks one at a time, oldest first, until the pool is destroyed.]*/
+        while (pool->quit == 0)
+        {
+            if (pool->head == NULL)
+            {
+                if (Condition_Wait(pool->cond, pool->lock, 0) != COND_OK)
+                {
+                    LogError("Condition_Wait has failed. Bailing.");
+                    break;
+                }
+            }
+            else
+            {
+                WORKER_POOL_TASK* task = pool->head;
+                pool->head = task->next;
+                if (pool->head == NULL)
+                {
+                    pool->tail = NULL;
+                }
+                task->next = NULL;
+
+                /*Codes_SRS_WORKER_POOL_13_009: [The thread shall not hold the pool lock while it runs a task.]*/
+                (void)Unlock(pool->lock);
+                task->function(task->context);
+                if (Lock(pool->lock) != LOCK_OK)
+                {
+                    LogError("unable to lock");
+                    locked = false;
+                    break;
+                }
+            }
+        }
+
+        if (locked)
+        {
+            /*Condition_Post wakes a single thread, pass the wake-up on so that every thread sees 'quit'*/
+            (void)Condition_Post(pool->cond);
+            (void)Unlock(pool->lock);
+        }
+    }
+
+    /*Codes_SRS_WORKER_POOL_13_017: [Before it exits, every thread of the pool shall call on_thread_exit if it is not NULL.]*/
+    if (pool->on_thread_exit != NULL)
+    {
+        pool->on_thread_exit();
+    }
+
+    return 0;
+}
+
+/*stops and joins the first 'count' threads of the pool*/
+static void stop_threads(WORKER_POOL_HANDLE_DATA* pool, size_t count)
+{
+    size_t i;
+
+    if (Lock(pool->lock) != LOCK_OK)
+    {
+        pool->quit = 1; /*at the cost of a data race, still try to stop the threads*/
+        LogError("unable to lock");
+    }
+    else
+    {
+        pool->quit = 1;
+        (void)Condition_Post(pool->cond);
+        (void)Unlock(pool->lock);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        int thread_result;
+        if (ThreadAPI_Join(pool->threads[i], &thread_result) != THREADAPI_OK)
+        {
+            LogError("ThreadAPI_Join failed");
+        }
+    }
+}
+
+WORKER_POOL_HANDLE WorkerPool_Create(size_t thread_count)
+{
+    /*Codes_SRS_WORKER_POOL_13_018: [WorkerPool_Create shall create the pool the same way as WorkerPool_CreateWithThreadExit with a NULL on_thread_exit.]*/
+    return WorkerPool_CreateWithThreadExit(thread_count, NULL);
+}
+
+WORKER_POOL_HANDLE WorkerPool_CreateWithThreadExit(size_t thread_count, WORKER_POOL_THREAD_EXIT_FUNCTION on_thread_exit)
+{
+    /*Codes_SRS_WORKER_POOL_13_001: [WorkerPool_Create shall allocate a new WORKER_POOL_HANDLE_DATA and return NULL if it fails.]*/
+    WORKER_POOL_HANDLE_DATA* result = (WORKER_POOL_HANDLE_DATA*)malloc(sizeof(WORKER_POOL_HANDLE_DATA));
+    if (result == NULL)
+    {
+        LogError("malloc failed");
+    }
+    else
+    {
+        /*Codes_SRS_WORKER_POOL_13_002: [If thread_count is 0, WorkerPool_Create shall create one thread per processor.]*/
+        result->thread_count = (thread_count == 0) ? get_processor_count() : thread_count;
+        result->head = NULL;
+        result->tail = NULL;
+        result->quit = 0;
+        result->on_thread_exit = on_thread_exit;
+
+        /*Codes_SRS_WORKER_POOL_13_003: [If creating the lock, the condition or the array of threads fails, WorkerPool_Create shall free what it created and return NULL.]*/
+        if ((result->lock = Lock_Init()) == NULL)
+        {
+            LogError("Lock_Init failed");
+            free(result);
+            result = NULL;
+        }
+        else if ((result->cond = Condition_Init()) == NULL)
+        {
+            LogError("Condition_Init failed");
+            Lock_Deinit(result->lock);
+            free(result);
+            result = NULL;
+        }
+        else if ((result->threads = (THREAD_HANDLE*)malloc(result->thread_count * sizeof(THREAD_HANDLE))) == NULL)
+        {
+            LogError("malloc failed");
+            Condition_Deinit(result->cond);
+            Lock_Deinit(result->lock);
+            free(result);
+            result = NULL;
+        }
+        else
+        {
+            size_t i;
+
+            /*Codes_SRS_WORKER_POOL_13_004: [WorkerPool_Create shall start thread_count threads by calling ThreadAPI_Create.]*/
+            for (i = 0; i < result->thread_count; i++)
+            {
+                if (ThreadAPI_Create(&result->threads[i], worker_pool_thread, result) != THREADAPI_OK)
+                {
+                    break;
+                }
+            }
+
+            if (i < result->thread_count)
+            {
+                /*Codes_SRS_WORKER_POOL_13_005: [If starting a thread fails, WorkerPool_Create shall stop the threads it started, free what it created and return NULL.]*/
+                LogError("ThreadAPI_Create failed");
+                stop_threads(result, i);
+                free(result->threads);
+                Condition_Deinit(result->cond);
+                Lock_Deinit(result->lock);
+                free(result);
+                result = NULL;
+            }
+        }
+    }
+
+    return result;
+}
+
+void WorkerPool_Destroy(WORKER_POOL_HANDLE handle)
+{
+    /*Codes_SRS_WORKER_POOL_13_006: [If handle is NULL, WorkerPool_Destroy shall do nothing.]*/
+    if (handle != NULL)
+    {
+        /*Codes_SRS_WORKER_POOL_13_007: [WorkerPool_Destroy shall signal the threads to stop, join them and free the pool. Tasks that are still scheduled shall not be run.]*/
+        stop_threads(handle, handle->thread_count);
+        free(handle->threads);
+        Condition_Deinit(handle->cond);
+        Lock_Deinit(handle->lock);
+        free(handle);
+    }
+}
+
+WORKER_POOL_RESULT WorkerPool_Schedule(WORKER_POOL_HANDLE handle, WORKER_POOL_TASK* task)
+{
+    WORKER_POOL_RESULT result;
+
+    /*Codes_SRS_WORKER_POOL_13_010: [If handle, task or task->function is NULL, WorkerPool_Schedule shall return WORKER_POOL_INVALIDARG.]*/
+    if (handle == NULL || task == NULL || task->function == NULL)
+    {
+        LogError("invalid arg: handle = %p, task = %p", handle, task);
+        result = WORKER_POOL_INVALIDARG;
+    }
+    else if (Lock(handle->lock) != LOCK_OK)
+    {
+        /*Codes_SRS_WORKER_POOL_13_012: [If locking fails, WorkerPool_Schedule shall return WORKER_POOL_ERROR.]*/
+        LogError("unable to lock");
+        result = WORKER_POOL_ERROR;
+    }
+    else
+    {
+        /*Codes_SRS_WORKER_POOL_13_011: [WorkerPool_Schedule shall append task to the scheduled tasks, signal one thread and return WORKER_POOL_OK.]*/
+        task->next = NULL;
+        if (handle->tail == NULL)
+        {
+            handle->head = task;
+        }
+        else
+        {
+            handle->tail->next = task;
+        }
+        handle->tail = task;
+
+        if (Condition_Post(handle->cond) != COND_OK)
+        {
+            LogError("Condition_Post failed");
+        }
+        (void)Unlock(handle->lock);
+        result = WORKER_POOL_OK;
+    }
+
+    return result;
+}
+
+WORKER_POOL_RESULT WorkerPool_Cancel(WORKER_POOL_HANDLE handle, WORKER_POOL_TASK* task)
+{
+    WORKER_POOL_RESULT result;
+
+    /*Codes_SRS_WORKER_POOL_13_014: [If handle or task is NULL, WorkerPool_Cancel shall return WORKER_POOL_INVALIDARG.]*/
+    if (handle == NULL || task == NULL)
+    {
+        LogError("invalid arg: handle = %p, task = %p", handle, task);
+        result = WORKER_POOL_INVALIDARG;
+    }
+    else if (Lock(handle->lock) != LOCK_OK)
+    {
+        LogError("unable to lock");
+        result = WORKER_POOL_ERROR;
+    }
+    else
+    {
+        WORKER_POOL_TASK* previous = NULL;
+        WORKER_POOL_TASK* current = handle->head;
+        while ((current != NULL) && (current != task))
+        {
+            previous = current;
+            current = current->next;
+        }
+
+        if (current == NULL)
+        {
+            /*Codes_SRS_WORKER_POOL_13_015: [If task is not scheduled, WorkerPool_Cancel shall return WORKER_POOL_ERROR.]*/
+            result = WORKER_POOL_ERROR;
+        }
+        else
+        {
+            /*Codes_SRS_WORKER_POOL_13_016: [WorkerPool_Cancel shall remove task from the scheduled tasks and return WORKER_POOL_OK.]*/
+            if (previous == NULL)
+            {
+                handle->head = task->next;
+            }
+            else
+            {
+                previous->next = task->next;
+            }
+            if (handle->tail == task)
+            {
+                handle->tail = previous;
+            }
+            task->next = NULL;
+            result = WORKER_POOL_OK;
+        }
+        (void)Unlock(handle->lock);
+    }
+
+    return result;
+}
+
+size_t WorkerPool_GetThreadCount(WORKER_POOL_HANDLE handle)
+{
+    /*Codes_SRS_WORKER_POOL_13_013: [WorkerPool_GetThreadCount shall return the number of threads of the pool, or 0 if handle is NULL.]*/
+    return (handle == NULL) ? 0 : handle->thread_count;
+}
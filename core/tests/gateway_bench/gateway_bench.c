@@ -0,0 +1,493 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/*
+* Measures the throughput and the latency of a gateway. Producer modules and
+* consumer modules are created in process and handed to Gateway_LL_Create2,
+* so no module library, network or configuration file is involved. Every
+* producer module has a thread that creates messages and publishes them as
+* fast as it can; links make the bus deliver them to every consumer module
+* (and not to the other producers). The content of every message starts with
+* the time it was created at and the consumers record how long it took the
+* message to reach them.
+*
+* Starting from a baseline configuration, the benchmark sweeps one parameter
+* at a time: the number of consumer modules, the size of the content, the
+* number of properties and the number of producer threads. Every run prints
+* one JSON object on its own line:
+*     {"consumers":<n>,"payload_bytes":<n>,"properties":<n>,"publishers":<n>,
+*      "messages":<n>,"deliveries":<n>,"elapsed_ms":<n>,"msgs_per_sec":<n>,
+*      "deliveries_per_sec":<n>,"latency_us":{"p50":<n>,"p99":<n>,"p999":<n>,"max":<n>}}
+* where messages counts the messages published, deliveries the messages
+* received by all the consumers and elapsed_ms the time until every consumer
+* received every message. The latencies are taken over every delivery.
+*
+* usage: gateway_bench [messages_per_run]
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "azure_c_shared_utility/threadapi.h"
+#include "azure_c_shared_utility/iot_logging.h"
+#include "azure_c_shared_utility/map.h"
+#include "azure_c_shared_utility/vector.h"
+
+#include "message.h"
+#include "module.h"
+#include "message_bus.h"
+#include "gateway_ll.h"
+
+#if defined(WIN32)
+#include <windows.h>
+#endif
+
+#define DEFAULT_MESSAGES_PER_RUN    100000
+#define DRAIN_TIMEOUT_US            120000000
+#define MAX_PUBLISHERS              16
+
+typedef struct BENCH_CONFIG_TAG
+{
+    size_t  consumers;
+    size_t  payload_bytes;
+    size_t  properties;
+    size_t  publishers;
+}BENCH_CONFIG;
+
+static const BENCH_CONFIG baseline = { 4, 64, 2, 1 };
+
+static const size_t consumer_counts[] = { 1, 4, 16, 64 };
+static const size_t payload_sizes[] = { 16, 256, 4096, 65536 };
+static const size_t property_counts[] = { 0, 4, 16 };
+static const size_t publisher_counts[] = { 1, 2, 4, 8 };
+
+typedef struct CONSUMER_TAG
+{
+    MODULE              module;
+    MODULE_C_STYLE      module_c_style;
+
+    /*latency of every message received, only ever written by the consumer's worker thread*/
+    uint64_t*           latencies_us;
+    size_t              capacity;
+    volatile size_t     received;
+}CONSUMER;
+
+typedef struct PRODUCER_TAG
+{
+    MODULE              module;
+    MODULE_C_STYLE      module_c_style;
+    MESSAGE_BUS_HANDLE  bus;
+    MAP_HANDLE          properties;
+    size_t              payload_bytes;
+    size_t              count;
+    size_t              published;
+}PRODUCER;
+
+static uint64_t get_time_us(void)
+{
+#if defined(WIN32)
+    LARGE_INTEGER frequency, counter;
+    (void)QueryPerformanceFrequency(&frequency);
+    (void)QueryPerformanceCounter(&counter);
+    return (uint64_t)((counter.QuadPart / frequency.QuadPart) * 1000000 + ((counter.QuadPart % frequency.QuadPart) * 1000000) / frequency.QuadPart);
+#else
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+#endif
+}
+
+static MODULE_HANDLE Bench_Create(MESSAGE_BUS_HANDLE busHandle, const void* configuration)
+{
+    (void)busHandle;
+    return (MODULE_HANDLE)configuration;
+}
+
+static void Bench_Destroy(MODULE_HANDLE moduleHandle)
+{
+    (void)moduleHandle;
+}
+
+static void Consumer_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messageHandle)
+{
+    CONSUMER* consumer = (CONSUMER*)moduleHandle;
+    const CONSTBUFFER* content = Message_GetContent(messageHandle);
+    if ((content != NULL) && (content->size >= sizeof(uint64_t)) && (consumer->received < consumer->capacity))
+    {
+        uint64_t created_us;
+        (void)memcpy(&created_us, content->buffer, sizeof(created_us));
+        consumer->latencies_us[consumer->received] = get_time_us() - created_us;
+    }
+    consumer->received++;
+}
+
+static void Producer_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messageHandle)
+{
+    /*the links never deliver anything to a producer*/
+    (void)moduleHandle;
+    (void)messageHandle;
+}
+
+static const MODULE_APIS consumer_apis =
+{
+    Bench_Create,
+    Bench_Destroy,
+    Consumer_Receive
+};
+
+static const MODULE_APIS producer_apis =
+{
+    Bench_Create,
+    Bench_Destroy,
+    Producer_Receive
+};
+
+static int producer_thread(void* param)
+{
+    PRODUCER* producer = (PRODUCER*)param;
+    unsigned char* payload = (unsigned char*)calloc(producer->payload_bytes, 1);
+    if (payload == NULL)
+    {
+        LogError("unable to allocate the payload");
+    }
+    else
+    {
+        MESSAGE_CONFIG config;
+        config.size = producer->payload_bytes;
+        config.source = payload;
+        config.sourceProperties = producer->properties;
+
+        for (producer->published = 0; producer->published < producer->count; producer->published++)
+        {
+            MESSAGE_HANDLE message;
+            uint64_t now_us = get_time_us();
+            (void)memcpy(payload, &now_us, sizeof(now_us));
+            if ((message = Message_Create(&config)) == NULL)
+            {
+                LogError("Message_Create failed");
+                break;
+            }
+            else
+            {
+                MESSAGE_BUS_RESULT publish_result = MessageBus_Publish(producer->bus, producer->module_c_style.module_handle, message);
+                Message_Destroy(message);
+                if (publish_result != MESSAGE_BUS_OK)
+                {
+                    LogError("MessageBus_Publish failed");
+                    break;
+                }
+            }
+        }
+        free(payload);
+    }
+    return 0;
+}
+
+static MAP_HANDLE create_properties(size_t count)
+{
+    MAP_HANDLE result = Map_Create(NULL);
+    if (result == NULL)
+    {
+        LogError("Map_Create failed");
+    }
+    else
+    {
+        size_t i;
+        for (i = 0; i < count; i++)
+        {
+            char name[32];
+            char value[32];
+            (void)sprintf(name, "property%lu", (unsigned long)i);
+            (void)sprintf(value, "value%lu", (unsigned long)i);
+            if (Map_Add(result, name, value) != MAP_OK)
+            {
+                LogError("Map_Add failed");
+                Map_Destroy(result);
+                result = NULL;
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+static size_t total_received(const CONSUMER* consumers, size_t count)
+{
+    size_t result = 0;
+    size_t i;
+    for (i = 0; i < count; i++)
+    {
+        result += consumers[i].received;
+    }
+    return result;
+}
+
+static int compare_latencies(const void* left, const void* right)
+{
+    uint64_t a = *(const uint64_t*)left;
+    uint64_t b = *(const uint64_t*)right;
+    return (a < b) ? -1 : ((a > b) ? 1 : 0);
+}
+
+/*value below which 'permille' thousandths of the sorted samples are*/
+static uint64_t percentile(const uint64_t* sorted, size_t count, size_t permille)
+{
+    size_t index = (count * permille) / 1000;
+    return (count == 0) ? 0 : sorted[(index < count) ? index : count - 1];
+}
+
+static int print_results(const BENCH_CONFIG* config, const CONSUMER* consumers, size_t messages, uint64_t elapsed_us)
+{
+    int result;
+    size_t deliveries = messages * config->consumers;
+    uint64_t* all = (uint64_t*)malloc(deliveries * sizeof(uint64_t));
+    if (all == NULL)
+    {
+        LogError("unable to allocate the latencies");
+        result = __LINE__;
+    }
+    else
+    {
+        size_t samples = 0;
+        size_t i;
+        double elapsed_s;
+        for (i = 0; i < config->consumers; i++)
+        {
+            size_t count = (consumers[i].received < consumers[i].capacity) ? consumers[i].received : consumers[i].capacity;
+            (void)memcpy(all + samples, consumers[i].latencies_us, count * sizeof(uint64_t));
+            samples += count;
+        }
+        qsort(all, samples, sizeof(uint64_t), compare_latencies);
+
+        if (elapsed_us == 0)
+        {
+            elapsed_us = 1;
+        }
+        elapsed_s = (double)elapsed_us / 1000000.0;
+        (void)printf("{\"consumers\":%lu,\"payload_bytes\":%lu,\"properties\":%lu,\"publishers\":%lu,"
+            "\"messages\":%lu,\"deliveries\":%lu,\"elapsed_ms\":%llu,\"msgs_per_sec\":%.0f,\"deliveries_per_sec\":%.0f,"
+            "\"latency_us\":{\"p50\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu}}\n",
+            (unsigned long)config->consumers, (unsigned long)config->payload_bytes, (unsigned long)config->properties, (unsigned long)config->publishers,
+            (unsigned long)messages, (unsigned long)deliveries, (unsigned long long)(elapsed_us / 1000),
+            (double)messages / elapsed_s, (double)deliveries / elapsed_s,
+            (unsigned long long)percentile(all, samples, 500),
+            (unsigned long long)percentile(all, samples, 990),
+            (unsigned long long)percentile(all, samples, 999),
+            (unsigned long long)((samples == 0) ? 0 : all[samples - 1]));
+        (void)fflush(stdout);
+        free(all);
+        result = 0;
+    }
+    return result;
+}
+
+static int run_bench(const BENCH_CONFIG* config, size_t messages_per_run)
+{
+    int result;
+    size_t per_publisher = messages_per_run / config->publishers;
+    size_t messages = per_publisher * config->publishers;
+    MESSAGE_BUS_HANDLE bus = MessageBus_Create();
+    MAP_HANDLE properties = create_properties(config->properties);
+    VECTOR_HANDLE modules = VECTOR_create(sizeof(MODULE));
+    CONSUMER* consumers = (CONSUMER*)calloc(config->consumers, sizeof(CONSUMER));
+    PRODUCER producers[MAX_PUBLISHERS];
+    GATEWAY_HANDLE gateway = NULL;
+    size_t i;
+
+    if ((bus == NULL) || (properties == NULL) || (modules == NULL) || (consumers == NULL) || (config->publishers > MAX_PUBLISHERS))
+    {
+        LogError("unable to set up the run");
+        result = __LINE__;
+    }
+    else
+    {
+        result = 0;
+        for (i = 0; (result == 0) && (i < config->consumers); i++)
+        {
+            consumers[i].capacity = messages;
+            consumers[i].latencies_us = (uint64_t*)malloc(messages * sizeof(uint64_t));
+            consumers[i].module_c_style.module_apis = &consumer_apis;
+            consumers[i].module_c_style.module_handle = consumer_apis.Module_Create(bus, &consumers[i]);
+            consumers[i].module.module_type = NATIVE_C_TYPE;
+            consumers[i].module.module_data = &consumers[i].module_c_style;
+            if ((consumers[i].latencies_us == NULL) || (VECTOR_push_back(modules, &consumers[i].module, 1) != 0))
+            {
+                LogError("unable to create consumer %lu", (unsigned long)i);
+                result = __LINE__;
+            }
+        }
+        for (i = 0; (result == 0) && (i < config->publishers); i++)
+        {
+            producers[i].bus = bus;
+            producers[i].properties = properties;
+            producers[i].payload_bytes = (config->payload_bytes < sizeof(uint64_t)) ? sizeof(uint64_t) : config->payload_bytes;
+            producers[i].count = per_publisher;
+            producers[i].published = 0;
+            producers[i].module_c_style.module_apis = &producer_apis;
+            producers[i].module_c_style.module_handle = producer_apis.Module_Create(bus, &producers[i]);
+            producers[i].module.module_type = NATIVE_C_TYPE;
+            producers[i].module.module_data = &producers[i].module_c_style;
+            if (VECTOR_push_back(modules, &producers[i].module, 1) != 0)
+            {
+                LogError("unable to create producer %lu", (unsigned long)i);
+                result = __LINE__;
+            }
+        }
+
+        if (result == 0)
+        {
+            /*the gateway owns the bus from here on*/
+            gateway = Gateway_LL_Create2(modules, bus);
+            if (gateway == NULL)
+            {
+                LogError("Gateway_LL_Create2 failed");
+                result = __LINE__;
+            }
+        }
+
+        for (i = 0; (result == 0) && (i < config->consumers); i++)
+        {
+            MESSAGE_BUS_LINK link = { NULL, consumers[i].module_c_style.module_handle, NULL, NULL };
+            if (MessageBus_AddLink(bus, &link) != MESSAGE_BUS_OK)
+            {
+                LogError("MessageBus_AddLink failed");
+                result = __LINE__;
+            }
+        }
+
+        if (result == 0)
+        {
+            THREAD_HANDLE threads[MAX_PUBLISHERS];
+            size_t started;
+            size_t expected = messages * config->consumers;
+            uint64_t start_us = get_time_us();
+            uint64_t end_us;
+
+            for (started = 0; started < config->publishers; started++)
+            {
+                if (ThreadAPI_Create(&threads[started], producer_thread, &producers[started]) != THREADAPI_OK)
+                {
+                    LogError("ThreadAPI_Create failed");
+                    break;
+                }
+            }
+            for (i = 0; i < started; i++)
+            {
+                int thread_result;
+                (void)ThreadAPI_Join(threads[i], &thread_result);
+            }
+
+            /*wait for the module workers to deliver everything that was published*/
+            end_us = get_time_us();
+            while ((total_received(consumers, config->consumers) < expected) && ((end_us - start_us) < DRAIN_TIMEOUT_US))
+            {
+                ThreadAPI_Sleep(1);
+                end_us = get_time_us();
+            }
+            end_us = get_time_us();
+
+            if ((started != config->publishers) || (total_received(consumers, config->consumers) < expected))
+            {
+                LogError("only %lu of %lu messages were delivered", (unsigned long)total_received(consumers, config->consumers), (unsigned long)expected);
+                result = __LINE__;
+            }
+            else
+            {
+                result = print_results(config, consumers, messages, end_us - start_us);
+            }
+        }
+    }
+
+    /*removes the modules from the bus and destroys it; the modules themselves belong to this function*/
+    if (gateway != NULL)
+    {
+        Gateway_LL_Destroy(gateway);
+    }
+    else if (bus != NULL)
+    {
+        MessageBus_Destroy(bus);
+    }
+    if (consumers != NULL)
+    {
+        for (i = 0; i < config->consumers; i++)
+        {
+            free(consumers[i].latencies_us);
+        }
+        free(consumers);
+    }
+    if (modules != NULL)
+    {
+        VECTOR_destroy(modules);
+    }
+    if (properties != NULL)
+    {
+        Map_Destroy(properties);
+    }
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    int result = 0;
+    size_t messages_per_run = DEFAULT_MESSAGES_PER_RUN;
+    size_t i;
+
+    if (argc > 1)
+    {
+        messages_per_run = (size_t)strtoul(argv[1], NULL, 10);
+    }
+
+    if (messages_per_run == 0)
+    {
+        (void)printf("usage: gateway_bench [messages_per_run]\n");
+        result = 1;
+    }
+    else
+    {
+        BENCH_CONFIG config;
+
+        for (i = 0; i < sizeof(consumer_counts) / sizeof(consumer_counts[0]); i++)
+        {
+            config = baseline;
+            config.consumers = consumer_counts[i];
+            /*keep the number of deliveries, and the memory the latencies take, about the same*/
+            if (run_bench(&config, (messages_per_run * baseline.consumers) / config.consumers) != 0)
+            {
+                result = 1;
+            }
+        }
+        for (i = 0; i < sizeof(payload_sizes) / sizeof(payload_sizes[0]); i++)
+        {
+            config = baseline;
+            config.payload_bytes = payload_sizes[i];
+            if (run_bench(&config, messages_per_run) != 0)
+            {
+                result = 1;
+            }
+        }
+        for (i = 0; i < sizeof(property_counts) / sizeof(property_counts[0]); i++)
+        {
+            config = baseline;
+            config.properties = property_counts[i];
+            if (run_bench(&config, messages_per_run) != 0)
+            {
+                result = 1;
+            }
+        }
+        for (i = 0; i < sizeof(publisher_counts) / sizeof(publisher_counts[0]); i++)
+        {
+            config = baseline;
+            config.publishers = publisher_counts[i];
+            if (run_bench(&config, messages_per_run) != 0)
+            {
+                result = 1;
+            }
+        }
+    }
+
+    return result;
+}
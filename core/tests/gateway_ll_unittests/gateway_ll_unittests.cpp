@@ -10,10 +10,13 @@
 #include "micromock.h"
 #include "micromockcharstararenullterminatedstrings.h"
 #include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
 
 #include "gateway_ll.h"
 #include "message_bus.h"
 #include "module_loader.h"
+#include "worker_pool.h"
+#include "message_pool.h"
 
 #define DUMMY_LIBRARY_PATH "x.dll"
 
@@ -54,6 +57,7 @@ static size_t currentMessageBus_Create_call;
 static size_t whenShallMessageBus_Create_fail;
 static size_t currentMessageBus_module_count;
 static size_t currentMessageBus_ref_count;
+static MESSAGE_BUS_CONFIG lastMessageBus_Create2_config;
 
 static size_t currentModuleLoader_Load_call;
 static size_t whenShallModuleLoader_Load_fail;
@@ -68,6 +72,18 @@ static size_t whenShallVECTOR_push_back_fail;
 static size_t currentVECTOR_find_if_call;
 static size_t whenShallVECTOR_find_if_fail;
 
+static size_t currentWorkerPool_Create_call;
+static size_t whenShallWorkerPool_Create_fail;
+static size_t currentWorkerPool_thread_count;
+static WORKER_POOL_THREAD_EXIT_FUNCTION currentWorkerPool_on_thread_exit;
+static size_t currentWorkerPool_Schedule_call;
+static size_t whenShallWorkerPool_Schedule_fail;
+static size_t currentWorkerPool_Destroy_call;
+static size_t currentMessageBus_AddLink_call;
+static size_t currentMessageBus_RemoveLink_call;
+static size_t currentLock_call;
+static size_t whenShallLock_fail;
+
 static MODULE_APIS dummyAPIs;
 
 TYPED_MOCK_CLASS(CGatewayLLMocks, CGlobalMock)
@@ -123,6 +139,12 @@ public:
 	}
 	MOCK_METHOD_END(MESSAGE_BUS_HANDLE, result1);
 
+	MOCK_STATIC_METHOD_1(, MESSAGE_BUS_HANDLE, MessageBus_Create2, const MESSAGE_BUS_CONFIG*, config)
+		lastMessageBus_Create2_config = *config;
+		++currentMessageBus_ref_count;
+		MESSAGE_BUS_HANDLE result1 = (MESSAGE_BUS_HANDLE)BASEIMPLEMENTATION::gballoc_malloc(1);
+	MOCK_METHOD_END(MESSAGE_BUS_HANDLE, result1);
+
 	MOCK_STATIC_METHOD_1(, void, MessageBus_Destroy, MESSAGE_BUS_HANDLE, bus)
 		if (currentMessageBus_ref_count > 0)
 		{
@@ -134,7 +156,7 @@ public:
 		}
 	MOCK_VOID_METHOD_END();
 
-	MOCK_STATIC_METHOD_3(, MESSAGE_BUS_RESULT, MessageBus_AddModule, MESSAGE_BUS_HANDLE, handle, MODULE_HANDLE, module, const MODULE_APIS*, module_apis)
+	MOCK_STATIC_METHOD_5(, MESSAGE_BUS_RESULT, MessageBus_AddModuleWithReceiveBatch, MESSAGE_BUS_HANDLE, handle, const MODULE*, module, const MESSAGE_BUS_FILTER*, filter, const MESSAGE_BUS_QUEUE_CONFIG*, queue_config, pfModule_ReceiveBatch, receive_batch)
 		currentMessageBus_AddModule_call++;
 		MESSAGE_BUS_RESULT result1  = MESSAGE_BUS_ERROR;
 		if (handle != NULL && module != NULL)
@@ -147,6 +169,16 @@ public:
 		}
 	MOCK_METHOD_END(MESSAGE_BUS_RESULT, result1);
 
+	MOCK_STATIC_METHOD_2(, MESSAGE_BUS_RESULT, MessageBus_AddModule, MESSAGE_BUS_HANDLE, handle, const MODULE*, module)
+		currentMessageBus_AddModule_call++;
+		MESSAGE_BUS_RESULT result1 = MESSAGE_BUS_ERROR;
+		if (handle != NULL && module != NULL && whenShallMessageBus_AddModule_fail != currentMessageBus_AddModule_call)
+		{
+			++currentMessageBus_module_count;
+			result1 = MESSAGE_BUS_OK;
+		}
+	MOCK_METHOD_END(MESSAGE_BUS_RESULT, result1);
+
 	MOCK_STATIC_METHOD_2(, MESSAGE_BUS_RESULT, MessageBus_RemoveModule, MESSAGE_BUS_HANDLE, handle, MODULE_HANDLE, module)
 		currentMessageBus_RemoveModule_call++;
 		MESSAGE_BUS_RESULT result1 = MESSAGE_BUS_ERROR;
@@ -157,6 +189,37 @@ public:
 		}
 	MOCK_METHOD_END(MESSAGE_BUS_RESULT, result1);
 
+	MOCK_STATIC_METHOD_4(, MESSAGE_BUS_RESULT, MessageBus_RemoveModuleWithDrain, MESSAGE_BUS_HANDLE, handle, MODULE_HANDLE, module, unsigned int, drain_timeout_ms, MESSAGE_BUS_DRAIN_RESULT*, drain_result)
+		MESSAGE_BUS_RESULT result1 = MESSAGE_BUS_ERROR;
+		if (handle != NULL && module != NULL && currentMessageBus_module_count > 0)
+		{
+			--currentMessageBus_module_count;
+			drain_result->delivered = 1;
+			drain_result->dropped = 0;
+			result1 = MESSAGE_BUS_OK;
+		}
+	MOCK_METHOD_END(MESSAGE_BUS_RESULT, result1);
+
+	MOCK_STATIC_METHOD_2(, MESSAGE_BUS_RESULT, MessageBus_AddLink, MESSAGE_BUS_HANDLE, handle, const MESSAGE_BUS_LINK*, link)
+		currentMessageBus_AddLink_call++;
+		MESSAGE_BUS_RESULT result1 = (handle != NULL && link != NULL) ? MESSAGE_BUS_OK : MESSAGE_BUS_INVALIDARG;
+	MOCK_METHOD_END(MESSAGE_BUS_RESULT, result1);
+
+	MOCK_STATIC_METHOD_2(, MESSAGE_BUS_RESULT, MessageBus_RemoveLink, MESSAGE_BUS_HANDLE, handle, const MESSAGE_BUS_LINK*, link)
+		currentMessageBus_RemoveLink_call++;
+		MESSAGE_BUS_RESULT result1 = (handle != NULL && link != NULL) ? MESSAGE_BUS_OK : MESSAGE_BUS_INVALIDARG;
+	MOCK_METHOD_END(MESSAGE_BUS_RESULT, result1);
+
+	MOCK_STATIC_METHOD_3(, MESSAGE_BUS_RESULT, MessageBus_GetStatistics, MESSAGE_BUS_HANDLE, handle, MODULE_HANDLE, module, MESSAGE_BUS_MODULE_STATISTICS*, statistics)
+		MESSAGE_BUS_RESULT result1 = MESSAGE_BUS_INVALIDARG;
+		if (handle != NULL && module != NULL && statistics != NULL)
+		{
+			memset(statistics, 0, sizeof(*statistics));
+			statistics->enqueued = 42;
+			result1 = MESSAGE_BUS_OK;
+		}
+	MOCK_METHOD_END(MESSAGE_BUS_RESULT, result1);
+
 	MOCK_STATIC_METHOD_1(, MODULE_LIBRARY_HANDLE, ModuleLoader_Load, const char*, moduleLibraryFileName)
 		currentModuleLoader_Load_call++;
 		MODULE_LIBRARY_HANDLE handle = NULL;
@@ -170,6 +233,9 @@ public:
 		const MODULE_APIS* apis = &dummyAPIs;
 	MOCK_METHOD_END(const MODULE_APIS*, apis);
 
+	MOCK_STATIC_METHOD_1(, pfModule_ReceiveBatch, ModuleLoader_GetModuleReceiveBatch, MODULE_LIBRARY_HANDLE, module_library_handle)
+	MOCK_METHOD_END(pfModule_ReceiveBatch, NULL);
+
 	MOCK_STATIC_METHOD_1(, void, ModuleLoader_Unload, MODULE_LIBRARY_HANDLE, moduleLibraryHandle)
 		BASEIMPLEMENTATION::gballoc_free(moduleLibraryHandle);
 	MOCK_VOID_METHOD_END();
@@ -208,6 +274,10 @@ public:
 		auto element = BASEIMPLEMENTATION::VECTOR_front(handle);
 	MOCK_METHOD_END(void*, element);
 
+	MOCK_STATIC_METHOD_1(, void*, VECTOR_back, const VECTOR_HANDLE, handle)
+		auto element = BASEIMPLEMENTATION::VECTOR_back(handle);
+	MOCK_METHOD_END(void*, element);
+
 	MOCK_STATIC_METHOD_1(, size_t, VECTOR_size, const VECTOR_HANDLE, handle)
 		auto size = BASEIMPLEMENTATION::VECTOR_size(handle);
 	MOCK_METHOD_END(size_t, size);
@@ -221,6 +291,70 @@ public:
 		}
 	MOCK_METHOD_END(void*, element);
 
+	MOCK_STATIC_METHOD_2(, WORKER_POOL_HANDLE, WorkerPool_CreateWithThreadExit, size_t, thread_count, WORKER_POOL_THREAD_EXIT_FUNCTION, on_thread_exit)
+		currentWorkerPool_Create_call++;
+		WORKER_POOL_HANDLE pool = NULL;
+		if (whenShallWorkerPool_Create_fail != currentWorkerPool_Create_call)
+		{
+			currentWorkerPool_thread_count = thread_count;
+			currentWorkerPool_on_thread_exit = on_thread_exit;
+			pool = (WORKER_POOL_HANDLE)BASEIMPLEMENTATION::gballoc_malloc(1);
+		}
+	MOCK_METHOD_END(WORKER_POOL_HANDLE, pool);
+
+	MOCK_STATIC_METHOD_0(, void, MessagePool_ReleaseThreadCache)
+	MOCK_VOID_METHOD_END()
+
+	/*runs the task right away, as a pool whose threads are all idle would*/
+	MOCK_STATIC_METHOD_2(, WORKER_POOL_RESULT, WorkerPool_Schedule, WORKER_POOL_HANDLE, handle, WORKER_POOL_TASK*, task)
+		currentWorkerPool_Schedule_call++;
+		WORKER_POOL_RESULT result1 = WORKER_POOL_ERROR;
+		if (whenShallWorkerPool_Schedule_fail != currentWorkerPool_Schedule_call)
+		{
+			task->function(task->context);
+			result1 = WORKER_POOL_OK;
+		}
+	MOCK_METHOD_END(WORKER_POOL_RESULT, result1);
+
+	MOCK_STATIC_METHOD_1(, void, WorkerPool_Destroy, WORKER_POOL_HANDLE, handle)
+		currentWorkerPool_Destroy_call++;
+		BASEIMPLEMENTATION::gballoc_free(handle);
+	MOCK_VOID_METHOD_END();
+
+	MOCK_STATIC_METHOD_0(, LOCK_HANDLE, Lock_Init)
+		LOCK_HANDLE result1 = (LOCK_HANDLE)BASEIMPLEMENTATION::gballoc_malloc(1);
+	MOCK_METHOD_END(LOCK_HANDLE, result1);
+
+	MOCK_STATIC_METHOD_1(, LOCK_RESULT, Lock, LOCK_HANDLE, lock)
+		currentLock_call++;
+		auto result1 = (whenShallLock_fail == currentLock_call) ? LOCK_ERROR : LOCK_OK;
+	MOCK_METHOD_END(LOCK_RESULT, result1);
+
+	MOCK_STATIC_METHOD_1(, LOCK_RESULT, Unlock, LOCK_HANDLE, lock)
+		auto result1 = LOCK_OK;
+	MOCK_METHOD_END(LOCK_RESULT, result1);
+
+	MOCK_STATIC_METHOD_1(, LOCK_RESULT, Lock_Deinit, LOCK_HANDLE, lock)
+		BASEIMPLEMENTATION::gballoc_free(lock);
+		auto result1 = LOCK_OK;
+	MOCK_METHOD_END(LOCK_RESULT, result1);
+
+	MOCK_STATIC_METHOD_0(, COND_HANDLE, Condition_Init)
+		COND_HANDLE result1 = (COND_HANDLE)BASEIMPLEMENTATION::gballoc_malloc(1);
+	MOCK_METHOD_END(COND_HANDLE, result1);
+
+	MOCK_STATIC_METHOD_1(, COND_RESULT, Condition_Post, COND_HANDLE, handle)
+		auto result1 = COND_OK;
+	MOCK_METHOD_END(COND_RESULT, result1);
+
+	MOCK_STATIC_METHOD_3(, COND_RESULT, Condition_Wait, COND_HANDLE, handle, LOCK_HANDLE, lock, int, timeout_milliseconds)
+		auto result1 = COND_OK;
+	MOCK_METHOD_END(COND_RESULT, result1);
+
+	MOCK_STATIC_METHOD_1(, void, Condition_Deinit, COND_HANDLE, handle)
+		BASEIMPLEMENTATION::gballoc_free(handle);
+	MOCK_VOID_METHOD_END();
+
 	MOCK_STATIC_METHOD_1(, void*, gballoc_malloc, size_t, size)
 		void* result2;
 		currentmalloc_call++;
@@ -255,14 +389,21 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , void, mock_Module_Destroy, MODUL
 DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayLLMocks, , void, mock_Module_Receive, MODULE_HANDLE, moduleHandle, MESSAGE_HANDLE, messageHandle);
 
 DECLARE_GLOBAL_MOCK_METHOD_0(CGatewayLLMocks, , MESSAGE_BUS_HANDLE, MessageBus_Create);
+DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , MESSAGE_BUS_HANDLE, MessageBus_Create2, const MESSAGE_BUS_CONFIG*, config);
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , void, MessageBus_Destroy, MESSAGE_BUS_HANDLE, bus);
-DECLARE_GLOBAL_MOCK_METHOD_3(CGatewayLLMocks, , MESSAGE_BUS_RESULT, MessageBus_AddModule, MESSAGE_BUS_HANDLE, handle, MODULE_HANDLE, module, const MODULE_APIS*, module_apis);
+DECLARE_GLOBAL_MOCK_METHOD_5(CGatewayLLMocks, , MESSAGE_BUS_RESULT, MessageBus_AddModuleWithReceiveBatch, MESSAGE_BUS_HANDLE, handle, const MODULE*, module, const MESSAGE_BUS_FILTER*, filter, const MESSAGE_BUS_QUEUE_CONFIG*, queue_config, pfModule_ReceiveBatch, receive_batch);
+DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayLLMocks, , MESSAGE_BUS_RESULT, MessageBus_AddModule, MESSAGE_BUS_HANDLE, handle, const MODULE*, module);
 DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayLLMocks, , MESSAGE_BUS_RESULT, MessageBus_RemoveModule, MESSAGE_BUS_HANDLE, handle, MODULE_HANDLE, module);
+DECLARE_GLOBAL_MOCK_METHOD_4(CGatewayLLMocks, , MESSAGE_BUS_RESULT, MessageBus_RemoveModuleWithDrain, MESSAGE_BUS_HANDLE, handle, MODULE_HANDLE, module, unsigned int, drain_timeout_ms, MESSAGE_BUS_DRAIN_RESULT*, drain_result);
+DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayLLMocks, , MESSAGE_BUS_RESULT, MessageBus_AddLink, MESSAGE_BUS_HANDLE, handle, const MESSAGE_BUS_LINK*, link);
+DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayLLMocks, , MESSAGE_BUS_RESULT, MessageBus_RemoveLink, MESSAGE_BUS_HANDLE, handle, const MESSAGE_BUS_LINK*, link);
+DECLARE_GLOBAL_MOCK_METHOD_3(CGatewayLLMocks, , MESSAGE_BUS_RESULT, MessageBus_GetStatistics, MESSAGE_BUS_HANDLE, handle, MODULE_HANDLE, module, MESSAGE_BUS_MODULE_STATISTICS*, statistics);
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , void, MessageBus_IncRef, MESSAGE_BUS_HANDLE, bus);
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , void, MessageBus_DecRef, MESSAGE_BUS_HANDLE, bus);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , MODULE_LIBRARY_HANDLE, ModuleLoader_Load, const char*, moduleLibraryFileName);
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , const MODULE_APIS*, ModuleLoader_GetModuleAPIs, MODULE_LIBRARY_HANDLE, module_library_handle);
+DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , pfModule_ReceiveBatch, ModuleLoader_GetModuleReceiveBatch, MODULE_LIBRARY_HANDLE, module_library_handle);
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , void, ModuleLoader_Unload, MODULE_LIBRARY_HANDLE, moduleLibraryHandle);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , VECTOR_HANDLE, VECTOR_create, size_t, elementSize);
@@ -271,9 +412,24 @@ DECLARE_GLOBAL_MOCK_METHOD_3(CGatewayLLMocks, , int, VECTOR_push_back, VECTOR_HA
 DECLARE_GLOBAL_MOCK_METHOD_3(CGatewayLLMocks, , void, VECTOR_erase, VECTOR_HANDLE, handle, void*, elements, size_t, index);
 DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayLLMocks, , void*, VECTOR_element, const VECTOR_HANDLE, handle, size_t, index);
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , void*, VECTOR_front, const VECTOR_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , void*, VECTOR_back, const VECTOR_HANDLE, handle);
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , size_t, VECTOR_size, const VECTOR_HANDLE, handle);
 DECLARE_GLOBAL_MOCK_METHOD_3(CGatewayLLMocks, , void*, VECTOR_find_if, const VECTOR_HANDLE, handle, PREDICATE_FUNCTION, pred, const void*, value);
 
+DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayLLMocks, , WORKER_POOL_HANDLE, WorkerPool_CreateWithThreadExit, size_t, thread_count, WORKER_POOL_THREAD_EXIT_FUNCTION, on_thread_exit);
+DECLARE_GLOBAL_MOCK_METHOD_0(CGatewayLLMocks, , void, MessagePool_ReleaseThreadCache);
+DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayLLMocks, , WORKER_POOL_RESULT, WorkerPool_Schedule, WORKER_POOL_HANDLE, handle, WORKER_POOL_TASK*, task);
+DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , void, WorkerPool_Destroy, WORKER_POOL_HANDLE, handle);
+
+DECLARE_GLOBAL_MOCK_METHOD_0(CGatewayLLMocks, , LOCK_HANDLE, Lock_Init);
+DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , LOCK_RESULT, Lock, LOCK_HANDLE, lock);
+DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , LOCK_RESULT, Unlock, LOCK_HANDLE, lock);
+DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , LOCK_RESULT, Lock_Deinit, LOCK_HANDLE, lock);
+
+DECLARE_GLOBAL_MOCK_METHOD_0(CGatewayLLMocks, , COND_HANDLE, Condition_Init);
+DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , COND_RESULT, Condition_Post, COND_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_3(CGatewayLLMocks, , COND_RESULT, Condition_Wait, COND_HANDLE, handle, LOCK_HANDLE, lock, int, timeout_milliseconds);
+DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , void, Condition_Deinit, COND_HANDLE, handle);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , void*, gballoc_malloc, size_t, size);
 DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayLLMocks, , void*, gballoc_realloc, void*, ptr, size_t, size);
@@ -284,6 +440,28 @@ static MICROMOCK_MUTEX_HANDLE g_testByTest;
 
 static GATEWAY_PROPERTIES* dummyProps;
 
+static size_t startup_times_callback_count;
+static const char* startup_times_callback_names[4];
+
+static void record_startup_times(const char* module_name, MODULE_HANDLE module, const GATEWAY_MODULE_STARTUP_TIMES* times, void* context)
+{
+	(void)module;
+	(void)times;
+	(void)context;
+	if (startup_times_callback_count < sizeof(startup_times_callback_names) / sizeof(startup_times_callback_names[0]))
+	{
+		startup_times_callback_names[startup_times_callback_count] = module_name;
+	}
+	startup_times_callback_count++;
+}
+
+static VECTOR_HANDLE create_depends_on(const char* module_name)
+{
+	VECTOR_HANDLE depends_on = BASEIMPLEMENTATION::VECTOR_create(sizeof(const char*));
+	(void)BASEIMPLEMENTATION::VECTOR_push_back(depends_on, &module_name, 1);
+	return depends_on;
+}
+
 BEGIN_TEST_SUITE(gateway_ll_unittests)
 
 TEST_SUITE_INITIALIZE(TestClassInitialize)
@@ -330,6 +508,18 @@ TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
 	currentVECTOR_find_if_call = 0;
 	whenShallVECTOR_find_if_fail = 0;
 
+	currentWorkerPool_Create_call = 0;
+	whenShallWorkerPool_Create_fail = 0;
+	currentWorkerPool_thread_count = 0;
+	currentWorkerPool_on_thread_exit = NULL;
+	currentWorkerPool_Schedule_call = 0;
+	whenShallWorkerPool_Schedule_fail = 0;
+	currentWorkerPool_Destroy_call = 0;
+	currentMessageBus_AddLink_call = 0;
+	currentMessageBus_RemoveLink_call = 0;
+	currentLock_call = 0;
+	whenShallLock_fail = 0;
+
 	dummyAPIs = {
 		mock_Module_Create,
 		mock_Module_Destroy,
@@ -345,6 +535,12 @@ TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
 	dummyProps = (GATEWAY_PROPERTIES*)malloc(sizeof(GATEWAY_PROPERTIES));
 	dummyProps->gateway_properties_entries = BASEIMPLEMENTATION::VECTOR_create(sizeof(GATEWAY_PROPERTIES_ENTRY));
 	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry, 1);
+	dummyProps->gateway_links = NULL;
+	dummyProps->bus_config.use_worker_pool = false;
+	dummyProps->bus_config.worker_count = 0;
+	dummyProps->bus_config.routing = MESSAGE_BUS_ROUTING_AUTOMATIC;
+	dummyProps->startup_config.parallel = false;
+	dummyProps->startup_config.thread_count = 0;
 }
 
 TEST_FUNCTION_CLEANUP(TestMethodCleanup)
@@ -389,6 +585,66 @@ TEST_FUNCTION(Gateway_LL_Create_Creates_Handle_Success)
 	Gateway_LL_Destroy(gateway);
 }
 
+/*Tests_SRS_GATEWAY_LL_13_011: [If properties is not NULL and its bus_config asks for a worker pool or a routing other than MESSAGE_BUS_ROUTING_AUTOMATIC, the function shall create the message bus by calling MessageBus_Create2 with it.]*/
+TEST_FUNCTION(Gateway_LL_Create_Creates_MessageBus_With_Worker_Pool_Success)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+	GATEWAY_PROPERTIES properties = { 0 };
+	properties.bus_config.use_worker_pool = true;
+	properties.bus_config.worker_count = 2;
+
+	//Expectations
+	STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_Create2(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG))
+		.IgnoreArgument(1);
+
+	//Act
+	GATEWAY_HANDLE gateway = Gateway_LL_Create(&properties);
+
+	//Assert
+	ASSERT_IS_NOT_NULL(gateway);
+	ASSERT_IS_TRUE(lastMessageBus_Create2_config.use_worker_pool);
+	ASSERT_ARE_EQUAL(size_t, 2, lastMessageBus_Create2_config.worker_count);
+	mocks.AssertActualAndExpectedCalls();
+
+	//Cleanup
+	Gateway_LL_Destroy(gateway);
+}
+
+/*Tests_SRS_GATEWAY_LL_13_046: [If properties's gateway_links is not NULL and its bus_config routing is MESSAGE_BUS_ROUTING_AUTOMATIC, the function shall create a bus with MESSAGE_BUS_ROUTING_LINKS routing, so that the gateway keeps following its links when it has none left.]*/
+TEST_FUNCTION(Gateway_LL_Create_With_Links_Creates_MessageBus_Routing_Along_Links)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+	GATEWAY_PROPERTIES properties = { 0 };
+	properties.gateway_links = BASEIMPLEMENTATION::VECTOR_create(sizeof(GATEWAY_LINK_ENTRY));
+
+	//Expectations
+	STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_Create2(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(properties.gateway_links));
+
+	//Act
+	GATEWAY_HANDLE gateway = Gateway_LL_Create(&properties);
+
+	//Assert
+	ASSERT_IS_NOT_NULL(gateway);
+	ASSERT_ARE_EQUAL(int, (int)MESSAGE_BUS_ROUTING_LINKS, (int)lastMessageBus_Create2_config.routing);
+	mocks.AssertActualAndExpectedCalls();
+
+	//Cleanup
+	Gateway_LL_Destroy(gateway);
+	BASEIMPLEMENTATION::VECTOR_destroy(properties.gateway_links);
+}
+
 /*Tests_SRS_GATEWAY_LL_14_002: [This function shall return NULL upon any memory allocation failure.]*/
 TEST_FUNCTION(Gateway_LL_Create_Creates_Handle_Malloc_Failure)
 {
@@ -467,6 +723,7 @@ TEST_FUNCTION(Gateway_LL_Create_VECTOR_Create_Fails)
 	//Nothing to cleanup
 }
 
+/*Tests_SRS_GATEWAY_LL_13_028: [Before destroying the GATEWAY_HANDLE the function shall remove the modules already added in the reverse order they were added.]*/
 TEST_FUNCTION(Gateway_LL_Create_VECTOR_push_back_Fails_To_Add_All_Modules_In_Props)
 {
 	//Arrange
@@ -489,17 +746,24 @@ TEST_FUNCTION(Gateway_LL_Create_VECTOR_push_back_Fails_To_Add_All_Modules_In_Pro
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, VECTOR_size(dummyProps->gateway_properties_entries));
 
+	//Looking for dependencies
+	STRICT_EXPECTED_CALL(mocks, VECTOR_element(dummyProps->gateway_properties_entries, 0));
+	STRICT_EXPECTED_CALL(mocks, VECTOR_element(dummyProps->gateway_properties_entries, 1));
+
 	//Adding module 1 (Success)
 	STRICT_EXPECTED_CALL(mocks, VECTOR_element(dummyProps->gateway_properties_entries, 0));
 	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Load(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleReceiveBatch(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, mock_Module_Create(IGNORED_PTR_ARG, NULL))
 		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_AddModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG, &dummyAPIs))
+	STRICT_EXPECTED_CALL(mocks, MessageBus_AddModuleWithReceiveBatch(IGNORED_PTR_ARG, IGNORED_PTR_ARG, NULL, IGNORED_PTR_ARG, NULL))
 		.IgnoreArgument(1)
-		.IgnoreArgument(2);
+		.IgnoreArgument(2)
+		.IgnoreArgument(4);
 	STRICT_EXPECTED_CALL(mocks, MessageBus_IncRef(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
@@ -512,11 +776,14 @@ TEST_FUNCTION(Gateway_LL_Create_VECTOR_push_back_Fails_To_Add_All_Modules_In_Pro
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleReceiveBatch(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, mock_Module_Create(IGNORED_PTR_ARG, NULL))
 		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_AddModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG, &dummyAPIs))
+	STRICT_EXPECTED_CALL(mocks, MessageBus_AddModuleWithReceiveBatch(IGNORED_PTR_ARG, IGNORED_PTR_ARG, NULL, IGNORED_PTR_ARG, NULL))
 		.IgnoreArgument(1)
-		.IgnoreArgument(2);
+		.IgnoreArgument(2)
+		.IgnoreArgument(4);
 	STRICT_EXPECTED_CALL(mocks, MessageBus_IncRef(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
 	whenShallVECTOR_push_back_fail = 2;
@@ -536,7 +803,7 @@ TEST_FUNCTION(Gateway_LL_Create_VECTOR_push_back_Fails_To_Add_All_Modules_In_Pro
 	//Removing previous module
 	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, VECTOR_front(IGNORED_PTR_ARG))
+	STRICT_EXPECTED_CALL(mocks, VECTOR_back(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, MessageBus_RemoveModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 		.IgnoreArgument(1)
@@ -595,17 +862,24 @@ TEST_FUNCTION(Gateway_LL_Create_MessageBus_AddModule_Fails_To_Add_All_Modules_In
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, VECTOR_size(dummyProps->gateway_properties_entries));
 
+	//Looking for dependencies
+	STRICT_EXPECTED_CALL(mocks, VECTOR_element(dummyProps->gateway_properties_entries, 0));
+	STRICT_EXPECTED_CALL(mocks, VECTOR_element(dummyProps->gateway_properties_entries, 1));
+
 	//Adding module 1 (Success)
 	STRICT_EXPECTED_CALL(mocks, VECTOR_element(dummyProps->gateway_properties_entries, 0));
 	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Load(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleReceiveBatch(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, mock_Module_Create(IGNORED_PTR_ARG, NULL))
 		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_AddModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG, &dummyAPIs))
+	STRICT_EXPECTED_CALL(mocks, MessageBus_AddModuleWithReceiveBatch(IGNORED_PTR_ARG, IGNORED_PTR_ARG, NULL, IGNORED_PTR_ARG, NULL))
 		.IgnoreArgument(1)
-		.IgnoreArgument(2);
+		.IgnoreArgument(2)
+		.IgnoreArgument(4);
 	STRICT_EXPECTED_CALL(mocks, MessageBus_IncRef(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
@@ -618,12 +892,15 @@ TEST_FUNCTION(Gateway_LL_Create_MessageBus_AddModule_Fails_To_Add_All_Modules_In
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleReceiveBatch(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, mock_Module_Create(IGNORED_PTR_ARG, NULL))
 		.IgnoreArgument(1);
 	whenShallMessageBus_AddModule_fail = 2;
-	STRICT_EXPECTED_CALL(mocks, MessageBus_AddModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG, &dummyAPIs))
+	STRICT_EXPECTED_CALL(mocks, MessageBus_AddModuleWithReceiveBatch(IGNORED_PTR_ARG, IGNORED_PTR_ARG, NULL, IGNORED_PTR_ARG, NULL))
 		.IgnoreArgument(1)
-		.IgnoreArgument(2);
+		.IgnoreArgument(2)
+		.IgnoreArgument(4);
 	STRICT_EXPECTED_CALL(mocks, mock_Module_Destroy(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
@@ -632,7 +909,7 @@ TEST_FUNCTION(Gateway_LL_Create_MessageBus_AddModule_Fails_To_Add_All_Modules_In
 	//Removing previous module
 	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, VECTOR_front(IGNORED_PTR_ARG))
+	STRICT_EXPECTED_CALL(mocks, VECTOR_back(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, MessageBus_RemoveModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 		.IgnoreArgument(1)
@@ -691,17 +968,24 @@ TEST_FUNCTION(Gateway_LL_Create_Adds_All_Modules_In_Props_Success)
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, VECTOR_size(dummyProps->gateway_properties_entries));
 
+	//Looking for dependencies
+	STRICT_EXPECTED_CALL(mocks, VECTOR_element(dummyProps->gateway_properties_entries, 0));
+	STRICT_EXPECTED_CALL(mocks, VECTOR_element(dummyProps->gateway_properties_entries, 1));
+
 	//Adding module 1 (Failure)
 	STRICT_EXPECTED_CALL(mocks, VECTOR_element(dummyProps->gateway_properties_entries, 0));
 	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Load(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleReceiveBatch(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, mock_Module_Create(IGNORED_PTR_ARG, NULL))
 		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_AddModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG, &dummyAPIs))
+	STRICT_EXPECTED_CALL(mocks, MessageBus_AddModuleWithReceiveBatch(IGNORED_PTR_ARG, IGNORED_PTR_ARG, NULL, IGNORED_PTR_ARG, NULL))
 		.IgnoreArgument(1)
-		.IgnoreArgument(2);
+		.IgnoreArgument(2)
+		.IgnoreArgument(4);
 	STRICT_EXPECTED_CALL(mocks, MessageBus_IncRef(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
@@ -714,11 +998,14 @@ TEST_FUNCTION(Gateway_LL_Create_Adds_All_Modules_In_Props_Success)
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleReceiveBatch(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, mock_Module_Create(IGNORED_PTR_ARG, NULL))
 		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_AddModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG, &dummyAPIs))
+	STRICT_EXPECTED_CALL(mocks, MessageBus_AddModuleWithReceiveBatch(IGNORED_PTR_ARG, IGNORED_PTR_ARG, NULL, IGNORED_PTR_ARG, NULL))
 		.IgnoreArgument(1)
-		.IgnoreArgument(2);
+		.IgnoreArgument(2)
+		.IgnoreArgument(4);
 	STRICT_EXPECTED_CALL(mocks, MessageBus_IncRef(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
@@ -737,28 +1024,52 @@ TEST_FUNCTION(Gateway_LL_Create_Adds_All_Modules_In_Props_Success)
 	Gateway_LL_Destroy(gateway);
 }
 
-/*Tests_SRS_GATEWAY_LL_14_005: [ If gw is NULL the function shall do nothing. ]*/
-TEST_FUNCTION(Gateway_LL_Destroy_Does_Nothing_If_NULL)
+/*Tests_SRS_GATEWAY_LL_13_017: [If properties's startup_config asks for a parallel startup and there is more than one entry, the function shall load and create the modules of the entries concurrently on a worker pool of startup_config's thread_count threads, one thread per entry when it is 0 or more than the number of entries.]*/
+/*Tests_SRS_GATEWAY_LL_13_018: [The function shall wait for every module of a level to be loaded and created before adding any of them to the bus.]*/
+/*Tests_SRS_GATEWAY_LL_13_019: [The function shall add the created modules of a level to the bus and to GATEWAY_HANDLE_DATA's modules in the order of their entries, as Gateway_LL_AddModule does.]*/
+/*Tests_SRS_GATEWAY_LL_13_050: [The function shall create the worker pool by calling WorkerPool_CreateWithThreadExit with MessagePool_ReleaseThreadCache, so that the message blocks cached by its threads are not lost.]*/
+TEST_FUNCTION(Gateway_LL_Create_Starts_Modules_On_Worker_Pool_Success)
 {
 	//Arrange
 	CGatewayLLMocks mocks;
 
-	GATEWAY_HANDLE gateway = NULL;
+	GATEWAY_PROPERTIES_ENTRY dummyEntry2 = {
+		"dummy module 2",
+		"x2.dll",
+		NULL
+	};
+
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry2, 1);
+	dummyProps->startup_config.parallel = true;
+	startup_times_callback_count = 0;
 
 	//Act
-	Gateway_LL_Destroy(gateway);
+	GATEWAY_HANDLE gateway = Gateway_LL_Create(dummyProps);
 
 	//Assert
-	mocks.AssertActualAndExpectedCalls();
+	ASSERT_IS_NOT_NULL(gateway);
+	ASSERT_ARE_EQUAL(size_t, 1, currentWorkerPool_Create_call);
+	ASSERT_ARE_EQUAL(size_t, 2, currentWorkerPool_thread_count);
+	ASSERT_IS_TRUE(currentWorkerPool_on_thread_exit == MessagePool_ReleaseThreadCache);
+	ASSERT_ARE_EQUAL(size_t, 2, currentWorkerPool_Schedule_call);
+	ASSERT_ARE_EQUAL(size_t, 2, currentModule_Create_call);
+	ASSERT_ARE_EQUAL(size_t, 2, currentMessageBus_module_count);
+	ASSERT_ARE_EQUAL(int, 0, Gateway_LL_GetStartupTimes(gateway, record_startup_times, NULL));
+	ASSERT_ARE_EQUAL(size_t, 2, startup_times_callback_count);
+	ASSERT_ARE_EQUAL(char_ptr, "dummy module", startup_times_callback_names[0]);
+	ASSERT_ARE_EQUAL(char_ptr, "dummy module 2", startup_times_callback_names[1]);
+
+	//Cleanup
+	Gateway_LL_Destroy(gateway);
 }
 
-/*Tests_SRS_GATEWAY_LL_14_037: [ If GATEWAY_HANDLE_DATA's message bus cannot unlink module, the function shall log the error and continue unloading the module from the GATEWAY_HANDLE. ]*/
-TEST_FUNCTION(Gateway_LL_Destroy_Continues_Unloading_If_MessageBus_RemoveModule_Fails)
+/*Tests_SRS_GATEWAY_LL_13_048: [If locking or waiting for the modules of a level fails, the function shall destroy the worker pool, so that no task is running any more, and fail without adding any module of the level.]*/
+/*Tests_SRS_GATEWAY_LL_13_020: [If any module cannot be loaded, created or added to the bus, the function shall destroy the modules that were created but not added in the reverse order of their entries, then destroy the GATEWAY_HANDLE.]*/
+TEST_FUNCTION(Gateway_LL_Create_Fails_And_Destroys_The_Worker_Pool_If_Waiting_For_A_Level_Fails)
 {
 	//Arrange
 	CGatewayLLMocks mocks;
 
-	//Add another entry to the properties
 	GATEWAY_PROPERTIES_ENTRY dummyEntry2 = {
 		"dummy module 2",
 		"x2.dll",
@@ -766,74 +1077,58 @@ TEST_FUNCTION(Gateway_LL_Destroy_Continues_Unloading_If_MessageBus_RemoveModule_
 	};
 
 	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry2, 1);
+	dummyProps->startup_config.parallel = true;
+	/*each task locks once, the third lock is the wait for the level*/
+	whenShallLock_fail = 3;
 
+	//Act
 	GATEWAY_HANDLE gateway = Gateway_LL_Create(dummyProps);
-	mocks.ResetAllCalls();
 
-	//Expectations
-	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, VECTOR_front(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	whenShallMessageBus_RemoveModule_fail = 1;
-	STRICT_EXPECTED_CALL(mocks, MessageBus_RemoveModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-		.IgnoreArgument(1)
-		.IgnoreArgument(2);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_DecRef(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, mock_Module_Destroy(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, VECTOR_erase(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-		.IgnoreArgument(1)
-		.IgnoreArgument(2);
+	//Assert
+	ASSERT_IS_NULL(gateway);
+	ASSERT_ARE_EQUAL(size_t, 2, currentModule_Create_call);
+	ASSERT_ARE_EQUAL(size_t, 2, currentModule_Destroy_call);
+	ASSERT_ARE_EQUAL(size_t, 0, currentMessageBus_AddModule_call);
+	ASSERT_ARE_EQUAL(size_t, 1, currentWorkerPool_Destroy_call);
 
-	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, VECTOR_front(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_RemoveModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-		.IgnoreArgument(1)
-		.IgnoreArgument(2);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_DecRef(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, mock_Module_Destroy(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, VECTOR_erase(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-		.IgnoreArgument(1)
-		.IgnoreArgument(2);
+	//Cleanup
+}
 
-	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_Destroy(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
+/*Tests_SRS_GATEWAY_LL_13_051: [If a task cannot lock, it shall still count its module as started and signal the condition, so that the wait for the level does not hang.]*/
+TEST_FUNCTION(Gateway_LL_Create_Adds_The_Modules_If_A_Task_Cannot_Lock)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	GATEWAY_PROPERTIES_ENTRY dummyEntry2 = {
+		"dummy module 2",
+		"x2.dll",
+		NULL
+	};
+
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry2, 1);
+	dummyProps->startup_config.parallel = true;
+	/*each task locks once, the first one cannot*/
+	whenShallLock_fail = 1;
 
 	//Act
-	Gateway_LL_Destroy(gateway);
+	GATEWAY_HANDLE gateway = Gateway_LL_Create(dummyProps);
 
 	//Assert
-	mocks.AssertActualAndExpectedCalls();
+	ASSERT_IS_NOT_NULL(gateway);
+	ASSERT_ARE_EQUAL(size_t, 2, currentModule_Create_call);
+	ASSERT_ARE_EQUAL(size_t, 2, currentMessageBus_module_count);
+
+	//Cleanup
+	Gateway_LL_Destroy(gateway);
 }
 
-/*Tests_SRS_GATEWAY_LL_14_028: [ The function shall remove each module in GATEWAY_HANDLE_DATA's modules vector and destroy GATEWAY_HANDLE_DATA's modules. ]*/
-/*Tests_SRS_GATEWAY_LL_14_006: [ The function shall destroy the GATEWAY_HANDLE_DATA's bus MESSAGE_BUS_HANDLE. ]*/
-TEST_FUNCTION(Gateway_LL_Destroy_Removes_All_Modules_And_Destroys_Vector_Success)
+/*Tests_SRS_GATEWAY_LL_13_017: [If properties's startup_config asks for a parallel startup and there is more than one entry, the function shall load and create the modules of the entries concurrently on a worker pool of startup_config's thread_count threads, one thread per entry when it is 0 or more than the number of entries.]*/
+TEST_FUNCTION(Gateway_LL_Create_Starts_Modules_On_Worker_Pool_Of_Thread_Count_Threads)
 {
 	//Arrange
 	CGatewayLLMocks mocks;
 
-	//Add another entry to the properties
 	GATEWAY_PROPERTIES_ENTRY dummyEntry2 = {
 		"dummy module 2",
 		"x2.dll",
@@ -841,502 +1136,1484 @@ TEST_FUNCTION(Gateway_LL_Destroy_Removes_All_Modules_And_Destroys_Vector_Success
 	};
 
 	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry2, 1);
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry2, 1);
+	dummyProps->startup_config.parallel = true;
+	dummyProps->startup_config.thread_count = 2;
 
+	//Act
 	GATEWAY_HANDLE gateway = Gateway_LL_Create(dummyProps);
-	mocks.ResetAllCalls();
 
-	//Gateway_LL_Destroy Expectations
-	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, VECTOR_front(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_RemoveModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-		.IgnoreArgument(1)
-		.IgnoreArgument(2);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_DecRef(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, mock_Module_Destroy(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, VECTOR_erase(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-		.IgnoreArgument(1)
-		.IgnoreArgument(2);
+	//Assert
+	ASSERT_IS_NOT_NULL(gateway);
+	ASSERT_ARE_EQUAL(size_t, 2, currentWorkerPool_thread_count);
+	ASSERT_ARE_EQUAL(size_t, 3, currentWorkerPool_Schedule_call);
+	ASSERT_ARE_EQUAL(size_t, 3, currentMessageBus_module_count);
 
-	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, VECTOR_front(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_RemoveModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-		.IgnoreArgument(1)
-		.IgnoreArgument(2);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_DecRef(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
+	//Cleanup
+	Gateway_LL_Destroy(gateway);
+}
+
+/*Tests_SRS_GATEWAY_LL_13_017: [If properties's startup_config asks for a parallel startup and there is more than one entry, the function shall load and create the modules of the entries concurrently on a worker pool of startup_config's thread_count threads, one thread per entry when it is 0 or more than the number of entries.]*/
+TEST_FUNCTION(Gateway_LL_Create_Starts_A_Single_Module_Without_Worker_Pool)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+	dummyProps->startup_config.parallel = true;
+
+	//Act
+	GATEWAY_HANDLE gateway = Gateway_LL_Create(dummyProps);
+
+	//Assert
+	ASSERT_IS_NOT_NULL(gateway);
+	ASSERT_ARE_EQUAL(size_t, 0, currentWorkerPool_Create_call);
+	ASSERT_ARE_EQUAL(size_t, 1, currentMessageBus_module_count);
+
+	//Cleanup
+	Gateway_LL_Destroy(gateway);
+}
+
+/*Tests_SRS_GATEWAY_LL_13_021: [If the worker pool, its lock or its condition cannot be created, the function shall load, create and add the modules one after another instead.]*/
+TEST_FUNCTION(Gateway_LL_Create_Starts_Modules_One_After_Another_If_WorkerPool_Create_Fails)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	GATEWAY_PROPERTIES_ENTRY dummyEntry2 = {
+		"dummy module 2",
+		"x2.dll",
+		NULL
+	};
+
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry2, 1);
+	dummyProps->startup_config.parallel = true;
+	whenShallWorkerPool_Create_fail = 1;
+
+	//Act
+	GATEWAY_HANDLE gateway = Gateway_LL_Create(dummyProps);
+
+	//Assert
+	ASSERT_IS_NOT_NULL(gateway);
+	ASSERT_ARE_EQUAL(size_t, 0, currentWorkerPool_Schedule_call);
+	ASSERT_ARE_EQUAL(size_t, 2, currentModule_Create_call);
+	ASSERT_ARE_EQUAL(size_t, 2, currentMessageBus_module_count);
+
+	//Cleanup
+	Gateway_LL_Destroy(gateway);
+}
+
+/*Tests_SRS_GATEWAY_LL_13_022: [If a module cannot be scheduled on the worker pool, the function shall load and create it on the calling thread.]*/
+TEST_FUNCTION(Gateway_LL_Create_Starts_Module_On_Calling_Thread_If_WorkerPool_Schedule_Fails)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	GATEWAY_PROPERTIES_ENTRY dummyEntry2 = {
+		"dummy module 2",
+		"x2.dll",
+		NULL
+	};
+
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry2, 1);
+	dummyProps->startup_config.parallel = true;
+	whenShallWorkerPool_Schedule_fail = 2;
+
+	//Act
+	GATEWAY_HANDLE gateway = Gateway_LL_Create(dummyProps);
+
+	//Assert
+	ASSERT_IS_NOT_NULL(gateway);
+	ASSERT_ARE_EQUAL(size_t, 2, currentModule_Create_call);
+	ASSERT_ARE_EQUAL(size_t, 2, currentMessageBus_module_count);
+
+	//Cleanup
+	Gateway_LL_Destroy(gateway);
+}
+
+/*Tests_SRS_GATEWAY_LL_13_020: [If any module cannot be loaded, created or added to the bus, the function shall destroy the modules that were created but not added in the reverse order of their entries, then destroy the GATEWAY_HANDLE.]*/
+TEST_FUNCTION(Gateway_LL_Create_Destroys_Started_Modules_If_A_Module_Create_Fails_On_Worker_Pool)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	bool fail_create = false;
+	GATEWAY_PROPERTIES_ENTRY dummyEntry2 = {
+		"dummy module 2",
+		"x2.dll",
+		&fail_create
+	};
+	GATEWAY_PROPERTIES_ENTRY dummyEntry3 = {
+		"dummy module 3",
+		"x3.dll",
+		NULL
+	};
+
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry2, 1);
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry3, 1);
+	dummyProps->startup_config.parallel = true;
+
+	//Act
+	GATEWAY_HANDLE gateway = Gateway_LL_Create(dummyProps);
+
+	//Assert
+	ASSERT_IS_NULL(gateway);
+	ASSERT_ARE_EQUAL(size_t, 3, currentModule_Create_call);
+	ASSERT_ARE_EQUAL(size_t, 2, currentModule_Destroy_call);
+	ASSERT_ARE_EQUAL(size_t, 0, currentMessageBus_module_count);
+	ASSERT_ARE_EQUAL(size_t, 0, currentMessageBus_ref_count);
+}
+
+/*Tests_SRS_GATEWAY_LL_13_020: [If any module cannot be loaded, created or added to the bus, the function shall destroy the modules that were created but not added in the reverse order of their entries, then destroy the GATEWAY_HANDLE.]*/
+TEST_FUNCTION(Gateway_LL_Create_Destroys_Started_Modules_If_A_Module_Cannot_Be_Added_After_Worker_Pool)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	GATEWAY_PROPERTIES_ENTRY dummyEntry2 = {
+		"dummy module 2",
+		"x2.dll",
+		NULL
+	};
+
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry2, 1);
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry2, 1);
+	dummyProps->startup_config.parallel = true;
+	whenShallMessageBus_AddModule_fail = 2;
+
+	//Act
+	GATEWAY_HANDLE gateway = Gateway_LL_Create(dummyProps);
+
+	//Assert
+	ASSERT_IS_NULL(gateway);
+	ASSERT_ARE_EQUAL(size_t, 3, currentModule_Create_call);
+	ASSERT_ARE_EQUAL(size_t, 3, currentModule_Destroy_call);
+	ASSERT_ARE_EQUAL(size_t, 0, currentMessageBus_module_count);
+	ASSERT_ARE_EQUAL(size_t, 0, currentMessageBus_ref_count);
+}
+
+/*Tests_SRS_GATEWAY_LL_13_026: [If an entry depends on other modules, the function shall start the modules level by level, a module's level being one above the highest level of the modules it depends on, and add every module of a level to the bus before creating those of the next level.]*/
+TEST_FUNCTION(Gateway_LL_Create_Starts_Modules_After_The_Modules_They_Depend_On)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	GATEWAY_PROPERTIES_ENTRY dummyEntry2 = {
+		"dummy module 2",
+		"x2.dll",
+		NULL
+	};
+
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry2, 1);
+	GATEWAY_PROPERTIES_ENTRY* dummyEntry = (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries);
+	dummyEntry->depends_on = create_depends_on("dummy module 2");
+	startup_times_callback_count = 0;
+
+	//Act
+	GATEWAY_HANDLE gateway = Gateway_LL_Create(dummyProps);
+
+	//Assert
+	ASSERT_IS_NOT_NULL(gateway);
+	ASSERT_ARE_EQUAL(size_t, 0, currentWorkerPool_Create_call);
+	ASSERT_ARE_EQUAL(size_t, 2, currentModule_Create_call);
+	ASSERT_ARE_EQUAL(size_t, 2, currentMessageBus_module_count);
+	ASSERT_ARE_EQUAL(int, 0, Gateway_LL_GetStartupTimes(gateway, record_startup_times, NULL));
+	ASSERT_ARE_EQUAL(size_t, 2, startup_times_callback_count);
+	ASSERT_ARE_EQUAL(char_ptr, "dummy module 2", startup_times_callback_names[0]);
+	ASSERT_ARE_EQUAL(char_ptr, "dummy module", startup_times_callback_names[1]);
+
+	//Cleanup
+	Gateway_LL_Destroy(gateway);
+	BASEIMPLEMENTATION::VECTOR_destroy(dummyEntry->depends_on);
+}
+
+/*Tests_SRS_GATEWAY_LL_13_026: [If an entry depends on other modules, the function shall start the modules level by level, a module's level being one above the highest level of the modules it depends on, and add every module of a level to the bus before creating those of the next level.]*/
+/*Tests_SRS_GATEWAY_LL_13_018: [The function shall wait for every module of a level to be loaded and created before adding any of them to the bus.]*/
+TEST_FUNCTION(Gateway_LL_Create_Starts_Each_Level_Of_Modules_On_Worker_Pool)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	GATEWAY_PROPERTIES_ENTRY dummyEntry2 = {
+		"dummy module 2",
+		"x2.dll",
+		NULL
+	};
+	GATEWAY_PROPERTIES_ENTRY dummyEntry3 = {
+		"dummy module 3",
+		"x3.dll",
+		NULL
+	};
+
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry2, 1);
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry3, 1);
+	GATEWAY_PROPERTIES_ENTRY* dummyEntry = (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries);
+	dummyEntry->depends_on = create_depends_on("dummy module 3");
+	dummyProps->startup_config.parallel = true;
+	startup_times_callback_count = 0;
+
+	//Act
+	GATEWAY_HANDLE gateway = Gateway_LL_Create(dummyProps);
+
+	//Assert
+	ASSERT_IS_NOT_NULL(gateway);
+	ASSERT_ARE_EQUAL(size_t, 1, currentWorkerPool_Create_call);
+	ASSERT_ARE_EQUAL(size_t, 3, currentWorkerPool_Schedule_call);
+	ASSERT_ARE_EQUAL(size_t, 3, currentMessageBus_module_count);
+	ASSERT_ARE_EQUAL(int, 0, Gateway_LL_GetStartupTimes(gateway, record_startup_times, NULL));
+	ASSERT_ARE_EQUAL(size_t, 3, startup_times_callback_count);
+	ASSERT_ARE_EQUAL(char_ptr, "dummy module 2", startup_times_callback_names[0]);
+	ASSERT_ARE_EQUAL(char_ptr, "dummy module 3", startup_times_callback_names[1]);
+	ASSERT_ARE_EQUAL(char_ptr, "dummy module", startup_times_callback_names[2]);
+
+	//Cleanup
+	Gateway_LL_Destroy(gateway);
+	BASEIMPLEMENTATION::VECTOR_destroy(dummyEntry->depends_on);
+}
+
+/*Tests_SRS_GATEWAY_LL_13_027: [If an entry depends on a name that is not the module_name of an entry, or the dependencies of the entries have a cycle, the function shall destroy the GATEWAY_HANDLE without starting any module.]*/
+TEST_FUNCTION(Gateway_LL_Create_Fails_If_A_Module_Depends_On_An_Unknown_Module)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	GATEWAY_PROPERTIES_ENTRY* dummyEntry = (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries);
+	dummyEntry->depends_on = create_depends_on("no such module");
+
+	//Act
+	GATEWAY_HANDLE gateway = Gateway_LL_Create(dummyProps);
+
+	//Assert
+	ASSERT_IS_NULL(gateway);
+	ASSERT_ARE_EQUAL(size_t, 0, currentModule_Create_call);
+	ASSERT_ARE_EQUAL(size_t, 0, currentMessageBus_ref_count);
+
+	//Cleanup
+	BASEIMPLEMENTATION::VECTOR_destroy(dummyEntry->depends_on);
+}
+
+/*Tests_SRS_GATEWAY_LL_13_027: [If an entry depends on a name that is not the module_name of an entry, or the dependencies of the entries have a cycle, the function shall destroy the GATEWAY_HANDLE without starting any module.]*/
+TEST_FUNCTION(Gateway_LL_Create_Fails_If_Modules_Depend_On_Each_Other)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	GATEWAY_PROPERTIES_ENTRY dummyEntry2 = {
+		"dummy module 2",
+		"x2.dll",
+		NULL
+	};
+
+	dummyEntry2.depends_on = create_depends_on("dummy module");
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry2, 1);
+	GATEWAY_PROPERTIES_ENTRY* dummyEntry = (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries);
+	dummyEntry->depends_on = create_depends_on("dummy module 2");
+
+	//Act
+	GATEWAY_HANDLE gateway = Gateway_LL_Create(dummyProps);
+
+	//Assert
+	ASSERT_IS_NULL(gateway);
+	ASSERT_ARE_EQUAL(size_t, 0, currentModule_Create_call);
+	ASSERT_ARE_EQUAL(size_t, 0, currentMessageBus_ref_count);
+
+	//Cleanup
+	BASEIMPLEMENTATION::VECTOR_destroy(dummyEntry->depends_on);
+	BASEIMPLEMENTATION::VECTOR_destroy(dummyEntry2.depends_on);
+}
+
+/*Tests_SRS_GATEWAY_LL_14_036: [ If any MODULE_HANDLE is unable to be created from a GATEWAY_PROPERTIES_ENTRY the GATEWAY_HANDLE will be destroyed. ]*/
+TEST_FUNCTION(Gateway_LL_Create_Does_Not_Create_Modules_Whose_Dependency_Fails)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	bool fail_create = false;
+	GATEWAY_PROPERTIES_ENTRY dummyEntry2 = {
+		"dummy module 2",
+		"x2.dll",
+		&fail_create
+	};
+
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry2, 1);
+	GATEWAY_PROPERTIES_ENTRY* dummyEntry = (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries);
+	dummyEntry->depends_on = create_depends_on("dummy module 2");
+
+	//Act
+	GATEWAY_HANDLE gateway = Gateway_LL_Create(dummyProps);
+
+	//Assert
+	ASSERT_IS_NULL(gateway);
+	ASSERT_ARE_EQUAL(size_t, 1, currentModule_Create_call);
+	ASSERT_ARE_EQUAL(size_t, 0, currentMessageBus_module_count);
+	ASSERT_ARE_EQUAL(size_t, 0, currentMessageBus_ref_count);
+
+	//Cleanup
+	BASEIMPLEMENTATION::VECTOR_destroy(dummyEntry->depends_on);
+}
+
+/*Tests_SRS_GATEWAY_LL_14_005: [ If gw is NULL the function shall do nothing. ]*/
+TEST_FUNCTION(Gateway_LL_Destroy_Does_Nothing_If_NULL)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	GATEWAY_HANDLE gateway = NULL;
+
+	//Act
+	Gateway_LL_Destroy(gateway);
+
+	//Assert
+	mocks.AssertActualAndExpectedCalls();
+}
+
+/*Tests_SRS_GATEWAY_LL_14_037: [ If GATEWAY_HANDLE_DATA's message bus cannot unlink module, the function shall log the error and continue unloading the module from the GATEWAY_HANDLE. ]*/
+TEST_FUNCTION(Gateway_LL_Destroy_Continues_Unloading_If_MessageBus_RemoveModule_Fails)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	//Add another entry to the properties
+	GATEWAY_PROPERTIES_ENTRY dummyEntry2 = {
+		"dummy module 2",
+		"x2.dll",
+		NULL
+	};
+
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry2, 1);
+
+	GATEWAY_HANDLE gateway = Gateway_LL_Create(dummyProps);
+	mocks.ResetAllCalls();
+
+	//Expectations
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_back(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	whenShallMessageBus_RemoveModule_fail = 1;
+	STRICT_EXPECTED_CALL(mocks, MessageBus_RemoveModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_DecRef(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, mock_Module_Destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_erase(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_back(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_RemoveModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_DecRef(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, mock_Module_Destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_erase(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_Destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+
+	//Act
+	Gateway_LL_Destroy(gateway);
+
+	//Assert
+	mocks.AssertActualAndExpectedCalls();
+}
+
+/*Tests_SRS_GATEWAY_LL_14_028: [ The function shall remove each module in GATEWAY_HANDLE_DATA's modules vector and destroy GATEWAY_HANDLE_DATA's modules. ]*/
+/*Tests_SRS_GATEWAY_LL_13_029: [The function shall remove the modules in the reverse order they were added, so that a module is removed before the modules it depends on.]*/
+/*Tests_SRS_GATEWAY_LL_14_006: [ The function shall destroy the GATEWAY_HANDLE_DATA's bus MESSAGE_BUS_HANDLE. ]*/
+TEST_FUNCTION(Gateway_LL_Destroy_Removes_All_Modules_And_Destroys_Vector_Success)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	//Add another entry to the properties
+	GATEWAY_PROPERTIES_ENTRY dummyEntry2 = {
+		"dummy module 2",
+		"x2.dll",
+		NULL
+	};
+
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry2, 1);
+
+	GATEWAY_HANDLE gateway = Gateway_LL_Create(dummyProps);
+	mocks.ResetAllCalls();
+
+	//Gateway_LL_Destroy Expectations
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_back(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_RemoveModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_DecRef(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, mock_Module_Destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_erase(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_back(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_RemoveModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_DecRef(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, mock_Module_Destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_erase(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_Destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+
+	//Act
+	Gateway_LL_Destroy(gateway);
+
+	//Assert
+	ASSERT_ARE_EQUAL(size_t, 0, currentMessageBus_module_count);
+	mocks.AssertActualAndExpectedCalls();
+}
+
+/*Tests_SRS_GATEWAY_LL_13_030: [If gw is NULL the function shall do nothing.]*/
+/*Tests_SRS_GATEWAY_LL_13_033: [If drain_result is not NULL, the function shall store in it the sum of the messages delivered and dropped while removing the modules.]*/
+TEST_FUNCTION(Gateway_LL_DestroyWithDrain_Does_Nothing_If_NULL)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+	MESSAGE_BUS_DRAIN_RESULT drain_result = { 42, 42 };
+
+	//Act
+	Gateway_LL_DestroyWithDrain(NULL, 1000, &drain_result);
+
+	//Assert
+	ASSERT_ARE_EQUAL(size_t, 0, drain_result.delivered);
+	ASSERT_ARE_EQUAL(size_t, 0, drain_result.dropped);
+	mocks.AssertActualAndExpectedCalls();
+}
+
+/*Tests_SRS_GATEWAY_LL_13_031: [The function shall destroy the gateway as Gateway_LL_Destroy does, removing every module from the bus with MessageBus_RemoveModuleWithDrain and the time left until drain_timeout_ms milliseconds have passed since the function was called.]*/
+/*Tests_SRS_GATEWAY_LL_13_033: [If drain_result is not NULL, the function shall store in it the sum of the messages delivered and dropped while removing the modules.]*/
+TEST_FUNCTION(Gateway_LL_DestroyWithDrain_Drains_All_Modules_Success)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+	MESSAGE_BUS_DRAIN_RESULT drain_result;
+
+	//Add another entry to the properties
+	GATEWAY_PROPERTIES_ENTRY dummyEntry2 = {
+		"dummy module 2",
+		"x2.dll",
+		NULL
+	};
+
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry2, 1);
+
+	GATEWAY_HANDLE gateway = Gateway_LL_Create(dummyProps);
+	mocks.ResetAllCalls();
+
+	//Gateway_LL_DestroyWithDrain Expectations
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_back(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_RemoveModuleWithDrain(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 0, IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2)
+		.IgnoreArgument(3)
+		.IgnoreArgument(4);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_DecRef(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, mock_Module_Destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_erase(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_back(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_RemoveModuleWithDrain(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 0, IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2)
+		.IgnoreArgument(3)
+		.IgnoreArgument(4);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_DecRef(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, mock_Module_Destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_erase(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_Destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+
+	//Act
+	Gateway_LL_DestroyWithDrain(gateway, 1000, &drain_result);
+
+	//Assert
+	ASSERT_ARE_EQUAL(size_t, 0, currentMessageBus_module_count);
+	ASSERT_ARE_EQUAL(size_t, 2, drain_result.delivered);
+	ASSERT_ARE_EQUAL(size_t, 0, drain_result.dropped);
+	mocks.AssertActualAndExpectedCalls();
+}
+
+/*Tests_SRS_GATEWAY_LL_13_015: [The function shall track every module it adds to the bus in its own vector of MODULE_DATA, without a module library and without a name, and shall not keep a reference to modules.]*/
+/*Tests_SRS_GATEWAY_LL_13_016: [If MODULE_DATA's module_library_handle is NULL the module belongs to the caller of Gateway_LL_Create2 and the function shall neither destroy it nor unload a library.]*/
+TEST_FUNCTION(Gateway_LL_Create2_Destroy_Leaves_Caller_Modules_Alive)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+	MODULE_C_STYLE c_style = { &dummyAPIs, (MODULE_HANDLE)0x42 };
+	MODULE module = { NATIVE_C_TYPE, &c_style };
+	VECTOR_HANDLE modules = BASEIMPLEMENTATION::VECTOR_create(sizeof(MODULE));
+	BASEIMPLEMENTATION::VECTOR_push_back(modules, &module, 1);
+	MESSAGE_BUS_HANDLE bus = MessageBus_Create();
+
+	GATEWAY_HANDLE gateway = Gateway_LL_Create2(modules, bus);
+	ASSERT_IS_NOT_NULL(gateway);
+	BASEIMPLEMENTATION::VECTOR_destroy(modules);
+	mocks.ResetAllCalls();
+
+	//Gateway_LL_Destroy Expectations
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_back(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_RemoveModule(IGNORED_PTR_ARG, (MODULE_HANDLE)0x42))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_DecRef(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, gballoc_free(NULL));
+	STRICT_EXPECTED_CALL(mocks, VECTOR_erase(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_Destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+
+	//Act
+	Gateway_LL_Destroy(gateway);
+
+	//Assert
+	ASSERT_ARE_EQUAL(size_t, 0, currentMessageBus_module_count);
+	mocks.AssertActualAndExpectedCalls();
+}
+
+/*Tests_SRS_GATEWAY_LL_14_011: [ If gw, entry, or GATEWAY_PROPERTIES_ENTRY's module_path is NULL the function shall return NULL. ]*/
+TEST_FUNCTION(Gateway_LL_AddModule_Returns_Null_For_Null_Gateway)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
+	mocks.ResetAllCalls();
+
+	//Act
+	MODULE_HANDLE handle0 = Gateway_LL_AddModule(NULL, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
+	
+	//Assert
+	ASSERT_IS_NULL(handle0);
+	mocks.AssertActualAndExpectedCalls();
+
+	//Cleanup
+	Gateway_LL_Destroy(gw);
+}
+
+/*Tests_SRS_GATEWAY_LL_14_011: [ If gw, entry, or GATEWAY_PROPERTIES_ENTRY's module_path is NULL the function shall return NULL. ]*/
+TEST_FUNCTION(Gateway_LL_AddModule_Returns_Null_For_Null_Module)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
+	mocks.ResetAllCalls();
+
+	//Act
+	MODULE_HANDLE handle1 = Gateway_LL_AddModule(gw, NULL);
+
+	//Assert
+	ASSERT_IS_NULL(handle1);
+	mocks.AssertActualAndExpectedCalls();
+
+	//Cleanup
+	Gateway_LL_Destroy(gw);
+}
+
+/*Tests_SRS_GATEWAY_LL_14_011: [ If gw, entry, or GATEWAY_PROPERTIES_ENTRY's module_path is NULL the function shall return NULL. ]*/
+TEST_FUNCTION(Gateway_LL_AddModule_Returns_Null_For_Null_Params)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
+	mocks.ResetAllCalls();
+
+	//Act
+	GATEWAY_PROPERTIES_ENTRY* entry = (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries);
+	entry->module_path = NULL;
+	MODULE_HANDLE handle2 = Gateway_LL_AddModule(gw, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
+
+	//Assert
+	ASSERT_IS_NULL(handle2);
+	mocks.AssertActualAndExpectedCalls();
+
+	//Cleanup
+	Gateway_LL_Destroy(gw);
+}
+
+/*Tests_SRS_GATEWAY_LL_14_012: [ The function shall load the module located at GATEWAY_PROPERTIES_ENTRY's module_path into a MODULE_LIBRARY_HANDLE. ]*/
+/*Tests_SRS_GATEWAY_LL_14_013: [ The function shall get the const MODULE_APIS* from the MODULE_LIBRARY_HANDLE. ]*/
+/*Tests_SRS_GATEWAY_LL_14_017: [ The function shall link the module to the GATEWAY_HANDLE_DATA's bus using a call to MessageBus_AddModuleWithReceiveBatch with GATEWAY_PROPERTIES_ENTRY's module_queue and the Module_ReceiveBatch of the module library. ]*/
+/*Tests_SRS_GATEWAY_LL_14_029: [ The function shall create a new MODULE_DATA containting the MODULE_HANDLE and MODULE_LIBRARY_HANDLE if the module was successfully linked to the message bus. ]*/
+/*Tests_SRS_GATEWAY_LL_14_032: [ The function shall add the new MODULE_DATA to GATEWAY_HANDLE_DATA's modules if the module was successfully linked to the message bus. ]*/
+/*Tests_SRS_GATEWAY_LL_14_019: [ The function shall return the newly created MODULE_HANDLE only if each API call returns successfully. ]*/
+/*Tests_SRS_GATEWAY_LL_14_039: [ The function shall increment the MESSAGE_BUS_HANDLE reference count if the MODULE_HANDLE was successfully linked to the GATEWAY_HANDLE_DATA's bus. ]*/
+TEST_FUNCTION(Gateway_LL_AddModule_Loads_Module_From_Library_Path)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
+	mocks.ResetAllCalls();
+
+	//Expectations
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Load(DUMMY_LIBRARY_PATH));
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleReceiveBatch(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, mock_Module_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_AddModuleWithReceiveBatch(IGNORED_PTR_ARG, IGNORED_PTR_ARG, NULL, IGNORED_PTR_ARG, NULL))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2)
+		.IgnoreArgument(4);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_IncRef(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+
+	//Act
+	MODULE_HANDLE handle = Gateway_LL_AddModule(gw, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
+
+	//Assert
+	ASSERT_IS_NOT_NULL(handle);
+	mocks.AssertActualAndExpectedCalls();
+
+	//Cleanup
+	Gateway_LL_Destroy(gw);
+}
+
+/*Tests_SRS_GATEWAY_LL_14_031: [ If unsuccessful, the function shall return NULL. ]*/
+TEST_FUNCTION(Gateway_LL_AddModule_Fails)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
+	mocks.ResetActualCalls();
+
+	//Expectations
+	whenShallModuleLoader_Load_fail = 1;
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Load(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+
+	MODULE_HANDLE handle = Gateway_LL_AddModule(gw, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
+
+	//Assert
+	ASSERT_IS_NULL(handle);
+	mocks.AssertActualAndExpectedCalls();
+
+	//Cleanup
+	Gateway_LL_Destroy(gw);
+}
+
+/*Tests_SRS_GATEWAY_LL_14_015: [ The function shall use the MODULE_APIS to create a MODULE_HANDLE using the GATEWAY_PROPERTIES_ENTRY's module_properties. ]*/
+/*Tests_SRS_GATEWAY_LL_14_039: [ The function shall increment the MESSAGE_BUS_HANDLE reference count if the MODULE_HANDLE was successfully linked to the GATEWAY_HANDLE_DATA's bus. ]*/
+TEST_FUNCTION(Gateway_LL_AddModule_Creates_Module_Using_Module_Properties)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
+	mocks.ResetAllCalls();
+	bool* properties = (bool*)malloc(sizeof(bool));
+	*properties = true;
+	GATEWAY_PROPERTIES_ENTRY entry = {
+		"Test module",
+		DUMMY_LIBRARY_PATH,
+		properties
+	};
+
+	//Expectations
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Load(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleReceiveBatch(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, mock_Module_Create(IGNORED_PTR_ARG, properties))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_AddModuleWithReceiveBatch(IGNORED_PTR_ARG, IGNORED_PTR_ARG, NULL, IGNORED_PTR_ARG, NULL))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2)
+		.IgnoreArgument(4);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_IncRef(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+
+	//Act
+	MODULE_HANDLE handle = Gateway_LL_AddModule(gw, &entry);
+
+	//Assert
+	ASSERT_IS_NOT_NULL(handle);
+	mocks.AssertActualAndExpectedCalls();
+
+	//Cleanup
+	Gateway_LL_Destroy(gw);
+	free(properties);
+}
+
+/*Tests_SRS_GATEWAY_LL_14_016: [ If the module creation is unsuccessful, the function shall return NULL. ]*/
+TEST_FUNCTION(Gateway_LL_AddModule_Module_Create_Fails)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
+	mocks.ResetAllCalls();
+	//Setting this boolean to false will cause mock_Module_Create to fail
+	bool properties = false;
+	GATEWAY_PROPERTIES_ENTRY entry = {
+		"Test module",
+		DUMMY_LIBRARY_PATH,
+		&properties
+	};
+
+	//Expectations
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Load(DUMMY_LIBRARY_PATH));
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleReceiveBatch(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, mock_Module_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+
+	//Act
+	MODULE_HANDLE handle = Gateway_LL_AddModule(gw, &entry);
+
+	//Assert
+	ASSERT_IS_NULL(handle);
+	mocks.AssertActualAndExpectedCalls();
+
+	//Cleanup
+	Gateway_LL_Destroy(gw);
+}
+
+/*Tests_SRS_GATEWAY_LL_14_018: [ If the message bus linking is unsuccessful, the function shall return NULL. ]*/
+TEST_FUNCTION(Gateway_LL_AddModule_MessageBus_AddModule_Fails)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
+	mocks.ResetAllCalls();
+	
+	//Expectations
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Load(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, mock_Module_Destroy(IGNORED_PTR_ARG))
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleReceiveBatch(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, VECTOR_erase(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+	STRICT_EXPECTED_CALL(mocks, mock_Module_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 		.IgnoreArgument(1)
 		.IgnoreArgument(2);
+	whenShallMessageBus_AddModule_fail = 1;
+	STRICT_EXPECTED_CALL(mocks, MessageBus_AddModuleWithReceiveBatch(IGNORED_PTR_ARG, IGNORED_PTR_ARG, NULL, IGNORED_PTR_ARG, NULL))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2)
+		.IgnoreArgument(4);
+	STRICT_EXPECTED_CALL(mocks, mock_Module_Destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	
 
-	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+	//Act
+	MODULE_HANDLE handle = Gateway_LL_AddModule(gw, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
+
+	ASSERT_IS_NULL(handle);
+	mocks.AssertActualAndExpectedCalls();
+
+	//Cleanup
+	Gateway_LL_Destroy(gw);
+}
+
+/*Tests_SRS_GATEWAY_LL_14_030: [ If any internal API call is unsuccessful after a module is created, the library will be unloaded and the module destroyed. ]*/
+/*Tests_SRS_GATEWAY_LL_14_039: [The function shall increment the MESSAGE_BUS_HANDLE reference count if the MODULE_HANDLE was successfully linked to the GATEWAY_HANDLE_DATA's bus. ]*/
+TEST_FUNCTION(Gateway_LL_AddModule_Internal_API_Fail_Rollback_Module)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
+	mocks.ResetAllCalls();
+
+	//Expectations
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Load(DUMMY_LIBRARY_PATH));
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleReceiveBatch(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_Destroy(IGNORED_PTR_ARG))
+	STRICT_EXPECTED_CALL(mocks, mock_Module_Create(IGNORED_PTR_ARG, NULL))
 		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+	STRICT_EXPECTED_CALL(mocks, MessageBus_AddModuleWithReceiveBatch(IGNORED_PTR_ARG, IGNORED_PTR_ARG, NULL, IGNORED_PTR_ARG, NULL))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2)
+		.IgnoreArgument(4);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_IncRef(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	whenShallVECTOR_push_back_fail = 1;
+	STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_RemoveModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_DecRef(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, mock_Module_Destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
 
 	//Act
-	Gateway_LL_Destroy(gateway);
+	MODULE_HANDLE handle = Gateway_LL_AddModule(gw, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
 
-	//Assert
+	ASSERT_IS_NULL(handle);
 	ASSERT_ARE_EQUAL(size_t, 0, currentMessageBus_module_count);
 	mocks.AssertActualAndExpectedCalls();
+
+	//Cleanup
+	Gateway_LL_Destroy(gw);
 }
 
-/*Tests_SRS_GATEWAY_LL_14_011: [ If gw, entry, or GATEWAY_PROPERTIES_ENTRY's module_path is NULL the function shall return NULL. ]*/
-TEST_FUNCTION(Gateway_LL_AddModule_Returns_Null_For_Null_Gateway)
+/*Tests_SRS_GATEWAY_LL_14_020: [ If gw or module is NULL the function shall return. ]*/
+TEST_FUNCTION(Gateway_LL_RemoveModule_Does_Nothing_If_Gateway_NULL)
 {
 	//Arrange
 	CGatewayLLMocks mocks;
-
 	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
+	MODULE_HANDLE handle = Gateway_LL_AddModule(gw, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
 	mocks.ResetAllCalls();
 
 	//Act
-	MODULE_HANDLE handle0 = Gateway_LL_AddModule(NULL, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
+	Gateway_LL_RemoveModule(NULL, NULL);
+	Gateway_LL_RemoveModule(NULL, handle);
 	
 	//Assert
-	ASSERT_IS_NULL(handle0);
 	mocks.AssertActualAndExpectedCalls();
 
 	//Cleanup
 	Gateway_LL_Destroy(gw);
 }
 
-/*Tests_SRS_GATEWAY_LL_14_011: [ If gw, entry, or GATEWAY_PROPERTIES_ENTRY's module_path is NULL the function shall return NULL. ]*/
-TEST_FUNCTION(Gateway_LL_AddModule_Returns_Null_For_Null_Module)
+/*Tests_SRS_GATEWAY_LL_14_020: [ If gw or module is NULL the function shall return. ]*/
+TEST_FUNCTION(Gateway_LL_RemoveModule_Does_Nothing_If_Module_NULL)
 {
 	//Arrange
 	CGatewayLLMocks mocks;
-
 	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
 	mocks.ResetAllCalls();
 
+	//Expectations
+	STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+		.IgnoreAllArguments();
+
 	//Act
-	MODULE_HANDLE handle1 = Gateway_LL_AddModule(gw, NULL);
+	Gateway_LL_RemoveModule(gw, NULL);
 
 	//Assert
-	ASSERT_IS_NULL(handle1);
 	mocks.AssertActualAndExpectedCalls();
 
 	//Cleanup
 	Gateway_LL_Destroy(gw);
 }
 
-/*Tests_SRS_GATEWAY_LL_14_011: [ If gw, entry, or GATEWAY_PROPERTIES_ENTRY's module_path is NULL the function shall return NULL. ]*/
-TEST_FUNCTION(Gateway_LL_AddModule_Returns_Null_For_Null_Params)
+/*Tests_SRS_GATEWAY_LL_14_023: [ The function shall locate the MODULE_DATA object in GATEWAY_HANDLE_DATA's modules containing module and return if it cannot be found. ]*/
+/*Tests_SRS_GATEWAY_LL_14_021: [ The function shall unlink module from the GATEWAY_HANDLE_DATA's bus MESSAGE_BUS_HANDLE. ]*/
+/*Tests_SRS_GATEWAY_LL_14_024: [ The function shall use the MODULE_DATA's module_library_handle to retrieve the MODULE_APIS and destroy module. ]*/
+/*Tests_SRS_GATEWAY_LL_14_025: [ The function shall unload MODULE_DATA's module_library_handle. ]*/
+/*Tests_SRS_GATEWAY_LL_14_026: [ The function shall remove that MODULE_DATA from GATEWAY_HANDLE_DATA's modules. ]*/
+/*Tests_SRS_GATEWAY_LL_14_038: [ The function shall decrement the MESSAGE_BUS_HANDLE reference count. ]*/
+TEST_FUNCTION(Gateway_LL_RemoveModule_Finds_Module_Data_Success)
 {
 	//Arrange
 	CGatewayLLMocks mocks;
-
 	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
+	MODULE_HANDLE handle = Gateway_LL_AddModule(gw, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
 	mocks.ResetAllCalls();
 
+	//Expectations
+	STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+		.IgnoreAllArguments();
+	STRICT_EXPECTED_CALL(mocks, MessageBus_RemoveModule(IGNORED_PTR_ARG, handle))
+		.IgnoreAllArguments();
+	STRICT_EXPECTED_CALL(mocks, MessageBus_DecRef(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, mock_Module_Destroy(handle))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_erase(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+	
+
 	//Act
-	GATEWAY_PROPERTIES_ENTRY* entry = (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries);
-	entry->module_path = NULL;
-	MODULE_HANDLE handle2 = Gateway_LL_AddModule(gw, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
+	Gateway_LL_RemoveModule(gw, handle);
 
 	//Assert
-	ASSERT_IS_NULL(handle2);
 	mocks.AssertActualAndExpectedCalls();
 
 	//Cleanup
 	Gateway_LL_Destroy(gw);
 }
 
-/*Tests_SRS_GATEWAY_LL_14_012: [ The function shall load the module located at GATEWAY_PROPERTIES_ENTRY's module_path into a MODULE_LIBRARY_HANDLE. ]*/
-/*Tests_SRS_GATEWAY_LL_14_013: [ The function shall get the const MODULE_APIS* from the MODULE_LIBRARY_HANDLE. ]*/
-/*Tests_SRS_GATEWAY_LL_14_017: [ The function shall link the module to the GATEWAY_HANDLE_DATA's bus using a call to MessageBus_AddModule. ]*/
-/*Tests_SRS_GATEWAY_LL_14_029: [ The function shall create a new MODULE_DATA containting the MODULE_HANDLE and MODULE_LIBRARY_HANDLE if the module was successfully linked to the message bus. ]*/
-/*Tests_SRS_GATEWAY_LL_14_032: [ The function shall add the new MODULE_DATA to GATEWAY_HANDLE_DATA's modules if the module was successfully linked to the message bus. ]*/
-/*Tests_SRS_GATEWAY_LL_14_019: [ The function shall return the newly created MODULE_HANDLE only if each API call returns successfully. ]*/
-/*Tests_SRS_GATEWAY_LL_14_039: [ The function shall increment the MESSAGE_BUS_HANDLE reference count if the MODULE_HANDLE was successfully linked to the GATEWAY_HANDLE_DATA's bus. ]*/
-TEST_FUNCTION(Gateway_LL_AddModule_Loads_Module_From_Library_Path)
+/*Tests_SRS_GATEWAY_LL_14_023: [ The function shall locate the MODULE_DATA object in GATEWAY_HANDLE_DATA's modules containing module and return if it cannot be found. ]*/
+TEST_FUNCTION(Gateway_LL_RemoveModule_Finds_Module_Data_Failure)
 {
 	//Arrange
 	CGatewayLLMocks mocks;
+	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
+	MODULE_HANDLE handle = Gateway_LL_AddModule(gw, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
+	mocks.ResetAllCalls();
+
+	//Expectations
+	STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, gw))
+		.IgnoreAllArguments();
+
+	//Act
+	Gateway_LL_RemoveModule(gw, (MODULE_HANDLE)gw);
+
+	//Assert
+	mocks.AssertActualAndExpectedCalls();
+
+	//Cleanup
+	Gateway_LL_Destroy(gw);
+}
 
+/*Tests_SRS_GATEWAY_LL_14_022: [ If GATEWAY_HANDLE_DATA's bus cannot unlink module, the function shall log the error and continue unloading the module from the GATEWAY_HANDLE. ]*/
+/*Tests_SRS_GATEWAY_LL_14_038: [ The function shall decrement the MESSAGE_BUS_HANDLE reference count. ]*/
+TEST_FUNCTION(Gateway_LL_RemoveModule_MessageBus_RemoveModule_Failure)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
 	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
+	MODULE_HANDLE handle = Gateway_LL_AddModule(gw, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
 	mocks.ResetAllCalls();
 
 	//Expectations
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Load(DUMMY_LIBRARY_PATH));
+	STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+		.IgnoreAllArguments();
+	whenShallMessageBus_RemoveModule_fail = 1;
+	STRICT_EXPECTED_CALL(mocks, MessageBus_RemoveModule(IGNORED_PTR_ARG, handle))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, MessageBus_DecRef(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, mock_Module_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-		.IgnoreArgument(1)
-		.IgnoreArgument(2);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_AddModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-		.IgnoreArgument(1)
-		.IgnoreArgument(2)
-		.IgnoreArgument(3);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_IncRef(IGNORED_PTR_ARG))
+	STRICT_EXPECTED_CALL(mocks, mock_Module_Destroy(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_erase(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
 		.IgnoreArgument(1)
 		.IgnoreArgument(2);
 
 	//Act
-	MODULE_HANDLE handle = Gateway_LL_AddModule(gw, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
+	Gateway_LL_RemoveModule(gw, handle);
+
+	//Assert
+	mocks.AssertActualAndExpectedCalls();
+
+	//Cleanup
+	Gateway_LL_Destroy(gw);
+}
+
+/*Tests_SRS_GATEWAY_LL_13_004: [If gw, entry, entry's module_source or entry's module_sink is NULL the function shall return a non-zero value.]*/
+TEST_FUNCTION(Gateway_LL_AddLink_Fails_For_Null_Gateway)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+	GATEWAY_LINK_ENTRY link = { "dummy module", "dummy module", NULL, NULL };
+
+	//Act
+	int result = Gateway_LL_AddLink(NULL, &link);
+
+	//Assert
+	ASSERT_ARE_NOT_EQUAL(int, 0, result);
+	mocks.AssertActualAndExpectedCalls();
+}
+
+/*Tests_SRS_GATEWAY_LL_13_004: [If gw, entry, entry's module_source or entry's module_sink is NULL the function shall return a non-zero value.]*/
+TEST_FUNCTION(Gateway_LL_AddLink_Fails_For_Null_Sink)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
+	GATEWAY_LINK_ENTRY link = { "dummy module", NULL, NULL, NULL };
+	mocks.ResetAllCalls();
+
+	//Act
+	int result = Gateway_LL_AddLink(gw, &link);
+
+	//Assert
+	ASSERT_ARE_NOT_EQUAL(int, 0, result);
+	mocks.AssertActualAndExpectedCalls();
+
+	//Cleanup
+	Gateway_LL_Destroy(gw);
+}
+
+/*Tests_SRS_GATEWAY_LL_13_005: [The function shall return a non-zero value if module_sink, or module_source when it is not "*", is not the name of a module of the gateway.]*/
+TEST_FUNCTION(Gateway_LL_AddLink_Fails_For_Unknown_Module)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
+	GATEWAY_LINK_ENTRY link = { GATEWAY_LINK_ANY_SOURCE, "no such module", NULL, NULL };
+	mocks.ResetAllCalls();
+
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+
+	//Act
+	int result = Gateway_LL_AddLink(gw, &link);
+
+	//Assert
+	ASSERT_ARE_NOT_EQUAL(int, 0, result);
+	mocks.AssertActualAndExpectedCalls();
+
+	//Cleanup
+	Gateway_LL_Destroy(gw);
+}
+
+/*Tests_SRS_GATEWAY_LL_13_008: [If gw, entry, entry's module_source or entry's module_sink is NULL the function shall return.]*/
+TEST_FUNCTION(Gateway_LL_RemoveLink_Does_Nothing_For_Null_Entry)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
+	mocks.ResetAllCalls();
+
+	//Act
+	Gateway_LL_RemoveLink(gw, NULL);
+
+	//Assert
+	mocks.AssertActualAndExpectedCalls();
+
+	//Cleanup
+	Gateway_LL_Destroy(gw);
+}
+
+static size_t statistics_callback_count;
+static uint64_t statistics_callback_enqueued;
+
+static void count_statistics(const char* module_name, MODULE_HANDLE module, const MESSAGE_BUS_MODULE_STATISTICS* statistics, void* context)
+{
+	(void)module_name;
+	(void)module;
+	(void)context;
+	statistics_callback_count++;
+	statistics_callback_enqueued = statistics->enqueued;
+}
+
+/*Tests_SRS_GATEWAY_LL_13_038: [If gw, properties or properties's gateway_properties_entries is NULL the function shall return a non-zero value.]*/
+TEST_FUNCTION(Gateway_LL_Update_Fails_For_Null_Gateway)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	//Act
+	int result = Gateway_LL_Update(NULL, dummyProps);
 
 	//Assert
-	ASSERT_IS_NOT_NULL(handle);
+	ASSERT_ARE_NOT_EQUAL(int, 0, result);
 	mocks.AssertActualAndExpectedCalls();
-
-	//Cleanup
-	Gateway_LL_Destroy(gw);
 }
 
-/*Tests_SRS_GATEWAY_LL_14_031: [ If unsuccessful, the function shall return NULL. ]*/
-TEST_FUNCTION(Gateway_LL_AddModule_Fails)
+/*Tests_SRS_GATEWAY_LL_13_039: [The function shall return a non-zero value without changing the gateway if an entry has no module_name or no module_path, if two entries have the same module_name, or if an entry depends on a name that is not the module_name of an entry.]*/
+TEST_FUNCTION(Gateway_LL_Update_Fails_For_Duplicate_Module_Names)
 {
 	//Arrange
 	CGatewayLLMocks mocks;
-
 	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
-	mocks.ResetActualCalls();
+	GATEWAY_PROPERTIES_ENTRY duplicateEntry = {
+		"dummy module",
+		DUMMY_LIBRARY_PATH,
+		NULL
+	};
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &duplicateEntry, 1);
+	mocks.ResetAllCalls();
 
-	//Expectations
-	whenShallModuleLoader_Load_fail = 1;
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Load(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(dummyProps->gateway_properties_entries));
+	STRICT_EXPECTED_CALL(mocks, VECTOR_element(dummyProps->gateway_properties_entries, 0));
+	STRICT_EXPECTED_CALL(mocks, VECTOR_element(dummyProps->gateway_properties_entries, 1));
+	STRICT_EXPECTED_CALL(mocks, VECTOR_element(dummyProps->gateway_properties_entries, 0));
 
-	MODULE_HANDLE handle = Gateway_LL_AddModule(gw, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
+	//Act
+	int result = Gateway_LL_Update(gw, dummyProps);
 
 	//Assert
-	ASSERT_IS_NULL(handle);
+	ASSERT_ARE_NOT_EQUAL(int, 0, result);
+	ASSERT_ARE_EQUAL(size_t, 0, currentModuleLoader_Load_call);
 	mocks.AssertActualAndExpectedCalls();
 
 	//Cleanup
 	Gateway_LL_Destroy(gw);
 }
 
-/*Tests_SRS_GATEWAY_LL_14_015: [ The function shall use the MODULE_APIS to create a MODULE_HANDLE using the GATEWAY_PROPERTIES_ENTRY's module_properties. ]*/
-/*Tests_SRS_GATEWAY_LL_14_039: [ The function shall increment the MESSAGE_BUS_HANDLE reference count if the MODULE_HANDLE was successfully linked to the GATEWAY_HANDLE_DATA's bus. ]*/
-TEST_FUNCTION(Gateway_LL_AddModule_Creates_Module_Using_Module_Properties)
+/*Tests_SRS_GATEWAY_LL_13_040: [The function shall remove, in the reverse order they were added and as Gateway_LL_RemoveModule does, the named modules of the gateway that have no entry of the same module_name, or whose entry has a module_path, module_queue or module_configuration other than the ones the module was added with.]*/
+/*Tests_SRS_GATEWAY_LL_13_045: [The function shall return 0 once the modules and links of the gateway are those of properties.]*/
+TEST_FUNCTION(Gateway_LL_Update_Keeps_Unchanged_Modules_Running)
 {
 	//Arrange
 	CGatewayLLMocks mocks;
+	GATEWAY_HANDLE gw = Gateway_LL_Create(dummyProps);
+	currentModule_Create_call = 0;
+	currentModuleLoader_Load_call = 0;
 
-	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
-	mocks.ResetAllCalls();
-	bool* properties = (bool*)malloc(sizeof(bool));
-	*properties = true;
-	GATEWAY_PROPERTIES_ENTRY entry = {
-		"Test module",
-		DUMMY_LIBRARY_PATH,
-		properties
-	};
+	//Act
+	int result = Gateway_LL_Update(gw, dummyProps);
 
-	//Expectations
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Load(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, mock_Module_Create(IGNORED_PTR_ARG, properties))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_AddModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-		.IgnoreArgument(1)
-		.IgnoreArgument(2)
-		.IgnoreArgument(3);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_IncRef(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-		.IgnoreArgument(1)
-		.IgnoreArgument(2);
+	//Assert
+	ASSERT_ARE_EQUAL(int, 0, result);
+	ASSERT_ARE_EQUAL(size_t, 0, currentModuleLoader_Load_call);
+	ASSERT_ARE_EQUAL(size_t, 0, currentModule_Create_call);
+	ASSERT_ARE_EQUAL(size_t, 0, currentModule_Destroy_call);
+	ASSERT_ARE_EQUAL(size_t, 1, currentMessageBus_module_count);
+
+	//Cleanup
+	Gateway_LL_Destroy(gw);
+}
+
+/*Tests_SRS_GATEWAY_LL_13_040: [The function shall remove, in the reverse order they were added and as Gateway_LL_RemoveModule does, the named modules of the gateway that have no entry of the same module_name, or whose entry has a module_path, module_queue or module_configuration other than the ones the module was added with.]*/
+/*Tests_SRS_GATEWAY_LL_13_042: [The function shall add, as Gateway_LL_AddModule does, the module of every entry whose module_name is not the name of a module of the gateway, once the modules it depends on are on the gateway.]*/
+TEST_FUNCTION(Gateway_LL_Update_Replaces_Changed_Modules)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+	GATEWAY_HANDLE gw = Gateway_LL_Create(dummyProps);
+	GATEWAY_PROPERTIES_ENTRY* dummyEntry = (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries);
+	dummyEntry->module_queue.capacity = 16;
+	currentModule_Create_call = 0;
 
 	//Act
-	MODULE_HANDLE handle = Gateway_LL_AddModule(gw, &entry);
+	int result = Gateway_LL_Update(gw, dummyProps);
 
 	//Assert
-	ASSERT_IS_NOT_NULL(handle);
-	mocks.AssertActualAndExpectedCalls();
+	ASSERT_ARE_EQUAL(int, 0, result);
+	ASSERT_ARE_EQUAL(size_t, 1, currentModule_Destroy_call);
+	ASSERT_ARE_EQUAL(size_t, 1, currentModule_Create_call);
+	ASSERT_ARE_EQUAL(size_t, 1, currentMessageBus_module_count);
 
 	//Cleanup
 	Gateway_LL_Destroy(gw);
-	free(properties);
 }
 
-/*Tests_SRS_GATEWAY_LL_14_016: [ If the module creation is unsuccessful, the function shall return NULL. ]*/
-TEST_FUNCTION(Gateway_LL_AddModule_Module_Create_Fails)
+/*Tests_SRS_GATEWAY_LL_13_040: [The function shall remove, in the reverse order they were added and as Gateway_LL_RemoveModule does, the named modules of the gateway that have no entry of the same module_name, or whose entry has a module_path, module_queue or module_configuration other than the ones the module was added with.]*/
+TEST_FUNCTION(Gateway_LL_Update_Destroys_Removed_Modules)
 {
 	//Arrange
 	CGatewayLLMocks mocks;
-
-	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
-	mocks.ResetAllCalls();
-	//Setting this boolean to false will cause mock_Module_Create to fail
-	bool properties = false;
-	GATEWAY_PROPERTIES_ENTRY entry = {
-		"Test module",
-		DUMMY_LIBRARY_PATH,
-		&properties
+	GATEWAY_PROPERTIES_ENTRY dummyEntry2 = {
+		"dummy module 2",
+		"x2.dll",
+		NULL
 	};
-
-	//Expectations
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Load(DUMMY_LIBRARY_PATH));
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, mock_Module_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-		.IgnoreArgument(1)
-		.IgnoreArgument(2);
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry2, 1);
+	GATEWAY_HANDLE gw = Gateway_LL_Create(dummyProps);
+	BASEIMPLEMENTATION::VECTOR_erase(dummyProps->gateway_properties_entries, BASEIMPLEMENTATION::VECTOR_back(dummyProps->gateway_properties_entries), 1);
+	currentModule_Create_call = 0;
 
 	//Act
-	MODULE_HANDLE handle = Gateway_LL_AddModule(gw, &entry);
+	int result = Gateway_LL_Update(gw, dummyProps);
 
 	//Assert
-	ASSERT_IS_NULL(handle);
-	mocks.AssertActualAndExpectedCalls();
+	ASSERT_ARE_EQUAL(int, 0, result);
+	ASSERT_ARE_EQUAL(size_t, 1, currentModule_Destroy_call);
+	ASSERT_ARE_EQUAL(size_t, 0, currentModule_Create_call);
+	ASSERT_ARE_EQUAL(size_t, 1, currentMessageBus_module_count);
 
 	//Cleanup
 	Gateway_LL_Destroy(gw);
 }
 
-/*Tests_SRS_GATEWAY_LL_14_018: [ If the message bus linking is unsuccessful, the function shall return NULL. ]*/
-TEST_FUNCTION(Gateway_LL_AddModule_MessageBus_AddModule_Fails)
+/*Tests_SRS_GATEWAY_LL_13_049: [The function shall also remove the named modules whose entry depends, directly or through other entries, on a module it removes, so that they are created again after it.]*/
+TEST_FUNCTION(Gateway_LL_Update_Restarts_The_Dependents_Of_Changed_Modules)
 {
 	//Arrange
 	CGatewayLLMocks mocks;
-
-	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
-	mocks.ResetAllCalls();
-	
-	//Expectations
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Load(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, mock_Module_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-		.IgnoreArgument(1)
-		.IgnoreArgument(2);
-	whenShallMessageBus_AddModule_fail = 1;
-	STRICT_EXPECTED_CALL(mocks, MessageBus_AddModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-		.IgnoreArgument(1)
-		.IgnoreArgument(2)
-		.IgnoreArgument(3);
-	STRICT_EXPECTED_CALL(mocks, mock_Module_Destroy(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	
+	GATEWAY_PROPERTIES_ENTRY dummyEntry2 = {
+		"dummy module 2",
+		"x2.dll",
+		NULL
+	};
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry2, 1);
+	GATEWAY_PROPERTIES_ENTRY* dummyEntry = (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries);
+	dummyEntry->depends_on = create_depends_on("dummy module 2");
+	GATEWAY_HANDLE gw = Gateway_LL_Create(dummyProps);
+	GATEWAY_PROPERTIES_ENTRY* dependency = (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_back(dummyProps->gateway_properties_entries);
+	dependency->module_path = "x3.dll";
+	currentModule_Create_call = 0;
 
 	//Act
-	MODULE_HANDLE handle = Gateway_LL_AddModule(gw, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
+	int result = Gateway_LL_Update(gw, dummyProps);
 
-	ASSERT_IS_NULL(handle);
-	mocks.AssertActualAndExpectedCalls();
+	//Assert
+	ASSERT_ARE_EQUAL(int, 0, result);
+	ASSERT_ARE_EQUAL(size_t, 2, currentModule_Destroy_call);
+	ASSERT_ARE_EQUAL(size_t, 2, currentModule_Create_call);
+	ASSERT_ARE_EQUAL(size_t, 2, currentMessageBus_module_count);
 
 	//Cleanup
 	Gateway_LL_Destroy(gw);
+	BASEIMPLEMENTATION::VECTOR_destroy(dummyEntry->depends_on);
 }
 
-/*Tests_SRS_GATEWAY_LL_14_030: [ If any internal API call is unsuccessful after a module is created, the library will be unloaded and the module destroyed. ]*/
-/*Tests_SRS_GATEWAY_LL_14_039: [The function shall increment the MESSAGE_BUS_HANDLE reference count if the MODULE_HANDLE was successfully linked to the GATEWAY_HANDLE_DATA's bus. ]*/
-TEST_FUNCTION(Gateway_LL_AddModule_Internal_API_Fail_Rollback_Module)
+/*Tests_SRS_GATEWAY_LL_13_041: [The function shall remove, as Gateway_LL_RemoveLink does, the links of GATEWAY_HANDLE_DATA's links that are not in properties's gateway_links.]*/
+/*Tests_SRS_GATEWAY_LL_13_044: [The function shall add, as Gateway_LL_AddLink does, the links of properties's gateway_links that are not in GATEWAY_HANDLE_DATA's links, and return a non-zero value if one cannot be added.]*/
+TEST_FUNCTION(Gateway_LL_Update_Removes_And_Adds_Only_The_Links_That_Changed)
 {
 	//Arrange
 	CGatewayLLMocks mocks;
-
-	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
-	mocks.ResetAllCalls();
-
-	//Expectations
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Load(DUMMY_LIBRARY_PATH));
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, mock_Module_Create(IGNORED_PTR_ARG, NULL))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_AddModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-		.IgnoreArgument(1)
-		.IgnoreArgument(2)
-		.IgnoreArgument(3);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_IncRef(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	whenShallVECTOR_push_back_fail = 1;
-	STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-		.IgnoreArgument(1)
-		.IgnoreArgument(2);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_RemoveModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-		.IgnoreArgument(1)
-		.IgnoreArgument(2);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_DecRef(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, mock_Module_Destroy(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
+	GATEWAY_PROPERTIES_ENTRY dummyEntry2 = {
+		"dummy module 2",
+		"x2.dll",
+		NULL
+	};
+	GATEWAY_LINK_ENTRY kept = { "dummy module", "dummy module 2", NULL, NULL };
+	GATEWAY_LINK_ENTRY removed = { "dummy module 2", "dummy module", NULL, NULL };
+	GATEWAY_LINK_ENTRY added = { "dummy module", "dummy module", NULL, NULL };
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_properties_entries, &dummyEntry2, 1);
+	dummyProps->gateway_links = BASEIMPLEMENTATION::VECTOR_create(sizeof(GATEWAY_LINK_ENTRY));
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_links, &kept, 1);
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_links, &removed, 1);
+	GATEWAY_HANDLE gw = Gateway_LL_Create(dummyProps);
+	BASEIMPLEMENTATION::VECTOR_erase(dummyProps->gateway_links, BASEIMPLEMENTATION::VECTOR_back(dummyProps->gateway_links), 1);
+	BASEIMPLEMENTATION::VECTOR_push_back(dummyProps->gateway_links, &added, 1);
+	currentMessageBus_AddLink_call = 0;
 
 	//Act
-	MODULE_HANDLE handle = Gateway_LL_AddModule(gw, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
+	int result = Gateway_LL_Update(gw, dummyProps);
 
-	ASSERT_IS_NULL(handle);
-	ASSERT_ARE_EQUAL(size_t, 0, currentMessageBus_module_count);
-	mocks.AssertActualAndExpectedCalls();
+	//Assert
+	ASSERT_ARE_EQUAL(int, 0, result);
+	ASSERT_ARE_EQUAL(size_t, 1, currentMessageBus_RemoveLink_call);
+	ASSERT_ARE_EQUAL(size_t, 1, currentMessageBus_AddLink_call);
+	ASSERT_ARE_EQUAL(size_t, 0, currentModule_Destroy_call);
 
 	//Cleanup
 	Gateway_LL_Destroy(gw);
+	BASEIMPLEMENTATION::VECTOR_destroy(dummyProps->gateway_links);
 }
 
-/*Tests_SRS_GATEWAY_LL_14_020: [ If gw or module is NULL the function shall return. ]*/
-TEST_FUNCTION(Gateway_LL_RemoveModule_Does_Nothing_If_Gateway_NULL)
+/*Tests_SRS_GATEWAY_LL_13_012: [If gw or callback is NULL the function shall return a non-zero value.]*/
+TEST_FUNCTION(Gateway_LL_GetStatistics_Fails_For_Null_Gateway)
 {
 	//Arrange
 	CGatewayLLMocks mocks;
-	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
-	MODULE_HANDLE handle = Gateway_LL_AddModule(gw, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
-	mocks.ResetAllCalls();
 
 	//Act
-	Gateway_LL_RemoveModule(NULL, NULL);
-	Gateway_LL_RemoveModule(NULL, handle);
-	
+	int result = Gateway_LL_GetStatistics(NULL, count_statistics, NULL);
+
 	//Assert
+	ASSERT_ARE_NOT_EQUAL(int, 0, result);
 	mocks.AssertActualAndExpectedCalls();
-
-	//Cleanup
-	Gateway_LL_Destroy(gw);
 }
 
-/*Tests_SRS_GATEWAY_LL_14_020: [ If gw or module is NULL the function shall return. ]*/
-TEST_FUNCTION(Gateway_LL_RemoveModule_Does_Nothing_If_Module_NULL)
+/*Tests_SRS_GATEWAY_LL_13_012: [If gw or callback is NULL the function shall return a non-zero value.]*/
+TEST_FUNCTION(Gateway_LL_GetStatistics_Fails_For_Null_Callback)
 {
 	//Arrange
 	CGatewayLLMocks mocks;
 	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
 	mocks.ResetAllCalls();
 
-	//Expectations
-	STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-		.IgnoreAllArguments();
-
 	//Act
-	Gateway_LL_RemoveModule(gw, NULL);
+	int result = Gateway_LL_GetStatistics(gw, NULL, NULL);
 
 	//Assert
+	ASSERT_ARE_NOT_EQUAL(int, 0, result);
 	mocks.AssertActualAndExpectedCalls();
 
 	//Cleanup
 	Gateway_LL_Destroy(gw);
 }
 
-/*Tests_SRS_GATEWAY_LL_14_023: [ The function shall locate the MODULE_DATA object in GATEWAY_HANDLE_DATA's modules containing module and return if it cannot be found. ]*/
-/*Tests_SRS_GATEWAY_LL_14_021: [ The function shall unlink module from the GATEWAY_HANDLE_DATA's bus MESSAGE_BUS_HANDLE. ]*/
-/*Tests_SRS_GATEWAY_LL_14_024: [ The function shall use the MODULE_DATA's module_library_handle to retrieve the MODULE_APIS and destroy module. ]*/
-/*Tests_SRS_GATEWAY_LL_14_025: [ The function shall unload MODULE_DATA's module_library_handle. ]*/
-/*Tests_SRS_GATEWAY_LL_14_026: [ The function shall remove that MODULE_DATA from GATEWAY_HANDLE_DATA's modules. ]*/
-/*Tests_SRS_GATEWAY_LL_14_038: [ The function shall decrement the MESSAGE_BUS_HANDLE reference count. ]*/
-TEST_FUNCTION(Gateway_LL_RemoveModule_Finds_Module_Data_Success)
+/*Tests_SRS_GATEWAY_LL_13_013: [The function shall read the statistics of each module of GATEWAY_HANDLE_DATA's modules with MessageBus_GetStatistics and pass them to callback along with the module's name.]*/
+TEST_FUNCTION(Gateway_LL_GetStatistics_Calls_Callback_For_Each_Module)
 {
 	//Arrange
 	CGatewayLLMocks mocks;
 	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
 	MODULE_HANDLE handle = Gateway_LL_AddModule(gw, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
+	statistics_callback_count = 0;
+	statistics_callback_enqueued = 0;
 	mocks.ResetAllCalls();
 
 	//Expectations
-	STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-		.IgnoreAllArguments();
-	STRICT_EXPECTED_CALL(mocks, MessageBus_RemoveModule(IGNORED_PTR_ARG, handle))
-		.IgnoreAllArguments();
-	STRICT_EXPECTED_CALL(mocks, MessageBus_DecRef(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, mock_Module_Destroy(handle))
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
+	STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
 		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, VECTOR_erase(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+	STRICT_EXPECTED_CALL(mocks, MessageBus_GetStatistics(IGNORED_PTR_ARG, handle, IGNORED_PTR_ARG))
 		.IgnoreArgument(1)
-		.IgnoreArgument(2);
-	
+		.IgnoreArgument(3);
 
 	//Act
-	Gateway_LL_RemoveModule(gw, handle);
+	int result = Gateway_LL_GetStatistics(gw, count_statistics, NULL);
 
 	//Assert
+	ASSERT_ARE_EQUAL(int, 0, result);
+	ASSERT_ARE_EQUAL(size_t, 1, statistics_callback_count);
+	ASSERT_IS_TRUE(statistics_callback_enqueued == 42);
 	mocks.AssertActualAndExpectedCalls();
 
 	//Cleanup
 	Gateway_LL_Destroy(gw);
 }
 
-/*Tests_SRS_GATEWAY_LL_14_023: [ The function shall locate the MODULE_DATA object in GATEWAY_HANDLE_DATA's modules containing module and return if it cannot be found. ]*/
-TEST_FUNCTION(Gateway_LL_RemoveModule_Finds_Module_Data_Failure)
+/*Tests_SRS_GATEWAY_LL_13_024: [If gw or callback is NULL the function shall return a non-zero value.]*/
+TEST_FUNCTION(Gateway_LL_GetStartupTimes_Fails_For_Null_Gateway)
+{
+	//Arrange
+	CGatewayLLMocks mocks;
+
+	//Act
+	int result = Gateway_LL_GetStartupTimes(NULL, record_startup_times, NULL);
+
+	//Assert
+	ASSERT_ARE_NOT_EQUAL(int, 0, result);
+	mocks.AssertActualAndExpectedCalls();
+}
+
+/*Tests_SRS_GATEWAY_LL_13_024: [If gw or callback is NULL the function shall return a non-zero value.]*/
+TEST_FUNCTION(Gateway_LL_GetStartupTimes_Fails_For_Null_Callback)
 {
 	//Arrange
 	CGatewayLLMocks mocks;
 	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
-	MODULE_HANDLE handle = Gateway_LL_AddModule(gw, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
 	mocks.ResetAllCalls();
 
-	//Expectations
-	STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, gw))
-		.IgnoreAllArguments();
-
 	//Act
-	Gateway_LL_RemoveModule(gw, (MODULE_HANDLE)gw);
+	int result = Gateway_LL_GetStartupTimes(gw, NULL, NULL);
 
 	//Assert
+	ASSERT_ARE_NOT_EQUAL(int, 0, result);
 	mocks.AssertActualAndExpectedCalls();
 
 	//Cleanup
 	Gateway_LL_Destroy(gw);
 }
 
-/*Tests_SRS_GATEWAY_LL_14_022: [ If GATEWAY_HANDLE_DATA's bus cannot unlink module, the function shall log the error and continue unloading the module from the GATEWAY_HANDLE. ]*/
-/*Tests_SRS_GATEWAY_LL_14_038: [ The function shall decrement the MESSAGE_BUS_HANDLE reference count. ]*/
-TEST_FUNCTION(Gateway_LL_RemoveModule_MessageBus_RemoveModule_Failure)
+/*Tests_SRS_GATEWAY_LL_13_023: [The function shall measure how long loading the library of the module and creating the module take.]*/
+/*Tests_SRS_GATEWAY_LL_13_025: [The function shall pass the startup times of each module of GATEWAY_HANDLE_DATA's modules to callback along with the module's name, and return 0.]*/
+TEST_FUNCTION(Gateway_LL_GetStartupTimes_Calls_Callback_For_Each_Module)
 {
 	//Arrange
 	CGatewayLLMocks mocks;
 	GATEWAY_HANDLE gw = Gateway_LL_Create(NULL);
-	MODULE_HANDLE handle = Gateway_LL_AddModule(gw, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
+	(void)Gateway_LL_AddModule(gw, (GATEWAY_PROPERTIES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_properties_entries));
+	startup_times_callback_count = 0;
 	mocks.ResetAllCalls();
 
 	//Expectations
-	STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-		.IgnoreAllArguments();
-	whenShallMessageBus_RemoveModule_fail = 1;
-	STRICT_EXPECTED_CALL(mocks, MessageBus_RemoveModule(IGNORED_PTR_ARG, handle))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, MessageBus_DecRef(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_GetModuleAPIs(IGNORED_PTR_ARG))
-		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, mock_Module_Destroy(IGNORED_PTR_ARG))
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, ModuleLoader_Unload(IGNORED_PTR_ARG))
+	STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
 		.IgnoreArgument(1);
-	STRICT_EXPECTED_CALL(mocks, VECTOR_erase(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-		.IgnoreArgument(1)
-		.IgnoreArgument(2);
 
 	//Act
-	Gateway_LL_RemoveModule(gw, handle);
+	int result = Gateway_LL_GetStartupTimes(gw, record_startup_times, NULL);
 
 	//Assert
+	ASSERT_ARE_EQUAL(int, 0, result);
+	ASSERT_ARE_EQUAL(size_t, 1, startup_times_callback_count);
+	ASSERT_ARE_EQUAL(char_ptr, "dummy module", startup_times_callback_names[0]);
 	mocks.AssertActualAndExpectedCalls();
 
 	//Cleanup
@@ -244,6 +244,9 @@ int             json_boolean(const JSON_Value *value);
 #undef parson_parson_h
 #include "parson.h"
 
+/*the bus_config of the properties the last Gateway_LL_Create was called with*/
+static MESSAGE_BUS_CONFIG lastGateway_LL_Create_bus_config;
+
 TYPED_MOCK_CLASS(CGatewayMocks, CGlobalMock)
 {
 public:
@@ -301,6 +304,22 @@ public:
 		}
 	MOCK_METHOD_END(JSON_Value*, value);
 
+	MOCK_STATIC_METHOD_1(, JSON_Array*, json_value_get_array, const JSON_Value*, value)
+		JSON_Array* arr = NULL;
+		if (value != NULL)
+		{
+			arr = (JSON_Array*)0x42;
+		}
+	MOCK_METHOD_END(JSON_Array*, arr);
+
+	MOCK_STATIC_METHOD_2(, JSON_Object*, json_object_get_object, const JSON_Object*, object, const char*, name)
+		JSON_Object* obj = NULL;
+	MOCK_METHOD_END(JSON_Object*, obj);
+
+	MOCK_STATIC_METHOD_2(, double, json_object_get_number, const JSON_Object*, object, const char*, name)
+		double number = 0;
+	MOCK_METHOD_END(double, number);
+
 	MOCK_STATIC_METHOD_1(, char*, json_serialize_to_string, const JSON_Value*, value)
 		char* serialized_string = NULL;
 		const char* text = "[serialized string]";
@@ -321,6 +340,7 @@ public:
 
 	/*Gateway Mocks*/
 	MOCK_STATIC_METHOD_1(, GATEWAY_HANDLE, Gateway_LL_Create, const GATEWAY_PROPERTIES*, properties)
+		lastGateway_LL_Create_bus_config = properties->bus_config;
 		GATEWAY_HANDLE handle = (GATEWAY_HANDLE)BASEIMPLEMENTATION::gballoc_malloc(1);
 	MOCK_METHOD_END(GATEWAY_HANDLE, handle);
 
@@ -328,6 +348,9 @@ public:
 		BASEIMPLEMENTATION::gballoc_free(gw);
 	MOCK_VOID_METHOD_END();
 
+	MOCK_STATIC_METHOD_2(, int, Gateway_LL_Update, GATEWAY_HANDLE, gw, const GATEWAY_PROPERTIES*, properties)
+	MOCK_METHOD_END(int, 0);
+
 	/*Vector Mocks*/
 	MOCK_STATIC_METHOD_1(, VECTOR_HANDLE, VECTOR_create, size_t, elementSize)
 		VECTOR_HANDLE vector = BASEIMPLEMENTATION::VECTOR_create(elementSize);
@@ -363,6 +386,11 @@ public:
 
 	MOCK_STATIC_METHOD_1(, void*, gballoc_malloc, size_t, size)
 		void* result2 = BASEIMPLEMENTATION::gballoc_malloc(size);
+		if (result2 != NULL && size == sizeof(GATEWAY_PROPERTIES))
+		{
+			/*malloc does not zero the properties, so neither do the tests*/
+			memset(result2, 0xA5, size);
+		}
 	MOCK_METHOD_END(void*, result2);
 
 	MOCK_STATIC_METHOD_2(, void*, gballoc_realloc, void*, ptr, size_t, size)
@@ -381,12 +409,16 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , size_t, json_array_get_count, cons
 DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayMocks, , JSON_Object*, json_array_get_object, const JSON_Array*, arr, size_t, index);
 DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayMocks, , const char*, json_object_get_string, const JSON_Object*, object, const char*, name);
 DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayMocks, , JSON_Value*, json_object_get_value, const JSON_Object*, object, const char*, name);
+DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , JSON_Array*, json_value_get_array, const JSON_Value*, value);
+DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayMocks, , JSON_Object*, json_object_get_object, const JSON_Object*, object, const char*, name);
+DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayMocks, , double, json_object_get_number, const JSON_Object*, object, const char*, name);
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , char*, json_serialize_to_string, const JSON_Value*, value);
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , void, json_value_free, JSON_Value*, value);
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , void, json_free_serialized_string, char*, string);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , GATEWAY_HANDLE, Gateway_LL_Create, const GATEWAY_PROPERTIES*, properties);
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , void, Gateway_LL_Destroy, GATEWAY_HANDLE, gw);
+DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayMocks, , int, Gateway_LL_Update, GATEWAY_HANDLE, gw, const GATEWAY_PROPERTIES*, properties);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , VECTOR_HANDLE, VECTOR_create, size_t, elementSize);
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , void, VECTOR_destroy, VECTOR_HANDLE, handle);
@@ -511,6 +543,11 @@ TEST_FUNCTION(Gateway_Create_Parses_Valid_JSON_Configuration_File)
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "module path"))
 		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "queue"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "depends on"))
+		.IgnoreArgument(1)
+		.SetReturn((JSON_Value*)NULL);
 	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "args"))
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, json_serialize_to_string(IGNORED_PTR_ARG))
@@ -525,6 +562,11 @@ TEST_FUNCTION(Gateway_Create_Parses_Valid_JSON_Configuration_File)
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "module path"))
 		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "queue"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "depends on"))
+		.IgnoreArgument(1)
+		.SetReturn((JSON_Value*)NULL);
 	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "args"))
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, json_serialize_to_string(IGNORED_PTR_ARG))
@@ -533,6 +575,14 @@ TEST_FUNCTION(Gateway_Create_Parses_Valid_JSON_Configuration_File)
 		.IgnoreArgument(1)
 		.IgnoreArgument(2);
 
+	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "links"))
+		.IgnoreArgument(1)
+		.SetReturn((JSON_Value*)NULL);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "worker pool"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "startup"))
+		.IgnoreArgument(1);
+
 	STRICT_EXPECTED_CALL(mocks, Gateway_LL_Create(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
@@ -589,6 +639,11 @@ TEST_FUNCTION(Gateway_Create_Traverses_JSON_Value_Success)
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "module path"))
 		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "queue"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "depends on"))
+		.IgnoreArgument(1)
+		.SetReturn((JSON_Value*)NULL);
 	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "args"))
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, json_serialize_to_string(IGNORED_PTR_ARG))
@@ -603,6 +658,11 @@ TEST_FUNCTION(Gateway_Create_Traverses_JSON_Value_Success)
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "module path"))
 		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "queue"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "depends on"))
+		.IgnoreArgument(1)
+		.SetReturn((JSON_Value*)NULL);
 	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "args"))
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, json_serialize_to_string(IGNORED_PTR_ARG))
@@ -611,6 +671,14 @@ TEST_FUNCTION(Gateway_Create_Traverses_JSON_Value_Success)
 		.IgnoreArgument(1)
 		.IgnoreArgument(2);
 
+	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "links"))
+		.IgnoreArgument(1)
+		.SetReturn((JSON_Value*)NULL);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "worker pool"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "startup"))
+		.IgnoreArgument(1);
+
 	STRICT_EXPECTED_CALL(mocks, Gateway_LL_Create(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
@@ -667,6 +735,11 @@ TEST_FUNCTION(Gateway_Create_Traverses_JSON_Push_Back_Fail)
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "module path"))
 		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "queue"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "depends on"))
+		.IgnoreArgument(1)
+		.SetReturn((JSON_Value*)NULL);
 	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "args"))
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, json_serialize_to_string(IGNORED_PTR_ARG))
@@ -681,6 +754,11 @@ TEST_FUNCTION(Gateway_Create_Traverses_JSON_Push_Back_Fail)
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "module path"))
 		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "queue"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "depends on"))
+		.IgnoreArgument(1)
+		.SetReturn((JSON_Value*)NULL);
 	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "args"))
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, json_serialize_to_string(IGNORED_PTR_ARG))
@@ -840,4 +918,345 @@ TEST_FUNCTION(Gateway_Create_Fails_For_Missing_Info_In_JSON_Configuration)
 	mocks.AssertActualAndExpectedCalls();
 }
 
+/*Tests_SRS_GATEWAY_13_002: [The function shall return NULL if "links" is not an array or any of its entries is missing "source" or "sink".]*/
+TEST_FUNCTION(Gateway_Create_Fails_For_Links_Not_An_Array_In_JSON_Configuration)
+{
+	//Arrange
+	CGatewayMocks mocks;
+
+	STRICT_EXPECTED_CALL(mocks, json_parse_file(VALID_JSON_PATH));
+	STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(GATEWAY_PROPERTIES)));
+	STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_array(IGNORED_PTR_ARG, "modules"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+		.SetReturn(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(GATEWAY_PROPERTIES_ENTRY)));
+
+	STRICT_EXPECTED_CALL(mocks, json_array_get_object(IGNORED_PTR_ARG, 0))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "module name"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "module path"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "queue"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "depends on"))
+		.IgnoreArgument(1)
+		.SetReturn((JSON_Value*)NULL);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "args"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_serialize_to_string(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+
+	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "links"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+		.SetReturn((JSON_Array*)NULL);
+
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_free_serialized_string(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+
+	STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+
+	//Act
+	GATEWAY_HANDLE gateway = Gateway_Create_From_JSON(VALID_JSON_PATH);
+
+	//Assert
+	ASSERT_IS_NULL(gateway);
+	mocks.AssertActualAndExpectedCalls();
+}
+
+/*Tests_SRS_GATEWAY_13_007: [The function shall return NULL if the "policy" of a "queue" is not "drop newest", "drop oldest" or "block", or its "capacity" or "timeout" is negative.]*/
+TEST_FUNCTION(Gateway_Create_Fails_For_Unknown_Queue_Policy_In_JSON_Configuration)
+{
+	//Arrange
+	CGatewayMocks mocks;
+
+	STRICT_EXPECTED_CALL(mocks, json_parse_file(VALID_JSON_PATH));
+	STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(GATEWAY_PROPERTIES)));
+	STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_array(IGNORED_PTR_ARG, "modules"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+		.SetReturn(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(GATEWAY_PROPERTIES_ENTRY)));
+
+	STRICT_EXPECTED_CALL(mocks, json_array_get_object(IGNORED_PTR_ARG, 0))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "module name"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "module path"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "queue"))
+		.IgnoreArgument(1)
+		.SetReturn((JSON_Object*)0x42);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_number(IGNORED_PTR_ARG, "capacity"))
+		.IgnoreArgument(1)
+		.SetReturn(10);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "policy"))
+		.IgnoreArgument(1)
+		.SetReturn("drop everything");
+	STRICT_EXPECTED_CALL(mocks, json_object_get_number(IGNORED_PTR_ARG, "timeout"))
+		.IgnoreArgument(1);
+
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+
+	STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+
+	//Act
+	GATEWAY_HANDLE gateway = Gateway_Create_From_JSON(VALID_JSON_PATH);
+
+	//Assert
+	ASSERT_IS_NULL(gateway);
+	mocks.AssertActualAndExpectedCalls();
+}
+
+/*Tests_SRS_GATEWAY_13_016: [The function shall return NULL if the "depends on" of a module is not an array of strings.]*/
+TEST_FUNCTION(Gateway_Create_Fails_For_Depends_On_Not_An_Array_In_JSON_Configuration)
+{
+	//Arrange
+	CGatewayMocks mocks;
+
+	STRICT_EXPECTED_CALL(mocks, json_parse_file(VALID_JSON_PATH));
+	STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(GATEWAY_PROPERTIES)));
+	STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_array(IGNORED_PTR_ARG, "modules"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+		.SetReturn(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(GATEWAY_PROPERTIES_ENTRY)));
+
+	STRICT_EXPECTED_CALL(mocks, json_array_get_object(IGNORED_PTR_ARG, 0))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "module name"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "module path"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "queue"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "depends on"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+		.SetReturn((JSON_Array*)NULL);
+
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+
+	STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+
+	//Act
+	GATEWAY_HANDLE gateway = Gateway_Create_From_JSON(VALID_JSON_PATH);
+
+	//Assert
+	ASSERT_IS_NULL(gateway);
+	mocks.AssertActualAndExpectedCalls();
+}
+
+/*Tests_SRS_GATEWAY_13_013: [The function shall return NULL if the "threads" of the "startup" object is negative.]*/
+TEST_FUNCTION(Gateway_Create_Fails_For_Negative_Startup_Threads_In_JSON_Configuration)
+{
+	//Arrange
+	CGatewayMocks mocks;
+
+	STRICT_EXPECTED_CALL(mocks, json_parse_file(VALID_JSON_PATH));
+	STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(GATEWAY_PROPERTIES)));
+	STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_array(IGNORED_PTR_ARG, "modules"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+		.SetReturn(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(GATEWAY_PROPERTIES_ENTRY)));
+
+	STRICT_EXPECTED_CALL(mocks, json_array_get_object(IGNORED_PTR_ARG, 0))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "module name"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "module path"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "queue"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "depends on"))
+		.IgnoreArgument(1)
+		.SetReturn((JSON_Value*)NULL);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "args"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_serialize_to_string(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+
+	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "links"))
+		.IgnoreArgument(1)
+		.SetReturn((JSON_Value*)NULL);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "worker pool"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "startup"))
+		.IgnoreArgument(1)
+		.SetReturn((JSON_Object*)0x42);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_number(IGNORED_PTR_ARG, "threads"))
+		.IgnoreArgument(1)
+		.SetReturn(-1);
+
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_free_serialized_string(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+
+	STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+
+	//Act
+	GATEWAY_HANDLE gateway = Gateway_Create_From_JSON(VALID_JSON_PATH);
+
+	//Assert
+	ASSERT_IS_NULL(gateway);
+	mocks.AssertActualAndExpectedCalls();
+}
+
+/*Tests_SRS_GATEWAY_13_008: [If the JSON_Value has no "worker pool" object the function shall leave GATEWAY_PROPERTIES's bus_config zeroed so that every module gets its own thread.]*/
+/*Tests_SRS_GATEWAY_13_021: [The function shall set the routing of GATEWAY_PROPERTIES's bus_config to MESSAGE_BUS_ROUTING_AUTOMATIC.]*/
+TEST_FUNCTION(Gateway_Create_Sets_The_Automatic_Routing)
+{
+	//Arrange
+	CGatewayMocks mocks;
+
+	STRICT_EXPECTED_CALL(mocks, json_parse_file(VALID_JSON_PATH));
+	STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(GATEWAY_PROPERTIES)));
+	STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_array(IGNORED_PTR_ARG, "modules"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+		.SetReturn(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(GATEWAY_PROPERTIES_ENTRY)));
+
+	STRICT_EXPECTED_CALL(mocks, json_array_get_object(IGNORED_PTR_ARG, 0))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "module name"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "module path"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "queue"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "depends on"))
+		.IgnoreArgument(1)
+		.SetReturn((JSON_Value*)NULL);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "args"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_serialize_to_string(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+		.IgnoreArgument(1)
+		.IgnoreArgument(2);
+
+	STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "links"))
+		.IgnoreArgument(1)
+		.SetReturn((JSON_Value*)NULL);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "worker pool"))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "startup"))
+		.IgnoreArgument(1);
+
+	STRICT_EXPECTED_CALL(mocks, Gateway_LL_Create(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_free_serialized_string(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+		.IgnoreArgument(1);
+
+	//Act
+	GATEWAY_HANDLE gateway = Gateway_Create_From_JSON(VALID_JSON_PATH);
+
+	//Assert
+	ASSERT_IS_NOT_NULL(gateway);
+	ASSERT_IS_TRUE(!lastGateway_LL_Create_bus_config.use_worker_pool);
+	ASSERT_ARE_EQUAL(size_t, 0, lastGateway_LL_Create_bus_config.worker_count);
+	ASSERT_ARE_EQUAL(int, (int)MESSAGE_BUS_ROUTING_AUTOMATIC, (int)lastGateway_LL_Create_bus_config.routing);
+	mocks.AssertActualAndExpectedCalls();
+
+	//Cleanup
+	Gateway_LL_Destroy(gateway);
+}
+
+/*Tests_SRS_GATEWAY_13_018: [If gw or file_path is NULL the function shall return a non-zero value.]*/
+TEST_FUNCTION(Gateway_UpdateFromJSON_Fails_For_Null_Path)
+{
+	//Arrange
+	CGatewayMocks mocks;
+
+	//Act
+	int result = Gateway_UpdateFromJSON((GATEWAY_HANDLE)0x42, NULL);
+
+	//Assert
+	ASSERT_ARE_NOT_EQUAL(int, 0, result);
+	mocks.AssertActualAndExpectedCalls();
+}
+
+/*Tests_SRS_GATEWAY_13_019: [The function shall read and parse the file into a GATEWAY_PROPERTIES instance as Gateway_Create_From_JSON does, and return a non-zero value without changing the gateway if it cannot.]*/
+TEST_FUNCTION(Gateway_UpdateFromJSON_Does_Not_Update_If_File_Not_Exist)
+{
+	//Arrange
+	CGatewayMocks mocks;
+
+	STRICT_EXPECTED_CALL(mocks, json_parse_file(DUMMY_JSON_PATH))
+		.SetFailReturn((JSON_Value*)NULL);
+
+	//Act
+	int result = Gateway_UpdateFromJSON((GATEWAY_HANDLE)0x42, DUMMY_JSON_PATH);
+
+	//Assert
+	ASSERT_ARE_NOT_EQUAL(int, 0, result);
+	mocks.AssertActualAndExpectedCalls();
+}
+
 END_TEST_SUITE(gateway_unittests)
@@ -178,7 +178,8 @@ BEGIN_TEST_SUITE(gw_e2etests)
 			}
 		}
 		
-		GATEWAY_PROPERTIES_ENTRY modules[3];
+		/*zeroed, so that the module queues have no limit*/
+		GATEWAY_PROPERTIES_ENTRY modules[3] = { 0 };
 
 		modules[0].module_configuration = &iotHubConfig;
 		modules[0].module_name = "IoTHub";
@@ -194,7 +195,7 @@ BEGIN_TEST_SUITE(gw_e2etests)
 		modules[2].module_path = e2e_module_path();
 		
 		
-		GATEWAY_PROPERTIES m6GatewayProperties;
+		GATEWAY_PROPERTIES m6GatewayProperties = { 0 };
 		VECTOR_HANDLE gatewayProps = VECTOR_create(sizeof(GATEWAY_PROPERTIES_ENTRY));
 
 		VECTOR_push_back(gatewayProps, &modules, 3);
@@ -5,6 +5,8 @@
 #ifdef _CRTDBG_MAP_ALLOC
 #include <crtdbg.h>
 #endif
+#include <stdio.h>
+#include <string.h>
 
 #include "testrunnerswitcher.h"
 #include "umock_c.h"
@@ -21,6 +23,7 @@ static TEST_MUTEX_HANDLE g_testByTest;
 static TEST_MUTEX_HANDLE g_dllByDll;
 
 #include "message.h"
+#include "string_intern.h"
 
 static size_t currentmalloc_call;
 static size_t whenShallmalloc_fail;
@@ -66,6 +69,58 @@ static void my_gballoc_free(void* ptr)
     free(ptr);
 }
 
+/*the properties Map_GetInternals reports for any MAP_HANDLE*/
+static const char* const* test_keys;
+static const char* const* test_values;
+static size_t test_property_count;
+
+static MAP_RESULT my_Map_GetInternals(MAP_HANDLE handle, const char*const** keys, const char*const** values, size_t* count)
+{
+    (void)handle;
+    *keys = test_keys;
+    *values = test_values;
+    *count = test_property_count;
+    return MAP_OK;
+}
+
+/*the string intern table is not linked in this test: interning a string returns it, and only the references are counted*/
+static size_t currentStringIntern_Acquire_call;
+static size_t whenShallStringIntern_Acquire_fail;
+static size_t currentStringIntern_refCount;
+
+const char* StringIntern_Acquire(const char* string)
+{
+    const char* result;
+    currentStringIntern_Acquire_call++;
+    if (whenShallStringIntern_Acquire_fail == currentStringIntern_Acquire_call)
+    {
+        result = NULL;
+    }
+    else
+    {
+        result = string;
+        currentStringIntern_refCount++;
+    }
+    return result;
+}
+
+void StringIntern_Release(const char* interned)
+{
+    if (interned != NULL)
+    {
+        currentStringIntern_refCount--;
+    }
+}
+
+/*hashes strings by their length, so that different names get the same hash*/
+static size_t currentStringIntern_Hash_call;
+
+size_t StringIntern_Hash(const char* string)
+{
+    currentStringIntern_Hash_call++;
+    return (string == NULL) ? 0 : strlen(string);
+}
+
 static CONSTMAP_HANDLE my_ConstMap_Create(MAP_HANDLE sourceMap)
 {
     CONSTMAP_HANDLE result2;
@@ -172,6 +227,18 @@ static void my_CONSTBUFFER_Destroy(CONSTBUFFER_HANDLE constbufferHandle)
 #include "azure_c_shared_utility/gballoc.h"
 #undef ENABLE_MOCKS
 
+/*release function of the adopted content*/
+static size_t currentrelease_call;
+static unsigned char* lastrelease_content;
+static void* lastrelease_context;
+
+static void test_release(unsigned char* content, void* context)
+{
+    currentrelease_call++;
+    lastrelease_content = content;
+    lastrelease_context = context;
+}
+
 #ifdef _MSC_VER
 #pragma warning(disable:4505)
 #endif
@@ -329,6 +396,65 @@ static const unsigned char fail_whenThereIsOnly1ByteOfcontentSize[] =
     0x00                    /*not enough bytes for contentSize*/
 };
 
+/*the round trip tests serialize random messages, built by the following functions, into buffers of this size*/
+#define RANDOM_BYTE_ARRAY_SIZE 1024
+
+static size_t put_int32_t(unsigned char* destination, size_t position, size_t value)
+{
+    destination[position + 0] = (value >> 24) & 0xFF;
+    destination[position + 1] = (value >> 16) & 0xFF;
+    destination[position + 2] = (value >> 8) & 0xFF;
+    destination[position + 3] = value & 0xFF;
+    return position + 4;
+}
+
+/*writes count random characters, none of them '\0', followed by '\0'*/
+static size_t put_random_string(unsigned char* destination, size_t position, size_t count)
+{
+    size_t i;
+    for (i = 0; i < count; i++)
+    {
+        destination[position++] = (unsigned char)(1 + (rand() % 255));
+    }
+    destination[position++] = '\0';
+    return position;
+}
+
+/*
+* writes the byte array of a random message: up to 8 properties, whose names
+* end with "#" and their index so that no two are the same, and up to 64
+* bytes of content. Returns the size of the byte array
+*/
+static size_t make_random_byte_array(unsigned char* destination)
+{
+    size_t propertyCount = rand() % 9;
+    size_t contentSize = rand() % 65;
+    size_t position = put_int32_t(destination, 6, propertyCount);
+    size_t i;
+
+    destination[0] = 0xA1;
+    destination[1] = 0x60;
+    for (i = 0; i < propertyCount; i++)
+    {
+        size_t j;
+        size_t nameLength = rand() % 16;
+        for (j = 0; j < nameLength; j++)
+        {
+            /*no '#' in the random part of the name*/
+            destination[position++] = (unsigned char)('a' + (rand() % 26));
+        }
+        position += sprintf((char*)destination + position, "#%u", (unsigned int)i) + 1;
+        position = put_random_string(destination, position, rand() % 24);
+    }
+    position = put_int32_t(destination, position, contentSize);
+    for (i = 0; i < contentSize; i++)
+    {
+        destination[position++] = (unsigned char)(rand() % 256);
+    }
+    (void)put_int32_t(destination, 2, position);
+    return position;
+}
+
 
 
 #define TEST_MAP_HANDLE ((MAP_HANDLE)(1))
@@ -358,6 +484,8 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
         REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
         REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
 
+        REGISTER_GLOBAL_MOCK_HOOK(Map_GetInternals, my_Map_GetInternals);
+
         REGISTER_GLOBAL_MOCK_HOOK(ConstMap_Create, my_ConstMap_Create);
         REGISTER_GLOBAL_MOCK_HOOK(ConstMap_Clone, my_ConstMap_Clone);
         REGISTER_GLOBAL_MOCK_HOOK(ConstMap_Destroy, my_ConstMap_Destroy);
@@ -411,6 +539,17 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
 		currentCONSTBUFFER_Clone_call = 0;
 		whenShallCONSTBUFFER_Clone_fail = 0;
 
+        currentrelease_call = 0;
+        lastrelease_content = NULL;
+        lastrelease_context = NULL;
+
+        test_keys = NULL;
+        test_values = NULL;
+        test_property_count = 0;
+        currentStringIntern_Acquire_call = 0;
+        currentStringIntern_Hash_call = 0;
+        whenShallStringIntern_Acquire_fail = 0;
+        currentStringIntern_refCount = 0;
     }
 
     TEST_FUNCTION_CLEANUP(TestMethodCleanup)
@@ -450,21 +589,22 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
     }
 
     /*Tests_SRS_MESSAGE_02_006: [Otherwise, Message_Create shall return a non-NULL handle and shall set the internal ref count to "1".]*/
-    /*Tests_SRS_MESSAGE_02_019: [Message_Create shall clone the sourceProperties to a readonly CONSTMAP.] */
-	/*Tests_SRS_MESSAGE_17_003: [Message_Create shall copy the source to a readonly CONSTBUFFER.]*/
+    /*Tests_SRS_MESSAGE_02_019: [Message_Create shall copy the names and values of the sourceProperties, read with Map_GetInternals, to the message.]*/
+	/*Tests_SRS_MESSAGE_17_003: [Message_Create shall copy the source to the readonly content of the message.]*/
+	/*Tests_SRS_MESSAGE_13_001: [Message_Create shall allocate the message, its properties and the copy of its content in a single block of memory, with MessagePool_Allocate.]*/
     TEST_FUNCTION(Message_Create_happy_path)
     {
         ///arrange
         unsigned char fake;
         MESSAGE_CONFIG c = { 1, &fake, (MAP_HANDLE)&fake};
 
+        STRICT_EXPECTED_CALL(Map_GetInternals((MAP_HANDLE)&fake, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is reading the properties*/
+            .IgnoreArgument_keys()
+            .IgnoreArgument_values()
+            .IgnoreArgument_count();
         STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the structure*/
             .IgnoreArgument(1);
 
-		STRICT_EXPECTED_CALL(CONSTBUFFER_Create(&fake, 1)); /*this is copying the buffer*/
-
-		STRICT_EXPECTED_CALL(ConstMap_Create((MAP_HANDLE)&fake)); /*this is copying the properties*/
-
         ///act
         MESSAGE_HANDLE r = Message_Create(&c);
 
@@ -483,13 +623,13 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
         unsigned char fake;
         MESSAGE_CONFIG c = { 0, &fake, (MAP_HANDLE)&fake };
 
+        STRICT_EXPECTED_CALL(Map_GetInternals((MAP_HANDLE)&fake, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is reading the properties*/
+            .IgnoreArgument_keys()
+            .IgnoreArgument_values()
+            .IgnoreArgument_count();
         STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the structure*/
             .IgnoreArgument(1);
 
-		STRICT_EXPECTED_CALL(CONSTBUFFER_Create(&fake, 0)); /* this is copying the (empty buffer)*/
-
-		STRICT_EXPECTED_CALL(ConstMap_Create((MAP_HANDLE)&fake)); /*this is copying the properties*/
-
         ///act
         MESSAGE_HANDLE r = Message_Create(&c);
 
@@ -508,13 +648,13 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
         unsigned char fake;
         MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&fake }; /*<---- this is NULL , in the testbefore it was non-NULL*/
 
+        STRICT_EXPECTED_CALL(Map_GetInternals((MAP_HANDLE)&fake, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is reading the properties*/
+            .IgnoreArgument_keys()
+            .IgnoreArgument_values()
+            .IgnoreArgument_count();
         STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the structure*/
             .IgnoreArgument(1);
 
-		STRICT_EXPECTED_CALL(CONSTBUFFER_Create(NULL, 0)); /* this is copying the (empty buffer)*/
-
-		STRICT_EXPECTED_CALL(ConstMap_Create((MAP_HANDLE)&fake)); /*this is copying the properties*/
-
         ///act
         MESSAGE_HANDLE r = Message_Create(&c);
 
@@ -527,27 +667,18 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
     }
 
     /*Tests_SRS_MESSAGE_02_005: [If Message_Create encounters an error while building the internal structures of the message, then it shall return NULL.]*/
-    TEST_FUNCTION(Message_Create_zero_size_fails_when_Map_Clone_fails)
+    TEST_FUNCTION(Message_Create_zero_size_fails_when_Map_GetInternals_fails)
     {
         ///arrange
         unsigned char fake;
         MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&fake }; /*<---- this is NULL , in the testbefore it was non-NULL*/
 
-        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the structure*/
-            .IgnoreArgument(1);
-        {
-            STRICT_EXPECTED_CALL(CONSTBUFFER_Create(NULL, 0)); /* this is copying the (empty buffer)*/
-            {
-                whenShallConstMap_Create_fail = 1;
-                STRICT_EXPECTED_CALL(ConstMap_Create((MAP_HANDLE)&fake)) /*this is copying the properties*/
-                    .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(Map_GetInternals((MAP_HANDLE)&fake, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is reading the properties*/
+            .IgnoreArgument_keys()
+            .IgnoreArgument_values()
+            .IgnoreArgument_count()
+            .SetReturn(MAP_ERROR);
 
-                STRICT_EXPECTED_CALL(CONSTBUFFER_Destroy(IGNORED_PTR_ARG)) /* this is copying the (empty buffer)*/
-                    .IgnoreArgument(1);
-            }
-            STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
-                .IgnoreArgument(1);
-        }
         ///act
         MESSAGE_HANDLE r = Message_Create(&c);
 
@@ -566,6 +697,10 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
         MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&fake }; /*<---- this is NULL , in the testbefore it was non-NULL*/
 
         whenShallmalloc_fail = 1;
+        STRICT_EXPECTED_CALL(Map_GetInternals((MAP_HANDLE)&fake, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is reading the properties*/
+            .IgnoreArgument_keys()
+            .IgnoreArgument_values()
+            .IgnoreArgument_count();
         STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the structure*/
             .IgnoreArgument(1);
 
@@ -580,27 +715,18 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
     }
 
     /*Tests_SRS_MESSAGE_02_005: [If Message_Create encounters an error while building the internal structures of the message, then it shall return NULL.]*/
-    TEST_FUNCTION(Message_Create_nonzero_size_fails_when_Map_Clone_fails)
+    TEST_FUNCTION(Message_Create_nonzero_size_fails_when_Map_GetInternals_fails)
     {
         ///arrange
         unsigned char fake;
         MESSAGE_CONFIG c = { 1, &fake, (MAP_HANDLE)&fake };
 
-        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the structure*/
-            .IgnoreArgument(1);
-        {
-            STRICT_EXPECTED_CALL(CONSTBUFFER_Create(&fake, 1)); /* this is copying the buffer*/
-            {
-
-                whenShallConstMap_Create_fail = 1;
-                STRICT_EXPECTED_CALL(ConstMap_Create((MAP_HANDLE)&fake)); /*this is copying the properties*/
+        STRICT_EXPECTED_CALL(Map_GetInternals((MAP_HANDLE)&fake, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is reading the properties*/
+            .IgnoreArgument_keys()
+            .IgnoreArgument_values()
+            .IgnoreArgument_count()
+            .SetReturn(MAP_ERROR);
 
-                STRICT_EXPECTED_CALL(CONSTBUFFER_Destroy(IGNORED_PTR_ARG))
-                    .IgnoreArgument(1);
-            }
-            STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
-                .IgnoreArgument(1);
-        }
         ///act
         MESSAGE_HANDLE r = Message_Create(&c);
 
@@ -612,27 +738,34 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
     }
 
     /*Tests_SRS_MESSAGE_02_005: [If Message_Create encounters an error while building the internal structures of the message, then it shall return NULL.]*/
-    TEST_FUNCTION(Message_Create_nonzero_size_fails_when_CONSTBUFFER_fails_1)
+    TEST_FUNCTION(Message_Create_nonzero_size_fails_when_StringIntern_Acquire_fails)
     {
         ///arrange
         unsigned char fake;
         MESSAGE_CONFIG c = { 1, &fake, (MAP_HANDLE)&fake };
-
+        const char* keys[] = { "macAddress", "source" };
+        const char* values[] = { "01:02:03:03:02:01", "bleTelemetry" };
+        test_keys = keys;
+        test_values = values;
+        test_property_count = 2;
+
+        whenShallStringIntern_Acquire_fail = 2; /*the name of the second property*/
+        STRICT_EXPECTED_CALL(Map_GetInternals((MAP_HANDLE)&fake, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is reading the properties*/
+            .IgnoreArgument_keys()
+            .IgnoreArgument_values()
+            .IgnoreArgument_count();
         STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the structure*/
             .IgnoreArgument(1);
-
-        whenShallCONSTBUFFER_Create_fail = 1;
-        STRICT_EXPECTED_CALL(CONSTBUFFER_Create(&fake, 1)); /* this is copying the buffer*/
         STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-
         ///act
         MESSAGE_HANDLE r = Message_Create(&c);
 
         ///assert
         ASSERT_IS_NULL(r);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, 0, currentStringIntern_refCount);
 
         ///cleanup
     }
@@ -645,6 +778,10 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
         MESSAGE_CONFIG c = { 1, &fake, (MAP_HANDLE)&fake };
 
         whenShallmalloc_fail = 1;
+        STRICT_EXPECTED_CALL(Map_GetInternals((MAP_HANDLE)&fake, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is reading the properties*/
+            .IgnoreArgument_keys()
+            .IgnoreArgument_values()
+            .IgnoreArgument_count();
         STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the structure*/
             .IgnoreArgument(1);
 
@@ -725,8 +862,9 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
 	}
 
 	/*Tests_SRS_MESSAGE_17_014: [On success, Message_CreateFromBuffer shall return a non-NULL handle and set the internal ref count to "1".]*/
-	/*Tests_SRS_MESSAGE_17_012: [Message_CreateFromBuffer shall copy the sourceProperties to a readonly CONSTMAP.]*/
+	/*Tests_SRS_MESSAGE_17_012: [Message_CreateFromBuffer shall copy the names and values of the sourceProperties to the message, the names acquired from the string intern table.]*/
 	/*Tests_SRS_MESSAGE_17_013: [Message_CreateFromBuffer shall clone the CONSTBUFFER sourceBuffer.]*/
+	/*Tests_SRS_MESSAGE_13_003: [Message_CreateFromBuffer shall use the CONSTBUFFER returned by CONSTBUFFER_GetContent as the content of the message.]*/
 	TEST_FUNCTION(Message_CreateFromBuffer_Success)
 	{
 		///arrange
@@ -740,13 +878,15 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
 
 		umock_c_reset_all_calls();
 
+		STRICT_EXPECTED_CALL(Map_GetInternals((MAP_HANDLE)&fake, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is reading the properties*/
+			.IgnoreArgument_keys()
+			.IgnoreArgument_values()
+			.IgnoreArgument_count();
 		STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the structure*/
 			.IgnoreArgument(1);
 
 		STRICT_EXPECTED_CALL(CONSTBUFFER_Clone(buffer)); /*this is copying the buffer*/
-
-		STRICT_EXPECTED_CALL(ConstMap_Create((MAP_HANDLE)&fake)); /*this is copying the properties*/
-
+		STRICT_EXPECTED_CALL(CONSTBUFFER_GetContent(buffer));
 
 		///act
 		MESSAGE_HANDLE r = Message_CreateFromBuffer(&cfg);
@@ -754,6 +894,7 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
 		///assert
 		ASSERT_IS_NOT_NULL(r);
 		ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+		ASSERT_ARE_EQUAL(void_ptr, (void*)CONSTBUFFER_GetContent(buffer)->buffer, (void*)Message_GetContent(r)->buffer);
 
 		///cleanup
 		Message_Destroy(r);
@@ -777,6 +918,10 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
 
 		umock_c_reset_all_calls();
 
+		STRICT_EXPECTED_CALL(Map_GetInternals((MAP_HANDLE)&fake, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is reading the properties*/
+			.IgnoreArgument_keys()
+			.IgnoreArgument_values()
+			.IgnoreArgument_count();
 		STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the structure*/
 			.IgnoreArgument(1);
 
@@ -804,9 +949,19 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
 			(MAP_HANDLE)&fake
 		};
 
+		const char* keys[] = { "macAddress" };
+		const char* values[] = { "01:02:03:03:02:01" };
+		test_keys = keys;
+		test_values = values;
+		test_property_count = 1;
+
 		whenShallCONSTBUFFER_Clone_fail = 1;
 		umock_c_reset_all_calls();
 
+		STRICT_EXPECTED_CALL(Map_GetInternals((MAP_HANDLE)&fake, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is reading the properties*/
+			.IgnoreArgument_keys()
+			.IgnoreArgument_values()
+			.IgnoreArgument_count();
 		STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the structure*/
 			.IgnoreArgument(1);
 
@@ -820,6 +975,7 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
 		///assert
 		ASSERT_IS_NULL(r);
 		ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+		ASSERT_ARE_EQUAL(size_t, 0, currentStringIntern_refCount);
 
 		//cleanup
 		CONSTBUFFER_Destroy(buffer);
@@ -837,23 +993,13 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
 			(MAP_HANDLE)&fake
 		};
 
-		whenShallConstMap_Create_fail = 1;
 		umock_c_reset_all_calls();
 
-		STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the structure*/
-			.IgnoreArgument(1);
-        {
-            
-            STRICT_EXPECTED_CALL(CONSTBUFFER_Clone(buffer)); /*this is copying the buffer*/
-            {
-                STRICT_EXPECTED_CALL(ConstMap_Create((MAP_HANDLE)&fake)); /*this is copying the properties*/
-                STRICT_EXPECTED_CALL(CONSTBUFFER_Destroy(buffer));
-            }
-
-            STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
-                .IgnoreArgument(1);
-        }
-
+		STRICT_EXPECTED_CALL(Map_GetInternals((MAP_HANDLE)&fake, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is reading the properties*/
+			.IgnoreArgument_keys()
+			.IgnoreArgument_values()
+			.IgnoreArgument_count()
+			.SetReturn(MAP_ERROR);
 
 		///act
 		MESSAGE_HANDLE r = Message_CreateFromBuffer(&cfg);
@@ -882,8 +1028,7 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
     }
 
     /*Tests_SRS_MESSAGE_02_010: [Message_Clone shall return messageHandle.]*/
-	/*Tests_SRS_MESSAGE_17_001: [Message_Clone shall clone the CONSTMAP handle.]*/
-	/*Tests_SRS_MESSAGE_17_004: [Message_Clone shall clone the CONSTBUFFER handle]*/
+	/*Tests_SRS_MESSAGE_13_004: [Message_Clone shall not clone the content nor the properties, which belong to the message until its ref count is zero.]*/
     TEST_FUNCTION(Message_Clone_increments_ref_count_1)
     {
         ///arrange
@@ -891,11 +1036,6 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
         MESSAGE_HANDLE aMessage = Message_Create(&c);
         umock_c_reset_all_calls();
 
-		STRICT_EXPECTED_CALL(ConstMap_Clone(IGNORED_PTR_ARG))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(CONSTBUFFER_Clone(IGNORED_PTR_ARG))
-			.IgnoreArgument(1);
-
         ///act
         MESSAGE_HANDLE r = Message_Clone(aMessage);
 
@@ -917,11 +1057,6 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
         MESSAGE_HANDLE r = Message_Clone(aMessage);
         umock_c_reset_all_calls();
 
-		STRICT_EXPECTED_CALL(ConstMap_Destroy(IGNORED_PTR_ARG))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(CONSTBUFFER_Destroy(IGNORED_PTR_ARG))
-			.IgnoreArgument(1);
-
         ///act
         Message_Destroy(r);
 
@@ -942,10 +1077,6 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
         Message_Destroy(r);
         umock_c_reset_all_calls();
 
-        STRICT_EXPECTED_CALL(ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(CONSTBUFFER_Destroy(IGNORED_PTR_ARG))
-			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*only 1 because the message is 0 size*/
 			.IgnoreArgument(1);
 
@@ -975,13 +1106,26 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
     }
 
     /*Tests_SRS_MESSAGE_02_012: [Otherwise, Message_GetProperties shall shall clone and return the CONSTMAP handle representing the properties of the message.]*/
+    /*Tests_SRS_MESSAGE_13_015: [If the message has no CONSTMAP yet, Message_GetProperties shall create one with the names and values of its properties and keep it until the ref count of the message is zero.]*/
     TEST_FUNCTION(Message_GetProperties_happy_path)
     {
         ///arrange
         MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&c };
+        const char* keys[] = { "macAddress", "source" };
+        const char* values[] = { "01:02:03:03:02:01", "bleTelemetry" };
+        test_keys = keys;
+        test_values = values;
+        test_property_count = 2;
         MESSAGE_HANDLE aMessage = Message_Create(&c);
         umock_c_reset_all_calls();
 
+        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument_mapFilterFunc()
+            .SetReturn(TEST_MAP_HANDLE);
+        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, "macAddress", "01:02:03:03:02:01"));
+        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, "source", "bleTelemetry"));
+        STRICT_EXPECTED_CALL(ConstMap_Create(TEST_MAP_HANDLE));
+        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
 		STRICT_EXPECTED_CALL(ConstMap_Clone(IGNORED_PTR_ARG)).IgnoreArgument(1);
 
         ///act
@@ -996,531 +1140,1649 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
 		ConstMap_Destroy(theProperties);
     }
 
-    /*Tests_SRS_MESSAGE_02_013: [If message is NULL then Message_GetContent shall return NULL.] */
-    TEST_FUNCTION(Message_GetContent_with_NULL_message_returns_NULL)
+    /*Tests_SRS_MESSAGE_13_015: [If the message has no CONSTMAP yet, Message_GetProperties shall create one with the names and values of its properties and keep it until the ref count of the message is zero.]*/
+    TEST_FUNCTION(Message_GetProperties_second_call_only_clones)
     {
         ///arrange
+        MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&c };
+        MESSAGE_HANDLE aMessage = Message_Create(&c);
+        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument_mapFilterFunc()
+            .SetReturn(TEST_MAP_HANDLE);
+        CONSTMAP_HANDLE first = Message_GetProperties(aMessage);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(ConstMap_Clone(first));
 
         ///act
-        const CONSTBUFFER* content = Message_GetContent(NULL);
+        CONSTMAP_HANDLE theProperties = Message_GetProperties(aMessage);
 
         ///assert
-        ASSERT_IS_NULL(content);
+        ASSERT_ARE_EQUAL(void_ptr, first, theProperties);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         ///cleanup
+        ConstMap_Destroy(theProperties);
+        ConstMap_Destroy(first);
+        Message_Destroy(aMessage);
     }
 
-    /*Tests_SRS_MESSAGE_02_014: [Otherwise, Message_GetContent shall return a non-NULL const pointer to a structure of type CONSTBUFFER.]*/
-    /*Tests_SRS_MESSAGE_02_015: [The MESSAGE_CONTENT's field size shall have the same value as the cfg's field size.]*/
-    /*Tests_SRS_MESSAGE_02_016: [The MESSAGE_CONTENT's field data shall compare equal byte-by-byte to the cfg's field source.]*/
-    TEST_FUNCTION(Message_GetContent_with_non_NULL_message_zero_size_succeeds)
+    /*Tests_SRS_MESSAGE_13_016: [If creating the CONSTMAP fails, Message_GetProperties shall return NULL.]*/
+    TEST_FUNCTION(Message_GetProperties_fails_when_Map_Create_fails)
     {
         ///arrange
-        MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&c};
-        MESSAGE_HANDLE msg = Message_Create(&c);
+        MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&c };
+        MESSAGE_HANDLE aMessage = Message_Create(&c);
         umock_c_reset_all_calls();
 
-		STRICT_EXPECTED_CALL(CONSTBUFFER_GetContent(IGNORED_PTR_ARG))
-			.IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument_mapFilterFunc()
+            .SetReturn(NULL);
 
         ///act
-        const CONSTBUFFER* content = Message_GetContent(msg);
+        CONSTMAP_HANDLE theProperties = Message_GetProperties(aMessage);
 
         ///assert
-        ASSERT_IS_NOT_NULL(content);
-        ASSERT_ARE_EQUAL(size_t, 0, content->size);
-        ASSERT_IS_NULL(content->buffer);
+        ASSERT_IS_NULL(theProperties);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         ///cleanup
-        Message_Destroy(msg);
+        Message_Destroy(aMessage);
     }
 
-    /*Tests_SRS_MESSAGE_02_014: [Otherwise, Message_GetContent shall return a non-NULL const pointer to a structure of type CONSTBUFFER.]*/
-    /*Tests_SRS_MESSAGE_02_015: [The MESSAGE_CONTENT's field size shall have the same value as the cfg's field size.]*/
-    /*Tests_SRS_MESSAGE_02_016: [The MESSAGE_CONTENT's field data shall compare equal byte-by-byte to the cfg's field source.]*/
-    TEST_FUNCTION(Message_GetContent_with_non_NULL_message_nonzero_size_succeeds)
+    /*Tests_SRS_MESSAGE_13_016: [If creating the CONSTMAP fails, Message_GetProperties shall return NULL.]*/
+    TEST_FUNCTION(Message_GetProperties_fails_when_Map_Add_fails)
     {
         ///arrange
-        char t ='3';
-        MESSAGE_CONFIG c = { sizeof(t), (unsigned char*)&t, (MAP_HANDLE)&c};
-        MESSAGE_HANDLE msg = Message_Create(&c);
+        MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&c };
+        const char* keys[] = { "macAddress" };
+        const char* values[] = { "01:02:03:03:02:01" };
+        test_keys = keys;
+        test_values = values;
+        test_property_count = 1;
+        MESSAGE_HANDLE aMessage = Message_Create(&c);
         umock_c_reset_all_calls();
 
-		STRICT_EXPECTED_CALL(CONSTBUFFER_GetContent(IGNORED_PTR_ARG))
-			.IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument_mapFilterFunc()
+            .SetReturn(TEST_MAP_HANDLE);
+        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, "macAddress", "01:02:03:03:02:01"))
+            .SetReturn(MAP_ERROR);
+        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
 
         ///act
-        const CONSTBUFFER* content = Message_GetContent(msg);
+        CONSTMAP_HANDLE theProperties = Message_GetProperties(aMessage);
 
         ///assert
-        ASSERT_IS_NOT_NULL(content);
-        ASSERT_ARE_EQUAL(size_t, 1, content->size);
-        ASSERT_ARE_EQUAL(int, 0, memcmp(content->buffer, &t, 1));
+        ASSERT_IS_NULL(theProperties);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         ///cleanup
-        Message_Destroy(msg);
+        Message_Destroy(aMessage);
     }
 
-	/*Tests_SRS_MESSAGE_17_006: [If message is NULL then Message_GetContentHandle shall return NULL.]*/
-	TEST_FUNCTION(Message_GetContentHandle_with_NULL_message_returns_NULL)
-	{
-		///arrange
-
-		///act
-		CONSTBUFFER_HANDLE content = Message_GetContentHandle(NULL);
+    /*Tests_SRS_MESSAGE_13_016: [If creating the CONSTMAP fails, Message_GetProperties shall return NULL.]*/
+    TEST_FUNCTION(Message_GetProperties_fails_when_ConstMap_Create_fails)
+    {
+        ///arrange
+        MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&c };
+        MESSAGE_HANDLE aMessage = Message_Create(&c);
+        umock_c_reset_all_calls();
 
-		///assert
-		ASSERT_IS_NULL(content);
-		ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        whenShallConstMap_Create_fail = 1;
+        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument_mapFilterFunc()
+            .SetReturn(TEST_MAP_HANDLE);
+        STRICT_EXPECTED_CALL(ConstMap_Create(TEST_MAP_HANDLE));
+        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
 
-		///cleanup
-	}
+        ///act
+        CONSTMAP_HANDLE theProperties = Message_GetProperties(aMessage);
 
-	/*Tests_SRS_MESSAGE_17_007: [Otherwise, Message_GetContentHandle shall shall clone and return the CONSTBUFFER_HANDLE representing the message content.]*/
-	TEST_FUNCTION(Message_GetContentHandle_with_non_NULL_message_zero_size_succeeds)
-	{
-		///arrange
-		MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&c};
-		MESSAGE_HANDLE msg = Message_Create(&c);
-		umock_c_reset_all_calls();
+        ///assert
+        ASSERT_IS_NULL(theProperties);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-		STRICT_EXPECTED_CALL(CONSTBUFFER_Clone(IGNORED_PTR_ARG))
-			.IgnoreArgument(1);
+        ///cleanup
+        Message_Destroy(aMessage);
+    }
 
-		///act
-        CONSTBUFFER_HANDLE content = Message_GetContentHandle(msg);
+    /*Tests_SRS_MESSAGE_13_002: [Message_Create shall store the names of the properties acquired from the string intern table with StringIntern_Acquire, and copies of their values in the message.]*/
+    TEST_FUNCTION(Message_Create_acquires_the_names_and_copies_the_values_of_the_properties)
+    {
+        ///arrange
+        MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&c };
+        const char* keys[] = { "macAddress", "source" };
+        const char* values[] = { "01:02:03:03:02:01", "bleTelemetry" };
+        test_keys = keys;
+        test_values = values;
+        test_property_count = 2;
 
-		///assert
-		ASSERT_IS_NOT_NULL(content);
-		ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ///act
+        MESSAGE_HANDLE aMessage = Message_Create(&c);
 
-		const CONSTBUFFER * contentBuffer = CONSTBUFFER_GetContent(content);
-		ASSERT_ARE_EQUAL(size_t, 0, contentBuffer->size);
-		ASSERT_IS_NULL(contentBuffer->buffer);
+        ///assert
+        ASSERT_IS_NOT_NULL(aMessage);
+        ASSERT_ARE_EQUAL(size_t, 2, currentStringIntern_refCount);
+        ASSERT_IS_TRUE(Message_GetProperty(aMessage, "macAddress") != values[0]);
+        ASSERT_ARE_EQUAL(char_ptr, "01:02:03:03:02:01", Message_GetProperty(aMessage, "macAddress"));
+        ASSERT_ARE_EQUAL(char_ptr, "bleTelemetry", Message_GetProperty(aMessage, "source"));
 
-		///cleanup
-		Message_Destroy(msg);
-		CONSTBUFFER_Destroy(content);
+        ///cleanup
+        Message_Destroy(aMessage);
+    }
 
-	}
+    /*Tests_SRS_MESSAGE_13_017: [If message or name is NULL then Message_GetProperty shall return NULL.]*/
+    TEST_FUNCTION(Message_GetProperty_with_NULL_message_returns_NULL)
+    {
+        ///arrange
 
-	/*Tests_SRS_MESSAGE_17_007: [Otherwise, Message_GetContentHandle shall shall clone and return the CONSTBUFFER_HANDLE representing the message content.]*/
-	TEST_FUNCTION(Message_GetContentHandle_with_non_NULL_message_nonzero_size_succeeds)
-	{
-		///arrange
-		char t = '3';
-		MESSAGE_CONFIG c = { sizeof(t), (unsigned char*)&t, (MAP_HANDLE)&c};
-		MESSAGE_HANDLE msg = Message_Create(&c);
-		umock_c_reset_all_calls();
+        ///act
+        const char* value = Message_GetProperty(NULL, "source");
 
-		STRICT_EXPECTED_CALL(CONSTBUFFER_Clone(IGNORED_PTR_ARG))
-			.IgnoreArgument(1);
+        ///assert
+        ASSERT_IS_NULL(value);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-		///act
-        CONSTBUFFER_HANDLE content = Message_GetContentHandle(msg);
+        ///cleanup
+    }
 
-		///assert
-		ASSERT_IS_NOT_NULL(content);
-		ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    /*Tests_SRS_MESSAGE_13_017: [If message or name is NULL then Message_GetProperty shall return NULL.]*/
+    TEST_FUNCTION(Message_GetProperty_with_NULL_name_returns_NULL)
+    {
+        ///arrange
+        MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&c };
+        MESSAGE_HANDLE aMessage = Message_Create(&c);
+        umock_c_reset_all_calls();
 
-		const CONSTBUFFER * contentBuffer = CONSTBUFFER_GetContent(content);
-		ASSERT_ARE_EQUAL(size_t, 1, contentBuffer->size);
-		ASSERT_ARE_EQUAL(int, 0, memcmp(contentBuffer->buffer, &t, 1));
+        ///act
+        const char* value = Message_GetProperty(aMessage, NULL);
+
+        ///assert
+        ASSERT_IS_NULL(value);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+        Message_Destroy(aMessage);
+    }
+
+    /*Tests_SRS_MESSAGE_13_018: [Message_GetProperty shall return the value of the property called name, or NULL if the message has no such property.]*/
+    TEST_FUNCTION(Message_GetProperty_returns_the_value_of_the_property)
+    {
+        ///arrange
+        MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&c };
+        const char* keys[] = { "macAddress", "source" };
+        const char* values[] = { "01:02:03:03:02:01", "bleTelemetry" };
+        char name[] = "source";
+        test_keys = keys;
+        test_values = values;
+        test_property_count = 2;
+        MESSAGE_HANDLE aMessage = Message_Create(&c);
+        umock_c_reset_all_calls();
+
+        ///act
+        const char* value = Message_GetProperty(aMessage, name);
+
+        ///assert
+        ASSERT_ARE_EQUAL(char_ptr, "bleTelemetry", value);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+        Message_Destroy(aMessage);
+    }
+
+    /*Tests_SRS_MESSAGE_13_018: [Message_GetProperty shall return the value of the property called name, or NULL if the message has no such property.]*/
+    TEST_FUNCTION(Message_GetProperty_returns_NULL_for_a_missing_property)
+    {
+        ///arrange
+        MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&c };
+        const char* keys[] = { "macAddress" };
+        const char* values[] = { "01:02:03:03:02:01" };
+        test_keys = keys;
+        test_values = values;
+        test_property_count = 1;
+        MESSAGE_HANDLE aMessage = Message_Create(&c);
+        umock_c_reset_all_calls();
+
+        ///act
+        const char* value = Message_GetProperty(aMessage, "macAddres");
+
+        ///assert
+        ASSERT_IS_NULL(value);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+        Message_Destroy(aMessage);
+    }
+
+    /*Tests_SRS_MESSAGE_13_019: [Message_GetProperty shall compare name to the interned names of the properties by pointer before comparing their characters.]*/
+    TEST_FUNCTION(Message_GetProperty_finds_an_interned_name_by_pointer)
+    {
+        ///arrange
+        MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&c };
+        const char* keys[] = { "source" };
+        const char* values[] = { "bleTelemetry" };
+        test_keys = keys;
+        test_values = values;
+        test_property_count = 1;
+        MESSAGE_HANDLE aMessage = Message_Create(&c);
+        umock_c_reset_all_calls();
+
+        ///act
+        const char* value = Message_GetProperty(aMessage, keys[0]);
+
+        ///assert
+        ASSERT_ARE_EQUAL(char_ptr, values[0], value);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+        Message_Destroy(aMessage);
+    }
+
+    /*Tests_SRS_MESSAGE_13_020: [Message_Create shall index the properties by the hash of their names, computed with StringIntern_Hash.]*/
+    TEST_FUNCTION(Message_Create_hashes_the_names_of_the_properties)
+    {
+        ///arrange
+        MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&c };
+        const char* keys[] = { "macAddress", "source", "timestamp" };
+        const char* values[] = { "01:02:03:03:02:01", "bleTelemetry", "2016-09-06T12:00:00" };
+        test_keys = keys;
+        test_values = values;
+        test_property_count = 3;
+
+        ///act
+        MESSAGE_HANDLE aMessage = Message_Create(&c);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(aMessage);
+        ASSERT_ARE_EQUAL(size_t, 3, currentStringIntern_Hash_call);
+
+        ///cleanup
+        Message_Destroy(aMessage);
+    }
+
+    /*Tests_SRS_MESSAGE_13_021: [Message_GetProperty shall hash name with StringIntern_Hash and only compare it to the names of the properties with the same hash.]*/
+    TEST_FUNCTION(Message_GetProperty_hashes_the_name_once)
+    {
+        ///arrange
+        MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&c };
+        const char* keys[] = { "macAddress", "source", "timestamp" };
+        const char* values[] = { "01:02:03:03:02:01", "bleTelemetry", "2016-09-06T12:00:00" };
+        test_keys = keys;
+        test_values = values;
+        test_property_count = 3;
+        MESSAGE_HANDLE aMessage = Message_Create(&c);
+        currentStringIntern_Hash_call = 0;
+
+        ///act
+        const char* value = Message_GetProperty(aMessage, "timestamp");
+
+        ///assert
+        ASSERT_ARE_EQUAL(char_ptr, "2016-09-06T12:00:00", value);
+        ASSERT_ARE_EQUAL(size_t, 1, currentStringIntern_Hash_call);
+
+        ///cleanup
+        Message_Destroy(aMessage);
+    }
+
+    /*Tests_SRS_MESSAGE_13_021: [Message_GetProperty shall hash name with StringIntern_Hash and only compare it to the names of the properties with the same hash.]*/
+    TEST_FUNCTION(Message_GetProperty_tells_apart_names_with_the_same_hash)
+    {
+        ///arrange
+        MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&c };
+        /*the fake StringIntern_Hash hashes macAddress and deviceName the same, and timestamp and deviceKey the same*/
+        const char* keys[] = { "timestamp", "macAddress", "source", "deviceName", "deviceKey" };
+        const char* values[] = { "2016-09-06T12:00:00", "01:02:03:03:02:01", "mapping", "device1", "key1" };
+        size_t i;
+        test_keys = keys;
+        test_values = values;
+        test_property_count = 5;
+        MESSAGE_HANDLE aMessage = Message_Create(&c);
+        umock_c_reset_all_calls();
+
+        ///act
+        ///assert
+        for (i = 0; i < 5; i++)
+        {
+            char name[16];
+            (void)strcpy(name, keys[i]);
+            ASSERT_ARE_EQUAL(char_ptr, values[i], Message_GetProperty(aMessage, name));
+        }
+        ASSERT_IS_NULL(Message_GetProperty(aMessage, "deviceNamf"));
+        ASSERT_IS_NULL(Message_GetProperty(aMessage, "messageId"));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+        Message_Destroy(aMessage);
+    }
+
+    /*Tests_SRS_MESSAGE_02_013: [If message is NULL then Message_GetContent shall return NULL.] */
+    TEST_FUNCTION(Message_GetContent_with_NULL_message_returns_NULL)
+    {
+        ///arrange
+
+        ///act
+        const CONSTBUFFER* content = Message_GetContent(NULL);
+
+        ///assert
+        ASSERT_IS_NULL(content);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_02_014: [Otherwise, Message_GetContent shall return a non-NULL const pointer to a structure of type CONSTBUFFER.]*/
+    /*Tests_SRS_MESSAGE_02_015: [The MESSAGE_CONTENT's field size shall have the same value as the cfg's field size.]*/
+    /*Tests_SRS_MESSAGE_02_016: [The MESSAGE_CONTENT's field data shall compare equal byte-by-byte to the cfg's field source.]*/
+    TEST_FUNCTION(Message_GetContent_with_non_NULL_message_zero_size_succeeds)
+    {
+        ///arrange
+        MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&c};
+        MESSAGE_HANDLE msg = Message_Create(&c);
+        umock_c_reset_all_calls();
+
+        ///act
+        const CONSTBUFFER* content = Message_GetContent(msg);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(content);
+        ASSERT_ARE_EQUAL(size_t, 0, content->size);
+        ASSERT_IS_NULL(content->buffer);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+        Message_Destroy(msg);
+    }
+
+    /*Tests_SRS_MESSAGE_02_014: [Otherwise, Message_GetContent shall return a non-NULL const pointer to a structure of type CONSTBUFFER.]*/
+    /*Tests_SRS_MESSAGE_02_015: [The MESSAGE_CONTENT's field size shall have the same value as the cfg's field size.]*/
+    /*Tests_SRS_MESSAGE_02_016: [The MESSAGE_CONTENT's field data shall compare equal byte-by-byte to the cfg's field source.]*/
+    TEST_FUNCTION(Message_GetContent_with_non_NULL_message_nonzero_size_succeeds)
+    {
+        ///arrange
+        char t ='3';
+        MESSAGE_CONFIG c = { sizeof(t), (unsigned char*)&t, (MAP_HANDLE)&c};
+        MESSAGE_HANDLE msg = Message_Create(&c);
+        umock_c_reset_all_calls();
+
+        ///act
+        const CONSTBUFFER* content = Message_GetContent(msg);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(content);
+        ASSERT_ARE_EQUAL(size_t, 1, content->size);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(content->buffer, &t, 1));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+        Message_Destroy(msg);
+    }
+
+	/*Tests_SRS_MESSAGE_17_006: [If message is NULL then Message_GetContentHandle shall return NULL.]*/
+	TEST_FUNCTION(Message_GetContentHandle_with_NULL_message_returns_NULL)
+	{
+		///arrange
+
+		///act
+		CONSTBUFFER_HANDLE content = Message_GetContentHandle(NULL);
+
+		///assert
+		ASSERT_IS_NULL(content);
+		ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+		///cleanup
+	}
+
+	/*Tests_SRS_MESSAGE_17_007: [Otherwise, Message_GetContentHandle shall shall clone and return the CONSTBUFFER_HANDLE representing the message content.]*/
+	/*Tests_SRS_MESSAGE_13_005: [If the message has no CONSTBUFFER_HANDLE, Message_GetContentHandle shall create one with a copy of the content and keep it until the ref count of the message is zero.]*/
+	TEST_FUNCTION(Message_GetContentHandle_with_non_NULL_message_zero_size_succeeds)
+	{
+		///arrange
+		MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&c};
+		MESSAGE_HANDLE msg = Message_Create(&c);
+		umock_c_reset_all_calls();
+
+		STRICT_EXPECTED_CALL(CONSTBUFFER_Create(NULL, 0));
+		STRICT_EXPECTED_CALL(CONSTBUFFER_Clone(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+
+		///act
+        CONSTBUFFER_HANDLE content = Message_GetContentHandle(msg);
+
+		///assert
+		ASSERT_IS_NOT_NULL(content);
+		ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+		const CONSTBUFFER * contentBuffer = CONSTBUFFER_GetContent(content);
+		ASSERT_ARE_EQUAL(size_t, 0, contentBuffer->size);
+		ASSERT_IS_NULL(contentBuffer->buffer);
+
+		///cleanup
+		Message_Destroy(msg);
+		CONSTBUFFER_Destroy(content);
+
+	}
+
+	/*Tests_SRS_MESSAGE_17_007: [Otherwise, Message_GetContentHandle shall shall clone and return the CONSTBUFFER_HANDLE representing the message content.]*/
+	/*Tests_SRS_MESSAGE_13_005: [If the message has no CONSTBUFFER_HANDLE, Message_GetContentHandle shall create one with a copy of the content and keep it until the ref count of the message is zero.]*/
+	TEST_FUNCTION(Message_GetContentHandle_with_non_NULL_message_nonzero_size_succeeds)
+	{
+		///arrange
+		char t = '3';
+		MESSAGE_CONFIG c = { sizeof(t), (unsigned char*)&t, (MAP_HANDLE)&c};
+		MESSAGE_HANDLE msg = Message_Create(&c);
+		umock_c_reset_all_calls();
+
+		STRICT_EXPECTED_CALL(CONSTBUFFER_Create(IGNORED_PTR_ARG, 1))
+			.ValidateArgumentBuffer(1, &t, 1);
+		STRICT_EXPECTED_CALL(CONSTBUFFER_Clone(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+
+		///act
+        CONSTBUFFER_HANDLE content = Message_GetContentHandle(msg);
+
+		///assert
+		ASSERT_IS_NOT_NULL(content);
+		ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+		const CONSTBUFFER * contentBuffer = CONSTBUFFER_GetContent(content);
+		ASSERT_ARE_EQUAL(size_t, 1, contentBuffer->size);
+		ASSERT_ARE_EQUAL(int, 0, memcmp(contentBuffer->buffer, &t, 1));
 
 		///cleanup
 		Message_Destroy(msg);
 		CONSTBUFFER_Destroy(content);
 	}
 
-    /*Tests_SRS_MESSAGE_02_017: [If message is NULL then Message_Destroy shall do nothing.] */
-    TEST_FUNCTION(Message_Destroy_with_NULL_argument_does_nothing)
+	/*Tests_SRS_MESSAGE_13_005: [If the message has no CONSTBUFFER_HANDLE, Message_GetContentHandle shall create one with a copy of the content and keep it until the ref count of the message is zero.]*/
+	TEST_FUNCTION(Message_GetContentHandle_second_call_only_clones)
+	{
+		///arrange
+		char t = '3';
+		MESSAGE_CONFIG c = { sizeof(t), (unsigned char*)&t, (MAP_HANDLE)&c};
+		MESSAGE_HANDLE msg = Message_Create(&c);
+		CONSTBUFFER_HANDLE first = Message_GetContentHandle(msg);
+		umock_c_reset_all_calls();
+
+		STRICT_EXPECTED_CALL(CONSTBUFFER_Clone(first));
+
+		///act
+		CONSTBUFFER_HANDLE content = Message_GetContentHandle(msg);
+
+		///assert
+		ASSERT_ARE_EQUAL(void_ptr, first, content);
+		ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+		///cleanup
+		CONSTBUFFER_Destroy(content);
+		CONSTBUFFER_Destroy(first);
+		Message_Destroy(msg);
+	}
+
+	/*Tests_SRS_MESSAGE_13_006: [If creating the CONSTBUFFER_HANDLE fails, Message_GetContentHandle shall return NULL.]*/
+	TEST_FUNCTION(Message_GetContentHandle_fails_when_CONSTBUFFER_Create_fails)
+	{
+		///arrange
+		char t = '3';
+		MESSAGE_CONFIG c = { sizeof(t), (unsigned char*)&t, (MAP_HANDLE)&c};
+		MESSAGE_HANDLE msg = Message_Create(&c);
+		umock_c_reset_all_calls();
+
+		whenShallCONSTBUFFER_Create_fail = 1;
+		STRICT_EXPECTED_CALL(CONSTBUFFER_Create(IGNORED_PTR_ARG, 1))
+			.IgnoreArgument(1);
+
+		///act
+		CONSTBUFFER_HANDLE content = Message_GetContentHandle(msg);
+
+		///assert
+		ASSERT_IS_NULL(content);
+		ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+		///cleanup
+		Message_Destroy(msg);
+	}
+
+    /*Tests_SRS_MESSAGE_02_017: [If message is NULL then Message_Destroy shall do nothing.] */
+    TEST_FUNCTION(Message_Destroy_with_NULL_argument_does_nothing)
+    {
+        ///arrange
+
+        ///act
+        Message_Destroy(NULL);
+
+        ///assert
+        
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_02_020: [Otherwise, Message_Destroy shall decrement the internal ref count of the message.] 
+    /*Tests_SRS_MESSAGE_02_021: [If the ref count is zero then the allocated resources are freed.]*/
+	/*Tests_SRS_MESSAGE_17_002: [Message_Destroy shall release the names of the properties with StringIntern_Release, and destroy the CONSTMAP of the message if it has one, when the ref count is zero.]*/
+    TEST_FUNCTION(Message_Destroy_happy_path)
+    {
+        ///arrange
+        char t = '3';
+        MESSAGE_CONFIG c = { sizeof(t), (unsigned char*)&t, (MAP_HANDLE)&c };
+        const char* keys[] = { "macAddress", "source" };
+        const char* values[] = { "01:02:03:03:02:01", "bleTelemetry" };
+        test_keys = keys;
+        test_values = values;
+        test_property_count = 2;
+        MESSAGE_HANDLE msg = Message_Create(&c);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*this is the handle, the properties and the content*/
+            .IgnoreArgument(1);
+
+        ///act
+        Message_Destroy(msg);
+
+        ///assert
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, 0, currentStringIntern_refCount);
+
+        ///cleanup
+    }
+
+	/*Tests_SRS_MESSAGE_17_002: [Message_Destroy shall release the names of the properties with StringIntern_Release, and destroy the CONSTMAP of the message if it has one, when the ref count is zero.]*/
+    TEST_FUNCTION(Message_Destroy_destroys_the_CONSTMAP_of_the_properties)
+    {
+        ///arrange
+        MESSAGE_CONFIG c = { 0, NULL, (MAP_HANDLE)&c };
+        MESSAGE_HANDLE msg = Message_Create(&c);
+        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument_mapFilterFunc()
+            .SetReturn(TEST_MAP_HANDLE);
+        CONSTMAP_HANDLE properties = Message_GetProperties(msg);
+        ConstMap_Destroy(properties);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(ConstMap_Destroy(properties)); /*this is the map*/
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*this is the handle*/
+            .IgnoreArgument(1);
+
+        ///act
+        Message_Destroy(msg);
+
+        ///assert
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+	/*Tests_SRS_MESSAGE_17_005: [Message_Destroy shall destroy the CONSTBUFFER_HANDLE of the message, if it has one, when the ref count is zero.]*/
+    TEST_FUNCTION(Message_Destroy_destroys_the_content_handle)
+    {
+        ///arrange
+        char t = '3';
+        MESSAGE_CONFIG c = { sizeof(t), (unsigned char*)&t, (MAP_HANDLE)&c };
+        MESSAGE_HANDLE msg = Message_Create(&c);
+        CONSTBUFFER_HANDLE content = Message_GetContentHandle(msg);
+        CONSTBUFFER_Destroy(content);
+        umock_c_reset_all_calls();
+
+		STRICT_EXPECTED_CALL(CONSTBUFFER_Destroy(content)); /*this is the buffer*/
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*this is the handle and the content*/
+            .IgnoreArgument(1);
+
+        ///act
+        Message_Destroy(msg);
+
+        ///assert
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_13_007: [If cfg is NULL then Message_CreateAdopt shall return NULL.]*/
+    TEST_FUNCTION(Message_CreateAdopt_with_NULL_cfg_fails)
+    {
+        ///arrange
+
+        ///act
+        MESSAGE_HANDLE r = Message_CreateAdopt(NULL);
+
+        ///assert
+        ASSERT_IS_NULL(r);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /*Tests_SRS_MESSAGE_13_008: [If field source of cfg is NULL and size is not zero, then Message_CreateAdopt shall fail and return NULL.]*/
+    TEST_FUNCTION(Message_CreateAdopt_with_NULL_source_and_non_zero_size_fails)
+    {
+        ///arrange
+        MESSAGE_ADOPT_CONFIG c = { 1, NULL, test_release, NULL, (MAP_HANDLE)&c };
+
+        ///act
+        MESSAGE_HANDLE r = Message_CreateAdopt(&c);
+
+        ///assert
+        ASSERT_IS_NULL(r);
+        ASSERT_ARE_EQUAL(int, 0, (int)currentrelease_call);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /*Tests_SRS_MESSAGE_13_009: [Message_CreateAdopt shall allocate the message without room for its content.]*/
+    /*Tests_SRS_MESSAGE_13_010: [Message_CreateAdopt shall copy the names and values of the sourceProperties to the message, the names acquired from the string intern table.]*/
+    /*Tests_SRS_MESSAGE_13_012: [Message_CreateAdopt shall use source as the content of the message, without copying it.]*/
+    /*Tests_SRS_MESSAGE_13_013: [On success, Message_CreateAdopt shall return a non-NULL handle and set the internal ref count to "1".]*/
+    TEST_FUNCTION(Message_CreateAdopt_happy_path)
+    {
+        ///arrange
+        unsigned char source[3] = { 1, 2, 3 };
+        MESSAGE_ADOPT_CONFIG c = { sizeof(source), source, test_release, (void*)&c, (MAP_HANDLE)&c };
+
+        STRICT_EXPECTED_CALL(Map_GetInternals((MAP_HANDLE)&c, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is reading the properties*/
+            .IgnoreArgument_keys()
+            .IgnoreArgument_values()
+            .IgnoreArgument_count();
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the structure*/
+            .IgnoreArgument(1);
+
+        ///act
+        MESSAGE_HANDLE r = Message_CreateAdopt(&c);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(r);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(void_ptr, (void*)source, (void*)Message_GetContent(r)->buffer);
+        ASSERT_ARE_EQUAL(int, (int)sizeof(source), (int)Message_GetContent(r)->size);
+        ASSERT_ARE_EQUAL(int, 0, (int)currentrelease_call);
+
+        ///cleanup
+        Message_Destroy(r);
+    }
+
+    /*Tests_SRS_MESSAGE_13_011: [If Message_CreateAdopt fails, it shall return NULL and leave source to the caller.]*/
+    TEST_FUNCTION(Message_CreateAdopt_fails_when_malloc_fails)
+    {
+        ///arrange
+        unsigned char source[3] = { 1, 2, 3 };
+        MESSAGE_ADOPT_CONFIG c = { sizeof(source), source, test_release, NULL, (MAP_HANDLE)&c };
+
+        whenShallmalloc_fail = 1;
+        STRICT_EXPECTED_CALL(Map_GetInternals((MAP_HANDLE)&c, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is reading the properties*/
+            .IgnoreArgument_keys()
+            .IgnoreArgument_values()
+            .IgnoreArgument_count();
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the structure*/
+            .IgnoreArgument(1);
+
+        ///act
+        MESSAGE_HANDLE r = Message_CreateAdopt(&c);
+
+        ///assert
+        ASSERT_IS_NULL(r);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(int, 0, (int)currentrelease_call);
+    }
+
+    /*Tests_SRS_MESSAGE_13_011: [If Message_CreateAdopt fails, it shall return NULL and leave source to the caller.]*/
+    TEST_FUNCTION(Message_CreateAdopt_fails_when_StringIntern_Acquire_fails)
+    {
+        ///arrange
+        unsigned char source[3] = { 1, 2, 3 };
+        MESSAGE_ADOPT_CONFIG c = { sizeof(source), source, test_release, NULL, (MAP_HANDLE)&c };
+        const char* keys[] = { "macAddress" };
+        const char* values[] = { "01:02:03:03:02:01" };
+        test_keys = keys;
+        test_values = values;
+        test_property_count = 1;
+
+        whenShallStringIntern_Acquire_fail = 1;
+        STRICT_EXPECTED_CALL(Map_GetInternals((MAP_HANDLE)&c, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is reading the properties*/
+            .IgnoreArgument_keys()
+            .IgnoreArgument_values()
+            .IgnoreArgument_count();
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the structure*/
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        MESSAGE_HANDLE r = Message_CreateAdopt(&c);
+
+        ///assert
+        ASSERT_IS_NULL(r);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(int, 0, (int)currentrelease_call);
+    }
+
+    /*Tests_SRS_MESSAGE_13_014: [Message_Destroy shall release the content adopted by the message, with the release function of the MESSAGE_ADOPT_CONFIG or with free if it was NULL, when the ref count is zero.]*/
+    TEST_FUNCTION(Message_Destroy_releases_the_adopted_content_when_the_ref_count_is_zero)
+    {
+        ///arrange
+        unsigned char source[3] = { 1, 2, 3 };
+        MESSAGE_ADOPT_CONFIG c = { sizeof(source), source, test_release, (void*)&c, (MAP_HANDLE)&c };
+        MESSAGE_HANDLE msg = Message_CreateAdopt(&c);
+        MESSAGE_HANDLE clone = Message_Clone(msg);
+        Message_Destroy(msg);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*this is the handle*/
+            .IgnoreArgument(1);
+
+        ///act
+        ASSERT_ARE_EQUAL(int, 0, (int)currentrelease_call);
+        Message_Destroy(clone);
+
+        ///assert
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(int, 1, (int)currentrelease_call);
+        ASSERT_ARE_EQUAL(void_ptr, (void*)source, (void*)lastrelease_content);
+        ASSERT_ARE_EQUAL(void_ptr, (void*)&c, lastrelease_context);
+    }
+
+    /*Tests_SRS_MESSAGE_13_014: [Message_Destroy shall release the content adopted by the message, with the release function of the MESSAGE_ADOPT_CONFIG or with free if it was NULL, when the ref count is zero.]*/
+    TEST_FUNCTION(Message_Destroy_frees_the_adopted_content_without_release_function)
+    {
+        ///arrange
+        unsigned char* source = (unsigned char*)malloc(3);
+        MESSAGE_ADOPT_CONFIG c = { 3, source, NULL, NULL, (MAP_HANDLE)&c };
+        MESSAGE_HANDLE msg;
+        (void)memset(source, 0, 3);
+        msg = Message_CreateAdopt(&c);
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(gballoc_free(source)); /*this is the content*/
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*this is the handle*/
+            .IgnoreArgument(1);
+
+        ///act
+        Message_Destroy(msg);
+
+        ///assert
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /*Tests_SRS_MESSAGE_02_022: [ If source is NULL then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_with_NULL_source_fails)
+    {
+        ///arrange
+
+        ///act
+        
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(NULL, 1);
+
+        ///assert
+
+        ASSERT_IS_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        
+        ///cleanup
+
+    }
+
+
+
+    /*Tests_SRS_MESSAGE_02_023: [ If source is not NULL and and size parameter is smaller than 14 then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_with_13_size_fails)
+    {
+        ///arrange
+
+        ///act
+
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail____minimalMessage, 13);
+
+        ///assert
+
+        ASSERT_IS_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_02_031: [ Otherwise Message_CreateFromByteArray shall succeed and return a non-NULL handle. ]*/
+    /*Tests_SRS_MESSAGE_13_022: [ Message_CreateFromByteArray shall allocate the message, with room for the properties and the content of the byte array, with MessagePool_Allocate. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_notFail____minimalMessage)
+    {
+
+        ///arrange
+
+        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreAllCalls();
+
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail____minimalMessage, sizeof(notFail____minimalMessage));
+        
+        ///assert
+        ASSERT_IS_NOT_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+        Message_Destroy(handle);
+    }
+
+    /*Tests_SRS_MESSAGE_02_031: [ Otherwise Message_CreateFromByteArray shall succeed and return a non-NULL handle. ]*/
+    /*Tests_SRS_MESSAGE_13_023: [ Message_CreateFromByteArray shall acquire the names of the properties from the string intern table straight from the byte array, copy their values to the message, and index them as Message_Create does. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_notFail__1Property_0bytes)
+    {
+
+        ///arrange
+
+        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreAllCalls();
+
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__1Property_0bytes, sizeof(notFail__1Property_0bytes));
+
+        ///assert
+        ASSERT_IS_NOT_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(char_ptr, "3", Message_GetProperty(handle, "3"));
+        ASSERT_ARE_EQUAL(size_t, 1, currentStringIntern_refCount);
+
+        ///cleanup
+        Message_Destroy(handle);
+    }
+
+    /*Tests_SRS_MESSAGE_02_031: [ Otherwise Message_CreateFromByteArray shall succeed and return a non-NULL handle. ]*/
+    /*Tests_SRS_MESSAGE_13_023: [ Message_CreateFromByteArray shall acquire the names of the properties from the string intern table straight from the byte array, copy their values to the message, and index them as Message_Create does. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_notFail__2Property_0bytes)
+    {
+
+        ///arrange
+
+        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreAllCalls();
+
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__2Property_0bytes, sizeof(notFail__2Property_0bytes));
+
+        ///assert
+        ASSERT_IS_NOT_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(char_ptr, "3", Message_GetProperty(handle, "3"));
+        ASSERT_ARE_EQUAL(char_ptr, "a", Message_GetProperty(handle, "ab"));
+        ASSERT_ARE_EQUAL(size_t, 0, Message_GetContent(handle)->size);
+
+        ///cleanup
+        Message_Destroy(handle);
+    }
+
+    /*Tests_SRS_MESSAGE_02_031: [ Otherwise Message_CreateFromByteArray shall succeed and return a non-NULL handle. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_notFail__0Property_1bytes)
+    {
+
+        ///arrange
+
+        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreAllCalls();
+
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__0Property_1bytes, sizeof(notFail__0Property_1bytes));
+
+        ///assert
+        ASSERT_IS_NOT_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+        Message_Destroy(handle);
+    }
+
+    
+    /*Tests_SRS_MESSAGE_02_031: [ Otherwise Message_CreateFromByteArray shall succeed and return a non-NULL handle. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_notFail__1Property_1bytes)
+    {
+
+        ///arrange
+
+        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreAllCalls();
+
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__1Property_1bytes, sizeof(notFail__1Property_1bytes));
+
+        ///assert
+        ASSERT_IS_NOT_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, 1, Message_GetContent(handle)->size);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(Message_GetContent(handle)->buffer, "3", 1));
+
+        ///cleanup
+        Message_Destroy(handle);
+    }
+
+    
+    /*Tests_SRS_MESSAGE_02_031: [ Otherwise Message_CreateFromByteArray shall succeed and return a non-NULL handle. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_notFail__2Property_1bytes)
+    {
+
+        ///arrange
+
+        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreAllCalls();
+
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__2Property_1bytes, sizeof(notFail__2Property_1bytes));
+
+        ///assert
+        ASSERT_IS_NOT_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, 1, Message_GetContent(handle)->size);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(Message_GetContent(handle)->buffer, "3", 1));
+
+        ///cleanup
+        Message_Destroy(handle);
+    }
+
+    /*Tests_SRS_MESSAGE_02_031: [ Otherwise Message_CreateFromByteArray shall succeed and return a non-NULL handle. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_notFail__0Property_2bytes)
+    {
+
+        ///arrange
+
+        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreAllCalls();
+
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__0Property_2bytes, sizeof(notFail__0Property_2bytes));
+
+        ///assert
+        ASSERT_IS_NOT_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, 2, Message_GetContent(handle)->size);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(Message_GetContent(handle)->buffer, "34", 2));
+
+        ///cleanup
+        Message_Destroy(handle);
+    }
+
+    /*Tests_SRS_MESSAGE_02_031: [ Otherwise Message_CreateFromByteArray shall succeed and return a non-NULL handle. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_notFail__1Property_2bytes)
+    {
+
+        ///arrange
+
+        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreAllCalls();
+
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__1Property_2bytes, sizeof(notFail__1Property_2bytes));
+
+        ///assert
+        ASSERT_IS_NOT_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, 2, Message_GetContent(handle)->size);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(Message_GetContent(handle)->buffer, "34", 2));
+
+        ///cleanup
+        Message_Destroy(handle);
+    }
+
+    /*Tests_SRS_MESSAGE_02_031: [ Otherwise Message_CreateFromByteArray shall succeed and return a non-NULL handle. ]*/
+    /*Tests_SRS_MESSAGE_13_025: [ Message_CreateFromByteArray shall copy the content of the byte array to the message. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_notFail__2Property_2bytes)
+    {
+
+        ///arrange
+
+        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreAllCalls();
+
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes));
+
+        ///assert
+        ASSERT_IS_NOT_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(char_ptr, "rocks", Message_GetProperty(handle, "BleedingEdge"));
+        ASSERT_ARE_EQUAL(char_ptr, "awesome", Message_GetProperty(handle, "Azure IoT Gateway is"));
+        ASSERT_ARE_EQUAL(size_t, 2, Message_GetContent(handle)->size);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(Message_GetContent(handle)->buffer, "34", 2));
+        ASSERT_IS_TRUE(Message_GetContent(handle)->buffer != notFail__2Property_2bytes + sizeof(notFail__2Property_2bytes) - 2);
+
+        ///cleanup
+        Message_Destroy(handle);
+    }
+
+    /*Tests_SRS_MESSAGE_02_024: [ If the first two bytes of source are not 0xA1 0x60 then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_when_first_byte_is_not_0xA1_fails)
+    {
+
+        ///arrange
+
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail_____firstByteNot0xA1, sizeof(fail_____firstByteNot0xA1));
+
+        ///assert
+        ASSERT_IS_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_02_024: [ If the first two bytes of source are not 0xA1 0x60 then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_when_second_byte_is_not_0x60_fails)
+    {
+
+        ///arrange
+
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail____secondByteNot0x60, sizeof(fail____secondByteNot0x60));
+
+        ///assert
+        ASSERT_IS_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_02_037: [ If the size embedded in the message is not the same as size parameter then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    
+    TEST_FUNCTION(Message_CreateFromByteArray_when_message_sizes_not_math_fails)
+    {
+        ///arrange
+
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail____minimalMessage,1+ sizeof(notFail____minimalMessage));
+
+        ///assert
+        ASSERT_IS_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_02_025: [ If while parsing the message content, a read would occur past the end of the array (as indicated by size) then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_with_1_property_when_1st_property_doesnt_end_fails)
+    {
+        ///arrange
+
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail_firstPropertyNameTooBig, sizeof(fail_firstPropertyNameTooBig));
+
+        ///assert
+        ASSERT_IS_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_02_025: [ If while parsing the message content, a read would occur past the end of the array (as indicated by size) then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_with_1_property_when_1st_property_value_doesnt_start_fails)
+    {
+        ///arrange
+
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail_firstPropertyValueDoesNotExist, sizeof(fail_firstPropertyValueDoesNotExist));
+
+        ///assert
+        ASSERT_IS_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+    
+    /*Tests_SRS_MESSAGE_02_025: [ If while parsing the message content, a read would occur past the end of the array (as indicated by size) then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_with_1_property_when_1st_property_value_doesnt_end_fails)
+    {
+        ///arrange
+
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail_firstPropertyValueDoesNotEnd, sizeof(fail_firstPropertyValueDoesNotEnd));
+
+        ///assert
+        ASSERT_IS_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_02_025: [ If while parsing the message content, a read would occur past the end of the array (as indicated by size) then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_with_1_byte_of_content_size_fails)
+    {
+        ///arrange
+
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail_whenThereIsOnly1ByteOfcontentSize, sizeof(fail_whenThereIsOnly1ByteOfcontentSize));
+
+        ///assert
+        ASSERT_IS_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_02_025: [ If while parsing the message content, a read would occur past the end of the array (as indicated by size) then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_with_2_byte_of_content_size_fails)
     {
         ///arrange
 
+        const unsigned char fail_whenThereIsOnly2ByteOfcontentSize[] =
+        {
+            0xA1, 0x60,             /*header*/
+            0x00, 0x00, 0x00, 20,   /*size of this array*/
+            0x00, 0x00, 0x00, 0x01, /*one property*/
+            '3', '3', '3', '\0',
+            '3', '3', '3', '\0',
+            0x00, 0x00              /*not enough bytes for contentSize*/
+        };
+
         ///act
-        Message_Destroy(NULL);
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail_whenThereIsOnly2ByteOfcontentSize, sizeof(fail_whenThereIsOnly2ByteOfcontentSize));
 
         ///assert
-        
+        ASSERT_IS_NULL(handle);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         ///cleanup
     }
 
-    /*Tests_SRS_MESSAGE_02_020: [Otherwise, Message_Destroy shall decrement the internal ref count of the message.] 
-    /*Tests_SRS_MESSAGE_02_021: [If the ref count is zero then the allocated resources are freed.]*/
-	/*Tests_SRS_MESSAGE_17_002: [Message_Destroy shall destroy the CONSTMAP properties.]*/
-	/*Tests_SRS_MESSAGE_17_005: [Message_Destroy shall destroy the CONSTBUFFER.]*/
-    TEST_FUNCTION(Message_Destroy_happy_path)
+    /*Tests_SRS_MESSAGE_02_025: [ If while parsing the message content, a read would occur past the end of the array (as indicated by size) then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_with_3_byte_of_content_size_fails)
     {
         ///arrange
-        char t = '3';
-        MESSAGE_CONFIG c = { sizeof(t), (unsigned char*)&t, (MAP_HANDLE)&c };
-        MESSAGE_HANDLE msg = Message_Create(&c);
-        umock_c_reset_all_calls();
 
-		STRICT_EXPECTED_CALL(ConstMap_Destroy(IGNORED_PTR_ARG)) /*this is the map*/
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(CONSTBUFFER_Destroy(IGNORED_PTR_ARG)) /*this is the buffer*/
-			.IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*this is the handle*/
-            .IgnoreArgument(1);
+        const unsigned char fail_whenThereIsOnly3ByteOfcontentSize[] =
+        {
+            0xA1, 0x60,             /*header*/
+            0x00, 0x00, 0x00, 21,   /*size of this array*/
+            0x00, 0x00, 0x00, 0x01, /*one property*/
+            '3', '3', '3', '\0',
+            '3', '3', '3', '\0',
+            0x00, 0x00, 0x00        /*not enough bytes for contentSize*/
+        };
 
         ///act
-        Message_Destroy(msg);
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail_whenThereIsOnly3ByteOfcontentSize, sizeof(fail_whenThereIsOnly3ByteOfcontentSize));
 
         ///assert
+        ASSERT_IS_NULL(handle);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         ///cleanup
     }
 
-    /*Tests_SRS_MESSAGE_02_022: [ If source is NULL then Message_CreateFromByteArray shall fail and return NULL. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_with_NULL_source_fails)
+    /*Tests_SRS_MESSAGE_02_025: [ If while parsing the message content, a read would occur past the end of the array (as indicated by size) then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_with_1_byte_of_content_size_but_no_content_fails)
     {
         ///arrange
 
+        const unsigned char fail_whenThereIsNotEnoughContent[] =
+        {
+            0xA1, 0x60,             /*header*/
+            0x00, 0x00, 0x00, 22,   /*size of this array*/
+            0x00, 0x00, 0x00, 0x01, /*one property*/
+            '3', '3', '3', '\0',
+            '3', '3', '3', '\0',
+            0x00, 0x00, 0x00, 0x01  /*no further content*/
+        };
+
         ///act
-        
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(NULL, 1);
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail_whenThereIsNotEnoughContent, sizeof(fail_whenThereIsNotEnoughContent));
 
         ///assert
+        ASSERT_IS_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_02_025: [ If while parsing the message content, a read would occur past the end of the array (as indicated by size) then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_with_1_byte_of_content_size_but_2_bytes_of_content_fails)
+    {
+        ///arrange
+
+        const unsigned char fail_whenThereIsTooMuchContent[] =
+        {
+            0xA1, 0x60,             /*header*/
+            0x00, 0x00, 0x00, 24,   /*size of this array*/
+            0x00, 0x00, 0x00, 0x01, /*one property*/
+            '3', '3', '3', '\0',
+            '3', '3', '3', '\0',
+            0x00, 0x00, 0x00, 0x01,  /*no further content*/
+            '3', '3'
+        };
+
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail_whenThereIsTooMuchContent, sizeof(fail_whenThereIsTooMuchContent));
 
+        ///assert
         ASSERT_IS_NULL(handle);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
-        
+
         ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_02_030: [ If any of the above steps fails, then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_fails_when_numberOfProperties_is_negative)
+    {
+        ///arrange
+
+        const unsigned char notFail____minimalMessage[] =
+        {
+            0xA1, 0x60,             /*header*/
+            0x00, 0x00, 0x00, 14,   /*size of this array*/
+            0xFF, 0xFF, 0xFF, 0xFF, /*-1 properties*/
+            0x00, 0x00, 0x00, 0x00  /*zero message content size*/
+        };
+
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail____minimalMessage, sizeof(notFail____minimalMessage));
+
+        ///assert
+        ASSERT_IS_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
+        ///cleanup
     }
 
+    /*Tests_SRS_MESSAGE_02_030: [ If any of the above steps fails, then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_fails_when_numberOfProperties_is_int32_max)
+    {
+        ///arrange
 
+        const unsigned char notFail____minimalMessage[] =
+        {
+            0xA1, 0x60,             /*header*/
+            0x00, 0x00, 0x00, 14,   /*size of this array*/
+            0x7F, 0xFF, 0xFF, 0xFF, /*INT32_MAX properties*/
+            0x00, 0x00, 0x00, 0x00  /*zero message content size*/
+        };
 
-    /*Tests_SRS_MESSAGE_02_023: [ If source is not NULL and and size parameter is smaller than 14 then Message_CreateFromByteArray shall fail and return NULL. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_with_13_size_fails)
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail____minimalMessage, sizeof(notFail____minimalMessage));
+
+        ///assert
+        ASSERT_IS_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_02_030: [ If any of the above steps fails, then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_fails_when_allocating_the_message_fails)
     {
         ///arrange
+        whenShallmalloc_fail = 1;
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument_size();
 
         ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes));
 
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail____minimalMessage, 13);
+        ///assert
+        ASSERT_IS_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, 0, currentStringIntern_Acquire_call);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_02_030: [ If any of the above steps fails, then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_fails_when_StringIntern_Acquire_fails)
+    {
+        ///arrange
+        whenShallStringIntern_Acquire_fail = 2; /*the name of the second property*/
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument_size();
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument_ptr();
+
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes));
 
         ///assert
+        ASSERT_IS_NULL(handle);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, 0, currentStringIntern_refCount);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_13_024: [ If the byte array has two properties with the same name, Message_CreateFromByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_with_two_properties_with_the_same_name_fails)
+    {
+        ///arrange
+        const unsigned char fail_whenAPropertyIsRepeated[] =
+        {
+            0xA1, 0x60,             /*header*/
+            0x00, 0x00, 0x00, 28,   /*size of this array*/
+            0x00, 0x00, 0x00, 0x03, /*three properties*/
+            'a', 'b', '\0', '1', '\0',
+            'c', 'd', '\0', '2', '\0',
+            'a', 'b', '\0', '3', '\0',
+            0x00, 0x00, 0x00, 0x00  /*zero message content size*/
+        };
+
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument_size();
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument_ptr();
 
+        ///act
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail_whenAPropertyIsRepeated, sizeof(fail_whenAPropertyIsRepeated));
+
+        ///assert
         ASSERT_IS_NULL(handle);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, 0, currentStringIntern_refCount);
 
         ///cleanup
     }
 
-    /*Tests_SRS_MESSAGE_02_031: [ Otherwise Message_CreateFromByteArray shall succeed and return a non-NULL handle. ]*/
-    /*Tests_SRS_MESSAGE_02_026: [ A MAP_HANDLE shall be created. ]*/
-    /*Tests_SRS_MESSAGE_02_028: [ A structure of type MESSAGE_CONFIG shall be populated with the MAP_HANDLE previously constructed and the message content ]*/
-    /*Tests_SRS_MESSAGE_02_029: [ A MESSAGE_HANDLE shall be constructed from the MESSAGE_CONFIG. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_notFail____minimalMessage)
+    /*Tests_SRS_MESSAGE_02_032: [ If messageHandle is NULL then Message_ToByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_ToByteArray_fails_with_NULL_messageHandle_parameter)
     {
 
         ///arrange
-
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
-        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-            .IgnoreAllCalls();
-        STRICT_EXPECTED_CALL(CONSTBUFFER_Create(notFail____minimalMessage + 14, 0));
-        STRICT_EXPECTED_CALL(ConstMap_Create(TEST_MAP_HANDLE));
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
+        int32_t size;
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail____minimalMessage, sizeof(notFail____minimalMessage));
-        
+        const unsigned char* byteArray = Message_ToByteArray(NULL, &size);
+
         ///assert
-        ASSERT_IS_NOT_NULL(handle);
+        ASSERT_IS_NULL(byteArray);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         ///cleanup
-        Message_Destroy(handle);
     }
 
-    /*Tests_SRS_MESSAGE_02_031: [ Otherwise Message_CreateFromByteArray shall succeed and return a non-NULL handle. ]*/
-    /*Tests_SRS_MESSAGE_02_027: [ All the properties of the byte array shall be added to the MAP_HANDLE. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_notFail__1Property_0bytes)
+    /*Tests_SRS_MESSAGE_02_038: [ If size is NULL then Message_ToByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_ToByteArray_fails_with_NULL_size_parameter)
     {
 
         ///arrange
 
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, "3", "3"))
-            .SetReturn(MAP_OK);
+        ///act
+        const unsigned char* byteArray = Message_ToByteArray(TEST_MESSAGE_HANDLE, NULL);
+
+        ///assert
+        ASSERT_IS_NULL(byteArray);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_02_033: [ Message_ToByteArray shall precompute the needed memory size and shall pre allocate it. ]*/
+    /*Tests_SRS_MESSAGE_02_034: [ Message_ToByteArray shall populate the memory with values as indicated in the implementation details. ]*/
+    /*Tests_SRS_MESSAGE_02_036: [ Otherwise Message_ToByteArray shall succeed, write in *size the byte array size and return a non-NULL result. ]*/
+    TEST_FUNCTION(Message_ToByteArray_no_properties_no_content_happy_path)
+    {
+
+        ///arrange
+        int32_t size;
 
         EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
             .IgnoreAllCalls();
-        STRICT_EXPECTED_CALL(CONSTBUFFER_Create(IGNORED_PTR_ARG, 0))
-            .IgnoreArgument_source();
-        STRICT_EXPECTED_CALL(ConstMap_Create(TEST_MAP_HANDLE));
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
+
+        MESSAGE_HANDLE messageHandle = Message_CreateFromByteArray(notFail____minimalMessage, sizeof(notFail____minimalMessage));
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument_size();
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__1Property_0bytes, sizeof(notFail__1Property_0bytes));
+        const unsigned char* byteArray = Message_ToByteArray(messageHandle, &size);
 
         ///assert
-        ASSERT_IS_NOT_NULL(handle);
+        ASSERT_IS_NOT_NULL(byteArray);
+        ASSERT_ARE_EQUAL(int32_t, sizeof(notFail____minimalMessage), size);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(byteArray, notFail____minimalMessage, size));
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         ///cleanup
-        Message_Destroy(handle);
+        free((void*)byteArray);
+        Message_Destroy(messageHandle);
     }
 
-    /*Tests_SRS_MESSAGE_02_031: [ Otherwise Message_CreateFromByteArray shall succeed and return a non-NULL handle. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_notFail__2Property_0bytes)
+    /*Tests_SRS_MESSAGE_02_033: [ Message_ToByteArray shall precompute the needed memory size and shall pre allocate it. ]*/
+    /*Tests_SRS_MESSAGE_02_034: [ Message_ToByteArray shall populate the memory with values as indicated in the implementation details. ]*/
+    /*Tests_SRS_MESSAGE_02_036: [ Otherwise Message_ToByteArray shall succeed, write in *size the byte array size and return a non-NULL result. ]*/
+    TEST_FUNCTION(Message_ToByteArray_with_properties_and_content_happy_path)
     {
 
         ///arrange
-
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, "3", "3"))
-            .SetReturn(MAP_OK);
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, "ab", "a"))
-            .SetReturn(MAP_OK);
+        int32_t size;
 
         EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
             .IgnoreAllCalls();
-        STRICT_EXPECTED_CALL(CONSTBUFFER_Create(IGNORED_PTR_ARG, 0))
-            .IgnoreArgument_source();
-        STRICT_EXPECTED_CALL(ConstMap_Create(TEST_MAP_HANDLE));
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
+
+        MESSAGE_HANDLE messageHandle = Message_CreateFromByteArray(notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes));
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument_size();
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__2Property_0bytes, sizeof(notFail__2Property_0bytes));
+        const unsigned char* byteArray = Message_ToByteArray(messageHandle, &size);
 
         ///assert
-        ASSERT_IS_NOT_NULL(handle);
+        ASSERT_IS_NOT_NULL(byteArray);
+        ASSERT_ARE_EQUAL(int32_t, sizeof(notFail__2Property_2bytes), size);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(byteArray, notFail__2Property_2bytes, size));
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         ///cleanup
-        Message_Destroy(handle);
+        free((void*)byteArray);
+        Message_Destroy(messageHandle);
     }
 
-    /*Tests_SRS_MESSAGE_02_031: [ Otherwise Message_CreateFromByteArray shall succeed and return a non-NULL handle. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_notFail__0Property_1bytes)
+    /*Tests_SRS_MESSAGE_02_035: [ If any of the above steps fails then Message_ToByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_ToByteArray_with_properties_and_content_fails_when_malloc_fails)
     {
 
         ///arrange
-
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
+        int32_t size;
 
         EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
             .IgnoreAllCalls();
-        STRICT_EXPECTED_CALL(CONSTBUFFER_Create(IGNORED_PTR_ARG, 1))
-            .IgnoreArgument_source();
-        STRICT_EXPECTED_CALL(ConstMap_Create(TEST_MAP_HANDLE));
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
+
+        MESSAGE_HANDLE messageHandle = Message_CreateFromByteArray(notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes));
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument_size()
+            .SetReturn(NULL);
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__0Property_1bytes, sizeof(notFail__0Property_1bytes));
+        const unsigned char* byteArray = Message_ToByteArray(messageHandle, &size);
 
         ///assert
-        ASSERT_IS_NOT_NULL(handle);
+        ASSERT_IS_NULL(byteArray);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         ///cleanup
-        Message_Destroy(handle);
+        free((void*)byteArray);
+        Message_Destroy(messageHandle);
     }
 
-    
-    /*Tests_SRS_MESSAGE_02_031: [ Otherwise Message_CreateFromByteArray shall succeed and return a non-NULL handle. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_notFail__1Property_1bytes)
+    /*Tests_SRS_MESSAGE_13_026: [ If messageHandle is NULL then Message_GetByteArraySize shall return -1. ]*/
+    TEST_FUNCTION(Message_GetByteArraySize_with_NULL_messageHandle_returns_minus_1)
     {
-
         ///arrange
 
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, "Azure IoT Gateway is", "awesome"));
-
-        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-            .IgnoreAllCalls();
-        STRICT_EXPECTED_CALL(CONSTBUFFER_Create(IGNORED_PTR_ARG, 1))
-            .ValidateArgumentBuffer(1, "3", 1);
-        STRICT_EXPECTED_CALL(ConstMap_Create(TEST_MAP_HANDLE));
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
-
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__1Property_1bytes, sizeof(notFail__1Property_1bytes));
+        int32_t result = Message_GetByteArraySize(NULL);
 
         ///assert
-        ASSERT_IS_NOT_NULL(handle);
+        ASSERT_ARE_EQUAL(int32_t, -1, result);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         ///cleanup
-        Message_Destroy(handle);
     }
 
-    
-    /*Tests_SRS_MESSAGE_02_031: [ Otherwise Message_CreateFromByteArray shall succeed and return a non-NULL handle. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_notFail__2Property_1bytes)
+    /*Tests_SRS_MESSAGE_13_028: [ Otherwise Message_GetByteArraySize shall return the size of the byte array Message_ToByteArray creates from the message. ]*/
+    TEST_FUNCTION(Message_GetByteArraySize_returns_the_size_of_the_byte_array)
     {
-
         ///arrange
-
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, "Azure IoT Gateway is", "awesome"));
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, "BleedingEdge", "rocks"));
-
-        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-            .IgnoreAllCalls();
-        STRICT_EXPECTED_CALL(CONSTBUFFER_Create(IGNORED_PTR_ARG, 1))
-            .ValidateArgumentBuffer(1, "3", 1);
-        STRICT_EXPECTED_CALL(ConstMap_Create(TEST_MAP_HANDLE));
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
+        MESSAGE_HANDLE messageHandle = Message_CreateFromByteArray(notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes));
+        umock_c_reset_all_calls();
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__2Property_1bytes, sizeof(notFail__2Property_1bytes));
+        int32_t result = Message_GetByteArraySize(messageHandle);
 
         ///assert
-        ASSERT_IS_NOT_NULL(handle);
+        ASSERT_ARE_EQUAL(int32_t, sizeof(notFail__2Property_2bytes), result);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         ///cleanup
-        Message_Destroy(handle);
+        Message_Destroy(messageHandle);
     }
 
-    /*Tests_SRS_MESSAGE_02_031: [ Otherwise Message_CreateFromByteArray shall succeed and return a non-NULL handle. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_notFail__0Property_2bytes)
+    /*Tests_SRS_MESSAGE_13_029: [ If messageHandle or buffer is NULL then Message_ToByteArrayBuffer shall fail and return -1. ]*/
+    TEST_FUNCTION(Message_ToByteArrayBuffer_with_NULL_messageHandle_fails)
     {
-
         ///arrange
-
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
-
-        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-            .IgnoreAllCalls();
-        STRICT_EXPECTED_CALL(CONSTBUFFER_Create(IGNORED_PTR_ARG, 2))
-            .ValidateArgumentBuffer(1, "34", 2);
-        STRICT_EXPECTED_CALL(ConstMap_Create(TEST_MAP_HANDLE));
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
+        unsigned char buffer[sizeof(notFail____minimalMessage)];
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__0Property_2bytes, sizeof(notFail__0Property_2bytes));
+        int32_t result = Message_ToByteArrayBuffer(NULL, buffer, sizeof(buffer));
 
         ///assert
-        ASSERT_IS_NOT_NULL(handle);
+        ASSERT_ARE_EQUAL(int32_t, -1, result);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         ///cleanup
-        Message_Destroy(handle);
     }
 
-    /*Tests_SRS_MESSAGE_02_031: [ Otherwise Message_CreateFromByteArray shall succeed and return a non-NULL handle. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_notFail__1Property_2bytes)
+    /*Tests_SRS_MESSAGE_13_029: [ If messageHandle or buffer is NULL then Message_ToByteArrayBuffer shall fail and return -1. ]*/
+    TEST_FUNCTION(Message_ToByteArrayBuffer_with_NULL_buffer_fails)
     {
-
         ///arrange
-
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, "Azure IoT Gateway is", "awesome"));
-        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-            .IgnoreAllCalls();
-        STRICT_EXPECTED_CALL(CONSTBUFFER_Create(IGNORED_PTR_ARG, 2))
-            .ValidateArgumentBuffer(1, "34", 2);
-        STRICT_EXPECTED_CALL(ConstMap_Create(TEST_MAP_HANDLE));
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
+        MESSAGE_HANDLE messageHandle = Message_CreateFromByteArray(notFail____minimalMessage, sizeof(notFail____minimalMessage));
+        umock_c_reset_all_calls();
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__1Property_2bytes, sizeof(notFail__1Property_2bytes));
+        int32_t result = Message_ToByteArrayBuffer(messageHandle, NULL, sizeof(notFail____minimalMessage));
 
         ///assert
-        ASSERT_IS_NOT_NULL(handle);
+        ASSERT_ARE_EQUAL(int32_t, -1, result);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         ///cleanup
-        Message_Destroy(handle);
+        Message_Destroy(messageHandle);
     }
 
-    /*Tests_SRS_MESSAGE_02_031: [ Otherwise Message_CreateFromByteArray shall succeed and return a non-NULL handle. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_notFail__2Property_2bytes)
+    /*Tests_SRS_MESSAGE_13_030: [ If the byte array of the message does not fit in size bytes, Message_ToByteArrayBuffer shall fail and return -1 without writing to buffer. ]*/
+    TEST_FUNCTION(Message_ToByteArrayBuffer_with_a_buffer_too_small_fails)
     {
-
         ///arrange
-
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, "BleedingEdge", "rocks"));
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, "Azure IoT Gateway is", "awesome"));
-        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-            .IgnoreAllCalls();
-        STRICT_EXPECTED_CALL(CONSTBUFFER_Create(IGNORED_PTR_ARG, 2))
-            .ValidateArgumentBuffer(1, "34", 2);
-        STRICT_EXPECTED_CALL(ConstMap_Create(TEST_MAP_HANDLE));
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
+        unsigned char buffer[sizeof(notFail__2Property_2bytes)];
+        MESSAGE_HANDLE messageHandle = Message_CreateFromByteArray(notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes));
+        umock_c_reset_all_calls();
+        (void)memset(buffer, 0x5A, sizeof(buffer));
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes));
+        int32_t result = Message_ToByteArrayBuffer(messageHandle, buffer, sizeof(buffer) - 1);
 
         ///assert
-        ASSERT_IS_NOT_NULL(handle);
+        ASSERT_ARE_EQUAL(int32_t, -1, result);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(int, 0x5A, buffer[0]);
+        ASSERT_ARE_EQUAL(int, 0x5A, buffer[sizeof(buffer) - 2]);
 
         ///cleanup
-        Message_Destroy(handle);
+        Message_Destroy(messageHandle);
     }
 
-    /*Tests_SRS_MESSAGE_02_024: [ If the first two bytes of source are not 0xA1 0x60 then Message_CreateFromByteArray shall fail and return NULL. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_when_first_byte_is_not_0xA1_fails)
+    /*Tests_SRS_MESSAGE_13_031: [ Otherwise Message_ToByteArrayBuffer shall write the byte array of the message, as Message_ToByteArray does, at the start of buffer and return its size. ]*/
+    TEST_FUNCTION(Message_ToByteArrayBuffer_writes_the_byte_array_without_allocating)
     {
-
         ///arrange
+        unsigned char buffer[sizeof(notFail__2Property_2bytes) + 1];
+        MESSAGE_HANDLE messageHandle = Message_CreateFromByteArray(notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes));
+        umock_c_reset_all_calls();
+        buffer[sizeof(buffer) - 1] = 0x5A;
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail_____firstByteNot0xA1, sizeof(fail_____firstByteNot0xA1));
+        int32_t result = Message_ToByteArrayBuffer(messageHandle, buffer, sizeof(buffer));
 
         ///assert
-        ASSERT_IS_NULL(handle);
+        ASSERT_ARE_EQUAL(int32_t, sizeof(notFail__2Property_2bytes), result);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(buffer, notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes)));
+        ASSERT_ARE_EQUAL(int, 0x5A, buffer[sizeof(buffer) - 1]);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         ///cleanup
+        Message_Destroy(messageHandle);
     }
 
-    /*Tests_SRS_MESSAGE_02_024: [ If the first two bytes of source are not 0xA1 0x60 then Message_CreateFromByteArray shall fail and return NULL. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_when_second_byte_is_not_0x60_fails)
+    /*Tests_SRS_MESSAGE_13_023: [ Message_CreateFromByteArray shall acquire the names of the properties from the string intern table straight from the byte array, copy their values to the message, and index them as Message_Create does. ]*/
+    /*Tests_SRS_MESSAGE_13_025: [ Message_CreateFromByteArray shall copy the content of the byte array to the message. ]*/
+    /*Tests_SRS_MESSAGE_13_031: [ Otherwise Message_ToByteArrayBuffer shall write the byte array of the message, as Message_ToByteArray does, at the start of buffer and return its size. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_round_trips_random_byte_arrays)
     {
+        ///arrange
+        unsigned char source[RANDOM_BYTE_ARRAY_SIZE];
+        unsigned char destination[RANDOM_BYTE_ARRAY_SIZE];
+        int iteration;
+        srand(42);
 
+        for (iteration = 0; iteration < 1000; iteration++)
+        {
+            int32_t size = (int32_t)make_random_byte_array(source);
+
+            ///act
+            MESSAGE_HANDLE messageHandle = Message_CreateFromByteArray(source, size);
+
+            ///assert
+            ASSERT_IS_NOT_NULL(messageHandle);
+            ASSERT_ARE_EQUAL(int32_t, size, Message_GetByteArraySize(messageHandle));
+            ASSERT_ARE_EQUAL(int32_t, size, Message_ToByteArrayBuffer(messageHandle, destination, sizeof(destination)));
+            ASSERT_ARE_EQUAL(int, 0, memcmp(source, destination, size));
+
+            ///cleanup
+            Message_Destroy(messageHandle);
+            ASSERT_ARE_EQUAL(size_t, 0, currentStringIntern_refCount);
+            umock_c_reset_all_calls();
+        }
+    }
+
+    /*Tests_SRS_MESSAGE_02_025: [ If while parsing the message content, a read would occur past the end of the array (as indicated by size) then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    /*Tests_SRS_MESSAGE_02_030: [ If any of the above steps fails, then Message_CreateFromByteArray shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArray_with_corrupted_byte_arrays_fails_or_round_trips)
+    {
         ///arrange
+        unsigned char source[RANDOM_BYTE_ARRAY_SIZE];
+        unsigned char destination[RANDOM_BYTE_ARRAY_SIZE];
+        int iteration;
+        srand(4242);
 
-        ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail____secondByteNot0x60, sizeof(fail____secondByteNot0x60));
+        for (iteration = 0; iteration < 5000; iteration++)
+        {
+            int32_t size = (int32_t)make_random_byte_array(source);
+            int corruptions = 1 + (rand() % 4);
+            int i;
+            for (i = 0; i < corruptions; i++)
+            {
+                source[rand() % size] = (unsigned char)(rand() % 256);
+            }
+            if (rand() % 4 == 0)
+            {
+                /*cut the byte array short, keeping the size it claims*/
+                size = rand() % size;
+            }
 
-        ///assert
-        ASSERT_IS_NULL(handle);
-        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+            ///act
+            MESSAGE_HANDLE messageHandle = Message_CreateFromByteArray(source, size);
 
-        ///cleanup
+            ///assert
+            if (messageHandle != NULL)
+            {
+                /*whatever was accepted is a message that serializes back to the same bytes*/
+                ASSERT_ARE_EQUAL(int32_t, size, Message_ToByteArrayBuffer(messageHandle, destination, sizeof(destination)));
+                ASSERT_ARE_EQUAL(int, 0, memcmp(source, destination, size));
+                Message_Destroy(messageHandle);
+            }
+
+            ///cleanup
+            ASSERT_ARE_EQUAL(size_t, 0, currentStringIntern_refCount);
+            umock_c_reset_all_calls();
+        }
     }
 
-    /*Tests_SRS_MESSAGE_02_037: [ If the size embedded in the message is not the same as size parameter then Message_CreateFromByteArray shall fail and return NULL. ]*/
-    
-    TEST_FUNCTION(Message_CreateFromByteArray_when_message_sizes_not_math_fails)
+    /*Tests_SRS_MESSAGE_13_032: [ If source is NULL then Message_CreateFromByteArrayView shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArrayView_with_NULL_source_fails)
     {
         ///arrange
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail____minimalMessage,1+ sizeof(notFail____minimalMessage));
+        MESSAGE_HANDLE handle = Message_CreateFromByteArrayView(NULL);
 
         ///assert
         ASSERT_IS_NULL(handle);
@@ -1529,563 +2791,675 @@ BEGIN_TEST_SUITE(gwmessage_unittests)
         ///cleanup
     }
 
-    /*Tests_SRS_MESSAGE_02_025: [ If while parsing the message content, a read would occur past the end of the array (as indicated by size) then Message_CreateFromByteArray shall fail and return NULL. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_with_1_property_when_1st_property_doesnt_end_fails)
+    /*Tests_SRS_MESSAGE_13_033: [ Message_CreateFromByteArrayView shall check the byte array in source as Message_CreateFromByteArray does, and fail and return NULL if it is not the byte array of a message. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArrayView_with_an_invalid_byte_array_fails)
     {
         ///arrange
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
+        CONSTBUFFER_HANDLE source = CONSTBUFFER_Create(fail_____firstByteNot0xA1, sizeof(fail_____firstByteNot0xA1));
+        umock_c_reset_all_calls();
 
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
+        STRICT_EXPECTED_CALL(CONSTBUFFER_GetContent(source));
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail_firstPropertyNameTooBig, sizeof(fail_firstPropertyNameTooBig));
+        MESSAGE_HANDLE handle = Message_CreateFromByteArrayView(source);
 
         ///assert
         ASSERT_IS_NULL(handle);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, 1, currentCONSTBUFFER_refCount);
 
         ///cleanup
+        CONSTBUFFER_Destroy(source);
     }
 
-    /*Tests_SRS_MESSAGE_02_025: [ If while parsing the message content, a read would occur past the end of the array (as indicated by size) then Message_CreateFromByteArray shall fail and return NULL. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_with_1_property_when_1st_property_value_doesnt_start_fails)
+    /*Tests_SRS_MESSAGE_13_034: [ Message_CreateFromByteArrayView shall allocate the message, with room for its properties only, with MessagePool_Allocate. ]*/
+    /*Tests_SRS_MESSAGE_13_035: [ Message_CreateFromByteArrayView shall use the names and values in the byte array as the properties of the message, without copying nor interning them, and index them as Message_Create does. ]*/
+    /*Tests_SRS_MESSAGE_13_036: [ Message_CreateFromByteArrayView shall use the content in the byte array as the content of the message, without copying it. ]*/
+    /*Tests_SRS_MESSAGE_13_037: [ Message_CreateFromByteArrayView shall clone source and keep it until the ref count of the message is zero. ]*/
+    /*Tests_SRS_MESSAGE_13_039: [ On success, Message_CreateFromByteArrayView shall return a non-NULL handle and set the internal ref count to "1". ]*/
+    TEST_FUNCTION(Message_CreateFromByteArrayView_happy_path)
     {
         ///arrange
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
+        CONSTBUFFER_HANDLE source = CONSTBUFFER_Create(notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes));
+        const unsigned char* bytes = CONSTBUFFER_GetContent(source)->buffer;
+        umock_c_reset_all_calls();
 
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
+        STRICT_EXPECTED_CALL(CONSTBUFFER_GetContent(source));
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument_size();
+        STRICT_EXPECTED_CALL(CONSTBUFFER_Clone(source));
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail_firstPropertyValueDoesNotExist, sizeof(fail_firstPropertyValueDoesNotExist));
+        MESSAGE_HANDLE handle = Message_CreateFromByteArrayView(source);
 
         ///assert
-        ASSERT_IS_NULL(handle);
+        ASSERT_IS_NOT_NULL(handle);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, 0, currentStringIntern_Acquire_call);
+        ASSERT_ARE_EQUAL(size_t, 2, currentCONSTBUFFER_refCount);
+        ASSERT_ARE_EQUAL(void_ptr, (void*)(bytes + 23), (void*)Message_GetProperty(handle, "BleedingEdge"));
+        ASSERT_ARE_EQUAL(char_ptr, "awesome", Message_GetProperty(handle, "Azure IoT Gateway is"));
+        ASSERT_ARE_EQUAL(void_ptr, (void*)(bytes + 62), (void*)Message_GetContent(handle)->buffer);
+        ASSERT_ARE_EQUAL(size_t, 2, Message_GetContent(handle)->size);
 
         ///cleanup
+        Message_Destroy(handle);
+        CONSTBUFFER_Destroy(source);
     }
-    
-    /*Tests_SRS_MESSAGE_02_025: [ If while parsing the message content, a read would occur past the end of the array (as indicated by size) then Message_CreateFromByteArray shall fail and return NULL. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_with_1_property_when_1st_property_value_doesnt_end_fails)
+
+    /*Tests_SRS_MESSAGE_13_038: [ If any of the above steps fails, Message_CreateFromByteArrayView shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArrayView_fails_when_allocating_the_message_fails)
     {
         ///arrange
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
+        CONSTBUFFER_HANDLE source = CONSTBUFFER_Create(notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes));
+        umock_c_reset_all_calls();
+        whenShallmalloc_fail = 1;
 
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
+        STRICT_EXPECTED_CALL(CONSTBUFFER_GetContent(source));
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument_size();
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail_firstPropertyValueDoesNotEnd, sizeof(fail_firstPropertyValueDoesNotEnd));
+        MESSAGE_HANDLE handle = Message_CreateFromByteArrayView(source);
 
         ///assert
         ASSERT_IS_NULL(handle);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, 1, currentCONSTBUFFER_refCount);
 
         ///cleanup
+        CONSTBUFFER_Destroy(source);
     }
 
-    /*Tests_SRS_MESSAGE_02_025: [ If while parsing the message content, a read would occur past the end of the array (as indicated by size) then Message_CreateFromByteArray shall fail and return NULL. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_with_1_byte_of_content_size_fails)
+    /*Tests_SRS_MESSAGE_13_038: [ If any of the above steps fails, Message_CreateFromByteArrayView shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArrayView_fails_when_CONSTBUFFER_Clone_fails)
     {
         ///arrange
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, "333", "333"));
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
+        CONSTBUFFER_HANDLE source = CONSTBUFFER_Create(notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes));
+        umock_c_reset_all_calls();
+        whenShallCONSTBUFFER_Clone_fail = 1;
+
+        STRICT_EXPECTED_CALL(CONSTBUFFER_GetContent(source));
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument_size();
+        STRICT_EXPECTED_CALL(CONSTBUFFER_Clone(source));
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument_ptr();
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail_whenThereIsOnly1ByteOfcontentSize, sizeof(fail_whenThereIsOnly1ByteOfcontentSize));
+        MESSAGE_HANDLE handle = Message_CreateFromByteArrayView(source);
 
         ///assert
         ASSERT_IS_NULL(handle);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, 1, currentCONSTBUFFER_refCount);
 
         ///cleanup
+        CONSTBUFFER_Destroy(source);
     }
 
-    /*Tests_SRS_MESSAGE_02_025: [ If while parsing the message content, a read would occur past the end of the array (as indicated by size) then Message_CreateFromByteArray shall fail and return NULL. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_with_2_byte_of_content_size_fails)
+    /*Tests_SRS_MESSAGE_13_038: [ If any of the above steps fails, Message_CreateFromByteArrayView shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArrayView_with_two_properties_with_the_same_name_fails)
     {
         ///arrange
-
-        const unsigned char fail_whenThereIsOnly2ByteOfcontentSize[] =
+        const unsigned char fail_whenAPropertyIsRepeated[] =
         {
             0xA1, 0x60,             /*header*/
-            0x00, 0x00, 0x00, 20,   /*size of this array*/
-            0x00, 0x00, 0x00, 0x01, /*one property*/
-            '3', '3', '3', '\0',
-            '3', '3', '3', '\0',
-            0x00, 0x00              /*not enough bytes for contentSize*/
+            0x00, 0x00, 0x00, 24,   /*size of this array*/
+            0x00, 0x00, 0x00, 0x02, /*two properties*/
+            'a', 'b', '\0', '1', '\0',
+            'a', 'b', '\0', '2', '\0',
+            0x00, 0x00, 0x00, 0x00  /*zero message content size*/
         };
+        CONSTBUFFER_HANDLE source = CONSTBUFFER_Create(fail_whenAPropertyIsRepeated, sizeof(fail_whenAPropertyIsRepeated));
+        umock_c_reset_all_calls();
 
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, "333", "333"));
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
+        STRICT_EXPECTED_CALL(CONSTBUFFER_GetContent(source));
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument_size();
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument_ptr();
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail_whenThereIsOnly2ByteOfcontentSize, sizeof(fail_whenThereIsOnly2ByteOfcontentSize));
+        MESSAGE_HANDLE handle = Message_CreateFromByteArrayView(source);
 
         ///assert
         ASSERT_IS_NULL(handle);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, 1, currentCONSTBUFFER_refCount);
 
         ///cleanup
+        CONSTBUFFER_Destroy(source);
     }
 
-    /*Tests_SRS_MESSAGE_02_025: [ If while parsing the message content, a read would occur past the end of the array (as indicated by size) then Message_CreateFromByteArray shall fail and return NULL. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_with_3_byte_of_content_size_fails)
+    /*Tests_SRS_MESSAGE_13_040: [ A message created with Message_CreateFromByteArrayView shall serialize to the byte array it was created from. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArrayView_serializes_to_the_byte_array_it_was_created_from)
     {
         ///arrange
+        unsigned char buffer[sizeof(notFail__2Property_2bytes)];
+        int32_t size;
+        CONSTBUFFER_HANDLE source = CONSTBUFFER_Create(notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes));
+        MESSAGE_HANDLE handle = Message_CreateFromByteArrayView(source);
+        umock_c_reset_all_calls();
 
-        const unsigned char fail_whenThereIsOnly3ByteOfcontentSize[] =
-        {
-            0xA1, 0x60,             /*header*/
-            0x00, 0x00, 0x00, 21,   /*size of this array*/
-            0x00, 0x00, 0x00, 0x01, /*one property*/
-            '3', '3', '3', '\0',
-            '3', '3', '3', '\0',
-            0x00, 0x00, 0x00        /*not enough bytes for contentSize*/
-        };
+        ///act
+        const unsigned char* result = Message_ToByteArray(handle, &size);
 
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, "333", "333"));
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
+        ///assert
+        ASSERT_IS_NOT_NULL(result);
+        ASSERT_ARE_EQUAL(int32_t, sizeof(notFail__2Property_2bytes), size);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(result, notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes)));
+        ASSERT_ARE_EQUAL(int32_t, sizeof(notFail__2Property_2bytes), Message_GetByteArraySize(handle));
+        ASSERT_ARE_EQUAL(int32_t, sizeof(notFail__2Property_2bytes), Message_ToByteArrayBuffer(handle, buffer, sizeof(buffer)));
+        ASSERT_ARE_EQUAL(int, 0, memcmp(buffer, notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes)));
+
+        ///cleanup
+        free((void*)result);
+        Message_Destroy(handle);
+        CONSTBUFFER_Destroy(source);
+    }
+
+    /*Tests_SRS_MESSAGE_13_041: [ If messageHandle is NULL then Message_ToByteArrayHandle shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_ToByteArrayHandle_with_NULL_messageHandle_fails)
+    {
+        ///arrange
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail_whenThereIsOnly3ByteOfcontentSize, sizeof(fail_whenThereIsOnly3ByteOfcontentSize));
+        CONSTBUFFER_HANDLE result = Message_ToByteArrayHandle(NULL);
 
         ///assert
-        ASSERT_IS_NULL(handle);
+        ASSERT_IS_NULL(result);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         ///cleanup
     }
 
-    /*Tests_SRS_MESSAGE_02_025: [ If while parsing the message content, a read would occur past the end of the array (as indicated by size) then Message_CreateFromByteArray shall fail and return NULL. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_with_1_byte_of_content_size_but_no_content_fails)
+    /*Tests_SRS_MESSAGE_13_042: [ If the message was created with Message_CreateFromByteArrayView, Message_ToByteArrayHandle shall return a clone of the byte array it was created from. ]*/
+    TEST_FUNCTION(Message_ToByteArrayHandle_returns_a_clone_of_the_byte_array_of_a_view)
     {
         ///arrange
+        CONSTBUFFER_HANDLE source = CONSTBUFFER_Create(notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes));
+        MESSAGE_HANDLE handle = Message_CreateFromByteArrayView(source);
+        umock_c_reset_all_calls();
 
-        const unsigned char fail_whenThereIsNotEnoughContent[] =
-        {
-            0xA1, 0x60,             /*header*/
-            0x00, 0x00, 0x00, 22,   /*size of this array*/
-            0x00, 0x00, 0x00, 0x01, /*one property*/
-            '3', '3', '3', '\0',
-            '3', '3', '3', '\0',
-            0x00, 0x00, 0x00, 0x01  /*no further content*/
-        };
-
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, "333", "333"));
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
+        STRICT_EXPECTED_CALL(CONSTBUFFER_Clone(source));
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail_whenThereIsNotEnoughContent, sizeof(fail_whenThereIsNotEnoughContent));
+        CONSTBUFFER_HANDLE result = Message_ToByteArrayHandle(handle);
 
         ///assert
-        ASSERT_IS_NULL(handle);
+        ASSERT_ARE_EQUAL(void_ptr, (void*)source, (void*)result);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, 3, currentCONSTBUFFER_refCount);
 
         ///cleanup
+        CONSTBUFFER_Destroy(result);
+        Message_Destroy(handle);
+        CONSTBUFFER_Destroy(source);
     }
 
-    /*Tests_SRS_MESSAGE_02_025: [ If while parsing the message content, a read would occur past the end of the array (as indicated by size) then Message_CreateFromByteArray shall fail and return NULL. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_with_1_byte_of_content_size_but_2_bytes_of_content_fails)
+    /*Tests_SRS_MESSAGE_13_043: [ Otherwise Message_ToByteArrayHandle shall create a CONSTBUFFER_HANDLE holding the byte array Message_ToByteArray creates from the message, and return NULL if that fails. ]*/
+    TEST_FUNCTION(Message_ToByteArrayHandle_serializes_other_messages)
     {
         ///arrange
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes));
+        umock_c_reset_all_calls();
 
-        const unsigned char fail_whenThereIsTooMuchContent[] =
-        {
-            0xA1, 0x60,             /*header*/
-            0x00, 0x00, 0x00, 24,   /*size of this array*/
-            0x00, 0x00, 0x00, 0x01, /*one property*/
-            '3', '3', '3', '\0',
-            '3', '3', '3', '\0',
-            0x00, 0x00, 0x00, 0x01,  /*no further content*/
-            '3', '3'
-        };
-
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, "333", "333"));
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
+        STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(notFail__2Property_2bytes)));
+        STRICT_EXPECTED_CALL(CONSTBUFFER_Create(IGNORED_PTR_ARG, sizeof(notFail__2Property_2bytes)))
+            .IgnoreArgument_source();
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument_ptr();
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(fail_whenThereIsTooMuchContent, sizeof(fail_whenThereIsTooMuchContent));
+        CONSTBUFFER_HANDLE result = Message_ToByteArrayHandle(handle);
 
         ///assert
-        ASSERT_IS_NULL(handle);
+        ASSERT_IS_NOT_NULL(result);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, sizeof(notFail__2Property_2bytes), CONSTBUFFER_GetContent(result)->size);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(CONSTBUFFER_GetContent(result)->buffer, notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes)));
 
         ///cleanup
+        CONSTBUFFER_Destroy(result);
+        Message_Destroy(handle);
     }
 
-    /*Tests_SRS_MESSAGE_02_030: [ If any of the above steps fails, then Message_CreateFromByteArray shall fail and return NULL. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_fails_when_Map_Create_fails)
+    /*Tests_SRS_MESSAGE_13_043: [ Otherwise Message_ToByteArrayHandle shall create a CONSTBUFFER_HANDLE holding the byte array Message_ToByteArray creates from the message, and return NULL if that fails. ]*/
+    TEST_FUNCTION(Message_ToByteArrayHandle_fails_when_CONSTBUFFER_Create_fails)
     {
         ///arrange
+        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes));
+        umock_c_reset_all_calls();
+        whenShallCONSTBUFFER_Create_fail = 1;
 
-        const unsigned char notFail____minimalMessage[] =
-        {
-            0xA1, 0x60,             /*header*/
-            0x00, 0x00, 0x00, 14,   /*size of this array*/
-            0x00, 0x00, 0x00, 0x00, /*zero properties*/
-            0x00, 0x00, 0x00, 0x00  /*zero message content size*/
-        };
-
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(NULL);
+        STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(notFail__2Property_2bytes)));
+        STRICT_EXPECTED_CALL(CONSTBUFFER_Create(IGNORED_PTR_ARG, sizeof(notFail__2Property_2bytes)))
+            .IgnoreArgument_source();
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument_ptr();
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail____minimalMessage, sizeof(notFail____minimalMessage));
+        CONSTBUFFER_HANDLE result = Message_ToByteArrayHandle(handle);
 
         ///assert
-        ASSERT_IS_NULL(handle);
+        ASSERT_IS_NULL(result);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         ///cleanup
+        Message_Destroy(handle);
     }
 
-    /*Tests_SRS_MESSAGE_02_030: [ If any of the above steps fails, then Message_CreateFromByteArray shall fail and return NULL. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_fails_when_numberOfProperties_is_negative)
+    /*Tests_SRS_MESSAGE_13_044: [ Message_Destroy shall destroy the byte array kept by a message created with Message_CreateFromByteArrayView, instead of releasing its names, when the ref count is zero. ]*/
+    TEST_FUNCTION(Message_Destroy_destroys_the_byte_array_of_a_view)
     {
         ///arrange
+        CONSTBUFFER_HANDLE source = CONSTBUFFER_Create(notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes));
+        MESSAGE_HANDLE handle = Message_CreateFromByteArrayView(source);
+        umock_c_reset_all_calls();
 
-        const unsigned char notFail____minimalMessage[] =
-        {
-            0xA1, 0x60,             /*header*/
-            0x00, 0x00, 0x00, 14,   /*size of this array*/
-            0xFF, 0xFF, 0xFF, 0xFF, /*-1 properties*/
-            0x00, 0x00, 0x00, 0x00  /*zero message content size*/
-        };
-
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
+        STRICT_EXPECTED_CALL(CONSTBUFFER_Destroy(source));
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument_ptr();
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail____minimalMessage, sizeof(notFail____minimalMessage));
+        Message_Destroy(handle);
 
         ///assert
-        ASSERT_IS_NULL(handle);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, 1, currentCONSTBUFFER_refCount);
+        ASSERT_ARE_EQUAL(size_t, 0, currentStringIntern_refCount);
 
         ///cleanup
+        CONSTBUFFER_Destroy(source);
     }
 
-    /*Tests_SRS_MESSAGE_02_030: [ If any of the above steps fails, then Message_CreateFromByteArray shall fail and return NULL. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_fails_when_numberOfProperties_is_int32_max)
+    /*Tests_SRS_MESSAGE_13_035: [ Message_CreateFromByteArrayView shall use the names and values in the byte array as the properties of the message, without copying nor interning them, and index them as Message_Create does. ]*/
+    /*Tests_SRS_MESSAGE_13_040: [ A message created with Message_CreateFromByteArrayView shall serialize to the byte array it was created from. ]*/
+    TEST_FUNCTION(Message_CreateFromByteArrayView_reads_random_byte_arrays_as_Message_CreateFromByteArray)
     {
         ///arrange
+        unsigned char source[RANDOM_BYTE_ARRAY_SIZE];
+        unsigned char destination[RANDOM_BYTE_ARRAY_SIZE];
+        int iteration;
+        srand(43);
 
-        const unsigned char notFail____minimalMessage[] =
+        for (iteration = 0; iteration < 1000; iteration++)
         {
-            0xA1, 0x60,             /*header*/
-            0x00, 0x00, 0x00, 14,   /*size of this array*/
-            0x7F, 0xFF, 0xFF, 0xFF, /*INT32_MAX properties*/
-            0x00, 0x00, 0x00, 0x00  /*zero message content size*/
-        };
-
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
+            int32_t size = (int32_t)make_random_byte_array(source);
+            CONSTBUFFER_HANDLE byteArray = CONSTBUFFER_Create(source, size);
+            MESSAGE_HANDLE copy = Message_CreateFromByteArray(source, size);
+            int32_t count = (source[6] << 24) | (source[7] << 16) | (source[8] << 8) | source[9];
+            const char* name = (const char*)source + 10;
+            int32_t i;
+
+            ///act
+            MESSAGE_HANDLE view = Message_CreateFromByteArrayView(byteArray);
+
+            ///assert
+            ASSERT_IS_NOT_NULL(view);
+            for (i = 0; i < count; i++)
+            {
+                const char* value = name + strlen(name) + 1;
+                ASSERT_ARE_EQUAL(char_ptr, Message_GetProperty(copy, name), Message_GetProperty(view, name));
+                ASSERT_ARE_EQUAL(char_ptr, value, Message_GetProperty(view, name));
+                name = value + strlen(value) + 1;
+            }
+            ASSERT_ARE_EQUAL(size_t, Message_GetContent(copy)->size, Message_GetContent(view)->size);
+            ASSERT_ARE_EQUAL(int32_t, size, Message_ToByteArrayBuffer(view, destination, sizeof(destination)));
+            ASSERT_ARE_EQUAL(int, 0, memcmp(source, destination, size));
+
+            ///cleanup
+            Message_Destroy(view);
+            Message_Destroy(copy);
+            CONSTBUFFER_Destroy(byteArray);
+            ASSERT_ARE_EQUAL(size_t, 0, currentCONSTBUFFER_refCount);
+            umock_c_reset_all_calls();
+        }
+    }
 
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
+    /*Tests_SRS_MESSAGE_13_045: [ If parent or overrides is NULL then Message_CreateDerived shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateDerived_with_NULL_parent_fails)
+    {
+        ///arrange
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail____minimalMessage, sizeof(notFail____minimalMessage));
+        MESSAGE_HANDLE result = Message_CreateDerived(NULL, TEST_MAP_HANDLE);
 
         ///assert
-        ASSERT_IS_NULL(handle);
+        ASSERT_IS_NULL(result);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         ///cleanup
     }
 
-    /*Tests_SRS_MESSAGE_02_030: [ If any of the above steps fails, then Message_CreateFromByteArray shall fail and return NULL. ]*/
-    TEST_FUNCTION(Message_CreateFromByteArray_fails_when_Map_Add_fails)
+    /*Tests_SRS_MESSAGE_13_045: [ If parent or overrides is NULL then Message_CreateDerived shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateDerived_with_NULL_overrides_fails)
     {
-
         ///arrange
-
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, "3", "3"))
-            .SetReturn(MAP_ERROR);
-
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
+        MESSAGE_CONFIG c = { 0, NULL, TEST_MAP_HANDLE };
+        MESSAGE_HANDLE parent = Message_Create(&c);
+        umock_c_reset_all_calls();
 
         ///act
-        MESSAGE_HANDLE handle = Message_CreateFromByteArray(notFail__1Property_0bytes, sizeof(notFail__1Property_0bytes));
+        MESSAGE_HANDLE result = Message_CreateDerived(parent, NULL);
 
         ///assert
-        ASSERT_IS_NULL(handle);
+        ASSERT_IS_NULL(result);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         ///cleanup
-        Message_Destroy(handle);
+        Message_Destroy(parent);
     }
 
-    /*Tests_SRS_MESSAGE_02_032: [ If messageHandle is NULL then Message_ToByteArray shall fail and return NULL. ]*/
-    TEST_FUNCTION(Message_ToByteArray_fails_with_NULL_messageHandle_parameter)
+    /*Tests_SRS_MESSAGE_13_046: [ Message_CreateDerived shall allocate the message, with room for the properties of overrides only, with MessagePool_Allocate. ]*/
+    /*Tests_SRS_MESSAGE_13_047: [ Message_CreateDerived shall store the names of overrides acquired from the string intern table and copies of their values, and index them as Message_Create does. ]*/
+    /*Tests_SRS_MESSAGE_13_049: [ Message_CreateDerived shall clone the message it derives from, and share its content without copying it. ]*/
+    /*Tests_SRS_MESSAGE_13_051: [ On success, Message_CreateDerived shall return a non-NULL handle and set the internal ref count to "1". ]*/
+    /*Tests_SRS_MESSAGE_13_052: [ Message_GetProperty shall look for the property in the properties of a derived message first, then in the properties of its parent. ]*/
+    TEST_FUNCTION(Message_CreateDerived_happy_path)
     {
-
         ///arrange
-        int32_t size;
+        unsigned char content[3] = { 1, 2, 3 };
+        MESSAGE_CONFIG c = { sizeof(content), content, TEST_MAP_HANDLE };
+        const char* keys[] = { "macAddress", "source" };
+        const char* values[] = { "01:02:03:03:02:01", "bleTelemetry" };
+        const char* overrideKeys[] = { "deviceName", "source" };
+        const char* overrideValues[] = { "firstDevice", "mapping" };
+        MESSAGE_HANDLE parent;
+        test_keys = keys;
+        test_values = values;
+        test_property_count = 2;
+        parent = Message_Create(&c);
+        test_keys = overrideKeys;
+        test_values = overrideValues;
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(Map_GetInternals((MAP_HANDLE)&c, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is reading the overrides*/
+            .IgnoreArgument_keys()
+            .IgnoreArgument_values()
+            .IgnoreArgument_count();
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the structure*/
+            .IgnoreArgument(1);
 
         ///act
-        const unsigned char* byteArray = Message_ToByteArray(NULL, &size);
+        MESSAGE_HANDLE result = Message_CreateDerived(parent, (MAP_HANDLE)&c);
 
         ///assert
-        ASSERT_IS_NULL(byteArray);
+        ASSERT_IS_NOT_NULL(result);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, 4, currentStringIntern_refCount);
+        ASSERT_ARE_EQUAL(char_ptr, "01:02:03:03:02:01", Message_GetProperty(result, "macAddress"));
+        ASSERT_ARE_EQUAL(char_ptr, "mapping", Message_GetProperty(result, "source"));
+        ASSERT_ARE_EQUAL(char_ptr, "firstDevice", Message_GetProperty(result, "deviceName"));
+        ASSERT_ARE_EQUAL(char_ptr, "bleTelemetry", Message_GetProperty(parent, "source"));
+        ASSERT_IS_NULL(Message_GetProperty(parent, "deviceName"));
+        ASSERT_ARE_EQUAL(void_ptr, (void*)Message_GetContent(parent)->buffer, (void*)Message_GetContent(result)->buffer);
+        ASSERT_ARE_EQUAL(size_t, sizeof(content), Message_GetContent(result)->size);
 
         ///cleanup
+        Message_Destroy(parent);
+        ASSERT_ARE_EQUAL(size_t, 4, currentStringIntern_refCount);
+        Message_Destroy(result);
+        ASSERT_ARE_EQUAL(size_t, 0, currentStringIntern_refCount);
     }
 
-    /*Tests_SRS_MESSAGE_02_038: [ If size is NULL then Message_ToByteArray shall fail and return NULL. ]*/
-    TEST_FUNCTION(Message_ToByteArray_fails_with_NULL_size_parameter)
+    /*Tests_SRS_MESSAGE_13_050: [ If any of the above steps fails, Message_CreateDerived shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateDerived_fails_when_malloc_fails)
     {
-
         ///arrange
+        MESSAGE_CONFIG c = { 0, NULL, TEST_MAP_HANDLE };
+        const char* keys[] = { "deviceName" };
+        const char* values[] = { "firstDevice" };
+        MESSAGE_HANDLE parent = Message_Create(&c);
+        test_keys = keys;
+        test_values = values;
+        test_property_count = 1;
+        umock_c_reset_all_calls();
+        whenShallmalloc_fail = currentmalloc_call + 1;
+
+        STRICT_EXPECTED_CALL(Map_GetInternals((MAP_HANDLE)&c, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument_keys()
+            .IgnoreArgument_values()
+            .IgnoreArgument_count();
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
 
         ///act
-        const unsigned char* byteArray = Message_ToByteArray(TEST_MESSAGE_HANDLE, NULL);
+        MESSAGE_HANDLE result = Message_CreateDerived(parent, (MAP_HANDLE)&c);
 
         ///assert
-        ASSERT_IS_NULL(byteArray);
+        ASSERT_IS_NULL(result);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, 0, currentStringIntern_refCount);
 
         ///cleanup
+        Message_Destroy(parent);
     }
 
-    /*Tests_SRS_MESSAGE_02_033: [ Message_ToByteArray shall precompute the needed memory size and shall pre allocate it. ]*/
-    /*Tests_SRS_MESSAGE_02_034: [ Message_ToByteArray shall populate the memory with values as indicated in the implementation details. ]*/
-    /*Tests_SRS_MESSAGE_02_036: [ Otherwise Message_ToByteArray shall succeed, write in *size the byte array size and return a non-NULL result. ]*/
-    TEST_FUNCTION(Message_ToByteArray_no_properties_no_content_happy_path)
+    /*Tests_SRS_MESSAGE_13_050: [ If any of the above steps fails, Message_CreateDerived shall fail and return NULL. ]*/
+    TEST_FUNCTION(Message_CreateDerived_fails_when_StringIntern_Acquire_fails)
     {
-
         ///arrange
-        int32_t size;
-
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
-        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-            .IgnoreAllCalls();
-        STRICT_EXPECTED_CALL(CONSTBUFFER_Create(IGNORED_PTR_ARG, 0))
-            .IgnoreArgument_source();
-        STRICT_EXPECTED_CALL(ConstMap_Create(TEST_MAP_HANDLE));
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
-
-        MESSAGE_HANDLE messageHandle = Message_CreateFromByteArray(notFail____minimalMessage, sizeof(notFail____minimalMessage));
-
-        size_t zero = 0;
-        const CONSTBUFFER bufferContent = { NULL, 0 };
+        MESSAGE_CONFIG c = { 0, NULL, TEST_MAP_HANDLE };
+        const char* keys[] = { "deviceName", "deviceKey" };
+        const char* values[] = { "firstDevice", "secret" };
+        MESSAGE_HANDLE parent = Message_Create(&c);
+        test_keys = keys;
+        test_values = values;
+        test_property_count = 2;
+        umock_c_reset_all_calls();
+        whenShallStringIntern_Acquire_fail = currentStringIntern_Acquire_call + 2; /*the name of the second override*/
 
-        STRICT_EXPECTED_CALL(ConstMap_GetInternals(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument_handle()
+        STRICT_EXPECTED_CALL(Map_GetInternals((MAP_HANDLE)&c, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument_keys()
             .IgnoreArgument_values()
-            .CopyOutArgumentBuffer(4, &zero, sizeof(zero));
-        STRICT_EXPECTED_CALL(CONSTBUFFER_GetContent(IGNORED_PTR_ARG))
-            .IgnoreArgument_constbufferHandle()
-            .SetReturn(&bufferContent);
+            .IgnoreArgument_count();
         STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-            .IgnoreArgument_size();
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
 
         ///act
-        const unsigned char* byteArray = Message_ToByteArray(messageHandle, &size);
+        MESSAGE_HANDLE result = Message_CreateDerived(parent, (MAP_HANDLE)&c);
 
         ///assert
-        ASSERT_IS_NOT_NULL(byteArray);
-        ASSERT_ARE_EQUAL(int32_t, sizeof(notFail____minimalMessage), size);
-        ASSERT_ARE_EQUAL(int, 0, memcmp(byteArray, notFail____minimalMessage, size));
+        ASSERT_IS_NULL(result);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, 0, currentStringIntern_refCount);
 
         ///cleanup
-        free((void*)byteArray);
-        Message_Destroy(messageHandle);
+        Message_Destroy(parent);
     }
 
-    /*Tests_SRS_MESSAGE_02_033: [ Message_ToByteArray shall precompute the needed memory size and shall pre allocate it. ]*/
-    /*Tests_SRS_MESSAGE_02_034: [ Message_ToByteArray shall populate the memory with values as indicated in the implementation details. ]*/
-    /*Tests_SRS_MESSAGE_02_036: [ Otherwise Message_ToByteArray shall succeed, write in *size the byte array size and return a non-NULL result. ]*/
-    TEST_FUNCTION(Message_ToByteArray_with_properties_and_content_happy_path)
+    /*Tests_SRS_MESSAGE_13_048: [ If parent is itself derived, Message_CreateDerived shall derive the message from the parent of parent instead, and make room for the properties of parent that overrides does not override. ]*/
+    TEST_FUNCTION(Message_CreateDerived_from_a_derived_message_carries_its_overrides_over)
     {
+        ///arrange
+        MESSAGE_CONFIG c = { 0, NULL, TEST_MAP_HANDLE };
+        const char* keys[] = { "macAddress", "source" };
+        const char* values[] = { "01:02:03:03:02:01", "bleTelemetry" };
+        const char* firstKeys[] = { "deviceName", "source" };
+        const char* firstValues[] = { "firstDevice", "mapping" };
+        const char* secondKeys[] = { "deviceName" };
+        const char* secondValues[] = { "secondDevice" };
+        MESSAGE_HANDLE parent;
+        MESSAGE_HANDLE first;
+        test_keys = keys;
+        test_values = values;
+        test_property_count = 2;
+        parent = Message_Create(&c);
+        test_keys = firstKeys;
+        test_values = firstValues;
+        first = Message_CreateDerived(parent, TEST_MAP_HANDLE);
+        test_keys = secondKeys;
+        test_values = secondValues;
+        test_property_count = 1;
+        Message_Destroy(parent);
+        umock_c_reset_all_calls();
+
+        ///act
+        MESSAGE_HANDLE result = Message_CreateDerived(first, TEST_MAP_HANDLE);
+        Message_Destroy(first);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(result);
+        ASSERT_ARE_EQUAL(char_ptr, "01:02:03:03:02:01", Message_GetProperty(result, "macAddress"));
+        ASSERT_ARE_EQUAL(char_ptr, "mapping", Message_GetProperty(result, "source"));
+        ASSERT_ARE_EQUAL(char_ptr, "secondDevice", Message_GetProperty(result, "deviceName"));
+
+        ///cleanup
+        Message_Destroy(result);
+        ASSERT_ARE_EQUAL(size_t, 0, currentStringIntern_refCount);
+    }
 
+    /*Tests_SRS_MESSAGE_13_053: [ The properties of a derived message, as Message_GetProperties and Message_ToByteArray see them, shall be the properties of overrides followed by the properties of its parent they do not override. ]*/
+    TEST_FUNCTION(Message_GetProperties_of_a_derived_message_merges_the_overrides)
+    {
         ///arrange
-        int32_t size;
+        MESSAGE_CONFIG c = { 0, NULL, TEST_MAP_HANDLE };
+        const char* keys[] = { "macAddress", "source" };
+        const char* values[] = { "01:02:03:03:02:01", "bleTelemetry" };
+        const char* overrideKeys[] = { "source" };
+        const char* overrideValues[] = { "mapping" };
+        MESSAGE_HANDLE parent;
+        MESSAGE_HANDLE derived;
+        test_keys = keys;
+        test_values = values;
+        test_property_count = 2;
+        parent = Message_Create(&c);
+        test_keys = overrideKeys;
+        test_values = overrideValues;
+        test_property_count = 1;
+        derived = Message_CreateDerived(parent, TEST_MAP_HANDLE);
+        umock_c_reset_all_calls();
 
         STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
             .IgnoreArgument_mapFilterFunc()
             .SetReturn(TEST_MAP_HANDLE);
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-            .IgnoreAllCalls();
-        STRICT_EXPECTED_CALL(CONSTBUFFER_Create(IGNORED_PTR_ARG, 2))
-            .IgnoreArgument_source();
+        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, "source", "mapping"));
+        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, "macAddress", "01:02:03:03:02:01"));
         STRICT_EXPECTED_CALL(ConstMap_Create(TEST_MAP_HANDLE));
         STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
-
-        MESSAGE_HANDLE messageHandle = Message_CreateFromByteArray(notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes));
-
-        size_t two = 2;
-        const char* keys[] = { "BleedingEdge", "Azure IoT Gateway is" };
-        const char* values[] = { "rocks", "awesome" };
-        const char* const* *pkeys = (const char* const* *)&keys;
-        const char* const* *pvalues = (const char* const* *)&values;
-
-        const CONSTBUFFER bufferContent = { (const unsigned char*)"34", 2 };
-
-        STRICT_EXPECTED_CALL(ConstMap_GetInternals(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument_handle()
-            .CopyOutArgumentBuffer(2, &pkeys, sizeof(char**))
-            .CopyOutArgumentBuffer(3, &pvalues, sizeof(char**))
-            .CopyOutArgumentBuffer(4, &two, sizeof(two));
-        STRICT_EXPECTED_CALL(CONSTBUFFER_GetContent(IGNORED_PTR_ARG))
-            .IgnoreArgument_constbufferHandle()
-            .SetReturn(&bufferContent);
-        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-            .IgnoreArgument_size();
+        STRICT_EXPECTED_CALL(ConstMap_Clone(IGNORED_PTR_ARG)).IgnoreArgument(1);
 
         ///act
-        const unsigned char* byteArray = Message_ToByteArray(messageHandle, &size);
+        CONSTMAP_HANDLE result = Message_GetProperties(derived);
 
         ///assert
-        ASSERT_IS_NOT_NULL(byteArray);
-        ASSERT_ARE_EQUAL(int32_t, sizeof(notFail__2Property_2bytes), size);
-        ASSERT_ARE_EQUAL(int, 0, memcmp(byteArray, notFail__2Property_2bytes, size));
+        ASSERT_IS_NOT_NULL(result);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         ///cleanup
-        free((void*)byteArray);
-        Message_Destroy(messageHandle);
+        ConstMap_Destroy(result);
+        Message_Destroy(derived);
+        Message_Destroy(parent);
     }
 
-    /*Tests_SRS_MESSAGE_02_035: [ If any of the above steps fails then Message_ToByteArray shall fail and return NULL. ]*/
-    TEST_FUNCTION(Message_ToByteArray_with_properties_and_content_fails_when_ConstMap_GetInternals_fails)
+    /*Tests_SRS_MESSAGE_13_053: [ The properties of a derived message, as Message_GetProperties and Message_ToByteArray see them, shall be the properties of overrides followed by the properties of its parent they do not override. ]*/
+    TEST_FUNCTION(Message_ToByteArray_of_a_derived_message_merges_the_overrides)
     {
-
         ///arrange
+        const unsigned char expected[] =
+        {
+            0xA1, 0x60,             /*header*/
+            0x00, 0x00, 0x00, 29,   /*size of this array*/
+            0x00, 0x00, 0x00, 0x03, /*three properties*/
+            'b', '\0', '5', '\0',
+            'c', '\0', '6', '\0',
+            'a', '\0', '1', '\0',
+            0x00, 0x00, 0x00, 0x03, /*3 bytes of content*/
+            7, 8, 9
+        };
+        const unsigned char source[] =
+        {
+            0xA1, 0x60,             /*header*/
+            0x00, 0x00, 0x00, 25,   /*size of this array*/
+            0x00, 0x00, 0x00, 0x02, /*two properties*/
+            'a', '\0', '1', '\0',
+            'b', '\0', '2', '\0',
+            0x00, 0x00, 0x00, 0x03, /*3 bytes of content*/
+            7, 8, 9
+        };
+        const char* overrideKeys[] = { "b", "c" };
+        const char* overrideValues[] = { "5", "6" };
         int32_t size;
+        MESSAGE_HANDLE parent = Message_CreateFromByteArray(source, sizeof(source));
+        MESSAGE_HANDLE derived;
+        test_keys = overrideKeys;
+        test_values = overrideValues;
+        test_property_count = 2;
+        derived = Message_CreateDerived(parent, TEST_MAP_HANDLE);
+        umock_c_reset_all_calls();
 
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-            .IgnoreAllCalls();
-        STRICT_EXPECTED_CALL(CONSTBUFFER_Create(IGNORED_PTR_ARG, 2))
-            .IgnoreArgument_source();
-        STRICT_EXPECTED_CALL(ConstMap_Create(TEST_MAP_HANDLE));
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
+        ///act
+        const unsigned char* result = Message_ToByteArray(derived, &size);
 
-        MESSAGE_HANDLE messageHandle = Message_CreateFromByteArray(notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes));
+        ///assert
+        ASSERT_IS_NOT_NULL(result);
+        ASSERT_ARE_EQUAL(int32_t, sizeof(expected), size);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(expected, result, sizeof(expected)));
 
-        size_t two = 2;
-        const char* keys[] = { "BleedingEdge", "Azure IoT Gateway is" };
-        const char* values[] = { "rocks", "awesome" };
-        const char* const* *pkeys = (const char* const* *)&keys;
-        const char* const* *pvalues = (const char* const* *)&values;
+        ///cleanup
+        free((void*)result);
+        Message_Destroy(derived);
+        Message_Destroy(parent);
+    }
 
-        const CONSTBUFFER bufferContent = { (const unsigned char*)"34", 2 };
+    /*Tests_SRS_MESSAGE_13_054: [ Message_GetContentHandle shall return the CONSTBUFFER_HANDLE of the parent of a derived message. ]*/
+    TEST_FUNCTION(Message_GetContentHandle_of_a_derived_message_returns_the_handle_of_its_parent)
+    {
+        ///arrange
+        unsigned char fake = 0x42;
+        CONSTBUFFER_HANDLE buffer = CONSTBUFFER_Create(&fake, 1);
+        MESSAGE_BUFFER_CONFIG c = { buffer, TEST_MAP_HANDLE };
+        MESSAGE_HANDLE parent = Message_CreateFromBuffer(&c);
+        MESSAGE_HANDLE derived = Message_CreateDerived(parent, TEST_MAP_HANDLE);
+        umock_c_reset_all_calls();
 
-        STRICT_EXPECTED_CALL(ConstMap_GetInternals(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument_handle()
-            .CopyOutArgumentBuffer(2, &pkeys, sizeof(char**))
-            .CopyOutArgumentBuffer(3, &pvalues, sizeof(char**))
-            .CopyOutArgumentBuffer(4, &two, sizeof(two))
-            .SetReturn(CONSTMAP_ERROR);
+        STRICT_EXPECTED_CALL(CONSTBUFFER_Clone(buffer));
 
         ///act
-        const unsigned char* byteArray = Message_ToByteArray(messageHandle, &size);
+        CONSTBUFFER_HANDLE result = Message_GetContentHandle(derived);
 
         ///assert
-        ASSERT_IS_NULL(byteArray);
+        ASSERT_ARE_EQUAL(void_ptr, (void*)buffer, (void*)result);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
         ///cleanup
-        free((void*)byteArray);
-        Message_Destroy(messageHandle);
+        CONSTBUFFER_Destroy(result);
+        Message_Destroy(derived);
+        Message_Destroy(parent);
+        CONSTBUFFER_Destroy(buffer);
     }
 
-    /*Tests_SRS_MESSAGE_02_035: [ If any of the above steps fails then Message_ToByteArray shall fail and return NULL. ]*/
-    TEST_FUNCTION(Message_ToByteArray_with_properties_and_content_fails_when_malloc_fails)
+    /*Tests_SRS_MESSAGE_13_055: [ Message_Destroy shall destroy the parent of a derived message when the ref count is zero. ]*/
+    TEST_FUNCTION(Message_Destroy_destroys_the_parent_of_a_derived_message)
     {
-
         ///arrange
-        int32_t size;
-
-        STRICT_EXPECTED_CALL(Map_Create(IGNORED_PTR_ARG))
-            .IgnoreArgument_mapFilterFunc()
-            .SetReturn(TEST_MAP_HANDLE);
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(Map_Add(TEST_MAP_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-            .IgnoreAllCalls();
-        STRICT_EXPECTED_CALL(CONSTBUFFER_Create(IGNORED_PTR_ARG, 2))
-            .IgnoreArgument_source();
-        STRICT_EXPECTED_CALL(ConstMap_Create(TEST_MAP_HANDLE));
-        STRICT_EXPECTED_CALL(Map_Destroy(TEST_MAP_HANDLE));
-
-        MESSAGE_HANDLE messageHandle = Message_CreateFromByteArray(notFail__2Property_2bytes, sizeof(notFail__2Property_2bytes));
+        unsigned char fake = 0x42;
+        CONSTBUFFER_HANDLE buffer = CONSTBUFFER_Create(&fake, 1);
+        MESSAGE_BUFFER_CONFIG c = { buffer, TEST_MAP_HANDLE };
+        MESSAGE_HANDLE parent = Message_CreateFromBuffer(&c);
+        MESSAGE_HANDLE derived = Message_CreateDerived(parent, TEST_MAP_HANDLE);
+        Message_Destroy(parent);
+        umock_c_reset_all_calls();
 
-        size_t two = 2;
-        const char* keys[] = { "BleedingEdge", "Azure IoT Gateway is" };
-        const char* values[] = { "rocks", "awesome" };
-        const char* const* *pkeys = (const char* const* *)&keys;
-        const char* const* *pvalues = (const char* const* *)&values;
-
-        const CONSTBUFFER bufferContent = { (const unsigned char*)"34", 2 };
-
-        STRICT_EXPECTED_CALL(ConstMap_GetInternals(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument_handle()
-            .CopyOutArgumentBuffer(2, &pkeys, sizeof(char**))
-            .CopyOutArgumentBuffer(3, &pvalues, sizeof(char**))
-            .CopyOutArgumentBuffer(4, &two, sizeof(two));
-        STRICT_EXPECTED_CALL(CONSTBUFFER_GetContent(IGNORED_PTR_ARG))
-            .IgnoreArgument_constbufferHandle()
-            .SetReturn(&bufferContent);
-        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-            .IgnoreArgument_size()
-            .SetReturn(NULL);
+        STRICT_EXPECTED_CALL(CONSTBUFFER_Destroy(buffer)); /*this is the content of the parent*/
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*this is the parent*/
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)) /*this is the derived message*/
+            .IgnoreArgument(1);
 
         ///act
-        const unsigned char* byteArray = Message_ToByteArray(messageHandle, &size);
+        Message_Destroy(derived);
 
         ///assert
-        ASSERT_IS_NULL(byteArray);
         ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        ASSERT_ARE_EQUAL(size_t, 1, currentCONSTBUFFER_refCount);
 
         ///cleanup
-        free((void*)byteArray);
-        Message_Destroy(messageHandle);
+        CONSTBUFFER_Destroy(buffer);
     }
 
 END_TEST_SUITE(gwmessage_unittests)
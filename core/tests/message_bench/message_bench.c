@@ -0,0 +1,311 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/*
+* Measures what it costs to create a message, for several sizes of content and
+* numbers of properties. Every case creates and destroys messages in a loop:
+*     create             - Message_Create, the content is copied next to the message
+*     create_from_buffer - CONSTBUFFER_Create then Message_CreateFromBuffer, the
+*                          content lives in its own CONSTBUFFER
+*     create_and_read    - Message_Create, then what a receiver does: read the
+*                          content and the properties
+*     fan_out            - Message_Create, then one Message_Clone and one
+*                          Message_Destroy per recipient, as the message bus
+*                          does for FAN_OUT_RECIPIENTS modules
+* Every case runs twice, first with the message pool disabled then with it
+* enabled, and prints one JSON object on its own line per run:
+*     {"case":"<name>","pool":<bool>,"payload_bytes":<n>,"properties":<n>,
+*      "messages":<n>,"elapsed_ms":<n>,"msgs_per_sec":<n>,
+*      "allocations_per_message":<n>}
+* allocations_per_message is only measured on Linux, where the allocator of
+* the C runtime is wrapped at link time; elsewhere it is null.
+*
+* usage: message_bench [messages_per_case]
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "azure_c_shared_utility/iot_logging.h"
+#include "azure_c_shared_utility/map.h"
+#include "azure_c_shared_utility/constmap.h"
+#include "azure_c_shared_utility/constbuffer.h"
+
+#include "message.h"
+#include "message_pool.h"
+
+#if defined(WIN32)
+#include <windows.h>
+#endif
+
+#define DEFAULT_MESSAGES_PER_CASE 1000000
+#define FAN_OUT_RECIPIENTS        10
+#define POOL_THREAD_CACHE_BLOCKS  64
+#define POOL_CENTRAL_CACHE_BLOCKS 1024
+
+typedef enum BENCH_CASE_TAG
+{
+    BENCH_CREATE,
+    BENCH_CREATE_FROM_BUFFER,
+    BENCH_CREATE_AND_READ,
+    BENCH_FAN_OUT
+}BENCH_CASE;
+
+static const char* case_names[] = { "create", "create_from_buffer", "create_and_read", "fan_out" };
+static const size_t payload_sizes[] = { 20, 256, 4096 };
+static const size_t property_counts[] = { 0, 4 };
+
+#if defined(MESSAGE_BENCH_COUNT_ALLOCATIONS)
+/*the linker sends every call to malloc, calloc and realloc here (-Wl,--wrap)*/
+static size_t allocation_count;
+
+extern void* __real_malloc(size_t size);
+extern void* __real_calloc(size_t nmemb, size_t size);
+extern void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size)
+{
+    allocation_count++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t nmemb, size_t size)
+{
+    allocation_count++;
+    return __real_calloc(nmemb, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size)
+{
+    allocation_count++;
+    return __real_realloc(ptr, size);
+}
+#endif
+
+static uint64_t get_time_us(void)
+{
+#if defined(WIN32)
+    LARGE_INTEGER frequency, counter;
+    (void)QueryPerformanceFrequency(&frequency);
+    (void)QueryPerformanceCounter(&counter);
+    return (uint64_t)((counter.QuadPart / frequency.QuadPart) * 1000000 + ((counter.QuadPart % frequency.QuadPart) * 1000000) / frequency.QuadPart);
+#else
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+#endif
+}
+
+static MAP_HANDLE create_properties(size_t count)
+{
+    MAP_HANDLE result = Map_Create(NULL);
+    if (result == NULL)
+    {
+        LogError("Map_Create failed");
+    }
+    else
+    {
+        size_t i;
+        for (i = 0; i < count; i++)
+        {
+            char name[32];
+            char value[32];
+            (void)sprintf(name, "property%lu", (unsigned long)i);
+            (void)sprintf(value, "value%lu", (unsigned long)i);
+            if (Map_Add(result, name, value) != MAP_OK)
+            {
+                LogError("Map_Add failed");
+                Map_Destroy(result);
+                result = NULL;
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+/*creates and destroys one message the way bench_case says, returns 0 on success*/
+static int create_one(BENCH_CASE bench_case, const unsigned char* payload, size_t payload_bytes, MAP_HANDLE properties)
+{
+    int result;
+    MESSAGE_HANDLE message;
+
+    if (bench_case == BENCH_CREATE_FROM_BUFFER)
+    {
+        CONSTBUFFER_HANDLE content = CONSTBUFFER_Create(payload, payload_bytes);
+        if (content == NULL)
+        {
+            message = NULL;
+        }
+        else
+        {
+            MESSAGE_BUFFER_CONFIG config;
+            config.sourceContent = content;
+            config.sourceProperties = properties;
+            message = Message_CreateFromBuffer(&config);
+            CONSTBUFFER_Destroy(content);
+        }
+    }
+    else
+    {
+        MESSAGE_CONFIG config;
+        config.size = payload_bytes;
+        config.source = payload;
+        config.sourceProperties = properties;
+        message = Message_Create(&config);
+    }
+
+    if (message == NULL)
+    {
+        LogError("unable to create a message");
+        result = __LINE__;
+    }
+    else
+    {
+        result = 0;
+        if (bench_case == BENCH_CREATE_AND_READ)
+        {
+            const CONSTBUFFER* content = Message_GetContent(message);
+            CONSTMAP_HANDLE message_properties = Message_GetProperties(message);
+            if ((content == NULL) || (content->size != payload_bytes) || (message_properties == NULL))
+            {
+                LogError("unable to read the message");
+                result = __LINE__;
+            }
+            ConstMap_Destroy(message_properties);
+        }
+        else if (bench_case == BENCH_FAN_OUT)
+        {
+            MESSAGE_HANDLE clones[FAN_OUT_RECIPIENTS];
+            size_t i;
+            for (i = 0; i < FAN_OUT_RECIPIENTS; i++)
+            {
+                clones[i] = Message_Clone(message);
+            }
+            for (i = 0; i < FAN_OUT_RECIPIENTS; i++)
+            {
+                Message_Destroy(clones[i]);
+            }
+        }
+        Message_Destroy(message);
+    }
+    return result;
+}
+
+static int run_case(BENCH_CASE bench_case, int pooled, size_t payload_bytes, size_t property_count, size_t messages)
+{
+    int result;
+    unsigned char* payload = (unsigned char*)malloc(payload_bytes);
+    MAP_HANDLE properties = create_properties(property_count);
+    if ((payload == NULL) || (properties == NULL))
+    {
+        LogError("unable to prepare the case");
+        result = __LINE__;
+    }
+    else
+    {
+        size_t i;
+        uint64_t start_us;
+        uint64_t elapsed_us;
+#if defined(MESSAGE_BENCH_COUNT_ALLOCATIONS)
+        size_t allocations_before;
+#endif
+        (void)memset(payload, 0x5A, payload_bytes);
+
+        /*warm up the allocator*/
+        result = create_one(bench_case, payload, payload_bytes, properties);
+
+#if defined(MESSAGE_BENCH_COUNT_ALLOCATIONS)
+        allocations_before = allocation_count;
+#endif
+        start_us = get_time_us();
+        for (i = 0; (i < messages) && (result == 0); i++)
+        {
+            result = create_one(bench_case, payload, payload_bytes, properties);
+        }
+        elapsed_us = get_time_us() - start_us;
+
+        if (result == 0)
+        {
+            (void)printf("{\"case\":\"%s\",\"pool\":%s,\"payload_bytes\":%lu,\"properties\":%lu,\"messages\":%lu,\"elapsed_ms\":%llu,\"msgs_per_sec\":%llu,",
+                case_names[bench_case],
+                pooled ? "true" : "false",
+                (unsigned long)payload_bytes,
+                (unsigned long)property_count,
+                (unsigned long)messages,
+                (unsigned long long)(elapsed_us / 1000),
+                (unsigned long long)((elapsed_us == 0) ? 0 : ((uint64_t)messages * 1000000) / elapsed_us));
+#if defined(MESSAGE_BENCH_COUNT_ALLOCATIONS)
+            (void)printf("\"allocations_per_message\":%.2f}\n", (double)(allocation_count - allocations_before) / (double)messages);
+#else
+            (void)printf("\"allocations_per_message\":null}\n");
+#endif
+        }
+    }
+
+    if (properties != NULL)
+    {
+        Map_Destroy(properties);
+    }
+    free(payload);
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    int result = 0;
+    size_t messages_per_case = DEFAULT_MESSAGES_PER_CASE;
+
+    if (argc > 1)
+    {
+        messages_per_case = (size_t)strtoul(argv[1], NULL, 10);
+    }
+
+    if (messages_per_case == 0)
+    {
+        (void)printf("usage: message_bench [messages_per_case]\n");
+        result = 1;
+    }
+    else
+    {
+        size_t i;
+        size_t j;
+        int bench_case;
+        int pooled;
+        for (bench_case = BENCH_CREATE; bench_case <= BENCH_FAN_OUT; bench_case++)
+        {
+            for (i = 0; i < sizeof(payload_sizes) / sizeof(payload_sizes[0]); i++)
+            {
+                for (j = 0; j < sizeof(property_counts) / sizeof(property_counts[0]); j++)
+                {
+                    for (pooled = 0; pooled <= 1; pooled++)
+                    {
+                        MESSAGE_POOL_CONFIG pool_config = { POOL_THREAD_CACHE_BLOCKS, POOL_CENTRAL_CACHE_BLOCKS };
+                        if (pooled && (MessagePool_Enable(&pool_config) != 0))
+                        {
+                            LogError("unable to enable the message pool");
+                            result = 1;
+                        }
+                        else
+                        {
+                            if (run_case((BENCH_CASE)bench_case, pooled, payload_sizes[i], property_counts[j], messages_per_case) != 0)
+                            {
+                                result = 1;
+                            }
+                            if (pooled)
+                            {
+                                MessagePool_Disable();
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,447 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/*
+* Measures the throughput of the message bus: a number of publisher threads
+* publish messages as fast as they can to a fixed set of consumer modules and
+* the time it takes for every consumer to receive every message is reported.
+*
+* Every configuration is run once with a static set of modules and once while
+* another thread keeps adding and removing an idle module, which makes the bus
+* replace the snapshot publishers read the modules from.
+*
+* Every run prints one line of the form:
+*     publishers=<n> consumers=<n> churn=<0|1> messages=<n> publish_ms=<n> publish_msgs_per_sec=<n> elapsed_ms=<n> msgs_per_sec=<n>
+* where messages counts the deliveries (messages published x consumers),
+* publish_ms is the time until every publisher returned and elapsed_ms the time
+* until every consumer received every message. publish_msgs_per_sec is the
+* rate at which the publishers got through MessageBus_Publish, which is what
+* contention between publishers limits.
+*
+* Then MANY_MODULE_COUNT modules are put on one bus, once with a thread per
+* module and once on a worker pool, and every run prints:
+*     modules=<n> worker_pool=<0|1> threads=<n> rss_kb=<n> messages=<n> elapsed_ms=<n> msgs_per_sec=<n>
+* where threads and rss_kb are what the process uses with the modules on the
+* bus (Linux only, 0 elsewhere).
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "azure_c_shared_utility/threadapi.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/iot_logging.h"
+#include "azure_c_shared_utility/map.h"
+
+#include "message.h"
+#include "module.h"
+#include "message_bus.h"
+
+#define CONSUMER_COUNT          4
+#define MESSAGES_PER_RUN        160000
+#define PAYLOAD_SIZE            64
+#define DRAIN_TIMEOUT_MS        120000
+#define MANY_MODULE_COUNT       500
+#define MANY_MODULE_MESSAGES    2000
+
+static const int publisher_counts[] = { 1, 4, 16 };
+
+typedef struct CONSUMER_TAG
+{
+    MODULE              module;
+    MODULE_C_STYLE      module_c_style;
+
+    /*only ever written by the consumer's worker thread*/
+    volatile size_t     received;
+}CONSUMER;
+
+typedef struct PUBLISHER_CONTEXT_TAG
+{
+    MESSAGE_BUS_HANDLE  bus;
+    MESSAGE_HANDLE      message;
+    size_t              count;
+}PUBLISHER_CONTEXT;
+
+typedef struct CHURN_CONTEXT_TAG
+{
+    MESSAGE_BUS_HANDLE  bus;
+    volatile int        stop;
+    size_t              iterations;
+}CHURN_CONTEXT;
+
+static MODULE_HANDLE Consumer_Create(MESSAGE_BUS_HANDLE busHandle, const void* configuration)
+{
+    (void)busHandle;
+    return (MODULE_HANDLE)configuration;
+}
+
+static void Consumer_Destroy(MODULE_HANDLE moduleHandle)
+{
+    (void)moduleHandle;
+}
+
+static void Consumer_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messageHandle)
+{
+    (void)messageHandle;
+    ((CONSUMER*)moduleHandle)->received++;
+}
+
+static const MODULE_APIS consumer_apis =
+{
+    Consumer_Create,
+    Consumer_Destroy,
+    Consumer_Receive
+};
+
+static int publisher_thread(void* param)
+{
+    PUBLISHER_CONTEXT* context = (PUBLISHER_CONTEXT*)param;
+    size_t i;
+    for (i = 0; i < context->count; i++)
+    {
+        if (MessageBus_Publish(context->bus, NULL, context->message) != MESSAGE_BUS_OK)
+        {
+            LogError("MessageBus_Publish failed");
+            break;
+        }
+    }
+    return 0;
+}
+
+/*adds and removes a module that receives nothing until told to stop*/
+static int churn_thread(void* param)
+{
+    CHURN_CONTEXT* context = (CHURN_CONTEXT*)param;
+    CONSUMER idle;
+    idle.received = 0;
+    idle.module_c_style.module_apis = &consumer_apis;
+    idle.module_c_style.module_handle = consumer_apis.Module_Create(context->bus, &idle);
+    idle.module.module_type = NATIVE_C_TYPE;
+    idle.module.module_data = &idle.module_c_style;
+
+    while (!context->stop)
+    {
+        if (MessageBus_AddModule(context->bus, &idle.module) != MESSAGE_BUS_OK)
+        {
+            LogError("MessageBus_AddModule failed");
+            break;
+        }
+        else if (MessageBus_RemoveModule(context->bus, idle.module_c_style.module_handle) != MESSAGE_BUS_OK)
+        {
+            LogError("MessageBus_RemoveModule failed");
+            break;
+        }
+        else
+        {
+            context->iterations++;
+        }
+    }
+
+    consumer_apis.Module_Destroy(idle.module_c_style.module_handle);
+    return 0;
+}
+
+static size_t total_received(CONSUMER* consumers)
+{
+    size_t result = 0;
+    size_t i;
+    for (i = 0; i < CONSUMER_COUNT; i++)
+    {
+        result += consumers[i].received;
+    }
+    return result;
+}
+
+static int run_test(TICK_COUNTER_HANDLE tick_counter, MESSAGE_HANDLE message, int publisher_count, int churn)
+{
+    int result;
+    MESSAGE_BUS_HANDLE bus = MessageBus_Create();
+    if (bus == NULL)
+    {
+        LogError("MessageBus_Create failed");
+        result = __LINE__;
+    }
+    else
+    {
+        CONSUMER consumers[CONSUMER_COUNT];
+        THREAD_HANDLE threads[16];
+        THREAD_HANDLE churn_handle = NULL;
+        PUBLISHER_CONTEXT context;
+        CHURN_CONTEXT churn_context;
+        size_t added = 0;
+        size_t expected;
+        tickcounter_ms_t start_ms, published_ms, end_ms;
+        int started = 0;
+        int i;
+
+        for (added = 0; added < CONSUMER_COUNT; added++)
+        {
+            consumers[added].received = 0;
+            consumers[added].module_c_style.module_apis = &consumer_apis;
+            consumers[added].module_c_style.module_handle = consumer_apis.Module_Create(bus, &consumers[added]);
+            consumers[added].module.module_type = NATIVE_C_TYPE;
+            consumers[added].module.module_data = &consumers[added].module_c_style;
+            if (MessageBus_AddModule(bus, &consumers[added].module) != MESSAGE_BUS_OK)
+            {
+                LogError("MessageBus_AddModule failed");
+                break;
+            }
+        }
+
+        context.bus = bus;
+        context.message = message;
+        context.count = MESSAGES_PER_RUN / publisher_count;
+        expected = context.count * publisher_count * CONSUMER_COUNT;
+
+        churn_context.bus = bus;
+        churn_context.stop = 0;
+        churn_context.iterations = 0;
+
+        if ((added != CONSUMER_COUNT) || (tickcounter_get_current_ms(tick_counter, &start_ms) != 0))
+        {
+            result = __LINE__;
+        }
+        else if (churn && (ThreadAPI_Create(&churn_handle, churn_thread, &churn_context) != THREADAPI_OK))
+        {
+            LogError("ThreadAPI_Create failed");
+            result = __LINE__;
+        }
+        else
+        {
+            for (started = 0; started < publisher_count; started++)
+            {
+                if (ThreadAPI_Create(&threads[started], publisher_thread, &context) != THREADAPI_OK)
+                {
+                    LogError("ThreadAPI_Create failed");
+                    break;
+                }
+            }
+
+            for (i = 0; i < started; i++)
+            {
+                int thread_result;
+                (void)ThreadAPI_Join(threads[i], &thread_result);
+            }
+
+            if (tickcounter_get_current_ms(tick_counter, &published_ms) != 0)
+            {
+                published_ms = start_ms;
+            }
+
+            if (churn_handle != NULL)
+            {
+                int thread_result;
+                churn_context.stop = 1;
+                (void)ThreadAPI_Join(churn_handle, &thread_result);
+            }
+
+            /*wait for the module workers to deliver everything that was published*/
+            end_ms = start_ms;
+            while ((total_received(consumers) < expected) &&
+                   (tickcounter_get_current_ms(tick_counter, &end_ms) == 0) &&
+                   ((end_ms - start_ms) < DRAIN_TIMEOUT_MS))
+            {
+                ThreadAPI_Sleep(1);
+            }
+            (void)tickcounter_get_current_ms(tick_counter, &end_ms);
+
+            if ((started != publisher_count) || (total_received(consumers) < expected))
+            {
+                LogError("only %zu of %zu messages were delivered", total_received(consumers), expected);
+                result = __LINE__;
+            }
+            else
+            {
+                tickcounter_ms_t publish_ms = (published_ms > start_ms) ? (published_ms - start_ms) : 1;
+                tickcounter_ms_t elapsed_ms = (end_ms > start_ms) ? (end_ms - start_ms) : 1;
+                (void)printf("publishers=%d consumers=%d churn=%d messages=%zu publish_ms=%lu publish_msgs_per_sec=%.0f elapsed_ms=%lu msgs_per_sec=%.0f\r\n",
+                    publisher_count, CONSUMER_COUNT, churn, expected,
+                    (unsigned long)publish_ms, (double)(context.count * publisher_count) * 1000.0 / (double)publish_ms,
+                    (unsigned long)elapsed_ms, (double)expected * 1000.0 / (double)elapsed_ms);
+                result = 0;
+            }
+        }
+
+        while (added > 0)
+        {
+            added--;
+            (void)MessageBus_RemoveModule(bus, consumers[added].module_c_style.module_handle);
+            consumer_apis.Module_Destroy(consumers[added].module_c_style.module_handle);
+        }
+
+        MessageBus_Destroy(bus);
+    }
+
+    return result;
+}
+
+/*reads the number of threads and the resident set size of the process*/
+static void get_process_usage(size_t* threads, size_t* rss_kb)
+{
+    *threads = 0;
+    *rss_kb = 0;
+#ifdef __linux__
+    {
+        FILE* status = fopen("/proc/self/status", "r");
+        if (status != NULL)
+        {
+            char line[256];
+            while (fgets(line, sizeof(line), status) != NULL)
+            {
+                if (strncmp(line, "Threads:", 8) == 0)
+                {
+                    *threads = (size_t)strtoul(line + 8, NULL, 10);
+                }
+                else if (strncmp(line, "VmRSS:", 6) == 0)
+                {
+                    *rss_kb = (size_t)strtoul(line + 6, NULL, 10);
+                }
+            }
+            (void)fclose(status);
+        }
+    }
+#endif
+}
+
+static int run_many_modules_test(TICK_COUNTER_HANDLE tick_counter, MESSAGE_HANDLE message, bool use_worker_pool)
+{
+    int result;
+    MESSAGE_BUS_CONFIG bus_config = { use_worker_pool, 0 };
+    MESSAGE_BUS_HANDLE bus = MessageBus_Create2(&bus_config);
+    CONSUMER* consumers = (CONSUMER*)malloc(MANY_MODULE_COUNT * sizeof(CONSUMER));
+    if ((bus == NULL) || (consumers == NULL))
+    {
+        LogError("unable to create the bus or the modules");
+        result = __LINE__;
+    }
+    else
+    {
+        size_t added;
+        size_t threads, rss_kb;
+        size_t received = 0;
+        size_t expected = (size_t)MANY_MODULE_MESSAGES * MANY_MODULE_COUNT;
+        tickcounter_ms_t start_ms, end_ms;
+        size_t i;
+
+        for (added = 0; added < MANY_MODULE_COUNT; added++)
+        {
+            consumers[added].received = 0;
+            consumers[added].module_c_style.module_apis = &consumer_apis;
+            consumers[added].module_c_style.module_handle = consumer_apis.Module_Create(bus, &consumers[added]);
+            consumers[added].module.module_type = NATIVE_C_TYPE;
+            consumers[added].module.module_data = &consumers[added].module_c_style;
+            if (MessageBus_AddModule(bus, &consumers[added].module) != MESSAGE_BUS_OK)
+            {
+                LogError("MessageBus_AddModule failed");
+                break;
+            }
+        }
+        get_process_usage(&threads, &rss_kb);
+
+        if ((added != MANY_MODULE_COUNT) || (tickcounter_get_current_ms(tick_counter, &start_ms) != 0))
+        {
+            result = __LINE__;
+        }
+        else
+        {
+            for (i = 0; i < MANY_MODULE_MESSAGES; i++)
+            {
+                if (MessageBus_Publish(bus, NULL, message) != MESSAGE_BUS_OK)
+                {
+                    LogError("MessageBus_Publish failed");
+                    break;
+                }
+            }
+
+            end_ms = start_ms;
+            do
+            {
+                ThreadAPI_Sleep(1);
+                received = 0;
+                for (i = 0; i < MANY_MODULE_COUNT; i++)
+                {
+                    received += consumers[i].received;
+                }
+            } while ((received < expected) &&
+                     (tickcounter_get_current_ms(tick_counter, &end_ms) == 0) &&
+                     ((end_ms - start_ms) < DRAIN_TIMEOUT_MS));
+            (void)tickcounter_get_current_ms(tick_counter, &end_ms);
+
+            if (received < expected)
+            {
+                LogError("only %zu of %zu messages were delivered", received, expected);
+                result = __LINE__;
+            }
+            else
+            {
+                tickcounter_ms_t elapsed_ms = (end_ms > start_ms) ? (end_ms - start_ms) : 1;
+                (void)printf("modules=%d worker_pool=%d threads=%zu rss_kb=%zu messages=%zu elapsed_ms=%lu msgs_per_sec=%.0f\r\n",
+                    MANY_MODULE_COUNT, use_worker_pool ? 1 : 0, threads, rss_kb, expected,
+                    (unsigned long)elapsed_ms, (double)expected * 1000.0 / (double)elapsed_ms);
+                result = 0;
+            }
+        }
+
+        while (added > 0)
+        {
+            added--;
+            (void)MessageBus_RemoveModule(bus, consumers[added].module_c_style.module_handle);
+            consumer_apis.Module_Destroy(consumers[added].module_c_style.module_handle);
+        }
+    }
+
+    free(consumers);
+    MessageBus_Destroy(bus);
+    return result;
+}
+
+int main(void)
+{
+    int result;
+    TICK_COUNTER_HANDLE tick_counter = tickcounter_create();
+    if (tick_counter == NULL)
+    {
+        LogError("tickcounter_create failed");
+        result = 1;
+    }
+    else
+    {
+        unsigned char payload[PAYLOAD_SIZE] = { 0 };
+        MAP_HANDLE properties = Map_Create(NULL);
+        MESSAGE_CONFIG config = { sizeof(payload), payload, properties };
+        MESSAGE_HANDLE message = (properties == NULL) ? NULL : Message_Create(&config);
+        if (message == NULL)
+        {
+            LogError("unable to create the test message");
+            result = 1;
+        }
+        else
+        {
+            size_t i;
+            int churn;
+            result = 0;
+            for (churn = 0; churn <= 1; churn++)
+            {
+                for (i = 0; i < sizeof(publisher_counts) / sizeof(publisher_counts[0]); i++)
+                {
+                    if (run_test(tick_counter, message, publisher_counts[i], churn) != 0)
+                    {
+                        result = 1;
+                    }
+                }
+            }
+            if ((run_many_modules_test(tick_counter, message, false) != 0) ||
+                (run_many_modules_test(tick_counter, message, true) != 0))
+            {
+                result = 1;
+            }
+            Message_Destroy(message);
+        }
+        Map_Destroy(properties);
+        tickcounter_destroy(tick_counter);
+    }
+
+    return result;
+}
@@ -5,15 +5,17 @@
 #include <crtdbg.h>
 #endif
 #include <cstdlib>
+#include <climits>
 #include <signal.h>
+#include <deque>
 
 #include "testrunnerswitcher.h"
 #include "micromock.h"
 #include "micromockcharstararenullterminatedstrings.h"
 #include "azure_c_shared_utility/condition.h"
-#include "azure_c_shared_utility/vector.h"
 #include "azure_c_shared_utility/list.h"
 #include "message.h"
+#include "message_queue.h"
 #include "azure_c_shared_utility/threadapi.h"
 #include "azure_c_shared_utility/refcount.h"
 
@@ -40,7 +42,6 @@ namespace BASEIMPLEMENTATION
 #undef Unlock
 #undef Lock_Init
 #undef Lock_Deinit
-#include "vector.c"
 };
 
 #include "message_bus.h"
@@ -51,14 +52,11 @@ DEFINE_MICROMOCK_ENUM_TO_STRING(MESSAGE_BUS_RESULT, MESSAGE_BUS_RESULT_VALUES);
 static size_t currentmalloc_call;
 static size_t whenShallmalloc_fail;
 
-static size_t currentVECTOR_create_call;
-static size_t whenShallVECTOR_create_fail;
+static size_t currentMessageQueue_Create_call;
+static size_t whenShallMessageQueue_Create_fail;
 
-static size_t currentVECTOR_push_back_call;
-static size_t whenShallVECTOR_push_back_fail;
-
-static size_t currentVECTOR_find_if_call;
-static size_t whenShallVECTOR_find_if_fail;
+static size_t currentMessageQueue_Push_call;
+static size_t whenShallMessageQueue_Push_fail;
 
 static size_t currentlist_find_call;
 static size_t whenShalllist_find_fail;
@@ -189,6 +187,9 @@ public:
         BASEIMPLEMENTATION::gballoc_free(ptr);
     MOCK_VOID_METHOD_END()
 
+    MOCK_STATIC_METHOD_0(, void, MessagePool_ReleaseThreadCache)
+    MOCK_VOID_METHOD_END()
+
     MOCK_STATIC_METHOD_0(, LOCK_HANDLE, Lock_Init)
         LOCK_HANDLE result2;
         ++currentLock_Init_call;
@@ -268,72 +269,67 @@ public:
         free(handle);
     MOCK_VOID_METHOD_END()
 
-    MOCK_STATIC_METHOD_1(, VECTOR_HANDLE, VECTOR_create, size_t, elementSize)
-        VECTOR_HANDLE result2;
-        ++currentVECTOR_create_call;
-        if ((whenShallVECTOR_create_fail > 0) &&
-            (currentVECTOR_create_call == whenShallVECTOR_create_fail))
+    MOCK_STATIC_METHOD_2(, MESSAGE_QUEUE_HANDLE, MessageQueue_Create, size_t, initial_capacity, size_t, max_capacity)
+        MESSAGE_QUEUE_HANDLE result2;
+        ++currentMessageQueue_Create_call;
+        if ((whenShallMessageQueue_Create_fail > 0) &&
+            (currentMessageQueue_Create_call == whenShallMessageQueue_Create_fail))
         {
             result2 = NULL;
         }
         else
         {
-            result2 = BASEIMPLEMENTATION::VECTOR_create(elementSize);
+            result2 = (MESSAGE_QUEUE_HANDLE)new std::deque<MESSAGE_HANDLE>();
         }
-    MOCK_METHOD_END(VECTOR_HANDLE, result2)
+    MOCK_METHOD_END(MESSAGE_QUEUE_HANDLE, result2)
 
-    MOCK_STATIC_METHOD_1(, void, VECTOR_destroy, VECTOR_HANDLE, vector)
-        BASEIMPLEMENTATION::VECTOR_destroy(vector);
+    MOCK_STATIC_METHOD_1(, void, MessageQueue_Destroy, MESSAGE_QUEUE_HANDLE, handle)
+        delete (std::deque<MESSAGE_HANDLE>*)handle;
     MOCK_VOID_METHOD_END()
 
-    MOCK_STATIC_METHOD_3(, int, VECTOR_push_back, VECTOR_HANDLE, vector, const void*, elements, size_t, numElements)
-        int result2;
-        ++currentVECTOR_push_back_call;
-        if ((whenShallVECTOR_push_back_fail > 0) &&
-            (currentVECTOR_push_back_call == whenShallVECTOR_push_back_fail))
+    MOCK_STATIC_METHOD_2(, MESSAGE_QUEUE_RESULT, MessageQueue_Push, MESSAGE_QUEUE_HANDLE, handle, MESSAGE_HANDLE, message)
+        MESSAGE_QUEUE_RESULT result2;
+        ++currentMessageQueue_Push_call;
+        if ((whenShallMessageQueue_Push_fail > 0) &&
+            (currentMessageQueue_Push_call == whenShallMessageQueue_Push_fail))
         {
-            result2 = __LINE__;
+            result2 = MESSAGE_QUEUE_ERROR;
         }
         else
         {
-            result2 = BASEIMPLEMENTATION::VECTOR_push_back(vector, elements, numElements);
+            ((std::deque<MESSAGE_HANDLE>*)handle)->push_back(message);
+            result2 = MESSAGE_QUEUE_OK;
         }
-    MOCK_METHOD_END(int, result2)
+    MOCK_METHOD_END(MESSAGE_QUEUE_RESULT, result2)
 
-    MOCK_STATIC_METHOD_3(, void, VECTOR_erase, VECTOR_HANDLE, vector, void*, elements, size_t, numElements)
-        BASEIMPLEMENTATION::VECTOR_erase(vector, elements, numElements);
-    MOCK_VOID_METHOD_END()
-
-    MOCK_STATIC_METHOD_2(, void*, VECTOR_element, VECTOR_HANDLE, vector, size_t, index)
-        void* result2 = BASEIMPLEMENTATION::VECTOR_element(vector, index);
-    MOCK_METHOD_END(void*, result2)
-
-    MOCK_STATIC_METHOD_1(, void*, VECTOR_front, VECTOR_HANDLE, vector)
-        void* result2 = BASEIMPLEMENTATION::VECTOR_front(vector);
-    MOCK_METHOD_END(void*, result2)
-
-    MOCK_STATIC_METHOD_1(, void*, VECTOR_back, const VECTOR_HANDLE, vector)
-        void* result2 = BASEIMPLEMENTATION::VECTOR_back(vector);
-    MOCK_METHOD_END(void*, result2)
-
-    MOCK_STATIC_METHOD_3(, void*, VECTOR_find_if, VECTOR_HANDLE, vector, PREDICATE_FUNCTION, pred, const void*, value)
-        void* result2;
-        ++currentVECTOR_find_if_call;
-        if ((whenShallVECTOR_find_if_fail > 0) &&
-            (currentVECTOR_find_if_call == whenShallVECTOR_find_if_fail))
+    MOCK_STATIC_METHOD_1(, MESSAGE_HANDLE, MessageQueue_Pop, MESSAGE_QUEUE_HANDLE, handle)
+        std::deque<MESSAGE_HANDLE>* queue = (std::deque<MESSAGE_HANDLE>*)handle;
+        MESSAGE_HANDLE result2 = NULL;
+        if (!queue->empty())
         {
-            result2 = NULL;
+            result2 = queue->front();
+            queue->pop_front();
         }
-        else
+    MOCK_METHOD_END(MESSAGE_HANDLE, result2)
+
+    MOCK_STATIC_METHOD_3(, size_t, MessageQueue_PopBatch, MESSAGE_QUEUE_HANDLE, handle, MESSAGE_HANDLE*, messages, size_t, max_count)
+        std::deque<MESSAGE_HANDLE>* queue = (std::deque<MESSAGE_HANDLE>*)handle;
+        size_t result2 = 0;
+        while ((result2 < max_count) && !queue->empty())
         {
-            result2 = BASEIMPLEMENTATION::VECTOR_find_if(vector, pred, value);
+            messages[result2++] = queue->front();
+            queue->pop_front();
         }
-    MOCK_METHOD_END(void*, result2)
+    MOCK_METHOD_END(size_t, result2)
 
-    MOCK_STATIC_METHOD_1(, size_t, VECTOR_size, VECTOR_HANDLE, vector)
-        size_t result2 = BASEIMPLEMENTATION::VECTOR_size(vector);
+    MOCK_STATIC_METHOD_1(, size_t, MessageQueue_Size, MESSAGE_QUEUE_HANDLE, handle)
+        size_t result2 = ((std::deque<MESSAGE_HANDLE>*)handle)->size();
     MOCK_METHOD_END(size_t, result2)
 
+    MOCK_STATIC_METHOD_1(, bool, MessageQueue_IsEmpty, MESSAGE_QUEUE_HANDLE, handle)
+        bool result2 = ((std::deque<MESSAGE_HANDLE>*)handle)->empty();
+    MOCK_METHOD_END(bool, result2)
+
     MOCK_STATIC_METHOD_3(, THREADAPI_RESULT, ThreadAPI_Create, THREAD_HANDLE*, threadHandle, THREAD_START_FUNC, func, void*, arg)
         THREADAPI_RESULT result2;
         ++currentThreadAPI_Create_call;
@@ -375,6 +371,9 @@ public:
         ((RefCountObject*)message)->dec_ref();
     MOCK_VOID_METHOD_END()
 
+    MOCK_STATIC_METHOD_2(, const char*, Message_GetProperty, MESSAGE_HANDLE, message, const char*, name)
+    MOCK_METHOD_END(const char*, (const char*)NULL)
+
     // list.h
 
     MOCK_STATIC_METHOD_0(, LIST_HANDLE, list_create)
@@ -504,20 +503,20 @@ public:
 DECLARE_GLOBAL_MOCK_METHOD_1(CMessageBusMocks, , void*, gballoc_malloc, size_t, size);
 DECLARE_GLOBAL_MOCK_METHOD_1(CMessageBusMocks, , void, gballoc_free, void*, ptr);
 
+DECLARE_GLOBAL_MOCK_METHOD_0(CMessageBusMocks, , void, MessagePool_ReleaseThreadCache);
+
 DECLARE_GLOBAL_MOCK_METHOD_0(CMessageBusMocks, , LOCK_HANDLE, Lock_Init);
 DECLARE_GLOBAL_MOCK_METHOD_1(CMessageBusMocks, , LOCK_RESULT, Lock, LOCK_HANDLE, lock);
 DECLARE_GLOBAL_MOCK_METHOD_1(CMessageBusMocks, , LOCK_RESULT, Unlock, LOCK_HANDLE, lock);
 DECLARE_GLOBAL_MOCK_METHOD_1(CMessageBusMocks, , LOCK_RESULT, Lock_Deinit, LOCK_HANDLE, lock);
 
-DECLARE_GLOBAL_MOCK_METHOD_1(CMessageBusMocks, , VECTOR_HANDLE, VECTOR_create, size_t, elementSize);
-DECLARE_GLOBAL_MOCK_METHOD_1(CMessageBusMocks, , void, VECTOR_destroy, VECTOR_HANDLE, vector);
-DECLARE_GLOBAL_MOCK_METHOD_3(CMessageBusMocks, , int, VECTOR_push_back, VECTOR_HANDLE, vector, const void*, elements, size_t, numElements);
-DECLARE_GLOBAL_MOCK_METHOD_3(CMessageBusMocks, , void, VECTOR_erase, VECTOR_HANDLE, vector, void*, elements, size_t, numElements);
-DECLARE_GLOBAL_MOCK_METHOD_2(CMessageBusMocks, , void*, VECTOR_element, VECTOR_HANDLE, vector, size_t, index);
-DECLARE_GLOBAL_MOCK_METHOD_1(CMessageBusMocks, , void*, VECTOR_front, VECTOR_HANDLE, vector);
-DECLARE_GLOBAL_MOCK_METHOD_1(CMessageBusMocks, , void*, VECTOR_back, VECTOR_HANDLE, vector);
-DECLARE_GLOBAL_MOCK_METHOD_3(CMessageBusMocks, , void*, VECTOR_find_if, VECTOR_HANDLE, vector, PREDICATE_FUNCTION, pred, const void*, value);
-DECLARE_GLOBAL_MOCK_METHOD_1(CMessageBusMocks, , size_t, VECTOR_size, VECTOR_HANDLE, vector);
+DECLARE_GLOBAL_MOCK_METHOD_2(CMessageBusMocks, , MESSAGE_QUEUE_HANDLE, MessageQueue_Create, size_t, initial_capacity, size_t, max_capacity);
+DECLARE_GLOBAL_MOCK_METHOD_1(CMessageBusMocks, , void, MessageQueue_Destroy, MESSAGE_QUEUE_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_2(CMessageBusMocks, , MESSAGE_QUEUE_RESULT, MessageQueue_Push, MESSAGE_QUEUE_HANDLE, handle, MESSAGE_HANDLE, message);
+DECLARE_GLOBAL_MOCK_METHOD_1(CMessageBusMocks, , MESSAGE_HANDLE, MessageQueue_Pop, MESSAGE_QUEUE_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_3(CMessageBusMocks, , size_t, MessageQueue_PopBatch, MESSAGE_QUEUE_HANDLE, handle, MESSAGE_HANDLE*, messages, size_t, max_count);
+DECLARE_GLOBAL_MOCK_METHOD_1(CMessageBusMocks, , size_t, MessageQueue_Size, MESSAGE_QUEUE_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_1(CMessageBusMocks, , bool, MessageQueue_IsEmpty, MESSAGE_QUEUE_HANDLE, handle);
 
 DECLARE_GLOBAL_MOCK_METHOD_0(CMessageBusMocks, , COND_HANDLE, Condition_Init);
 DECLARE_GLOBAL_MOCK_METHOD_1(CMessageBusMocks, , COND_RESULT, Condition_Post, COND_HANDLE, handle);
@@ -530,6 +529,7 @@ DECLARE_GLOBAL_MOCK_METHOD_2(CMessageBusMocks, , THREADAPI_RESULT, ThreadAPI_Joi
 DECLARE_GLOBAL_MOCK_METHOD_1(CMessageBusMocks, , MESSAGE_HANDLE, Message_Create, const MESSAGE_CONFIG*, cfg);
 DECLARE_GLOBAL_MOCK_METHOD_1(CMessageBusMocks, , MESSAGE_HANDLE, Message_Clone, MESSAGE_HANDLE, message);
 DECLARE_GLOBAL_MOCK_METHOD_1(CMessageBusMocks, , void, Message_Destroy, MESSAGE_HANDLE, message);
+DECLARE_GLOBAL_MOCK_METHOD_2(CMessageBusMocks, , const char*, Message_GetProperty, MESSAGE_HANDLE, message, const char*, name);
 
 // list.h
 DECLARE_GLOBAL_MOCK_METHOD_0(CMessageBusMocks, , LIST_HANDLE, list_create);
@@ -567,14 +567,11 @@ TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
     currentmalloc_call = 0;
     whenShallmalloc_fail = 0;
 
-    currentVECTOR_create_call = 0;
-    whenShallVECTOR_create_fail = 0;
-
-    currentVECTOR_push_back_call = 0;
-    whenShallVECTOR_push_back_fail = 0;
+    currentMessageQueue_Create_call = 0;
+    whenShallMessageQueue_Create_fail = 0;
 
-    currentVECTOR_find_if_call = 0;
-    whenShallVECTOR_find_if_fail = 0;
+    currentMessageQueue_Push_call = 0;
+    whenShallMessageQueue_Push_fail = 0;
 
     currentLock_Init_call = 0;
     whenShallLock_Init_fail = 0;
@@ -722,6 +719,87 @@ TEST_FUNCTION(MessageBus_Create_fails_when_Lock_Init_fails)
     ///cleanup
 }
 
+//Tests_SRS_MESSAGE_BUS_13_160: [Otherwise MessageBus_Create2 shall initialize MESSAGE_BUS_HANDLE_DATA::pool by calling WorkerPool_CreateWithThreadExit with config->worker_count and MessagePool_ReleaseThreadCache, so that the message blocks cached by the pool threads are not lost.]
+TEST_FUNCTION(MessageBus_Create2_with_worker_pool_starts_the_pool_threads)
+{
+    ///arrange
+    CMessageBusMocks mocks;
+    MESSAGE_BUS_CONFIG config = { true, 2 };
+
+    STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the structure*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, list_create());
+    STRICT_EXPECTED_CALL(mocks, Lock_Init());
+    STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the pool*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, Lock_Init());
+    STRICT_EXPECTED_CALL(mocks, Condition_Init());
+    STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the threads of the pool*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+    STRICT_EXPECTED_CALL(mocks, ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+
+    ///act
+    auto r = MessageBus_Create2(&config);
+
+    ///assert
+    ASSERT_IS_NOT_NULL(r);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+    MessageBus_Destroy(r);
+}
+
+//Tests_SRS_MESSAGE_BUS_13_003: [This function shall return NULL if an underlying API call to the platform causes an error.]
+TEST_FUNCTION(MessageBus_Create2_fails_when_WorkerPool_Create_fails)
+{
+    ///arrange
+    CMessageBusMocks mocks;
+    MESSAGE_BUS_CONFIG config = { true, 2 };
+
+    STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the structure*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, list_create());
+    STRICT_EXPECTED_CALL(mocks, Lock_Init());
+    whenShallmalloc_fail = 2;
+    STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the pool*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, Lock_Deinit(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, list_destroy(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    ///act
+    auto r = MessageBus_Create2(&config);
+
+    ///assert
+    ASSERT_IS_NULL(r);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+}
+
+//Tests_SRS_MESSAGE_BUS_13_186: [If config is not NULL and config->routing is not a MESSAGE_BUS_ROUTING value, MessageBus_Create2 shall return NULL.]
+TEST_FUNCTION(MessageBus_Create2_fails_with_unknown_routing)
+{
+    ///arrange
+    CMessageBusMocks mocks;
+    MESSAGE_BUS_CONFIG config = { false, 0, (MESSAGE_BUS_ROUTING)42 };
+
+    ///act
+    auto r = MessageBus_Create2(&config);
+
+    ///assert
+    ASSERT_IS_NULL(r);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+}
+
 //Tests_SRS_MESSAGE_BUS_13_038: [If bus or module or module_apis is NULL the function shall return MESSAGE_BUS_INVALIDARG.]
 TEST_FUNCTION(MessageBus_AddModule_fails_with_null_bus)
 {
@@ -794,7 +872,7 @@ TEST_FUNCTION(MessageBus_AddModule_fails_when_alloc_module_info_fails)
 	MessageBus_Destroy(bus);
 }
 
-TEST_FUNCTION(MessageBus_AddModule_fails_when_VECTOR_create_fails)
+TEST_FUNCTION(MessageBus_AddModule_fails_when_MessageQueue_Create_fails)
 {
     ///arrange
     CMessageBusMocks mocks;
@@ -807,9 +885,8 @@ TEST_FUNCTION(MessageBus_AddModule_fails_when_VECTOR_create_fails)
     STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
-    whenShallVECTOR_create_fail = currentVECTOR_create_call + 1;
-    STRICT_EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG))
-        .IgnoreArgument(1);
+    whenShallMessageQueue_Create_fail = currentMessageQueue_Create_call + 1;
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Create(0, 0));
 
     ///act
     auto result = MessageBus_AddModule(bus, fake_module, &fake_module_apis);
@@ -835,9 +912,11 @@ TEST_FUNCTION(MessageBus_AddModule_fails_when_Lock_Init_fails)
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Create(0, 0));
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Create(0, 0));
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Destroy(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Destroy(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     whenShallLock_Init_fail = currentLock_Init_call + 1;
     STRICT_EXPECTED_CALL(mocks, Lock_Init());
@@ -866,9 +945,11 @@ TEST_FUNCTION(MessageBus_AddModule_fails_when_Condition_Init_fails)
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Create(0, 0));
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Create(0, 0));
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Destroy(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Destroy(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, Lock_Init());
     STRICT_EXPECTED_CALL(mocks, Lock_Deinit(IGNORED_PTR_ARG))
@@ -900,9 +981,11 @@ TEST_FUNCTION(MessageBus_AddModule_fails_when_list_add_fails)
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Create(0, 0));
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Create(0, 0));
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Destroy(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Destroy(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, Lock_Init());
     STRICT_EXPECTED_CALL(mocks, Lock_Deinit(IGNORED_PTR_ARG))
@@ -942,9 +1025,11 @@ TEST_FUNCTION(MessageBus_AddModule_fails_when_ThreadAPI_Create_fails)
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Create(0, 0));
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Create(0, 0));
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Destroy(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Destroy(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, Lock_Init());
     STRICT_EXPECTED_CALL(mocks, Lock_Deinit(IGNORED_PTR_ARG))
@@ -988,9 +1073,11 @@ TEST_FUNCTION(MessageBus_AddModule_fails_when_lock_on_modules_lock_fails)
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Create(0, 0));
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Create(0, 0));
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Destroy(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Destroy(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, Lock_Init());
     whenShallLock_fail = 1;
@@ -1036,8 +1123,8 @@ TEST_FUNCTION(MessageBus_AddModule_succeeds)
     // this is for the MessageBus_AddModule call
 	STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the module_info*/
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG))
-        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Create(0, 0));
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Create(0, 0));
     STRICT_EXPECTED_CALL(mocks, list_add(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, Lock_Init());
@@ -1100,12 +1187,13 @@ static COND_RESULT module_publish_worker_calls_module_receive_Condition_Wait(voi
 // Tests_SRS_MESSAGE_BUS_13_068: [ This function shall run a loop that keeps running while module_info->quit_worker is equal to 0. ]
 // Tests_SRS_MESSAGE_BUS_13_071: [ For every iteration of the loop the function will first wait on module_info->mq_cond using module_info->mq_lock as the corresponding mutex to be used by the condition variable. ]
 // Tests_SRS_MESSAGE_BUS_13_090: [ When module_info->mq_cond has been signaled this function shall kick off another loop predicated on module_info->quit_worker being equal to 0 and module_info->mq not being empty. This thread has the lock on module_info->mq_lock at this point. ]
-// Tests_SRS_MESSAGE_BUS_13_069: [ The function shall dequeue a message from the module's message queue. ]
+// Tests_SRS_MESSAGE_BUS_13_069: [ The function shall dequeue all the messages of the module's message queue, up to MESSAGE_BUS_RECEIVE_BATCH_SIZE of them, by calling MessageQueue_PopBatch once. ]
 // Tests_SRS_MESSAGE_BUS_13_091: [ The function shall unlock module_info->mq_lock. ]
-// Tests_SRS_MESSAGE_BUS_13_092: [ The function shall deliver the message to the module's callback function via module_info->module_apis. ]
-// Tests_SRS_MESSAGE_BUS_13_093: [ The function shall destroy the message that was dequeued by calling Message_Destroy. ]
+// Tests_SRS_MESSAGE_BUS_13_092: [ Otherwise the function shall deliver the messages one at a time, in order, to the module's callback function via module_info->module_apis. ]
+// Tests_SRS_MESSAGE_BUS_13_093: [ The function shall destroy the messages that were dequeued by calling Message_Destroy. ]
 // Tests_SRS_MESSAGE_BUS_13_094: [ The function shall re-acquire the lock on module_info->mq_lock. ]
 // Tests_SRS_MESSAGE_BUS_13_095: [ When the function exits the outer loop predicated on module_info->quit_worker being 0 it shall unlock module_info->mq_lock before exiting from the function. ]
+// Tests_SRS_MESSAGE_BUS_13_193: [ Before it exits, the function shall call MessagePool_ReleaseThreadCache so that the message blocks cached by the thread are not lost. ]
 // Tests_SRS_MESSAGE_BUS_13_026: [ This function shall assign user_data to a local variable called module_info of type MESSAGE_BUS_MODULEINFO*. ]
 // Tests_SRS_MESSAGE_BUS_04_001: [** This function shall immediately start processing messages when `module->mq` is not empty without waiting on `module->mq_cond`.]
 TEST_FUNCTION(module_publish_worker_calls_module_receive)
@@ -1200,9 +1288,8 @@ TEST_FUNCTION(module_publish_worker_calls_module_receive)
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, list_item_get_value(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-        .IgnoreArgument(1)
-        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Push(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, Message_Clone(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, Condition_Post(IGNORED_PTR_ARG))
@@ -1211,8 +1298,8 @@ TEST_FUNCTION(module_publish_worker_calls_module_receive)
     // this is for the MessageBus_AddModule call
 	STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the module_info*/
 		.IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG))
-        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Create(0, 0));
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Create(0, 0));
     STRICT_EXPECTED_CALL(mocks, list_add(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, Lock_Init());
@@ -1233,25 +1320,23 @@ TEST_FUNCTION(module_publish_worker_calls_module_receive)
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_IsEmpty(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, Condition_Wait(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
         .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, Condition_Wait(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
         .IgnoreAllArguments();
-    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_IsEmpty(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_front(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_IsEmpty(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_erase(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-        .IgnoreArgument(1)
-        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_PopBatch(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+        .IgnoreAllArguments();
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_PopBatch(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+        .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, Message_Destroy(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, MessagePool_ReleaseThreadCache());
 
 
     ///act
@@ -1288,8 +1373,8 @@ TEST_FUNCTION(module_publish_worker_fails_when_first_lock_fails)
     // this is for the MessageBus_AddModule call
     STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the module_info*/
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG))
-        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Create(0, 0));
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Create(0, 0));
     STRICT_EXPECTED_CALL(mocks, list_add(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, Lock_Init());
@@ -1305,6 +1390,7 @@ TEST_FUNCTION(module_publish_worker_fails_when_first_lock_fails)
     STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
         .IgnoreArgument(1)
         .SetFailReturn(LOCK_ERROR);
+    STRICT_EXPECTED_CALL(mocks, MessagePool_ReleaseThreadCache());
 
     ///act
     auto result = MessageBus_AddModule(bus, fake_module, &fake_module_apis);
@@ -1358,22 +1444,21 @@ TEST_FUNCTION(module_publish_worker_clean_message_queue_before_waiting_for_condi
     //Calls for the first message before calling Condition_Wait
     STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_IsEmpty(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_front(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_IsEmpty(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_erase(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-        .IgnoreArgument(1)
-        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_PopBatch(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+        .IgnoreAllArguments();
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_PopBatch(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+        .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, Message_Destroy(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_IsEmpty(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
@@ -1396,9 +1481,8 @@ TEST_FUNCTION(module_publish_worker_clean_message_queue_before_waiting_for_condi
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, list_item_get_value(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-        .IgnoreArgument(1)
-        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Push(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, Message_Clone(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, Condition_Post(IGNORED_PTR_ARG))
@@ -1409,25 +1493,23 @@ TEST_FUNCTION(module_publish_worker_clean_message_queue_before_waiting_for_condi
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_IsEmpty(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, Condition_Wait(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
         .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, Condition_Wait(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
         .IgnoreAllArguments();
-    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_IsEmpty(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_IsEmpty(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_front(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_erase(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-        .IgnoreArgument(1)
-        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_PopBatch(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+        .IgnoreAllArguments();
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_PopBatch(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+        .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, Message_Destroy(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, MessagePool_ReleaseThreadCache());
 
     ///act
     thread_func_to_call(thread_func_args);
@@ -1559,9 +1641,13 @@ TEST_FUNCTION(MessageBus_RemoveModule_fails_when_lock_mq_lock_fails)
             .SetFailReturn(LOCK_ERROR);
         STRICT_EXPECTED_CALL(mocks, ThreadAPI_Join(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, MessageQueue_Pop(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, MessageQueue_Pop(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, MessageQueue_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, MessageQueue_Destroy(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, Condition_Deinit(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
@@ -1625,9 +1711,13 @@ TEST_FUNCTION(MessageBus_RemoveModule_succeeds)
     STRICT_EXPECTED_CALL(mocks, ThreadAPI_Join(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(1)
         .IgnoreArgument(2);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Pop(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Pop(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Destroy(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Destroy(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, Condition_Deinit(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
@@ -1686,12 +1776,16 @@ TEST_FUNCTION(MessageBus_RemoveModule_with_msg_succeeds)
     STRICT_EXPECTED_CALL(mocks, ThreadAPI_Join(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(1)
         .IgnoreArgument(2);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Pop(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, Message_Destroy(message));
-    STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Pop(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Pop(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Destroy(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Destroy(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, Condition_Deinit(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
@@ -1885,8 +1979,8 @@ TEST_FUNCTION(MessageBus_Publish_fails_with_null_message)
     ///cleanup
 }
 
-//Tests_SRS_MESSAGE_BUS_13_037: [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]
-TEST_FUNCTION(MessageBus_Publish_fails_when_lock_on_modules_lock_fails)
+//Tests_SRS_MESSAGE_BUS_13_031: [MessageBus_Publish shall read MESSAGE_BUS_HANDLE_DATA::snapshot without acquiring MESSAGE_BUS_HANDLE_DATA::modules_lock and shall keep it from being freed until the loop ends.]
+TEST_FUNCTION(MessageBus_Publish_does_not_lock_modules_lock)
 {
     ///arrange
     CMessageBusMocks mocks;
@@ -1900,16 +1994,14 @@ TEST_FUNCTION(MessageBus_Publish_fails_when_lock_on_modules_lock_fails)
 
     mocks.ResetAllCalls();
 
-    // this is for MessageBus_Publish
+    // a failing lock would make the publish fail if it were taken
     whenShallLock_fail = 1;
-    STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
 
     ///act
     auto result = MessageBus_Publish(bus, NULL, message);
 
     ///assert
-    ASSERT_ARE_EQUAL(MESSAGE_BUS_RESULT, result, MESSAGE_BUS_ERROR);
+    ASSERT_ARE_EQUAL(MESSAGE_BUS_RESULT, result, MESSAGE_BUS_OK);
     mocks.AssertActualAndExpectedCalls();
 
     ///cleanup
@@ -1994,10 +2086,9 @@ TEST_FUNCTION(MessageBus_Publish_fails_when_vector_push_back_fails)
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, list_item_get_value(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    whenShallVECTOR_push_back_fail = currentVECTOR_push_back_call + 1;
-    STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-        .IgnoreArgument(1)
-        .IgnoreArgument(2);
+    whenShallMessageQueue_Push_fail = currentMessageQueue_Push_call + 1;
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Push(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, Message_Clone(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, Message_Destroy(IGNORED_PTR_ARG))
@@ -2048,9 +2139,8 @@ TEST_FUNCTION(MessageBus_Publish_fails_when_vector_condition_post_fails)
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, list_item_get_value(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-        .IgnoreArgument(1)
-        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Push(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, Message_Clone(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     whenShallCond_Post_fail = 1;
@@ -2070,13 +2160,13 @@ TEST_FUNCTION(MessageBus_Publish_fails_when_vector_condition_post_fails)
     MessageBus_Destroy(bus);
 }
 
-//Tests_SRS_MESSAGE_BUS_13_031: [MessageBus_Publish shall acquire the lock MESSAGE_BUS_HANDLE_DATA::modules_lock.]
-//Tests_SRS_MESSAGE_BUS_13_032: [ MessageBus_Publish shall start a processing loop for every module in MESSAGE_BUS_HANDLE_DATA::modules. ]
+//Tests_SRS_MESSAGE_BUS_13_031: [MessageBus_Publish shall read MESSAGE_BUS_HANDLE_DATA::snapshot without acquiring MESSAGE_BUS_HANDLE_DATA::modules_lock and shall keep it from being freed until the loop ends.]
+//Tests_SRS_MESSAGE_BUS_13_032: [MessageBus_Publish shall start a processing loop for every module in the snapshot.]
 //Tests_SRS_MESSAGE_BUS_13_033 : [In the loop, the function shall first acquire the lock on MESSAGE_BUS_MODULEINFO::mq_lock.]
-//Tests_SRS_MESSAGE_BUS_13_034 : [The function shall then append message to MESSAGE_BUS_MODULEINFO::mq by calling Message_Clone and VECTOR_push_back.]
+//Tests_SRS_MESSAGE_BUS_13_034 : [The function shall then append message to MESSAGE_BUS_MODULEINFO::mq by calling Message_Clone and MessageQueue_Push.]
 //Tests_SRS_MESSAGE_BUS_13_035 : [The function shall then release MESSAGE_BUS_MODULEINFO::mq_lock.]
 //Tests_SRS_MESSAGE_BUS_13_096 : [The function shall then signal MESSAGE_BUS_MODULEINFO::mq_cond.]
-//Tests_SRS_MESSAGE_BUS_13_040 : [MessageBus_Publish shall release the lock MESSAGE_BUS_HANDLE_DATA::modules_lock after the loop.]
+//Tests_SRS_MESSAGE_BUS_13_040: [MessageBus_Publish shall release the snapshot after the loop.]
 //Tests_SRS_MESSAGE_BUS_13_037 : [This function shall return MESSAGE_BUS_ERROR if an underlying API call to the platform causes an error or MESSAGE_BUS_OK otherwise.]
 TEST_FUNCTION(MessageBus_Publish_succeeds)
 {
@@ -2094,24 +2184,64 @@ TEST_FUNCTION(MessageBus_Publish_succeeds)
 
     mocks.ResetAllCalls();
 
-    // this is for MessageBus_Publish
+    // this is for MessageBus_Publish, which reads the snapshot instead of locking modules_lock
     STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, Message_GetProperty(message, MESSAGE_BUS_PRIORITY_PROPERTY));
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Push(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Size(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, Message_Clone(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, list_get_head_item(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, Condition_Post(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, list_get_next_item(IGNORED_PTR_ARG))
+
+    ///act
+    result = MessageBus_Publish(bus, NULL, message);
+
+    ///assert
+    ASSERT_ARE_EQUAL(MESSAGE_BUS_RESULT, result, MESSAGE_BUS_OK);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+    Message_Destroy(message);
+    MessageBus_RemoveModule(bus, fake_module);
+    MessageBus_Destroy(bus);
+}
+
+//Tests_SRS_MESSAGE_BUS_13_168: [MessageBus_Publish shall queue the message in the high priority lane of the modules if its MESSAGE_BUS_PRIORITY_PROPERTY property is MESSAGE_BUS_PRIORITY_HIGH_VALUE, and in their normal priority lane otherwise.]
+//Tests_SRS_MESSAGE_BUS_13_173: [MessageBus_GetModuleCounters shall store the number of messages, the number of latency samples and the average and maximum queue latency of every lane in counters->lanes.]
+//Tests_SRS_MESSAGE_BUS_13_175: [MessageBus_Publish shall count every message appended to a lane of the module as enqueued and queued, and raise the queue depth high-water mark of the module if the number of queued messages exceeds it.]
+//Tests_SRS_MESSAGE_BUS_13_180: [MessageBus_GetStatistics shall copy the statistics of the module into statistics without acquiring MESSAGE_BUS_MODULEINFO::mq_lock and return MESSAGE_BUS_OK.]
+TEST_FUNCTION(MessageBus_Publish_queues_high_priority_message_in_high_priority_lane)
+{
+    ///arrange
+    CMessageBusMocks mocks;
+
+    auto bus = MessageBus_Create();
+
+    // create a message to send
+    unsigned char fake;
+    MESSAGE_CONFIG c = { 1, &fake, (MAP_HANDLE)&fake };
+    auto message = Message_Create(&c);
+
+    auto result = MessageBus_AddModule(bus, fake_module, &fake_module_apis);
+
+    mocks.ResetAllCalls();
+
+    STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, list_item_get_value(IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, Message_GetProperty(message, MESSAGE_BUS_PRIORITY_PROPERTY))
+        .SetReturn(MESSAGE_BUS_PRIORITY_HIGH_VALUE);
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Push(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+    STRICT_EXPECTED_CALL(mocks, MessageQueue_Size(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-        .IgnoreArgument(1)
-        .IgnoreArgument(2);
     STRICT_EXPECTED_CALL(mocks, Message_Clone(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, Condition_Post(IGNORED_PTR_ARG))
@@ -2124,6 +2254,22 @@ TEST_FUNCTION(MessageBus_Publish_succeeds)
     ASSERT_ARE_EQUAL(MESSAGE_BUS_RESULT, result, MESSAGE_BUS_OK);
     mocks.AssertActualAndExpectedCalls();
 
+    MESSAGE_BUS_MODULE_COUNTERS counters;
+    result = MessageBus_GetModuleCounters(bus, fake_module, &counters);
+    ASSERT_ARE_EQUAL(MESSAGE_BUS_RESULT, result, MESSAGE_BUS_OK);
+    ASSERT_ARE_EQUAL(size_t, 1, counters.queued);
+    ASSERT_ARE_EQUAL(size_t, 1, counters.lanes[MESSAGE_BUS_PRIORITY_HIGH].queued);
+    ASSERT_ARE_EQUAL(size_t, 0, counters.lanes[MESSAGE_BUS_PRIORITY_NORMAL].queued);
+    ASSERT_ARE_EQUAL(size_t, 0, counters.lanes[MESSAGE_BUS_PRIORITY_HIGH].latency_samples);
+
+    MESSAGE_BUS_MODULE_STATISTICS statistics;
+    result = MessageBus_GetStatistics(bus, fake_module, &statistics);
+    ASSERT_ARE_EQUAL(MESSAGE_BUS_RESULT, result, MESSAGE_BUS_OK);
+    ASSERT_IS_TRUE(statistics.enqueued == 1);
+    ASSERT_IS_TRUE(statistics.delivered == 0);
+    ASSERT_ARE_EQUAL(size_t, 1, statistics.queued);
+    ASSERT_ARE_EQUAL(size_t, 1, statistics.queued_high_water);
+
     ///cleanup
     Message_Destroy(message);
     MessageBus_RemoveModule(bus, fake_module);
@@ -2158,6 +2304,7 @@ TEST_FUNCTION(MessageBus_Publish_succeeds_skips_self)
 		.IgnoreArgument(1);
 	STRICT_EXPECTED_CALL(mocks, list_item_get_value(IGNORED_PTR_ARG))
 		.IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, Message_GetProperty(message, MESSAGE_BUS_PRIORITY_PROPERTY));
 
 	///act
 	result = MessageBus_Publish(bus, fake_module, message);
@@ -2172,4 +2319,290 @@ TEST_FUNCTION(MessageBus_Publish_succeeds_skips_self)
 	MessageBus_Destroy(bus);
 }
 
+//Tests_SRS_MESSAGE_BUS_13_118: [If bus, link or link->module_sink is NULL, MessageBus_AddLink shall return MESSAGE_BUS_INVALIDARG.]
+TEST_FUNCTION(MessageBus_AddLink_fails_with_null_bus)
+{
+    ///arrange
+    CMessageBusMocks mocks;
+    MESSAGE_BUS_LINK link = { NULL, (MODULE_HANDLE)0x1, NULL, NULL };
+
+    ///act
+    auto r1 = MessageBus_AddLink(NULL, &link);
+
+    ///assert
+    ASSERT_ARE_EQUAL(MESSAGE_BUS_RESULT, r1, MESSAGE_BUS_INVALIDARG);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+}
+
+//Tests_SRS_MESSAGE_BUS_13_118: [If bus, link or link->module_sink is NULL, MessageBus_AddLink shall return MESSAGE_BUS_INVALIDARG.]
+TEST_FUNCTION(MessageBus_AddLink_fails_with_null_sink)
+{
+    ///arrange
+    CMessageBusMocks mocks;
+    MESSAGE_BUS_LINK link = { (MODULE_HANDLE)0x1, NULL, NULL, NULL };
+
+    ///act
+    auto r1 = MessageBus_AddLink((MESSAGE_BUS_HANDLE)0x1, &link);
+
+    ///assert
+    ASSERT_ARE_EQUAL(MESSAGE_BUS_RESULT, r1, MESSAGE_BUS_INVALIDARG);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+}
+
+//Tests_SRS_MESSAGE_BUS_13_119: [If link->filter_value is not NULL and link->filter_property is NULL, MessageBus_AddLink shall return MESSAGE_BUS_INVALIDARG.]
+TEST_FUNCTION(MessageBus_AddLink_fails_with_value_and_no_property)
+{
+    ///arrange
+    CMessageBusMocks mocks;
+    MESSAGE_BUS_LINK link = { NULL, (MODULE_HANDLE)0x1, NULL, "value" };
+
+    ///act
+    auto r1 = MessageBus_AddLink((MESSAGE_BUS_HANDLE)0x1, &link);
+
+    ///assert
+    ASSERT_ARE_EQUAL(MESSAGE_BUS_RESULT, r1, MESSAGE_BUS_INVALIDARG);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+}
+
+//Tests_SRS_MESSAGE_BUS_13_188: [MessageBus_AddLink shall return MESSAGE_BUS_INVALIDARG if the routing of the bus is MESSAGE_BUS_ROUTING_BROADCAST.]
+TEST_FUNCTION(MessageBus_AddLink_fails_on_a_broadcast_bus)
+{
+    ///arrange
+    CMessageBusMocks mocks;
+    MESSAGE_BUS_CONFIG config = { false, 0, MESSAGE_BUS_ROUTING_BROADCAST };
+    MESSAGE_BUS_HANDLE bus = MessageBus_Create2(&config);
+    MESSAGE_BUS_LINK link = { NULL, (MODULE_HANDLE)0x1, NULL, NULL };
+    mocks.ResetAllCalls();
+
+    STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, list_find(IGNORED_PTR_ARG, IGNORED_PTR_ARG, (MODULE_HANDLE)0x1))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    ///act
+    auto r1 = MessageBus_AddLink(bus, &link);
+
+    ///assert
+    ASSERT_ARE_EQUAL(MESSAGE_BUS_RESULT, r1, MESSAGE_BUS_INVALIDARG);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+    MessageBus_Destroy(bus);
+}
+
+//Tests_SRS_MESSAGE_BUS_13_126: [If bus, link or link->module_sink is NULL, MessageBus_RemoveLink shall return MESSAGE_BUS_INVALIDARG.]
+TEST_FUNCTION(MessageBus_RemoveLink_fails_with_null_link)
+{
+    ///arrange
+    CMessageBusMocks mocks;
+
+    ///act
+    auto r1 = MessageBus_RemoveLink((MESSAGE_BUS_HANDLE)0x1, NULL);
+
+    ///assert
+    ASSERT_ARE_EQUAL(MESSAGE_BUS_RESULT, r1, MESSAGE_BUS_INVALIDARG);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+}
+
+//Tests_SRS_MESSAGE_BUS_13_038: [If `bus` or `module` or `module->module_data` is NULL the function shall return MESSAGE_BUS_INVALIDARG.]
+TEST_FUNCTION(MessageBus_AddModuleWithFilter_fails_with_null_bus)
+{
+    ///arrange
+    CMessageBusMocks mocks;
+    const char* values[] = { "bleTelemetry" };
+    MESSAGE_BUS_FILTER_CONDITION condition = { "source", values, 1 };
+    MESSAGE_BUS_FILTER filter = { &condition, 1 };
+    MODULE_C_STYLE module_c_style = { (MODULE_APIS*)0x1, (MODULE_HANDLE)0x1 };
+    MODULE module = { NATIVE_C_TYPE, &module_c_style };
+
+    ///act
+    auto r1 = MessageBus_AddModuleWithFilter(NULL, &module, &filter);
+
+    ///assert
+    ASSERT_ARE_EQUAL(MESSAGE_BUS_RESULT, r1, MESSAGE_BUS_INVALIDARG);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+}
+
+//Tests_SRS_MESSAGE_BUS_13_149: [If queue_config is not NULL and its policy is not a MESSAGE_BUS_QUEUE_POLICY value, the function shall return MESSAGE_BUS_INVALIDARG.]
+TEST_FUNCTION(MessageBus_AddModuleWithQueue_fails_with_unknown_policy)
+{
+    ///arrange
+    CMessageBusMocks mocks;
+    MESSAGE_BUS_QUEUE_CONFIG queue_config = { 10, (MESSAGE_BUS_QUEUE_POLICY)42, 0 };
+    MODULE_C_STYLE module_c_style = { (MODULE_APIS*)0x1, (MODULE_HANDLE)0x1 };
+    MODULE module = { NATIVE_C_TYPE, &module_c_style };
+
+    ///act
+    auto r1 = MessageBus_AddModuleWithQueue((MESSAGE_BUS_HANDLE)0x1, &module, NULL, &queue_config);
+
+    ///assert
+    ASSERT_ARE_EQUAL(MESSAGE_BUS_RESULT, r1, MESSAGE_BUS_INVALIDARG);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+}
+
+//Tests_SRS_MESSAGE_BUS_13_189: [If queue_config is not NULL and its timeout_ms is greater than INT_MAX, the function shall return MESSAGE_BUS_INVALIDARG.]
+TEST_FUNCTION(MessageBus_AddModuleWithQueue_fails_with_timeout_above_INT_MAX)
+{
+    ///arrange
+    CMessageBusMocks mocks;
+    MESSAGE_BUS_QUEUE_CONFIG queue_config = { 10, MESSAGE_BUS_QUEUE_BLOCK, (unsigned int)INT_MAX + 1 };
+    MODULE_C_STYLE module_c_style = { (MODULE_APIS*)0x1, (MODULE_HANDLE)0x1 };
+    MODULE module = { NATIVE_C_TYPE, &module_c_style };
+
+    ///act
+    auto r1 = MessageBus_AddModuleWithQueue((MESSAGE_BUS_HANDLE)0x1, &module, NULL, &queue_config);
+
+    ///assert
+    ASSERT_ARE_EQUAL(MESSAGE_BUS_RESULT, r1, MESSAGE_BUS_INVALIDARG);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+}
+
+static void FakeModule_ReceiveBatch(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE* messageHandles, size_t count)
+{
+    (void)moduleHandle;
+    (void)messageHandles;
+    (void)count;
+}
+
+//Tests_SRS_MESSAGE_BUS_13_038: [If `bus` or `module` or `module->module_data` is NULL the function shall return MESSAGE_BUS_INVALIDARG.]
+TEST_FUNCTION(MessageBus_AddModuleWithReceiveBatch_fails_with_null_bus)
+{
+    ///arrange
+    CMessageBusMocks mocks;
+    MODULE_C_STYLE module_c_style = { (MODULE_APIS*)0x1, (MODULE_HANDLE)0x1 };
+    MODULE module = { NATIVE_C_TYPE, &module_c_style };
+
+    ///act
+    auto r1 = MessageBus_AddModuleWithReceiveBatch(NULL, &module, NULL, NULL, FakeModule_ReceiveBatch);
+
+    ///assert
+    ASSERT_ARE_EQUAL(MESSAGE_BUS_RESULT, r1, MESSAGE_BUS_INVALIDARG);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+}
+
+//Tests_SRS_MESSAGE_BUS_13_155: [If bus, module or counters is NULL, MessageBus_GetModuleCounters shall return MESSAGE_BUS_INVALIDARG.]
+TEST_FUNCTION(MessageBus_GetModuleCounters_fails_with_null_counters)
+{
+    ///arrange
+    CMessageBusMocks mocks;
+
+    ///act
+    auto r1 = MessageBus_GetModuleCounters((MESSAGE_BUS_HANDLE)0x1, (MODULE_HANDLE)0x1, NULL);
+
+    ///assert
+    ASSERT_ARE_EQUAL(MESSAGE_BUS_RESULT, r1, MESSAGE_BUS_INVALIDARG);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+}
+
+//Tests_SRS_MESSAGE_BUS_13_178: [If bus, module or statistics is NULL, MessageBus_GetStatistics shall return MESSAGE_BUS_INVALIDARG.]
+TEST_FUNCTION(MessageBus_GetStatistics_fails_with_null_statistics)
+{
+    ///arrange
+    CMessageBusMocks mocks;
+
+    ///act
+    auto r1 = MessageBus_GetStatistics((MESSAGE_BUS_HANDLE)0x1, (MODULE_HANDLE)0x1, NULL);
+
+    ///assert
+    ASSERT_ARE_EQUAL(MESSAGE_BUS_RESULT, r1, MESSAGE_BUS_INVALIDARG);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+}
+
+//Tests_SRS_MESSAGE_BUS_13_179: [MessageBus_GetStatistics shall return MESSAGE_BUS_ERROR if module is not on the bus.]
+TEST_FUNCTION(MessageBus_GetStatistics_fails_for_unknown_module)
+{
+    ///arrange
+    CMessageBusMocks mocks;
+    auto bus = MessageBus_Create();
+    MESSAGE_BUS_MODULE_STATISTICS statistics;
+    mocks.ResetAllCalls();
+
+    STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, list_find(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+
+    ///act
+    auto result = MessageBus_GetStatistics(bus, fake_module, &statistics);
+
+    ///assert
+    ASSERT_ARE_EQUAL(MESSAGE_BUS_RESULT, result, MESSAGE_BUS_ERROR);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+    MessageBus_Destroy(bus);
+}
+
+//Tests_SRS_MESSAGE_BUS_13_048: [If bus or module is NULL the function shall return MESSAGE_BUS_INVALIDARG.]
+//Tests_SRS_MESSAGE_BUS_13_185: [If drain_result is not NULL, the function shall store in it the number of queued messages delivered to the module while draining and the number of queued messages destroyed without being delivered.]
+TEST_FUNCTION(MessageBus_RemoveModuleWithDrain_fails_with_null_bus)
+{
+    ///arrange
+    CMessageBusMocks mocks;
+    MESSAGE_BUS_DRAIN_RESULT drain_result = { 42, 42 };
+
+    ///act
+    auto result = MessageBus_RemoveModuleWithDrain(NULL, (MODULE_HANDLE)0x1, 1000, &drain_result);
+
+    ///assert
+    ASSERT_ARE_EQUAL(MESSAGE_BUS_RESULT, result, MESSAGE_BUS_INVALIDARG);
+    ASSERT_ARE_EQUAL(size_t, 0, drain_result.delivered);
+    ASSERT_ARE_EQUAL(size_t, 0, drain_result.dropped);
+    mocks.AssertActualAndExpectedCalls();
+}
+
+//Tests_SRS_MESSAGE_BUS_13_050: [MessageBus_RemoveModule shall unlock MESSAGE_BUS_HANDLE_DATA::modules_lock and return MESSAGE_BUS_ERROR if the module is not found in MESSAGE_BUS_HANDLE_DATA::modules.]
+TEST_FUNCTION(MessageBus_RemoveModuleWithDrain_fails_for_unknown_module)
+{
+    ///arrange
+    CMessageBusMocks mocks;
+    auto bus = MessageBus_Create();
+    MESSAGE_BUS_DRAIN_RESULT drain_result;
+    mocks.ResetAllCalls();
+
+    STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, list_find(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+
+    ///act
+    auto result = MessageBus_RemoveModuleWithDrain(bus, fake_module, 1000, &drain_result);
+
+    ///assert
+    ASSERT_ARE_EQUAL(MESSAGE_BUS_RESULT, result, MESSAGE_BUS_ERROR);
+    ASSERT_ARE_EQUAL(size_t, 0, drain_result.delivered);
+    ASSERT_ARE_EQUAL(size_t, 0, drain_result.dropped);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+    MessageBus_Destroy(bus);
+}
+
 END_TEST_SUITE(message_bus_unittests)
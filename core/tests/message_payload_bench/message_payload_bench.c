@@ -0,0 +1,380 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/*
+* Compares the content of a reading formatted as JSON text, the way modules
+* such as simulated_device publish it, with the same reading encoded with
+* message_payload. The reading has a device name, a timestamp, a temperature
+* and a humidity. Every case runs in a loop for both formats:
+*     encode  - format the reading as JSON / encode it, into a buffer of the
+*               benchmark
+*     decode  - parse the JSON and read the fields back / decode the payload
+*     message - what a producer and a receiver do: create a message with the
+*               reading as its content, read the content back, destroy it
+* and prints one JSON object on its own line per run:
+*     {"case":"<name>","format":"<json|payload>","content_bytes":<n>,
+*      "messages":<n>,"elapsed_ms":<n>,"msgs_per_sec":<n>,
+*      "allocations_per_message":<n>}
+* allocations_per_message is only measured on Linux, where the allocator of
+* the C runtime is wrapped at link time; elsewhere it is null.
+*
+* usage: message_payload_bench [messages_per_case]
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "azure_c_shared_utility/iot_logging.h"
+#include "azure_c_shared_utility/map.h"
+#include "azure_c_shared_utility/constbuffer.h"
+#include "parson.h"
+
+#include "message.h"
+#include "message_payload.h"
+
+#if defined(WIN32)
+#include <windows.h>
+#endif
+
+#define DEFAULT_MESSAGES_PER_CASE 1000000
+#define CONTENT_BUFFER_SIZE       256
+#define READING_FIELDS            4
+
+typedef enum BENCH_CASE_TAG
+{
+    BENCH_ENCODE,
+    BENCH_DECODE,
+    BENCH_MESSAGE
+}BENCH_CASE;
+
+typedef enum BENCH_FORMAT_TAG
+{
+    BENCH_JSON,
+    BENCH_PAYLOAD
+}BENCH_FORMAT;
+
+static const char* case_names[] = { "encode", "decode", "message" };
+static const char* format_names[] = { "json", "payload" };
+
+typedef struct READING_TAG
+{
+    const char* deviceName;
+    int64_t timestamp;
+    double temperature;
+    double humidity;
+}READING;
+
+#if defined(MESSAGE_PAYLOAD_BENCH_COUNT_ALLOCATIONS)
+/*the linker sends every call to malloc, calloc and realloc here (-Wl,--wrap)*/
+static size_t allocation_count;
+
+extern void* __real_malloc(size_t size);
+extern void* __real_calloc(size_t nmemb, size_t size);
+extern void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size)
+{
+    allocation_count++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t nmemb, size_t size)
+{
+    allocation_count++;
+    return __real_calloc(nmemb, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size)
+{
+    allocation_count++;
+    return __real_realloc(ptr, size);
+}
+#endif
+
+static uint64_t get_time_us(void)
+{
+#if defined(WIN32)
+    LARGE_INTEGER frequency, counter;
+    (void)QueryPerformanceFrequency(&frequency);
+    (void)QueryPerformanceCounter(&counter);
+    return (uint64_t)((counter.QuadPart / frequency.QuadPart) * 1000000 + ((counter.QuadPart % frequency.QuadPart) * 1000000) / frequency.QuadPart);
+#else
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+#endif
+}
+
+/*the fields of the reading, which point into it*/
+static void get_fields(const READING* reading, MESSAGE_PAYLOAD_FIELD fields[READING_FIELDS])
+{
+    fields[0].name = "deviceName";
+    fields[0].type = MESSAGE_PAYLOAD_STRING;
+    fields[0].value.string = reading->deviceName;
+    fields[1].name = "timestamp";
+    fields[1].type = MESSAGE_PAYLOAD_INTEGER;
+    fields[1].value.integer = reading->timestamp;
+    fields[2].name = "temperature";
+    fields[2].type = MESSAGE_PAYLOAD_NUMBER;
+    fields[2].value.number = reading->temperature;
+    fields[3].name = "humidity";
+    fields[3].type = MESSAGE_PAYLOAD_NUMBER;
+    fields[3].value.number = reading->humidity;
+}
+
+/*writes the reading to buffer in format, returns the number of bytes written or -1*/
+static int32_t encode_reading(BENCH_FORMAT format, const READING* reading, unsigned char* buffer, int32_t size)
+{
+    int32_t result;
+    if (format == BENCH_JSON)
+    {
+        int written = sprintf((char*)buffer, "{\"deviceName\": \"%s\", \"timestamp\": %lld, \"temperature\": %.2f, \"humidity\": %.2f}",
+            reading->deviceName,
+            (long long)reading->timestamp,
+            reading->temperature,
+            reading->humidity);
+        result = ((written < 0) || (written >= size)) ? -1 : (int32_t)written;
+    }
+    else
+    {
+        MESSAGE_PAYLOAD_FIELD fields[READING_FIELDS];
+        get_fields(reading, fields);
+        result = MessagePayload_Encode(fields, READING_FIELDS, buffer, size);
+    }
+    return result;
+}
+
+/*reads the reading back from content in format, returns 0 on success*/
+static int decode_reading(BENCH_FORMAT format, const unsigned char* content, size_t size, READING* reading)
+{
+    int result;
+    if (format == BENCH_JSON)
+    {
+        /*the content of a message is not zero terminated, parson wants it to be*/
+        char text[CONTENT_BUFFER_SIZE];
+        if (size >= sizeof(text))
+        {
+            result = __LINE__;
+        }
+        else
+        {
+            JSON_Value* json;
+            (void)memcpy(text, content, size);
+            text[size] = '\0';
+            json = json_parse_string(text);
+            if (json == NULL)
+            {
+                result = __LINE__;
+            }
+            else
+            {
+                JSON_Object* root = json_value_get_object(json);
+                if (root == NULL)
+                {
+                    result = __LINE__;
+                }
+                else
+                {
+                    /*the name goes away with the JSON value, so it is only checked*/
+                    const char* deviceName = json_object_get_string(root, "deviceName");
+                    reading->deviceName = NULL;
+                    reading->timestamp = (int64_t)json_object_get_number(root, "timestamp");
+                    reading->temperature = json_object_get_number(root, "temperature");
+                    reading->humidity = json_object_get_number(root, "humidity");
+                    result = (deviceName == NULL) ? __LINE__ : 0;
+                }
+                json_value_free(json);
+            }
+        }
+    }
+    else
+    {
+        MESSAGE_PAYLOAD_FIELD fields[READING_FIELDS];
+        size_t count = READING_FIELDS;
+        if (MessagePayload_Decode(content, size, fields, &count) != 0)
+        {
+            result = __LINE__;
+        }
+        else
+        {
+            size_t i;
+            for (i = 0; i < count; i++)
+            {
+                if (strcmp(fields[i].name, "deviceName") == 0)
+                {
+                    reading->deviceName = fields[i].value.string;
+                }
+                else if (strcmp(fields[i].name, "timestamp") == 0)
+                {
+                    reading->timestamp = fields[i].value.integer;
+                }
+                else if (strcmp(fields[i].name, "temperature") == 0)
+                {
+                    reading->temperature = fields[i].value.number;
+                }
+                else if (strcmp(fields[i].name, "humidity") == 0)
+                {
+                    reading->humidity = fields[i].value.number;
+                }
+            }
+            result = 0;
+        }
+    }
+    return result;
+}
+
+/*runs bench_case once, returns 0 on success*/
+static int run_one(BENCH_CASE bench_case, BENCH_FORMAT format, const READING* reading, MAP_HANDLE properties, unsigned char* content, int32_t content_bytes)
+{
+    int result;
+    READING decoded;
+    if (bench_case == BENCH_ENCODE)
+    {
+        result = (encode_reading(format, reading, content, CONTENT_BUFFER_SIZE) == content_bytes) ? 0 : __LINE__;
+    }
+    else if (bench_case == BENCH_DECODE)
+    {
+        result = decode_reading(format, content, (size_t)content_bytes, &decoded);
+    }
+    else
+    {
+        MESSAGE_HANDLE message;
+        if (format == BENCH_JSON)
+        {
+            /*the JSON is formatted to a buffer then copied into the message, as simulated_device does*/
+            char text[CONTENT_BUFFER_SIZE];
+            MESSAGE_CONFIG config;
+            config.size = (size_t)encode_reading(format, reading, (unsigned char*)text, sizeof(text));
+            config.source = (const unsigned char*)text;
+            config.sourceProperties = properties;
+            message = Message_Create(&config);
+        }
+        else
+        {
+            /*the fields are encoded straight into the content of the message*/
+            MESSAGE_PAYLOAD_FIELD fields[READING_FIELDS];
+            get_fields(reading, fields);
+            message = MessagePayload_CreateMessage(fields, READING_FIELDS, properties);
+        }
+
+        if (message == NULL)
+        {
+            LogError("unable to create a message");
+            result = __LINE__;
+        }
+        else
+        {
+            const CONSTBUFFER* message_content = Message_GetContent(message);
+            if (message_content == NULL)
+            {
+                LogError("unable to read the message");
+                result = __LINE__;
+            }
+            else
+            {
+                result = decode_reading(format, message_content->buffer, message_content->size, &decoded);
+            }
+            Message_Destroy(message);
+        }
+    }
+    return result;
+}
+
+static int run_case(BENCH_CASE bench_case, BENCH_FORMAT format, size_t messages)
+{
+    int result;
+    READING reading = { "SimulatedDevice01", 1475000000000, 21.53, 48.20 };
+    unsigned char content[CONTENT_BUFFER_SIZE];
+    int32_t content_bytes = encode_reading(format, &reading, content, sizeof(content));
+    MAP_HANDLE properties = Map_Create(NULL);
+    if ((content_bytes < 0) || (properties == NULL))
+    {
+        LogError("unable to prepare the case");
+        result = __LINE__;
+    }
+    else
+    {
+        size_t i;
+        uint64_t start_us;
+        uint64_t elapsed_us;
+#if defined(MESSAGE_PAYLOAD_BENCH_COUNT_ALLOCATIONS)
+        size_t allocations_before;
+#endif
+        /*warm up the allocator*/
+        result = run_one(bench_case, format, &reading, properties, content, content_bytes);
+
+#if defined(MESSAGE_PAYLOAD_BENCH_COUNT_ALLOCATIONS)
+        allocations_before = allocation_count;
+#endif
+        start_us = get_time_us();
+        for (i = 0; (i < messages) && (result == 0); i++)
+        {
+            result = run_one(bench_case, format, &reading, properties, content, content_bytes);
+        }
+        elapsed_us = get_time_us() - start_us;
+
+        if (result != 0)
+        {
+            LogError("case %s failed for %s", case_names[bench_case], format_names[format]);
+        }
+        else
+        {
+            (void)printf("{\"case\":\"%s\",\"format\":\"%s\",\"content_bytes\":%ld,\"messages\":%lu,\"elapsed_ms\":%llu,\"msgs_per_sec\":%llu,",
+                case_names[bench_case],
+                format_names[format],
+                (long)content_bytes,
+                (unsigned long)messages,
+                (unsigned long long)(elapsed_us / 1000),
+                (unsigned long long)((elapsed_us == 0) ? 0 : ((uint64_t)messages * 1000000) / elapsed_us));
+#if defined(MESSAGE_PAYLOAD_BENCH_COUNT_ALLOCATIONS)
+            (void)printf("\"allocations_per_message\":%.2f}\n", (double)(allocation_count - allocations_before) / (double)messages);
+#else
+            (void)printf("\"allocations_per_message\":null}\n");
+#endif
+        }
+    }
+
+    if (properties != NULL)
+    {
+        Map_Destroy(properties);
+    }
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    int result = 0;
+    size_t messages_per_case = DEFAULT_MESSAGES_PER_CASE;
+
+    if (argc > 1)
+    {
+        messages_per_case = (size_t)strtoul(argv[1], NULL, 10);
+    }
+
+    if (messages_per_case == 0)
+    {
+        (void)printf("usage: message_payload_bench [messages_per_case]\n");
+        result = 1;
+    }
+    else
+    {
+        int bench_case;
+        int format;
+        for (bench_case = BENCH_ENCODE; bench_case <= BENCH_MESSAGE; bench_case++)
+        {
+            for (format = BENCH_JSON; format <= BENCH_PAYLOAD; format++)
+            {
+                if (run_case((BENCH_CASE)bench_case, (BENCH_FORMAT)format, messages_per_case) != 0)
+                {
+                    result = 1;
+                }
+            }
+        }
+    }
+
+    return result;
+}
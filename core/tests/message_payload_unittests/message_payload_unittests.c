@@ -0,0 +1,714 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+#include "message_payload.h"
+
+static size_t currentmalloc_call;
+static size_t whenShallmalloc_fail;
+static size_t currentfree_call;
+
+static void* my_gballoc_malloc(size_t size)
+{
+    void* result;
+    currentmalloc_call++;
+    if ((whenShallmalloc_fail > 0) && (currentmalloc_call == whenShallmalloc_fail))
+    {
+        result = NULL;
+    }
+    else
+    {
+        result = malloc(size);
+    }
+    return result;
+}
+
+static void* my_gballoc_calloc(size_t nmemb, size_t size)
+{
+    return calloc(nmemb, size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    currentfree_call++;
+    free(ptr);
+}
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#undef ENABLE_MOCKS
+
+#ifdef _MSC_VER
+#pragma warning(disable:4505)
+#endif
+
+#define TEST_MESSAGE_HANDLE ((MESSAGE_HANDLE)0x42)
+#define TEST_MAP_HANDLE ((MAP_HANDLE)0x43)
+
+/*a fake Message_CreateAdopt that keeps the config it is called with; the tests free the adopted content*/
+static size_t currentMessage_CreateAdopt_call;
+static bool whenShallMessage_CreateAdopt_fail;
+static MESSAGE_ADOPT_CONFIG lastMessage_CreateAdopt_config;
+
+MESSAGE_HANDLE Message_CreateAdopt(const MESSAGE_ADOPT_CONFIG* cfg)
+{
+    MESSAGE_HANDLE result;
+    currentMessage_CreateAdopt_call++;
+    lastMessage_CreateAdopt_config = *cfg;
+    if (whenShallMessage_CreateAdopt_fail)
+    {
+        result = NULL;
+    }
+    else
+    {
+        result = TEST_MESSAGE_HANDLE;
+    }
+    return result;
+}
+
+/*"t" = 1, encoded: header, 1 field, name length 1, "t", 0, MESSAGE_PAYLOAD_INTEGER, zigzag(1)*/
+static const unsigned char test_encoded_integer[] = { 0x93, 'P', 1, 1, 1, 't', 0, MESSAGE_PAYLOAD_INTEGER, 2 };
+
+static void set_integer(MESSAGE_PAYLOAD_FIELD* field, const char* name, int64_t value)
+{
+    field->name = name;
+    field->type = MESSAGE_PAYLOAD_INTEGER;
+    field->value.integer = value;
+}
+
+/*one field of every type*/
+static void set_reading(MESSAGE_PAYLOAD_FIELD fields[6])
+{
+    set_integer(&fields[0], "timestamp", -1234567890123);
+    fields[1].name = "temperature";
+    fields[1].type = MESSAGE_PAYLOAD_NUMBER;
+    fields[1].value.number = 21.5;
+    fields[2].name = "alarm";
+    fields[2].type = MESSAGE_PAYLOAD_BOOLEAN;
+    fields[2].value.boolean = true;
+    fields[3].name = "deviceName";
+    fields[3].type = MESSAGE_PAYLOAD_STRING;
+    fields[3].value.string = "Sensor7";
+    fields[4].name = "raw";
+    fields[4].type = MESSAGE_PAYLOAD_BYTES;
+    fields[4].value.bytes.buffer = (const unsigned char*)"\x00\x01\x02";
+    fields[4].value.bytes.size = 3;
+    fields[5].name = "";
+    fields[5].type = MESSAGE_PAYLOAD_BYTES;
+    fields[5].value.bytes.buffer = NULL;
+    fields[5].value.bytes.size = 0;
+}
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    (void)error_code;
+    ASSERT_FAIL("umock_c reported error");
+}
+
+BEGIN_TEST_SUITE(message_payload_unittests)
+
+    TEST_SUITE_INITIALIZE(TestClassInitialize)
+    {
+        TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        umock_c_init(on_umock_c_error);
+
+        int result = umocktypes_charptr_register_types();
+        ASSERT_ARE_EQUAL(int, 0, result);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_calloc, my_gballoc_calloc);
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+    }
+
+    TEST_SUITE_CLEANUP(TestClassCleanup)
+    {
+        TEST_MUTEX_DESTROY(g_testByTest);
+        TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    }
+
+    TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest) != 0)
+        {
+            ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+        }
+
+        umock_c_reset_all_calls();
+
+        currentmalloc_call = 0;
+        whenShallmalloc_fail = 0;
+        currentfree_call = 0;
+        currentMessage_CreateAdopt_call = 0;
+        whenShallMessage_CreateAdopt_fail = false;
+        memset(&lastMessage_CreateAdopt_config, 0, sizeof(lastMessage_CreateAdopt_config));
+    }
+
+    TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+    {
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_001: [If fields is NULL and count is not 0, or any field is invalid, MessagePayload_GetEncodedSize shall return -1.]*/
+    TEST_FUNCTION(MessagePayload_GetEncodedSize_with_NULL_fields_fails)
+    {
+        ///arrange
+
+        ///act
+        int32_t result = MessagePayload_GetEncodedSize(NULL, 1);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int32_t, -1, result);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_001: [If fields is NULL and count is not 0, or any field is invalid, MessagePayload_GetEncodedSize shall return -1.]*/
+    TEST_FUNCTION(MessagePayload_GetEncodedSize_with_a_NULL_name_fails)
+    {
+        ///arrange
+        MESSAGE_PAYLOAD_FIELD fields[6];
+        set_reading(fields);
+        fields[2].name = NULL;
+
+        ///act
+        int32_t result = MessagePayload_GetEncodedSize(fields, 6);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int32_t, -1, result);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_001: [If fields is NULL and count is not 0, or any field is invalid, MessagePayload_GetEncodedSize shall return -1.]*/
+    TEST_FUNCTION(MessagePayload_GetEncodedSize_with_a_NULL_string_fails)
+    {
+        ///arrange
+        MESSAGE_PAYLOAD_FIELD fields[6];
+        set_reading(fields);
+        fields[3].value.string = NULL;
+
+        ///act
+        int32_t result = MessagePayload_GetEncodedSize(fields, 6);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int32_t, -1, result);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_001: [If fields is NULL and count is not 0, or any field is invalid, MessagePayload_GetEncodedSize shall return -1.]*/
+    TEST_FUNCTION(MessagePayload_GetEncodedSize_with_NULL_bytes_of_non_zero_size_fails)
+    {
+        ///arrange
+        MESSAGE_PAYLOAD_FIELD fields[6];
+        set_reading(fields);
+        fields[4].value.bytes.buffer = NULL;
+
+        ///act
+        int32_t result = MessagePayload_GetEncodedSize(fields, 6);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int32_t, -1, result);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_001: [If fields is NULL and count is not 0, or any field is invalid, MessagePayload_GetEncodedSize shall return -1.]*/
+    TEST_FUNCTION(MessagePayload_GetEncodedSize_with_an_unknown_type_fails)
+    {
+        ///arrange
+        MESSAGE_PAYLOAD_FIELD fields[6];
+        set_reading(fields);
+        fields[0].type = (MESSAGE_PAYLOAD_TYPE)(MESSAGE_PAYLOAD_BYTES + 1);
+
+        ///act
+        int32_t result = MessagePayload_GetEncodedSize(fields, 6);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int32_t, -1, result);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_003: [Otherwise, MessagePayload_GetEncodedSize shall return the number of bytes MessagePayload_Encode writes for the fields.]*/
+    TEST_FUNCTION(MessagePayload_GetEncodedSize_of_no_fields_is_the_size_of_the_header)
+    {
+        ///arrange
+
+        ///act
+        int32_t result = MessagePayload_GetEncodedSize(NULL, 0);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int32_t, 4, result);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_003: [Otherwise, MessagePayload_GetEncodedSize shall return the number of bytes MessagePayload_Encode writes for the fields.]*/
+    TEST_FUNCTION(MessagePayload_GetEncodedSize_returns_the_size_MessagePayload_Encode_writes)
+    {
+        ///arrange
+        MESSAGE_PAYLOAD_FIELD fields[6];
+        unsigned char buffer[128];
+        set_reading(fields);
+
+        ///act
+        int32_t result = MessagePayload_GetEncodedSize(fields, 6);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int32_t, MessagePayload_Encode(fields, 6, buffer, sizeof(buffer)), result);
+        /*header 4, timestamp 18, temperature 22, alarm 9, deviceName 22, raw 10, "" 4*/
+        ASSERT_ARE_EQUAL(int32_t, 89, result);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_004: [If buffer is NULL, MessagePayload_Encode shall return -1.]*/
+    TEST_FUNCTION(MessagePayload_Encode_with_NULL_buffer_fails)
+    {
+        ///arrange
+        MESSAGE_PAYLOAD_FIELD field;
+        set_integer(&field, "t", 1);
+
+        ///act
+        int32_t result = MessagePayload_Encode(&field, 1, NULL, 128);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int32_t, -1, result);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_005: [If fields is NULL and count is not 0, or any field is invalid, MessagePayload_Encode shall return -1.]*/
+    TEST_FUNCTION(MessagePayload_Encode_with_an_invalid_field_fails)
+    {
+        ///arrange
+        MESSAGE_PAYLOAD_FIELD fields[6];
+        unsigned char buffer[128];
+        set_reading(fields);
+        fields[5].name = NULL;
+
+        ///act
+        int32_t result = MessagePayload_Encode(fields, 6, buffer, sizeof(buffer));
+
+        ///assert
+        ASSERT_ARE_EQUAL(int32_t, -1, result);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_006: [If the encoded fields do not fit in size bytes, MessagePayload_Encode shall return -1 and write nothing.]*/
+    TEST_FUNCTION(MessagePayload_Encode_with_a_buffer_too_small_fails_and_writes_nothing)
+    {
+        ///arrange
+        MESSAGE_PAYLOAD_FIELD field;
+        unsigned char buffer[sizeof(test_encoded_integer)];
+        set_integer(&field, "t", 1);
+        memset(buffer, 0xEE, sizeof(buffer));
+
+        ///act
+        int32_t result = MessagePayload_Encode(&field, 1, buffer, sizeof(buffer) - 1);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int32_t, -1, result);
+        ASSERT_ARE_EQUAL(int, 0xEE, buffer[0]);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_007: [MessagePayload_Encode shall write the encoded fields to buffer and return the number of bytes written.]*/
+    TEST_FUNCTION(MessagePayload_Encode_writes_the_encoded_fields)
+    {
+        ///arrange
+        MESSAGE_PAYLOAD_FIELD field;
+        unsigned char buffer[sizeof(test_encoded_integer)];
+        set_integer(&field, "t", 1);
+
+        ///act
+        int32_t result = MessagePayload_Encode(&field, 1, buffer, sizeof(buffer));
+
+        ///assert
+        ASSERT_ARE_EQUAL(int32_t, sizeof(test_encoded_integer), result);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(test_encoded_integer, buffer, sizeof(test_encoded_integer)));
+        ASSERT_ARE_EQUAL(size_t, 0, currentmalloc_call);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_007: [MessagePayload_Encode shall write the encoded fields to buffer and return the number of bytes written.]*/
+    TEST_FUNCTION(MessagePayload_Encode_writes_small_negative_integers_in_one_byte)
+    {
+        ///arrange
+        MESSAGE_PAYLOAD_FIELD field;
+        unsigned char buffer[sizeof(test_encoded_integer)];
+        set_integer(&field, "t", -64);
+
+        ///act
+        int32_t result = MessagePayload_Encode(&field, 1, buffer, sizeof(buffer));
+
+        ///assert
+        ASSERT_ARE_EQUAL(int32_t, sizeof(test_encoded_integer), result);
+        ASSERT_ARE_EQUAL(int, 127, buffer[sizeof(test_encoded_integer) - 1]);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_008: [If properties is NULL, MessagePayload_CreateMessage shall return NULL.]*/
+    TEST_FUNCTION(MessagePayload_CreateMessage_with_NULL_properties_fails)
+    {
+        ///arrange
+        MESSAGE_PAYLOAD_FIELD field;
+        set_integer(&field, "t", 1);
+
+        ///act
+        MESSAGE_HANDLE result = MessagePayload_CreateMessage(&field, 1, NULL);
+
+        ///assert
+        ASSERT_IS_NULL(result);
+        ASSERT_ARE_EQUAL(size_t, 0, currentmalloc_call);
+        ASSERT_ARE_EQUAL(size_t, 0, currentMessage_CreateAdopt_call);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_009: [If fields is NULL and count is not 0, or any field is invalid, MessagePayload_CreateMessage shall return NULL.]*/
+    TEST_FUNCTION(MessagePayload_CreateMessage_with_an_invalid_field_fails)
+    {
+        ///arrange
+        MESSAGE_PAYLOAD_FIELD fields[6];
+        set_reading(fields);
+        fields[3].value.string = NULL;
+
+        ///act
+        MESSAGE_HANDLE result = MessagePayload_CreateMessage(fields, 6, TEST_MAP_HANDLE);
+
+        ///assert
+        ASSERT_IS_NULL(result);
+        ASSERT_ARE_EQUAL(size_t, 0, currentmalloc_call);
+        ASSERT_ARE_EQUAL(size_t, 0, currentMessage_CreateAdopt_call);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_013: [If any step fails, MessagePayload_CreateMessage shall free what it allocated and return NULL.]*/
+    TEST_FUNCTION(MessagePayload_CreateMessage_fails_when_malloc_fails)
+    {
+        ///arrange
+        MESSAGE_PAYLOAD_FIELD field;
+        set_integer(&field, "t", 1);
+        whenShallmalloc_fail = 1;
+
+        ///act
+        MESSAGE_HANDLE result = MessagePayload_CreateMessage(&field, 1, TEST_MAP_HANDLE);
+
+        ///assert
+        ASSERT_IS_NULL(result);
+        ASSERT_ARE_EQUAL(size_t, 0, currentMessage_CreateAdopt_call);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_010: [MessagePayload_CreateMessage shall allocate a buffer for the encoded fields.]*/
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_011: [MessagePayload_CreateMessage shall encode the fields into the buffer.]*/
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_012: [MessagePayload_CreateMessage shall create the message by calling Message_CreateAdopt with the buffer and properties, and return it.]*/
+    TEST_FUNCTION(MessagePayload_CreateMessage_happy_path)
+    {
+        ///arrange
+        MESSAGE_PAYLOAD_FIELD field;
+        set_integer(&field, "t", 1);
+
+        ///act
+        MESSAGE_HANDLE result = MessagePayload_CreateMessage(&field, 1, TEST_MAP_HANDLE);
+
+        ///assert
+        ASSERT_ARE_EQUAL(void_ptr, (void*)TEST_MESSAGE_HANDLE, (void*)result);
+        ASSERT_ARE_EQUAL(size_t, 1, currentmalloc_call);
+        ASSERT_ARE_EQUAL(size_t, 1, currentMessage_CreateAdopt_call);
+        ASSERT_ARE_EQUAL(size_t, sizeof(test_encoded_integer), lastMessage_CreateAdopt_config.size);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(test_encoded_integer, lastMessage_CreateAdopt_config.source, sizeof(test_encoded_integer)));
+        ASSERT_IS_NULL(lastMessage_CreateAdopt_config.release);
+        ASSERT_ARE_EQUAL(void_ptr, (void*)TEST_MAP_HANDLE, (void*)lastMessage_CreateAdopt_config.sourceProperties);
+        ASSERT_ARE_EQUAL(size_t, 0, currentfree_call);
+
+        ///cleanup
+        free(lastMessage_CreateAdopt_config.source);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_013: [If any step fails, MessagePayload_CreateMessage shall free what it allocated and return NULL.]*/
+    TEST_FUNCTION(MessagePayload_CreateMessage_frees_the_buffer_when_Message_CreateAdopt_fails)
+    {
+        ///arrange
+        MESSAGE_PAYLOAD_FIELD field;
+        set_integer(&field, "t", 1);
+        whenShallMessage_CreateAdopt_fail = true;
+
+        ///act
+        MESSAGE_HANDLE result = MessagePayload_CreateMessage(&field, 1, TEST_MAP_HANDLE);
+
+        ///assert
+        ASSERT_IS_NULL(result);
+        ASSERT_ARE_EQUAL(size_t, 1, currentmalloc_call);
+        ASSERT_ARE_EQUAL(size_t, 1, currentfree_call);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_014: [MessagePayload_IsEncoded shall return true if source is not NULL and starts with the header of an encoded payload, and false otherwise.]*/
+    TEST_FUNCTION(MessagePayload_IsEncoded_with_NULL_source_returns_false)
+    {
+        ///arrange
+
+        ///act
+        bool result = MessagePayload_IsEncoded(NULL, 9);
+
+        ///assert
+        ASSERT_IS_FALSE(result);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_014: [MessagePayload_IsEncoded shall return true if source is not NULL and starts with the header of an encoded payload, and false otherwise.]*/
+    TEST_FUNCTION(MessagePayload_IsEncoded_with_JSON_returns_false)
+    {
+        ///arrange
+        const char* json = "{\"temperature\": 21.50}";
+
+        ///act
+        bool result = MessagePayload_IsEncoded((const unsigned char*)json, strlen(json));
+
+        ///assert
+        ASSERT_IS_FALSE(result);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_014: [MessagePayload_IsEncoded shall return true if source is not NULL and starts with the header of an encoded payload, and false otherwise.]*/
+    TEST_FUNCTION(MessagePayload_IsEncoded_with_an_encoded_payload_returns_true)
+    {
+        ///arrange
+
+        ///act
+        bool result = MessagePayload_IsEncoded(test_encoded_integer, sizeof(test_encoded_integer));
+
+        ///assert
+        ASSERT_IS_TRUE(result);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_015: [If source or count is NULL, or fields is NULL and *count is not 0, MessagePayload_Decode shall fail and return a non-zero value.]*/
+    TEST_FUNCTION(MessagePayload_Decode_with_NULL_source_fails)
+    {
+        ///arrange
+        MESSAGE_PAYLOAD_FIELD field;
+        size_t count = 1;
+
+        ///act
+        int result = MessagePayload_Decode(NULL, sizeof(test_encoded_integer), &field, &count);
+
+        ///assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(size_t, 1, count);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_015: [If source or count is NULL, or fields is NULL and *count is not 0, MessagePayload_Decode shall fail and return a non-zero value.]*/
+    TEST_FUNCTION(MessagePayload_Decode_with_NULL_count_fails)
+    {
+        ///arrange
+        MESSAGE_PAYLOAD_FIELD field;
+
+        ///act
+        int result = MessagePayload_Decode(test_encoded_integer, sizeof(test_encoded_integer), &field, NULL);
+
+        ///assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_015: [If source or count is NULL, or fields is NULL and *count is not 0, MessagePayload_Decode shall fail and return a non-zero value.]*/
+    TEST_FUNCTION(MessagePayload_Decode_with_NULL_fields_fails)
+    {
+        ///arrange
+        size_t count = 1;
+
+        ///act
+        int result = MessagePayload_Decode(test_encoded_integer, sizeof(test_encoded_integer), NULL, &count);
+
+        ///assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_016: [If source does not start with a valid header, MessagePayload_Decode shall fail and return a non-zero value.]*/
+    TEST_FUNCTION(MessagePayload_Decode_of_JSON_fails)
+    {
+        ///arrange
+        const char* json = "{\"temperature\": 21.50}";
+        MESSAGE_PAYLOAD_FIELD field;
+        size_t count = 1;
+
+        ///act
+        int result = MessagePayload_Decode((const unsigned char*)json, strlen(json), &field, &count);
+
+        ///assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(size_t, 1, count);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_016: [If source does not start with a valid header, MessagePayload_Decode shall fail and return a non-zero value.]*/
+    TEST_FUNCTION(MessagePayload_Decode_of_more_fields_than_the_payload_can_hold_fails)
+    {
+        ///arrange
+        unsigned char source[sizeof(test_encoded_integer)];
+        MESSAGE_PAYLOAD_FIELD field;
+        size_t count = 1;
+        memcpy(source, test_encoded_integer, sizeof(source));
+        source[3] = 2;
+
+        ///act
+        int result = MessagePayload_Decode(source, sizeof(source), &field, &count);
+
+        ///assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(size_t, 1, count);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_017: [If the payload has more fields than *count, MessagePayload_Decode shall set *count to the number of fields and fail and return a non-zero value.]*/
+    TEST_FUNCTION(MessagePayload_Decode_with_no_room_returns_the_number_of_fields)
+    {
+        ///arrange
+        MESSAGE_PAYLOAD_FIELD fields[6];
+        unsigned char buffer[128];
+        int32_t size;
+        size_t count = 0;
+        set_reading(fields);
+        size = MessagePayload_Encode(fields, 6, buffer, sizeof(buffer));
+
+        ///act
+        int result = MessagePayload_Decode(buffer, (size_t)size, NULL, &count);
+
+        ///assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(size_t, 6, count);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_018: [MessagePayload_Decode shall decode the fields into fields, with names and values that point into source.]*/
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_020: [On success, MessagePayload_Decode shall set *count to the number of fields and return 0.]*/
+    TEST_FUNCTION(MessagePayload_Decode_returns_the_encoded_fields)
+    {
+        ///arrange
+        MESSAGE_PAYLOAD_FIELD fields[6];
+        MESSAGE_PAYLOAD_FIELD decoded[8];
+        unsigned char buffer[128];
+        int32_t size;
+        size_t count = 8;
+        set_reading(fields);
+        size = MessagePayload_Encode(fields, 6, buffer, sizeof(buffer));
+
+        ///act
+        int result = MessagePayload_Decode(buffer, (size_t)size, decoded, &count);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(size_t, 6, count);
+        ASSERT_ARE_EQUAL(char_ptr, "timestamp", decoded[0].name);
+        ASSERT_IS_TRUE((const unsigned char*)decoded[0].name > buffer);
+        ASSERT_IS_TRUE((const unsigned char*)decoded[0].name < buffer + size);
+        ASSERT_ARE_EQUAL(int, MESSAGE_PAYLOAD_INTEGER, decoded[0].type);
+        ASSERT_IS_TRUE(decoded[0].value.integer == -1234567890123);
+        ASSERT_ARE_EQUAL(char_ptr, "temperature", decoded[1].name);
+        ASSERT_ARE_EQUAL(int, MESSAGE_PAYLOAD_NUMBER, decoded[1].type);
+        ASSERT_IS_TRUE(decoded[1].value.number == 21.5);
+        ASSERT_ARE_EQUAL(char_ptr, "alarm", decoded[2].name);
+        ASSERT_ARE_EQUAL(int, MESSAGE_PAYLOAD_BOOLEAN, decoded[2].type);
+        ASSERT_IS_TRUE(decoded[2].value.boolean);
+        ASSERT_ARE_EQUAL(char_ptr, "deviceName", decoded[3].name);
+        ASSERT_ARE_EQUAL(int, MESSAGE_PAYLOAD_STRING, decoded[3].type);
+        ASSERT_ARE_EQUAL(char_ptr, "Sensor7", decoded[3].value.string);
+        ASSERT_ARE_EQUAL(char_ptr, "raw", decoded[4].name);
+        ASSERT_ARE_EQUAL(int, MESSAGE_PAYLOAD_BYTES, decoded[4].type);
+        ASSERT_ARE_EQUAL(size_t, 3, decoded[4].value.bytes.size);
+        ASSERT_ARE_EQUAL(int, 0, memcmp("\x00\x01\x02", decoded[4].value.bytes.buffer, 3));
+        ASSERT_ARE_EQUAL(char_ptr, "", decoded[5].name);
+        ASSERT_ARE_EQUAL(size_t, 0, decoded[5].value.bytes.size);
+        ASSERT_ARE_EQUAL(size_t, 0, currentmalloc_call);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_018: [MessagePayload_Decode shall decode the fields into fields, with names and values that point into source.]*/
+    TEST_FUNCTION(MessagePayload_Decode_returns_the_extreme_integers)
+    {
+        ///arrange
+        static const int64_t values[] = { 0, 1, -1, 63, -64, 64, -65, INT64_MAX, INT64_MIN };
+        size_t i;
+        for (i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+        {
+            MESSAGE_PAYLOAD_FIELD field;
+            MESSAGE_PAYLOAD_FIELD decoded;
+            unsigned char buffer[32];
+            int32_t size;
+            size_t count = 1;
+            set_integer(&field, "t", values[i]);
+            size = MessagePayload_Encode(&field, 1, buffer, sizeof(buffer));
+
+            ///act
+            int result = MessagePayload_Decode(buffer, (size_t)size, &decoded, &count);
+
+            ///assert
+            ASSERT_ARE_EQUAL(int, 0, result);
+            ASSERT_IS_TRUE(decoded.value.integer == values[i]);
+        }
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_019: [If a field is invalid or bytes are left after the last field, MessagePayload_Decode shall fail and return a non-zero value.]*/
+    TEST_FUNCTION(MessagePayload_Decode_of_a_truncated_payload_fails)
+    {
+        ///arrange
+        MESSAGE_PAYLOAD_FIELD fields[6];
+        MESSAGE_PAYLOAD_FIELD decoded[6];
+        unsigned char buffer[128];
+        int32_t size;
+        int32_t truncated;
+        set_reading(fields);
+        size = MessagePayload_Encode(fields, 6, buffer, sizeof(buffer));
+
+        for (truncated = 0; truncated < size; truncated++)
+        {
+            size_t count = 6;
+
+            ///act
+            int result = MessagePayload_Decode(buffer, (size_t)truncated, decoded, &count);
+
+            ///assert
+            ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        }
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_019: [If a field is invalid or bytes are left after the last field, MessagePayload_Decode shall fail and return a non-zero value.]*/
+    TEST_FUNCTION(MessagePayload_Decode_with_bytes_after_the_last_field_fails)
+    {
+        ///arrange
+        unsigned char source[sizeof(test_encoded_integer) + 4];
+        MESSAGE_PAYLOAD_FIELD field;
+        size_t count = 1;
+        memcpy(source, test_encoded_integer, sizeof(test_encoded_integer));
+        memset(source + sizeof(test_encoded_integer), 0, 4);
+
+        ///act
+        int result = MessagePayload_Decode(source, sizeof(source), &field, &count);
+
+        ///assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_019: [If a field is invalid or bytes are left after the last field, MessagePayload_Decode shall fail and return a non-zero value.]*/
+    TEST_FUNCTION(MessagePayload_Decode_of_an_unknown_type_fails)
+    {
+        ///arrange
+        unsigned char source[sizeof(test_encoded_integer)];
+        MESSAGE_PAYLOAD_FIELD field;
+        size_t count = 1;
+        memcpy(source, test_encoded_integer, sizeof(source));
+        source[7] = MESSAGE_PAYLOAD_BYTES + 1;
+
+        ///act
+        int result = MessagePayload_Decode(source, sizeof(source), &field, &count);
+
+        ///assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    }
+
+    /*Tests_SRS_MESSAGE_PAYLOAD_13_019: [If a field is invalid or bytes are left after the last field, MessagePayload_Decode shall fail and return a non-zero value.]*/
+    TEST_FUNCTION(MessagePayload_Decode_of_a_name_without_its_zero_fails)
+    {
+        ///arrange
+        unsigned char source[sizeof(test_encoded_integer)];
+        MESSAGE_PAYLOAD_FIELD field;
+        size_t count = 1;
+        memcpy(source, test_encoded_integer, sizeof(source));
+        source[6] = 'u';
+
+        ///act
+        int result = MessagePayload_Decode(source, sizeof(source), &field, &count);
+
+        ///assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    }
+
+END_TEST_SUITE(message_payload_unittests)
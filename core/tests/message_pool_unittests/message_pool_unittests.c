@@ -0,0 +1,614 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+#include "azure_c_shared_utility/lock.h"
+#include "message_pool.h"
+
+static size_t currentmalloc_call;
+static size_t whenShallmalloc_fail;
+static size_t lastmalloc_size;
+static size_t currentfree_call;
+
+static void* my_gballoc_malloc(size_t size)
+{
+    void* result;
+    currentmalloc_call++;
+    lastmalloc_size = size;
+    if ((whenShallmalloc_fail > 0) && (currentmalloc_call == whenShallmalloc_fail))
+    {
+        result = NULL;
+    }
+    else
+    {
+        result = malloc(size);
+    }
+    return result;
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    currentfree_call++;
+    free(ptr);
+}
+
+/*lock is not linked in this test, the tests run on a single thread*/
+static bool lock_fails;
+
+LOCK_HANDLE Lock_Init(void)
+{
+    return (LOCK_HANDLE)0x42;
+}
+
+LOCK_RESULT Lock(LOCK_HANDLE handle)
+{
+    (void)handle;
+    return lock_fails ? LOCK_ERROR : LOCK_OK;
+}
+
+LOCK_RESULT Unlock(LOCK_HANDLE handle)
+{
+    (void)handle;
+    return LOCK_OK;
+}
+
+LOCK_RESULT Lock_Deinit(LOCK_HANDLE handle)
+{
+    (void)handle;
+    return LOCK_OK;
+}
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#undef ENABLE_MOCKS
+
+#ifdef _MSC_VER
+#pragma warning(disable:4505)
+#endif
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    (void)error_code;
+    ASSERT_FAIL("umock_c reported error");
+}
+
+static void enable_pool(size_t thread_cache_blocks, size_t central_cache_blocks)
+{
+    MESSAGE_POOL_CONFIG config = { thread_cache_blocks, central_cache_blocks };
+    ASSERT_ARE_EQUAL(int, 0, MessagePool_Enable(&config));
+    currentmalloc_call = 0;
+    currentfree_call = 0;
+}
+
+static MESSAGE_POOL_STATISTICS get_statistics(void)
+{
+    MESSAGE_POOL_STATISTICS statistics;
+    ASSERT_ARE_EQUAL(int, 0, MessagePool_GetStatistics(&statistics));
+    return statistics;
+}
+
+BEGIN_TEST_SUITE(message_pool_unittests)
+
+    TEST_SUITE_INITIALIZE(TestClassInitialize)
+    {
+        TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        umock_c_init(on_umock_c_error);
+
+        int result = umocktypes_charptr_register_types();
+        ASSERT_ARE_EQUAL(int, 0, result);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+    }
+
+    TEST_SUITE_CLEANUP(TestClassCleanup)
+    {
+        TEST_MUTEX_DESTROY(g_testByTest);
+        TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    }
+
+    TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest) != 0)
+        {
+            ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+        }
+
+        umock_c_reset_all_calls();
+
+        currentmalloc_call = 0;
+        whenShallmalloc_fail = 0;
+        lastmalloc_size = 0;
+        currentfree_call = 0;
+        lock_fails = false;
+    }
+
+    TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+    {
+        lock_fails = false;
+        /*gives every cached block back to the heap*/
+        MessagePool_Disable();
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_001: [If config is NULL then MessagePool_Enable shall fail and return a non-zero value.]*/
+    TEST_FUNCTION(MessagePool_Enable_with_NULL_config_fails)
+    {
+        ///arrange
+
+        ///act
+        int result = MessagePool_Enable(NULL);
+
+        ///assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_002: [If config asks to cache no block at all then MessagePool_Enable shall fail and return a non-zero value.]*/
+    TEST_FUNCTION(MessagePool_Enable_without_caching_fails)
+    {
+        ///arrange
+        MESSAGE_POOL_CONFIG config = { 0, 0 };
+
+        ///act
+        int result = MessagePool_Enable(&config);
+
+        ///assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_003: [If the pool is already enabled then MessagePool_Enable shall fail and return a non-zero value.]*/
+    TEST_FUNCTION(MessagePool_Enable_twice_fails)
+    {
+        ///arrange
+        MESSAGE_POOL_CONFIG config = { 4, 4 };
+        enable_pool(4, 4);
+
+        ///act
+        int result = MessagePool_Enable(&config);
+
+        ///assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_004: [MessagePool_Enable shall reset the statistics of the pool, start a new generation of the pool and return 0.]*/
+    TEST_FUNCTION(MessagePool_Enable_resets_the_statistics)
+    {
+        ///arrange
+        enable_pool(4, 4);
+        MessagePool_Free(MessagePool_Allocate(10));
+        MessagePool_Disable();
+
+        ///act
+        enable_pool(4, 4);
+
+        ///assert
+        MESSAGE_POOL_STATISTICS statistics = get_statistics();
+        ASSERT_ARE_EQUAL(int, 0, (int)statistics.heap_allocations);
+        ASSERT_ARE_EQUAL(int, 0, (int)statistics.heap_frees);
+        ASSERT_ARE_EQUAL(int, 0, (int)statistics.central_allocations);
+        ASSERT_ARE_EQUAL(int, 0, (int)statistics.central_frees);
+        ASSERT_ARE_EQUAL(int, 0, (int)statistics.central_cached_blocks);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_018: [If the central free lists cannot be locked, MessagePool_Enable shall fail and return a non-zero value.]*/
+    TEST_FUNCTION(MessagePool_Enable_fails_when_Lock_fails)
+    {
+        ///arrange
+        MESSAGE_POOL_CONFIG config = { 4, 4 };
+        lock_fails = true;
+
+        ///act
+        int result = MessagePool_Enable(&config);
+
+        ///assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        lock_fails = false;
+        ASSERT_ARE_EQUAL(int, 0, MessagePool_Enable(&config));
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_011: [If the pool is disabled or size does not fit the largest size class, MessagePool_Allocate shall allocate the block from the heap.]*/
+    /*Tests_SRS_MESSAGE_POOL_13_015: [If the pool is disabled or the block came from the heap, MessagePool_Free shall free it to the heap.]*/
+    TEST_FUNCTION(MessagePool_Allocate_uses_the_heap_when_disabled)
+    {
+        ///arrange
+
+        ///act
+        void* block1 = MessagePool_Allocate(10);
+        MessagePool_Free(block1);
+        void* block2 = MessagePool_Allocate(10);
+        MessagePool_Free(block2);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(block1);
+        ASSERT_IS_NOT_NULL(block2);
+        ASSERT_ARE_EQUAL(int, 2, (int)currentmalloc_call);
+        ASSERT_ARE_EQUAL(int, 2, (int)currentfree_call);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_011: [If the pool is disabled or size does not fit the largest size class, MessagePool_Allocate shall allocate the block from the heap.]*/
+    TEST_FUNCTION(MessagePool_Allocate_uses_the_heap_for_big_blocks)
+    {
+        ///arrange
+        enable_pool(4, 4);
+
+        ///act
+        void* block = MessagePool_Allocate(4096);
+        MessagePool_Free(block);
+
+        ///assert
+        MESSAGE_POOL_STATISTICS statistics = get_statistics();
+        ASSERT_IS_NOT_NULL(block);
+        ASSERT_ARE_EQUAL(int, 1, (int)currentmalloc_call);
+        ASSERT_ARE_EQUAL(int, 1, (int)currentfree_call);
+        ASSERT_ARE_EQUAL(int, 1, (int)statistics.heap_allocations);
+        ASSERT_ARE_EQUAL(int, 1, (int)statistics.heap_frees);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_021: [If the central free lists cannot be locked, MessagePool_Allocate and MessagePool_Free shall use the heap instead of them.]*/
+    TEST_FUNCTION(MessagePool_Free_frees_to_the_heap_when_Lock_fails)
+    {
+        ///arrange
+        enable_pool(1, 4);
+        void* block1 = MessagePool_Allocate(10);
+        void* block2 = MessagePool_Allocate(10);
+        lock_fails = true;
+
+        ///act
+        MessagePool_Free(block1);
+        MessagePool_Free(block2);
+
+        ///assert
+        lock_fails = false;
+        MESSAGE_POOL_STATISTICS statistics = get_statistics();
+        ASSERT_ARE_EQUAL(int, 1, (int)currentfree_call);
+        ASSERT_ARE_EQUAL(int, 0, (int)statistics.central_frees);
+        ASSERT_ARE_EQUAL(int, 1, (int)statistics.heap_frees);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_021: [If the central free lists cannot be locked, MessagePool_Allocate and MessagePool_Free shall use the heap instead of them.]*/
+    TEST_FUNCTION(MessagePool_Allocate_uses_the_heap_when_Lock_fails)
+    {
+        ///arrange
+        enable_pool(1, 4);
+        void* block1 = MessagePool_Allocate(10);
+        void* block2 = MessagePool_Allocate(10);
+        MessagePool_Free(block1);
+        MessagePool_Free(block2);
+        lock_fails = true;
+
+        ///act
+        void* block3 = MessagePool_Allocate(10);
+        void* block4 = MessagePool_Allocate(10);
+
+        ///assert
+        lock_fails = false;
+        MESSAGE_POOL_STATISTICS statistics = get_statistics();
+        ASSERT_IS_NOT_NULL(block3);
+        ASSERT_IS_NOT_NULL(block4);
+        ASSERT_ARE_EQUAL(int, 3, (int)currentmalloc_call);
+        ASSERT_ARE_EQUAL(int, 0, (int)statistics.central_allocations);
+        ASSERT_ARE_EQUAL(int, 1, (int)statistics.central_cached_blocks);
+
+        ///cleanup
+        MessagePool_Free(block3);
+        MessagePool_Free(block4);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_012: [Otherwise, MessagePool_Allocate shall take a block of the smallest size class that fits size from the free list of the calling thread, then from the central free list, then from the heap.]*/
+    TEST_FUNCTION(MessagePool_Allocate_allocates_a_whole_size_class_from_the_heap)
+    {
+        ///arrange
+        enable_pool(4, 4);
+
+        ///act
+        void* small_block = MessagePool_Allocate(100);
+        size_t small_size = lastmalloc_size;
+        void* big_block = MessagePool_Allocate(1500);
+        size_t big_size = lastmalloc_size;
+
+        ///assert
+        ASSERT_IS_NOT_NULL(small_block);
+        ASSERT_IS_NOT_NULL(big_block);
+        ASSERT_ARE_EQUAL(int, 128, (int)small_size);
+        ASSERT_ARE_EQUAL(int, 2048, (int)big_size);
+
+        ///cleanup
+        MessagePool_Free(small_block);
+        MessagePool_Free(big_block);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_012: [Otherwise, MessagePool_Allocate shall take a block of the smallest size class that fits size from the free list of the calling thread, then from the central free list, then from the heap.]*/
+    /*Tests_SRS_MESSAGE_POOL_13_016: [If the block was allocated by the calling thread and its free list is not full, MessagePool_Free shall add the block to that free list.]*/
+    TEST_FUNCTION(MessagePool_Allocate_reuses_a_block_freed_by_the_same_thread)
+    {
+        ///arrange
+        enable_pool(4, 4);
+        void* block1 = MessagePool_Allocate(100);
+        MessagePool_Free(block1);
+
+        ///act
+        void* block2 = MessagePool_Allocate(90);
+
+        ///assert
+        MESSAGE_POOL_STATISTICS statistics = get_statistics();
+        ASSERT_ARE_EQUAL(void_ptr, block1, block2);
+        ASSERT_ARE_EQUAL(int, 1, (int)currentmalloc_call);
+        ASSERT_ARE_EQUAL(int, 0, (int)currentfree_call);
+        ASSERT_ARE_EQUAL(int, 0, (int)statistics.central_frees);
+
+        ///cleanup
+        MessagePool_Free(block2);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_012: [Otherwise, MessagePool_Allocate shall take a block of the smallest size class that fits size from the free list of the calling thread, then from the central free list, then from the heap.]*/
+    TEST_FUNCTION(MessagePool_Allocate_does_not_reuse_a_block_of_another_size_class)
+    {
+        ///arrange
+        enable_pool(4, 4);
+        MessagePool_Free(MessagePool_Allocate(100));
+
+        ///act
+        void* block = MessagePool_Allocate(200);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(block);
+        ASSERT_ARE_EQUAL(int, 2, (int)currentmalloc_call);
+        ASSERT_ARE_EQUAL(int, 256, (int)lastmalloc_size);
+
+        ///cleanup
+        MessagePool_Free(block);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_017: [Otherwise, MessagePool_Free shall add the block to the central free list of its size class, or free it to the heap when that list is full.]*/
+    TEST_FUNCTION(MessagePool_Free_gives_the_block_to_the_central_free_list_when_the_thread_free_list_is_full)
+    {
+        ///arrange
+        enable_pool(1, 4);
+        void* block1 = MessagePool_Allocate(10);
+        void* block2 = MessagePool_Allocate(10);
+
+        ///act
+        MessagePool_Free(block1);
+        MessagePool_Free(block2);
+
+        ///assert
+        MESSAGE_POOL_STATISTICS statistics = get_statistics();
+        ASSERT_ARE_EQUAL(int, 0, (int)currentfree_call);
+        ASSERT_ARE_EQUAL(int, 1, (int)statistics.central_frees);
+        ASSERT_ARE_EQUAL(int, 1, (int)statistics.central_cached_blocks);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_017: [Otherwise, MessagePool_Free shall add the block to the central free list of its size class, or free it to the heap when that list is full.]*/
+    TEST_FUNCTION(MessagePool_Free_frees_to_the_heap_when_the_central_free_list_is_full)
+    {
+        ///arrange
+        enable_pool(1, 1);
+        void* block1 = MessagePool_Allocate(10);
+        void* block2 = MessagePool_Allocate(10);
+        void* block3 = MessagePool_Allocate(10);
+
+        ///act
+        MessagePool_Free(block1);
+        MessagePool_Free(block2);
+        MessagePool_Free(block3);
+
+        ///assert
+        MESSAGE_POOL_STATISTICS statistics = get_statistics();
+        ASSERT_ARE_EQUAL(int, 1, (int)currentfree_call);
+        ASSERT_ARE_EQUAL(int, 1, (int)statistics.central_frees);
+        ASSERT_ARE_EQUAL(int, 1, (int)statistics.heap_frees);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_012: [Otherwise, MessagePool_Allocate shall take a block of the smallest size class that fits size from the free list of the calling thread, then from the central free list, then from the heap.]*/
+    TEST_FUNCTION(MessagePool_Allocate_takes_blocks_from_the_central_free_list)
+    {
+        ///arrange
+        enable_pool(1, 4);
+        void* block1 = MessagePool_Allocate(10);
+        void* block2 = MessagePool_Allocate(10);
+        MessagePool_Free(block1);
+        MessagePool_Free(block2);
+
+        ///act
+        void* block3 = MessagePool_Allocate(10);
+        void* block4 = MessagePool_Allocate(10);
+
+        ///assert
+        MESSAGE_POOL_STATISTICS statistics = get_statistics();
+        ASSERT_IS_NOT_NULL(block3);
+        ASSERT_IS_NOT_NULL(block4);
+        ASSERT_ARE_EQUAL(int, 2, (int)currentmalloc_call);
+        ASSERT_ARE_EQUAL(int, 1, (int)statistics.central_allocations);
+        ASSERT_ARE_EQUAL(int, 0, (int)statistics.central_cached_blocks);
+
+        ///cleanup
+        MessagePool_Free(block3);
+        MessagePool_Free(block4);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_013: [If allocating the block fails, MessagePool_Allocate shall return NULL.]*/
+    TEST_FUNCTION(MessagePool_Allocate_fails_when_malloc_fails)
+    {
+        ///arrange
+        enable_pool(4, 4);
+        whenShallmalloc_fail = 1;
+
+        ///act
+        void* block = MessagePool_Allocate(10);
+
+        ///assert
+        ASSERT_IS_NULL(block);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_013: [If allocating the block fails, MessagePool_Allocate shall return NULL.]*/
+    TEST_FUNCTION(MessagePool_Allocate_fails_when_malloc_fails_while_disabled)
+    {
+        ///arrange
+        whenShallmalloc_fail = 1;
+
+        ///act
+        void* block = MessagePool_Allocate(10);
+
+        ///assert
+        ASSERT_IS_NULL(block);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_014: [If block is NULL then MessagePool_Free shall do nothing.]*/
+    TEST_FUNCTION(MessagePool_Free_with_NULL_does_nothing)
+    {
+        ///arrange
+        enable_pool(4, 4);
+
+        ///act
+        MessagePool_Free(NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, 0, (int)currentfree_call);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_005: [MessagePool_Disable shall disable the pool so that blocks are allocated from and freed to the heap.]*/
+    TEST_FUNCTION(MessagePool_Disable_frees_blocks_still_alive_to_the_heap)
+    {
+        ///arrange
+        enable_pool(4, 4);
+        void* block = MessagePool_Allocate(10);
+        MessagePool_Disable();
+
+        ///act
+        MessagePool_Free(block);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, 1, (int)currentfree_call);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_006: [MessagePool_Disable shall free the blocks of the central free lists.]*/
+    /*Tests_SRS_MESSAGE_POOL_13_007: [MessagePool_Disable shall free the blocks cached by the calling thread.]*/
+    TEST_FUNCTION(MessagePool_Disable_frees_the_cached_blocks)
+    {
+        ///arrange
+        enable_pool(1, 4);
+        void* block1 = MessagePool_Allocate(10);
+        void* block2 = MessagePool_Allocate(10);
+        void* block3 = MessagePool_Allocate(1000);
+        MessagePool_Free(block1);
+        MessagePool_Free(block2);
+        MessagePool_Free(block3);
+
+        ///act
+        MessagePool_Disable();
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, 3, (int)currentmalloc_call);
+        ASSERT_ARE_EQUAL(int, 3, (int)currentfree_call);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_019: [If the central free lists cannot be locked, MessagePool_Disable shall still disable the pool and leave the blocks of the central free lists to the next MessagePool_Disable.]*/
+    TEST_FUNCTION(MessagePool_Disable_disables_the_pool_when_Lock_fails)
+    {
+        ///arrange
+        enable_pool(1, 4);
+        void* block1 = MessagePool_Allocate(10);
+        void* block2 = MessagePool_Allocate(10);
+        MessagePool_Free(block1);
+        MessagePool_Free(block2);
+        lock_fails = true;
+
+        ///act
+        MessagePool_Disable();
+
+        ///assert
+        lock_fails = false;
+        ASSERT_ARE_EQUAL(int, 1, (int)currentfree_call);
+        enable_pool(1, 4);
+        MESSAGE_POOL_STATISTICS statistics = get_statistics();
+        ASSERT_ARE_EQUAL(int, 1, (int)statistics.central_cached_blocks);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_008: [MessagePool_ReleaseThreadCache shall give the blocks cached by the calling thread to the central free lists, or to the heap when they are full or the pool is disabled.]*/
+    TEST_FUNCTION(MessagePool_ReleaseThreadCache_gives_the_blocks_to_the_central_free_lists)
+    {
+        ///arrange
+        enable_pool(4, 1);
+        void* block1 = MessagePool_Allocate(10);
+        void* block2 = MessagePool_Allocate(10);
+        MessagePool_Free(block1);
+        MessagePool_Free(block2);
+
+        ///act
+        MessagePool_ReleaseThreadCache();
+
+        ///assert
+        MESSAGE_POOL_STATISTICS statistics = get_statistics();
+        ASSERT_ARE_EQUAL(int, 1, (int)statistics.central_cached_blocks);
+        ASSERT_ARE_EQUAL(int, 1, (int)statistics.heap_frees);
+        ASSERT_ARE_EQUAL(int, 1, (int)currentfree_call);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_009: [If statistics is NULL then MessagePool_GetStatistics shall fail and return a non-zero value.]*/
+    TEST_FUNCTION(MessagePool_GetStatistics_with_NULL_statistics_fails)
+    {
+        ///arrange
+
+        ///act
+        int result = MessagePool_GetStatistics(NULL);
+
+        ///assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_020: [If the central free lists cannot be locked, MessagePool_GetStatistics shall fail and return a non-zero value.]*/
+    TEST_FUNCTION(MessagePool_GetStatistics_fails_when_Lock_fails)
+    {
+        ///arrange
+        MESSAGE_POOL_STATISTICS statistics;
+        enable_pool(4, 4);
+        lock_fails = true;
+
+        ///act
+        int result = MessagePool_GetStatistics(&statistics);
+
+        ///assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    }
+
+    /*Tests_SRS_MESSAGE_POOL_13_010: [MessagePool_GetStatistics shall copy the counters of the pool to statistics and return 0.]*/
+    TEST_FUNCTION(MessagePool_GetStatistics_counts_heap_allocations)
+    {
+        ///arrange
+        enable_pool(4, 4);
+        void* block1 = MessagePool_Allocate(10);
+        void* block2 = MessagePool_Allocate(10);
+        MessagePool_Free(block1);
+        void* block3 = MessagePool_Allocate(10);
+
+        ///act
+        MESSAGE_POOL_STATISTICS statistics;
+        int result = MessagePool_GetStatistics(&statistics);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(int, 2, (int)statistics.heap_allocations);
+        ASSERT_ARE_EQUAL(int, 0, (int)statistics.heap_frees);
+
+        ///cleanup
+        MessagePool_Free(block2);
+        MessagePool_Free(block3);
+    }
+
+END_TEST_SUITE(message_pool_unittests)
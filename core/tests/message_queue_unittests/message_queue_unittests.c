@@ -0,0 +1,501 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include <stdbool.h>
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+#include "message.h"
+#include "message_queue.h"
+
+static size_t currentmalloc_call;
+static size_t whenShallmalloc_fail;
+
+static size_t currentMessage_Destroy_call;
+
+static void* my_gballoc_malloc(size_t size)
+{
+    void* result;
+    currentmalloc_call++;
+    if ((whenShallmalloc_fail > 0) && (currentmalloc_call == whenShallmalloc_fail))
+    {
+        result = NULL;
+    }
+    else
+    {
+        result = malloc(size);
+    }
+    return result;
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+/*message.c is not linked in this test; the queue only ever destroys messages*/
+void Message_Destroy(MESSAGE_HANDLE message)
+{
+    (void)message;
+    currentMessage_Destroy_call++;
+}
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#undef ENABLE_MOCKS
+
+#ifdef _MSC_VER
+#pragma warning(disable:4505)
+#endif
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    ASSERT_FAIL("umock_c reported error");
+}
+
+#define FAKE_MESSAGE(n) ((MESSAGE_HANDLE)(size_t)(0x100 + (n)))
+
+BEGIN_TEST_SUITE(message_queue_unittests)
+
+    TEST_SUITE_INITIALIZE(TestClassInitialize)
+    {
+        TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        umock_c_init(on_umock_c_error);
+
+        int result = umocktypes_charptr_register_types();
+        ASSERT_ARE_EQUAL(int, 0, result);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+    }
+
+    TEST_SUITE_CLEANUP(TestClassCleanup)
+    {
+        TEST_MUTEX_DESTROY(g_testByTest);
+        TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    }
+
+    TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest) != 0)
+        {
+            ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+        }
+
+        umock_c_reset_all_calls();
+
+        currentmalloc_call = 0;
+        whenShallmalloc_fail = 0;
+
+        currentMessage_Destroy_call = 0;
+    }
+
+    TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+    {
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    /*Tests_SRS_MESSAGE_QUEUE_13_001: [MessageQueue_Create shall allocate a new MESSAGE_QUEUE_HANDLE_DATA and return NULL if it fails.]*/
+    TEST_FUNCTION(MessageQueue_Create_fails_when_malloc_fails)
+    {
+        ///arrange
+        whenShallmalloc_fail = 1;
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        MESSAGE_QUEUE_HANDLE queue = MessageQueue_Create(0, 0);
+
+        ///assert
+        ASSERT_IS_NULL(queue);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_QUEUE_13_005: [If allocating the circular buffer fails, MessageQueue_Create shall free all resources and return NULL.]*/
+    TEST_FUNCTION(MessageQueue_Create_fails_when_buffer_malloc_fails)
+    {
+        ///arrange
+        whenShallmalloc_fail = 2;
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        MESSAGE_QUEUE_HANDLE queue = MessageQueue_Create(0, 0);
+
+        ///assert
+        ASSERT_IS_NULL(queue);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_QUEUE_13_002: [If initial_capacity is 0, MessageQueue_Create shall use a default capacity of 16.]*/
+    /*Tests_SRS_MESSAGE_QUEUE_13_004: [MessageQueue_Create shall round the capacity up to the next power of 2 and allocate the circular buffer.]*/
+    TEST_FUNCTION(MessageQueue_Create_succeeds)
+    {
+        ///arrange
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(gballoc_malloc(16 * sizeof(MESSAGE_HANDLE)));
+
+        ///act
+        MESSAGE_QUEUE_HANDLE queue = MessageQueue_Create(0, 0);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(queue);
+        ASSERT_IS_TRUE(MessageQueue_IsEmpty(queue));
+        ASSERT_ARE_EQUAL(size_t, 0, MessageQueue_Size(queue));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+        MessageQueue_Destroy(queue);
+    }
+
+    /*Tests_SRS_MESSAGE_QUEUE_13_004: [MessageQueue_Create shall round the capacity up to the next power of 2 and allocate the circular buffer.]*/
+    TEST_FUNCTION(MessageQueue_Create_rounds_capacity_up)
+    {
+        ///arrange
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(gballoc_malloc(8 * sizeof(MESSAGE_HANDLE)));
+
+        ///act
+        MESSAGE_QUEUE_HANDLE queue = MessageQueue_Create(5, 0);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(queue);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+        MessageQueue_Destroy(queue);
+    }
+
+    /*Tests_SRS_MESSAGE_QUEUE_13_003: [If max_capacity is not 0 and is smaller than the initial capacity, the initial capacity shall be max_capacity.]*/
+    TEST_FUNCTION(MessageQueue_Create_limits_capacity_to_max_capacity)
+    {
+        ///arrange
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(gballoc_malloc(4 * sizeof(MESSAGE_HANDLE)));
+
+        ///act
+        MESSAGE_QUEUE_HANDLE queue = MessageQueue_Create(0, 3);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(queue);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+        MessageQueue_Destroy(queue);
+    }
+
+    /*Tests_SRS_MESSAGE_QUEUE_13_006: [If handle is NULL, MessageQueue_Destroy shall do nothing.]*/
+    TEST_FUNCTION(MessageQueue_Destroy_with_NULL_does_nothing)
+    {
+        ///arrange
+
+        ///act
+        MessageQueue_Destroy(NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_QUEUE_13_007: [MessageQueue_Destroy shall call Message_Destroy on every message still in the queue.]*/
+    /*Tests_SRS_MESSAGE_QUEUE_13_008: [MessageQueue_Destroy shall free the circular buffer and the queue.]*/
+    TEST_FUNCTION(MessageQueue_Destroy_destroys_queued_messages)
+    {
+        ///arrange
+        MESSAGE_QUEUE_HANDLE queue = MessageQueue_Create(0, 0);
+        (void)MessageQueue_Push(queue, FAKE_MESSAGE(1));
+        (void)MessageQueue_Push(queue, FAKE_MESSAGE(2));
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        MessageQueue_Destroy(queue);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 2, currentMessage_Destroy_call);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_QUEUE_13_009: [If handle or message is NULL, MessageQueue_Push shall return MESSAGE_QUEUE_INVALIDARG.]*/
+    TEST_FUNCTION(MessageQueue_Push_with_NULL_handle_fails)
+    {
+        ///arrange
+
+        ///act
+        MESSAGE_QUEUE_RESULT result = MessageQueue_Push(NULL, FAKE_MESSAGE(1));
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, MESSAGE_QUEUE_INVALIDARG, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_QUEUE_13_009: [If handle or message is NULL, MessageQueue_Push shall return MESSAGE_QUEUE_INVALIDARG.]*/
+    TEST_FUNCTION(MessageQueue_Push_with_NULL_message_fails)
+    {
+        ///arrange
+        MESSAGE_QUEUE_HANDLE queue = MessageQueue_Create(0, 0);
+        umock_c_reset_all_calls();
+
+        ///act
+        MESSAGE_QUEUE_RESULT result = MessageQueue_Push(queue, NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, MESSAGE_QUEUE_INVALIDARG, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+        MessageQueue_Destroy(queue);
+    }
+
+    /*Tests_SRS_MESSAGE_QUEUE_13_013: [MessageQueue_Push shall store message at the back of the queue and return MESSAGE_QUEUE_OK.]*/
+    /*Tests_SRS_MESSAGE_QUEUE_13_015: [MessageQueue_Pop shall remove and return the message at the front of the queue.]*/
+    TEST_FUNCTION(MessageQueue_Push_and_Pop_are_FIFO)
+    {
+        ///arrange
+        MESSAGE_QUEUE_HANDLE queue = MessageQueue_Create(0, 0);
+        umock_c_reset_all_calls();
+
+        ///act
+        MESSAGE_QUEUE_RESULT result1 = MessageQueue_Push(queue, FAKE_MESSAGE(1));
+        MESSAGE_QUEUE_RESULT result2 = MessageQueue_Push(queue, FAKE_MESSAGE(2));
+        MESSAGE_QUEUE_RESULT result3 = MessageQueue_Push(queue, FAKE_MESSAGE(3));
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, MESSAGE_QUEUE_OK, result1);
+        ASSERT_ARE_EQUAL(int, MESSAGE_QUEUE_OK, result2);
+        ASSERT_ARE_EQUAL(int, MESSAGE_QUEUE_OK, result3);
+        ASSERT_ARE_EQUAL(size_t, 3, MessageQueue_Size(queue));
+        ASSERT_ARE_EQUAL(void_ptr, FAKE_MESSAGE(1), MessageQueue_Pop(queue));
+        ASSERT_ARE_EQUAL(void_ptr, FAKE_MESSAGE(2), MessageQueue_Pop(queue));
+        ASSERT_ARE_EQUAL(void_ptr, FAKE_MESSAGE(3), MessageQueue_Pop(queue));
+        ASSERT_IS_TRUE(MessageQueue_IsEmpty(queue));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+        MessageQueue_Destroy(queue);
+    }
+
+    /*Tests_SRS_MESSAGE_QUEUE_13_011: [If the circular buffer is full, MessageQueue_Push shall double its size.]*/
+    TEST_FUNCTION(MessageQueue_Push_grows_a_wrapped_queue_and_keeps_order)
+    {
+        ///arrange
+        size_t i;
+        MESSAGE_QUEUE_HANDLE queue = MessageQueue_Create(4, 0);
+
+        /*move the head so that the buffer wraps around before it grows*/
+        (void)MessageQueue_Push(queue, FAKE_MESSAGE(0));
+        (void)MessageQueue_Push(queue, FAKE_MESSAGE(1));
+        (void)MessageQueue_Pop(queue);
+        (void)MessageQueue_Pop(queue);
+        for (i = 0; i < 4; i++)
+        {
+            (void)MessageQueue_Push(queue, FAKE_MESSAGE(10 + i));
+        }
+        umock_c_reset_all_calls();
+
+        STRICT_EXPECTED_CALL(gballoc_malloc(8 * sizeof(MESSAGE_HANDLE)));
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        MESSAGE_QUEUE_RESULT result = MessageQueue_Push(queue, FAKE_MESSAGE(14));
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, MESSAGE_QUEUE_OK, result);
+        ASSERT_ARE_EQUAL(size_t, 5, MessageQueue_Size(queue));
+        for (i = 0; i < 5; i++)
+        {
+            ASSERT_ARE_EQUAL(void_ptr, FAKE_MESSAGE(10 + i), MessageQueue_Pop(queue));
+        }
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+        MessageQueue_Destroy(queue);
+    }
+
+    /*Tests_SRS_MESSAGE_QUEUE_13_012: [If growing the circular buffer fails, MessageQueue_Push shall return MESSAGE_QUEUE_ERROR.]*/
+    TEST_FUNCTION(MessageQueue_Push_fails_when_growing_fails)
+    {
+        ///arrange
+        MESSAGE_QUEUE_HANDLE queue = MessageQueue_Create(1, 0);
+        (void)MessageQueue_Push(queue, FAKE_MESSAGE(1));
+        umock_c_reset_all_calls();
+
+        whenShallmalloc_fail = currentmalloc_call + 1;
+        STRICT_EXPECTED_CALL(gballoc_malloc(2 * sizeof(MESSAGE_HANDLE)));
+
+        ///act
+        MESSAGE_QUEUE_RESULT result = MessageQueue_Push(queue, FAKE_MESSAGE(2));
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, MESSAGE_QUEUE_ERROR, result);
+        ASSERT_ARE_EQUAL(size_t, 1, MessageQueue_Size(queue));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+        MessageQueue_Destroy(queue);
+    }
+
+    /*Tests_SRS_MESSAGE_QUEUE_13_010: [If the queue holds max_capacity messages, MessageQueue_Push shall return MESSAGE_QUEUE_FULL.]*/
+    TEST_FUNCTION(MessageQueue_Push_fails_when_queue_is_at_max_capacity)
+    {
+        ///arrange
+        MESSAGE_QUEUE_HANDLE queue = MessageQueue_Create(0, 2);
+        (void)MessageQueue_Push(queue, FAKE_MESSAGE(1));
+        (void)MessageQueue_Push(queue, FAKE_MESSAGE(2));
+        umock_c_reset_all_calls();
+
+        ///act
+        MESSAGE_QUEUE_RESULT result = MessageQueue_Push(queue, FAKE_MESSAGE(3));
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, MESSAGE_QUEUE_FULL, result);
+        ASSERT_ARE_EQUAL(size_t, 2, MessageQueue_Size(queue));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+        MessageQueue_Destroy(queue);
+    }
+
+    /*Tests_SRS_MESSAGE_QUEUE_13_014: [If handle is NULL or the queue is empty, MessageQueue_Pop shall return NULL.]*/
+    TEST_FUNCTION(MessageQueue_Pop_with_NULL_returns_NULL)
+    {
+        ///arrange
+
+        ///act
+        MESSAGE_HANDLE result = MessageQueue_Pop(NULL);
+
+        ///assert
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_MESSAGE_QUEUE_13_014: [If handle is NULL or the queue is empty, MessageQueue_Pop shall return NULL.]*/
+    TEST_FUNCTION(MessageQueue_Pop_on_empty_queue_returns_NULL)
+    {
+        ///arrange
+        MESSAGE_QUEUE_HANDLE queue = MessageQueue_Create(0, 0);
+
+        ///act
+        MESSAGE_HANDLE result = MessageQueue_Pop(queue);
+
+        ///assert
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+        MessageQueue_Destroy(queue);
+    }
+
+    /*Tests_SRS_MESSAGE_QUEUE_13_018: [If handle or messages is NULL, MessageQueue_PopBatch shall return 0.]*/
+    TEST_FUNCTION(MessageQueue_PopBatch_with_NULL_returns_0)
+    {
+        ///arrange
+        MESSAGE_HANDLE messages[2];
+        MESSAGE_QUEUE_HANDLE queue = MessageQueue_Create(0, 0);
+        (void)MessageQueue_Push(queue, FAKE_MESSAGE(1));
+
+        ///act
+        size_t result1 = MessageQueue_PopBatch(NULL, messages, 2);
+        size_t result2 = MessageQueue_PopBatch(queue, NULL, 2);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 0, result1);
+        ASSERT_ARE_EQUAL(size_t, 0, result2);
+        ASSERT_ARE_EQUAL(size_t, 1, MessageQueue_Size(queue));
+
+        ///cleanup
+        MessageQueue_Destroy(queue);
+    }
+
+    /*Tests_SRS_MESSAGE_QUEUE_13_019: [MessageQueue_PopBatch shall remove the oldest messages of the queue, up to max_count of them, store them in messages in order and return how many it removed.]*/
+    TEST_FUNCTION(MessageQueue_PopBatch_pops_a_wrapped_queue_in_order)
+    {
+        ///arrange
+        size_t i;
+        MESSAGE_HANDLE messages[4];
+        MESSAGE_QUEUE_HANDLE queue = MessageQueue_Create(4, 0);
+
+        /*move the head so that the messages wrap around the end of the buffer*/
+        (void)MessageQueue_Push(queue, FAKE_MESSAGE(0));
+        (void)MessageQueue_Push(queue, FAKE_MESSAGE(1));
+        (void)MessageQueue_Push(queue, FAKE_MESSAGE(2));
+        (void)MessageQueue_Pop(queue);
+        (void)MessageQueue_Pop(queue);
+        (void)MessageQueue_Pop(queue);
+        for (i = 0; i < 3; i++)
+        {
+            (void)MessageQueue_Push(queue, FAKE_MESSAGE(10 + i));
+        }
+        umock_c_reset_all_calls();
+
+        ///act
+        size_t result1 = MessageQueue_PopBatch(queue, messages, 2);
+        size_t result2 = MessageQueue_PopBatch(queue, messages + 2, 2);
+        size_t result3 = MessageQueue_PopBatch(queue, messages, 2);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 2, result1);
+        ASSERT_ARE_EQUAL(size_t, 1, result2);
+        ASSERT_ARE_EQUAL(size_t, 0, result3);
+        for (i = 0; i < 3; i++)
+        {
+            ASSERT_ARE_EQUAL(void_ptr, FAKE_MESSAGE(10 + i), messages[i]);
+        }
+        ASSERT_IS_TRUE(MessageQueue_IsEmpty(queue));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+        MessageQueue_Destroy(queue);
+    }
+
+    /*Tests_SRS_MESSAGE_QUEUE_13_016: [MessageQueue_Size shall return the number of messages in the queue, or 0 if handle is NULL.]*/
+    /*Tests_SRS_MESSAGE_QUEUE_13_017: [MessageQueue_IsEmpty shall return true if handle is NULL or the queue holds no messages, false otherwise.]*/
+    TEST_FUNCTION(MessageQueue_Size_and_IsEmpty_with_NULL)
+    {
+        ///arrange
+
+        ///act
+        size_t size = MessageQueue_Size(NULL);
+        bool isEmpty = MessageQueue_IsEmpty(NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 0, size);
+        ASSERT_IS_TRUE(isEmpty);
+
+        ///cleanup
+    }
+
+END_TEST_SUITE(message_queue_unittests)
@@ -0,0 +1,201 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/*
+* Measures how long loading the libraries of the modules of a gateway takes
+* when many modules share a few libraries. Every run loads the given module
+* libraries, one after another, for every one of the module instances of a
+* configuration and then unloads them, two ways:
+*     - "per_instance" opens the library and calls its Module_GetAPIS for
+*       every instance, with DynamicLibrary_LoadLibrary and
+*       DynamicLibrary_FindSymbol, as ModuleLoader_Load did before it shared
+*       the loaded libraries;
+*     - "module_loader" calls ModuleLoader_Load and ModuleLoader_Unload.
+* Every run prints one JSON object on its own line:
+*     {"loader":"<name>","libraries":<n>,"instances":<n>,"runs":<n>,
+*      "load_us":{"min":<n>,"mean":<n>},"unload_us":{"min":<n>,"mean":<n>}}
+* where load_us is the time taken to load every instance and unload_us the
+* time taken to unload them.
+*
+* usage: module_loader_bench [-n instances] library_path...
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "azure_c_shared_utility/iot_logging.h"
+
+#include "module.h"
+#include "module_loader.h"
+#include "dynamic_library.h"
+
+#if defined(WIN32)
+#include <windows.h>
+#endif
+
+#define DEFAULT_INSTANCES   200
+#define RUNS                10
+
+typedef struct LOADER_TAG
+{
+    const char* name;
+    /*loads the library at path and returns an opaque handle, or NULL*/
+    void* (*load)(const char* path);
+    void (*unload)(void* handle);
+}LOADER;
+
+static uint64_t get_time_us(void)
+{
+#if defined(WIN32)
+    LARGE_INTEGER frequency, counter;
+    (void)QueryPerformanceFrequency(&frequency);
+    (void)QueryPerformanceCounter(&counter);
+    return (uint64_t)((counter.QuadPart / frequency.QuadPart) * 1000000 + ((counter.QuadPart % frequency.QuadPart) * 1000000) / frequency.QuadPart);
+#else
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+#endif
+}
+
+static void* per_instance_load(const char* path)
+{
+    DYNAMIC_LIBRARY_HANDLE result = DynamicLibrary_LoadLibrary(path);
+    if (result != NULL)
+    {
+        pfModule_GetAPIS pfnGetAPIS = (pfModule_GetAPIS)DynamicLibrary_FindSymbol(result, MODULE_GETAPIS_NAME);
+        if (pfnGetAPIS == NULL || pfnGetAPIS() == NULL)
+        {
+            DynamicLibrary_UnloadLibrary(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+static void per_instance_unload(void* handle)
+{
+    DynamicLibrary_UnloadLibrary(handle);
+}
+
+static void* module_loader_load(const char* path)
+{
+    return ModuleLoader_Load(path);
+}
+
+static void module_loader_unload(void* handle)
+{
+    ModuleLoader_Unload((MODULE_LIBRARY_HANDLE)handle);
+}
+
+static const LOADER loaders[] =
+{
+    { "per_instance", per_instance_load, per_instance_unload },
+    { "module_loader", module_loader_load, module_loader_unload }
+};
+
+static int run_bench(const LOADER* loader, char** paths, size_t path_count, size_t instances)
+{
+    int result;
+    void** handles = (void**)malloc(instances * sizeof(void*));
+    if (handles == NULL)
+    {
+        LogError("malloc failed");
+        result = __LINE__;
+    }
+    else
+    {
+        uint64_t load_min_us = UINT64_MAX;
+        uint64_t load_total_us = 0;
+        uint64_t unload_min_us = UINT64_MAX;
+        uint64_t unload_total_us = 0;
+        size_t run;
+
+        result = 0;
+        for (run = 0; run < RUNS && result == 0; run++)
+        {
+            uint64_t start_us = get_time_us();
+            uint64_t loaded_us;
+            uint64_t unloaded_us;
+            size_t loaded;
+            size_t i;
+
+            /*the instances of a configuration name their libraries in turn*/
+            for (loaded = 0; loaded < instances; loaded++)
+            {
+                if ((handles[loaded] = loader->load(paths[loaded % path_count])) == NULL)
+                {
+                    LogError("%s failed to load %s", loader->name, paths[loaded % path_count]);
+                    result = __LINE__;
+                    break;
+                }
+            }
+            loaded_us = get_time_us();
+            for (i = loaded; i > 0; i--)
+            {
+                loader->unload(handles[i - 1]);
+            }
+            unloaded_us = get_time_us();
+
+            if (loaded_us - start_us < load_min_us)
+            {
+                load_min_us = loaded_us - start_us;
+            }
+            if (unloaded_us - loaded_us < unload_min_us)
+            {
+                unload_min_us = unloaded_us - loaded_us;
+            }
+            load_total_us += loaded_us - start_us;
+            unload_total_us += unloaded_us - loaded_us;
+        }
+
+        if (result == 0)
+        {
+            (void)printf("{\"loader\":\"%s\",\"libraries\":%lu,\"instances\":%lu,\"runs\":%d,"
+                "\"load_us\":{\"min\":%llu,\"mean\":%llu},\"unload_us\":{\"min\":%llu,\"mean\":%llu}}\n",
+                loader->name, (unsigned long)path_count, (unsigned long)instances, RUNS,
+                (unsigned long long)load_min_us, (unsigned long long)(load_total_us / RUNS),
+                (unsigned long long)unload_min_us, (unsigned long long)(unload_total_us / RUNS));
+        }
+
+        free(handles);
+    }
+
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    int result = 0;
+    size_t instances = DEFAULT_INSTANCES;
+    int first_path = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-n") == 0)
+    {
+        instances = (size_t)strtoul(argv[2], NULL, 10);
+        first_path = 3;
+    }
+
+    if (instances == 0 || first_path >= argc)
+    {
+        (void)printf("usage: module_loader_bench [-n instances] library_path...\n");
+        result = 1;
+    }
+    else
+    {
+        size_t i;
+        for (i = 0; i < sizeof(loaders) / sizeof(loaders[0]); i++)
+        {
+            if (run_bench(&loaders[i], argv + first_path, (size_t)(argc - first_path), instances) != 0)
+            {
+                result = 1;
+            }
+        }
+    }
+
+    return result;
+}
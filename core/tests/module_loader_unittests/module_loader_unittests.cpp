@@ -43,6 +43,8 @@ namespace BASEIMPLEMENTATION
 
 static size_t currentmalloc_call;
 static size_t whenShallmalloc_fail;
+static size_t currentLock_call;
+static size_t whenShallLock_fail;
 
 // Value for a good handle
 #define TEST_MODULE_LIBRARY_GOOD_HANDLE (void*)0xDEAF
@@ -56,7 +58,14 @@ static size_t whenShallmalloc_fail;
 #define TEST_MODULE_LIBRARY_BAD_NAME ("bad")
 
 
+// Value returned by Lock_Init, the module loader never destroys its lock
+#define TEST_LOCK_HANDLE (LOCK_HANDLE)0x42
+
+// Value returned by the Module_GetReceiveBatch of a library that exports it
+#define TEST_MODULE_RECEIVE_BATCH (void*)0xBA7C
+
 static bool test_getApi_func_success = true;
+static bool test_has_receive_batch = false;
 
 TYPED_MOCK_CLASS(CModuleLoaderMocks, CGlobalMock)
 {
@@ -75,7 +84,7 @@ public:
 			{
 				*(void**)result1 = TEST_MODULE_LIBRARY_BADSYM_HANDLE;
 			}
-			else if (strcmp(dynamicLibraryFileName, TEST_MODULE_LIBRARY_GOOD_NAME) == 0)
+			else
 			{
 				*(void**)result1 = TEST_MODULE_LIBRARY_GOOD_HANDLE;
 			}
@@ -108,6 +117,10 @@ public:
 		{
 			result2 = NULL;
 		}
+		if (strcmp(symbolName, MODULE_GETRECEIVEBATCH_NAME) == 0)
+		{
+			result2 = (test_has_receive_batch && (result2 != NULL)) ? (void*)&test_getReceiveBatch_func : NULL;
+		}
 	MOCK_METHOD_END(void*, result2)
 
     // Mock GetAPIS function, returned on successful call of FindSymbol.
@@ -119,6 +132,10 @@ public:
 		}
 	MOCK_METHOD_END(void*, result3)
 
+	// Mock Module_GetReceiveBatch function, returned by FindSymbol when test_has_receive_batch is true.
+	MOCK_STATIC_METHOD_0(, void *, test_getReceiveBatch_func)
+	MOCK_METHOD_END(void*, TEST_MODULE_RECEIVE_BATCH)
+
 	MOCK_STATIC_METHOD_1(, void*, gballoc_malloc, size_t, size)
 		void* result2;
 		currentmalloc_call++;
@@ -142,6 +159,22 @@ public:
 	MOCK_STATIC_METHOD_2(, void*, gballoc_realloc, void*, ptr, size_t, size)
 		MOCK_METHOD_END(void*, BASEIMPLEMENTATION::gballoc_realloc(ptr, size));
 
+	MOCK_STATIC_METHOD_0(, LOCK_HANDLE, Lock_Init)
+	MOCK_METHOD_END(LOCK_HANDLE, TEST_LOCK_HANDLE);
+
+	MOCK_STATIC_METHOD_1(, LOCK_RESULT, Lock, LOCK_HANDLE, lock)
+		currentLock_call++;
+		auto result1 = (whenShallLock_fail == currentLock_call) ? LOCK_ERROR : LOCK_OK;
+	MOCK_METHOD_END(LOCK_RESULT, result1);
+
+	MOCK_STATIC_METHOD_1(, LOCK_RESULT, Unlock, LOCK_HANDLE, lock)
+		auto result1 = LOCK_OK;
+	MOCK_METHOD_END(LOCK_RESULT, result1);
+
+	MOCK_STATIC_METHOD_1(, LOCK_RESULT, Lock_Deinit, LOCK_HANDLE, lock)
+		auto result1 = LOCK_OK;
+	MOCK_METHOD_END(LOCK_RESULT, result1);
+
 	MOCK_STATIC_METHOD_1(, void, gballoc_free, void*, ptr)
 		BASEIMPLEMENTATION::gballoc_free(ptr);
 	MOCK_VOID_METHOD_END()
@@ -151,6 +184,12 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CModuleLoaderMocks, , void*, DynamicLibrary_LoadLib
 DECLARE_GLOBAL_MOCK_METHOD_1(CModuleLoaderMocks, , void, DynamicLibrary_UnloadLibrary, void*, library);
 DECLARE_GLOBAL_MOCK_METHOD_2(CModuleLoaderMocks, , void*, DynamicLibrary_FindSymbol, void*, library, const char*, symbolName);
 DECLARE_GLOBAL_MOCK_METHOD_0(CModuleLoaderMocks, , void*, test_getApi_func);
+DECLARE_GLOBAL_MOCK_METHOD_0(CModuleLoaderMocks, , void*, test_getReceiveBatch_func);
+
+DECLARE_GLOBAL_MOCK_METHOD_0(CModuleLoaderMocks, , LOCK_HANDLE, Lock_Init);
+DECLARE_GLOBAL_MOCK_METHOD_1(CModuleLoaderMocks, , LOCK_RESULT, Lock, LOCK_HANDLE, lock);
+DECLARE_GLOBAL_MOCK_METHOD_1(CModuleLoaderMocks, , LOCK_RESULT, Unlock, LOCK_HANDLE, lock);
+DECLARE_GLOBAL_MOCK_METHOD_1(CModuleLoaderMocks, , LOCK_RESULT, Lock_Deinit, LOCK_HANDLE, lock);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CModuleLoaderMocks, , void*, gballoc_malloc, size_t, size);
 DECLARE_GLOBAL_MOCK_METHOD_2(CModuleLoaderMocks, , void*, gballoc_realloc, void*, ptr, size_t, size);
@@ -166,6 +205,10 @@ BEGIN_TEST_SUITE(module_loader_unittests)
         TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
 		g_testByTest = MicroMockCreateMutex();
 		ASSERT_IS_NOT_NULL(g_testByTest);
+
+		/*the first ModuleLoader_Load creates the lock of the loaded libraries, so that no test sees Lock_Init*/
+		CModuleLoaderMocks mocks;
+		ModuleLoader_Unload(ModuleLoader_Load(TEST_MODULE_LIBRARY_GOOD_NAME));
 	}
 
     TEST_SUITE_CLEANUP(TestClassCleanup)
@@ -182,7 +225,10 @@ BEGIN_TEST_SUITE(module_loader_unittests)
 		}
 		currentmalloc_call = 0;
 		whenShallmalloc_fail = 0;
+		currentLock_call = 0;
+		whenShallLock_fail = 0;
 		test_getApi_func_success = true;
+		test_has_receive_batch = false;
     }
 
     TEST_FUNCTION_CLEANUP(TestMethodCleanup)
@@ -193,7 +239,10 @@ BEGIN_TEST_SUITE(module_loader_unittests)
 		}
 		currentmalloc_call = 0;
 		whenShallmalloc_fail = 0;
+		currentLock_call = 0;
+		whenShallLock_fail = 0;
 		test_getApi_func_success = true;
+		test_has_receive_batch = false;
     }
 
 	/*Tests_SRS_MODULE_LOADER_17_001: [ModuleLoader_Load shall validate the moduleFileName, if it is NULL or an empty string, it will return NULL.]*/
@@ -221,6 +270,8 @@ BEGIN_TEST_SUITE(module_loader_unittests)
 		const char* moduleFileName = TEST_MODULE_LIBRARY_GOOD_NAME;
 
 		whenShallmalloc_fail = 1;
+		STRICT_EXPECTED_CALL(mocks, Lock(TEST_LOCK_HANDLE));
+		STRICT_EXPECTED_CALL(mocks, Unlock(TEST_LOCK_HANDLE));
 		STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
 			.IgnoreArgument(1);
 
@@ -240,6 +291,8 @@ BEGIN_TEST_SUITE(module_loader_unittests)
 		CModuleLoaderMocks mocks;
 		///arrange
 		const char* moduleFileName = TEST_MODULE_LIBRARY_BAD_NAME;
+		STRICT_EXPECTED_CALL(mocks, Lock(TEST_LOCK_HANDLE));
+		STRICT_EXPECTED_CALL(mocks, Unlock(TEST_LOCK_HANDLE));
 		STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, DynamicLibrary_LoadLibrary(moduleFileName));
@@ -262,6 +315,8 @@ BEGIN_TEST_SUITE(module_loader_unittests)
 		CModuleLoaderMocks mocks;
 		///arrange
 		const char* moduleFileName = TEST_MODULE_LIBRARY_BAD_SYM_NAME;
+		STRICT_EXPECTED_CALL(mocks, Lock(TEST_LOCK_HANDLE));
+		STRICT_EXPECTED_CALL(mocks, Unlock(TEST_LOCK_HANDLE));
 		STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, DynamicLibrary_LoadLibrary(moduleFileName));
@@ -288,6 +343,8 @@ BEGIN_TEST_SUITE(module_loader_unittests)
 		///arrange
 		test_getApi_func_success = false;
 		const char* moduleFileName = TEST_MODULE_LIBRARY_GOOD_NAME;
+		STRICT_EXPECTED_CALL(mocks, Lock(TEST_LOCK_HANDLE));
+		STRICT_EXPECTED_CALL(mocks, Unlock(TEST_LOCK_HANDLE));
 		STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, DynamicLibrary_LoadLibrary(moduleFileName));
@@ -317,11 +374,16 @@ BEGIN_TEST_SUITE(module_loader_unittests)
 		///arrange
 		const char* moduleFileName = TEST_MODULE_LIBRARY_GOOD_NAME;
 		test_getApi_func_success = true;
+		STRICT_EXPECTED_CALL(mocks, Lock(TEST_LOCK_HANDLE));
+		STRICT_EXPECTED_CALL(mocks, Unlock(TEST_LOCK_HANDLE));
 		STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, DynamicLibrary_LoadLibrary(moduleFileName));
 		STRICT_EXPECTED_CALL(mocks, DynamicLibrary_FindSymbol(IGNORED_PTR_ARG, MODULE_GETAPIS_NAME)).IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, test_getApi_func());
+		STRICT_EXPECTED_CALL(mocks, DynamicLibrary_FindSymbol(IGNORED_PTR_ARG, MODULE_GETRECEIVEBATCH_NAME)).IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Lock(TEST_LOCK_HANDLE));
+		STRICT_EXPECTED_CALL(mocks, Unlock(TEST_LOCK_HANDLE));
 
 		///act
 		MODULE_LIBRARY_HANDLE moduleHandle = ModuleLoader_Load(moduleFileName);
@@ -378,6 +440,75 @@ BEGIN_TEST_SUITE(module_loader_unittests)
 
 	}
 
+	/*Tests_SRS_MODULE_LOADER_13_006: [ModuleLoader_GetModuleReceiveBatch shall return NULL if the moduleLibraryHandle is NULL.]*/
+	TEST_FUNCTION(ModuleLoader_GetModuleReceiveBatch_Library_Is_Null)
+	{
+		CModuleLoaderMocks mocks;
+		///arrange
+
+		///act
+		pfModule_ReceiveBatch receiveBatch = ModuleLoader_GetModuleReceiveBatch(NULL);
+
+		///assert
+		ASSERT_IS_NULL((void*)receiveBatch);
+		mocks.AssertActualAndExpectedCalls();
+
+		///cleanup
+	}
+
+	/*Tests_SRS_MODULE_LOADER_13_005: [ModuleLoader_Load shall locate the function defined by MODULE_GETRECEIVEBATCH_NAME in the open library and, if it is present, call it to get the Module_ReceiveBatch of the library.]*/
+	/*Tests_SRS_MODULE_LOADER_13_007: [ModuleLoader_GetModuleReceiveBatch shall return the Module_ReceiveBatch of the library, or NULL if it does not export MODULE_GETRECEIVEBATCH_NAME.]*/
+	TEST_FUNCTION(ModuleLoader_GetModuleReceiveBatch_Returns_The_Exported_ReceiveBatch)
+	{
+		CModuleLoaderMocks mocks;
+		///arrange
+		const char* moduleFileName = TEST_MODULE_LIBRARY_GOOD_NAME;
+		test_has_receive_batch = true;
+		STRICT_EXPECTED_CALL(mocks, Lock(TEST_LOCK_HANDLE));
+		STRICT_EXPECTED_CALL(mocks, Unlock(TEST_LOCK_HANDLE));
+		STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, DynamicLibrary_LoadLibrary(moduleFileName));
+		STRICT_EXPECTED_CALL(mocks, DynamicLibrary_FindSymbol(IGNORED_PTR_ARG, MODULE_GETAPIS_NAME)).IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, test_getApi_func());
+		STRICT_EXPECTED_CALL(mocks, DynamicLibrary_FindSymbol(IGNORED_PTR_ARG, MODULE_GETRECEIVEBATCH_NAME)).IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, test_getReceiveBatch_func());
+		STRICT_EXPECTED_CALL(mocks, Lock(TEST_LOCK_HANDLE));
+		STRICT_EXPECTED_CALL(mocks, Unlock(TEST_LOCK_HANDLE));
+		MODULE_LIBRARY_HANDLE moduleHandle = ModuleLoader_Load(moduleFileName);
+		ASSERT_IS_NOT_NULL(moduleHandle);
+
+		///act
+		pfModule_ReceiveBatch receiveBatch = ModuleLoader_GetModuleReceiveBatch(moduleHandle);
+
+		///assert
+		ASSERT_ARE_EQUAL(void_ptr, TEST_MODULE_RECEIVE_BATCH, (void*)receiveBatch);
+		mocks.AssertActualAndExpectedCalls();
+
+		///cleanup
+		ModuleLoader_Unload(moduleHandle);
+	}
+
+	/*Tests_SRS_MODULE_LOADER_13_007: [ModuleLoader_GetModuleReceiveBatch shall return the Module_ReceiveBatch of the library, or NULL if it does not export MODULE_GETRECEIVEBATCH_NAME.]*/
+	TEST_FUNCTION(ModuleLoader_GetModuleReceiveBatch_Returns_NULL_Without_The_Export)
+	{
+		CModuleLoaderMocks mocks;
+		///arrange
+		MODULE_LIBRARY_HANDLE moduleHandle = ModuleLoader_Load(TEST_MODULE_LIBRARY_GOOD_NAME);
+		ASSERT_IS_NOT_NULL(moduleHandle);
+		mocks.ResetAllCalls();
+
+		///act
+		pfModule_ReceiveBatch receiveBatch = ModuleLoader_GetModuleReceiveBatch(moduleHandle);
+
+		///assert
+		ASSERT_IS_NULL((void*)receiveBatch);
+		mocks.AssertActualAndExpectedCalls();
+
+		///cleanup
+		ModuleLoader_Unload(moduleHandle);
+	}
+
 	/*Tests_SRS_MODULE_LOADER_17_009: [ModuleLoader_Unload shall do nothing if the moduleLibrary  is NULL.]*/
 	TEST_FUNCTION(ModuleLoader_Null_Module)
 	{
@@ -412,6 +543,8 @@ BEGIN_TEST_SUITE(module_loader_unittests)
 		ASSERT_IS_NOT_NULL(moduleHandle);
 		mocks.ResetAllCalls();
 		
+		STRICT_EXPECTED_CALL(mocks, Lock(TEST_LOCK_HANDLE));
+		STRICT_EXPECTED_CALL(mocks, Unlock(TEST_LOCK_HANDLE));
 		STRICT_EXPECTED_CALL(mocks, DynamicLibrary_UnloadLibrary(TEST_MODULE_LIBRARY_GOOD_HANDLE)).IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
 			.IgnoreArgument(1);
@@ -425,4 +558,138 @@ BEGIN_TEST_SUITE(module_loader_unittests)
 		///cleanup
 	}
 
+	/*Tests_SRS_MODULE_LOADER_13_002: [If the library is already loaded, ModuleLoader_Load shall increment its reference count and return its handle without loading the library again.]*/
+	TEST_FUNCTION(ModuleLoader_Load_Same_Library_Twice_Loads_It_Once)
+	{
+		CModuleLoaderMocks mocks;
+
+		///arrange
+		const char* moduleFileName = TEST_MODULE_LIBRARY_GOOD_NAME;
+		test_getApi_func_success = true;
+		MODULE_LIBRARY_HANDLE firstHandle = ModuleLoader_Load(moduleFileName);
+		ASSERT_IS_NOT_NULL(firstHandle);
+		mocks.ResetAllCalls();
+
+		STRICT_EXPECTED_CALL(mocks, Lock(TEST_LOCK_HANDLE));
+		STRICT_EXPECTED_CALL(mocks, Unlock(TEST_LOCK_HANDLE));
+
+		///act
+		MODULE_LIBRARY_HANDLE secondHandle = ModuleLoader_Load(moduleFileName);
+
+		///assert
+		ASSERT_ARE_EQUAL(void_ptr, firstHandle, secondHandle);
+		mocks.AssertActualAndExpectedCalls();
+
+		///cleanup
+		ModuleLoader_Unload(secondHandle);
+		ModuleLoader_Unload(firstHandle);
+	}
+
+	/*Tests_SRS_MODULE_LOADER_13_004: [ModuleLoader_Unload shall decrement the reference count of the library, and shall do nothing else unless it reaches 0.]*/
+	TEST_FUNCTION(ModuleLoader_Unload_Unloads_The_Library_With_Its_Last_Handle)
+	{
+		CModuleLoaderMocks mocks;
+
+		///arrange
+		const char* moduleFileName = TEST_MODULE_LIBRARY_GOOD_NAME;
+		test_getApi_func_success = true;
+		MODULE_LIBRARY_HANDLE firstHandle = ModuleLoader_Load(moduleFileName);
+		MODULE_LIBRARY_HANDLE secondHandle = ModuleLoader_Load(moduleFileName);
+		ASSERT_IS_NOT_NULL(secondHandle);
+		ModuleLoader_Unload(firstHandle);
+		mocks.ResetAllCalls();
+
+		STRICT_EXPECTED_CALL(mocks, Lock(TEST_LOCK_HANDLE));
+		STRICT_EXPECTED_CALL(mocks, Unlock(TEST_LOCK_HANDLE));
+		STRICT_EXPECTED_CALL(mocks, DynamicLibrary_UnloadLibrary(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+
+		///act
+		ModuleLoader_Unload(secondHandle);
+
+		///assert
+		mocks.AssertActualAndExpectedCalls();
+
+		///cleanup
+	}
+
+	/*Tests_SRS_MODULE_LOADER_13_001: [ModuleLoader_Load shall identify the library by the canonical path of moduleLibraryFileName if it is a relative path with a directory, by moduleLibraryFileName if it has no directory, and otherwise by moduleLibraryFileName if a loaded library was loaded with the same moduleLibraryFileName and by its canonical path if not.]*/
+	TEST_FUNCTION(ModuleLoader_Load_Identifies_A_Relative_Name_By_Its_Canonical_Path)
+	{
+		CModuleLoaderMocks mocks;
+
+		///arrange
+		MODULE_LIBRARY_HANDLE firstHandle = ModuleLoader_Load("./.");
+		ASSERT_IS_NOT_NULL(firstHandle);
+		mocks.ResetAllCalls();
+
+		/*only the lookup of the canonical path, the library is not loaded again*/
+		STRICT_EXPECTED_CALL(mocks, Lock(TEST_LOCK_HANDLE));
+		STRICT_EXPECTED_CALL(mocks, Unlock(TEST_LOCK_HANDLE));
+
+		///act
+		MODULE_LIBRARY_HANDLE secondHandle = ModuleLoader_Load("././.");
+
+		///assert
+		ASSERT_ARE_EQUAL(void_ptr, firstHandle, secondHandle);
+		mocks.AssertActualAndExpectedCalls();
+
+		///cleanup
+		ModuleLoader_Unload(secondHandle);
+		ModuleLoader_Unload(firstHandle);
+	}
+
+	/*Tests_SRS_MODULE_LOADER_13_008: [If the lock of the loaded libraries cannot be created or taken, ModuleLoader_Load shall fail and return NULL.]*/
+	TEST_FUNCTION(ModuleLoader_Load_Fails_If_Locking_The_Loaded_Libraries_Fails)
+	{
+		CModuleLoaderMocks mocks;
+
+		///arrange
+		whenShallLock_fail = 1;
+		STRICT_EXPECTED_CALL(mocks, Lock(TEST_LOCK_HANDLE));
+
+		///act
+		MODULE_LIBRARY_HANDLE moduleHandle = ModuleLoader_Load(TEST_MODULE_LIBRARY_GOOD_NAME);
+
+		///assert
+		ASSERT_IS_NULL(moduleHandle);
+		mocks.AssertActualAndExpectedCalls();
+
+		///cleanup
+	}
+
+	/*Tests_SRS_MODULE_LOADER_13_008: [If the lock of the loaded libraries cannot be created or taken, ModuleLoader_Load shall fail and return NULL.]*/
+	TEST_FUNCTION(ModuleLoader_Load_Unloads_Its_Copy_If_Adding_The_Library_Fails)
+	{
+		CModuleLoaderMocks mocks;
+
+		///arrange
+		const char* moduleFileName = TEST_MODULE_LIBRARY_GOOD_NAME;
+		whenShallLock_fail = 2;
+		STRICT_EXPECTED_CALL(mocks, Lock(TEST_LOCK_HANDLE));
+		STRICT_EXPECTED_CALL(mocks, Unlock(TEST_LOCK_HANDLE));
+		STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, DynamicLibrary_LoadLibrary(moduleFileName));
+		STRICT_EXPECTED_CALL(mocks, DynamicLibrary_FindSymbol(IGNORED_PTR_ARG, MODULE_GETAPIS_NAME)).IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, test_getApi_func());
+		STRICT_EXPECTED_CALL(mocks, DynamicLibrary_FindSymbol(IGNORED_PTR_ARG, MODULE_GETRECEIVEBATCH_NAME)).IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Lock(TEST_LOCK_HANDLE));
+		STRICT_EXPECTED_CALL(mocks, DynamicLibrary_UnloadLibrary(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+
+		///act
+		MODULE_LIBRARY_HANDLE moduleHandle = ModuleLoader_Load(moduleFileName);
+
+		///assert
+		ASSERT_IS_NULL(moduleHandle);
+		mocks.AssertActualAndExpectedCalls();
+
+		///cleanup
+	}
+
 END_TEST_SUITE(module_loader_unittests)
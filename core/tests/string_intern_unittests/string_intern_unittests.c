@@ -0,0 +1,397 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+#include "azure_c_shared_utility/lock.h"
+#include "string_intern.h"
+
+static size_t currentmalloc_call;
+static size_t whenShallmalloc_fail;
+static size_t currentfree_call;
+
+static void* my_gballoc_malloc(size_t size)
+{
+    void* result;
+    currentmalloc_call++;
+    if ((whenShallmalloc_fail > 0) && (currentmalloc_call == whenShallmalloc_fail))
+    {
+        result = NULL;
+    }
+    else
+    {
+        result = malloc(size);
+    }
+    return result;
+}
+
+static void* my_gballoc_calloc(size_t nmemb, size_t size)
+{
+    return calloc(nmemb, size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    currentfree_call++;
+    free(ptr);
+}
+
+/*lock is not linked in this test, the table is only used by the thread running the tests*/
+static bool lock_fails;
+
+LOCK_HANDLE Lock_Init(void)
+{
+    return (LOCK_HANDLE)0x42;
+}
+
+LOCK_RESULT Lock(LOCK_HANDLE handle)
+{
+    (void)handle;
+    return lock_fails ? LOCK_ERROR : LOCK_OK;
+}
+
+LOCK_RESULT Unlock(LOCK_HANDLE handle)
+{
+    (void)handle;
+    return LOCK_OK;
+}
+
+LOCK_RESULT Lock_Deinit(LOCK_HANDLE handle)
+{
+    (void)handle;
+    return LOCK_OK;
+}
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#undef ENABLE_MOCKS
+
+#ifdef _MSC_VER
+#pragma warning(disable:4505)
+#endif
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    (void)error_code;
+    ASSERT_FAIL("umock_c reported error");
+}
+
+BEGIN_TEST_SUITE(string_intern_unittests)
+
+    TEST_SUITE_INITIALIZE(TestClassInitialize)
+    {
+        TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        umock_c_init(on_umock_c_error);
+
+        int result = umocktypes_charptr_register_types();
+        ASSERT_ARE_EQUAL(int, 0, result);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_calloc, my_gballoc_calloc);
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+    }
+
+    TEST_SUITE_CLEANUP(TestClassCleanup)
+    {
+        TEST_MUTEX_DESTROY(g_testByTest);
+        TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    }
+
+    TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest) != 0)
+        {
+            ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+        }
+
+        umock_c_reset_all_calls();
+
+        currentmalloc_call = 0;
+        whenShallmalloc_fail = 0;
+        currentfree_call = 0;
+        lock_fails = false;
+    }
+
+    TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+    {
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    /*Tests_SRS_STRING_INTERN_13_001: [If string is NULL then StringIntern_Acquire shall fail and return NULL.]*/
+    TEST_FUNCTION(StringIntern_Acquire_with_NULL_string_fails)
+    {
+        ///arrange
+
+        ///act
+        const char* result = StringIntern_Acquire(NULL);
+
+        ///assert
+        ASSERT_IS_NULL(result);
+        ASSERT_ARE_EQUAL(size_t, 0, currentmalloc_call);
+    }
+
+    /*Tests_SRS_STRING_INTERN_13_002: [StringIntern_Acquire shall allocate the table the first time it is called, and fail and return NULL if that fails.]*/
+    /*Tests_SRS_STRING_INTERN_13_004: [Otherwise, StringIntern_Acquire shall add a copy of string to the table with a single reference and return the copy.]*/
+    TEST_FUNCTION(StringIntern_Acquire_returns_a_copy_of_a_new_string)
+    {
+        ///arrange
+        char string[] = "macAddress";
+
+        ///act
+        const char* result = StringIntern_Acquire(string);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(result);
+        ASSERT_IS_TRUE(result != string);
+        ASSERT_ARE_EQUAL(char_ptr, "macAddress", result);
+        ASSERT_ARE_EQUAL(size_t, 1, currentmalloc_call);
+
+        ///cleanup
+        StringIntern_Release(result);
+    }
+
+    /*Tests_SRS_STRING_INTERN_13_003: [If the table holds a string equal to string, StringIntern_Acquire shall take a reference on it and return it.]*/
+    TEST_FUNCTION(StringIntern_Acquire_returns_the_same_copy_of_equal_strings)
+    {
+        ///arrange
+        char first[] = "source";
+        char second[] = "source";
+        const char* interned = StringIntern_Acquire(first);
+        currentmalloc_call = 0;
+
+        ///act
+        const char* result = StringIntern_Acquire(second);
+
+        ///assert
+        ASSERT_ARE_EQUAL(void_ptr, (void*)interned, (void*)result);
+        ASSERT_ARE_EQUAL(size_t, 0, currentmalloc_call);
+
+        ///cleanup
+        StringIntern_Release(result);
+        StringIntern_Release(interned);
+    }
+
+    /*Tests_SRS_STRING_INTERN_13_004: [Otherwise, StringIntern_Acquire shall add a copy of string to the table with a single reference and return the copy.]*/
+    TEST_FUNCTION(StringIntern_Acquire_returns_different_copies_of_different_strings)
+    {
+        ///arrange
+        const char* source = StringIntern_Acquire("source");
+
+        ///act
+        const char* result = StringIntern_Acquire("sourc");
+
+        ///assert
+        ASSERT_IS_TRUE(result != source);
+        ASSERT_ARE_EQUAL(char_ptr, "sourc", result);
+
+        ///cleanup
+        StringIntern_Release(result);
+        StringIntern_Release(source);
+    }
+
+    /*Tests_SRS_STRING_INTERN_13_005: [If adding the string fails, StringIntern_Acquire shall return NULL.]*/
+    TEST_FUNCTION(StringIntern_Acquire_fails_when_malloc_fails)
+    {
+        ///arrange
+        whenShallmalloc_fail = 1;
+
+        ///act
+        const char* result = StringIntern_Acquire("timestamp");
+
+        ///assert
+        ASSERT_IS_NULL(result);
+        ASSERT_ARE_EQUAL(size_t, 1, currentmalloc_call);
+    }
+
+    /*Tests_SRS_STRING_INTERN_13_011: [StringIntern_Acquire shall lock the shard of the table that holds string, and fail and return NULL if that fails.]*/
+    TEST_FUNCTION(StringIntern_Acquire_fails_when_Lock_fails)
+    {
+        ///arrange
+        const char* interned = StringIntern_Acquire("deviceName");
+        lock_fails = true;
+        currentmalloc_call = 0;
+
+        ///act
+        const char* result = StringIntern_Acquire("deviceName");
+
+        ///assert
+        ASSERT_IS_NULL(result);
+        ASSERT_ARE_EQUAL(size_t, 0, currentmalloc_call);
+
+        ///cleanup
+        lock_fails = false;
+        StringIntern_Release(interned);
+    }
+
+    /*Tests_SRS_STRING_INTERN_13_004: [Otherwise, StringIntern_Acquire shall add a copy of string to the table with a single reference and return the copy.]*/
+    TEST_FUNCTION(StringIntern_Acquire_keeps_many_strings_apart)
+    {
+        ///arrange
+        char strings[1000][8];
+        const char* interned[1000];
+        size_t i;
+        for (i = 0; i < 1000; i++)
+        {
+            (void)sprintf(strings[i], "dev%u", (unsigned int)i);
+            interned[i] = StringIntern_Acquire(strings[i]);
+            ASSERT_IS_NOT_NULL(interned[i]);
+        }
+        currentmalloc_call = 0;
+
+        for (i = 0; i < 1000; i++)
+        {
+            ///act
+            const char* result = StringIntern_Acquire(strings[i]);
+
+            ///assert
+            ASSERT_ARE_EQUAL(void_ptr, (void*)interned[i], (void*)result);
+            ASSERT_ARE_EQUAL(char_ptr, strings[i], result);
+            StringIntern_Release(result);
+        }
+        ASSERT_ARE_EQUAL(size_t, 0, currentmalloc_call);
+
+        ///cleanup
+        for (i = 0; i < 1000; i++)
+        {
+            StringIntern_Release(interned[i]);
+        }
+    }
+
+    /*Tests_SRS_STRING_INTERN_13_006: [If interned is NULL then StringIntern_Release shall do nothing.]*/
+    TEST_FUNCTION(StringIntern_Release_with_NULL_does_nothing)
+    {
+        ///arrange
+
+        ///act
+        StringIntern_Release(NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 0, currentfree_call);
+    }
+
+    /*Tests_SRS_STRING_INTERN_13_007: [StringIntern_Release shall release a reference on interned.]*/
+    TEST_FUNCTION(StringIntern_Release_keeps_a_string_that_is_still_referenced)
+    {
+        ///arrange
+        const char* interned = StringIntern_Acquire("characteristicUUID");
+        (void)StringIntern_Acquire("characteristicUUID");
+        currentmalloc_call = 0;
+
+        ///act
+        StringIntern_Release(interned);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 0, currentfree_call);
+        ASSERT_ARE_EQUAL(void_ptr, (void*)interned, (void*)StringIntern_Acquire("characteristicUUID"));
+        ASSERT_ARE_EQUAL(size_t, 0, currentmalloc_call);
+
+        ///cleanup
+        StringIntern_Release(interned);
+        StringIntern_Release(interned);
+    }
+
+    /*Tests_SRS_STRING_INTERN_13_008: [When the last reference is released, StringIntern_Release shall remove the string from the table and free it.]*/
+    TEST_FUNCTION(StringIntern_Release_frees_the_string_with_the_last_reference)
+    {
+        ///arrange
+        const char* interned = StringIntern_Acquire("bleControllerIndex");
+        (void)StringIntern_Acquire("bleControllerIndex");
+        StringIntern_Release(interned);
+        currentfree_call = 0;
+
+        ///act
+        StringIntern_Release(interned);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 1, currentfree_call);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_STRING_INTERN_13_012: [If StringIntern_Release cannot lock the shard of the table that holds interned, it shall keep the reference, and the string stays in the table.]*/
+    TEST_FUNCTION(StringIntern_Release_keeps_the_string_when_Lock_fails)
+    {
+        ///arrange
+        const char* interned = StringIntern_Acquire("bleGatt");
+        lock_fails = true;
+
+        ///act
+        StringIntern_Release(interned);
+
+        ///assert
+        lock_fails = false;
+        ASSERT_ARE_EQUAL(size_t, 0, currentfree_call);
+        ASSERT_ARE_EQUAL(void_ptr, (void*)interned, (void*)StringIntern_Acquire("bleGatt"));
+
+        ///cleanup
+        StringIntern_Release(interned);
+        StringIntern_Release(interned);
+    }
+
+    /*Tests_SRS_STRING_INTERN_13_008: [When the last reference is released, StringIntern_Release shall remove the string from the table and free it.]*/
+    TEST_FUNCTION(StringIntern_Acquire_adds_again_a_string_that_was_removed)
+    {
+        ///arrange
+        StringIntern_Release(StringIntern_Acquire("bleTelemetry"));
+        currentmalloc_call = 0;
+
+        ///act
+        const char* result = StringIntern_Acquire("bleTelemetry");
+
+        ///assert
+        ASSERT_ARE_EQUAL(char_ptr, "bleTelemetry", result);
+        ASSERT_ARE_EQUAL(size_t, 1, currentmalloc_call);
+
+        ///cleanup
+        StringIntern_Release(result);
+    }
+
+    /*Tests_SRS_STRING_INTERN_13_009: [If string is NULL then StringIntern_Hash shall return 0.]*/
+    TEST_FUNCTION(StringIntern_Hash_with_NULL_string_returns_0)
+    {
+        ///arrange
+
+        ///act
+        size_t result = StringIntern_Hash(NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 0, result);
+    }
+
+    /*Tests_SRS_STRING_INTERN_13_010: [Otherwise, StringIntern_Hash shall return the hash the table uses for string, which is the same for equal strings, interned or not.]*/
+    TEST_FUNCTION(StringIntern_Hash_is_the_same_for_equal_strings)
+    {
+        ///arrange
+        char string[] = "deviceName";
+        const char* interned = StringIntern_Acquire(string);
+
+        ///act
+        size_t result = StringIntern_Hash(string);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, result, StringIntern_Hash(interned));
+        ASSERT_ARE_EQUAL(size_t, result, StringIntern_Hash("deviceName"));
+        ASSERT_ARE_NOT_EQUAL(size_t, result, StringIntern_Hash("deviceKey"));
+
+        ///cleanup
+        StringIntern_Release(interned);
+    }
+
+END_TEST_SUITE(string_intern_unittests)
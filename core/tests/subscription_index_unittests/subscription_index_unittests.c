@@ -0,0 +1,581 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+#include "subscription_index.h"
+
+static size_t currentmalloc_call;
+static size_t whenShallmalloc_fail;
+
+static void* my_gballoc_malloc(size_t size)
+{
+    void* result;
+    currentmalloc_call++;
+    if ((whenShallmalloc_fail > 0) && (currentmalloc_call == whenShallmalloc_fail))
+    {
+        result = NULL;
+    }
+    else
+    {
+        result = malloc(size);
+    }
+    return result;
+}
+
+static void* my_gballoc_realloc(void* ptr, size_t size)
+{
+    void* result;
+    currentmalloc_call++;
+    if ((whenShallmalloc_fail > 0) && (currentmalloc_call == whenShallmalloc_fail))
+    {
+        result = NULL;
+    }
+    else
+    {
+        result = realloc(ptr, size);
+    }
+    return result;
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+/*message is not linked in this test; a MESSAGE_HANDLE is a FAKE_PROPERTIES**/
+typedef struct FAKE_PROPERTIES_TAG
+{
+    const char* const* keys;
+    const char* const* values;
+    size_t count;
+}FAKE_PROPERTIES;
+
+const char* Message_GetProperty(MESSAGE_HANDLE message, const char* name)
+{
+    const FAKE_PROPERTIES* properties = (const FAKE_PROPERTIES*)message;
+    const char* result = NULL;
+    size_t i;
+    for (i = 0; i < properties->count; i++)
+    {
+        if (strcmp(properties->keys[i], name) == 0)
+        {
+            result = properties->values[i];
+            break;
+        }
+    }
+    return result;
+}
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#undef ENABLE_MOCKS
+
+#ifdef _MSC_VER
+#pragma warning(disable:4505)
+#endif
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    ASSERT_FAIL("umock_c reported error");
+}
+
+static const char* ble_sources[] = { "bleTelemetry" };
+static const char* mac_addresses[] = { "01:01:01:01:01:01", "02:02:02:02:02:02" };
+
+/*source == "bleTelemetry" && macAddress in {01:..., 02:...}*/
+static const MESSAGE_BUS_FILTER_CONDITION ble_conditions[] =
+{
+    { "source", ble_sources, 1 },
+    { "macAddress", mac_addresses, 2 }
+};
+static const MESSAGE_BUS_FILTER ble_filter = { ble_conditions, 2 };
+
+/*source == "bleTelemetry"*/
+static const MESSAGE_BUS_FILTER source_filter = { ble_conditions, 1 };
+
+static void match(SUBSCRIPTION_INDEX_HANDLE index, const char* source, const char* mac_address, size_t* matches)
+{
+    const char* keys[] = { "source", "macAddress" };
+    const char* values[] = { source, mac_address };
+    FAKE_PROPERTIES properties = { keys, values, (mac_address == NULL) ? 1 : 2 };
+    SubscriptionIndex_Match(index, (MESSAGE_HANDLE)&properties, matches);
+}
+
+BEGIN_TEST_SUITE(subscription_index_unittests)
+
+    TEST_SUITE_INITIALIZE(TestClassInitialize)
+    {
+        TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        umock_c_init(on_umock_c_error);
+
+        int result = umocktypes_charptr_register_types();
+        ASSERT_ARE_EQUAL(int, 0, result);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_realloc, my_gballoc_realloc);
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+    }
+
+    TEST_SUITE_CLEANUP(TestClassCleanup)
+    {
+        TEST_MUTEX_DESTROY(g_testByTest);
+        TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    }
+
+    TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest) != 0)
+        {
+            ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+        }
+
+        umock_c_reset_all_calls();
+
+        currentmalloc_call = 0;
+        whenShallmalloc_fail = 0;
+    }
+
+    TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+    {
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_001: [SubscriptionIndex_Create shall allocate a new SUBSCRIPTION_INDEX_HANDLE_DATA and return NULL if it fails.]*/
+    TEST_FUNCTION(SubscriptionIndex_Create_fails_when_malloc_fails)
+    {
+        ///arrange
+        whenShallmalloc_fail = 1;
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        SUBSCRIPTION_INDEX_HANDLE index = SubscriptionIndex_Create();
+
+        ///assert
+        ASSERT_IS_NULL(index);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_002: [SubscriptionIndex_Create shall allocate a hash table of 16 empty buckets and return NULL if it fails.]*/
+    TEST_FUNCTION(SubscriptionIndex_Create_fails_when_buckets_malloc_fails)
+    {
+        ///arrange
+        whenShallmalloc_fail = 2;
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        SUBSCRIPTION_INDEX_HANDLE index = SubscriptionIndex_Create();
+
+        ///assert
+        ASSERT_IS_NULL(index);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_002: [SubscriptionIndex_Create shall allocate a hash table of 16 empty buckets and return NULL if it fails.]*/
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_013: [SubscriptionIndex_GetSlotCount shall return the number of slots of the index, or 0 if handle is NULL.]*/
+    TEST_FUNCTION(SubscriptionIndex_Create_succeeds)
+    {
+        ///arrange
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(gballoc_malloc(16 * sizeof(void*)));
+
+        ///act
+        SUBSCRIPTION_INDEX_HANDLE index = SubscriptionIndex_Create();
+
+        ///assert
+        ASSERT_IS_NOT_NULL(index);
+        ASSERT_ARE_EQUAL(size_t, 0, SubscriptionIndex_GetSlotCount(index));
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+        ///cleanup
+        SubscriptionIndex_Destroy(index);
+    }
+
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_003: [If handle is NULL, SubscriptionIndex_Destroy shall do nothing.]*/
+    TEST_FUNCTION(SubscriptionIndex_Destroy_does_nothing_with_null_handle)
+    {
+        ///act
+        SubscriptionIndex_Destroy(NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_005: [If handle, filter or slot is NULL, SubscriptionIndex_Add shall return SUBSCRIPTION_INDEX_INVALIDARG.]*/
+    TEST_FUNCTION(SubscriptionIndex_Add_fails_with_null_args)
+    {
+        ///arrange
+        SUBSCRIPTION_INDEX_HANDLE index = SubscriptionIndex_Create();
+        size_t slot;
+
+        ///act
+        SUBSCRIPTION_INDEX_RESULT result1 = SubscriptionIndex_Add(NULL, &ble_filter, &slot);
+        SUBSCRIPTION_INDEX_RESULT result2 = SubscriptionIndex_Add(index, NULL, &slot);
+        SUBSCRIPTION_INDEX_RESULT result3 = SubscriptionIndex_Add(index, &ble_filter, NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, SUBSCRIPTION_INDEX_INVALIDARG, result1);
+        ASSERT_ARE_EQUAL(int, SUBSCRIPTION_INDEX_INVALIDARG, result2);
+        ASSERT_ARE_EQUAL(int, SUBSCRIPTION_INDEX_INVALIDARG, result3);
+        ASSERT_ARE_EQUAL(size_t, 0, SubscriptionIndex_GetSlotCount(index));
+
+        ///cleanup
+        SubscriptionIndex_Destroy(index);
+    }
+
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_006: [If filter has no conditions, or a condition has a NULL property or no values or a NULL value, SubscriptionIndex_Add shall return SUBSCRIPTION_INDEX_INVALIDARG.]*/
+    TEST_FUNCTION(SubscriptionIndex_Add_fails_with_invalid_filter)
+    {
+        ///arrange
+        SUBSCRIPTION_INDEX_HANDLE index = SubscriptionIndex_Create();
+        const char* null_values[] = { NULL };
+        MESSAGE_BUS_FILTER_CONDITION no_values = { "source", ble_sources, 0 };
+        MESSAGE_BUS_FILTER_CONDITION null_value = { "source", null_values, 1 };
+        MESSAGE_BUS_FILTER_CONDITION null_property = { NULL, ble_sources, 1 };
+        MESSAGE_BUS_FILTER no_conditions = { ble_conditions, 0 };
+        MESSAGE_BUS_FILTER no_values_filter = { &no_values, 1 };
+        MESSAGE_BUS_FILTER null_value_filter = { &null_value, 1 };
+        MESSAGE_BUS_FILTER null_property_filter = { &null_property, 1 };
+        size_t slot;
+
+        ///act
+        SUBSCRIPTION_INDEX_RESULT result1 = SubscriptionIndex_Add(index, &no_conditions, &slot);
+        SUBSCRIPTION_INDEX_RESULT result2 = SubscriptionIndex_Add(index, &no_values_filter, &slot);
+        SUBSCRIPTION_INDEX_RESULT result3 = SubscriptionIndex_Add(index, &null_value_filter, &slot);
+        SUBSCRIPTION_INDEX_RESULT result4 = SubscriptionIndex_Add(index, &null_property_filter, &slot);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, SUBSCRIPTION_INDEX_INVALIDARG, result1);
+        ASSERT_ARE_EQUAL(int, SUBSCRIPTION_INDEX_INVALIDARG, result2);
+        ASSERT_ARE_EQUAL(int, SUBSCRIPTION_INDEX_INVALIDARG, result3);
+        ASSERT_ARE_EQUAL(int, SUBSCRIPTION_INDEX_INVALIDARG, result4);
+
+        ///cleanup
+        SubscriptionIndex_Destroy(index);
+    }
+
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_007: [SubscriptionIndex_Add shall use the first slot that is not in use, or a new slot if all of them are.]*/
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_010: [SubscriptionIndex_Add shall store the slot in slot and return SUBSCRIPTION_INDEX_OK.]*/
+    TEST_FUNCTION(SubscriptionIndex_Add_assigns_consecutive_slots)
+    {
+        ///arrange
+        SUBSCRIPTION_INDEX_HANDLE index = SubscriptionIndex_Create();
+        size_t slot0, slot1;
+
+        ///act
+        SUBSCRIPTION_INDEX_RESULT result1 = SubscriptionIndex_Add(index, &ble_filter, &slot0);
+        SUBSCRIPTION_INDEX_RESULT result2 = SubscriptionIndex_Add(index, &source_filter, &slot1);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, SUBSCRIPTION_INDEX_OK, result1);
+        ASSERT_ARE_EQUAL(int, SUBSCRIPTION_INDEX_OK, result2);
+        ASSERT_ARE_EQUAL(size_t, 0, slot0);
+        ASSERT_ARE_EQUAL(size_t, 1, slot1);
+        ASSERT_ARE_EQUAL(size_t, 2, SubscriptionIndex_GetSlotCount(index));
+
+        ///cleanup
+        SubscriptionIndex_Destroy(index);
+    }
+
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_009: [If any allocation fails, SubscriptionIndex_Add shall remove what it added to the index and return SUBSCRIPTION_INDEX_ERROR.]*/
+    TEST_FUNCTION(SubscriptionIndex_Add_leaves_index_unchanged_when_malloc_fails)
+    {
+        ///arrange
+        SUBSCRIPTION_INDEX_HANDLE index = SubscriptionIndex_Create();
+        size_t slot, matches[2];
+        size_t fail_at;
+        SUBSCRIPTION_INDEX_RESULT result = SUBSCRIPTION_INDEX_ERROR;
+        (void)SubscriptionIndex_Add(index, &source_filter, &slot);
+
+        ///act
+        for (fail_at = 1; result != SUBSCRIPTION_INDEX_OK; fail_at++)
+        {
+            currentmalloc_call = 0;
+            whenShallmalloc_fail = fail_at;
+            result = SubscriptionIndex_Add(index, &ble_filter, &slot);
+
+            ///assert
+            if (result != SUBSCRIPTION_INDEX_OK)
+            {
+                ASSERT_ARE_EQUAL(int, SUBSCRIPTION_INDEX_ERROR, result);
+                match(index, "bleTelemetry", "01:01:01:01:01:01", matches);
+                ASSERT_ARE_NOT_EQUAL(size_t, 0, matches[0]);
+            }
+        }
+        whenShallmalloc_fail = 0;
+
+        match(index, "bleTelemetry", "01:01:01:01:01:01", matches);
+        ASSERT_ARE_EQUAL(size_t, 1, slot);
+        ASSERT_ARE_NOT_EQUAL(size_t, 0, matches[0]);
+        ASSERT_ARE_NOT_EQUAL(size_t, 0, matches[1]);
+
+        ///cleanup
+        SubscriptionIndex_Destroy(index);
+    }
+
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_014: [If handle or matches is NULL, SubscriptionIndex_Match shall do nothing.]*/
+    TEST_FUNCTION(SubscriptionIndex_Match_does_nothing_with_null_args)
+    {
+        ///arrange
+        size_t matches[1] = { 42 };
+
+        ///act
+        SubscriptionIndex_Match(NULL, NULL, matches);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 42, matches[0]);
+    }
+
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_015: [SubscriptionIndex_Match shall look up the value of every indexed property name in the properties of message with Message_GetProperty and count, for each slot, the conditions accepting that value.]*/
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_016: [SubscriptionIndex_Match shall set matches[slot] to 1 for every slot in use whose conditions are all satisfied and to 0 for every other slot.]*/
+    TEST_FUNCTION(SubscriptionIndex_Match_requires_every_condition)
+    {
+        ///arrange
+        SUBSCRIPTION_INDEX_HANDLE index = SubscriptionIndex_Create();
+        size_t ble_slot, source_slot;
+        size_t both[2], source_only[2], other_mac[2], other_source[2];
+        (void)SubscriptionIndex_Add(index, &ble_filter, &ble_slot);
+        (void)SubscriptionIndex_Add(index, &source_filter, &source_slot);
+
+        ///act
+        match(index, "bleTelemetry", "02:02:02:02:02:02", both);
+        match(index, "bleTelemetry", NULL, source_only);
+        match(index, "bleTelemetry", "03:03:03:03:03:03", other_mac);
+        match(index, "iothub", "01:01:01:01:01:01", other_source);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 1, both[ble_slot]);
+        ASSERT_ARE_EQUAL(size_t, 1, both[source_slot]);
+        ASSERT_ARE_EQUAL(size_t, 0, source_only[ble_slot]);
+        ASSERT_ARE_EQUAL(size_t, 1, source_only[source_slot]);
+        ASSERT_ARE_EQUAL(size_t, 0, other_mac[ble_slot]);
+        ASSERT_ARE_EQUAL(size_t, 1, other_mac[source_slot]);
+        ASSERT_ARE_EQUAL(size_t, 0, other_source[ble_slot]);
+        ASSERT_ARE_EQUAL(size_t, 0, other_source[source_slot]);
+
+        ///cleanup
+        SubscriptionIndex_Destroy(index);
+    }
+
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_016: [SubscriptionIndex_Match shall set matches[slot] to 1 for every slot in use whose conditions are all satisfied and to 0 for every other slot.]*/
+    TEST_FUNCTION(SubscriptionIndex_Match_with_null_message_matches_nothing)
+    {
+        ///arrange
+        SUBSCRIPTION_INDEX_HANDLE index = SubscriptionIndex_Create();
+        size_t slot, matches[1];
+        (void)SubscriptionIndex_Add(index, &source_filter, &slot);
+
+        ///act
+        SubscriptionIndex_Match(index, NULL, matches);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 0, matches[0]);
+
+        ///cleanup
+        SubscriptionIndex_Destroy(index);
+    }
+
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_008: [SubscriptionIndex_Add shall record the slot and condition under the (property, value) key of every value of every condition of filter.]*/
+    TEST_FUNCTION(SubscriptionIndex_Match_ignores_duplicate_values)
+    {
+        ///arrange
+        SUBSCRIPTION_INDEX_HANDLE index = SubscriptionIndex_Create();
+        const char* duplicates[] = { "bleTelemetry", "bleTelemetry" };
+        MESSAGE_BUS_FILTER_CONDITION conditions[] =
+        {
+            { "source", duplicates, 2 },
+            { "macAddress", mac_addresses, 2 }
+        };
+        MESSAGE_BUS_FILTER filter = { conditions, 2 };
+        size_t slot, matches[1];
+        (void)SubscriptionIndex_Add(index, &filter, &slot);
+
+        ///act
+        match(index, "bleTelemetry", NULL, matches);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 0, matches[0]);
+
+        ///cleanup
+        SubscriptionIndex_Destroy(index);
+    }
+
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_008: [SubscriptionIndex_Add shall record the slot and condition under the (property, value) key of every value of every condition of filter.]*/
+    TEST_FUNCTION(SubscriptionIndex_Match_with_many_filters_matches_each_once)
+    {
+        ///arrange
+        SUBSCRIPTION_INDEX_HANDLE index = SubscriptionIndex_Create();
+        char names[100][8];
+        const char* values[100];
+        MESSAGE_BUS_FILTER_CONDITION conditions[100];
+        MESSAGE_BUS_FILTER filters[100];
+        size_t slots[100], matches[100];
+        size_t i, j;
+        for (i = 0; i < 100; i++)
+        {
+            (void)sprintf(names[i], "dev%u", (unsigned int)i);
+            values[i] = names[i];
+            conditions[i].property = "source";
+            conditions[i].values = &values[i];
+            conditions[i].value_count = 1;
+            filters[i].conditions = &conditions[i];
+            filters[i].condition_count = 1;
+            ASSERT_ARE_EQUAL(int, SUBSCRIPTION_INDEX_OK, SubscriptionIndex_Add(index, &filters[i], &slots[i]));
+        }
+
+        for (i = 0; i < 100; i++)
+        {
+            ///act
+            match(index, names[i], NULL, matches);
+
+            ///assert
+            for (j = 0; j < 100; j++)
+            {
+                ASSERT_ARE_EQUAL(size_t, (i == j) ? 1 : 0, matches[slots[j]]);
+            }
+        }
+
+        ///cleanup
+        SubscriptionIndex_Destroy(index);
+    }
+
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_011: [If handle is NULL or slot is not in use, SubscriptionIndex_Remove shall do nothing.]*/
+    TEST_FUNCTION(SubscriptionIndex_Remove_does_nothing_with_unused_slot)
+    {
+        ///arrange
+        SUBSCRIPTION_INDEX_HANDLE index = SubscriptionIndex_Create();
+        size_t slot, matches[1];
+        (void)SubscriptionIndex_Add(index, &source_filter, &slot);
+
+        ///act
+        SubscriptionIndex_Remove(NULL, slot);
+        SubscriptionIndex_Remove(index, slot + 1);
+
+        ///assert
+        match(index, "bleTelemetry", NULL, matches);
+        ASSERT_ARE_EQUAL(size_t, 1, matches[slot]);
+
+        ///cleanup
+        SubscriptionIndex_Destroy(index);
+    }
+
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_007: [SubscriptionIndex_Add shall use the first slot that is not in use, or a new slot if all of them are.]*/
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_012: [SubscriptionIndex_Remove shall remove every entry of slot from the index, free the nodes and property names no longer used and mark slot as not in use.]*/
+    TEST_FUNCTION(SubscriptionIndex_Remove_stops_matching_and_frees_the_slot)
+    {
+        ///arrange
+        SUBSCRIPTION_INDEX_HANDLE index = SubscriptionIndex_Create();
+        size_t ble_slot, source_slot, new_slot, matches[2];
+        (void)SubscriptionIndex_Add(index, &ble_filter, &ble_slot);
+        (void)SubscriptionIndex_Add(index, &source_filter, &source_slot);
+
+        ///act
+        SubscriptionIndex_Remove(index, ble_slot);
+
+        ///assert
+        match(index, "bleTelemetry", "01:01:01:01:01:01", matches);
+        ASSERT_ARE_EQUAL(size_t, 0, matches[ble_slot]);
+        ASSERT_ARE_EQUAL(size_t, 1, matches[source_slot]);
+
+        ASSERT_ARE_EQUAL(int, SUBSCRIPTION_INDEX_OK, SubscriptionIndex_Add(index, &ble_filter, &new_slot));
+        ASSERT_ARE_EQUAL(size_t, ble_slot, new_slot);
+        ASSERT_ARE_EQUAL(size_t, 2, SubscriptionIndex_GetSlotCount(index));
+
+        ///cleanup
+        SubscriptionIndex_Destroy(index);
+    }
+
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_017: [If handle is NULL, SubscriptionIndex_Clone shall return NULL.]*/
+    TEST_FUNCTION(SubscriptionIndex_Clone_fails_with_null_handle)
+    {
+        ///act
+        SUBSCRIPTION_INDEX_HANDLE clone = SubscriptionIndex_Clone(NULL);
+
+        ///assert
+        ASSERT_IS_NULL(clone);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    }
+
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_018: [SubscriptionIndex_Clone shall create a new index with the same slots, filters and number of buckets as handle.]*/
+    TEST_FUNCTION(SubscriptionIndex_Clone_matches_like_the_original_and_is_independent)
+    {
+        ///arrange
+        SUBSCRIPTION_INDEX_HANDLE index = SubscriptionIndex_Create();
+        size_t ble_slot, source_slot, matches[2];
+        (void)SubscriptionIndex_Add(index, &ble_filter, &ble_slot);
+        (void)SubscriptionIndex_Add(index, &source_filter, &source_slot);
+
+        ///act
+        SUBSCRIPTION_INDEX_HANDLE clone = SubscriptionIndex_Clone(index);
+        SubscriptionIndex_Remove(index, ble_slot);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(clone);
+        ASSERT_ARE_EQUAL(size_t, 2, SubscriptionIndex_GetSlotCount(clone));
+        match(clone, "bleTelemetry", "01:01:01:01:01:01", matches);
+        ASSERT_ARE_EQUAL(size_t, 1, matches[ble_slot]);
+        ASSERT_ARE_EQUAL(size_t, 1, matches[source_slot]);
+        match(index, "bleTelemetry", "01:01:01:01:01:01", matches);
+        ASSERT_ARE_EQUAL(size_t, 0, matches[ble_slot]);
+        ASSERT_ARE_EQUAL(size_t, 1, matches[source_slot]);
+
+        ///cleanup
+        SubscriptionIndex_Destroy(clone);
+        SubscriptionIndex_Destroy(index);
+    }
+
+    /*Tests_SRS_SUBSCRIPTION_INDEX_13_019: [If any allocation fails, SubscriptionIndex_Clone shall free what it allocated and return NULL.]*/
+    TEST_FUNCTION(SubscriptionIndex_Clone_fails_when_malloc_fails)
+    {
+        ///arrange
+        SUBSCRIPTION_INDEX_HANDLE index = SubscriptionIndex_Create();
+        SUBSCRIPTION_INDEX_HANDLE clone = NULL;
+        size_t slot, fail_at, matches[1];
+        (void)SubscriptionIndex_Add(index, &ble_filter, &slot);
+
+        ///act
+        for (fail_at = 1; clone == NULL; fail_at++)
+        {
+            currentmalloc_call = 0;
+            whenShallmalloc_fail = fail_at;
+            clone = SubscriptionIndex_Clone(index);
+        }
+        whenShallmalloc_fail = 0;
+
+        ///assert
+        match(clone, "bleTelemetry", "01:01:01:01:01:01", matches);
+        ASSERT_ARE_EQUAL(size_t, 1, matches[slot]);
+
+        ///cleanup
+        SubscriptionIndex_Destroy(clone);
+        SubscriptionIndex_Destroy(index);
+    }
+
+END_TEST_SUITE(subscription_index_unittests)
@@ -0,0 +1,491 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#ifdef _CRTDBG_MAP_ALLOC
+#include <crtdbg.h>
+#endif
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "worker_pool.h"
+
+static size_t currentmalloc_call;
+static size_t whenShallmalloc_fail;
+static size_t currentfree_call;
+
+static void* my_gballoc_malloc(size_t size)
+{
+    void* result;
+    currentmalloc_call++;
+    if ((whenShallmalloc_fail > 0) && (currentmalloc_call == whenShallmalloc_fail))
+    {
+        result = NULL;
+    }
+    else
+    {
+        result = malloc(size);
+    }
+    return result;
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    currentfree_call++;
+    free(ptr);
+}
+
+/*lock, condition and threadapi are not linked in this test; no thread is ever started, the tests run the thread function themselves*/
+static bool lock_fails;
+
+LOCK_HANDLE Lock_Init(void)
+{
+    return (LOCK_HANDLE)0x42;
+}
+
+LOCK_RESULT Lock(LOCK_HANDLE handle)
+{
+    (void)handle;
+    return lock_fails ? LOCK_ERROR : LOCK_OK;
+}
+
+LOCK_RESULT Unlock(LOCK_HANDLE handle)
+{
+    (void)handle;
+    return LOCK_OK;
+}
+
+LOCK_RESULT Lock_Deinit(LOCK_HANDLE handle)
+{
+    (void)handle;
+    return LOCK_OK;
+}
+
+COND_HANDLE Condition_Init(void)
+{
+    return (COND_HANDLE)0x43;
+}
+
+COND_RESULT Condition_Post(COND_HANDLE handle)
+{
+    (void)handle;
+    return COND_OK;
+}
+
+/*a thread waiting for tasks has run all of them; make it bail out*/
+COND_RESULT Condition_Wait(COND_HANDLE handle, LOCK_HANDLE lock, int timeout_milliseconds)
+{
+    (void)handle;
+    (void)lock;
+    (void)timeout_milliseconds;
+    return COND_ERROR;
+}
+
+void Condition_Deinit(COND_HANDLE handle)
+{
+    (void)handle;
+}
+
+static size_t currentThreadAPI_Create_call;
+static size_t whenShallThreadAPI_Create_fail;
+static size_t currentThreadAPI_Join_call;
+static THREAD_START_FUNC last_thread_function;
+static void* last_thread_argument;
+
+THREADAPI_RESULT ThreadAPI_Create(THREAD_HANDLE* threadHandle, THREAD_START_FUNC func, void* arg)
+{
+    THREADAPI_RESULT result;
+    currentThreadAPI_Create_call++;
+    if ((whenShallThreadAPI_Create_fail > 0) && (currentThreadAPI_Create_call == whenShallThreadAPI_Create_fail))
+    {
+        result = THREADAPI_ERROR;
+    }
+    else
+    {
+        *threadHandle = (THREAD_HANDLE)(size_t)currentThreadAPI_Create_call;
+        last_thread_function = func;
+        last_thread_argument = arg;
+        result = THREADAPI_OK;
+    }
+    return result;
+}
+
+THREADAPI_RESULT ThreadAPI_Join(THREAD_HANDLE threadHandle, int* res)
+{
+    (void)threadHandle;
+    currentThreadAPI_Join_call++;
+    *res = 0;
+    return THREADAPI_OK;
+}
+
+static size_t thread_exit_count;
+
+static void on_thread_exit(void)
+{
+    thread_exit_count++;
+}
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#undef ENABLE_MOCKS
+
+#ifdef _MSC_VER
+#pragma warning(disable:4505)
+#endif
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    ASSERT_FAIL("umock_c reported error");
+}
+
+/*every task appends its number to 'ran'*/
+static int ran[8];
+static size_t ran_count;
+
+static void record_task(void* context)
+{
+    ran[ran_count++] = *(const int*)context;
+}
+
+static const int task_numbers[] = { 1, 2, 3 };
+
+static void init_task(WORKER_POOL_TASK* task, size_t i)
+{
+    task->function = record_task;
+    task->context = (void*)&task_numbers[i];
+    task->next = NULL;
+}
+
+BEGIN_TEST_SUITE(worker_pool_unittests)
+
+    TEST_SUITE_INITIALIZE(TestClassInitialize)
+    {
+        TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+        g_testByTest = TEST_MUTEX_CREATE();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+
+        umock_c_init(on_umock_c_error);
+
+        int result = umocktypes_charptr_register_types();
+        ASSERT_ARE_EQUAL(int, 0, result);
+
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+        REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+    }
+
+    TEST_SUITE_CLEANUP(TestClassCleanup)
+    {
+        TEST_MUTEX_DESTROY(g_testByTest);
+        TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    }
+
+    TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+    {
+        if (TEST_MUTEX_ACQUIRE(g_testByTest) != 0)
+        {
+            ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+        }
+
+        umock_c_reset_all_calls();
+
+        currentmalloc_call = 0;
+        whenShallmalloc_fail = 0;
+        currentfree_call = 0;
+        lock_fails = false;
+
+        currentThreadAPI_Create_call = 0;
+        whenShallThreadAPI_Create_fail = 0;
+        currentThreadAPI_Join_call = 0;
+        last_thread_function = NULL;
+        last_thread_argument = NULL;
+        thread_exit_count = 0;
+
+        ran_count = 0;
+    }
+
+    TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+    {
+        TEST_MUTEX_RELEASE(g_testByTest);
+    }
+
+    /*Tests_SRS_WORKER_POOL_13_001: [WorkerPool_Create shall allocate a new WORKER_POOL_HANDLE_DATA and return NULL if it fails.]*/
+    TEST_FUNCTION(WorkerPool_Create_fails_when_malloc_fails)
+    {
+        ///arrange
+        whenShallmalloc_fail = 1;
+
+        ///act
+        WORKER_POOL_HANDLE pool = WorkerPool_Create(2);
+
+        ///assert
+        ASSERT_IS_NULL(pool);
+        ASSERT_ARE_EQUAL(int, 0, (int)currentThreadAPI_Create_call);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_WORKER_POOL_13_003: [If creating the lock, the condition or the array of threads fails, WorkerPool_Create shall free what it created and return NULL.]*/
+    TEST_FUNCTION(WorkerPool_Create_fails_when_allocating_the_threads_fails)
+    {
+        ///arrange
+        whenShallmalloc_fail = 2;
+
+        ///act
+        WORKER_POOL_HANDLE pool = WorkerPool_Create(2);
+
+        ///assert
+        ASSERT_IS_NULL(pool);
+        ASSERT_ARE_EQUAL(int, 0, (int)currentThreadAPI_Create_call);
+        ASSERT_ARE_EQUAL(int, 1, (int)currentfree_call);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_WORKER_POOL_13_004: [WorkerPool_Create shall start thread_count threads by calling ThreadAPI_Create.]*/
+    /*Tests_SRS_WORKER_POOL_13_013: [WorkerPool_GetThreadCount shall return the number of threads of the pool, or 0 if handle is NULL.]*/
+    TEST_FUNCTION(WorkerPool_Create_starts_thread_count_threads)
+    {
+        ///arrange
+
+        ///act
+        WORKER_POOL_HANDLE pool = WorkerPool_Create(3);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(pool);
+        ASSERT_ARE_EQUAL(int, 3, (int)currentThreadAPI_Create_call);
+        ASSERT_ARE_EQUAL(int, 3, (int)WorkerPool_GetThreadCount(pool));
+
+        ///cleanup
+        WorkerPool_Destroy(pool);
+    }
+
+    /*Tests_SRS_WORKER_POOL_13_002: [If thread_count is 0, WorkerPool_Create shall create one thread per processor.]*/
+    TEST_FUNCTION(WorkerPool_Create_with_0_threads_starts_at_least_one_thread)
+    {
+        ///arrange
+
+        ///act
+        WORKER_POOL_HANDLE pool = WorkerPool_Create(0);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(pool);
+        ASSERT_IS_TRUE(WorkerPool_GetThreadCount(pool) >= 1);
+        ASSERT_ARE_EQUAL(int, (int)WorkerPool_GetThreadCount(pool), (int)currentThreadAPI_Create_call);
+
+        ///cleanup
+        WorkerPool_Destroy(pool);
+    }
+
+    /*Tests_SRS_WORKER_POOL_13_005: [If starting a thread fails, WorkerPool_Create shall stop the threads it started, free what it created and return NULL.]*/
+    TEST_FUNCTION(WorkerPool_Create_joins_the_started_threads_when_a_thread_fails_to_start)
+    {
+        ///arrange
+        whenShallThreadAPI_Create_fail = 3;
+
+        ///act
+        WORKER_POOL_HANDLE pool = WorkerPool_Create(4);
+
+        ///assert
+        ASSERT_IS_NULL(pool);
+        ASSERT_ARE_EQUAL(int, 2, (int)currentThreadAPI_Join_call);
+        ASSERT_ARE_EQUAL(int, (int)currentmalloc_call, (int)currentfree_call);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_WORKER_POOL_13_006: [If handle is NULL, WorkerPool_Destroy shall do nothing.]*/
+    TEST_FUNCTION(WorkerPool_Destroy_does_nothing_with_NULL_handle)
+    {
+        ///arrange
+
+        ///act
+        WorkerPool_Destroy(NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, 0, (int)currentfree_call);
+        ASSERT_ARE_EQUAL(int, 0, (int)currentThreadAPI_Join_call);
+    }
+
+    /*Tests_SRS_WORKER_POOL_13_007: [WorkerPool_Destroy shall signal the threads to stop, join them and free the pool. Tasks that are still scheduled shall not be run.]*/
+    TEST_FUNCTION(WorkerPool_Destroy_joins_the_threads_and_frees_the_pool)
+    {
+        ///arrange
+        WORKER_POOL_TASK task;
+        WORKER_POOL_HANDLE pool = WorkerPool_Create(2);
+        init_task(&task, 0);
+        (void)WorkerPool_Schedule(pool, &task);
+
+        ///act
+        WorkerPool_Destroy(pool);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, 2, (int)currentThreadAPI_Join_call);
+        ASSERT_ARE_EQUAL(int, (int)currentmalloc_call, (int)currentfree_call);
+        ASSERT_ARE_EQUAL(int, 0, (int)ran_count);
+    }
+
+    /*Tests_SRS_WORKER_POOL_13_010: [If handle, task or task->function is NULL, WorkerPool_Schedule shall return WORKER_POOL_INVALIDARG.]*/
+    TEST_FUNCTION(WorkerPool_Schedule_fails_with_NULL_arguments)
+    {
+        ///arrange
+        WORKER_POOL_TASK task;
+        WORKER_POOL_HANDLE pool = WorkerPool_Create(1);
+        init_task(&task, 0);
+
+        ///act
+        WORKER_POOL_RESULT result1 = WorkerPool_Schedule(NULL, &task);
+        WORKER_POOL_RESULT result2 = WorkerPool_Schedule(pool, NULL);
+        task.function = NULL;
+        WORKER_POOL_RESULT result3 = WorkerPool_Schedule(pool, &task);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, (int)WORKER_POOL_INVALIDARG, (int)result1);
+        ASSERT_ARE_EQUAL(int, (int)WORKER_POOL_INVALIDARG, (int)result2);
+        ASSERT_ARE_EQUAL(int, (int)WORKER_POOL_INVALIDARG, (int)result3);
+
+        ///cleanup
+        WorkerPool_Destroy(pool);
+    }
+
+    /*Tests_SRS_WORKER_POOL_13_012: [If locking fails, WorkerPool_Schedule shall return WORKER_POOL_ERROR.]*/
+    TEST_FUNCTION(WorkerPool_Schedule_fails_when_Lock_fails)
+    {
+        ///arrange
+        WORKER_POOL_TASK task;
+        WORKER_POOL_HANDLE pool = WorkerPool_Create(1);
+        init_task(&task, 0);
+        lock_fails = true;
+
+        ///act
+        WORKER_POOL_RESULT result = WorkerPool_Schedule(pool, &task);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, (int)WORKER_POOL_ERROR, (int)result);
+
+        ///cleanup
+        lock_fails = false;
+        WorkerPool_Destroy(pool);
+    }
+
+    /*Tests_SRS_WORKER_POOL_13_008: [Every thread of the pool shall run the scheduled tasks one at a time, oldest first, until the pool is destroyed.]*/
+    /*Tests_SRS_WORKER_POOL_13_011: [WorkerPool_Schedule shall append task to the scheduled tasks, signal one thread and return WORKER_POOL_OK.]*/
+    /*Tests_SRS_WORKER_POOL_13_018: [WorkerPool_Create shall create the pool the same way as WorkerPool_CreateWithThreadExit with a NULL on_thread_exit.]*/
+    TEST_FUNCTION(WorkerPool_thread_runs_the_scheduled_tasks_oldest_first)
+    {
+        ///arrange
+        WORKER_POOL_TASK tasks[3];
+        size_t i;
+        WORKER_POOL_HANDLE pool = WorkerPool_Create(1);
+        for (i = 0; i < 3; i++)
+        {
+            init_task(&tasks[i], i);
+            ASSERT_ARE_EQUAL(int, (int)WORKER_POOL_OK, (int)WorkerPool_Schedule(pool, &tasks[i]));
+        }
+
+        ///act
+        (void)last_thread_function(last_thread_argument);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, 3, (int)ran_count);
+        ASSERT_ARE_EQUAL(int, 1, ran[0]);
+        ASSERT_ARE_EQUAL(int, 2, ran[1]);
+        ASSERT_ARE_EQUAL(int, 3, ran[2]);
+        ASSERT_ARE_EQUAL(int, 0, (int)thread_exit_count);
+
+        ///cleanup
+        WorkerPool_Destroy(pool);
+    }
+
+    /*Tests_SRS_WORKER_POOL_13_017: [Before it exits, every thread of the pool shall call on_thread_exit if it is not NULL.]*/
+    TEST_FUNCTION(WorkerPool_thread_calls_on_thread_exit_before_it_exits)
+    {
+        ///arrange
+        WORKER_POOL_HANDLE pool = WorkerPool_CreateWithThreadExit(1, on_thread_exit);
+        ASSERT_IS_NOT_NULL(pool);
+
+        ///act
+        (void)last_thread_function(last_thread_argument);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, 1, (int)thread_exit_count);
+
+        ///cleanup
+        WorkerPool_Destroy(pool);
+    }
+
+    /*Tests_SRS_WORKER_POOL_13_014: [If handle or task is NULL, WorkerPool_Cancel shall return WORKER_POOL_INVALIDARG.]*/
+    TEST_FUNCTION(WorkerPool_Cancel_fails_with_NULL_arguments)
+    {
+        ///arrange
+        WORKER_POOL_TASK task;
+        WORKER_POOL_HANDLE pool = WorkerPool_Create(1);
+        init_task(&task, 0);
+
+        ///act
+        WORKER_POOL_RESULT result1 = WorkerPool_Cancel(NULL, &task);
+        WORKER_POOL_RESULT result2 = WorkerPool_Cancel(pool, NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, (int)WORKER_POOL_INVALIDARG, (int)result1);
+        ASSERT_ARE_EQUAL(int, (int)WORKER_POOL_INVALIDARG, (int)result2);
+
+        ///cleanup
+        WorkerPool_Destroy(pool);
+    }
+
+    /*Tests_SRS_WORKER_POOL_13_015: [If task is not scheduled, WorkerPool_Cancel shall return WORKER_POOL_ERROR.]*/
+    /*Tests_SRS_WORKER_POOL_13_016: [WorkerPool_Cancel shall remove task from the scheduled tasks and return WORKER_POOL_OK.]*/
+    TEST_FUNCTION(WorkerPool_Cancel_removes_a_scheduled_task)
+    {
+        ///arrange
+        WORKER_POOL_TASK tasks[3];
+        size_t i;
+        WORKER_POOL_HANDLE pool = WorkerPool_Create(1);
+        for (i = 0; i < 3; i++)
+        {
+            init_task(&tasks[i], i);
+            (void)WorkerPool_Schedule(pool, &tasks[i]);
+        }
+
+        ///act
+        WORKER_POOL_RESULT result1 = WorkerPool_Cancel(pool, &tasks[2]);
+        WORKER_POOL_RESULT result2 = WorkerPool_Cancel(pool, &tasks[2]);
+        (void)WorkerPool_Schedule(pool, &tasks[2]);
+        WORKER_POOL_RESULT result3 = WorkerPool_Cancel(pool, &tasks[0]);
+        (void)last_thread_function(last_thread_argument);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, (int)WORKER_POOL_OK, (int)result1);
+        ASSERT_ARE_EQUAL(int, (int)WORKER_POOL_ERROR, (int)result2);
+        ASSERT_ARE_EQUAL(int, (int)WORKER_POOL_OK, (int)result3);
+        ASSERT_ARE_EQUAL(int, 2, (int)ran_count);
+        ASSERT_ARE_EQUAL(int, 2, ran[0]);
+        ASSERT_ARE_EQUAL(int, 3, ran[1]);
+
+        ///cleanup
+        WorkerPool_Destroy(pool);
+    }
+
+    /*Tests_SRS_WORKER_POOL_13_013: [WorkerPool_GetThreadCount shall return the number of threads of the pool, or 0 if handle is NULL.]*/
+    TEST_FUNCTION(WorkerPool_GetThreadCount_returns_0_with_NULL_handle)
+    {
+        ///arrange
+
+        ///act
+        size_t result = WorkerPool_GetThreadCount(NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, 0, (int)result);
+    }
+
+END_TEST_SUITE(worker_pool_unittests)
@@ -410,6 +410,13 @@ static int format_timestamp(char* dest, size_t dest_size)
     return result;
 }
 
+/*deletes the buffer adopted by a message published by on_read_complete*/
+static void release_read_buffer(unsigned char* content, void* context)
+{
+    (void)content;
+    BUFFER_delete((BUFFER_HANDLE)context);
+}
+
 static void on_read_complete(
     BLEIO_SEQ_HANDLE bleio_seq_handle,
     void* context,
@@ -495,18 +502,24 @@ static void on_read_complete(
                     }
                     else
                     {
-                        MESSAGE_CONFIG message_config;
+                        /*Codes_SRS_BLE_13_023: [The message published by the ON_BLEIO_SEQ_READ_COMPLETE callback shall adopt the buffer that was read, by calling Message_CreateAdopt, so that the buffer is deleted when the message is destroyed instead of being copied.]*/
+                        MESSAGE_ADOPT_CONFIG message_config;
                         message_config.sourceProperties = message_properties;
                         message_config.size = BUFFER_length(data); // "data" MUST NOT be NULL here
-                        message_config.source = (const unsigned char*)BUFFER_u_char(data);
+                        message_config.source = BUFFER_u_char(data);
+                        message_config.release = release_read_buffer;
+                        message_config.releaseContext = data;
 
-                        MESSAGE_HANDLE message = Message_Create(&message_config);
+                        MESSAGE_HANDLE message = Message_CreateAdopt(&message_config);
                         if (message == NULL)
                         {
-                            LogError("Message_Create() failed");
+                            LogError("Message_CreateAdopt() failed");
                         }
                         else
                         {
+                            // the message owns the buffer now
+                            data = NULL;
+
                             /*Codes_SRS_BLE_13_019: [BLE_Create shall handle the ON_BLEIO_SEQ_READ_COMPLETE callback on the BLE I/O sequence. If the call is successful then a new message shall be published on the bus with the buffer that was read as the content of the message along with the following properties:
 
                                 | Property Name           | Description                                                   |
@@ -530,7 +543,10 @@ static void on_read_complete(
         }
     }
 
-    BUFFER_delete(data);
+    if (data != NULL)
+    {
+        BUFFER_delete(data);
+    }
 }
 
 void on_write_complete(
@@ -603,7 +619,6 @@ static void BLE_Receive(MODULE_HANDLE module, MESSAGE_HANDLE message)
     if (module != NULL && message != NULL)
     {
         BLE_HANDLE_DATA* handle_data = (BLE_HANDLE_DATA*)module;
-        CONSTMAP_HANDLE properties = Message_GetProperties(message);
 
         /*Codes_SRS_BLE_13_020: [ BLE_Receive shall ignore all messages except those that have the following properties:
             >| Property Name           | Description                                                             |
@@ -612,11 +627,11 @@ static void BLE_Receive(MODULE_HANDLE module, MESSAGE_HANDLE message)
             >| macAddress              | MAC address of the BLE device to which the data to should be written.   |
         ]*/
         // fetch the 'source' property
-        const char* source = ConstMap_GetValue(properties, GW_SOURCE_PROPERTY);
+        const char* source = Message_GetProperty(message, GW_SOURCE_PROPERTY);
         if (source != NULL && strcmp(source, GW_SOURCE_BLE_COMMAND) == 0)
         {
             // fetch the 'macAddress' property
-            const char* mac_address = ConstMap_GetValue(properties, GW_MAC_ADDRESS_PROPERTY);
+            const char* mac_address = Message_GetProperty(message, GW_MAC_ADDRESS_PROPERTY);
             if (mac_address != NULL && is_message_for_module(mac_address, handle_data) == true)
             {
                 const CONSTBUFFER* content = Message_GetContent(message);
@@ -642,8 +657,6 @@ static void BLE_Receive(MODULE_HANDLE module, MESSAGE_HANDLE message)
                 }
             }
         }
-
-        ConstMap_Destroy(properties);
     }
     else
     {
@@ -453,13 +453,13 @@ static void BLE_HL_Destroy(MODULE_HANDLE module)
     }
 }
 
-static bool recognize_bus_message(BLE_HL_HANDLE_DATA* handle_data, CONSTMAP_HANDLE properties)
+static bool recognize_bus_message(BLE_HL_HANDLE_DATA* handle_data, MESSAGE_HANDLE message_handle)
 {
     bool result;
-    const char * message_mac = ConstMap_GetValue(properties, GW_MAC_ADDRESS_PROPERTY);
+    const char * message_mac = Message_GetProperty(message_handle, GW_MAC_ADDRESS_PROPERTY);
     if (message_mac != NULL && (strcmp(message_mac, STRING_c_str(handle_data->mac_address)) == 0))
     {
-        const char * message_source = ConstMap_GetValue(properties, GW_SOURCE_PROPERTY);
+        const char * message_source = Message_GetProperty(message_handle, GW_SOURCE_PROPERTY);
         if ((message_source != NULL) && (strcmp(message_source, GW_IDMAP_MODULE) == 0))
         {
             result = true; /* recognized */
@@ -480,48 +480,59 @@ static bool recognize_bus_message(BLE_HL_HANDLE_DATA* handle_data, CONSTMAP_HAND
     return result;
 }
 
-static int forward_new_message(BLE_HL_HANDLE_DATA* handle_data, CONSTMAP_HANDLE properties, BLE_INSTRUCTION* ble_instr)
+static int forward_new_message(BLE_HL_HANDLE_DATA* handle_data, MESSAGE_HANDLE message_handle, BLE_INSTRUCTION* ble_instr)
 {
     int result;
-    /*Codes_SRS_BLE_HL_17_018: [ BLE_HL_Receive shall call ConstMap_CloneWriteable on the message properties. ]*/
-    MAP_HANDLE new_message_props = ConstMap_CloneWriteable(properties);
-    if (new_message_props != NULL)
+    CONSTMAP_HANDLE properties = Message_GetProperties(message_handle);
+    if (properties == NULL)
     {
-        /*Codes_SRS_BLE_HL_17_020: [ BLE_HL_Receive shall call Map_AddOrUpdate with key of "source" and value of "BLE". ]*/
-        if (Map_AddOrUpdate(new_message_props, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_COMMAND) == MAP_OK)
+        /*Codes_SRS_BLE_HL_13_024: [ If Message_GetProperties fails, BLE_HL_Receive shall return. ]*/
+        LogError("Unable to get the message properties");
+        result = __LINE__;
+    }
+    else
+    {
+        /*Codes_SRS_BLE_HL_17_018: [ BLE_HL_Receive shall call ConstMap_CloneWriteable on the properties of the message, obtained with Message_GetProperties. ]*/
+        MAP_HANDLE new_message_props = ConstMap_CloneWriteable(properties);
+        if (new_message_props != NULL)
         {
-            MESSAGE_CONFIG cfg;
-            cfg.size = sizeof(BLE_INSTRUCTION);
-            cfg.source = (const unsigned char *)ble_instr;
-            cfg.sourceProperties = new_message_props;
-            /*Codes_SRS_BLE_HL_17_023: [ BLE_HL_Receive shall create a new message by calling Message_Create with new map and BLE_INSTRUCTION as the buffer. ]*/
-            MESSAGE_HANDLE new_message_handle = Message_Create(&cfg);
-            if (new_message_handle != NULL)
+            /*Codes_SRS_BLE_HL_17_020: [ BLE_HL_Receive shall call Map_AddOrUpdate with key of "source" and value of "BLE". ]*/
+            if (Map_AddOrUpdate(new_message_props, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_COMMAND) == MAP_OK)
             {
-                /*Codes_SRS_BLE_HL_13_018: [ BLE_HL_Receive shall forward new message to the underlying module. ]*/
-                MODULE_STATIC_GETAPIS(BLE_MODULE)()->Module_Receive(handle_data->module_handle, new_message_handle);
-                Message_Destroy(new_message_handle);
-                result = 0;
+                MESSAGE_CONFIG cfg;
+                cfg.size = sizeof(BLE_INSTRUCTION);
+                cfg.source = (const unsigned char *)ble_instr;
+                cfg.sourceProperties = new_message_props;
+                /*Codes_SRS_BLE_HL_17_023: [ BLE_HL_Receive shall create a new message by calling Message_Create with new map and BLE_INSTRUCTION as the buffer. ]*/
+                MESSAGE_HANDLE new_message_handle = Message_Create(&cfg);
+                if (new_message_handle != NULL)
+                {
+                    /*Codes_SRS_BLE_HL_13_018: [ BLE_HL_Receive shall forward new message to the underlying module. ]*/
+                    MODULE_STATIC_GETAPIS(BLE_MODULE)()->Module_Receive(handle_data->module_handle, new_message_handle);
+                    Message_Destroy(new_message_handle);
+                    result = 0;
+                }
+                else
+                {
+                    /*Codes_SRS_BLE_HL_17_024: [ If creating new message fails, BLE_HL_Receive shall deallocate all resources and return. ]*/
+                    LogError("Forward message creation failed");
+                    result = __LINE__;
+                }
             }
             else
             {
-                /*Codes_SRS_BLE_HL_17_024: [ If creating new message fails, BLE_HL_Receive shall deallocate all resources and return. ]*/
-                LogError("Forward message creation failed");
+                LogError("Unable to set properties");
                 result = __LINE__;
             }
+            Map_Destroy(new_message_props);
         }
         else
         {
-            LogError("Unable to set properties");
+            /*Codes_SRS_BLE_HL_17_019: [ If ConstMap_CloneWriteable fails, BLE_HL_Receive shall return. ]*/
+            LogError("Unable to get writeable properties");
             result = __LINE__;
         }
-        Map_Destroy(new_message_props);
-    }
-    else
-    {
-        /*Codes_SRS_BLE_HL_17_019: [ If ConstMap_CloneWriteable fails, BLE_HL_Receive shall return. ]*/
-        LogError("Unable to get writeable properties");
-        result = __LINE__;
+        ConstMap_Destroy(properties);
     }
     return result;
 }
@@ -535,86 +546,81 @@ static void BLE_HL_Receive(MODULE_HANDLE module, MESSAGE_HANDLE message_handle)
         /*Codes_SRS_BLE_HL_13_018: [ BLE_HL_Receive shall forward the call to the underlying module. ]*/
         BLE_HL_HANDLE_DATA* handle_data = (BLE_HL_HANDLE_DATA*)module;
 
-        CONSTMAP_HANDLE properties = Message_GetProperties(message_handle);
-        if (properties != NULL)
+        if (recognize_bus_message(handle_data, message_handle) == true)
         {
-            if (recognize_bus_message(handle_data, properties) == true)
+            const CONSTBUFFER * message_content = Message_GetContent(message_handle);
+            if (message_content != NULL)
             {
-                const CONSTBUFFER * message_content = Message_GetContent(message_handle);
-                if (message_content != NULL)
+                /*Codes_SRS_BLE_HL_17_006: [ BLE_HL_Receive shall parse the message contents as a JSON object. ]*/
+                /*Codes_SRS_BLE_HL_17_007: [ If the message contents do not parse, then BLE_HL_Receive shall return. ]*/
+                JSON_Value* json = json_parse_string((const char*)(message_content->buffer));
+                if (json != NULL)
                 {
-                    /*Codes_SRS_BLE_HL_17_006: [ BLE_HL_Receive shall parse the message contents as a JSON object. ]*/
-                    /*Codes_SRS_BLE_HL_17_007: [ If the message contents do not parse, then BLE_HL_Receive shall return. ]*/
-                    JSON_Value* json = json_parse_string((const char*)(message_content->buffer));
-                    if (json != NULL)
+                    JSON_Object* instr = json_value_get_object(json);
+                    if (instr != NULL)
                     {
-                        JSON_Object* instr = json_value_get_object(json);
-                        if (instr != NULL)
+                        const char* type = json_object_get_string(instr, "type");
+                        if (type != NULL)
                         {
-                            const char* type = json_object_get_string(instr, "type");
-                            if (type != NULL)
+                            /*Codes_SRS_BLE_HL_17_008: [ BLE_HL_Receive shall return if the JSON object does not contain the following fields: "type", "characteristic_uuid", and "data". ]*/
+                            const char* characteristic_uuid = json_object_get_string(instr, "characteristic_uuid");
+                            if (characteristic_uuid != NULL)
                             {
-                                /*Codes_SRS_BLE_HL_17_008: [ BLE_HL_Receive shall return if the JSON object does not contain the following fields: "type", "characteristic_uuid", and "data". ]*/
-                                const char* characteristic_uuid = json_object_get_string(instr, "characteristic_uuid");
-                                if (characteristic_uuid != NULL)
+                                BLE_INSTRUCTION ble_instr = { 0 };
+                                /*Codes_SRS_BLE_HL_17_012: [ BLE_HL_Receive shall create a STRING_HANDLE from the characteristic_uuid data field. ]*/
+                                /*Codes_SRS_BLE_HL_17_016: [ BLE_HL_Receive shall set characteristic_uuid to the created STRING. ]*/
+                                ble_instr.characteristic_uuid = STRING_construct(characteristic_uuid);
+                                if (ble_instr.characteristic_uuid != NULL)
                                 {
-                                    BLE_INSTRUCTION ble_instr = { 0 };
-                                    /*Codes_SRS_BLE_HL_17_012: [ BLE_HL_Receive shall create a STRING_HANDLE from the characteristic_uuid data field. ]*/
-                                    /*Codes_SRS_BLE_HL_17_016: [ BLE_HL_Receive shall set characteristic_uuid to the created STRING. ]*/
-                                    ble_instr.characteristic_uuid = STRING_construct(characteristic_uuid);
-                                    if (ble_instr.characteristic_uuid != NULL)
+                                    /*Codes_SRS_BLE_HL_17_014: [ BLE_HL_Receive shall parse the json object to fill in a new BLE_INSTRUCTION. ]*/
+                                    if (parse_instruction(type, instr, &ble_instr, 0) == true)
                                     {
-                                        /*Codes_SRS_BLE_HL_17_014: [ BLE_HL_Receive shall parse the json object to fill in a new BLE_INSTRUCTION. ]*/
-                                        if (parse_instruction(type, instr, &ble_instr, 0) == true)
+                                        if (forward_new_message(handle_data, message_handle, &ble_instr) != 0)
                                         {
-                                            if (forward_new_message(handle_data, properties, &ble_instr) != 0)
-                                            {
-                                                free_instruction(&ble_instr);
-                                            }
-                                        }
-                                        else
-                                        {
-                                            /*Codes_SRS_BLE_HL_17_026: [ If the json object does not parse, BLE_HL_Receive shall return. ]*/
-                                            /*Codes_SRS_BLE_HL_17_008: [ BLE_HL_Receive shall return if the JSON object does not contain the following fields: "type", "characteristic_uuid", and "data". ]*/
-                                            LogError("Not a valid BLE instruction");
                                             free_instruction(&ble_instr);
                                         }
                                     }
                                     else
                                     {
-                                        /*Codes_SRS_BLE_HL_17_013: [ If the string creation fails, BLE_HL_Receive shall return. ]*/
-                                        LogError("Characteristic uuid string creation failed.");
+                                        /*Codes_SRS_BLE_HL_17_026: [ If the json object does not parse, BLE_HL_Receive shall return. ]*/
+                                        /*Codes_SRS_BLE_HL_17_008: [ BLE_HL_Receive shall return if the JSON object does not contain the following fields: "type", "characteristic_uuid", and "data". ]*/
+                                        LogError("Not a valid BLE instruction");
+                                        free_instruction(&ble_instr);
                                     }
                                 }
                                 else
                                 {
-                                    LogError("Characteristic uuid not found");
+                                    /*Codes_SRS_BLE_HL_17_013: [ If the string creation fails, BLE_HL_Receive shall return. ]*/
+                                    LogError("Characteristic uuid string creation failed.");
                                 }
                             }
                             else
                             {
-                                LogError("BLE Instruction type not found");
+                                LogError("Characteristic uuid not found");
                             }
                         }
                         else
                         {
-                            LogError("JSON Object expected, not received.");
+                            LogError("BLE Instruction type not found");
                         }
-                        json_value_free(json);
                     }
                     else
                     {
-                        LogError("JSON parsing failed");
+                        LogError("JSON Object expected, not received.");
                     }
+                    json_value_free(json);
                 }
                 else
                 {
-                    LogError("No Message Content");
+                    LogError("JSON parsing failed");
                 }
             }
-            /*Codes_SRS_BLE_HL_17_025: [ BLE_HL_Receive shall free all resources created. ]*/
-            ConstMap_Destroy(properties);
+            else
+            {
+                LogError("No Message Content");
+            }
         }
+        /*Codes_SRS_BLE_HL_17_025: [ BLE_HL_Receive shall free all resources created. ]*/
     }
     else
     {
@@ -524,6 +524,9 @@ public:
         MOCK_STATIC_METHOD_1(, CONSTMAP_HANDLE, Message_GetProperties, MESSAGE_HANDLE, message)
         MOCK_METHOD_END(CONSTMAP_HANDLE, (CONSTMAP_HANDLE)BASEIMPLEMENTATION::gballoc_malloc(1))
 
+        MOCK_STATIC_METHOD_2(, const char*, Message_GetProperty, MESSAGE_HANDLE, message, const char*, name)
+        MOCK_METHOD_END(const char*, (const char*)NULL)
+
         MOCK_STATIC_METHOD_1(, const CONSTBUFFER*, Message_GetContent, MESSAGE_HANDLE, message)
         MOCK_METHOD_END(const CONSTBUFFER*, (const CONSTBUFFER*)NULL);
 
@@ -536,9 +539,6 @@ public:
         MOCK_STATIC_METHOD_1(, MAP_HANDLE, ConstMap_CloneWriteable, CONSTMAP_HANDLE, handle)
         MOCK_METHOD_END(MAP_HANDLE, (MAP_HANDLE)BASEIMPLEMENTATION::gballoc_malloc(1))
 
-        MOCK_STATIC_METHOD_2(, const char*, ConstMap_GetValue, CONSTMAP_HANDLE, handle, const char*, key)
-        MOCK_METHOD_END(const char*, (const char*)NULL)
-
         MOCK_STATIC_METHOD_1(, void, ConstMap_Destroy, CONSTMAP_HANDLE, handle)
             BASEIMPLEMENTATION::gballoc_free(handle);
         MOCK_VOID_METHOD_END()
@@ -584,11 +584,11 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CBLEHLMocks, , void, BUFFER_delete, BUFFER_HANDLE,
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEHLMocks, , MESSAGE_HANDLE, Message_Create, const MESSAGE_CONFIG*, cfg);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEHLMocks, , CONSTMAP_HANDLE, Message_GetProperties, MESSAGE_HANDLE, message);
+DECLARE_GLOBAL_MOCK_METHOD_2(CBLEHLMocks, , const char*, Message_GetProperty, MESSAGE_HANDLE, message, const char*, name);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEHLMocks, , const CONSTBUFFER*, Message_GetContent, MESSAGE_HANDLE, message);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEHLMocks, , void, Message_Destroy, MESSAGE_HANDLE, message);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEHLMocks, , MAP_HANDLE, ConstMap_CloneWriteable, CONSTMAP_HANDLE, handle);
-DECLARE_GLOBAL_MOCK_METHOD_2(CBLEHLMocks, , const char*, ConstMap_GetValue, CONSTMAP_HANDLE, handle, const char*, key);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEHLMocks, , void, ConstMap_Destroy, CONSTMAP_HANDLE, handle);
 
 DECLARE_GLOBAL_MOCK_METHOD_3(CBLEHLMocks, , MAP_RESULT, Map_AddOrUpdate, MAP_HANDLE, handle, const char*, key, const char*, value);
@@ -1921,7 +1921,7 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
     //Tests_SRS_BLE_HL_17_006: [ BLE_HL_Receive shall parse the message contents as a JSON object. ]
     //Tests_SRS_BLE_HL_17_016: [ BLE_HL_Receive shall set characteristic_uuid to the created STRING. ]
     //Tests_SRS_BLE_HL_17_014: [ BLE_HL_Receive shall parse the json object to fill in a new BLE_INSTRUCTION. ]
-    //Tests_SRS_BLE_HL_17_018: [ BLE_HL_Receive shall call ConstMap_CloneWriteable on the message properties. ]
+    //Tests_SRS_BLE_HL_17_018: [ BLE_HL_Receive shall call ConstMap_CloneWriteable on the properties of the message, obtained with Message_GetProperties. ]
     //Tests_SRS_BLE_HL_17_020: [ BLE_HL_Receive shall call Map_AddOrUpdate with key of "source" and value of "BLE". ]
     //Tests_SRS_BLE_HL_17_023: [ BLE_HL_Receive shall create a new message by calling Message_Create with new map and BLE_INSTRUCTION as the buffer. ]
     //Tests_SRS_BLE_HL_17_025: [ BLE_HL_Receive shall free all resources created. ]
@@ -1944,14 +1944,11 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         mocks.ResetAllCalls();
 
         MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_MAC_ADDRESS_PROPERTY))
             .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
         STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_SOURCE_PROPERTY))
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
@@ -1974,6 +1971,7 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         STRICT_EXPECTED_CALL(mocks, Base64_Decoder(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
         STRICT_EXPECTED_CALL(mocks, ConstMap_CloneWriteable(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .SetReturn((MAP_HANDLE)0x42);
@@ -2025,14 +2023,11 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         mocks.ResetAllCalls();
 
         MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_MAC_ADDRESS_PROPERTY))
             .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
         STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_SOURCE_PROPERTY))
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
@@ -2053,6 +2048,7 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         STRICT_EXPECTED_CALL(mocks, Base64_Decoder(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
         STRICT_EXPECTED_CALL(mocks, ConstMap_CloneWriteable(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .SetReturn((MAP_HANDLE)0x42);
@@ -2105,14 +2101,11 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         mocks.ResetAllCalls();
 
         MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_MAC_ADDRESS_PROPERTY))
             .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
         STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_SOURCE_PROPERTY))
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
@@ -2133,6 +2126,7 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         STRICT_EXPECTED_CALL(mocks, Base64_Decoder(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
         STRICT_EXPECTED_CALL(mocks, ConstMap_CloneWriteable(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .SetReturn((MAP_HANDLE)0x42);
@@ -2182,14 +2176,11 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         mocks.ResetAllCalls();
 
         MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_MAC_ADDRESS_PROPERTY))
             .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
         STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_SOURCE_PROPERTY))
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
@@ -2210,6 +2201,7 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         STRICT_EXPECTED_CALL(mocks, Base64_Decoder(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
         STRICT_EXPECTED_CALL(mocks, ConstMap_CloneWriteable(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .SetFailReturn((MAP_HANDLE)NULL);
@@ -2234,6 +2226,71 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         BLE_HL_Destroy(module);
     }
 
+    //Tests_SRS_BLE_HL_13_024: [ If Message_GetProperties fails, BLE_HL_Receive shall return. ]
+    TEST_FUNCTION(BLE_HL_Receive_message_get_properties_fails)
+    {
+        ///arrange
+        CBLEHLMocks mocks;
+        unsigned char fake = '\0';
+        CONSTBUFFER messageBuffer;
+        messageBuffer.buffer = &fake;
+        messageBuffer.size = 1;
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "type"))
+            .IgnoreArgument(1)
+            .SetReturn((const char*)"write_at_init");
+        STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((size_t)1);
+
+        auto module = BLE_HL_Create((MESSAGE_BUS_HANDLE)0x42, (const void*)FAKE_CONFIG);
+        mocks.ResetAllCalls();
+
+        MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_MAC_ADDRESS_PROPERTY))
+            .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
+        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_SOURCE_PROPERTY))
+            .SetReturn((const char *)GW_IDMAP_MODULE);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
+            .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "type"))
+            .IgnoreArgument(1)
+            .SetReturn("write_once");
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "characteristic_uuid"))
+            .IgnoreArgument(1)
+            .SetReturn("F000AA02-0451-4000-B000-000000000000");
+        STRICT_EXPECTED_CALL(mocks, STRING_construct(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "data"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Base64_Decoder(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage))
+            .SetFailReturn((CONSTMAP_HANDLE)NULL);
+
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        BLE_HL_Receive(module, (MESSAGE_HANDLE)0x42);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        BLE_HL_Destroy(module);
+    }
+
     //Tests_SRS_BLE_HL_17_008: [ BLE_HL_Receive shall return if the JSON object does not contain the following fields: "type", "characteristic_uuid", and "data". ]
     //Tests_SRS_BLE_HL_17_026: [ If the json object does not parse, BLE_HL_Receive shall return. ]
     TEST_FUNCTION(BLE_HL_Receive_parse_instruction_fails)
@@ -2255,14 +2312,11 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         mocks.ResetAllCalls();
 
         MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_MAC_ADDRESS_PROPERTY))
             .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
         STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_SOURCE_PROPERTY))
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
@@ -2290,9 +2344,6 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
         ///act
         BLE_HL_Receive(module, (MESSAGE_HANDLE)0x42);
 
@@ -2324,14 +2375,11 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         mocks.ResetAllCalls();
 
         MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_MAC_ADDRESS_PROPERTY))
             .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
         STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_SOURCE_PROPERTY))
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
@@ -2352,9 +2400,6 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
         ///act
         BLE_HL_Receive(module, (MESSAGE_HANDLE)0x42);
 
@@ -2385,14 +2430,11 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         mocks.ResetAllCalls();
 
         MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_MAC_ADDRESS_PROPERTY))
             .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
         STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_SOURCE_PROPERTY))
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
@@ -2410,9 +2452,6 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
         ///act
         BLE_HL_Receive(module, (MESSAGE_HANDLE)0x42);
 
@@ -2443,14 +2482,11 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         mocks.ResetAllCalls();
 
         MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_MAC_ADDRESS_PROPERTY))
             .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
         STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_SOURCE_PROPERTY))
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
@@ -2465,9 +2501,6 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
         ///act
         BLE_HL_Receive(module, (MESSAGE_HANDLE)0x42);
 
@@ -2498,14 +2531,11 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         mocks.ResetAllCalls();
 
         MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_MAC_ADDRESS_PROPERTY))
             .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
         STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_SOURCE_PROPERTY))
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
@@ -2518,9 +2548,6 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
         ///act
         BLE_HL_Receive(module, (MESSAGE_HANDLE)0x42);
 
@@ -2551,14 +2578,11 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         mocks.ResetAllCalls();
 
         MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_MAC_ADDRESS_PROPERTY))
             .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
         STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_SOURCE_PROPERTY))
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
@@ -2566,9 +2590,6 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
             .IgnoreArgument(1)
             .SetFailReturn((JSON_Value*)NULL);
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
         ///act
         BLE_HL_Receive(module, (MESSAGE_HANDLE)0x42);
 
@@ -2599,21 +2620,15 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         mocks.ResetAllCalls();
 
         MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_MAC_ADDRESS_PROPERTY))
             .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
         STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_SOURCE_PROPERTY))
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)NULL);
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
         ///act
         BLE_HL_Receive(module, (MESSAGE_HANDLE)0x42);
 
@@ -2644,20 +2659,14 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         mocks.ResetAllCalls();
 
         MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_MAC_ADDRESS_PROPERTY))
             .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
         STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_SOURCE_PROPERTY))
             .SetReturn((const char *)"BLE");
 
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
         ///act
         BLE_HL_Receive(module, (MESSAGE_HANDLE)0x42);
 
@@ -2688,16 +2697,11 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         mocks.ResetAllCalls();
 
         MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_MAC_ADDRESS_PROPERTY))
             .SetReturn((const char *)"AA:BB:DD:DD:EE:FF");
         STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
         ///act
         BLE_HL_Receive(module, (MESSAGE_HANDLE)0x42);
 
@@ -2709,8 +2713,7 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
     }
 
     //Tests_SRS_BLE_HL_17_002: [ If messageHandle properties does not contain "macAddress" property, then this function shall return. ]
-    //Tests_SRS_BLE_HL_17_004: [ If messageHandle properties does not contain "source" property, then this function shall return. ]
-    TEST_FUNCTION(BLE_HL_Receive_message_no_properties)
+    TEST_FUNCTION(BLE_HL_Receive_message_no_mac_address)
     {
         ///arrange
         CBLEHLMocks mocks;
@@ -2729,8 +2732,8 @@ BEGIN_TEST_SUITE(ble_hl_unittests)
         mocks.ResetAllCalls();
 
         MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage))
-            .SetFailReturn((CONSTMAP_HANDLE)NULL);
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(fakeMessage, GW_MAC_ADDRESS_PROPERTY))
+            .SetReturn((const char *)NULL);
 
         ///act
         BLE_HL_Receive(module, (MESSAGE_HANDLE)0x42);
@@ -78,6 +78,8 @@ namespace BASEIMPLEMENTATION
 
 #include "vector.c"
 #include "message.c"
+#include "message_pool.c"
+#include "string_intern.c"
 #include "constbuffer.c"
 #include "constmap.c"
 #include "map.c"
@@ -229,6 +231,10 @@ public:
         MESSAGE_HANDLE result2 = BASEIMPLEMENTATION::Message_Create(cfg);
     MOCK_METHOD_END(MESSAGE_HANDLE, result2)
 
+    MOCK_STATIC_METHOD_1(, MESSAGE_HANDLE, Message_CreateAdopt, const MESSAGE_ADOPT_CONFIG*, cfg)
+        MESSAGE_HANDLE result2 = BASEIMPLEMENTATION::Message_CreateAdopt(cfg);
+    MOCK_METHOD_END(MESSAGE_HANDLE, result2)
+
     MOCK_STATIC_METHOD_1(, MESSAGE_HANDLE, Message_CreateFromBuffer, const MESSAGE_BUFFER_CONFIG*, cfg)
             MESSAGE_HANDLE result1 = BASEIMPLEMENTATION::Message_CreateFromBuffer(cfg);
     MOCK_METHOD_END(MESSAGE_HANDLE, result1)
@@ -241,6 +247,10 @@ public:
         CONSTMAP_HANDLE result1 = BASEIMPLEMENTATION::Message_GetProperties(message);
     MOCK_METHOD_END(CONSTMAP_HANDLE, result1)
 
+    MOCK_STATIC_METHOD_2(, const char*, Message_GetProperty, MESSAGE_HANDLE, message, const char*, name)
+        const char* result1 = BASEIMPLEMENTATION::Message_GetProperty(message, name);
+    MOCK_METHOD_END(const char*, result1)
+
     MOCK_STATIC_METHOD_1(, const CONSTBUFFER*, Message_GetContent, MESSAGE_HANDLE, message)
         const CONSTBUFFER* result1 = BASEIMPLEMENTATION::Message_GetContent(message);
     MOCK_METHOD_END(const CONSTBUFFER*, result1)
@@ -530,9 +540,11 @@ DECLARE_GLOBAL_MOCK_METHOD_3(CBLEMocks, , THREADAPI_RESULT, ThreadAPI_Create, TH
 DECLARE_GLOBAL_MOCK_METHOD_2(CBLEMocks, , THREADAPI_RESULT, ThreadAPI_Join, THREAD_HANDLE, threadHandle, int*, res);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , MESSAGE_HANDLE, Message_Create, const MESSAGE_CONFIG*, cfg);
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , MESSAGE_HANDLE, Message_CreateAdopt, const MESSAGE_ADOPT_CONFIG*, cfg);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , MESSAGE_HANDLE, Message_CreateFromBuffer, const MESSAGE_BUFFER_CONFIG*, cfg);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , MESSAGE_HANDLE, Message_Clone, MESSAGE_HANDLE, message);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , CONSTMAP_HANDLE, Message_GetProperties, MESSAGE_HANDLE, message);
+DECLARE_GLOBAL_MOCK_METHOD_2(CBLEMocks, , const char*, Message_GetProperty, MESSAGE_HANDLE, message, const char*, name);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , const CONSTBUFFER*, Message_GetContent, MESSAGE_HANDLE, message);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , CONSTBUFFER_HANDLE, Message_GetContentHandle, MESSAGE_HANDLE, message);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , void, Message_Destroy, MESSAGE_HANDLE, message);
@@ -2127,7 +2139,7 @@ BEGIN_TEST_SUITE(ble_unittests)
         VECTOR_destroy(instructions);
     }
 
-    TEST_FUNCTION(on_read_complete_does_not_publish_message_when_Message_Create_fails)
+    TEST_FUNCTION(on_read_complete_does_not_publish_message_when_Message_CreateAdopt_fails)
     {
         ///arrange
         CBLEMocks mocks;
@@ -2224,7 +2236,7 @@ BEGIN_TEST_SUITE(ble_unittests)
                 .IgnoreAllArguments();
         }
 
-        STRICT_EXPECTED_CALL(mocks, Message_Create(IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, Message_CreateAdopt(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .SetFailReturn((MESSAGE_HANDLE)NULL);
 
@@ -2288,18 +2300,12 @@ BEGIN_TEST_SUITE(ble_unittests)
             .IgnoreArgument(1)
             .IgnoreArgument(2);                                              // CBLEIOSequence::run
         STRICT_EXPECTED_CALL(mocks, BUFFER_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);                                              // CBLEIOSequence::run
+            .IgnoreArgument(1);                                              // Message_Destroy releases the buffer
         STRICT_EXPECTED_CALL(mocks, BUFFER_length(IGNORED_PTR_ARG))
             .IgnoreArgument(1);                                              // on_read_complete
         STRICT_EXPECTED_CALL(mocks, BUFFER_u_char(IGNORED_PTR_ARG))
             .IgnoreArgument(1);                                              // on_read_complete
 
-        STRICT_EXPECTED_CALL(mocks, CONSTBUFFER_Create(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);                                              // on_read_complete
-        STRICT_EXPECTED_CALL(mocks, CONSTBUFFER_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
         STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
             .IgnoreArgument(1);                                              // CBLEIOSequence::run
 
@@ -2356,7 +2362,7 @@ BEGIN_TEST_SUITE(ble_unittests)
                 .IgnoreAllArguments();
         }
 
-        STRICT_EXPECTED_CALL(mocks, Message_Create(IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, Message_CreateAdopt(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, Message_Destroy(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
@@ -2551,17 +2557,7 @@ BEGIN_TEST_SUITE(ble_unittests)
         MESSAGE_HANDLE message = Message_Create(&message_config);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(message));
-
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Clone(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, Map_GetValueFromKey(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(message, GW_SOURCE_PROPERTY));
 
         ///act
         BLE_Receive(handle, message);
@@ -2618,17 +2614,7 @@ BEGIN_TEST_SUITE(ble_unittests)
         MESSAGE_HANDLE message = Message_Create(&message_config);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(message));
-
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Clone(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, Map_GetValueFromKey(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(message, GW_SOURCE_PROPERTY));
 
         ///act
         BLE_Receive(handle, message);
@@ -2685,21 +2671,8 @@ BEGIN_TEST_SUITE(ble_unittests)
         MESSAGE_HANDLE message = Message_Create(&message_config);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(message));
-
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Clone(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, Map_GetValueFromKey(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, Map_GetValueFromKey(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(message, GW_SOURCE_PROPERTY));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(message, GW_MAC_ADDRESS_PROPERTY));
 
         ///act
         BLE_Receive(handle, message);
@@ -2758,21 +2731,8 @@ BEGIN_TEST_SUITE(ble_unittests)
         MESSAGE_HANDLE message = Message_Create(&message_config);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(message));
-
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Clone(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, Map_GetValueFromKey(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, Map_GetValueFromKey(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(message, GW_SOURCE_PROPERTY));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(message, GW_MAC_ADDRESS_PROPERTY));
 
         ///act
         BLE_Receive(handle, message);
@@ -2826,21 +2786,8 @@ BEGIN_TEST_SUITE(ble_unittests)
         MESSAGE_HANDLE message = Message_Create(&message_config);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(message));
-
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Clone(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, Map_GetValueFromKey(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, Map_GetValueFromKey(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(message, GW_SOURCE_PROPERTY));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(message, GW_MAC_ADDRESS_PROPERTY));
 
         ///act
         BLE_Receive(handle, message);
@@ -2893,26 +2840,10 @@ BEGIN_TEST_SUITE(ble_unittests)
         MESSAGE_HANDLE message = Message_Create(&message_config);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(message));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(message, GW_SOURCE_PROPERTY));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(message, GW_MAC_ADDRESS_PROPERTY));
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(message));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Clone(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, CONSTBUFFER_GetContent(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, Map_GetValueFromKey(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, Map_GetValueFromKey(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1);
-
         ///act
         BLE_Receive(handle, message);
 
@@ -2973,26 +2904,10 @@ BEGIN_TEST_SUITE(ble_unittests)
         MESSAGE_HANDLE message = Message_Create(&message_config);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(message));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(message, GW_SOURCE_PROPERTY));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(message, GW_MAC_ADDRESS_PROPERTY));
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(message));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Clone(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, CONSTBUFFER_GetContent(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, Map_GetValueFromKey(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, Map_GetValueFromKey(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-            .IgnoreArgument(1);
-
         STRICT_EXPECTED_CALL(mocks, BLEIO_Seq_AddInstruction(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(2);
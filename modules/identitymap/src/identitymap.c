@@ -361,40 +361,24 @@ static void IdentityMap_Destroy(MODULE_HANDLE moduleHandle)
 
 static void publish_with_new_properties(MAP_HANDLE newProperties, MESSAGE_HANDLE messageHandle, IDENTITY_MAP_DATA * idModule)
 {
-	/*Codes_SRS_IDMAP_17_034: [IdentityMap_Receive shall clone message content.] */ 
-	CONSTBUFFER_HANDLE content = Message_GetContentHandle(messageHandle);
-	if (content == NULL)
+	/*Codes_SRS_IDMAP_13_005: [IdentityMap_Receive shall create a new message by calling Message_CreateDerived with messageHandle and the map of overriding properties, so that the new message shares the content and the other properties of messageHandle.]*/
+	MESSAGE_HANDLE newMessage = Message_CreateDerived(messageHandle, newProperties);
+	if (newMessage == NULL)
 	{
-		/*Codes_SRS_IDMAP_17_035: [If cloning message content fails, IdentityMap_Receive shall deallocate all resources and return.]*/
-		LogError("Could not extract message content");
+		/*Codes_SRS_IDMAP_13_006: [If creating new message fails, IdentityMap_Receive shall deallocate all resources and return.]*/
+		LogError("Could not create new message to publish");
 	}
 	else
 	{
-		MESSAGE_BUFFER_CONFIG newMessageConfig =
+		MESSAGE_BUS_RESULT busStatus;
+		/*Codes_SRS_IDMAP_17_038: [IdentityMap_Receive shall call MessageBus_Publish with busHandle and new message.]*/
+		busStatus = MessageBus_Publish(idModule->busHandle, (MODULE_HANDLE)idModule, newMessage);
+		if (busStatus != MESSAGE_BUS_OK)
 		{
-			content,
-			newProperties
-		};
-		/*Codes_SRS_IDMAP_17_036: [IdentityMap_Receive shall create a new message by calling Message_CreateFromBuffer with new map and cloned content.]*/
-		MESSAGE_HANDLE newMessage = Message_CreateFromBuffer(&newMessageConfig);
-		if (newMessage == NULL)
-		{
-			/*Codes_SRS_IDMAP_17_037: [If creating new message fails, IdentityMap_Receive shall deallocate all resources and return.]*/
-			LogError("Could not create new message to publish");
-		}
-		else
-		{
-			MESSAGE_BUS_RESULT busStatus;
-			/*Codes_SRS_IDMAP_17_038: [IdentityMap_Receive shall call MessageBus_Publish with busHandle and new message.]*/
-			busStatus = MessageBus_Publish(idModule->busHandle, (MODULE_HANDLE)idModule, newMessage);
-			if (busStatus != MESSAGE_BUS_OK)
-			{
-				LogError("Message bus publish failure: %s", ENUM_TO_STRING(MESSAGE_BUS_RESULT, busStatus));
-			}
-			Message_Destroy(newMessage);
+			LogError("Message bus publish failure: %s", ENUM_TO_STRING(MESSAGE_BUS_RESULT, busStatus));
 		}
 		/*Codes_SRS_IDMAP_17_039: [IdentityMap_Receive will destroy all resources it created.]*/
-		CONSTBUFFER_Destroy(content);
+		Message_Destroy(newMessage);
 	}
 }
 
@@ -406,48 +390,38 @@ static void IdentityMap_RepublishD2C(
 	MESSAGE_HANDLE messageHandle,
 	IDENTITY_MAP_CONFIG * match)
 {
-	CONSTMAP_HANDLE properties = Message_GetProperties(messageHandle);
-	if (properties == NULL)
+	/*Codes_SRS_IDMAP_13_001: [On a D2C message received, IdentityMap_Receive shall call Map_Create to create an empty map of overriding properties.]*/
+	MAP_HANDLE newProperties = Map_Create(NULL);
+	if (newProperties == NULL)
 	{
-
-		LogError("Could not extract message properties");
+		/*Codes_SRS_IDMAP_13_002: [If Map_Create fails, IdentityMap_Receive shall deallocate any resources and return.]*/
+		LogError("Could not create the map of overriding properties");
 	}
 	else
 	{
-		/*Codes_SRS_IDMAP_17_026: [On a message which passes all checks, IdentityMap_Receive shall call ConstMap_CloneWriteable on the message properties.]*/
-		MAP_HANDLE newProperties = ConstMap_CloneWriteable(properties);
-		if (newProperties == NULL)
+		/*Codes_SRS_IDMAP_17_028: [IdentityMap_Receive shall call Map_AddOrUpdate with key of "deviceName" and value of found deviceId.]*/
+		if (Map_AddOrUpdate(newProperties, GW_DEVICENAME_PROPERTY, match->deviceId) != MAP_OK)
+		{
+			/*Codes_SRS_IDMAP_17_029: [If adding deviceName fails,IdentityMap_Receive shall deallocate all resources and return.]*/
+			LogError("Could not attach device name property to message");
+		}
+		/*Codes_SRS_IDMAP_17_030: [IdentityMap_Receive shall call Map_AddOrUpdate with key of "deviceKey" and value of found deviceKey.]*/
+		else if (Map_AddOrUpdate(newProperties, GW_DEVICEKEY_PROPERTY, match->deviceKey) != MAP_OK)
+		{
+			/*Codes_SRS_IDMAP_17_031: [If adding deviceKey fails, IdentityMap_Receive shall deallocate all resources and return.]*/
+			LogError("Could not attach device key property to message");
+		}
+		/*Codes_SRS_IDMAP_17_032: [IdentityMap_Receive shall call Map_AddOrUpdate with key of "source" and value of "mapping".]*/
+		else if (Map_AddOrUpdate(newProperties, GW_SOURCE_PROPERTY, GW_IDMAP_MODULE) != MAP_OK)
 		{
-			/*Codes_SRS_IDMAP_17_027: [If ConstMap_CloneWriteable fails, IdentityMap_Receive shall deallocate any resources and return.] */
-			LogError("Could not make writeable new properties map");
+			/*Codes_SRS_IDMAP_17_033: [If adding source fails, IdentityMap_Receive shall deallocate all resources and return.]*/
+			LogError("Could not attach source property to message");
 		}
 		else
 		{
-			/*Codes_SRS_IDMAP_17_028: [IdentityMap_Receive shall call Map_AddOrUpdate with key of "deviceName" and value of found deviceId.]*/
-			if (Map_AddOrUpdate(newProperties, GW_DEVICENAME_PROPERTY, match->deviceId) != MAP_OK)
-			{
-				/*Codes_SRS_IDMAP_17_029: [If adding deviceName fails,IdentityMap_Receive shall deallocate all resources and return.]*/
-				LogError("Could not attach device name property to message");
-			}
-			/*Codes_SRS_IDMAP_17_030: [IdentityMap_Receive shall call Map_AddOrUpdate with key of "deviceKey" and value of found deviceKey.]*/
-			else if (Map_AddOrUpdate(newProperties, GW_DEVICEKEY_PROPERTY, match->deviceKey) != MAP_OK)
-			{
-				/*Codes_SRS_IDMAP_17_031: [If adding deviceKey fails, IdentityMap_Receive shall deallocate all resources and return.]*/
-				LogError("Could not attach device key property to message");
-			}
-			/*Codes_SRS_IDMAP_17_032: [IdentityMap_Receive shall call Map_AddOrUpdate with key of "source" and value of "mapping".]*/
-			else if (Map_AddOrUpdate(newProperties, GW_SOURCE_PROPERTY, GW_IDMAP_MODULE) != MAP_OK)
-			{
-				/*Codes_SRS_IDMAP_17_033: [If adding source fails, IdentityMap_Receive shall deallocate all resources and return.]*/
-				LogError("Could not attach source property to message");
-			}
-			else
-			{
-				publish_with_new_properties(newProperties, messageHandle, idModule);
-			}
-			Map_Destroy(newProperties);
+			publish_with_new_properties(newProperties, messageHandle, idModule);
 		}
-		ConstMap_Destroy(properties);
+		Map_Destroy(newProperties);
 	}
 }
 
@@ -459,42 +433,32 @@ static void IdentityMap_RepublishC2D(
 	MESSAGE_HANDLE messageHandle,
 	IDENTITY_MAP_CONFIG * match)
 {
-	CONSTMAP_HANDLE properties = Message_GetProperties(messageHandle);
-	if (properties == NULL)
+	/*Codes_SRS_IDMAP_13_003: [ On a C2D message received, IdentityMap_Receive shall call Map_Create to create an empty map of overriding properties. ]*/
+	MAP_HANDLE newProperties = Map_Create(NULL);
+	if (newProperties == NULL)
 	{
-
-		LogError("Could not extract message properties");
+		/*Codes_SRS_IDMAP_13_004: [ If Map_Create fails, IdentityMap_Receive shall deallocate any resources and return. ]*/
+		LogError("Could not create the map of overriding properties");
 	}
 	else
 	{
-		/*Codes_SRS_IDMAP_17_049: [ On a C2D message received, IdentityMap_Receive shall call ConstMap_CloneWriteable on the message properties. ]*/
-		MAP_HANDLE newProperties = ConstMap_CloneWriteable(properties);
-		if (newProperties == NULL)
+		/*Codes_SRS_IDMAP_17_051: [ IdentityMap_Receive shall call Map_AddOrUpdate with key of "macAddress" and value of found macAddress. ]*/
+		if (Map_AddOrUpdate(newProperties, GW_MAC_ADDRESS_PROPERTY, match->macAddress) != MAP_OK)
+		{
+			/*Codes_SRS_IDMAP_17_052: [ If adding macAddress fails, IdentityMap_Receive shall deallocate all resources and return. ]*/
+			LogError("Could not attach MAC address property to message");
+		}
+		/*Codes_SRS_IDMAP_17_032: [IdentityMap_Receive shall call Map_AddOrUpdate with key of "source" and value of "mapping".]*/
+		else if (Map_AddOrUpdate(newProperties, GW_SOURCE_PROPERTY, GW_IDMAP_MODULE) != MAP_OK)
 		{
-			/*Codes_SRS_IDMAP_17_050: [ If ConstMap_CloneWriteable fails, IdentityMap_Receive shall deallocate any resources and return. ]*/
-			LogError("Could not make writeable new properties map");
+			/*Codes_SRS_IDMAP_17_033: [If adding source fails, IdentityMap_Receive shall deallocate all resources and return.]*/
+			LogError("Could not attach source property to message");
 		}
 		else
 		{
-			/*Codes_SRS_IDMAP_17_051: [ IdentityMap_Receive shall call Map_AddOrUpdate with key of "macAddress" and value of found macAddress. ]*/
-			if (Map_AddOrUpdate(newProperties, GW_MAC_ADDRESS_PROPERTY, match->macAddress) != MAP_OK)
-			{
-				/*Codes_SRS_IDMAP_17_052: [ If adding macAddress fails, IdentityMap_Receive shall deallocate all resources and return. ]*/
-				LogError("Could not attach MAC address property to message");
-			}
-			/*Codes_SRS_IDMAP_17_032: [IdentityMap_Receive shall call Map_AddOrUpdate with key of "source" and value of "mapping".]*/
-			else if (Map_AddOrUpdate(newProperties, GW_SOURCE_PROPERTY, GW_IDMAP_MODULE) != MAP_OK)
-			{
-				/*Codes_SRS_IDMAP_17_033: [If adding source fails, IdentityMap_Receive shall deallocate all resources and return.]*/
-				LogError("Could not attach source property to message");
-			}
-			else
-			{
-				publish_with_new_properties(newProperties, messageHandle, idModule);
-			}
-			Map_Destroy(newProperties);
+			publish_with_new_properties(newProperties, messageHandle, idModule);
 		}
-		ConstMap_Destroy(properties);
+		Map_Destroy(newProperties);
 	}
 }
 
@@ -545,15 +509,13 @@ static void IdentityMap_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messa
 	{
 		IDENTITY_MAP_DATA * idModule = (IDENTITY_MAP_DATA*)moduleHandle;
 
-		CONSTMAP_HANDLE properties = Message_GetProperties(messageHandle);
-
-		const char * source = ConstMap_GetValue(properties, GW_SOURCE_PROPERTY);
+		const char * source = Message_GetProperty(messageHandle, GW_SOURCE_PROPERTY);
 		bool isC2DMessage;
 		if (determine_message_direction(source, &isC2DMessage))
 		{
 			if (isC2DMessage == true)
 			{
-				const char * deviceName = ConstMap_GetValue(properties, GW_DEVICENAME_PROPERTY);
+				const char * deviceName = Message_GetProperty(messageHandle, GW_DEVICENAME_PROPERTY);
 				/*Codes_SRS_IDMAP_17_045: [ If messageHandle properties does not contain "deviceName" property, then the message shall not be marked as a C2D message. */
 				if (deviceName != NULL)
 				{
@@ -577,14 +539,14 @@ static void IdentityMap_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messa
 			else
 			{
 				const char * messageMac = IdentityMapConfig_ToUpperCase(
-					ConstMap_GetValue(properties, GW_MAC_ADDRESS_PROPERTY));
+					Message_GetProperty(messageHandle, GW_MAC_ADDRESS_PROPERTY));
 
 				/*Codes_SRS_IDMAP_17_021: [If messageHandle properties does not contain "macAddress" property, then the function shall return.]*/
 				if (messageMac != NULL)
 				{
 					/*Codes_SRS_IDMAP_17_024: [If messageHandle properties contains properties "deviceName" and "deviceKey", then this function shall return.] */
-					if ((ConstMap_GetValue(properties, GW_DEVICENAME_PROPERTY) == NULL ||
-						ConstMap_GetValue(properties, GW_DEVICEKEY_PROPERTY) == NULL))
+					if ((Message_GetProperty(messageHandle, GW_DEVICENAME_PROPERTY) == NULL ||
+						Message_GetProperty(messageHandle, GW_DEVICEKEY_PROPERTY) == NULL))
 					{
 						if (IdentityMapConfig_IsCanonicalMAC(messageMac) == false)
 						{
@@ -615,8 +577,6 @@ static void IdentityMap_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messa
 				}
 			}
 		}
-		ConstMap_Destroy(properties);
-
 	}
 }
 
@@ -63,8 +63,8 @@ static size_t whenShallConstMap_Create_fail;
 static size_t currentConstMap_Clone_call;
 static size_t whenShallConstMap_Clone_fail;
 
-static size_t currentConstMap_CloneWriteable_call;
-static size_t whenShallConstMap_CloneWriteable_fail;
+static size_t currentMap_Create_call;
+static size_t whenShallMap_Create_fail;
 
 static size_t currentCONSTBUFFER_Create_call;
 static size_t whenShallCONSTBUFFER_Create_fail;
@@ -112,12 +112,34 @@ static MAP_RESULT currentMapResult;
 
 static MESSAGE_BUS_RESULT currentMessageBusResult;
 
-//CONSTMAP GetValue mocks
+//Message_GetProperty and CONSTMAP GetValue mocks
 static const char* macAddressProperties;
 static const char* sourceProperties;
 static const char* deviceNameProperties;
 static const char* deviceKeyProperties;
 
+static const char* getPropertyValue(const char* key)
+{
+	const char * result = VALID_VALUE;
+	if (strcmp(GW_MAC_ADDRESS_PROPERTY, key) == 0)
+	{
+		result = macAddressProperties;
+	}
+	else if (strcmp(GW_SOURCE_PROPERTY, key) == 0)
+	{
+		result = sourceProperties;
+	}
+	else if (strcmp(GW_DEVICENAME_PROPERTY, key) == 0)
+	{
+		result = deviceNameProperties;
+	}
+	else if (strcmp(GW_DEVICEKEY_PROPERTY, key) == 0)
+	{
+		result = deviceKeyProperties;
+	}
+	return result;
+}
+
 static VECTOR_HANDLE testVector1;
 static VECTOR_HANDLE testVector2;
 
@@ -195,37 +217,12 @@ TYPED_MOCK_CLASS(CIdentitymapMocks, CGlobalMock)
 		}
 		MOCK_METHOD_END(CONSTMAP_HANDLE, result3)
 
-	MOCK_STATIC_METHOD_1(, MAP_HANDLE, ConstMap_CloneWriteable, CONSTMAP_HANDLE, handle)
-		MAP_HANDLE result4;
-		currentConstMap_CloneWriteable_call++;
-		if (currentConstMap_CloneWriteable_call == whenShallConstMap_CloneWriteable_fail)
-			result4 = NULL;
-		else
-			result4 = (MAP_HANDLE)(new RefCountObject());
-	MOCK_METHOD_END(MAP_HANDLE, result4)
-
 	MOCK_STATIC_METHOD_1(, void, ConstMap_Destroy, CONSTMAP_HANDLE, map)
 		((RefCountObject*)map)->dec_ref();
 	MOCK_VOID_METHOD_END()
 
 	MOCK_STATIC_METHOD_2(, const char*, ConstMap_GetValue, CONSTMAP_HANDLE, handle, const char*, key)
-		const char * result5 = VALID_VALUE;
-		if (strcmp(GW_MAC_ADDRESS_PROPERTY, key) == 0)
-		{
-			result5 = macAddressProperties;
-		}
-		else if (strcmp(GW_SOURCE_PROPERTY, key) == 0)
-		{
-			result5 = sourceProperties;
-		}
-		else if (strcmp(GW_DEVICENAME_PROPERTY, key) == 0)
-		{
-			result5 = deviceNameProperties;
-		}
-		else if (strcmp(GW_DEVICEKEY_PROPERTY, key) == 0)
-		{
-			result5 = deviceKeyProperties;
-		}
+		const char * result5 = getPropertyValue(key);
 	MOCK_METHOD_END(const char *, result5)
 
 	// CONSTBUFFER mocks.
@@ -263,6 +260,16 @@ TYPED_MOCK_CLASS(CIdentitymapMocks, CGlobalMock)
 
 	// Map related
 
+	// Map_Create
+	MOCK_STATIC_METHOD_1(, MAP_HANDLE, Map_Create, MAP_FILTER_CALLBACK, mapFilterFunc)
+		MAP_HANDLE result4;
+		currentMap_Create_call++;
+		if (currentMap_Create_call == whenShallMap_Create_fail)
+			result4 = NULL;
+		else
+			result4 = (MAP_HANDLE)(new RefCountObject());
+	MOCK_METHOD_END(MAP_HANDLE, result4)
+
 	// Map_Clone
 	MOCK_STATIC_METHOD_1(, MAP_HANDLE, Map_Clone, MAP_HANDLE, sourceMap)
 		((RefCountObject*)sourceMap)->inc_ref();
@@ -292,7 +299,7 @@ TYPED_MOCK_CLASS(CIdentitymapMocks, CGlobalMock)
 		MESSAGE_HANDLE result2 = (MESSAGE_HANDLE)(new RefCountObject());
 	MOCK_METHOD_END(MESSAGE_HANDLE, result2)
 
-	MOCK_STATIC_METHOD_1(, MESSAGE_HANDLE, Message_CreateFromBuffer, const MESSAGE_BUFFER_CONFIG*, cfg)
+	MOCK_STATIC_METHOD_2(, MESSAGE_HANDLE, Message_CreateDerived, MESSAGE_HANDLE, parent, MAP_HANDLE, overrides)
 			MESSAGE_HANDLE result1;
 			currentMessage_call++;
 			if (currentMessage_call == whenShallMessage_fail)
@@ -309,36 +316,14 @@ TYPED_MOCK_CLASS(CIdentitymapMocks, CGlobalMock)
 		((RefCountObject*)message)->inc_ref();
 	MOCK_METHOD_END(MESSAGE_HANDLE, message)
 
-	MOCK_STATIC_METHOD_1(, CONSTMAP_HANDLE, Message_GetProperties, MESSAGE_HANDLE, message)
-		CONSTMAP_HANDLE result1;
-		currentMessage_call++;
-		if (currentMessage_call == whenShallMessage_fail)
-		{
-			result1 = NULL;
-		}
-		else
-		{
-			result1 = ConstMap_Create((MAP_HANDLE)VALID_MAP_HANDLE);
-		}
-	MOCK_METHOD_END(CONSTMAP_HANDLE, result1)
+	MOCK_STATIC_METHOD_2(, const char*, Message_GetProperty, MESSAGE_HANDLE, message, const char*, name)
+		const char * result1 = getPropertyValue(name);
+	MOCK_METHOD_END(const char *, result1)
 
 	MOCK_STATIC_METHOD_1(, const CONSTBUFFER*, Message_GetContent, MESSAGE_HANDLE, message)
 		CONSTBUFFER* result1 = &messageContent;
 	MOCK_METHOD_END(const CONSTBUFFER*, result1)
 
-	MOCK_STATIC_METHOD_1(, CONSTBUFFER_HANDLE, Message_GetContentHandle, MESSAGE_HANDLE, message)
-		CONSTBUFFER_HANDLE result1;
-		currentMessage_call++;
-		if (currentMessage_call == whenShallMessage_fail)
-		{
-			result1 = NULL;
-		}
-		else
-		{
-			result1 = CONSTBUFFER_Create(NULL, 0);
-		}
-	MOCK_METHOD_END(CONSTBUFFER_HANDLE, result1)
-
 	MOCK_STATIC_METHOD_1(, void, Message_Destroy, MESSAGE_HANDLE, message)
 		((RefCountObject*)message)->dec_ref();
 	MOCK_VOID_METHOD_END()
@@ -438,23 +423,22 @@ DECLARE_GLOBAL_MOCK_METHOD_3(CIdentitymapMocks, , MESSAGE_BUS_RESULT, MessageBus
 DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , CONSTMAP_HANDLE, ConstMap_Create, MAP_HANDLE, sourceMap);
 DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , CONSTMAP_HANDLE, ConstMap_Clone, CONSTMAP_HANDLE, handle);
 DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , void, ConstMap_Destroy, CONSTMAP_HANDLE, map);
-DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , MAP_HANDLE, ConstMap_CloneWriteable, CONSTMAP_HANDLE, handle);
 DECLARE_GLOBAL_MOCK_METHOD_2(CIdentitymapMocks, , const char*, ConstMap_GetValue, CONSTMAP_HANDLE, handle, const char *, key);
 
 DECLARE_GLOBAL_MOCK_METHOD_2(CIdentitymapMocks, , CONSTBUFFER_HANDLE, CONSTBUFFER_Create, const unsigned char*, source, size_t, size);
 DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , CONSTBUFFER_HANDLE, CONSTBUFFER_Clone, CONSTBUFFER_HANDLE, constbufferHandle);
 DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , void, CONSTBUFFER_Destroy, CONSTBUFFER_HANDLE, constbufferHandle);
 
+DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , MAP_HANDLE, Map_Create, MAP_FILTER_CALLBACK, mapFilterFunc);
 DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , MAP_HANDLE, Map_Clone, MAP_HANDLE, sourceMap);
 DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , void, Map_Destroy, MAP_HANDLE, ptr);
 DECLARE_GLOBAL_MOCK_METHOD_3(CIdentitymapMocks, , MAP_RESULT, Map_AddOrUpdate, MAP_HANDLE, handle, const char*, key, const char*, value);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , MESSAGE_HANDLE, Message_Create, const MESSAGE_CONFIG*, cfg);
-DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , MESSAGE_HANDLE, Message_CreateFromBuffer, const MESSAGE_BUFFER_CONFIG*, cfg);
+DECLARE_GLOBAL_MOCK_METHOD_2(CIdentitymapMocks, , MESSAGE_HANDLE, Message_CreateDerived, MESSAGE_HANDLE, parent, MAP_HANDLE, overrides);
 DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , MESSAGE_HANDLE, Message_Clone, MESSAGE_HANDLE, message);
-DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , CONSTMAP_HANDLE, Message_GetProperties, MESSAGE_HANDLE, message);
+DECLARE_GLOBAL_MOCK_METHOD_2(CIdentitymapMocks, , const char*, Message_GetProperty, MESSAGE_HANDLE, message, const char*, name);
 DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , const CONSTBUFFER*, Message_GetContent, MESSAGE_HANDLE, message);
-DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , CONSTBUFFER_HANDLE, Message_GetContentHandle, MESSAGE_HANDLE, message);
 DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , void, Message_Destroy, MESSAGE_HANDLE, message);
 
 // vector.h
@@ -518,8 +502,8 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 		deviceKeyProperties = NULL;
 		currentMessage_call = 0;
 		whenShallMessage_fail = 0;
-		currentConstMap_CloneWriteable_call = 0;
-		whenShallConstMap_CloneWriteable_fail = 0;
+		currentMap_Create_call = 0;
+		whenShallMap_Create_fail = 0;
 		currentMap_call = 0;
 		whenShallMap_fail = 0;
 		currentMessageBusResult = MESSAGE_BUS_OK;
@@ -1510,11 +1494,7 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 
 		mocks.ResetAllCalls();
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
 
 
 		///Act
@@ -1547,13 +1527,8 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 
 		mocks.ResetAllCalls();
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_MAC_ADDRESS_PROPERTY));
 		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 			.IgnoreAllArguments();
 
@@ -1592,20 +1567,13 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 
 		mocks.ResetAllCalls();
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_MAC_ADDRESS_PROPERTY));
 		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 			.IgnoreAllArguments();
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICEKEY_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICENAME_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICEKEY_PROPERTY));
 
 
 		///Act
@@ -1642,20 +1610,13 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 
 		mocks.ResetAllCalls();
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_MAC_ADDRESS_PROPERTY));
 		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 			.IgnoreAllArguments();
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICEKEY_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICENAME_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICEKEY_PROPERTY));
 
 
 		///Act
@@ -1692,20 +1653,13 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 
 		mocks.ResetAllCalls();
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_MAC_ADDRESS_PROPERTY));
 		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 			.IgnoreAllArguments();
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICEKEY_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICENAME_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICEKEY_PROPERTY));
 
 
 
@@ -1742,69 +1696,13 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 
 		mocks.ResetAllCalls();
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-			.IgnoreAllArguments();
-		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICEKEY_PROPERTY))
-			.IgnoreArgument(1);
-
-
-		///Act
-		theAPIS->Module_Receive(n, m);
-
-		///Assert
-		mocks.AssertActualAndExpectedCalls();
-
-		///Ablution
-		Message_Destroy(m);
-		theAPIS->Module_Destroy(n);
-		MessageBus_Destroy(bus);
-
-	}
-
-	/*Tests_SRS_IDMAP_17_021: [If messageHandle properties does not contain "macAddress" property, then the function shall return.]*/
-	TEST_FUNCTION(IdentityMap_Receive_D2C_get_properties_2_fail)
-	{
-		///Arrange
-		CIdentitymapMocks mocks;
-		const MODULE_APIS* theAPIS = Module_GetAPIS();
-
-		unsigned char fake;
-		MESSAGE_BUS_HANDLE bus = MessageBus_Create();
-		auto n = theAPIS->Module_Create(bus, testVector2);
-
-		MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
-		auto m = Message_Create(&cfg);
-
-		macAddressProperties = "aa:aa:bb:bb:cc:cc";
-		sourceProperties = GW_SOURCE_BLE_TELEMETRY;
-
-		mocks.ResetAllCalls();
-
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_MAC_ADDRESS_PROPERTY));
 		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 			.IgnoreAllArguments();
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
-			.IgnoreArgument(1);
-
-		whenShallMessage_fail = 2;
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICENAME_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICEKEY_PROPERTY));
 
 
 		///Act
@@ -1820,8 +1718,8 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 
 	}
 
-	/*Tests_SRS_IDMAP_17_027: [If ConstMap_CloneWriteable fails, IdentityMap_Receive shall deallocate any resources and return.]*/
-	TEST_FUNCTION(IdentityMap_Receive_D2C_CloneWriteable_fails)
+	/*Tests_SRS_IDMAP_13_002: [If Map_Create fails, IdentityMap_Receive shall deallocate any resources and return.]*/
+	TEST_FUNCTION(IdentityMap_Receive_D2C_Map_Create_fails)
 	{
 		///Arrange
 		CIdentitymapMocks mocks;
@@ -1840,23 +1738,14 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 		mocks.ResetAllCalls();
 
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_MAC_ADDRESS_PROPERTY));
 		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 			.IgnoreAllArguments();
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		whenShallConstMap_CloneWriteable_fail = 1;
-		STRICT_EXPECTED_CALL(mocks, ConstMap_CloneWriteable(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICENAME_PROPERTY));
+		whenShallMap_Create_fail = 1;
+		STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
 
 
 		///Act
@@ -1892,25 +1781,16 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 		mocks.ResetAllCalls();
 
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_MAC_ADDRESS_PROPERTY));
 		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 			.IgnoreAllArguments();
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICENAME_PROPERTY));
 
-		STRICT_EXPECTED_CALL(mocks, ConstMap_CloneWriteable(IGNORED_PTR_ARG)).IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
 		STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
 
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
 		whenShallMap_fail = 1;
 		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY, "aNiceDevice")).IgnoreArgument(1);
 
@@ -1948,23 +1828,14 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 		mocks.ResetAllCalls();
 
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_MAC_ADDRESS_PROPERTY));
 		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 			.IgnoreAllArguments();
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICENAME_PROPERTY));
 
-		STRICT_EXPECTED_CALL(mocks, ConstMap_CloneWriteable(IGNORED_PTR_ARG)).IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
 		STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
 		whenShallMap_fail = 2;
 		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY, "aNiceDevice")).IgnoreArgument(1);
@@ -2004,22 +1875,13 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 		mocks.ResetAllCalls();
 
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_MAC_ADDRESS_PROPERTY));
 		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 			.IgnoreAllArguments();
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_CloneWriteable(IGNORED_PTR_ARG)).IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICENAME_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
 		STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
 		whenShallMap_fail = 3;
 		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY, "aNiceDevice")).IgnoreArgument(1);
@@ -2040,65 +1902,8 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 
 	}
 
-	/*Tests_SRS_IDMAP_17_035: [If cloning message content fails, IdentityMap_Receive shall deallocate all resources and return.]*/
-	TEST_FUNCTION(IdentityMap_Receive_D2C_Message_GetContent_fail)
-	{
-		///Arrange
-		CIdentitymapMocks mocks;
-		const MODULE_APIS* theAPIS = Module_GetAPIS();
-
-		unsigned char fake;
-		MESSAGE_BUS_HANDLE bus = MessageBus_Create();
-		auto n = theAPIS->Module_Create(bus, testVector2);
-
-		MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
-		auto m = Message_Create(&cfg);
-
-		macAddressProperties = "aa:aa:bb:bb:cc:cc";
-		sourceProperties = GW_SOURCE_BLE_TELEMETRY;
-
-		mocks.ResetAllCalls();
-
-
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-			.IgnoreAllArguments();
-		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_CloneWriteable(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY, "aNiceDevice")).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_DEVICEKEY_PROPERTY, "aNiceKey")).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY, GW_IDMAP_MODULE)).IgnoreArgument(1);
-		whenShallMessage_fail = 3;
-		STRICT_EXPECTED_CALL(mocks, Message_GetContentHandle(m));
-
-
-		///Act
-		theAPIS->Module_Receive(n, m);
-
-		///Assert
-		mocks.AssertActualAndExpectedCalls();
-
-		///Ablution
-		Message_Destroy(m);
-		theAPIS->Module_Destroy(n);
-		MessageBus_Destroy(bus);
-
-	}
-
-	/*Tests_SRS_IDMAP_17_037: [If creating new message fails, IdentityMap_Receive shall deallocate all resources and return.]*/
-	TEST_FUNCTION(IdentityMap_Receive_D2C_Message_CreateFromBuffer_fail)
+	/*Tests_SRS_IDMAP_13_006: [If creating new message fails, IdentityMap_Receive shall deallocate all resources and return.]*/
+	TEST_FUNCTION(IdentityMap_Receive_D2C_Message_CreateDerived_fail)
 	{
 		///Arrange
 		CIdentitymapMocks mocks;
@@ -2117,22 +1922,13 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 		mocks.ResetAllCalls();
 
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_MAC_ADDRESS_PROPERTY));
 		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 			.IgnoreAllArguments();
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_CloneWriteable(IGNORED_PTR_ARG)).IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICENAME_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
 		STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY, "aNiceDevice"))
 			.IgnoreArgument(1);
@@ -2140,12 +1936,8 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY, GW_IDMAP_MODULE))
 			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, Message_GetContentHandle(m));
-		whenShallMessage_fail = 4;
-		STRICT_EXPECTED_CALL(mocks, Message_CreateFromBuffer(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, CONSTBUFFER_Create(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
-			.IgnoreAllArguments();
-		STRICT_EXPECTED_CALL(mocks, CONSTBUFFER_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+		whenShallMessage_fail = 1;
+		STRICT_EXPECTED_CALL(mocks, Message_CreateDerived(m, IGNORED_PTR_ARG)).IgnoreArgument(2);
 
 
 		///Act
@@ -2182,22 +1974,13 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 
 
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_MAC_ADDRESS_PROPERTY));
 		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 			.IgnoreAllArguments();
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_CloneWriteable(IGNORED_PTR_ARG)).IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICENAME_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
 		STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY, "aNiceDevice"))
 			.IgnoreArgument(1);
@@ -2205,12 +1988,8 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY, GW_IDMAP_MODULE))
 			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, Message_GetContentHandle(m));
-		STRICT_EXPECTED_CALL(mocks, Message_CreateFromBuffer(IGNORED_PTR_ARG)).IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_CreateDerived(m, IGNORED_PTR_ARG)).IgnoreArgument(2);
 		STRICT_EXPECTED_CALL(mocks, Message_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, CONSTBUFFER_Create(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
-			.IgnoreAllArguments();
-		STRICT_EXPECTED_CALL(mocks, CONSTBUFFER_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
 		currentMessageBusResult = MESSAGE_BUS_ERROR;
 		STRICT_EXPECTED_CALL(mocks, MessageBus_Publish(bus, n, IGNORED_PTR_ARG))
 			.IgnoreArgument(3);
@@ -2229,12 +2008,11 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 
 	}
 
-	/*Tests_SRS_IDMAP_17_026: [On a message which passes all checks, IdentityMap_Receive shall call ConstMap_CloneWriteable on the message properties.]*/
+	/*Tests_SRS_IDMAP_13_001: [On a D2C message received, IdentityMap_Receive shall call Map_Create to create an empty map of overriding properties.]*/
 	/*Tests_SRS_IDMAP_17_028: [IdentityMap_Receive shall call Map_AddOrUpdate with key of "deviceName" and value of found deviceId.]*/
 	/*Tests_SRS_IDMAP_17_032: [IdentityMap_Receive shall call Map_AddOrUpdate with key of "source" and value of "mapping".]*/
 	/*Tests_SRS_IDMAP_17_030: [IdentityMap_Receive shall call Map_AddOrUpdate with key of "deviceKey" and value of found deviceKey.]*/
-	/*Tests_SRS_IDMAP_17_034: [IdentityMap_Receive shall clone message content.]*/
-	/*Tests_SRS_IDMAP_17_036: [IdentityMap_Receive shall create a new message by calling Message_Create with new map and cloned content.]*/
+	/*Tests_SRS_IDMAP_13_005: [IdentityMap_Receive shall create a new message by calling Message_CreateDerived with messageHandle and the map of overriding properties, so that the new message shares the content and the other properties of messageHandle.]*/
 	/*Tests_SRS_IDMAP_17_038: [IdentityMap_Receive shall call MessageBus_Publish with busHandle and new message.]*/
 	/*Tests_SRS_IDMAP_17_039: [IdentityMap_Receive will destroy all resources it created.]*/
 	TEST_FUNCTION(IdentityMap_Receive_D2C_Success)
@@ -2276,22 +2054,13 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 		mocks.ResetAllCalls();
 
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_MAC_ADDRESS_PROPERTY));
 		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 			.IgnoreAllArguments();
 		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_CloneWriteable(IGNORED_PTR_ARG)).IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICENAME_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
 		STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY, "Sensor7"))
 			.IgnoreArgument(1);
@@ -2299,12 +2068,8 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY, GW_IDMAP_MODULE))
 			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, Message_GetContentHandle(m));
-		STRICT_EXPECTED_CALL(mocks, Message_CreateFromBuffer(IGNORED_PTR_ARG)).IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_CreateDerived(m, IGNORED_PTR_ARG)).IgnoreArgument(2);
 		STRICT_EXPECTED_CALL(mocks, Message_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, CONSTBUFFER_Create(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
-			.IgnoreAllArguments();
-		STRICT_EXPECTED_CALL(mocks, CONSTBUFFER_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, MessageBus_Publish((MESSAGE_BUS_HANDLE)&fake, n, IGNORED_PTR_ARG))
 			.IgnoreArgument(3);
 
@@ -2322,11 +2087,10 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 
 	}
 
-	//Tests_SRS_IDMAP_17_049: [ On a C2D message received, IdentityMap_Receive shall call ConstMap_CloneWriteable on the message properties. ]
+	//Tests_SRS_IDMAP_13_003: [ On a C2D message received, IdentityMap_Receive shall call Map_Create to create an empty map of overriding properties. ]
 	//Tests_SRS_IDMAP_17_051: [ IdentityMap_Receive shall call Map_AddOrUpdate with key of "macAddress" and value of found macAddress. ]
 	//Tests_SRS_IDMAP_17_032: [IdentityMap_Receive shall call Map_AddOrUpdate with key of "source" and value of "mapping".]
-	//Tests_SRS_IDMAP_17_034: [IdentityMap_Receive shall clone message content.]
-	//Tests_SRS_IDMAP_17_036: [IdentityMap_Receive shall create a new message by calling Message_CreateFromBuffer with new map and cloned content.]
+	//Tests_SRS_IDMAP_13_005: [IdentityMap_Receive shall create a new message by calling Message_CreateDerived with messageHandle and the map of overriding properties, so that the new message shares the content and the other properties of messageHandle.]
 	//Tests_SRS_IDMAP_17_038: [IdentityMap_Receive shall call MessageBus_Publish with busHandle and new message.]
 	TEST_FUNCTION(IdentityMap_Receive_C2D_Success)
 	{
@@ -2367,29 +2131,17 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 		mocks.ResetAllCalls();
 
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICENAME_PROPERTY));
             
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_CloneWriteable(IGNORED_PTR_ARG)).IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
 		STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY, "07:07:07:07:07:07"))
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY, GW_IDMAP_MODULE))
 			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, Message_GetContentHandle(m));
-		STRICT_EXPECTED_CALL(mocks, Message_CreateFromBuffer(IGNORED_PTR_ARG)).IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_CreateDerived(m, IGNORED_PTR_ARG)).IgnoreArgument(2);
 		STRICT_EXPECTED_CALL(mocks, Message_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, CONSTBUFFER_Create(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
-			.IgnoreAllArguments();
-		STRICT_EXPECTED_CALL(mocks, CONSTBUFFER_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, MessageBus_Publish((MESSAGE_BUS_HANDLE)&fake, n, IGNORED_PTR_ARG))
 			.IgnoreArgument(3);
 
@@ -2447,19 +2199,11 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 		mocks.ResetAllCalls();
 
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICENAME_PROPERTY));
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
 
-		STRICT_EXPECTED_CALL(mocks, ConstMap_CloneWriteable(IGNORED_PTR_ARG)).IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
 		STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
 
 		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY, "07:07:07:07:07:07"))
@@ -2523,19 +2267,11 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 		mocks.ResetAllCalls();
 
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICENAME_PROPERTY));
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
 
-		STRICT_EXPECTED_CALL(mocks, ConstMap_CloneWriteable(IGNORED_PTR_ARG)).IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
 		STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
 
 		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY, "07:07:07:07:07:07"))
@@ -2556,8 +2292,8 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 
 	}
 
-	//Tests_SRS_IDMAP_17_050: [ If ConstMap_CloneWriteable fails, IdentityMap_Receive shall deallocate any resources and return. ]
-	TEST_FUNCTION(IdentityMap_Receive_C2D_clone_writeable_fails)
+	//Tests_SRS_IDMAP_13_004: [ If Map_Create fails, IdentityMap_Receive shall deallocate any resources and return. ]
+	TEST_FUNCTION(IdentityMap_Receive_C2D_Map_Create_fails)
 	{
 		///Arrange
 		CIdentitymapMocks mocks;
@@ -2596,20 +2332,11 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 		mocks.ResetAllCalls();
 
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICENAME_PROPERTY));
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
 
-		STRICT_EXPECTED_CALL(mocks, ConstMap_CloneWriteable(IGNORED_PTR_ARG))
-			.IgnoreArgument(1)
+		STRICT_EXPECTED_CALL(mocks, Map_Create(NULL))
 			.SetFailReturn((MAP_HANDLE)NULL);
 
 
@@ -2626,70 +2353,6 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 
 	}
 
-	//Tests_SRS_IDMAP_17_046: [ If messageHandle properties does not contain a "source" property, then the message shall not be marked as a C2D message. ]
-	TEST_FUNCTION(IdentityMap_Receive_C2D_getproperties_fails)
-	{
-		///Arrange
-		CIdentitymapMocks mocks;
-		const MODULE_APIS* theAPIS = Module_GetAPIS();
-
-		unsigned char fake;
-		MESSAGE_BUS_HANDLE bus = (MESSAGE_BUS_HANDLE)&fake;
-		VECTOR_HANDLE v = VECTOR_create(sizeof(IDENTITY_MAP_CONFIG));
-
-		IDENTITY_MAP_CONFIG c1 = { "01:01:01:01:01:01", "Sensor1", "theKeyFor1" };
-		IDENTITY_MAP_CONFIG c2 = { "02:02:02:02:02:02", "Sensor2", "theKeyFor2" };
-		IDENTITY_MAP_CONFIG c3 = { "03:03:03:03:03:03", "Sensor3", "theKeyFor3" };
-		IDENTITY_MAP_CONFIG c4 = { "04:04:04:04:04:04", "Sensor4", "theKeyFor4" };
-		IDENTITY_MAP_CONFIG c5 = { "05:05:05:05:05:05", "Sensor5", "theKeyFor5" };
-		IDENTITY_MAP_CONFIG c6 = { "06:06:06:06:06:06", "Sensor6", "theKeyFor6" };
-		IDENTITY_MAP_CONFIG c7 = { "07:07:07:07:07:07", "Sensor7", "theKeyFor7" };
-		IDENTITY_MAP_CONFIG c8 = { "08:08:08:08:08:08",	"Sensor8", "theKeyFor8" };
-		IDENTITY_MAP_CONFIG c9 = { "09:09:09:09:09:09", "Sensor9",  "theKeyFor9" };
-		VECTOR_push_back(v, &c1, 1);
-		VECTOR_push_back(v, &c2, 1);
-		VECTOR_push_back(v, &c3, 1);
-		VECTOR_push_back(v, &c4, 1);
-		VECTOR_push_back(v, &c5, 1);
-		VECTOR_push_back(v, &c6, 1);
-		VECTOR_push_back(v, &c7, 1);
-		VECTOR_push_back(v, &c8, 1);
-		VECTOR_push_back(v, &c9, 1);
-		auto n = theAPIS->Module_Create(bus, v);
-
-		MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
-		auto m = Message_Create(&cfg);
-
-		deviceNameProperties = "Sensor7";
-		sourceProperties = GW_IOTHUB_MODULE;
-
-		mocks.ResetAllCalls();
-
-
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
-			.IgnoreArgument(1);
-
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m))
-			.SetFailReturn((CONSTMAP_HANDLE)NULL);
-
-		///Act
-		theAPIS->Module_Receive(n, m);
-
-		///Assert
-		mocks.AssertActualAndExpectedCalls();
-
-		///Ablution
-		Message_Destroy(m);
-		VECTOR_destroy(v);
-		theAPIS->Module_Destroy(n);
-
-	}
-
 	//Tests_SRS_IDMAP_17_048: [ If the deviceName of the message is not found in deviceToMacArray, then the message shall not be marked as a C2D message. ]
 	TEST_FUNCTION(IdentityMap_Receive_C2D_id_no_match_no_new_msg)
 	{
@@ -2730,13 +2393,8 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 		mocks.ResetAllCalls();
 
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICENAME_PROPERTY));
 
 		///Act
 		theAPIS->Module_Receive(n, m);
@@ -2792,13 +2450,8 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 		mocks.ResetAllCalls();
 
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_DEVICENAME_PROPERTY));
 
 		///Act
 		theAPIS->Module_Receive(n, m);
@@ -2853,11 +2506,7 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 		mocks.ResetAllCalls();
 
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
 
 
 		///Act
@@ -2915,11 +2564,7 @@ BEGIN_TEST_SUITE(identitymap_unittests)
 		mocks.ResetAllCalls();
 
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(m, GW_SOURCE_PROPERTY));
 
 
 		///Act
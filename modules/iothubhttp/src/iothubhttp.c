@@ -230,6 +230,13 @@ static IOTHUBMESSAGE_DISPOSITION_RESULT IoTHubHttp_ReceiveMessageCallback(IOTHUB
                         LogError("Property [%s] did not add properly", GW_DEVICENAME_PROPERTY);
                         result = IOTHUBMESSAGE_ABANDONED;
                     }
+                    /*Codes_SRS_IOTHUBHTTP_13_001: [ IoTHubHttp_ReceiveMessageCallback shall set the property MESSAGE_BUS_PRIORITY_PROPERTY to MESSAGE_BUS_PRIORITY_HIGH_VALUE so that cloud to device messages are delivered ahead of telemetry. ]*/
+                    else if (Map_AddOrUpdate(newProperties, MESSAGE_BUS_PRIORITY_PROPERTY, MESSAGE_BUS_PRIORITY_HIGH_VALUE) != MAP_OK)
+                    {
+                        /*Codes_SRS_IOTHUBHTTP_17_022: [ If message properties fail to combine, IoTHubHttp_ReceiveMessageCallback shall return IOTHUBMESSAGE_ABANDONED. ]*/
+                        LogError("Property [%s] did not add properly", MESSAGE_BUS_PRIORITY_PROPERTY);
+                        result = IOTHUBMESSAGE_ABANDONED;
+                    }
                     else
                     {
                         /*Codes_SRS_IOTHUBHTTP_17_016: [ IoTHubHttp_ReceiveMessageCallback shall create a new message from combined properties, the size and buffer. ]*/
@@ -451,8 +458,7 @@ static void IoTHubHttp_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messag
     }
     else
     {
-        CONSTMAP_HANDLE properties = Message_GetProperties(messageHandle);
-        const char* source = ConstMap_GetValue(properties, SOURCE); /*properties is !=NULL by contract of Message*/
+        const char* source = Message_GetProperty(messageHandle, SOURCE);
 
         /*Codes_SRS_IOTHUBHTTP_02_010: [If message properties do not contain a property called "source" having the value set to "mapping" then IoTHubHttp_Receive shall do nothing.]*/
         if (
@@ -465,7 +471,7 @@ static void IoTHubHttp_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messag
         else
         {
             /*Codes_SRS_IOTHUBHTTP_02_011: [If message properties do not contain a property called "deviceName" having a non-NULL value then IoTHubHttp_Receive shall do nothing.]*/
-            const char* deviceName = ConstMap_GetValue(properties, DEVICENAME);
+            const char* deviceName = Message_GetProperty(messageHandle, DEVICENAME);
             if (deviceName == NULL)
             {
                 /*do nothing, not a message for this module*/
@@ -473,7 +479,7 @@ static void IoTHubHttp_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messag
             else
             {
                 /*Codes_SRS_IOTHUBHTTP_02_012: [If message properties do not contain a property called "deviceKey" having a non-NULL value then IoTHubHttp_Receive shall do nothing.]*/
-                const char* deviceKey = ConstMap_GetValue(properties, DEVICEKEY);
+                const char* deviceKey = Message_GetProperty(messageHandle, DEVICEKEY);
                 if (deviceKey == NULL)
                 {
                     /*do nothing, missing device key*/
@@ -515,7 +521,6 @@ static void IoTHubHttp_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messag
                 }
             }
         }
-        ConstMap_Destroy(properties);
     }
     /*Codes_SRS_IOTHUBHTTP_02_022: [IoTHubHttp_Receive shall return.]*/
 }
@@ -157,6 +157,84 @@ static const IOTHUBHTTP_CONFIG config_with_NULL_IoTHubSuffix = { "theIoTHub42",
 static const IOTHUBHTTP_CONFIG config_valid = { "theIoTHub42", "theAwesomeSuffix.com"};
 
 
+/*the properties of the fake messages, shared by the Message_GetProperties, Message_GetProperty and ConstMap_GetValue mocks*/
+static CONSTMAP_HANDLE getMessageProperties(MESSAGE_HANDLE message)
+{
+    CONSTMAP_HANDLE result;
+    if (message == MESSAGE_HANDLE_WITHOUT_SOURCE)
+    {
+        result = CONSTMAP_HANDLE_WITHOUT_SOURCE;
+    }
+    else if (message == MESSAGE_HANDLE_WITH_SOURCE_NOT_SET_TO_MAPPING)
+    {
+        result = CONSTMAP_HANDLE_WITH_SOURCE_NOT_SET_TO_MAPPING;
+    }
+    else if (message == MESSAGE_HANDLE_VALID_1)
+    {
+        result = CONSTMAP_HANDLE_VALID_1;
+    }
+    else if (message == MESSAGE_HANDLE_VALID_2)
+    {
+        result = CONSTMAP_HANDLE_VALID_2;
+    }
+    else
+    {
+        result = NULL;
+    }
+    return result;
+}
+
+static const char* getConstMapValue(CONSTMAP_HANDLE handle, const char* key)
+{
+    const char* result;
+    if (handle == CONSTMAP_HANDLE_WITHOUT_SOURCE)
+    {
+        result = NULL;
+    }
+    else if (handle == CONSTMAP_HANDLE_WITH_SOURCE_NOT_SET_TO_MAPPING)
+    {
+        if (strcmp(key, "source") == 0)
+        {
+            result = "notMapping";
+        }
+        else
+        {
+            result = NULL;
+        }
+    }
+    else if (handle == CONSTMAP_HANDLE_VALID_1)
+    {
+        size_t i;
+        result = NULL;
+        for (i = 0; i < sizeof(CONSTMAP_KEYS_VALID_1)/sizeof(CONSTMAP_KEYS_VALID_1[0]); i++)
+        {
+            if (strcmp(CONSTMAP_KEYS_VALID_1[i], key) == 0)
+            {
+                result = CONSTMAP_VALUES_VALID_1[i];
+                break;
+            }
+        }
+    }
+    else if (handle == CONSTMAP_HANDLE_VALID_2)
+    {
+        size_t i;
+        result = NULL;
+        for (i = 0; i < sizeof(CONSTMAP_KEYS_VALID_2)/sizeof(CONSTMAP_KEYS_VALID_2[0]); i++)
+        {
+            if (strcmp(CONSTMAP_KEYS_VALID_2[i], key) == 0)
+            {
+                result = CONSTMAP_VALUES_VALID_2[i];
+                break;
+            }
+        }
+    }
+    else
+    {
+        result = NULL;
+    }
+    return result;
+}
+
 TYPED_MOCK_CLASS(CIoTHubHTTPMocks, CGlobalMock)
 {
 public:
@@ -401,76 +479,15 @@ public:
     MOCK_VOID_METHOD_END()
 
     MOCK_STATIC_METHOD_1(, CONSTMAP_HANDLE, Message_GetProperties, MESSAGE_HANDLE, message)
-        CONSTMAP_HANDLE result2;
-        if (message == MESSAGE_HANDLE_WITHOUT_SOURCE)
-        {
-            result2 = CONSTMAP_HANDLE_WITHOUT_SOURCE;
-        }
-        else if (message == MESSAGE_HANDLE_WITH_SOURCE_NOT_SET_TO_MAPPING)
-        {
-            result2 = CONSTMAP_HANDLE_WITH_SOURCE_NOT_SET_TO_MAPPING;
-        }
-        else if (message == MESSAGE_HANDLE_VALID_1)
-        {
-            result2 = CONSTMAP_HANDLE_VALID_1;
-        }
-        else if (message == MESSAGE_HANDLE_VALID_2)
-        {
-            result2 = CONSTMAP_HANDLE_VALID_2;
-        }
-        else
-        {
-            result2 = NULL;
-        }
+        CONSTMAP_HANDLE result2 = getMessageProperties(message);
     MOCK_METHOD_END(CONSTMAP_HANDLE, result2)
 
+    MOCK_STATIC_METHOD_2(, const char*, Message_GetProperty, MESSAGE_HANDLE, message, const char*, name)
+        const char* result2 = getConstMapValue(getMessageProperties(message), name);
+    MOCK_METHOD_END(const char*, result2)
+
     MOCK_STATIC_METHOD_2(, const char*, ConstMap_GetValue, CONSTMAP_HANDLE, handle, const char*, key)
-        const char* result2;
-        if (handle == CONSTMAP_HANDLE_WITHOUT_SOURCE)
-        {
-            result2 = NULL;
-        }
-        else if (handle == CONSTMAP_HANDLE_WITH_SOURCE_NOT_SET_TO_MAPPING)
-        {
-            if (strcmp(key, "source") == 0)
-            {
-                result2 = "notMapping";
-            }
-            else
-            {
-                result2 = NULL;
-            }
-        }
-        else if (handle == CONSTMAP_HANDLE_VALID_1)
-        {
-            size_t i;
-            result2 = NULL;
-            for (i = 0; i < sizeof(CONSTMAP_KEYS_VALID_1)/sizeof(CONSTMAP_KEYS_VALID_1[0]); i++)
-            {
-                if (strcmp(CONSTMAP_KEYS_VALID_1[i], key) == 0)
-                {
-                    result2 = CONSTMAP_VALUES_VALID_1[i];
-                    break;
-                }
-            }
-        }
-        else if (handle == CONSTMAP_HANDLE_VALID_2)
-        {
-            size_t i;
-            result2 = NULL;
-            for (i = 0; i < sizeof(CONSTMAP_KEYS_VALID_2)/sizeof(CONSTMAP_KEYS_VALID_2[0]); i++)
-            {
-                if (strcmp(CONSTMAP_KEYS_VALID_2[i], key) == 0)
-                {
-                    result2 = CONSTMAP_VALUES_VALID_2[i];
-                    break;
-                }
-            }
-        }
-        else
-        {
-            result2 = NULL;
-        }
+        const char* result2 = getConstMapValue(handle, key);
     MOCK_METHOD_END(const char*, result2)
 
     MOCK_STATIC_METHOD_3(, MAP_RESULT, Map_AddOrUpdate, MAP_HANDLE, handle, const char*, key, const char*, value)
@@ -602,6 +619,7 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CIoTHubHTTPMocks, , const char*, STRING_c_str, STRI
 DECLARE_GLOBAL_MOCK_METHOD_2(CIoTHubHTTPMocks, , IOTHUB_CLIENT_HANDLE, IoTHubClient_CreateWithTransport, TRANSPORT_HANDLE, transport, const IOTHUB_CLIENT_CONFIG*, config)
 DECLARE_GLOBAL_MOCK_METHOD_1(CIoTHubHTTPMocks, , void, IoTHubClient_Destroy, IOTHUB_CLIENT_HANDLE, iotHubClientHandle)
 DECLARE_GLOBAL_MOCK_METHOD_1(CIoTHubHTTPMocks, , CONSTMAP_HANDLE, Message_GetProperties, MESSAGE_HANDLE, message)
+DECLARE_GLOBAL_MOCK_METHOD_2(CIoTHubHTTPMocks, , const char*, Message_GetProperty, MESSAGE_HANDLE, message, const char*, name)
 DECLARE_GLOBAL_MOCK_METHOD_1(CIoTHubHTTPMocks, , MESSAGE_HANDLE, Message_Create, const MESSAGE_CONFIG*, cfg)
 DECLARE_GLOBAL_MOCK_METHOD_1(CIoTHubHTTPMocks, , void, Message_Destroy, MESSAGE_HANDLE, message)
 DECLARE_GLOBAL_MOCK_METHOD_2(CIoTHubHTTPMocks, , const char*, ConstMap_GetValue, CONSTMAP_HANDLE, handle, const char*, key)
@@ -1250,15 +1268,11 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
         auto module = Module_Create(MESSAGE_BUS_HANDLE_VALID, &config_valid);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(MESSAGE_HANDLE_VALID_1));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "source"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "source"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceName"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceName"));
-
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceKey"));
 
         /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
         STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
@@ -1367,15 +1381,11 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
         Module_Receive(module, MESSAGE_HANDLE_VALID_1);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(MESSAGE_HANDLE_VALID_1));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "source"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "source"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceName"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceName"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceKey"));
 
         /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. One in this test*/
         STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
@@ -1450,15 +1460,11 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
         Module_Receive(module, MESSAGE_HANDLE_VALID_1);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(MESSAGE_HANDLE_VALID_2));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_2, "source"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_2, "source"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_2, "deviceName"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_2, "deviceName"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_2, "deviceKey"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_2, "deviceKey"));
 
         /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. One in this test*/
         STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
@@ -1563,15 +1569,11 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
         auto module = Module_Create(MESSAGE_BUS_HANDLE_VALID, &config_valid);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(MESSAGE_HANDLE_VALID_1));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "source"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "source"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceName"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceName"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceKey"));
 
         /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
         STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
@@ -1678,15 +1680,11 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
         auto module = Module_Create(MESSAGE_BUS_HANDLE_VALID, &config_valid);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(MESSAGE_HANDLE_VALID_1));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "source"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "source"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceName"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceName"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceKey"));
 
         /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
         STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
@@ -1789,15 +1787,11 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
         auto module = Module_Create(MESSAGE_BUS_HANDLE_VALID, &config_valid);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(MESSAGE_HANDLE_VALID_1));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "source"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "source"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceName"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceName"));
-
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceKey"));
 
         /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
         STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
@@ -1896,15 +1890,11 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
         auto module = Module_Create(MESSAGE_BUS_HANDLE_VALID, &config_valid);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(MESSAGE_HANDLE_VALID_1));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "source"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "source"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceName"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceName"));
-
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceKey"));
 
         /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
         STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
@@ -1997,15 +1987,11 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
         auto module = Module_Create(MESSAGE_BUS_HANDLE_VALID, &config_valid);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(MESSAGE_HANDLE_VALID_1));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "source"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "source"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceName"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceName"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceKey"));
 
         /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
         STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
@@ -2078,15 +2064,11 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
         auto module = Module_Create(MESSAGE_BUS_HANDLE_VALID, &config_valid);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(MESSAGE_HANDLE_VALID_1));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "source"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "source"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceName"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceName"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceKey"));
 
         /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
         STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
@@ -2154,15 +2136,11 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
 		auto module = Module_Create(MESSAGE_BUS_HANDLE_VALID, &config_valid);
 		mocks.ResetAllCalls();
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(MESSAGE_HANDLE_VALID_1));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-			.IgnoreArgument(1);
-
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "source"));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "source"));
 
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceName"));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceName"));
 
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceKey"));
 
 		/*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
 		STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
@@ -2200,15 +2178,11 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
         auto module = Module_Create(MESSAGE_BUS_HANDLE_VALID, &config_valid);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(MESSAGE_HANDLE_VALID_1));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "source"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "source"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceName"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceName"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceKey"));
 
         /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
         STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
@@ -2265,15 +2239,11 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
 		auto module = Module_Create(MESSAGE_BUS_HANDLE_VALID, &config_valid);
 		mocks.ResetAllCalls();
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(MESSAGE_HANDLE_VALID_1));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-			.IgnoreArgument(1);
-
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "source"));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "source"));
 
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceName"));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceName"));
 
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceKey"));
 
 		/*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
 		STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
@@ -2336,15 +2306,11 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
         auto module = Module_Create(MESSAGE_BUS_HANDLE_VALID, &config_valid);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(MESSAGE_HANDLE_VALID_1));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "source"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "source"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceName"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceName"));
-
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceKey"));
 
         /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
         STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
@@ -2386,15 +2352,11 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
 		auto module = Module_Create(MESSAGE_BUS_HANDLE_VALID, &config_valid);
 		mocks.ResetAllCalls();
 
-		STRICT_EXPECTED_CALL(mocks, Message_GetProperties(MESSAGE_HANDLE_VALID_1));
-		STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "source"));
 
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "source"));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceName"));
 
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceName"));
-
-		STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
+		STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceKey"));
 
 		/*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
 		STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
@@ -2426,15 +2388,11 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
         auto module = Module_Create(MESSAGE_BUS_HANDLE_VALID, &config_valid);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(MESSAGE_HANDLE_VALID_1));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "source"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "source"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceName"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceName"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"))
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceKey"))
             .SetReturn((const char*)NULL);
 
         ///act
@@ -2455,13 +2413,9 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
         auto module = Module_Create(MESSAGE_BUS_HANDLE_VALID, &config_valid);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(MESSAGE_HANDLE_VALID_1));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "source"));
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "source"));
 
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceName"))
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "deviceName"))
             .SetReturn((const char*)NULL);
 
         ///act
@@ -2482,11 +2436,7 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
         auto module = Module_Create(MESSAGE_BUS_HANDLE_VALID, &config_valid);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(MESSAGE_HANDLE_VALID_1));
-        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "source"))
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperty(MESSAGE_HANDLE_VALID_1, "source"))
             .SetReturn((const char*)NULL);
 
         ///act
@@ -2503,6 +2453,7 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
 	//Tests_SRS_IOTHUBHTTP_17_009: [ IoTHubHttp_ReceiveMessageCallback shall define a property "source" as "IoTHubHTTP". ]
 	//Tests_SRS_IOTHUBHTTP_17_010: [ IoTHubHttp_ReceiveMessageCallback shall define a property "deviceName" as the PERSONALITY's deviceName. ]
 	//Tests_SRS_IOTHUBHTTP_17_011: [ IoTHubHttp_ReceiveMessageCallback shall combine message properties with the "source" and "deviceName" properties. ]
+	//Tests_SRS_IOTHUBHTTP_13_001: [ IoTHubHttp_ReceiveMessageCallback shall set the property MESSAGE_BUS_PRIORITY_PROPERTY to MESSAGE_BUS_PRIORITY_HIGH_VALUE so that cloud to device messages are delivered ahead of telemetry. ]
 	//Tests_SRS_IOTHUBHTTP_17_014: [ If Message content type is IOTHUBMESSAGE_STRING, IoTHubHttp_ReceiveMessageCallback shall get the buffer from results of IoTHubMessage_GetString. ]
 	//Tests_SRS_IOTHUBHTTP_17_015: [ If Message content type is IOTHUBMESSAGE_STRING, IoTHubHttp_ReceiveMessageCallback shall get the buffer size from the string length. ]
 	//Tests_SRS_IOTHUBHTTP_17_016: [ IoTHubHttp_ReceiveMessageCallback shall create a new message from combined properties, the size and buffer. ]
@@ -2530,6 +2481,7 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
 		STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, Map_Add(MAP_HANDLE_VALID_1, GW_DEVICENAME_PROPERTY, "firstDevice"));
+		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(MAP_HANDLE_VALID_1, MESSAGE_BUS_PRIORITY_PROPERTY, MESSAGE_BUS_PRIORITY_HIGH_VALUE));
 		STRICT_EXPECTED_CALL(mocks, Message_Create(IGNORED_PTR_ARG))
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, MessageBus_Publish(MESSAGE_BUS_HANDLE_VALID, NULL, IGNORED_PTR_ARG))
@@ -2555,6 +2507,7 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
 	//Tests_SRS_IOTHUBHTTP_17_009: [ IoTHubHttp_ReceiveMessageCallback shall define a property "source" as "IoTHubHTTP". ]
 	//Tests_SRS_IOTHUBHTTP_17_010: [ IoTHubHttp_ReceiveMessageCallback shall define a property "deviceName" as the PERSONALITY's deviceName. ]
 	//Tests_SRS_IOTHUBHTTP_17_011: [ IoTHubHttp_ReceiveMessageCallback shall combine message properties with the "source" and "deviceName" properties. ]
+	//Tests_SRS_IOTHUBHTTP_13_001: [ IoTHubHttp_ReceiveMessageCallback shall set the property MESSAGE_BUS_PRIORITY_PROPERTY to MESSAGE_BUS_PRIORITY_HIGH_VALUE so that cloud to device messages are delivered ahead of telemetry. ]
 	//Tests_SRS_IOTHUBHTTP_17_013: [ If Message content type is IOTHUBMESSAGE_BYTEARRAY, IoTHubHttp_ReceiveMessageCallback shall get the size and buffer from the results of IoTHubMessage_GetByteArray. ]
 	//Tests_SRS_IOTHUBHTTP_17_016: [ IoTHubHttp_ReceiveMessageCallback shall create a new message from combined properties, the size and buffer. ]
 	//Tests_SRS_IOTHUBHTTP_17_018: [ IoTHubHttp_ReceiveMessageCallback shall call MessageBus_Publish with the new message and the busHandle. ]
@@ -2583,6 +2536,7 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
 		STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, Map_Add(MAP_HANDLE_VALID_1, GW_DEVICENAME_PROPERTY, "firstDevice"));
+		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(MAP_HANDLE_VALID_1, MESSAGE_BUS_PRIORITY_PROPERTY, MESSAGE_BUS_PRIORITY_HIGH_VALUE));
 		STRICT_EXPECTED_CALL(mocks, Message_Create(IGNORED_PTR_ARG))
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, MessageBus_Publish(MESSAGE_BUS_HANDLE_VALID, NULL, IGNORED_PTR_ARG))
@@ -2628,6 +2582,7 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
 		STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, Map_Add(MAP_HANDLE_VALID_1, GW_DEVICENAME_PROPERTY, "firstDevice"));
+		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(MAP_HANDLE_VALID_1, MESSAGE_BUS_PRIORITY_PROPERTY, MESSAGE_BUS_PRIORITY_HIGH_VALUE));
 		STRICT_EXPECTED_CALL(mocks, Message_Create(IGNORED_PTR_ARG))
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, MessageBus_Publish(MESSAGE_BUS_HANDLE_VALID, NULL, IGNORED_PTR_ARG))
@@ -2674,6 +2629,7 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
 		STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, Map_Add(MAP_HANDLE_VALID_1, GW_DEVICENAME_PROPERTY, "firstDevice"));
+		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(MAP_HANDLE_VALID_1, MESSAGE_BUS_PRIORITY_PROPERTY, MESSAGE_BUS_PRIORITY_HIGH_VALUE));
 		STRICT_EXPECTED_CALL(mocks, Message_Create(IGNORED_PTR_ARG))
 			.IgnoreArgument(1)
 			.SetFailReturn((MESSAGE_HANDLE)NULL);
@@ -2692,6 +2648,48 @@ BEGIN_TEST_SUITE(iothubhttp_unittests)
 		Module_Destroy(module);
 	}
 
+	//Tests_SRS_IOTHUBHTTP_17_022: [ If message properties fail to combined, IoTHubHttp_ReceiveMessageCallback shall return IOTHUBMESSAGE_ABANDONED. ]
+	TEST_FUNCTION(IoTHubHttp_callback_priority_Map_AddOrUpdate_fails)
+	{
+		///arrange
+		CIoTHubHTTPMocks mocks;
+		auto module = Module_Create(MESSAGE_BUS_HANDLE_VALID, &config_valid);
+		Module_Receive(module, MESSAGE_HANDLE_VALID_1);
+		IOTHUB_MESSAGE_HANDLE hubMsg = IOTHUB_MESSAGE_HANDLE_VALID;
+		mocks.ResetAllCalls();
+
+		IoTHubHttp_receive_message_content = "a message";
+		IoTHubHttp_receive_message_size = 9;
+
+		STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetContentType(hubMsg))
+			.SetReturn(IOTHUBMESSAGE_BYTEARRAY);
+		STRICT_EXPECTED_CALL(mocks, IoTHubMessage_GetByteArray(hubMsg, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+			.IgnoreArgument(2)
+			.IgnoreArgument(3);
+		STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(hubMsg))
+			.SetReturn(MAP_HANDLE_VALID_1);
+		STRICT_EXPECTED_CALL(mocks, Map_Add(MAP_HANDLE_VALID_1, GW_SOURCE_PROPERTY, GW_IOTHUB_MODULE));
+		STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
+			.IgnoreArgument(1);
+		STRICT_EXPECTED_CALL(mocks, Map_Add(MAP_HANDLE_VALID_1, GW_DEVICENAME_PROPERTY, "firstDevice"));
+		STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(MAP_HANDLE_VALID_1, MESSAGE_BUS_PRIORITY_PROPERTY, MESSAGE_BUS_PRIORITY_HIGH_VALUE))
+			.SetFailReturn(MAP_ERROR);
+
+
+		///act
+
+		// IoTHubHttp_receive_message_callback_function and IoTHubHttp_receive_message_userContext set in mock
+		auto result = IoTHubHttp_receive_message_callback_function(hubMsg, IoTHubHttp_receive_message_userContext);
+
+
+		///assert
+		ASSERT_ARE_EQUAL(IOTHUBMESSAGE_DISPOSITION_RESULT, result, IOTHUBMESSAGE_ABANDONED);
+		mocks.AssertActualAndExpectedCalls();
+
+		///cleanup
+		Module_Destroy(module);
+	}
+
 	//Tests_SRS_IOTHUBHTTP_17_022: [ If message properties fail to combined, IoTHubHttp_ReceiveMessageCallback shall return IOTHUBMESSAGE_ABANDONED. ]
 	TEST_FUNCTION(IoTHubHttp_callback_Map_Add_2_fails)
 	{
@@ -93,52 +93,44 @@ void BLEPrinter_Receive(MODULE_HANDLE module, MESSAGE_HANDLE message)
 {
     if (message != NULL)
     {
-        CONSTMAP_HANDLE props = Message_GetProperties(message);
-        if (props != NULL)
+        const char* source = Message_GetProperty(message, GW_SOURCE_PROPERTY);
+        if (source != NULL && strcmp(source, GW_SOURCE_BLE_TELEMETRY) == 0)
         {
-            const char* source = ConstMap_GetValue(props, GW_SOURCE_PROPERTY);
-            if (source != NULL && strcmp(source, GW_SOURCE_BLE_TELEMETRY) == 0)
+            const char* ble_controller_id = Message_GetProperty(message, GW_BLE_CONTROLLER_INDEX_PROPERTY);
+            const char* mac_address_str = Message_GetProperty(message, GW_MAC_ADDRESS_PROPERTY);
+            const char* timestamp = Message_GetProperty(message, GW_TIMESTAMP_PROPERTY);
+            const char* characteristic_uuid = Message_GetProperty(message, GW_CHARACTERISTIC_UUID_PROPERTY);
+            const CONSTBUFFER* buffer = Message_GetContent(message);
+            if (buffer != NULL && characteristic_uuid != NULL)
             {
-                const char* ble_controller_id = ConstMap_GetValue(props, GW_BLE_CONTROLLER_INDEX_PROPERTY);
-                const char* mac_address_str = ConstMap_GetValue(props, GW_MAC_ADDRESS_PROPERTY);
-                const char* timestamp = ConstMap_GetValue(props, GW_TIMESTAMP_PROPERTY);
-                const char* characteristic_uuid = ConstMap_GetValue(props, GW_CHARACTERISTIC_UUID_PROPERTY);
-                const CONSTBUFFER* buffer = Message_GetContent(message);
-                if (buffer != NULL && characteristic_uuid != NULL)
+                // dispatch the message based on the characteristic uuid
+                size_t i;
+                for (i = 0; i < g_dispatch_entries_length; i++)
                 {
-                    // dispatch the message based on the characteristic uuid
-                    size_t i;
-                    for (i = 0; i < g_dispatch_entries_length; i++)
+                    if (g_ascii_strcasecmp(
+                            characteristic_uuid,
+                            g_dispatch_entries[i].characteristic_uuid
+                        ) == 0)
                     {
-                        if (g_ascii_strcasecmp(
-                                characteristic_uuid,
-                                g_dispatch_entries[i].characteristic_uuid
-                            ) == 0)
-                        {
-                            g_dispatch_entries[i].message_printer(
-                                g_dispatch_entries[i].name,
-                                timestamp,
-                                buffer
-                            );
-                            break;
-                        }
-                    }
-
-                    if (i == g_dispatch_entries_length)
-                    {
-                        // dispatch to default printer
-                        print_default(characteristic_uuid, timestamp, buffer);
+                        g_dispatch_entries[i].message_printer(
+                            g_dispatch_entries[i].name,
+                            timestamp,
+                            buffer
+                        );
+                        break;
                     }
                 }
-                else
+
+                if (i == g_dispatch_entries_length)
                 {
-                    LogError("Message is invalid. Nothing to print.");
+                    // dispatch to default printer
+                    print_default(characteristic_uuid, timestamp, buffer);
                 }
             }
-        }
-        else
-        {
-            LogError("Message_GetProperties for the message returned NULL");
+            else
+            {
+                LogError("Message is invalid. Nothing to print.");
+            }
         }
     }
     else
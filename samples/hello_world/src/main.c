@@ -3,8 +3,69 @@
 
 #include <stdio.h>
 
+#include "azure_c_shared_utility/threadapi.h"
 #include "gateway.h"
 
+/*how often the statistics of the message bus are printed*/
+#define STATISTICS_INTERVAL_MS 10000
+
+typedef struct STATISTICS_PRINTER_TAG
+{
+    GATEWAY_HANDLE gateway;
+    volatile int stop;
+    int first_module;
+} STATISTICS_PRINTER;
+
+static void print_module_statistics(const char* module_name, MODULE_HANDLE module, const MESSAGE_BUS_MODULE_STATISTICS* statistics, void* context)
+{
+    STATISTICS_PRINTER* printer = (STATISTICS_PRINTER*)context;
+    size_t i;
+    (void)module;
+
+    printf("%s{\"name\":\"%s\",\"enqueued\":%llu,\"delivered\":%llu,\"dropped\":%llu,\"queued\":%lu,\"queued_high_water\":%lu,\"receive_time_us\":%llu,\"latency_samples\":%llu,\"latency_buckets_us\":[",
+        printer->first_module ? "" : ",",
+        (module_name == NULL) ? "" : module_name,
+        (unsigned long long)statistics->enqueued,
+        (unsigned long long)statistics->delivered,
+        (unsigned long long)statistics->dropped,
+        (unsigned long)statistics->queued,
+        (unsigned long)statistics->queued_high_water,
+        (unsigned long long)statistics->receive_time_us,
+        (unsigned long long)statistics->latency_samples);
+    for (i = 0; i < MESSAGE_BUS_LATENCY_BUCKET_COUNT; i++)
+    {
+        printf("%s%llu", (i == 0) ? "" : ",", (unsigned long long)statistics->latency_buckets[i]);
+    }
+    printf("]}");
+    printer->first_module = 0;
+}
+
+/*prints the statistics of the modules as JSON every STATISTICS_INTERVAL_MS until asked to stop*/
+static int statistics_printer(void* context)
+{
+    STATISTICS_PRINTER* printer = (STATISTICS_PRINTER*)context;
+    unsigned int elapsed_ms = 0;
+
+    while (printer->stop == 0)
+    {
+        ThreadAPI_Sleep(100);
+        elapsed_ms += 100;
+        if (elapsed_ms >= STATISTICS_INTERVAL_MS)
+        {
+            elapsed_ms = 0;
+            printer->first_module = 1;
+            printf("{\"modules\":[");
+            if (Gateway_LL_GetStatistics(printer->gateway, print_module_statistics, printer) != 0)
+            {
+                printf("failed to read the statistics of some modules\n");
+            }
+            printf("]}\n");
+        }
+    }
+
+    return 0;
+}
+
 int main(int argc, char** argv)
 {
     GATEWAY_HANDLE gateway;
@@ -21,9 +82,24 @@ int main(int argc, char** argv)
         }
         else
         {
+            STATISTICS_PRINTER printer = { gateway, 0, 1 };
+            THREAD_HANDLE printer_thread;
+            int printer_started = (ThreadAPI_Create(&printer_thread, statistics_printer, &printer) == THREADAPI_OK);
+            if (!printer_started)
+            {
+                printf("failed to start printing the statistics of the message bus\n");
+            }
+
             printf("gateway successfully created from JSON\n");
             printf("gateway shall run until ENTER is pressed\n");
             (void)getchar();
+
+            if (printer_started)
+            {
+                int thread_result;
+                printer.stop = 1;
+                (void)ThreadAPI_Join(printer_thread, &thread_result);
+            }
             Gateway_LL_Destroy(gateway);
         }
     }